@@ -176,6 +176,7 @@ if [ $SPDK_RUN_FUNCTIONAL_TEST -eq 1 ]; then
 		run_test "blockdev_general" $rootdir/test/bdev/blockdev.sh
 		run_test "bdev_raid" $rootdir/test/bdev/bdev_raid.sh
 		run_test "bdevperf_config" $rootdir/test/bdev/bdevperf/test_config.sh
+		run_test "bdevperf_shutdown" $rootdir/test/bdev/bdevperf/test_shutdown.sh
 		if [[ $(uname -s) == Linux ]]; then
 			run_test "reactor_set_interrupt" $rootdir/test/interrupt/reactor_set_interrupt.sh
 			run_test "reap_unregistered_poller" $rootdir/test/interrupt/reap_unregistered_poller.sh
@@ -20,6 +20,7 @@
 #include "spdk/conf.h"
 #include "spdk/zipf.h"
 #include "spdk/histogram_data.h"
+#include "spdk/json.h"
 
 #define BDEVPERF_CONFIG_MAX_FILENAME 1024
 #define BDEVPERF_CONFIG_UNDEFINED -1
@@ -32,6 +33,9 @@ struct bdevperf_task {
 	void				*buf;
 	void				*md_buf;
 	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	/* Time the I/O was scheduled to be issued at in open-loop mode */
+	uint64_t			submit_tsc;
 	struct bdevperf_task		*task_to_abort;
 	enum spdk_bdev_io_type		io_type;
 	TAILQ_ENTRY(bdevperf_task)	link;
@@ -70,6 +74,11 @@ static struct spdk_conf *g_bdevperf_conf = NULL;
 static const char *g_bdevperf_conf_file = NULL;
 static double g_zipf_theta;
 static bool g_random_map = false;
+static int g_rate_iops = 0;
+static bool g_poisson_arrivals = false;
+static const char *g_json_output_file = NULL;
+static const char *g_replay_file = NULL;
+static bool g_replay_asap = false;
 
 static struct spdk_cpuset g_all_cpuset;
 static struct spdk_poller *g_perf_timer = NULL;
@@ -149,11 +158,58 @@ struct bdevperf_job {
 	TAILQ_HEAD(, bdevperf_task)	task_list;
 	uint64_t			run_time_in_usec;
 
+	/* Open-loop mode: I/O is issued at a fixed rate or at the times recorded in a
+	 * replayed trace instead of keeping queue_depth I/O outstanding, and queue_depth
+	 * limits the number of outstanding I/O. */
+	uint64_t			rate_iops;
+	bool				poisson_arrivals;
+	double				rate_ticks_per_io;
+	double				rate_next_tsc;
+	struct replay_queue		*replay;
+	uint64_t			replay_index;
+	uint64_t			replay_skipped;
+	uint64_t			open_loop_max_lag_tsc;
+	int				open_loop_outstanding;
+	struct spdk_poller		*open_loop_poller;
+
 	/* keep channel's histogram data before being destroyed */
 	struct spdk_histogram_data	*histogram;
 	struct spdk_bit_array		*random_map;
 };
 
+/* I/O recorded in a trace */
+struct replay_io {
+	uint64_t			time_ns;
+	uint64_t			offset;
+	uint32_t			length;
+	enum spdk_bdev_io_type		io_type;
+};
+
+/* I/O that was submitted from a single queue (CPU, lcore or file) of the traced system */
+struct replay_queue {
+	uint32_t			id;
+	char				*name;
+	struct replay_io		*ios;
+	uint64_t			num_ios;
+	uint64_t			max_ios;
+	uint32_t			max_length;
+	TAILQ_ENTRY(replay_queue)	link;
+};
+
+enum replay_format {
+	REPLAY_FORMAT_UNKNOWN = 0,
+	REPLAY_FORMAT_BLKPARSE,
+	REPLAY_FORMAT_FIO_IOLOG_V2,
+	REPLAY_FORMAT_FIO_IOLOG_V3,
+	REPLAY_FORMAT_SPDK_TRACE,
+};
+
+static TAILQ_HEAD(, replay_queue) g_replay_queues = TAILQ_HEAD_INITIALIZER(g_replay_queues);
+static uint32_t g_replay_num_queues;
+static uint64_t g_replay_base_ns = UINT64_MAX;
+/* Size in bytes of the offsets and lengths recorded in the trace, 0 for blocks of the target bdev */
+static uint32_t g_replay_unit;
+
 struct spdk_bdevperf {
 	TAILQ_HEAD(, bdevperf_job)	jobs;
 	uint32_t			running_jobs;
@@ -176,6 +232,7 @@ enum job_config_rw {
 	JOB_CONFIG_RW_UNMAP,
 	JOB_CONFIG_RW_FLUSH,
 	JOB_CONFIG_RW_WRITE_ZEROES,
+	JOB_CONFIG_RW_REPLAY,
 };
 
 /* Storing values from a section of job config file */
@@ -186,6 +243,8 @@ struct job_config {
 	int				bs;
 	int				iodepth;
 	int				rwmixread;
+	int				rate_iops;
+	struct replay_queue		*replay_queue;
 	uint32_t			lcore;
 	int64_t				offset;
 	uint64_t			length;
@@ -223,6 +282,12 @@ struct lcore_thread {
 TAILQ_HEAD(, lcore_thread) g_lcore_thread_list
 	= TAILQ_HEAD_INITIALIZER(g_lcore_thread_list);
 
+static inline bool
+bdevperf_job_is_open_loop(struct bdevperf_job *job)
+{
+	return job->rate_iops != 0 || job->replay != NULL;
+}
+
 /*
  * Cumulative Moving Average (CMA): average of all data up to current
  * Exponential Moving Average (EMA): weighted mean of the previous n data and more weight is given to recent
@@ -293,6 +358,15 @@ performance_dump_job(struct bdevperf_aggregate_stats *stats, struct bdevperf_job
 		printf("\t Verification LBA range: start 0x%" PRIx64 " length 0x%" PRIx64 "\n",
 		       job->ios_base, job->size_in_ios);
 	}
+	if (job->rate_iops != 0) {
+		printf("\t Open loop: %" PRIu64 " IO/s with %s arrivals, latency measured from intended issue time\n",
+		       job->rate_iops, job->poisson_arrivals ? "poisson" : "fixed");
+	}
+	if (job->replay != NULL) {
+		printf("\t Replay: queue %" PRIu32 ", %" PRIu64 " of %" PRIu64 " I/O submitted, %" PRIu64 " skipped, %s\n",
+		       job->replay->id, job->replay_index - job->replay_skipped, job->replay->num_ios,
+		       job->replay_skipped, g_replay_asap ? "as fast as possible" : "recorded timing");
+	}
 
 	if (g_performance_dump_active == true) {
 		/* Use job's actual run time as Job has ended */
@@ -513,6 +587,157 @@ print_bucket(void *ctx, uint64_t start, uint64_t end, uint64_t count,
 	       so_far_pct, count);
 }
 
+struct latency_percentiles_ctx {
+	struct spdk_json_write_ctx	*w;
+	double				next;
+	int				step;
+};
+
+/* Report percentiles the way HdrHistogram does: every step halves the remaining
+ * distance to 100%, until the remaining distance is less than a single I/O. */
+static void
+write_percentile(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+		 uint64_t total, uint64_t so_far)
+{
+	struct latency_percentiles_ctx *pctx = ctx;
+	double so_far_pct;
+
+	if (count == 0) {
+		return;
+	}
+
+	so_far_pct = (double)so_far / total;
+	while (pctx->next <= so_far_pct) {
+		spdk_json_write_object_begin(pctx->w);
+		spdk_json_write_named_double(pctx->w, "percentile", pctx->next * 100);
+		spdk_json_write_named_double(pctx->w, "latency_us",
+					     (double)end * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+		spdk_json_write_named_uint64(pctx->w, "count", so_far);
+		spdk_json_write_object_end(pctx->w);
+
+		if (pctx->next >= 1.0) {
+			pctx->next = 2.0;
+			break;
+		}
+
+		pctx->step++;
+		pctx->next = 1.0 - ldexp(1.0, -pctx->step);
+		if ((1.0 - pctx->next) * total < 1.0) {
+			pctx->next = 1.0;
+		}
+	}
+}
+
+static void
+bdevperf_write_job_json(struct spdk_json_write_ctx *w, struct bdevperf_job *job)
+{
+	struct latency_info latency_info = {};
+	struct latency_percentiles_ctx pctx = { .w = w, .next = 0.5, .step = 1 };
+	uint64_t tsc_rate = spdk_get_ticks_hz();
+	uint64_t total_io = job->io_completed + job->io_failed;
+	double io_per_second = 0.0, average_latency = 0.0;
+
+	spdk_histogram_data_iterate(job->histogram, get_avg_latency, &latency_info);
+	if (job->run_time_in_usec != 0) {
+		io_per_second = (double)job->io_completed * SPDK_SEC_TO_USEC / job->run_time_in_usec;
+	}
+	if (total_io != 0) {
+		average_latency = (double)latency_info.total / total_io * SPDK_SEC_TO_USEC / tsc_rate;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "job", job->name);
+	spdk_json_write_named_string_fmt(w, "core_mask", "0x%s",
+					 spdk_cpuset_fmt(spdk_thread_get_cpumask(job->thread)));
+	spdk_json_write_named_uint32(w, "io_size", job->io_size);
+	spdk_json_write_named_uint32(w, "queue_depth", job->queue_depth);
+	spdk_json_write_named_bool(w, "open_loop", bdevperf_job_is_open_loop(job));
+	if (job->rate_iops != 0) {
+		spdk_json_write_named_uint64(w, "rate_iops", job->rate_iops);
+		spdk_json_write_named_string(w, "arrivals", job->poisson_arrivals ? "poisson" : "fixed");
+	}
+	if (job->replay != NULL) {
+		spdk_json_write_named_object_begin(w, "replay");
+		spdk_json_write_named_uint32(w, "queue", job->replay->id);
+		if (job->replay->name != NULL) {
+			spdk_json_write_named_string(w, "queue_name", job->replay->name);
+		}
+		spdk_json_write_named_uint64(w, "trace_ios", job->replay->num_ios);
+		spdk_json_write_named_uint64(w, "submitted", job->replay_index - job->replay_skipped);
+		spdk_json_write_named_uint64(w, "skipped", job->replay_skipped);
+		spdk_json_write_named_string(w, "timing", g_replay_asap ? "asap" : "recorded");
+		spdk_json_write_object_end(w);
+	}
+	if (bdevperf_job_is_open_loop(job)) {
+		spdk_json_write_named_double(w, "max_issue_lag_us",
+					     (double)job->open_loop_max_lag_tsc * SPDK_SEC_TO_USEC / tsc_rate);
+	}
+	spdk_json_write_named_double(w, "runtime_s", (double)job->run_time_in_usec / SPDK_SEC_TO_USEC);
+	spdk_json_write_named_uint64(w, "io_completed", job->io_completed);
+	spdk_json_write_named_uint64(w, "io_failed", job->io_failed);
+	spdk_json_write_named_uint64(w, "io_timeout", job->io_timeout);
+	spdk_json_write_named_double(w, "iops", io_per_second);
+	spdk_json_write_named_double(w, "mibps", io_per_second * job->io_size / (1024 * 1024));
+
+	spdk_json_write_named_object_begin(w, "latency_us");
+	spdk_json_write_named_double(w, "average", average_latency);
+	spdk_json_write_named_double(w, "min", (double)latency_info.min * SPDK_SEC_TO_USEC / tsc_rate);
+	spdk_json_write_named_double(w, "max", (double)latency_info.max * SPDK_SEC_TO_USEC / tsc_rate);
+	spdk_json_write_named_array_begin(w, "percentiles");
+	spdk_histogram_data_iterate(job->histogram, write_percentile, &pctx);
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
+static int
+bdevperf_json_write_cb(void *cb_ctx, const void *data, size_t size)
+{
+	FILE *file = cb_ctx;
+
+	return fwrite(data, 1, size, file) == size ? 0 : -1;
+}
+
+static void
+bdevperf_write_json_results(void)
+{
+	struct spdk_json_write_ctx *w;
+	struct bdevperf_job *job;
+	FILE *file;
+
+	if (strcmp(g_json_output_file, "-") == 0) {
+		file = stdout;
+	} else {
+		file = fopen(g_json_output_file, "w");
+		if (file == NULL) {
+			fprintf(stderr, "Could not open %s: %s\n", g_json_output_file, spdk_strerror(errno));
+			return;
+		}
+	}
+
+	w = spdk_json_write_begin(bdevperf_json_write_cb, file, SPDK_JSON_WRITE_FLAG_FORMATTED);
+	if (w == NULL) {
+		fprintf(stderr, "Could not write JSON results\n");
+	} else {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_array_begin(w, "results");
+		TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+			bdevperf_write_job_json(w, job);
+		}
+		spdk_json_write_array_end(w);
+		spdk_json_write_object_end(w);
+		spdk_json_write_end(w);
+		fputc('\n', file);
+	}
+
+	if (file != stdout) {
+		fclose(file);
+	} else {
+		fflush(stdout);
+	}
+}
+
 static void
 bdevperf_test_done(void *ctx)
 {
@@ -567,6 +792,10 @@ bdevperf_test_done(void *ctx)
 
 	fflush(stdout);
 
+	if (g_json_output_file != NULL) {
+		bdevperf_write_json_results();
+	}
+
 	if (g_latency_display_level == 0 || g_stats.total_io_completed == 0) {
 		goto clean;
 	}
@@ -662,9 +891,12 @@ bdevperf_job_empty(struct bdevperf_job *job)
 
 	end_tsc = spdk_get_ticks() - g_start_tsc;
 	job->run_time_in_usec = end_tsc * SPDK_SEC_TO_USEC / spdk_get_ticks_hz();
-	/* keep histogram info before channel is destroyed */
-	spdk_bdev_channel_get_histogram(job->ch, bdevperf_channel_get_histogram_cb,
-					job->histogram);
+	/* keep histogram info before channel is destroyed. Open-loop jobs
+	 * measure latency from the intended issue time in their own histogram. */
+	if (!bdevperf_job_is_open_loop(job)) {
+		spdk_bdev_channel_get_histogram(job->ch, bdevperf_channel_get_histogram_cb,
+						job->histogram);
+	}
 	spdk_put_io_channel(job->ch);
 	spdk_bdev_close(job->bdev_desc);
 	spdk_thread_send_msg(g_main_thread, bdevperf_job_end, NULL);
@@ -700,6 +932,7 @@ bdevperf_job_drain(void *ctx)
 	struct bdevperf_job *job = ctx;
 
 	spdk_poller_unregister(&job->run_timer);
+	spdk_poller_unregister(&job->open_loop_poller);
 	if (job->reset) {
 		spdk_poller_unregister(&job->reset_timer);
 	}
@@ -770,14 +1003,14 @@ bdevperf_verify_dif(struct bdevperf_task *task, struct iovec *iovs, int iovcnt)
 	}
 
 	if (spdk_bdev_is_md_interleaved(bdev)) {
-		rc = spdk_dif_verify(iovs, iovcnt, job->io_size_blocks, &dif_ctx, &err_blk);
+		rc = spdk_dif_verify(iovs, iovcnt, task->num_blocks, &dif_ctx, &err_blk);
 	} else {
 		struct iovec md_iov = {
 			.iov_base	= task->md_buf,
-			.iov_len	= spdk_bdev_get_md_size(bdev) * job->io_size_blocks,
+			.iov_len	= spdk_bdev_get_md_size(bdev) * task->num_blocks,
 		};
 
-		rc = spdk_dix_verify(iovs, iovcnt, &md_iov, job->io_size_blocks, &dif_ctx, &err_blk);
+		rc = spdk_dix_verify(iovs, iovcnt, &md_iov, task->num_blocks, &dif_ctx, &err_blk);
 	}
 
 	if (rc != 0) {
@@ -854,6 +1087,11 @@ bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		job->io_failed++;
 	}
 
+	if (bdevperf_job_is_open_loop(job)) {
+		job->open_loop_outstanding--;
+		spdk_histogram_data_tally(job->histogram, spdk_get_ticks() - task->submit_tsc);
+	}
+
 	if (job->verify) {
 		assert(task->offset_blocks / job->io_size_blocks >= job->ios_base);
 		offset_in_ios = task->offset_blocks / job->io_size_blocks - job->ios_base;
@@ -868,12 +1106,15 @@ bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	 * is_draining indicates when time has expired for the test run
 	 * and we are just waiting for the previously submitted I/O
 	 * to complete.  In this case, do not submit a new I/O to replace
-	 * the one just completed.
+	 * the one just completed. In open-loop mode, the next I/O is
+	 * submitted by the poller when it is due.
 	 */
-	if (!job->is_draining) {
-		bdevperf_submit_single(job, task);
-	} else {
+	if (job->is_draining) {
 		bdevperf_end_task(task);
+	} else if (bdevperf_job_is_open_loop(job)) {
+		TAILQ_INSERT_TAIL(&job->task_list, task, link);
+	} else {
+		bdevperf_submit_single(job, task);
 	}
 }
 
@@ -948,14 +1189,14 @@ bdevperf_generate_dif(struct bdevperf_task *task)
 	}
 
 	if (spdk_bdev_is_md_interleaved(bdev)) {
-		rc = spdk_dif_generate(&task->iov, 1, job->io_size_blocks, &dif_ctx);
+		rc = spdk_dif_generate(&task->iov, 1, task->num_blocks, &dif_ctx);
 	} else {
 		struct iovec md_iov = {
 			.iov_base	= task->md_buf,
-			.iov_len	= spdk_bdev_get_md_size(bdev) * job->io_size_blocks,
+			.iov_len	= spdk_bdev_get_md_size(bdev) * task->num_blocks,
 		};
 
-		rc = spdk_dix_generate(&task->iov, 1, &md_iov, job->io_size_blocks, &dif_ctx);
+		rc = spdk_dix_generate(&task->iov, 1, &md_iov, task->num_blocks, &dif_ctx);
 	}
 
 	if (rc != 0) {
@@ -994,31 +1235,31 @@ bdevperf_submit_task(void *arg)
 				rc = spdk_bdev_writev_blocks_with_md(desc, ch, &task->iov, 1,
 								     task->md_buf,
 								     task->offset_blocks,
-								     job->io_size_blocks,
+								     task->num_blocks,
 								     cb_fn, task);
 			}
 		}
 		break;
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 		rc = spdk_bdev_flush_blocks(desc, ch, task->offset_blocks,
-					    job->io_size_blocks, bdevperf_complete, task);
+					    task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 		rc = spdk_bdev_unmap_blocks(desc, ch, task->offset_blocks,
-					    job->io_size_blocks, bdevperf_complete, task);
+					    task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 		rc = spdk_bdev_write_zeroes_blocks(desc, ch, task->offset_blocks,
-						   job->io_size_blocks, bdevperf_complete, task);
+						   task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_READ:
 		if (g_zcopy) {
-			rc = spdk_bdev_zcopy_start(desc, ch, NULL, 0, task->offset_blocks, job->io_size_blocks,
+			rc = spdk_bdev_zcopy_start(desc, ch, NULL, 0, task->offset_blocks, task->num_blocks,
 						   true, bdevperf_zcopy_populate_complete, task);
 		} else {
 			rc = spdk_bdev_read_blocks_with_md(desc, ch, task->buf, task->md_buf,
 							   task->offset_blocks,
-							   job->io_size_blocks,
+							   task->num_blocks,
 							   bdevperf_complete, task);
 		}
 		break;
@@ -1096,7 +1337,7 @@ bdevperf_prep_zcopy_write_task(void *arg)
 	int			rc;
 
 	rc = spdk_bdev_zcopy_start(job->bdev_desc, job->ch, NULL, 0,
-				   task->offset_blocks, job->io_size_blocks,
+				   task->offset_blocks, task->num_blocks,
 				   false, bdevperf_zcopy_get_buf_complete, task);
 	if (rc != 0) {
 		assert(rc == -ENOMEM);
@@ -1191,6 +1432,7 @@ bdevperf_submit_single(struct bdevperf_job *job, struct bdevperf_task *task)
 	 * is absolute (entire bdev LBA range).
 	 */
 	task->offset_blocks = (offset_in_ios + job->ios_base) * job->io_size_blocks;
+	task->num_blocks = job->io_size_blocks;
 
 	if (job->verify || job->reset) {
 		generate_data(task->buf, job->buf_size,
@@ -1295,6 +1537,143 @@ bdevperf_timeout_cb(void *cb_arg, struct spdk_bdev_io *bdev_io)
 	bdevperf_submit_task(task);
 }
 
+static double
+bdevperf_job_next_interval(struct bdevperf_job *job)
+{
+	double u;
+
+	if (!job->poisson_arrivals) {
+		return job->rate_ticks_per_io;
+	}
+
+	/* Exponentially distributed inter-arrival times make a Poisson arrival process */
+	u = (rand_r(&job->seed) + 1.0) / ((double)RAND_MAX + 1.0);
+	return -log(u) * job->rate_ticks_per_io;
+}
+
+static int
+bdevperf_job_rate_poll(void *ctx)
+{
+	struct bdevperf_job *job = ctx;
+	struct bdevperf_task *task;
+	uint64_t now;
+	int count = 0;
+
+	now = spdk_get_ticks();
+
+	/* I/O that is due while queue_depth I/O are outstanding stays scheduled at
+	 * its original time, so that the time it waits for submission is included in
+	 * its latency instead of being omitted. */
+	while (!job->is_draining && job->rate_next_tsc <= now &&
+	       job->open_loop_outstanding < job->queue_depth) {
+		task = bdevperf_job_get_task(job);
+		task->submit_tsc = (uint64_t)job->rate_next_tsc;
+		job->open_loop_max_lag_tsc = spdk_max(job->open_loop_max_lag_tsc, now - task->submit_tsc);
+		job->rate_next_tsc += bdevperf_job_next_interval(job);
+		job->open_loop_outstanding++;
+		count++;
+
+		bdevperf_submit_single(job, task);
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+bdevperf_replay_submit(struct bdevperf_job *job, struct bdevperf_task *task,
+		       const struct replay_io *io)
+{
+	uint64_t num_blocks, offset_blocks, bdev_blocks;
+	uint32_t block_size;
+
+	block_size = spdk_bdev_get_data_block_size(job->bdev);
+	bdev_blocks = spdk_bdev_get_num_blocks(job->bdev);
+
+	if (g_replay_unit == 0) {
+		offset_blocks = io->offset;
+		num_blocks = io->length;
+	} else {
+		offset_blocks = io->offset * g_replay_unit / block_size;
+		num_blocks = SPDK_CEIL_DIV((uint64_t)io->length * g_replay_unit, block_size);
+	}
+
+	if (io->io_type == SPDK_BDEV_IO_TYPE_FLUSH && num_blocks == 0) {
+		/* Flushes without a range apply to the whole device */
+		offset_blocks = 0;
+		num_blocks = bdev_blocks;
+	} else {
+		/* Map the I/O onto the target bdev. Offsets beyond its end wrap around. */
+		num_blocks = spdk_min(spdk_max(num_blocks, 1), job->io_size_blocks);
+		offset_blocks %= bdev_blocks;
+		if (offset_blocks + num_blocks > bdev_blocks) {
+			offset_blocks = bdev_blocks - num_blocks;
+		}
+	}
+
+	task->offset_blocks = offset_blocks;
+	task->num_blocks = num_blocks;
+	task->io_type = io->io_type;
+	if (task->io_type == SPDK_BDEV_IO_TYPE_WRITE) {
+		task->iov.iov_base = task->buf;
+		task->iov.iov_len = num_blocks * spdk_bdev_get_block_size(job->bdev);
+	}
+
+	bdevperf_submit_task(task);
+}
+
+static int
+bdevperf_job_replay_poll(void *ctx)
+{
+	struct bdevperf_job *job = ctx;
+	struct replay_queue *queue = job->replay;
+	struct bdevperf_task *task;
+	struct replay_io *io;
+	uint64_t now, due_tsc;
+	int count = 0;
+
+	now = spdk_get_ticks();
+
+	while (!job->is_draining && job->replay_index < queue->num_ios &&
+	       job->open_loop_outstanding < job->queue_depth) {
+		io = &queue->ios[job->replay_index];
+		if (g_replay_asap) {
+			due_tsc = now;
+		} else {
+			/* Keep the timing of the trace across all queues */
+			due_tsc = g_start_tsc + (uint64_t)((double)(io->time_ns - g_replay_base_ns) *
+							   spdk_get_ticks_hz() / SPDK_SEC_TO_NSEC);
+			if (due_tsc > now) {
+				break;
+			}
+		}
+
+		job->replay_index++;
+		if (!spdk_bdev_io_type_supported(job->bdev, io->io_type)) {
+			job->replay_skipped++;
+			continue;
+		}
+
+		task = bdevperf_job_get_task(job);
+		task->submit_tsc = due_tsc;
+		job->open_loop_max_lag_tsc = spdk_max(job->open_loop_max_lag_tsc, now - due_tsc);
+		job->open_loop_outstanding++;
+		count++;
+
+		bdevperf_replay_submit(job, task, io);
+	}
+
+	if (job->replay_index == queue->num_ios && !job->is_draining) {
+		/* The whole queue was submitted, finish the job once it completes */
+		bdevperf_job_drain(job);
+		if (job->current_queue_depth == 0) {
+			bdevperf_job_empty(job);
+		}
+		return SPDK_POLLER_BUSY;
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 bdevperf_job_run(void *ctx)
 {
@@ -1314,6 +1693,17 @@ bdevperf_job_run(void *ctx)
 
 	spdk_bdev_set_timeout(job->bdev_desc, g_timeout_in_sec, bdevperf_timeout_cb, job);
 
+	if (job->rate_iops != 0) {
+		job->rate_next_tsc = spdk_get_ticks();
+		job->open_loop_poller = SPDK_POLLER_REGISTER(bdevperf_job_rate_poll, job, 0);
+		return;
+	}
+
+	if (job->replay != NULL) {
+		job->open_loop_poller = SPDK_POLLER_REGISTER(bdevperf_job_replay_poll, job, 0);
+		return;
+	}
+
 	for (i = 0; i < job->queue_depth; i++) {
 		task = bdevperf_job_get_task(job);
 		bdevperf_submit_single(job, task);
@@ -1640,6 +2030,8 @@ job_init_rw(struct bdevperf_job *job, enum job_config_rw rw)
 	case JOB_CONFIG_RW_WRITE_ZEROES:
 		job->write_zeroes = true;
 		break;
+	case JOB_CONFIG_RW_REPLAY:
+		break;
 	}
 }
 
@@ -1671,9 +2063,19 @@ bdevperf_construct_job(struct spdk_bdev *bdev, struct job_config *config,
 
 	job->workload_type = g_workload_type;
 	job->io_size = config->bs;
+	job->replay = config->replay_queue;
+	if (job->replay != NULL) {
+		/* Buffers have to fit the largest I/O of the replayed queue */
+		job->io_size = g_replay_unit == 0 ? job->replay->max_length * data_block_size :
+			       SPDK_ALIGN_CEIL((uint64_t)job->replay->max_length * g_replay_unit, data_block_size);
+		job->io_size = spdk_max(job->io_size, data_block_size);
+	}
 	job->rw_percentage = config->rwmixread;
 	job->continue_on_failure = g_continue_on_failure;
 	job->queue_depth = config->iodepth;
+	job->rate_iops = config->rate_iops;
+	job->poisson_arrivals = g_poisson_arrivals;
+	job->rate_ticks_per_io = job->rate_iops != 0 ? (double)spdk_get_ticks_hz() / job->rate_iops : 0;
 	job->bdev = bdev;
 	job->io_size_blocks = job->io_size / data_block_size;
 	job->buf_size = job->io_size_blocks * block_size;
@@ -1942,7 +2344,8 @@ bdevperf_construct_jobs(void)
 }
 
 static int
-make_cli_job_config(const char *filename, int64_t offset, uint64_t range)
+make_cli_job_config(const char *filename, int64_t offset, uint64_t range,
+		    struct replay_queue *replay_queue)
 {
 	struct job_config *config = calloc(1, sizeof(*config));
 
@@ -1959,9 +2362,15 @@ make_cli_job_config(const char *filename, int64_t offset, uint64_t range)
 	config->bs = g_io_size;
 	config->iodepth = g_queue_depth;
 	config->rwmixread = g_rw_percentage;
+	config->rate_iops = g_rate_iops;
+	config->replay_queue = replay_queue;
 	config->offset = offset;
 	config->length = range;
-	config->rw = parse_rw(g_workload_type, BDEVPERF_CONFIG_ERROR);
+	if (replay_queue != NULL) {
+		config->rw = JOB_CONFIG_RW_REPLAY;
+	} else {
+		config->rw = parse_rw(g_workload_type, BDEVPERF_CONFIG_ERROR);
+	}
 	if ((int)config->rw == BDEVPERF_CONFIG_ERROR) {
 		free(config);
 		return -EINVAL;
@@ -1984,7 +2393,7 @@ bdevperf_construct_multithread_job_config(void *ctx, struct spdk_bdev *bdev)
 	offset = 0;
 
 	SPDK_ENV_FOREACH_CORE(i) {
-		rc = make_cli_job_config(spdk_bdev_get_name(bdev), offset, blocks_per_job);
+		rc = make_cli_job_config(spdk_bdev_get_name(bdev), offset, blocks_per_job, NULL);
 		if (rc) {
 			return rc;
 		}
@@ -2029,7 +2438,24 @@ static int
 bdevperf_construct_job_config(void *ctx, struct spdk_bdev *bdev)
 {
 	/* Construct the job */
-	return make_cli_job_config(spdk_bdev_get_name(bdev), 0, 0);
+	return make_cli_job_config(spdk_bdev_get_name(bdev), 0, 0, NULL);
+}
+
+static int
+bdevperf_construct_replay_job_config(void *ctx, struct spdk_bdev *bdev)
+{
+	struct replay_queue *queue;
+	int rc;
+
+	/* Replay every queue of the trace from a separate job, spread across cores */
+	TAILQ_FOREACH(queue, &g_replay_queues, link) {
+		rc = make_cli_job_config(spdk_bdev_get_name(bdev), 0, 0, queue);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return 0;
 }
 
 static void
@@ -2074,6 +2500,9 @@ bdevperf_construct_job_configs(void)
 	 * Both for standard mode and "multithread" mode, if the -E flag is specified,
 	 * it creates one spdk_thread PER CORE. On each core, one spdk_thread is shared by
 	 * multiple jobs.
+	 *
+	 * The -Y flag replays a trace. One job is created per queue of the trace
+	 * and bdev, and the jobs are spread across cores.
 	 */
 
 	if (g_bdevperf_conf) {
@@ -2086,13 +2515,24 @@ bdevperf_construct_job_configs(void)
 		}
 	}
 
-	if (g_multithread_mode) {
+	if (g_replay_file != NULL) {
+		if (g_job_bdev_name != NULL) {
+			bdev = spdk_bdev_get_by_name(g_job_bdev_name);
+			if (bdev) {
+				g_run_rc = bdevperf_construct_replay_job_config(NULL, bdev);
+			} else {
+				fprintf(stderr, "Unable to find bdev '%s'\n", g_job_bdev_name);
+			}
+		} else {
+			g_run_rc = spdk_for_each_bdev_leaf(NULL, bdevperf_construct_replay_job_config);
+		}
+	} else if (g_multithread_mode) {
 		bdevperf_construct_multithread_job_configs();
 	} else if (g_job_bdev_name != NULL) {
 		bdev = spdk_bdev_get_by_name(g_job_bdev_name);
 		if (bdev) {
 			/* Construct the job */
-			g_run_rc = make_cli_job_config(g_job_bdev_name, 0, 0);
+			g_run_rc = make_cli_job_config(g_job_bdev_name, 0, 0, NULL);
 		} else {
 			fprintf(stderr, "Unable to find bdev '%s'\n", g_job_bdev_name);
 		}
@@ -2164,6 +2604,9 @@ config_set_cli_args(struct job_config *config)
 	if (g_rw_percentage > 0) {
 		config->rwmixread = g_rw_percentage;
 	}
+	if (g_rate_iops > 0) {
+		config->rate_iops = g_rate_iops;
+	}
 	if (g_workload_type) {
 		config->rw = parse_rw(g_workload_type, config->rw);
 	}
@@ -2208,6 +2651,8 @@ read_job_config(void)
 	global_default_config.iodepth = BDEVPERF_CONFIG_UNDEFINED;
 	/* bdevperf has no default for -M option but in FIO the default is 50 */
 	global_default_config.rwmixread = 50;
+	/* 0 means closed loop */
+	global_default_config.rate_iops = 0;
 	global_default_config.offset = 0;
 	/* length 0 means 100% */
 	global_default_config.length = 0;
@@ -2291,6 +2736,11 @@ read_job_config(void)
 			goto error;
 		}
 
+		config->rate_iops = parse_uint_option(s, "rate_iops", global_config.rate_iops);
+		if (config->rate_iops == BDEVPERF_CONFIG_ERROR) {
+			goto error;
+		}
+
 		config->offset = parse_uint_option(s, "offset", global_config.offset);
 		if (config->offset == BDEVPERF_CONFIG_ERROR) {
 			goto error;
@@ -2329,6 +2779,320 @@ error:
 	return 1;
 }
 
+static struct replay_queue *
+replay_get_queue(uint32_t id, const char *name)
+{
+	struct replay_queue *queue;
+
+	TAILQ_FOREACH(queue, &g_replay_queues, link) {
+		if (name != NULL ? strcmp(queue->name, name) == 0 : queue->id == id) {
+			return queue;
+		}
+	}
+
+	queue = calloc(1, sizeof(*queue));
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	if (name != NULL) {
+		queue->name = strdup(name);
+		if (queue->name == NULL) {
+			free(queue);
+			return NULL;
+		}
+		id = g_replay_num_queues;
+	}
+
+	queue->id = id;
+	TAILQ_INSERT_TAIL(&g_replay_queues, queue, link);
+	g_replay_num_queues++;
+
+	return queue;
+}
+
+static int
+replay_add_io(uint32_t queue_id, const char *queue_name, uint64_t time_ns,
+	      enum spdk_bdev_io_type io_type, uint64_t offset, uint32_t length)
+{
+	struct replay_queue *queue;
+	struct replay_io *ios;
+	uint64_t max_ios;
+
+	queue = replay_get_queue(queue_id, queue_name);
+	if (queue == NULL) {
+		return -ENOMEM;
+	}
+
+	if (queue->num_ios == queue->max_ios) {
+		max_ios = spdk_max(queue->max_ios * 2, 1024);
+		ios = realloc(queue->ios, max_ios * sizeof(*ios));
+		if (ios == NULL) {
+			return -ENOMEM;
+		}
+		queue->ios = ios;
+		queue->max_ios = max_ios;
+	}
+
+	queue->ios[queue->num_ios].time_ns = time_ns;
+	queue->ios[queue->num_ios].io_type = io_type;
+	queue->ios[queue->num_ios].offset = offset;
+	queue->ios[queue->num_ios].length = length;
+	queue->num_ios++;
+	queue->max_length = spdk_max(queue->max_length, length);
+	g_replay_base_ns = spdk_min(g_replay_base_ns, time_ns);
+
+	return 0;
+}
+
+/*
+ * Default blkparse output, e.g.:
+ *   8,0    3        1     0.000000000   697  Q   W 223490 + 8 [kjournald]
+ * Only the queue (Q) events are replayed, each CPU is a separate queue.
+ */
+static int
+replay_parse_blkparse(const char *line)
+{
+	unsigned int major, minor, cpu, pid;
+	uint64_t seq, sector = 0;
+	uint32_t num_sectors = 0;
+	double time;
+	char action[8], rwbs[16];
+	enum spdk_bdev_io_type io_type;
+	int count;
+
+	count = sscanf(line, "%u,%u %u %" SCNu64 " %lf %u %7s %15s %" SCNu64 " + %" SCNu32,
+		       &major, &minor, &cpu, &seq, &time, &pid, action, rwbs, &sector, &num_sectors);
+	if (count < 8 || strcmp(action, "Q") != 0) {
+		return 0;
+	}
+
+	if (strchr(rwbs, 'D') != NULL) {
+		io_type = SPDK_BDEV_IO_TYPE_UNMAP;
+	} else if (strchr(rwbs, 'F') != NULL && num_sectors == 0) {
+		io_type = SPDK_BDEV_IO_TYPE_FLUSH;
+	} else if (strchr(rwbs, 'W') != NULL) {
+		io_type = SPDK_BDEV_IO_TYPE_WRITE;
+	} else if (strchr(rwbs, 'R') != NULL) {
+		io_type = SPDK_BDEV_IO_TYPE_READ;
+	} else {
+		return 0;
+	}
+
+	if (io_type != SPDK_BDEV_IO_TYPE_FLUSH && (count < 10 || num_sectors == 0)) {
+		return 0;
+	}
+
+	return replay_add_io(cpu, NULL, (uint64_t)(time * SPDK_SEC_TO_NSEC), io_type, sector,
+			     num_sectors);
+}
+
+/*
+ * fio iolog, version 2:
+ *   filename action [offset length]
+ * with "filename wait usec" delays between I/O, or version 3:
+ *   timestamp_ns filename action [offset length]
+ * Each file is a separate queue.
+ */
+static int
+replay_parse_fio_iolog(const char *line, enum replay_format format, uint64_t *time_ns)
+{
+	char filename[256], action[16];
+	uint64_t timestamp = 0, offset = 0;
+	uint32_t length = 0;
+	enum spdk_bdev_io_type io_type;
+	int count;
+
+	if (format == REPLAY_FORMAT_FIO_IOLOG_V3) {
+		count = sscanf(line, "%" SCNu64 " %255s %15s %" SCNu64 " %" SCNu32,
+			       &timestamp, filename, action, &offset, &length) - 1;
+		*time_ns = timestamp;
+	} else {
+		count = sscanf(line, "%255s %15s %" SCNu64 " %" SCNu32, filename, action, &offset, &length);
+	}
+
+	if (count < 2) {
+		return 0;
+	}
+
+	if (strcmp(action, "wait") == 0) {
+		if (format == REPLAY_FORMAT_FIO_IOLOG_V2 && count >= 3) {
+			*time_ns += offset * 1000;
+		}
+		return 0;
+	} else if (strcmp(action, "read") == 0) {
+		io_type = SPDK_BDEV_IO_TYPE_READ;
+	} else if (strcmp(action, "write") == 0) {
+		io_type = SPDK_BDEV_IO_TYPE_WRITE;
+	} else if (strcmp(action, "trim") == 0) {
+		io_type = SPDK_BDEV_IO_TYPE_UNMAP;
+	} else if (strcmp(action, "sync") == 0 || strcmp(action, "datasync") == 0) {
+		return replay_add_io(0, filename, *time_ns, SPDK_BDEV_IO_TYPE_FLUSH, 0, 0);
+	} else {
+		/* add, open and close */
+		return 0;
+	}
+
+	if (count < 4 || length == 0) {
+		return 0;
+	}
+
+	return replay_add_io(0, filename, *time_ns, io_type, offset, length);
+}
+
+/*
+ * Text output of spdk_trace, e.g.:
+ *    2:    1283.738 p01 BDEV_IO_START   size: 0  id: b12  type: 1  ctx: 0x...  offset: 2048  len: 8  name: Malloc0
+ * Offsets and lengths are in blocks, each lcore is a separate queue.
+ */
+static int
+replay_parse_spdk_trace(const char *line)
+{
+	const char *type, *offset, *length;
+	unsigned int lcore;
+	double time_us;
+
+	if (strstr(line, "BDEV_IO_START") == NULL ||
+	    sscanf(line, "%u: %lf", &lcore, &time_us) != 2) {
+		return 0;
+	}
+
+	type = strstr(line, "type:");
+	offset = strstr(line, "offset:");
+	length = strstr(line, "len:");
+	if (type == NULL || offset == NULL || length == NULL) {
+		return 0;
+	}
+
+	switch (strtoul(type + strlen("type:"), NULL, 10)) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		break;
+	default:
+		return 0;
+	}
+
+	return replay_add_io(lcore, NULL, (uint64_t)(time_us * 1000),
+			     strtoul(type + strlen("type:"), NULL, 10),
+			     strtoull(offset + strlen("offset:"), NULL, 10),
+			     strtoul(length + strlen("len:"), NULL, 10));
+}
+
+static enum replay_format
+replay_detect_format(const char *line)
+{
+	unsigned int major, minor;
+
+	if (strncmp(line, "fio version 2 iolog", strlen("fio version 2 iolog")) == 0) {
+		return REPLAY_FORMAT_FIO_IOLOG_V2;
+	} else if (strncmp(line, "fio version 3 iolog", strlen("fio version 3 iolog")) == 0) {
+		return REPLAY_FORMAT_FIO_IOLOG_V3;
+	} else if (strstr(line, "BDEV_IO_START") != NULL) {
+		return REPLAY_FORMAT_SPDK_TRACE;
+	} else if (sscanf(line, "%u,%u", &major, &minor) == 2) {
+		return REPLAY_FORMAT_BLKPARSE;
+	}
+
+	return REPLAY_FORMAT_UNKNOWN;
+}
+
+static void
+free_replay_trace(void)
+{
+	struct replay_queue *queue, *tmp;
+
+	TAILQ_FOREACH_SAFE(queue, &g_replay_queues, link, tmp) {
+		TAILQ_REMOVE(&g_replay_queues, queue, link);
+		free(queue->ios);
+		free(queue->name);
+		free(queue);
+	}
+}
+
+static int
+read_replay_trace(void)
+{
+	enum replay_format format = REPLAY_FORMAT_UNKNOWN;
+	struct replay_queue *queue;
+	uint64_t time_ns = 0, num_ios = 0;
+	char *line = NULL;
+	size_t line_size = 0;
+	FILE *file;
+	int rc = 0;
+
+	if (g_replay_file == NULL) {
+		return 0;
+	}
+
+	file = fopen(g_replay_file, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open trace %s: %s\n", g_replay_file, spdk_strerror(errno));
+		return 1;
+	}
+
+	while (rc == 0 && getline(&line, &line_size, file) > 0) {
+		if (format == REPLAY_FORMAT_UNKNOWN) {
+			format = replay_detect_format(line);
+			if (format == REPLAY_FORMAT_FIO_IOLOG_V2 || format == REPLAY_FORMAT_FIO_IOLOG_V3) {
+				/* Skip the header */
+				continue;
+			}
+		}
+
+		switch (format) {
+		case REPLAY_FORMAT_BLKPARSE:
+			rc = replay_parse_blkparse(line);
+			break;
+		case REPLAY_FORMAT_FIO_IOLOG_V2:
+		case REPLAY_FORMAT_FIO_IOLOG_V3:
+			rc = replay_parse_fio_iolog(line, format, &time_ns);
+			break;
+		case REPLAY_FORMAT_SPDK_TRACE:
+			rc = replay_parse_spdk_trace(line);
+			break;
+		default:
+			break;
+		}
+	}
+
+	free(line);
+	fclose(file);
+
+	if (rc != 0) {
+		fprintf(stderr, "Could not read trace %s: %s\n", g_replay_file, spdk_strerror(-rc));
+		return 1;
+	}
+
+	switch (format) {
+	case REPLAY_FORMAT_BLKPARSE:
+		g_replay_unit = 512;
+		break;
+	case REPLAY_FORMAT_FIO_IOLOG_V2:
+	case REPLAY_FORMAT_FIO_IOLOG_V3:
+		g_replay_unit = 1;
+		break;
+	default:
+		g_replay_unit = 0;
+		break;
+	}
+
+	TAILQ_FOREACH(queue, &g_replay_queues, link) {
+		num_ios += queue->num_ios;
+	}
+
+	if (num_ios == 0) {
+		fprintf(stderr, "No I/O found in trace %s\n", g_replay_file);
+		return 1;
+	}
+
+	printf("Replaying %" PRIu64 " I/O from %" PRIu32 " queues of trace %s\n", num_ios,
+	       g_replay_num_queues, g_replay_file);
+	return 0;
+}
+
 static void
 bdevperf_run(void *arg1)
 {
@@ -2410,7 +3174,18 @@ SPDK_RPC_REGISTER("perform_tests", rpc_perform_tests, SPDK_RPC_RUNTIME)
 static void
 _bdevperf_job_drain(void *ctx)
 {
-	bdevperf_job_drain(ctx);
+	struct bdevperf_job *job = ctx;
+
+	if (job->is_draining) {
+		/* The job already finished or ends with its last completion */
+		return;
+	}
+
+	bdevperf_job_drain(job);
+	/* Open-loop jobs may have no I/O outstanding, so no completion would end them */
+	if (job->current_queue_depth == 0) {
+		bdevperf_job_empty(job);
+	}
 }
 
 static void
@@ -2466,6 +3241,14 @@ bdevperf_parse_arg(int ch, char *arg)
 		g_random_map = true;
 	} else if (ch == 'E') {
 		g_one_thread_per_lcore = true;
+	} else if (ch == 'a') {
+		g_poisson_arrivals = true;
+	} else if (ch == 'J') {
+		g_json_output_file = optarg;
+	} else if (ch == 'Y') {
+		g_replay_file = optarg;
+	} else if (ch == 'U') {
+		g_replay_asap = true;
 	} else {
 		tmp = spdk_strtoll(optarg, 10);
 		if (tmp < 0) {
@@ -2489,6 +3272,9 @@ bdevperf_parse_arg(int ch, char *arg)
 		case 'k':
 			g_timeout_in_sec = tmp;
 			break;
+		case 'I':
+			g_rate_iops = tmp;
+			break;
 		case 'M':
 			g_rw_percentage = tmp;
 			g_mix_specified = true;
@@ -2532,6 +3318,13 @@ bdevperf_usage(void)
 	printf(" -l                        display latency histogram, default: disable. -l display summary, -ll display details\n");
 	printf(" -D                        use a random map for picking offsets not previously read or written (for all jobs)\n");
 	printf(" -E                        share per lcore thread among jobs. Available only if -j is not used.\n");
+	printf(" -I <iops>                 open loop: issue I/O at the given rate per job instead of keeping the io depth\n");
+	printf("\t\t(io depth then limits the outstanding I/O, latency is measured from the intended issue time)\n");
+	printf(" -a                        use Poisson arrivals instead of a fixed interval with -I\n");
+	printf(" -J <filename>             write per job results with latency percentiles in JSON to <filename> (\"-\" for stdout)\n");
+	printf(" -Y <filename>             replay a trace instead of the io pattern: blkparse output, fio iolog or spdk_trace output\n");
+	printf("\t\t(each queue of the trace is replayed from a separate job, io depth limits its outstanding I/O)\n");
+	printf(" -U                        replay the trace as fast as possible instead of with its recorded timing\n");
 }
 
 static int
@@ -2547,10 +3340,10 @@ verify_test_params(struct spdk_app_opts *opts)
 	if (!g_bdevperf_conf_file && g_queue_depth <= 0) {
 		goto out;
 	}
-	if (!g_bdevperf_conf_file && g_io_size <= 0) {
+	if (!g_bdevperf_conf_file && !g_replay_file && g_io_size <= 0) {
 		goto out;
 	}
-	if (!g_bdevperf_conf_file && !g_workload_type) {
+	if (!g_bdevperf_conf_file && !g_replay_file && !g_workload_type) {
 		goto out;
 	}
 	if (g_bdevperf_conf_file && g_one_thread_per_lcore) {
@@ -2570,6 +3363,11 @@ verify_test_params(struct spdk_app_opts *opts)
 		printf("Timeout must be set for abort option, Ignoring g_abort\n");
 	}
 
+	if (g_poisson_arrivals && g_rate_iops == 0 && !g_bdevperf_conf_file) {
+		fprintf(stderr, "-a option must be specified with -I option\n");
+		return 1;
+	}
+
 	if (g_show_performance_ema_period > 0 &&
 	    g_show_performance_real_time == 0) {
 		fprintf(stderr, "-P option must be specified with -S option\n");
@@ -2583,6 +3381,20 @@ verify_test_params(struct spdk_app_opts *opts)
 		g_zcopy = false;
 	}
 
+	if (g_replay_file) {
+		if (g_bdevperf_conf_file || g_multithread_mode || g_rate_iops || g_zcopy) {
+			fprintf(stderr, "-Y option cannot be used with -j, -C, -I or -Z options\n");
+			return 1;
+		}
+		if (g_workload_type || g_io_size) {
+			fprintf(stderr, "Ignoring -w and -o options... The trace defines the I/O to replay.\n");
+		}
+		return 0;
+	} else if (g_replay_asap) {
+		fprintf(stderr, "-U option must be specified with -Y option\n");
+		return 1;
+	}
+
 	if (g_bdevperf_conf_file) {
 		/* workload_type verification happens during config file parsing */
 		return 0;
@@ -2658,7 +3470,7 @@ main(int argc, char **argv)
 	opts.rpc_addr = NULL;
 	opts.shutdown_cb = spdk_bdevperf_shutdown_cb;
 
-	if ((rc = spdk_app_parse_args(argc, argv, &opts, "Zzfq:o:t:w:k:CEF:M:P:S:T:Xlj:D", NULL,
+	if ((rc = spdk_app_parse_args(argc, argv, &opts, "Zzfq:o:t:w:k:CEF:I:J:M:P:S:T:UXY:lj:Da", NULL,
 				      bdevperf_parse_arg, bdevperf_usage)) !=
 	    SPDK_APP_PARSE_ARGS_SUCCESS) {
 		return rc;
@@ -2674,9 +3486,15 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (read_replay_trace()) {
+		free_replay_trace();
+		return 1;
+	}
+
 	rc = spdk_app_start(&opts, bdevperf_run, NULL);
 
 	spdk_app_fini();
 	free_job_config();
+	free_replay_trace();
 	return rc;
 }
@@ -174,6 +174,10 @@ struct spdk_bdev_io_stat {
 	uint64_t copy_latency_ticks;
 	uint64_t max_copy_latency_ticks;
 	uint64_t min_copy_latency_ticks;
+	/* Number of writes that were merged into coalesced writes */
+	uint64_t num_coalesced_write_ops;
+	/* Number of coalesced writes submitted to the bdev module */
+	uint64_t num_coalesced_write_batches;
 	uint64_t ticks_rate;
 
 	/* This data structure is privately defined in the bdev library.
@@ -200,8 +204,14 @@ struct spdk_bdev_opts {
 	 */
 	size_t opts_size;
 
-	/* Hole at bytes 24-31. */
-	uint8_t reserved[8];
+	/**
+	 * If set, each channel draws quota from the bdev's QoS budget and submits rate limited
+	 * I/O on its own thread, instead of sending all I/O through a single QoS thread.
+	 */
+	bool qos_distributed;
+
+	/* Hole at bytes 25-31. */
+	uint8_t reserved25[7];
 } __attribute__((packed));
 SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_opts) == 32, "Incorrect size");
 
@@ -546,6 +556,19 @@ const char *spdk_bdev_get_qos_rpc_type(enum spdk_bdev_qos_rate_limit_type type);
  */
 void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 
+/**
+ * Get the rates achieved under the quality of service rate limits on a bdev.
+ *
+ * The rates are measured over the last second, in I/O per second for the IOPS limits and
+ * in bytes per second for the bandwidth limits.  The rate of a limit that is not set is 0.
+ *
+ * \param bdev Block device to query.
+ * \param rates Pointer to the array holding the achieved rates.
+ *
+ * The rates are ordered based on the @ref spdk_bdev_qos_rate_limit_type enum.
+ */
+void spdk_bdev_get_qos_achieved_rates(struct spdk_bdev *bdev, uint64_t *rates);
+
 /**
  * Set the quality of service rate limits on a bdev.
  *
@@ -559,6 +582,25 @@ void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 void spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				   void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
 
+/**
+ * Set the write coalescing parameters of a bdev.
+ *
+ * With write coalescing enabled, writes to adjacent blocks submitted on the same channel
+ * are held back for up to window_us microseconds, or until max_size bytes have been
+ * gathered, and are then submitted to the bdev module as a single vectored write.  The
+ * completion of that write is reported to each of the original writes.
+ *
+ * Writes with metadata, memory domains or accel sequences are never coalesced.
+ *
+ * \param bdev Block device.
+ * \param window_us Maximum time in microseconds a write is held back. 0 disables coalescing.
+ * \param max_size Maximum size in bytes of a coalesced write.
+ * \param cb_fn Callback function to be called when the parameters have been updated.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_set_write_coalescing(struct spdk_bdev *bdev, uint64_t window_us, uint32_t max_size,
+				    void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
 /**
  * Get minimum I/O buffer address alignment for a bdev.
  *
@@ -1921,9 +1963,23 @@ void *spdk_bdev_io_get_md_buf(struct spdk_bdev_io *bdev_io);
  */
 void *spdk_bdev_io_get_cb_arg(struct spdk_bdev_io *bdev_io);
 
+/**
+ * Size classes of the per I/O type histograms, named after the largest I/O they hold.
+ */
+enum spdk_bdev_histogram_size_class {
+	SPDK_BDEV_HISTOGRAM_SIZE_4K = 0,
+	SPDK_BDEV_HISTOGRAM_SIZE_16K,
+	SPDK_BDEV_HISTOGRAM_SIZE_64K,
+	SPDK_BDEV_HISTOGRAM_SIZE_256K,
+	SPDK_BDEV_HISTOGRAM_SIZE_LARGE,
+	SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES /* Keep last */
+};
+
 typedef void (*spdk_bdev_histogram_status_cb)(void *cb_arg, int status);
 typedef void (*spdk_bdev_histogram_data_cb)(void *cb_arg, int status,
 		struct spdk_histogram_data *histogram);
+typedef void (*spdk_bdev_histogram_classes_cb)(void *cb_arg, int status,
+		struct spdk_histogram_data *histograms[][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES]);
 
 /**
  * Get the result of a previous seek function.
@@ -1972,6 +2028,31 @@ void spdk_bdev_histogram_get(struct spdk_bdev *bdev, struct spdk_histogram_data
 void spdk_bdev_channel_get_histogram(struct spdk_io_channel *ch, spdk_bdev_histogram_data_cb cb_fn,
 				     void *cb_arg);
 
+/**
+ * Get the histograms of a bdev split by I/O type and size class, merged from all channels.
+ *
+ * The histograms are indexed by @ref spdk_bdev_io_type and @ref spdk_bdev_histogram_size_class.
+ * An entry is NULL if no I/O of that type and size class completed since histograms were
+ * enabled.  The histograms passed to cb_fn are only valid during the execution of cb_fn.
+ *
+ * \param bdev Block device.
+ * \param reset Reset the histograms of each channel after they are merged, so that the next
+ * call reports the I/O completed in between.  This affects all users of this function.
+ * \param cb_fn Callback function to be called with the merged histograms.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_histogram_get_classes(struct spdk_bdev *bdev, bool reset,
+				     spdk_bdev_histogram_classes_cb cb_fn, void *cb_arg);
+
+/**
+ * Get the largest I/O size in bytes of a histogram size class.
+ *
+ * \param size_class Size class.
+ * \return Size in bytes, UINT64_MAX for the last size class.
+ */
+uint64_t spdk_bdev_histogram_size_class_get_max_size(enum spdk_bdev_histogram_size_class
+		size_class);
+
 /**
  * Retrieves media events.  Can only be called from the context of
  * SPDK_BDEV_EVENT_MEDIA_MANAGEMENT event callback.  These events are sent by
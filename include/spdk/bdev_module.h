@@ -624,6 +624,18 @@ struct spdk_bdev {
 		/** True if the state of the QoS is being modified */
 		bool qos_mod_in_progress;
 
+		/** Write coalescing parameters, see spdk_bdev_set_write_coalescing() */
+		struct {
+			/** Maximum time in microseconds a write is held back, 0 if disabled */
+			uint64_t window_us;
+
+			/** Maximum size in bytes of a coalesced write */
+			uint32_t max_size;
+
+			/** True if the coalescing parameters are being modified */
+			bool mod_in_progress;
+		} coalesce;
+
 		/**
 		 * SPDK spinlock protecting many of the internal fields of this structure. If
 		 * multiple locks need to be held, the following order must be used:
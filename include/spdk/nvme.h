@@ -2691,6 +2691,38 @@ int spdk_nvme_poll_group_destroy(struct spdk_nvme_poll_group *group);
 int64_t spdk_nvme_poll_group_process_completions(struct spdk_nvme_poll_group *group,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb);
 
+struct spdk_fd_group;
+
+/**
+ * Get an fd group that becomes readable whenever this poll group has work to do.
+ *
+ * The fd group is created on the first call and gathers the event file descriptors of
+ * every transport used by the poll group, including transports added later. Transports
+ * that cannot signal completions through a file descriptor keep the fd group readable,
+ * so that they continue to be polled. Once it is readable, the caller should call
+ * spdk_nvme_poll_group_wait() instead of spdk_nvme_poll_group_process_completions().
+ *
+ * \param group The poll group.
+ *
+ * \return the fd group or NULL if it could not be created.
+ */
+struct spdk_fd_group *spdk_nvme_poll_group_get_fd_group(struct spdk_nvme_poll_group *group);
+
+/**
+ * Process completions on all qpairs in this poll group after its fd group, retrieved by
+ * spdk_nvme_poll_group_get_fd_group(), became readable.
+ *
+ * This behaves like spdk_nvme_poll_group_process_completions() with no limit on the number
+ * of completions per qpair, but it also re-arms the fd group if more work may be pending.
+ *
+ * \param group The group on which to poll for completions.
+ * \param disconnected_qpair_cb A callback function of type spdk_nvme_disconnected_qpair_cb. Must be non-NULL.
+ *
+ * \return the number of completions across all qpairs or negated errno on failure.
+ */
+int64_t spdk_nvme_poll_group_wait(struct spdk_nvme_poll_group *group,
+				  spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb);
+
 /**
  * Check if all qpairs in the poll group are connected.
  *
@@ -4166,6 +4198,12 @@ struct spdk_nvme_transport_ops {
 	int (*ctrlr_ready)(struct spdk_nvme_ctrlr *ctrlr);
 
 	volatile struct spdk_nvme_registers *(*ctrlr_get_registers)(struct spdk_nvme_ctrlr *ctrlr);
+
+	int (*poll_group_register_interrupts)(struct spdk_nvme_transport_poll_group *tgroup,
+					      struct spdk_fd_group *fgrp);
+
+	void (*poll_group_unregister_interrupts)(struct spdk_nvme_transport_poll_group *tgroup,
+			struct spdk_fd_group *fgrp);
 };
 
 /**
@@ -310,6 +310,35 @@ typedef void (*nvmf_qpair_disconnect_cb)(void *ctx);
 int spdk_nvmf_qpair_disconnect(struct spdk_nvmf_qpair *qpair, nvmf_qpair_disconnect_cb cb_fn,
 			       void *ctx);
 
+typedef void (*spdk_nvmf_qpair_migrate_done_fn)(void *cb_arg, int status);
+
+/**
+ * Move an I/O qpair to another poll group.
+ *
+ * The qpair stops accepting new commands and is moved once all of its outstanding
+ * requests have completed, so no request state has to be carried over. If the qpair
+ * doesn't drain within a second, the migration is cancelled and the qpair keeps
+ * running on its current poll group. The same happens, with status -ENODEV, if the
+ * destination poll group is destroyed before the qpair gets there.
+ *
+ * This function must be called from the thread of the poll group the qpair currently
+ * belongs to. cb_fn is called on the same thread.
+ *
+ * \param qpair The I/O qpair to move.
+ * \param group The poll group to move the qpair to.
+ * \param cb_fn Function to call once the qpair has been moved or the migration failed.
+ * \param cb_arg Argument passed to cb_fn.
+ *
+ * \return 0 if the migration was started, cb_fn will be called with its result.
+ * \return -EINVAL if the qpair is an admin qpair or isn't connected to a controller.
+ * \return -EALREADY if the qpair already belongs to the poll group.
+ * \return -ENOTSUP if the transport doesn't support qpair migration.
+ * \return -EBUSY if the qpair is already being migrated or disconnected.
+ * \return -ENOMEM if the migration context could not be allocated.
+ */
+int spdk_nvmf_qpair_migrate(struct spdk_nvmf_qpair *qpair, struct spdk_nvmf_poll_group *group,
+			    spdk_nvmf_qpair_migrate_done_fn cb_fn, void *cb_arg);
+
 /**
  * Get the peer's transport ID for this queue pair.
  *
@@ -132,6 +132,9 @@ struct spdk_nvmf_qpair {
 
 	TAILQ_HEAD(, spdk_nvmf_request)		outstanding;
 	TAILQ_ENTRY(spdk_nvmf_qpair)		link;
+
+	/* Set while the qpair is being moved to another poll group */
+	struct nvmf_qpair_migrate_ctx		*migrate_ctx;
 };
 
 struct spdk_nvmf_transport_poll_group {
@@ -165,6 +168,22 @@ struct spdk_nvmf_poll_group {
 	/* Statistics */
 	struct spdk_nvmf_poll_group_stat		stat;
 
+	/* Load estimate used to place new qpairs. Updated periodically on the
+	 * group's thread by load_poller and read by the thread accepting qpairs.
+	 * In interrupt mode there is no load_poller, the thread accepting qpairs
+	 * samples the IOPS instead, with the target's mutex held. */
+	struct spdk_poller				*load_poller;
+	uint64_t					load_tsc;
+	uint64_t					load_busy_tsc;
+	uint64_t					load_idle_tsc;
+	uint64_t					load_completed_nvme_io;
+	/* Smoothed I/O operations per second */
+	uint64_t					load_iops;
+	/* Smoothed share of time the thread was busy, in units of 0.1% */
+	uint32_t					load_busy;
+	/* Qpairs placed on this group since load was last sampled */
+	uint32_t					load_new_qpairs;
+
 	spdk_nvmf_poll_group_destroy_done_fn		destroy_cb_fn;
 	void						*destroy_cb_arg;
 
@@ -320,7 +339,9 @@ struct spdk_nvmf_transport_ops {
 			struct spdk_nvmf_poll_group *group);
 
 	/**
-	 * Get the polling group of the queue pair optimal for the specific transport
+	 * Get the polling group the queue pair has an affinity to, e.g. the group already
+	 * polling the queue pair's placement id. Returns NULL if there's no such group, in
+	 * which case the target places the queue pair on its least loaded poll group.
 	 */
 	struct spdk_nvmf_transport_poll_group *(*get_optimal_poll_group)(struct spdk_nvmf_qpair *qpair);
 
@@ -346,6 +367,28 @@ struct spdk_nvmf_transport_ops {
 	 */
 	int (*poll_group_poll)(struct spdk_nvmf_transport_poll_group *group);
 
+	/*
+	 * Stop (quiesce == true) or restart (quiesce == false) reading new commands from
+	 * a qpair that is being moved to another poll group.
+	 * This callback is optional. Qpairs of transports that don't implement it, together
+	 * with qpair_is_idle and poll_group_migrate, can't be migrated.
+	 */
+	void (*qpair_quiesce)(struct spdk_nvmf_qpair *qpair, bool quiesce);
+
+	/*
+	 * Check whether a quiesced qpair has no commands or data transfers in progress,
+	 * i.e. whether it can be detached from its poll group with poll_group_remove.
+	 */
+	bool (*qpair_is_idle)(struct spdk_nvmf_qpair *qpair);
+
+	/*
+	 * Attach an idle qpair that was detached from another poll group. Unlike
+	 * poll_group_add, the qpair keeps its connection state. If this fails, the qpair
+	 * is still considered part of the group and will be disconnected.
+	 */
+	int (*poll_group_migrate)(struct spdk_nvmf_transport_poll_group *group,
+				  struct spdk_nvmf_qpair *qpair);
+
 	/*
 	 * Free the request without sending a response
 	 * to the originator. Release memory tied to this request.
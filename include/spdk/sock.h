@@ -15,6 +15,7 @@
 #include "spdk/queue.h"
 #include "spdk/json.h"
 #include "spdk/assert.h"
+#include "spdk/fd_group.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -490,6 +491,18 @@ bool spdk_sock_is_ipv4(struct spdk_sock *sock);
  */
 bool spdk_sock_is_connected(struct spdk_sock *sock);
 
+/**
+ * Get a file descriptor that becomes readable when the socket has an event to process,
+ * e.g. a pending connection on a listening socket.
+ *
+ * The descriptor is owned by the socket and must not be closed or read from.
+ *
+ * \param sock Socket.
+ *
+ * \return the file descriptor or -1 if the socket implementation doesn't provide one.
+ */
+int spdk_sock_get_interrupt_fd(struct spdk_sock *sock);
+
 /**
  * Callback function for spdk_sock_group_add_sock().
  *
@@ -580,6 +593,35 @@ int spdk_sock_group_poll_count(struct spdk_sock_group *group, int max_events);
  */
 int spdk_sock_group_close(struct spdk_sock_group **group);
 
+/**
+ * Register the file descriptors signalling activity on the sockets of this group
+ * with an fd group, so that the caller can wait for events instead of busy polling.
+ *
+ * Once registered, the group flushes writes as soon as they are queued and watches
+ * for write readiness on its own, since there is no longer a poller running in the
+ * background to flush them. spdk_sock_group_poll() must still be called whenever
+ * any of the registered descriptors becomes readable.
+ *
+ * \param group Group to register.
+ * \param fgrp The fd group to add the descriptors to.
+ * \param fn Function called when a descriptor becomes readable.
+ * \param arg Argument passed to fn.
+ *
+ * \return 0 on success, -ENOTSUP if any of the socket implementations used by the
+ * group does not support interrupts, or another negated errno on failure.
+ */
+int spdk_sock_group_register_interrupts(struct spdk_sock_group *group, struct spdk_fd_group *fgrp,
+					spdk_fd_fn fn, void *arg);
+
+/**
+ * Remove the descriptors added by spdk_sock_group_register_interrupts() from an fd group.
+ *
+ * \param group Group to unregister.
+ * \param fgrp The fd group the descriptors were added to.
+ */
+void spdk_sock_group_unregister_interrupts(struct spdk_sock_group *group,
+		struct spdk_fd_group *fgrp);
+
 /**
  * Get the optimal sock group for this sock.
  *
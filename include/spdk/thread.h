@@ -985,6 +985,13 @@ struct spdk_iobuf_opts {
 	uint32_t small_bufsize;
 	/** Size of a single large buffer */
 	uint32_t large_bufsize;
+	/**
+	 * Create separate pools on each NUMA node, each holding small_pool_count and
+	 * large_pool_count buffers.  Channels use the pools of their thread's NUMA node.
+	 */
+	bool enable_numa;
+	/** Allow taking buffers from other NUMA nodes when the local pool is exhausted */
+	bool numa_fallback;
 };
 
 struct spdk_iobuf_entry;
@@ -1006,6 +1013,19 @@ struct spdk_iobuf_buffer {
 typedef STAILQ_HEAD(, spdk_iobuf_entry) spdk_iobuf_entry_stailq_t;
 typedef STAILQ_HEAD(, spdk_iobuf_buffer) spdk_iobuf_buffer_stailq_t;
 
+struct spdk_iobuf_pool_stats {
+	/** Number of buffers taken from the channel's cache */
+	uint64_t	cache;
+	/** Number of batches taken from the buffers released by other modules on the same thread */
+	uint64_t	depot;
+	/** Number of batches taken from the global pool */
+	uint64_t	main;
+	/** Number of requests that had to wait for a buffer */
+	uint64_t	retry;
+	/** Number of buffers taken from the pool of another NUMA node */
+	uint64_t	remote;
+};
+
 struct spdk_iobuf_pool {
 	/** Buffer pool */
 	struct spdk_ring		*pool;
@@ -1019,6 +1039,8 @@ struct spdk_iobuf_pool {
 	spdk_iobuf_entry_stailq_t	*queue;
 	/** Buffer size */
 	uint32_t			bufsize;
+	/** Buffer statistics */
+	struct spdk_iobuf_pool_stats	stats;
 };
 
 /** iobuf channel */
@@ -1031,6 +1053,17 @@ struct spdk_iobuf_channel {
 	const void			*module;
 	/** Parent IO channel */
 	struct spdk_io_channel		*parent;
+	/** Link on the list of channels of the parent IO channel */
+	TAILQ_ENTRY(spdk_iobuf_channel)	tailq;
+};
+
+struct spdk_iobuf_module_stats {
+	/** Name of the module */
+	const char			*module;
+	/** Small buffer statistics */
+	struct spdk_iobuf_pool_stats	small_pool;
+	/** Large buffer statistics */
+	struct spdk_iobuf_pool_stats	large_pool;
 };
 
 /**
@@ -1159,6 +1192,20 @@ void *spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len, struct spdk_io
  */
 void spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len);
 
+typedef void (*spdk_iobuf_get_stats_cb)(struct spdk_iobuf_module_stats *modules,
+					uint32_t num_modules, void *cb_arg);
+
+/**
+ * Get iobuf statistics of each registered module, summed up over its channels on all threads.
+ *
+ * \param cb_fn Callback executed once the statistics are gathered.  The statistics are only valid
+ *              for the duration of the callback.
+ * \param cb_arg Argument passed to `cb_fn`.
+ *
+ * \return 0 on success, negative errno otherwise.
+ */
+int spdk_iobuf_get_stats(spdk_iobuf_get_stats_cb cb_fn, void *cb_arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -98,6 +98,7 @@ struct spdk_net_impl {
 	bool (*is_ipv6)(struct spdk_sock *sock);
 	bool (*is_ipv4)(struct spdk_sock *sock);
 	bool (*is_connected)(struct spdk_sock *sock);
+	int (*get_interrupt_fd)(struct spdk_sock *sock);
 
 	struct spdk_sock_group_impl *(*group_impl_get_optimal)(struct spdk_sock *sock,
 			struct spdk_sock_group_impl *hint);
@@ -107,6 +108,10 @@ struct spdk_net_impl {
 	int (*group_impl_poll)(struct spdk_sock_group_impl *group, int max_events,
 			       struct spdk_sock **socks);
 	int (*group_impl_close)(struct spdk_sock_group_impl *group);
+	int (*group_impl_register_interrupt)(struct spdk_sock_group_impl *group,
+					     struct spdk_fd_group *fgrp, spdk_fd_fn fn, void *arg);
+	void (*group_impl_unregister_interrupt)(struct spdk_sock_group_impl *group,
+						struct spdk_fd_group *fgrp);
 
 	int (*get_opts)(struct spdk_sock_impl_opts *opts, size_t *len);
 	int (*set_opts)(const struct spdk_sock_impl_opts *opts, size_t len);
@@ -121,11 +121,27 @@ static struct spdk_bdev_mgr g_bdev_mgr = {
 	.module_init_complete = false,
 };
 
+/* QoS groups, see struct bdev_qos_group */
+static struct {
+	/*
+	 * Protects the group tree and hands out the shares, once per timeslice.  I/O of the member
+	 * bdevs is admitted against the shares with atomics only.
+	 */
+	struct spdk_spinlock spinlock;
+	TAILQ_HEAD(, bdev_qos_group) groups;
+	uint64_t timeslice_size;
+	uint64_t last_timeslice;
+	uint64_t rate_tsc;
+} g_bdev_qos_groups = {
+	.groups = TAILQ_HEAD_INITIALIZER(g_bdev_qos_groups.groups),
+};
+
 static void
 __attribute__((constructor))
 _bdev_init(void)
 {
 	spdk_spin_init(&g_bdev_mgr.spinlock);
+	spdk_spin_init(&g_bdev_qos_groups.spinlock);
 }
 
 typedef void (*lock_range_cb)(struct lba_range *range, void *ctx, int status);
@@ -147,6 +163,7 @@ static struct spdk_bdev_opts	g_bdev_opts = {
 	.bdev_io_pool_size = SPDK_BDEV_IO_POOL_SIZE,
 	.bdev_io_cache_size = SPDK_BDEV_IO_CACHE_SIZE,
 	.bdev_auto_examine = SPDK_BDEV_AUTO_EXAMINE,
+	.qos_distributed = false,
 };
 
 static spdk_bdev_init_cb	g_init_cb_fn = NULL;
@@ -173,6 +190,18 @@ struct spdk_bdev_qos_limit {
 	/** Maximum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
 	uint32_t max_per_timeslice;
 
+	/** IOs or bytes a channel draws from remaining_this_timeslice at once in distributed mode. */
+	uint32_t grant_per_channel;
+
+	/** IOs or bytes admitted so far, used to measure the achieved rate. */
+	uint64_t consumed;
+
+	/** Value of consumed at the start of the current rate measurement. */
+	uint64_t last_consumed;
+
+	/** IOs or bytes per second admitted during the last rate measurement. */
+	uint64_t achieved_rate;
+
 	/** Function to check whether to queue the IO. */
 	bool (*queue_io)(const struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
 
@@ -201,6 +230,76 @@ struct spdk_bdev_qos {
 
 	/** Poller that processes queued I/O commands each time slice. */
 	struct spdk_poller *poller;
+
+	/**
+	 * Channels draw quota from rate_limits and submit I/O on their own thread, instead of
+	 * funneling all I/O through the QoS thread.  The poller only refills the budget then.
+	 */
+	bool distributed;
+
+	/** Incremented each timeslice, quota drawn by channels in earlier timeslices expires. */
+	uint64_t epoch;
+
+	/** Number of channels that drew quota in the current timeslice. */
+	uint32_t active_channels;
+
+	/** Start of the current achieved rate measurement. */
+	uint64_t rate_tsc;
+
+	/** QoS group the bdev belongs to, its I/O is admitted against the group's budget too. */
+	struct bdev_qos_group *group;
+};
+
+/*
+ * QoS groups share one budget between several bdevs.  Groups form a tree, the budget of each
+ * timeslice flows from the root groups down to the leaf groups, which the bdevs join.  Each child
+ * group is guaranteed its reservation, and the rest of its parent's budget is split between the
+ * children that were active in the last timeslice, in proportion to their weight.
+ */
+struct bdev_qos_group_limit {
+	/** IOs or bytes allowed per second, 0 if not limited. */
+	uint64_t limit;
+
+	/** IOs or bytes per second guaranteed out of the parent's budget. */
+	uint64_t reservation;
+
+	/** IOs or bytes the group was given for the current timeslice, INT64_MAX if not limited. */
+	int64_t share;
+
+	/** Remaining IOs or bytes of the share, allowed to run negative like in spdk_bdev_qos_limit. */
+	int64_t remaining;
+
+	/** IOs or bytes admitted so far. */
+	uint64_t consumed;
+
+	/** Value of consumed at the start of the current rate measurement. */
+	uint64_t last_consumed;
+
+	/** IOs or bytes per second admitted during the last rate measurement. */
+	uint64_t achieved_rate;
+};
+
+struct bdev_qos_group {
+	char *name;
+
+	struct bdev_qos_group_limit rate_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** Weight used to split the parent's budget left over after the reservations. */
+	uint32_t weight;
+
+	/** Number of bdevs in the group. */
+	uint32_t num_bdevs;
+
+	/** Whether I/O was admitted or held back in the current timeslice. */
+	bool active;
+
+	/** Number of times I/O was held back because the group's share was used up. */
+	uint64_t throttled;
+
+	struct bdev_qos_group *parent;
+	TAILQ_HEAD(, bdev_qos_group) children;
+	TAILQ_ENTRY(bdev_qos_group) child_link;
+	TAILQ_ENTRY(bdev_qos_group) link;
 };
 
 struct spdk_bdev_mgmt_channel {
@@ -259,6 +358,23 @@ struct spdk_bdev_shared_resource {
 #define BDEV_CH_RESET_IN_PROGRESS	(1 << 0)
 #define BDEV_CH_QOS_ENABLED		(1 << 1)
 
+#define BDEV_COALESCE_MAX_IOVS		32
+
+/*
+ * Adjacent writes held back on a channel to be submitted as a single write.
+ * The original I/O are linked using the spdk_bdev_io link TAILQ_ENTRY.
+ */
+struct bdev_coalesce_batch {
+	bdev_io_tailq_t				ios;
+	uint32_t				num_ios;
+	struct spdk_bdev_desc			*desc;
+	uint64_t				offset_blocks;
+	uint64_t				num_blocks;
+	int					iovcnt;
+	struct iovec				iovs[BDEV_COALESCE_MAX_IOVS];
+	STAILQ_ENTRY(bdev_coalesce_batch)	link;
+};
+
 struct spdk_bdev_channel {
 	struct spdk_bdev	*bdev;
 
@@ -300,6 +416,12 @@ struct spdk_bdev_channel {
 
 	struct spdk_histogram_data *histogram;
 
+	/*
+	 * Histograms indexed by I/O type and size class, each one allocated on the first
+	 * completion it records.  Only allocated while histogram is.
+	 */
+	struct spdk_histogram_data **io_histograms;
+
 #ifdef SPDK_CONFIG_VTUNE
 	uint64_t		start_tsc;
 	uint64_t		interval_tsc;
@@ -310,6 +432,37 @@ struct spdk_bdev_channel {
 	bdev_io_tailq_t		queued_resets;
 
 	lba_range_tailq_t	locked_ranges;
+
+	/* Quota drawn from the bdev's QoS budget when QoS is distributed */
+	struct {
+		/* Allowed to run negative, like remaining_this_timeslice */
+		int64_t		quota;
+		/* IOs or bytes admitted, but not yet added to the bdev's consumed counter */
+		uint64_t	consumed;
+	} qos_local[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/* QoS timeslice the local quota was drawn in */
+	uint64_t		qos_epoch;
+
+	/* Whether this channel was counted in active_channels of the current timeslice */
+	bool			qos_active;
+
+	/* I/O waiting for quota when QoS is distributed */
+	bdev_io_tailq_t		qos_queued;
+
+	/* Resubmits qos_queued, only registered while it is not empty */
+	struct spdk_poller	*qos_poller;
+
+	/* Maximum size of a coalesced write in blocks, 0 if write coalescing is disabled */
+	uint64_t		coalesce_max_blocks;
+
+	/* Batch of writes currently being coalesced */
+	struct bdev_coalesce_batch *coalesce_batch;
+
+	/* Submits coalesce_batch once the coalescing window expires */
+	struct spdk_poller	*coalesce_poller;
+
+	STAILQ_HEAD(, bdev_coalesce_batch) coalesce_free_batches;
 };
 
 struct media_event_entry {
@@ -354,6 +507,15 @@ struct set_qos_limit_ctx {
 	void (*cb_fn)(void *cb_arg, int status);
 	void *cb_arg;
 	struct spdk_bdev *bdev;
+	/* QoS group the bdev is being removed from */
+	struct bdev_qos_group *group;
+};
+
+struct set_write_coalescing_ctx {
+	void (*cb_fn)(void *cb_arg, int status);
+	void *cb_arg;
+	uint64_t window_us;
+	uint32_t max_size;
 };
 
 struct spdk_bdev_channel_iter {
@@ -392,6 +554,7 @@ static int bdev_write_zero_buffer(struct spdk_bdev_io *bdev_io);
 static void bdev_enable_qos_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 				struct spdk_io_channel *ch, void *_ctx);
 static void bdev_enable_qos_done(struct spdk_bdev *bdev, void *_ctx, int status);
+static void bdev_qos_groups_config_json(struct spdk_json_write_ctx *w);
 
 static int bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 				     struct iovec *iov, int iovcnt, void *md_buf, uint64_t offset_blocks,
@@ -450,6 +613,7 @@ spdk_bdev_get_opts(struct spdk_bdev_opts *opts, size_t opts_size)
 	SET_FIELD(bdev_io_pool_size);
 	SET_FIELD(bdev_io_cache_size);
 	SET_FIELD(bdev_auto_examine);
+	SET_FIELD(qos_distributed);
 
 	/* Do not remove this statement, you should always update this statement when you adding a new field,
 	 * and do not forget to add the SET_FIELD statement for your added field. */
@@ -495,6 +659,7 @@ spdk_bdev_set_opts(struct spdk_bdev_opts *opts)
 	SET_FIELD(bdev_io_pool_size);
 	SET_FIELD(bdev_io_cache_size);
 	SET_FIELD(bdev_auto_examine);
+	SET_FIELD(qos_distributed);
 
 	g_bdev_opts.opts_size = opts->opts_size;
 
@@ -1808,8 +1973,30 @@ bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 		return;
 	}
 
+	if (qos->group != NULL) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_qos_group_add_bdev");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		spdk_json_write_named_string(w, "group", qos->group->name);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+
 	spdk_bdev_get_qos_rate_limits(bdev, limits);
 
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (limits[i] > 0) {
+			break;
+		}
+	}
+	if (i == SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		/* Only limited by its group */
+		return;
+	}
+
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
 
@@ -1825,6 +2012,25 @@ bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 	spdk_json_write_object_end(w);
 }
 
+static void
+bdev_write_coalescing_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	if (bdev->internal.coalesce.window_us == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_set_write_coalescing");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", bdev->name);
+	spdk_json_write_named_uint64(w, "window_us", bdev->internal.coalesce.window_us);
+	spdk_json_write_named_uint32(w, "max_size_kb", bdev->internal.coalesce.max_size / 1024);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 void
 spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 {
@@ -1841,11 +2047,14 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "bdev_io_pool_size", g_bdev_opts.bdev_io_pool_size);
 	spdk_json_write_named_uint32(w, "bdev_io_cache_size", g_bdev_opts.bdev_io_cache_size);
 	spdk_json_write_named_bool(w, "bdev_auto_examine", g_bdev_opts.bdev_auto_examine);
+	spdk_json_write_named_bool(w, "qos_distributed", g_bdev_opts.qos_distributed);
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 
 	bdev_examine_allowlist_config_json(w);
 
+	bdev_qos_groups_config_json(w);
+
 	TAILQ_FOREACH(bdev_module, &g_bdev_mgr.bdev_modules, internal.tailq) {
 		if (bdev_module->config_json) {
 			bdev_module->config_json(w);
@@ -1860,6 +2069,7 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 		}
 
 		bdev_qos_config_json(bdev, w);
+		bdev_write_coalescing_config_json(bdev, w);
 	}
 
 	spdk_spin_unlock(&g_bdev_mgr.spinlock);
@@ -2490,6 +2700,23 @@ bdev_get_io_size_in_byte(struct spdk_bdev_io *bdev_io)
 	}
 }
 
+static uint64_t
+bdev_qos_io_cost(enum spdk_bdev_qos_rate_limit_type type, struct spdk_bdev_io *io)
+{
+	switch (type) {
+	case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
+		return 1;
+	case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
+		return bdev_get_io_size_in_byte(io);
+	case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
+		return bdev_is_read_io(io) ? bdev_get_io_size_in_byte(io) : 0;
+	case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
+		return bdev_is_read_io(io) ? 0 : bdev_get_io_size_in_byte(io);
+	default:
+		return 0;
+	}
+}
+
 static bool
 bdev_qos_rw_queue_io(const struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
 {
@@ -2640,169 +2867,513 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 	}
 }
 
-static bool
-bdev_qos_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_io *bdev_io)
+static int64_t
+bdev_qos_group_per_timeslice(uint64_t rate)
+{
+	return rate * SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC;
+}
+
+static void
+bdev_qos_group_distribute(struct bdev_qos_group *group, const int64_t *budget)
 {
+	struct bdev_qos_group_limit *limit;
+	struct bdev_qos_group *child;
+	int64_t child_budget[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	int64_t reserved[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int64_t share, remaining, leftover, min_per_timeslice;
+	uint64_t weight = 0;
+	bool all_active;
 	int i;
 
-	if (bdev_qos_io_to_limit(bdev_io) == true) {
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			if (!qos->rate_limits[i].queue_io) {
-				continue;
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = &group->rate_limits[i];
+		share = budget[i];
+		if (limit->limit != 0) {
+			share = spdk_min(share, bdev_qos_group_per_timeslice(limit->limit));
+		}
+		__atomic_store_n(&limit->share, share, __ATOMIC_RELAXED);
+
+		if (share != INT64_MAX) {
+			/* An overrun of the last timeslice is deducted, unused quota expires.  I/O is
+			 * admitted concurrently, so none of its charges may be lost. */
+			remaining = __atomic_load_n(&limit->remaining, __ATOMIC_RELAXED);
+			while (!__atomic_compare_exchange_n(&limit->remaining, &remaining,
+							    spdk_min(remaining, 0) + share, false,
+							    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
 			}
+		}
+	}
 
-			if (qos->rate_limits[i].queue_io(&qos->rate_limits[i],
-							 bdev_io) == true) {
-				return true;
-			}
+	TAILQ_FOREACH(child, &group->children, child_link) {
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			reserved[i] += bdev_qos_group_per_timeslice(child->rate_limits[i].reservation);
+		}
+		if (__atomic_load_n(&child->active, __ATOMIC_RELAXED)) {
+			weight += child->weight;
+		}
+	}
+
+	/* Before any child becomes active, the leftover is split between all of them */
+	all_active = weight == 0;
+	if (all_active) {
+		TAILQ_FOREACH(child, &group->children, child_link) {
+			weight += child->weight;
 		}
+	}
+
+	TAILQ_FOREACH(child, &group->children, child_link) {
 		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			if (!qos->rate_limits[i].update_quota) {
+			if (group->rate_limits[i].share == INT64_MAX) {
+				child_budget[i] = INT64_MAX;
 				continue;
 			}
 
-			qos->rate_limits[i].update_quota(&qos->rate_limits[i], bdev_io);
+			child_budget[i] = bdev_qos_group_per_timeslice(child->rate_limits[i].reservation);
+			if (all_active || __atomic_load_n(&child->active, __ATOMIC_RELAXED)) {
+				leftover = spdk_max(group->rate_limits[i].share - reserved[i], 0);
+				child_budget[i] += spdk_divide_round_up(leftover * child->weight, weight);
+			}
+
+			min_per_timeslice = bdev_qos_is_iops_rate_limit(i) ?
+					    SPDK_BDEV_QOS_MIN_IO_PER_TIMESLICE : SPDK_BDEV_QOS_MIN_BYTE_PER_TIMESLICE;
+			child_budget[i] = spdk_max(child_budget[i], min_per_timeslice);
 		}
+
+		bdev_qos_group_distribute(child, child_budget);
 	}
 
-	return false;
+	__atomic_store_n(&group->active, false, __ATOMIC_RELAXED);
 }
 
-static inline void
-_bdev_io_do_submit(void *ctx)
+static void
+bdev_qos_groups_update(uint64_t now)
 {
-	struct spdk_bdev_io *bdev_io = ctx;
-	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	int64_t budget[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	struct bdev_qos_group_limit *limit;
+	struct bdev_qos_group *group;
+	uint64_t ticks_hz, consumed;
+	int i;
 
-	bdev_io_do_submit(ch, bdev_io);
-}
+	assert(spdk_spin_held(&g_bdev_qos_groups.spinlock));
 
-static int
-bdev_qos_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
-{
-	struct spdk_bdev_io		*bdev_io = NULL, *tmp = NULL;
-	int				submitted_ios = 0;
+	if (now < g_bdev_qos_groups.last_timeslice + g_bdev_qos_groups.timeslice_size) {
+		return;
+	}
 
-	TAILQ_FOREACH_SAFE(bdev_io, &qos->queued, internal.link, tmp) {
-		if (!bdev_qos_queue_io(qos, bdev_io)) {
-			TAILQ_REMOVE(&qos->queued, bdev_io, internal.link);
+	/* The budget is not accumulated over the timeslices without I/O */
+	__atomic_store_n(&g_bdev_qos_groups.last_timeslice, now, __ATOMIC_RELAXED);
 
-			if (bdev_io->internal.io_submit_ch) {
-				/* Send back the IO to the original thread for the actual processing. */
-				bdev_io->internal.ch = bdev_io->internal.io_submit_ch;
-				bdev_io->internal.io_submit_ch = NULL;
-				spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io),
-						     _bdev_io_do_submit, bdev_io);
-			} else {
-				bdev_io_do_submit(ch, bdev_io);
+	ticks_hz = spdk_get_ticks_hz();
+	if (now - g_bdev_qos_groups.rate_tsc >= ticks_hz) {
+		TAILQ_FOREACH(group, &g_bdev_qos_groups.groups, link) {
+			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+				limit = &group->rate_limits[i];
+				consumed = __atomic_load_n(&limit->consumed, __ATOMIC_RELAXED);
+				limit->achieved_rate = (double)(consumed - limit->last_consumed) *
+						       ticks_hz / (now - g_bdev_qos_groups.rate_tsc);
+				limit->last_consumed = consumed;
 			}
-
-			submitted_ios++;
 		}
+		g_bdev_qos_groups.rate_tsc = now;
 	}
 
-	return submitted_ios;
-}
-
-static void
-bdev_queue_io_wait_with_cb(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn)
-{
-	int rc;
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		budget[i] = INT64_MAX;
+	}
 
-	bdev_io->internal.waitq_entry.bdev = bdev_io->bdev;
-	bdev_io->internal.waitq_entry.cb_fn = cb_fn;
-	bdev_io->internal.waitq_entry.cb_arg = bdev_io;
-	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, spdk_io_channel_from_ctx(bdev_io->internal.ch),
-				     &bdev_io->internal.waitq_entry);
-	if (rc != 0) {
-		SPDK_ERRLOG("Queue IO failed, rc=%d\n", rc);
-		bdev_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
-		bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
+	TAILQ_FOREACH(group, &g_bdev_qos_groups.groups, link) {
+		if (group->parent == NULL) {
+			bdev_qos_group_distribute(group, budget);
+		}
 	}
 }
 
 static bool
-bdev_rw_should_split(struct spdk_bdev_io *bdev_io)
+bdev_qos_group_queue_io(struct bdev_qos_group *group, struct spdk_bdev_io *bdev_io)
 {
-	uint32_t io_boundary;
-	struct spdk_bdev *bdev = bdev_io->bdev;
-	uint32_t max_size = bdev->max_segment_size;
-	int max_segs = bdev->max_num_segments;
+	struct bdev_qos_group_limit *limit;
+	struct bdev_qos_group *g;
+	uint64_t cost, last_timeslice;
+	bool queue = false;
+	int i;
 
-	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE && bdev->split_on_write_unit) {
-		io_boundary = bdev->write_unit_size;
-	} else if (bdev->split_on_optimal_io_boundary) {
-		io_boundary = bdev->optimal_io_boundary;
-	} else {
-		io_boundary = 0;
+	/* Only the first thread to see the timeslice expire takes the lock to hand out the shares */
+	last_timeslice = __atomic_load_n(&g_bdev_qos_groups.last_timeslice, __ATOMIC_RELAXED);
+	if (spdk_unlikely(spdk_get_ticks() >= last_timeslice + g_bdev_qos_groups.timeslice_size)) {
+		spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+		bdev_qos_groups_update(spdk_get_ticks());
+		spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
 	}
 
-	if (spdk_likely(!io_boundary && !max_segs && !max_size)) {
-		return false;
+	/* Only the leaf group is checked, its share is carved out of its parents' budget */
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = &group->rate_limits[i];
+		if (__atomic_load_n(&limit->share, __ATOMIC_RELAXED) != INT64_MAX &&
+		    __atomic_load_n(&limit->remaining, __ATOMIC_RELAXED) <= 0 &&
+		    bdev_qos_io_cost(i, bdev_io) != 0) {
+			queue = true;
+			__atomic_add_fetch(&group->throttled, 1, __ATOMIC_RELAXED);
+			break;
+		}
 	}
 
-	if (io_boundary) {
-		uint64_t start_stripe, end_stripe;
-
-		start_stripe = bdev_io->u.bdev.offset_blocks;
-		end_stripe = start_stripe + bdev_io->u.bdev.num_blocks - 1;
-		/* Avoid expensive div operations if possible.  These spdk_u32 functions are very cheap. */
-		if (spdk_likely(spdk_u32_is_pow2(io_boundary))) {
-			start_stripe >>= spdk_u32log2(io_boundary);
-			end_stripe >>= spdk_u32log2(io_boundary);
-		} else {
-			start_stripe /= io_boundary;
-			end_stripe /= io_boundary;
+	for (g = group; g != NULL; g = g->parent) {
+		/* Avoid writing to the cache line shared by all member bdevs if possible */
+		if (!__atomic_load_n(&g->active, __ATOMIC_RELAXED)) {
+			__atomic_store_n(&g->active, true, __ATOMIC_RELAXED);
 		}
-
-		if (start_stripe != end_stripe) {
-			return true;
+		if (queue) {
+			continue;
 		}
-	}
 
-	if (max_segs) {
-		if (bdev_io->u.bdev.iovcnt > max_segs) {
-			return true;
-		}
-	}
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			cost = bdev_qos_io_cost(i, bdev_io);
+			if (cost == 0) {
+				continue;
+			}
 
-	if (max_size) {
-		for (int i = 0; i < bdev_io->u.bdev.iovcnt; i++) {
-			if (bdev_io->u.bdev.iovs[i].iov_len > max_size) {
-				return true;
+			limit = &g->rate_limits[i];
+			__atomic_add_fetch(&limit->consumed, cost, __ATOMIC_RELAXED);
+			if (g == group && __atomic_load_n(&limit->share, __ATOMIC_RELAXED) != INT64_MAX) {
+				/* Like the bdev's own quota, this may run negative with concurrent I/O */
+				__atomic_sub_fetch(&limit->remaining, cost, __ATOMIC_RELAXED);
 			}
 		}
 	}
 
-	return false;
+	return queue;
 }
 
-static bool
-bdev_unmap_should_split(struct spdk_bdev_io *bdev_io)
+static void
+bdev_qos_group_put(struct bdev_qos_group *group)
 {
-	uint32_t num_unmap_segments;
-
-	if (!bdev_io->bdev->max_unmap || !bdev_io->bdev->max_unmap_segments) {
-		return false;
-	}
-	num_unmap_segments = spdk_divide_round_up(bdev_io->u.bdev.num_blocks, bdev_io->bdev->max_unmap);
-	if (num_unmap_segments > bdev_io->bdev->max_unmap_segments) {
-		return true;
-	}
-
-	return false;
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	assert(group->num_bdevs > 0);
+	group->num_bdevs--;
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
 }
 
 static bool
-bdev_write_zeroes_should_split(struct spdk_bdev_io *bdev_io)
+bdev_qos_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_io *bdev_io)
 {
-	if (!bdev_io->bdev->max_write_zeroes) {
-		return false;
-	}
+	int i;
 
-	if (bdev_io->u.bdev.num_blocks > bdev_io->bdev->max_write_zeroes) {
-		return true;
-	}
+	if (bdev_qos_io_to_limit(bdev_io) == true) {
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (!qos->rate_limits[i].queue_io) {
+				continue;
+			}
+
+			if (qos->rate_limits[i].queue_io(&qos->rate_limits[i],
+							 bdev_io) == true) {
+				return true;
+			}
+		}
+		if (qos->group != NULL && bdev_qos_group_queue_io(qos->group, bdev_io)) {
+			return true;
+		}
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (!qos->rate_limits[i].update_quota) {
+				continue;
+			}
+
+			qos->rate_limits[i].update_quota(&qos->rate_limits[i], bdev_io);
+			qos->rate_limits[i].consumed += bdev_qos_io_cost(i, bdev_io);
+		}
+	}
+
+	return false;
+}
+
+/*
+ * In distributed mode, channels draw quota from the budget of the current timeslice in grants
+ * and admit I/O against their local quota, so the shared budget is only touched once per grant.
+ * Quota left unused at the end of a timeslice expires, while an overrun is charged to the
+ * channel's next grants.
+ */
+static void
+bdev_qos_channel_flush_consumed(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos, int i)
+{
+	/* The admitted I/O is accounted in batches too, when drawing quota or once per timeslice */
+	if (ch->qos_local[i].consumed != 0) {
+		__atomic_add_fetch(&qos->rate_limits[i].consumed, ch->qos_local[i].consumed,
+				   __ATOMIC_RELAXED);
+		ch->qos_local[i].consumed = 0;
+	}
+}
+
+static void
+bdev_qos_channel_update_epoch(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
+{
+	uint64_t epoch = __atomic_load_n(&qos->epoch, __ATOMIC_RELAXED);
+	int i;
+
+	if (spdk_likely(ch->qos_epoch == epoch)) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		ch->qos_local[i].quota = spdk_min(ch->qos_local[i].quota, 0);
+		bdev_qos_channel_flush_consumed(ch, qos, i);
+	}
+	ch->qos_epoch = epoch;
+	ch->qos_active = false;
+}
+
+static bool
+bdev_qos_channel_draw_quota(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos, int i)
+{
+	struct spdk_bdev_qos_limit *limit = &qos->rate_limits[i];
+	int64_t grant, remaining;
+
+	/* Draw at least enough to pay off an overrun */
+	grant = spdk_max((int64_t)limit->grant_per_channel, 1 - ch->qos_local[i].quota);
+
+	remaining = __atomic_sub_fetch(&limit->remaining_this_timeslice, grant, __ATOMIC_RELAXED);
+	if (remaining + grant <= 0) {
+		/* The budget of this timeslice is used up */
+		__atomic_add_fetch(&limit->remaining_this_timeslice, grant, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	if (remaining < 0) {
+		/* Only take what was left */
+		__atomic_add_fetch(&limit->remaining_this_timeslice, -remaining, __ATOMIC_RELAXED);
+		grant += remaining;
+	}
+
+	ch->qos_local[i].quota += grant;
+
+	bdev_qos_channel_flush_consumed(ch, qos, i);
+
+	if (!ch->qos_active) {
+		ch->qos_active = true;
+		__atomic_add_fetch(&qos->active_channels, 1, __ATOMIC_RELAXED);
+	}
+
+	return ch->qos_local[i].quota > 0;
+}
+
+static bool
+bdev_qos_channel_queue_io(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos,
+			  struct spdk_bdev_io *bdev_io)
+{
+	uint64_t cost[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	int i;
+
+	if (bdev_qos_io_to_limit(bdev_io) == false) {
+		return false;
+	}
+
+	bdev_qos_channel_update_epoch(ch, qos);
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		cost[i] = 0;
+		if (qos->rate_limits[i].max_per_timeslice == 0) {
+			continue;
+		}
+
+		cost[i] = bdev_qos_io_cost(i, bdev_io);
+		if (cost[i] == 0 || ch->qos_local[i].quota > 0) {
+			continue;
+		}
+
+		if (!bdev_qos_channel_draw_quota(ch, qos, i)) {
+			return true;
+		}
+	}
+
+	if (qos->group != NULL && bdev_qos_group_queue_io(qos->group, bdev_io)) {
+		return true;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		ch->qos_local[i].quota -= cost[i];
+		ch->qos_local[i].consumed += cost[i];
+	}
+
+	return false;
+}
+
+static inline void
+_bdev_io_do_submit(void *ctx)
+{
+	struct spdk_bdev_io *bdev_io = ctx;
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+
+	bdev_io_do_submit(ch, bdev_io);
+}
+
+static int
+bdev_channel_poll_qos_queued(void *arg)
+{
+	struct spdk_bdev_channel *ch = arg;
+	struct spdk_bdev_io *bdev_io;
+	int submitted_ios = 0;
+
+	while (!TAILQ_EMPTY(&ch->qos_queued)) {
+		bdev_io = TAILQ_FIRST(&ch->qos_queued);
+		if (bdev_qos_channel_queue_io(ch, ch->bdev->internal.qos, bdev_io)) {
+			break;
+		}
+
+		TAILQ_REMOVE(&ch->qos_queued, bdev_io, internal.link);
+		bdev_io_do_submit(ch, bdev_io);
+		submitted_ios++;
+	}
+
+	if (TAILQ_EMPTY(&ch->qos_queued)) {
+		spdk_poller_unregister(&ch->qos_poller);
+	}
+
+	return submitted_ios > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+bdev_qos_channel_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_qos *qos = ch->bdev->internal.qos;
+
+	/* Rate limited I/O is kept in order behind the I/O already waiting for quota */
+	if ((TAILQ_EMPTY(&ch->qos_queued) || bdev_qos_io_to_limit(bdev_io) == false) &&
+	    bdev_qos_channel_queue_io(ch, qos, bdev_io) == false) {
+		bdev_io_do_submit(ch, bdev_io);
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&ch->qos_queued, bdev_io, internal.link);
+	if (ch->qos_poller == NULL) {
+		ch->qos_poller = SPDK_POLLER_REGISTER(bdev_channel_poll_qos_queued, ch,
+						      SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	}
+}
+
+static int
+bdev_qos_io_submit(struct spdk_bdev_channel *ch, struct spdk_bdev_qos *qos)
+{
+	struct spdk_bdev_io		*bdev_io = NULL, *tmp = NULL;
+	int				submitted_ios = 0;
+
+	TAILQ_FOREACH_SAFE(bdev_io, &qos->queued, internal.link, tmp) {
+		if (!bdev_qos_queue_io(qos, bdev_io)) {
+			TAILQ_REMOVE(&qos->queued, bdev_io, internal.link);
+
+			if (bdev_io->internal.io_submit_ch) {
+				/* Send back the IO to the original thread for the actual processing. */
+				bdev_io->internal.ch = bdev_io->internal.io_submit_ch;
+				bdev_io->internal.io_submit_ch = NULL;
+				spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io),
+						     _bdev_io_do_submit, bdev_io);
+			} else {
+				bdev_io_do_submit(ch, bdev_io);
+			}
+
+			submitted_ios++;
+		}
+	}
+
+	return submitted_ios;
+}
+
+static void
+bdev_queue_io_wait_with_cb(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn)
+{
+	int rc;
+
+	bdev_io->internal.waitq_entry.bdev = bdev_io->bdev;
+	bdev_io->internal.waitq_entry.cb_fn = cb_fn;
+	bdev_io->internal.waitq_entry.cb_arg = bdev_io;
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, spdk_io_channel_from_ctx(bdev_io->internal.ch),
+				     &bdev_io->internal.waitq_entry);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue IO failed, rc=%d\n", rc);
+		bdev_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
+	}
+}
+
+static bool
+bdev_rw_should_split(struct spdk_bdev_io *bdev_io)
+{
+	uint32_t io_boundary;
+	struct spdk_bdev *bdev = bdev_io->bdev;
+	uint32_t max_size = bdev->max_segment_size;
+	int max_segs = bdev->max_num_segments;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE && bdev->split_on_write_unit) {
+		io_boundary = bdev->write_unit_size;
+	} else if (bdev->split_on_optimal_io_boundary) {
+		io_boundary = bdev->optimal_io_boundary;
+	} else {
+		io_boundary = 0;
+	}
+
+	if (spdk_likely(!io_boundary && !max_segs && !max_size)) {
+		return false;
+	}
+
+	if (io_boundary) {
+		uint64_t start_stripe, end_stripe;
+
+		start_stripe = bdev_io->u.bdev.offset_blocks;
+		end_stripe = start_stripe + bdev_io->u.bdev.num_blocks - 1;
+		/* Avoid expensive div operations if possible.  These spdk_u32 functions are very cheap. */
+		if (spdk_likely(spdk_u32_is_pow2(io_boundary))) {
+			start_stripe >>= spdk_u32log2(io_boundary);
+			end_stripe >>= spdk_u32log2(io_boundary);
+		} else {
+			start_stripe /= io_boundary;
+			end_stripe /= io_boundary;
+		}
+
+		if (start_stripe != end_stripe) {
+			return true;
+		}
+	}
+
+	if (max_segs) {
+		if (bdev_io->u.bdev.iovcnt > max_segs) {
+			return true;
+		}
+	}
+
+	if (max_size) {
+		for (int i = 0; i < bdev_io->u.bdev.iovcnt; i++) {
+			if (bdev_io->u.bdev.iovs[i].iov_len > max_size) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static bool
+bdev_unmap_should_split(struct spdk_bdev_io *bdev_io)
+{
+	uint32_t num_unmap_segments;
+
+	if (!bdev_io->bdev->max_unmap || !bdev_io->bdev->max_unmap_segments) {
+		return false;
+	}
+	num_unmap_segments = spdk_divide_round_up(bdev_io->u.bdev.num_blocks, bdev_io->bdev->max_unmap);
+	if (num_unmap_segments > bdev_io->bdev->max_unmap_segments) {
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+bdev_write_zeroes_should_split(struct spdk_bdev_io *bdev_io)
+{
+	if (!bdev_io->bdev->max_write_zeroes) {
+		return false;
+	}
+
+	if (bdev_io->u.bdev.num_blocks > bdev_io->bdev->max_write_zeroes) {
+		return true;
+	}
 
 	return false;
 }
@@ -3338,8 +3909,11 @@ _bdev_io_submit(void *ctx)
 		_bdev_io_complete_in_submit(bdev_ch, bdev_io, SPDK_BDEV_IO_STATUS_ABORTED);
 	} else if (bdev_ch->flags & BDEV_CH_QOS_ENABLED) {
 		if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_ABORT) &&
-		    bdev_abort_queued_io(&bdev->internal.qos->queued, bdev_io->u.abort.bio_to_abort)) {
+		    (bdev_abort_queued_io(&bdev->internal.qos->queued, bdev_io->u.abort.bio_to_abort) ||
+		     bdev_abort_queued_io(&bdev_ch->qos_queued, bdev_io->u.abort.bio_to_abort))) {
 			_bdev_io_complete_in_submit(bdev_ch, bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		} else if (bdev->internal.qos->distributed) {
+			bdev_qos_channel_io_submit(bdev_ch, bdev_io);
 		} else {
 			TAILQ_INSERT_TAIL(&bdev->internal.qos->queued, bdev_io, internal.link);
 			bdev_qos_io_submit(bdev_ch, bdev->internal.qos);
@@ -3407,42 +3981,21 @@ bdev_io_range_is_locked(struct spdk_bdev_io *bdev_io, struct lba_range *range)
 	}
 }
 
-void
-bdev_io_submit(struct spdk_bdev_io *bdev_io)
+static void
+bdev_io_submit_ready(struct spdk_bdev_io *bdev_io)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
 	struct spdk_thread *thread = spdk_bdev_io_get_thread(bdev_io);
 	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
 
-	assert(thread != NULL);
-	assert(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
-
-	if (!TAILQ_EMPTY(&ch->locked_ranges)) {
-		struct lba_range *range;
-
-		TAILQ_FOREACH(range, &ch->locked_ranges, tailq) {
-			if (bdev_io_range_is_locked(bdev_io, range)) {
-				TAILQ_INSERT_TAIL(&ch->io_locked, bdev_io, internal.ch_link);
-				return;
-			}
-		}
-	}
-
-	TAILQ_INSERT_TAIL(&ch->io_submitted, bdev_io, internal.ch_link);
-
-	bdev_io->internal.submit_tsc = spdk_get_ticks();
-	spdk_trace_record_tsc(bdev_io->internal.submit_tsc, TRACE_BDEV_IO_START, 0, 0,
-			      (uintptr_t)bdev_io, (uint64_t)bdev_io->type, bdev_io->internal.caller_ctx,
-			      bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
-			      spdk_bdev_get_name(bdev));
-
-	if (bdev_io->internal.split) {
-		bdev_io_split(bdev_io);
-		return;
+	if (bdev_io->internal.split) {
+		bdev_io_split(bdev_io);
+		return;
 	}
 
 	if (ch->flags & BDEV_CH_QOS_ENABLED) {
-		if ((thread == bdev->internal.qos->thread) || !bdev->internal.qos->thread) {
+		if ((thread == bdev->internal.qos->thread) || !bdev->internal.qos->thread ||
+		    bdev->internal.qos->distributed) {
 			_bdev_io_submit(bdev_io);
 		} else {
 			bdev_io->internal.io_submit_ch = ch;
@@ -3454,6 +4007,277 @@ bdev_io_submit(struct spdk_bdev_io *bdev_io)
 	}
 }
 
+static struct bdev_coalesce_batch *
+bdev_coalesce_get_batch(struct spdk_bdev_channel *ch)
+{
+	struct bdev_coalesce_batch *batch;
+
+	batch = STAILQ_FIRST(&ch->coalesce_free_batches);
+	if (batch != NULL) {
+		STAILQ_REMOVE_HEAD(&ch->coalesce_free_batches, link);
+	} else {
+		batch = malloc(sizeof(*batch));
+		if (batch == NULL) {
+			return NULL;
+		}
+	}
+
+	TAILQ_INIT(&batch->ios);
+	batch->num_ios = 0;
+	batch->num_blocks = 0;
+	batch->iovcnt = 0;
+
+	return batch;
+}
+
+static void
+bdev_coalesce_complete_ios(struct bdev_coalesce_batch *batch, enum spdk_bdev_io_status status)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	/* Like the parent of split I/O, the original I/O were never submitted to the module,
+	 * so they are completed directly to the caller.
+	 */
+	while ((bdev_io = TAILQ_FIRST(&batch->ios)) != NULL) {
+		TAILQ_REMOVE(&batch->ios, bdev_io, internal.link);
+		TAILQ_REMOVE(&bdev_io->internal.ch->io_submitted, bdev_io, internal.ch_link);
+		spdk_trace_record(TRACE_BDEV_IO_DONE, 0, 0, (uintptr_t)bdev_io,
+				  bdev_io->internal.caller_ctx);
+		bdev_io->internal.status = status;
+		bdev_io->internal.cb(bdev_io, status == SPDK_BDEV_IO_STATUS_SUCCESS,
+				     bdev_io->internal.caller_ctx);
+	}
+}
+
+static void
+bdev_coalesce_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct bdev_coalesce_batch *batch = cb_arg;
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+
+	spdk_bdev_free_io(bdev_io);
+
+	bdev_coalesce_complete_ios(batch, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+				   SPDK_BDEV_IO_STATUS_FAILED);
+	STAILQ_INSERT_HEAD(&ch->coalesce_free_batches, batch, link);
+}
+
+static void
+bdev_coalesce_flush(struct spdk_bdev_channel *ch)
+{
+	struct bdev_coalesce_batch *batch = ch->coalesce_batch;
+	struct spdk_bdev_io *bdev_io;
+	int rc;
+
+	if (batch == NULL) {
+		return;
+	}
+	ch->coalesce_batch = NULL;
+
+	if (batch->num_ios > 1) {
+		rc = bdev_writev_blocks_with_md(batch->desc, spdk_io_channel_from_ctx(ch),
+						batch->iovs, batch->iovcnt, NULL,
+						batch->offset_blocks, batch->num_blocks,
+						NULL, NULL, NULL, bdev_coalesce_done, batch);
+		if (spdk_likely(rc == 0)) {
+			ch->stat->num_coalesced_write_ops += batch->num_ios;
+			ch->stat->num_coalesced_write_batches++;
+			return;
+		}
+	}
+
+	/* A single write, or no bdev_io was available for the merged one. Submit the
+	 * original I/O as they are, they will be queued on ENOMEM as usual.
+	 */
+	while ((bdev_io = TAILQ_FIRST(&batch->ios)) != NULL) {
+		TAILQ_REMOVE(&batch->ios, bdev_io, internal.link);
+		bdev_io_submit_ready(bdev_io);
+	}
+	STAILQ_INSERT_HEAD(&ch->coalesce_free_batches, batch, link);
+}
+
+static void
+bdev_coalesce_abort(struct spdk_bdev_channel *ch)
+{
+	struct bdev_coalesce_batch *batch = ch->coalesce_batch;
+
+	if (batch != NULL) {
+		ch->coalesce_batch = NULL;
+		bdev_coalesce_complete_ios(batch, SPDK_BDEV_IO_STATUS_ABORTED);
+		STAILQ_INSERT_HEAD(&ch->coalesce_free_batches, batch, link);
+	}
+}
+
+static int
+bdev_coalesce_poll(void *arg)
+{
+	struct spdk_bdev_channel *ch = arg;
+
+	if (ch->coalesce_batch == NULL) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	bdev_coalesce_flush(ch);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static bool
+bdev_io_can_coalesce(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	return bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
+	       !bdev_io->internal.split &&
+	       bdev_io->num_retries == 0 &&
+	       bdev_io->internal.cb != bdev_io_split_done &&
+	       bdev_io->internal.cb != bdev_coalesce_done &&
+	       bdev_io->u.bdev.md_buf == NULL &&
+	       bdev_io->internal.memory_domain == NULL &&
+	       bdev_io->internal.accel_sequence == NULL &&
+	       bdev_io->internal.orig_iovcnt == 0 &&
+	       bdev_io->u.bdev.iovcnt <= BDEV_COALESCE_MAX_IOVS &&
+	       bdev_io->u.bdev.num_blocks < ch->coalesce_max_blocks &&
+	       (ch->flags & BDEV_CH_RESET_IN_PROGRESS) == 0;
+}
+
+static bool
+bdev_coalesce_batch_fits(struct spdk_bdev_channel *ch, struct bdev_coalesce_batch *batch,
+			 struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev *bdev = ch->bdev;
+	uint32_t max_iovcnt = BDEV_COALESCE_MAX_IOVS;
+	uint64_t end_blocks;
+
+	if (batch->desc != bdev_io->internal.desc ||
+	    batch->offset_blocks + batch->num_blocks != bdev_io->u.bdev.offset_blocks) {
+		return false;
+	}
+
+	if (bdev->max_num_segments != 0) {
+		max_iovcnt = spdk_min(max_iovcnt, bdev->max_num_segments);
+	}
+	if (batch->iovcnt + bdev_io->u.bdev.iovcnt > (int)max_iovcnt ||
+	    batch->num_blocks + bdev_io->u.bdev.num_blocks > ch->coalesce_max_blocks) {
+		return false;
+	}
+
+	/* Do not merge writes that the bdev layer would split again. */
+	if (bdev->split_on_optimal_io_boundary && bdev->optimal_io_boundary != 0) {
+		end_blocks = bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks - 1;
+		if (batch->offset_blocks / bdev->optimal_io_boundary !=
+		    end_blocks / bdev->optimal_io_boundary) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Hold adjacent writes back on the channel and submit them as a single write once the
+ * coalescing window expires or the maximum size is reached.  Returns true if the I/O was
+ * added to the batch.
+ */
+static bool
+bdev_io_coalesce(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_coalesce_batch *batch = ch->coalesce_batch;
+	int i;
+
+	if (!bdev_io_can_coalesce(ch, bdev_io)) {
+		/* Reads are not ordered against outstanding writes, anything else goes after
+		 * the writes that were submitted before it.
+		 */
+		if (batch != NULL && bdev_io->type != SPDK_BDEV_IO_TYPE_READ &&
+		    bdev_io->internal.cb != bdev_coalesce_done) {
+			bdev_coalesce_flush(ch);
+		}
+		return false;
+	}
+
+	if (batch != NULL && !bdev_coalesce_batch_fits(ch, batch, bdev_io)) {
+		bdev_coalesce_flush(ch);
+		batch = NULL;
+	}
+
+	if (batch == NULL) {
+		batch = bdev_coalesce_get_batch(ch);
+		if (spdk_unlikely(batch == NULL)) {
+			return false;
+		}
+		batch->desc = bdev_io->internal.desc;
+		batch->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		ch->coalesce_batch = batch;
+	}
+
+	for (i = 0; i < bdev_io->u.bdev.iovcnt; i++) {
+		batch->iovs[batch->iovcnt++] = bdev_io->u.bdev.iovs[i];
+	}
+	batch->num_blocks += bdev_io->u.bdev.num_blocks;
+	batch->num_ios++;
+	TAILQ_INSERT_TAIL(&batch->ios, bdev_io, internal.link);
+
+	if (batch->num_blocks >= ch->coalesce_max_blocks ||
+	    batch->iovcnt == BDEV_COALESCE_MAX_IOVS) {
+		bdev_coalesce_flush(ch);
+	}
+
+	return true;
+}
+
+static void
+bdev_channel_set_coalescing(struct spdk_bdev_channel *ch, uint64_t window_us, uint32_t max_size)
+{
+	uint64_t max_blocks;
+
+	bdev_coalesce_flush(ch);
+	spdk_poller_unregister(&ch->coalesce_poller);
+
+	max_blocks = max_size / spdk_bdev_get_block_size(ch->bdev);
+
+	if (window_us == 0 || max_blocks < 2) {
+		ch->coalesce_max_blocks = 0;
+		return;
+	}
+
+	ch->coalesce_max_blocks = max_blocks;
+	ch->coalesce_poller = SPDK_POLLER_REGISTER(bdev_coalesce_poll, ch, window_us);
+}
+
+void
+bdev_io_submit(struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev *bdev = bdev_io->bdev;
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+
+	assert(spdk_bdev_io_get_thread(bdev_io) != NULL);
+	assert(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+
+	if (!TAILQ_EMPTY(&ch->locked_ranges)) {
+		struct lba_range *range;
+
+		TAILQ_FOREACH(range, &ch->locked_ranges, tailq) {
+			if (bdev_io_range_is_locked(bdev_io, range)) {
+				TAILQ_INSERT_TAIL(&ch->io_locked, bdev_io, internal.ch_link);
+				return;
+			}
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&ch->io_submitted, bdev_io, internal.ch_link);
+
+	bdev_io->internal.submit_tsc = spdk_get_ticks();
+	spdk_trace_record_tsc(bdev_io->internal.submit_tsc, TRACE_BDEV_IO_START, 0, 0,
+			      (uintptr_t)bdev_io, (uint64_t)bdev_io->type, bdev_io->internal.caller_ctx,
+			      bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
+			      spdk_bdev_get_name(bdev));
+
+	if (spdk_unlikely(ch->coalesce_max_blocks != 0) && bdev_io_coalesce(ch, bdev_io)) {
+		return;
+	}
+
+	bdev_io_submit_ready(bdev_io);
+}
+
 static inline void
 _bdev_io_ext_use_bounce_buffer(struct spdk_bdev_io *bdev_io)
 {
@@ -3588,6 +4412,52 @@ spdk_bdev_dump_info_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 	return 0;
 }
 
+static void
+bdev_qos_update_grants(struct spdk_bdev_qos *qos)
+{
+	uint32_t active_channels;
+	int i;
+
+	if (!qos->distributed) {
+		return;
+	}
+
+	/* Split the budget between the channels that drew quota in the last timeslice, keeping
+	 * a share for channels that just became active. */
+	active_channels = __atomic_exchange_n(&qos->active_channels, 0, __ATOMIC_RELAXED);
+	active_channels = spdk_max(active_channels, 1);
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		qos->rate_limits[i].grant_per_channel = spdk_max(
+				qos->rate_limits[i].max_per_timeslice / (2 * active_channels),
+				qos->rate_limits[i].min_per_timeslice);
+	}
+
+	/* Let the channels know that their quota expired */
+	__atomic_add_fetch(&qos->epoch, 1, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_qos_update_achieved_rates(struct spdk_bdev_qos *qos, uint64_t now)
+{
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t consumed;
+	int i;
+
+	if (now - qos->rate_tsc < ticks_hz) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		consumed = __atomic_load_n(&qos->rate_limits[i].consumed, __ATOMIC_RELAXED);
+		qos->rate_limits[i].achieved_rate = (double)(consumed - qos->rate_limits[i].last_consumed) *
+						    ticks_hz / (now - qos->rate_tsc);
+		qos->rate_limits[i].last_consumed = consumed;
+	}
+
+	qos->rate_tsc = now;
+}
+
 static void
 bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 {
@@ -3610,13 +4480,17 @@ bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 	}
 
 	bdev_qos_set_ops(qos);
+	bdev_qos_update_grants(qos);
 }
 
 static int
 bdev_channel_poll_qos(void *arg)
 {
 	struct spdk_bdev_qos *qos = arg;
+	struct spdk_bdev_qos_limit *limit;
 	uint64_t now = spdk_get_ticks();
+	uint64_t timeslices = 0;
+	int64_t remaining, refill;
 	int i;
 
 	if (now < (qos->last_timeslice + qos->timeslice_size)) {
@@ -3628,24 +4502,34 @@ bdev_channel_poll_qos(void *arg)
 		return SPDK_POLLER_IDLE;
 	}
 
-	/* Reset for next round of rate limiting */
-	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-		/* We may have allowed the IOs or bytes to slightly overrun in the last
-		 * timeslice. remaining_this_timeslice is signed, so if it's negative
-		 * here, we'll account for the overrun so that the next timeslice will
-		 * be appropriately reduced.
-		 */
-		if (qos->rate_limits[i].remaining_this_timeslice > 0) {
-			qos->rate_limits[i].remaining_this_timeslice = 0;
-		}
-	}
+	bdev_qos_update_achieved_rates(qos, now);
 
 	while (now >= (qos->last_timeslice + qos->timeslice_size)) {
 		qos->last_timeslice += qos->timeslice_size;
-		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
-			qos->rate_limits[i].remaining_this_timeslice +=
-				qos->rate_limits[i].max_per_timeslice;
-		}
+		timeslices++;
+	}
+
+	/* Reset for next round of rate limiting.  In distributed mode, the channels update
+	 * remaining_this_timeslice concurrently, so replace it with a compare-and-swap that
+	 * retries instead of losing their updates. */
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = &qos->rate_limits[i];
+		remaining = __atomic_load_n(&limit->remaining_this_timeslice, __ATOMIC_RELAXED);
+		do {
+			/* We may have allowed the IOs or bytes to slightly overrun in the last
+			 * timeslice. remaining_this_timeslice is signed, so if it's negative
+			 * here, we'll account for the overrun so that the next timeslice will
+			 * be appropriately reduced.
+			 */
+			refill = spdk_min(remaining, 0) + (int64_t)timeslices * limit->max_per_timeslice;
+		} while (!__atomic_compare_exchange_n(&limit->remaining_this_timeslice, &remaining, refill,
+						      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	}
+
+	if (qos->distributed) {
+		/* The channels resubmit their queued I/O themselves */
+		bdev_qos_update_grants(qos);
+		return SPDK_POLLER_BUSY;
 	}
 
 	return bdev_qos_io_submit(qos->ch, qos);
@@ -3656,6 +4540,14 @@ bdev_channel_destroy_resource(struct spdk_bdev_channel *ch)
 {
 	struct spdk_bdev_shared_resource *shared_resource;
 	struct lba_range *range;
+	struct bdev_coalesce_batch *batch;
+
+	assert(ch->coalesce_batch == NULL);
+	spdk_poller_unregister(&ch->coalesce_poller);
+	while ((batch = STAILQ_FIRST(&ch->coalesce_free_batches)) != NULL) {
+		STAILQ_REMOVE_HEAD(&ch->coalesce_free_batches, link);
+		free(batch);
+	}
 
 	bdev_free_io_stat(ch->stat);
 #ifdef SPDK_CONFIG_VTUNE
@@ -3714,6 +4606,7 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 			qos->thread = spdk_io_channel_get_thread(io_ch);
 
 			TAILQ_INIT(&qos->queued);
+			qos->distributed = g_bdev_opts.qos_distributed;
 
 			for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 				if (bdev_qos_is_iops_rate_limit(i) == true) {
@@ -3732,11 +4625,15 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 			qos->timeslice_size =
 				SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 			qos->last_timeslice = spdk_get_ticks();
+			qos->rate_tsc = qos->last_timeslice;
 			qos->poller = SPDK_POLLER_REGISTER(bdev_channel_poll_qos,
 							   qos,
 							   SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
 		}
 
+		memset(ch->qos_local, 0, sizeof(ch->qos_local));
+		ch->qos_epoch = qos->epoch;
+		ch->qos_active = false;
 		ch->flags |= BDEV_CH_QOS_ENABLED;
 	}
 }
@@ -3873,61 +4770,169 @@ spdk_bdev_set_timeout(struct spdk_bdev_desc *desc, uint64_t timeout_in_sec,
 	return 0;
 }
 
-static int
-bdev_channel_create(void *io_device, void *ctx_buf)
-{
-	struct spdk_bdev		*bdev = __bdev_from_io_dev(io_device);
-	struct spdk_bdev_channel	*ch = ctx_buf;
-	struct spdk_io_channel		*mgmt_io_ch;
-	struct spdk_bdev_mgmt_channel	*mgmt_ch;
-	struct spdk_bdev_shared_resource *shared_resource;
-	struct lba_range		*range;
+#define BDEV_NUM_IO_HISTOGRAMS (SPDK_BDEV_NUM_IO_TYPES * SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES)
 
-	ch->bdev = bdev;
-	ch->channel = bdev->fn_table->get_io_channel(bdev->ctxt);
-	if (!ch->channel) {
-		return -1;
-	}
+static const uint64_t g_bdev_histogram_size_class_max[SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES] = {
+	[SPDK_BDEV_HISTOGRAM_SIZE_4K] = 4 * 1024,
+	[SPDK_BDEV_HISTOGRAM_SIZE_16K] = 16 * 1024,
+	[SPDK_BDEV_HISTOGRAM_SIZE_64K] = 64 * 1024,
+	[SPDK_BDEV_HISTOGRAM_SIZE_256K] = 256 * 1024,
+	[SPDK_BDEV_HISTOGRAM_SIZE_LARGE] = UINT64_MAX,
+};
 
-	ch->accel_channel = spdk_accel_get_io_channel();
-	if (!ch->accel_channel) {
-		spdk_put_io_channel(ch->channel);
-		return -1;
-	}
+uint64_t
+spdk_bdev_histogram_size_class_get_max_size(enum spdk_bdev_histogram_size_class size_class)
+{
+	assert(size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES);
 
-	spdk_trace_record(TRACE_BDEV_IOCH_CREATE, 0, 0, 0, ch->bdev->name,
-			  spdk_thread_get_id(spdk_io_channel_get_thread(ch->channel)));
+	return g_bdev_histogram_size_class_max[size_class];
+}
 
-	assert(ch->histogram == NULL);
-	if (bdev->internal.histogram_enabled) {
+static int
+bdev_channel_alloc_histograms(struct spdk_bdev_channel *ch)
+{
+	if (ch->histogram == NULL) {
 		ch->histogram = spdk_histogram_data_alloc();
 		if (ch->histogram == NULL) {
-			SPDK_ERRLOG("Could not allocate histogram\n");
+			return -ENOMEM;
 		}
 	}
 
-	mgmt_io_ch = spdk_get_io_channel(&g_bdev_mgr);
-	if (!mgmt_io_ch) {
-		spdk_put_io_channel(ch->channel);
-		spdk_put_io_channel(ch->accel_channel);
-		return -1;
+	if (ch->io_histograms == NULL) {
+		ch->io_histograms = calloc(BDEV_NUM_IO_HISTOGRAMS, sizeof(*ch->io_histograms));
+		if (ch->io_histograms == NULL) {
+			spdk_histogram_data_free(ch->histogram);
+			ch->histogram = NULL;
+			return -ENOMEM;
+		}
 	}
 
-	mgmt_ch = __io_ch_to_bdev_mgmt_ch(mgmt_io_ch);
-	TAILQ_FOREACH(shared_resource, &mgmt_ch->shared_resources, link) {
-		if (shared_resource->shared_ch == ch->channel) {
-			spdk_put_io_channel(mgmt_io_ch);
-			shared_resource->ref++;
-			break;
+	return 0;
+}
+
+static void
+bdev_channel_free_histograms(struct spdk_bdev_channel *ch)
+{
+	int i;
+
+	if (ch->io_histograms != NULL) {
+		for (i = 0; i < BDEV_NUM_IO_HISTOGRAMS; i++) {
+			spdk_histogram_data_free(ch->io_histograms[i]);
 		}
+		free(ch->io_histograms);
+		ch->io_histograms = NULL;
 	}
 
-	if (shared_resource == NULL) {
-		shared_resource = calloc(1, sizeof(*shared_resource));
-		if (shared_resource == NULL) {
-			spdk_put_io_channel(ch->channel);
-			spdk_put_io_channel(ch->accel_channel);
-			spdk_put_io_channel(mgmt_io_ch);
+	spdk_histogram_data_free(ch->histogram);
+	ch->histogram = NULL;
+}
+
+static inline enum spdk_bdev_histogram_size_class
+bdev_io_get_histogram_size_class(struct spdk_bdev_io *bdev_io)
+{
+	enum spdk_bdev_histogram_size_class size_class;
+	uint64_t size;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_COMPARE:
+	case SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE:
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+	case SPDK_BDEV_IO_TYPE_COPY:
+		size = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+		break;
+	default:
+		return SPDK_BDEV_HISTOGRAM_SIZE_4K;
+	}
+
+	for (size_class = SPDK_BDEV_HISTOGRAM_SIZE_4K; size_class < SPDK_BDEV_HISTOGRAM_SIZE_LARGE;
+	     size_class++) {
+		if (size <= g_bdev_histogram_size_class_max[size_class]) {
+			break;
+		}
+	}
+
+	return size_class;
+}
+
+static inline void
+bdev_io_tally_histograms(struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
+{
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	struct spdk_histogram_data **histogram;
+
+	spdk_histogram_data_tally(ch->histogram, tsc_diff);
+
+	histogram = &ch->io_histograms[bdev_io->type * SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES +
+				       bdev_io_get_histogram_size_class(bdev_io)];
+	if (spdk_unlikely(*histogram == NULL)) {
+		*histogram = spdk_histogram_data_alloc();
+		if (*histogram == NULL) {
+			return;
+		}
+	}
+	spdk_histogram_data_tally(*histogram, tsc_diff);
+}
+
+static int
+bdev_channel_create(void *io_device, void *ctx_buf)
+{
+	struct spdk_bdev		*bdev = __bdev_from_io_dev(io_device);
+	struct spdk_bdev_channel	*ch = ctx_buf;
+	struct spdk_io_channel		*mgmt_io_ch;
+	struct spdk_bdev_mgmt_channel	*mgmt_ch;
+	struct spdk_bdev_shared_resource *shared_resource;
+	struct lba_range		*range;
+
+	ch->bdev = bdev;
+	ch->channel = bdev->fn_table->get_io_channel(bdev->ctxt);
+	if (!ch->channel) {
+		return -1;
+	}
+
+	ch->accel_channel = spdk_accel_get_io_channel();
+	if (!ch->accel_channel) {
+		spdk_put_io_channel(ch->channel);
+		return -1;
+	}
+
+	spdk_trace_record(TRACE_BDEV_IOCH_CREATE, 0, 0, 0, ch->bdev->name,
+			  spdk_thread_get_id(spdk_io_channel_get_thread(ch->channel)));
+
+	assert(ch->histogram == NULL);
+	assert(ch->io_histograms == NULL);
+	if (bdev->internal.histogram_enabled) {
+		if (bdev_channel_alloc_histograms(ch) != 0) {
+			SPDK_ERRLOG("Could not allocate histogram\n");
+		}
+	}
+
+	mgmt_io_ch = spdk_get_io_channel(&g_bdev_mgr);
+	if (!mgmt_io_ch) {
+		spdk_put_io_channel(ch->channel);
+		spdk_put_io_channel(ch->accel_channel);
+		return -1;
+	}
+
+	mgmt_ch = __io_ch_to_bdev_mgmt_ch(mgmt_io_ch);
+	TAILQ_FOREACH(shared_resource, &mgmt_ch->shared_resources, link) {
+		if (shared_resource->shared_ch == ch->channel) {
+			spdk_put_io_channel(mgmt_io_ch);
+			shared_resource->ref++;
+			break;
+		}
+	}
+
+	if (shared_resource == NULL) {
+		shared_resource = calloc(1, sizeof(*shared_resource));
+		if (shared_resource == NULL) {
+			spdk_put_io_channel(ch->channel);
+			spdk_put_io_channel(ch->accel_channel);
+			spdk_put_io_channel(mgmt_io_ch);
 			return -1;
 		}
 
@@ -3950,6 +4955,12 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&ch->io_locked);
 	TAILQ_INIT(&ch->io_accel_exec);
 	TAILQ_INIT(&ch->io_memory_domain);
+	TAILQ_INIT(&ch->qos_queued);
+	ch->qos_poller = NULL;
+	STAILQ_INIT(&ch->coalesce_free_batches);
+	ch->coalesce_batch = NULL;
+	ch->coalesce_poller = NULL;
+	ch->coalesce_max_blocks = 0;
 
 	ch->stat = bdev_alloc_io_stat(false);
 	if (ch->stat == NULL) {
@@ -3982,6 +4993,8 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 
 	spdk_spin_lock(&bdev->internal.spinlock);
 	bdev_enable_qos(bdev, ch);
+	bdev_channel_set_coalescing(ch, bdev->internal.coalesce.window_us,
+				    bdev->internal.coalesce.max_size);
 
 	TAILQ_FOREACH(range, &bdev->internal.locked_ranges, tailq) {
 		struct lba_range *new_range;
@@ -4195,6 +5208,8 @@ spdk_bdev_add_io_stat(struct spdk_bdev_io_stat *total, struct spdk_bdev_io_stat
 	total->write_latency_ticks += add->write_latency_ticks;
 	total->unmap_latency_ticks += add->unmap_latency_ticks;
 	total->copy_latency_ticks += add->copy_latency_ticks;
+	total->num_coalesced_write_ops += add->num_coalesced_write_ops;
+	total->num_coalesced_write_batches += add->num_coalesced_write_batches;
 	if (total->max_read_latency_ticks < add->max_read_latency_ticks) {
 		total->max_read_latency_ticks = add->max_read_latency_ticks;
 	}
@@ -4260,6 +5275,8 @@ spdk_bdev_reset_io_stat(struct spdk_bdev_io_stat *stat, enum spdk_bdev_reset_sta
 	stat->write_latency_ticks = 0;
 	stat->unmap_latency_ticks = 0;
 	stat->copy_latency_ticks = 0;
+	stat->num_coalesced_write_ops = 0;
+	stat->num_coalesced_write_batches = 0;
 
 	if (stat->io_error != NULL) {
 		memset(stat->io_error, 0, sizeof(struct spdk_bdev_io_error_stat));
@@ -4333,6 +5350,9 @@ spdk_bdev_dump_io_stat_json(struct spdk_bdev_io_stat *stat, struct spdk_json_wri
 	spdk_json_write_named_uint64(w, "min_copy_latency_ticks",
 				     stat->min_copy_latency_ticks != UINT64_MAX ?
 				     stat->min_copy_latency_ticks : 0);
+	spdk_json_write_named_uint64(w, "num_coalesced_write_ops", stat->num_coalesced_write_ops);
+	spdk_json_write_named_uint64(w, "num_coalesced_write_batches",
+				     stat->num_coalesced_write_batches);
 
 	if (stat->io_error != NULL) {
 		spdk_json_write_named_object_begin(w, "io_error");
@@ -4352,8 +5372,11 @@ bdev_channel_abort_queued_ios(struct spdk_bdev_channel *ch)
 	struct spdk_bdev_shared_resource *shared_resource = ch->shared_resource;
 	struct spdk_bdev_mgmt_channel *mgmt_ch = shared_resource->mgmt_ch;
 
+	bdev_coalesce_abort(ch);
 	bdev_abort_all_queued_io(&shared_resource->nomem_io, ch);
 	bdev_abort_all_buf_io(mgmt_ch, ch);
+	bdev_abort_all_queued_io(&ch->qos_queued, ch);
+	spdk_poller_unregister(&ch->qos_poller);
 }
 
 static void
@@ -4376,9 +5399,7 @@ bdev_channel_destroy(void *io_device, void *ctx_buf)
 
 	bdev_channel_abort_queued_ios(ch);
 
-	if (ch->histogram) {
-		spdk_histogram_data_free(ch->histogram);
-	}
+	bdev_channel_free_histograms(ch);
 
 	bdev_channel_destroy_resource(ch);
 }
@@ -4589,6 +5610,25 @@ spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits)
 	spdk_spin_unlock(&bdev->internal.spinlock);
 }
 
+void
+spdk_bdev_get_qos_achieved_rates(struct spdk_bdev *bdev, uint64_t *rates)
+{
+	int i;
+
+	memset(rates, 0, sizeof(*rates) * SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos) {
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (bdev->internal.qos->rate_limits[i].limit !=
+			    SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+				rates[i] = bdev->internal.qos->rate_limits[i].achieved_rate;
+			}
+		}
+	}
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
 size_t
 spdk_bdev_get_buf_align(const struct spdk_bdev *bdev)
 {
@@ -6254,9 +7294,11 @@ bdev_reset_freeze_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 		spdk_spin_unlock(&channel->bdev->internal.spinlock);
 	}
 
+	bdev_coalesce_abort(channel);
 	bdev_abort_all_queued_io(&shared_resource->nomem_io, channel);
 	bdev_abort_all_buf_io(mgmt_channel, channel);
 	bdev_abort_all_queued_io(&tmp_queued, channel);
+	bdev_abort_all_queued_io(&channel->qos_queued, channel);
 
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
@@ -6984,7 +8026,7 @@ bdev_io_complete(void *ctx)
 	TAILQ_REMOVE(&bdev_ch->io_submitted, bdev_io, internal.ch_link);
 
 	if (bdev_io->internal.ch->histogram) {
-		spdk_histogram_data_tally(bdev_io->internal.ch->histogram, tsc_diff);
+		bdev_io_tally_histograms(bdev_io, tsc_diff);
 	}
 
 	bdev_io_update_io_stat(bdev_io, tsc_diff);
@@ -7488,6 +8530,9 @@ bdev_destroy_cb(void *io_device)
 	cb_arg = bdev->internal.unregister_ctx;
 
 	spdk_spin_destroy(&bdev->internal.spinlock);
+	if (bdev->internal.qos != NULL && bdev->internal.qos->group != NULL) {
+		bdev_qos_group_put(bdev->internal.qos->group);
+	}
 	free(bdev->internal.qos);
 	bdev_free_io_stat(bdev->internal.stat);
 
@@ -8697,9 +9742,18 @@ bdev_disable_qos_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 		     struct spdk_io_channel *ch, void *_ctx)
 {
 	struct spdk_bdev_channel *bdev_ch = __io_ch_to_bdev_ch(ch);
+	struct spdk_bdev_io *bdev_io;
 
 	bdev_ch->flags &= ~BDEV_CH_QOS_ENABLED;
 
+	/* Resubmit the I/O that was waiting for quota in distributed mode */
+	spdk_poller_unregister(&bdev_ch->qos_poller);
+	while (!TAILQ_EMPTY(&bdev_ch->qos_queued)) {
+		bdev_io = TAILQ_FIRST(&bdev_ch->qos_queued);
+		TAILQ_REMOVE(&bdev_ch->qos_queued, bdev_io, internal.link);
+		_bdev_io_submit(bdev_io);
+	}
+
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
 
@@ -8847,7 +9901,19 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 					     bdev_update_qos_rate_limit_msg, ctx);
 		}
 	} else {
-		if (bdev->internal.qos != NULL) {
+		if (bdev->internal.qos != NULL && bdev->internal.qos->group != NULL) {
+			/* QoS stays enabled, the bdev is still limited by its group */
+			bdev_set_qos_rate_limits(bdev, limits);
+
+			if (bdev->internal.qos->thread != NULL) {
+				spdk_thread_send_msg(bdev->internal.qos->thread,
+						     bdev_update_qos_rate_limit_msg, ctx);
+			} else {
+				spdk_spin_unlock(&bdev->internal.spinlock);
+				bdev_set_qos_limit_done(ctx, 0);
+				return;
+			}
+		} else if (bdev->internal.qos != NULL) {
 			bdev_set_qos_rate_limits(bdev, limits);
 
 			/* Disabling */
@@ -8863,6 +9929,499 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 	spdk_spin_unlock(&bdev->internal.spinlock);
 }
 
+static void
+bdev_set_write_coalescing_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+			      struct spdk_io_channel *ch, void *_ctx)
+{
+	struct set_write_coalescing_ctx *ctx = _ctx;
+
+	bdev_channel_set_coalescing(__io_ch_to_bdev_ch(ch), ctx->window_us, ctx->max_size);
+	spdk_bdev_for_each_channel_continue(i, 0);
+}
+
+static void
+bdev_set_write_coalescing_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct set_write_coalescing_ctx *ctx = _ctx;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	bdev->internal.coalesce.mod_in_progress = false;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	if (ctx->cb_fn) {
+		ctx->cb_fn(ctx->cb_arg, status);
+	}
+	free(ctx);
+}
+
+void
+spdk_bdev_set_write_coalescing(struct spdk_bdev *bdev, uint64_t window_us, uint32_t max_size,
+			       void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_write_coalescing_ctx *ctx;
+
+	if (window_us != 0 && max_size < 2 * spdk_bdev_get_block_size(bdev)) {
+		SPDK_ERRLOG("Coalesced write size %" PRIu32 " is smaller than two blocks of bdev %s\n",
+			    max_size, bdev->name);
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->window_us = window_us;
+	ctx->max_size = max_size;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.coalesce.mod_in_progress) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+	bdev->internal.coalesce.mod_in_progress = true;
+	bdev->internal.coalesce.window_us = window_us;
+	bdev->internal.coalesce.max_size = window_us != 0 ? max_size : 0;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	spdk_bdev_for_each_channel(bdev, bdev_set_write_coalescing_msg, ctx,
+				   bdev_set_write_coalescing_done);
+}
+
+static struct bdev_qos_group *
+bdev_qos_group_find(const char *name)
+{
+	struct bdev_qos_group *group;
+
+	TAILQ_FOREACH(group, &g_bdev_qos_groups.groups, link) {
+		if (strcmp(group->name, name) == 0) {
+			return group;
+		}
+	}
+
+	return NULL;
+}
+
+int
+bdev_qos_group_create(const char *name, const char *parent_name, const uint64_t *limits,
+		      const uint64_t *reservations, uint32_t weight)
+{
+	struct bdev_qos_group *group, *parent = NULL, *sibling;
+	uint64_t reserved, min_per_sec;
+	int i, rc = 0;
+
+	if (name == NULL || name[0] == '\0' || weight == 0) {
+		return -EINVAL;
+	}
+
+	group = calloc(1, sizeof(*group));
+	if (group == NULL) {
+		return -ENOMEM;
+	}
+
+	group->name = strdup(name);
+	if (group->name == NULL) {
+		free(group);
+		return -ENOMEM;
+	}
+
+	group->weight = weight;
+	TAILQ_INIT(&group->children);
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		min_per_sec = bdev_qos_is_iops_rate_limit(i) ? SPDK_BDEV_QOS_MIN_IOS_PER_SEC :
+			      SPDK_BDEV_QOS_MIN_BYTES_PER_SEC;
+
+		/* Like the bdev rate limits, round up to what a timeslice can express */
+		group->rate_limits[i].limit = spdk_divide_round_up(limits ? limits[i] : 0,
+					      min_per_sec) * min_per_sec;
+		group->rate_limits[i].reservation = spdk_divide_round_up(reservations ? reservations[i] : 0,
+						    min_per_sec) * min_per_sec;
+		group->rate_limits[i].share = INT64_MAX;
+
+		if (group->rate_limits[i].limit != 0 &&
+		    group->rate_limits[i].reservation > group->rate_limits[i].limit) {
+			SPDK_ERRLOG("Reservation of QoS group %s exceeds its limit\n", name);
+			rc = -EINVAL;
+			goto err;
+		}
+	}
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	if (bdev_qos_group_find(name) != NULL) {
+		SPDK_ERRLOG("QoS group %s already exists\n", name);
+		rc = -EEXIST;
+		goto err_unlock;
+	}
+
+	if (parent_name != NULL) {
+		parent = bdev_qos_group_find(parent_name);
+		if (parent == NULL) {
+			SPDK_ERRLOG("QoS group %s does not exist\n", parent_name);
+			rc = -ENODEV;
+			goto err_unlock;
+		}
+
+		/* Bdevs can only join the leaf groups */
+		if (parent->num_bdevs != 0) {
+			SPDK_ERRLOG("QoS group %s has bdevs, it cannot have child groups\n", parent_name);
+			rc = -EBUSY;
+			goto err_unlock;
+		}
+
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (parent->rate_limits[i].limit == 0) {
+				continue;
+			}
+
+			reserved = group->rate_limits[i].reservation;
+			TAILQ_FOREACH(sibling, &parent->children, child_link) {
+				reserved += sibling->rate_limits[i].reservation;
+			}
+			if (reserved > parent->rate_limits[i].limit) {
+				SPDK_ERRLOG("Reservations of QoS group %s children exceed its limit\n",
+					    parent_name);
+				rc = -EINVAL;
+				goto err_unlock;
+			}
+		}
+
+		TAILQ_INSERT_TAIL(&parent->children, group, child_link);
+	}
+
+	group->parent = parent;
+	TAILQ_INSERT_TAIL(&g_bdev_qos_groups.groups, group, link);
+
+	/* Hand out the shares again at the next I/O, taking the new group into account */
+	g_bdev_qos_groups.timeslice_size =
+		SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	__atomic_store_n(&g_bdev_qos_groups.last_timeslice, 0, __ATOMIC_RELAXED);
+	if (g_bdev_qos_groups.rate_tsc == 0) {
+		g_bdev_qos_groups.rate_tsc = spdk_get_ticks();
+	}
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+
+	return 0;
+
+err_unlock:
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+err:
+	free(group->name);
+	free(group);
+	return rc;
+}
+
+int
+bdev_qos_group_delete(const char *name)
+{
+	struct bdev_qos_group *group;
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	group = bdev_qos_group_find(name);
+	if (group == NULL) {
+		spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+		return -ENODEV;
+	}
+
+	if (group->num_bdevs != 0 || !TAILQ_EMPTY(&group->children)) {
+		spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+		SPDK_ERRLOG("QoS group %s still has bdevs or child groups\n", name);
+		return -EBUSY;
+	}
+
+	if (group->parent != NULL) {
+		TAILQ_REMOVE(&group->parent->children, group, child_link);
+	}
+	TAILQ_REMOVE(&g_bdev_qos_groups.groups, group, link);
+	__atomic_store_n(&g_bdev_qos_groups.last_timeslice, 0, __ATOMIC_RELAXED);
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+
+	free(group->name);
+	free(group);
+
+	return 0;
+}
+
+void
+bdev_qos_group_add_bdev(struct spdk_bdev *bdev, const char *group_name,
+			void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx *ctx;
+	struct bdev_qos_group *group;
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	group = bdev_qos_group_find(group_name);
+	if (group == NULL || !TAILQ_EMPTY(&group->children)) {
+		spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+		SPDK_ERRLOG("QoS group %s does not exist or is not a leaf group\n", group_name);
+		free(ctx);
+		cb_fn(cb_arg, group == NULL ? -ENODEV : -EINVAL);
+		return;
+	}
+	/* Taking the reference first keeps child groups from being created meanwhile */
+	group->num_bdevs++;
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos_mod_in_progress ||
+	    (bdev->internal.qos != NULL && bdev->internal.qos->group != NULL)) {
+		rc = bdev->internal.qos_mod_in_progress ? -EAGAIN : -EBUSY;
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		bdev_qos_group_put(group);
+		free(ctx);
+		cb_fn(cb_arg, rc);
+		return;
+	}
+	bdev->internal.qos_mod_in_progress = true;
+
+	if (bdev->internal.qos == NULL) {
+		/* Rate limits that are not set are not enforced on the bdev itself */
+		bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+		if (!bdev->internal.qos) {
+			spdk_spin_unlock(&bdev->internal.spinlock);
+			SPDK_ERRLOG("Unable to allocate memory for QoS tracking\n");
+			bdev_qos_group_put(group);
+			bdev_set_qos_limit_done(ctx, -ENOMEM);
+			return;
+		}
+	}
+
+	bdev->internal.qos->group = group;
+
+	if (bdev->internal.qos->thread == NULL) {
+		spdk_bdev_for_each_channel(bdev, bdev_enable_qos_msg, ctx,
+					   bdev_enable_qos_done);
+		spdk_spin_unlock(&bdev->internal.spinlock);
+	} else {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		bdev_set_qos_limit_done(ctx, 0);
+	}
+}
+
+static void
+bdev_qos_group_detach_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+			  struct spdk_io_channel *ch, void *_ctx)
+{
+	/* Once the channel's thread gets here, none of its I/O refers to the group anymore */
+	spdk_bdev_for_each_channel_continue(i, 0);
+}
+
+static void
+bdev_qos_group_detach_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct set_qos_limit_ctx *ctx = _ctx;
+	int i;
+
+	bdev_qos_group_put(ctx->group);
+	ctx->group = NULL;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (bdev->internal.qos->rate_limits[i].limit != 0 &&
+		    bdev->internal.qos->rate_limits[i].limit != SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			break;
+		}
+	}
+
+	if (i == SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		/* The bdev has no rate limits of its own, disable QoS */
+		spdk_bdev_for_each_channel(bdev, bdev_disable_qos_msg, ctx,
+					   bdev_disable_qos_msg_done);
+		spdk_spin_unlock(&bdev->internal.spinlock);
+	} else {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		bdev_set_qos_limit_done(ctx, 0);
+	}
+}
+
+void
+bdev_qos_group_remove_bdev(struct spdk_bdev *bdev,
+			   void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos_mod_in_progress) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	if (bdev->internal.qos == NULL || bdev->internal.qos->group == NULL) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, -ENOENT);
+		return;
+	}
+	bdev->internal.qos_mod_in_progress = true;
+
+	ctx->group = bdev->internal.qos->group;
+	bdev->internal.qos->group = NULL;
+
+	/* I/O may still be admitted against the group on the channels' threads */
+	spdk_bdev_for_each_channel(bdev, bdev_qos_group_detach_msg, ctx,
+				   bdev_qos_group_detach_done);
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+static void
+bdev_qos_group_write_limit(struct spdk_json_write_ctx *w, const char *name, uint64_t value, int i)
+{
+	if (bdev_qos_is_iops_rate_limit(i) == false) {
+		/* Bandwidth is set and reported in megabytes */
+		value /= 1024 * 1024;
+	}
+
+	spdk_json_write_named_uint64(w, name, value);
+}
+
+static void
+bdev_qos_group_dump_info(struct bdev_qos_group *group, struct spdk_json_write_ctx *w)
+{
+	struct bdev_qos_group_limit *limit;
+	struct spdk_bdev *bdev;
+	double achieved;
+	int i;
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", group->name);
+	if (group->parent != NULL) {
+		spdk_json_write_named_string(w, "parent", group->parent->name);
+	}
+	spdk_json_write_named_uint32(w, "weight", group->weight);
+	spdk_json_write_named_uint64(w, "throttled",
+				     __atomic_load_n(&group->throttled, __ATOMIC_RELAXED));
+
+	spdk_json_write_named_array_begin(w, "bdevs");
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	TAILQ_FOREACH(bdev, &g_bdev_mgr.bdevs, internal.link) {
+		if (bdev->internal.qos != NULL && bdev->internal.qos->group == group) {
+			spdk_json_write_string(w, bdev->name);
+		}
+	}
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+	spdk_json_write_array_end(w);
+
+	spdk_json_write_named_object_begin(w, "rate_limits");
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = &group->rate_limits[i];
+
+		achieved = limit->achieved_rate;
+		if (bdev_qos_is_iops_rate_limit(i) == false) {
+			achieved /= 1024 * 1024;
+		}
+
+		spdk_json_write_named_object_begin(w, qos_rpc_type[i]);
+		bdev_qos_group_write_limit(w, "limit", limit->limit, i);
+		bdev_qos_group_write_limit(w, "reservation", limit->reservation, i);
+		if (limit->share != INT64_MAX) {
+			/* The share of the current timeslice, as a rate */
+			bdev_qos_group_write_limit(w, "share", limit->share * SPDK_SEC_TO_USEC /
+						   SPDK_BDEV_QOS_TIMESLICE_IN_USEC, i);
+		}
+		spdk_json_write_named_double(w, "achieved", achieved);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
+static void
+bdev_qos_groups_config_json(struct spdk_json_write_ctx *w)
+{
+	struct bdev_qos_group *group;
+	char name[32];
+	int i;
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	/* Parents are always created before their children */
+	TAILQ_FOREACH(group, &g_bdev_qos_groups.groups, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_qos_group_create");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", group->name);
+		if (group->parent != NULL) {
+			spdk_json_write_named_string(w, "parent", group->parent->name);
+		}
+		spdk_json_write_named_uint32(w, "weight", group->weight);
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (group->rate_limits[i].limit != 0) {
+				bdev_qos_group_write_limit(w, qos_rpc_type[i], group->rate_limits[i].limit, i);
+			}
+			if (group->rate_limits[i].reservation != 0) {
+				snprintf(name, sizeof(name), "reserved_%s", qos_rpc_type[i]);
+				bdev_qos_group_write_limit(w, name, group->rate_limits[i].reservation, i);
+			}
+		}
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+}
+
+bool
+bdev_qos_group_exists(const char *name)
+{
+	bool exists;
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	exists = bdev_qos_group_find(name) != NULL;
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+
+	return exists;
+}
+
+void
+bdev_qos_group_dump_info_json(const char *name, struct spdk_json_write_ctx *w)
+{
+	struct bdev_qos_group *group;
+
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	if (!TAILQ_EMPTY(&g_bdev_qos_groups.groups)) {
+		/* Refresh the achieved rates of idle groups */
+		bdev_qos_groups_update(spdk_get_ticks());
+	}
+
+	spdk_json_write_array_begin(w);
+	TAILQ_FOREACH(group, &g_bdev_qos_groups.groups, link) {
+		if (name == NULL || strcmp(group->name, name) == 0) {
+			bdev_qos_group_dump_info(group, w);
+		}
+	}
+	spdk_json_write_array_end(w);
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+}
+
 struct spdk_bdev_histogram_ctx {
 	spdk_bdev_histogram_status_cb cb_fn;
 	void *cb_arg;
@@ -8888,10 +10447,7 @@ bdev_histogram_disable_channel(struct spdk_bdev_channel_iter *i, struct spdk_bde
 {
 	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
 
-	if (ch->histogram != NULL) {
-		spdk_histogram_data_free(ch->histogram);
-		ch->histogram = NULL;
-	}
+	bdev_channel_free_histograms(ch);
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
 
@@ -8919,14 +10475,9 @@ bdev_histogram_enable_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev
 			      struct spdk_io_channel *_ch, void *_ctx)
 {
 	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
-	int status = 0;
+	int status;
 
-	if (ch->histogram == NULL) {
-		ch->histogram = spdk_histogram_data_alloc();
-		if (ch->histogram == NULL) {
-			status = -ENOMEM;
-		}
-	}
+	status = bdev_channel_alloc_histograms(ch);
 
 	spdk_bdev_for_each_channel_continue(i, status);
 }
@@ -9043,6 +10594,90 @@ spdk_bdev_channel_get_histogram(struct spdk_io_channel *ch, spdk_bdev_histogram_
 	cb_fn(cb_arg, status, bdev_ch->histogram);
 }
 
+struct spdk_bdev_histogram_classes_ctx {
+	spdk_bdev_histogram_classes_cb cb_fn;
+	void *cb_arg;
+	bool reset;
+	/** merged histogram data from all channels */
+	struct spdk_histogram_data *histograms[SPDK_BDEV_NUM_IO_TYPES][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES];
+};
+
+static void
+bdev_histogram_get_classes_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct spdk_bdev_histogram_classes_ctx *ctx = _ctx;
+	int type, size_class;
+
+	ctx->cb_fn(ctx->cb_arg, status, ctx->histograms);
+
+	for (type = 0; type < SPDK_BDEV_NUM_IO_TYPES; type++) {
+		for (size_class = 0; size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size_class++) {
+			spdk_histogram_data_free(ctx->histograms[type][size_class]);
+		}
+	}
+	free(ctx);
+}
+
+static void
+bdev_histogram_get_classes_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+				   struct spdk_io_channel *_ch, void *_ctx)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+	struct spdk_bdev_histogram_classes_ctx *ctx = _ctx;
+	struct spdk_histogram_data *histogram, **merged;
+	int type, size_class;
+
+	if (ch->io_histograms == NULL) {
+		spdk_bdev_for_each_channel_continue(i, -EFAULT);
+		return;
+	}
+
+	for (type = 0; type < SPDK_BDEV_NUM_IO_TYPES; type++) {
+		for (size_class = 0; size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size_class++) {
+			histogram = ch->io_histograms[type * SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES + size_class];
+			if (histogram == NULL) {
+				continue;
+			}
+
+			merged = &ctx->histograms[type][size_class];
+			if (*merged == NULL) {
+				*merged = spdk_histogram_data_alloc();
+				if (*merged == NULL) {
+					spdk_bdev_for_each_channel_continue(i, -ENOMEM);
+					return;
+				}
+			}
+
+			spdk_histogram_data_merge(*merged, histogram);
+			if (ctx->reset) {
+				spdk_histogram_data_reset(histogram);
+			}
+		}
+	}
+
+	spdk_bdev_for_each_channel_continue(i, 0);
+}
+
+void
+spdk_bdev_histogram_get_classes(struct spdk_bdev *bdev, bool reset,
+				spdk_bdev_histogram_classes_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev_histogram_classes_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM, NULL);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->reset = reset;
+
+	spdk_bdev_for_each_channel(bdev, bdev_histogram_get_classes_channel, ctx,
+				   bdev_histogram_get_classes_done);
+}
+
 size_t
 spdk_bdev_get_media_events(struct spdk_bdev_desc *desc, struct spdk_bdev_media_event *events,
 			   size_t max_events)
@@ -9249,6 +10884,8 @@ bdev_lock_lba_range_get_channel(struct spdk_bdev_channel_iter *i, struct spdk_bd
 		 */
 		ctx->owner_range = range;
 	}
+	/* Submit any held back writes now, so that they are waited for like any other I/O. */
+	bdev_coalesce_flush(ch);
 	TAILQ_INSERT_TAIL(&ch->locked_ranges, range, tailq);
 	bdev_lock_lba_range_check_io(i);
 }
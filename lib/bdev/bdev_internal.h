@@ -31,4 +31,20 @@ typedef void (*bdev_reset_device_stat_cb)(struct spdk_bdev *bdev, void *cb_arg,
 void bdev_reset_device_stat(struct spdk_bdev *bdev, enum spdk_bdev_reset_stat_mode mode,
 			    bdev_reset_device_stat_cb cb, void *cb_arg);
 
+struct spdk_json_write_ctx;
+
+/*
+ * QoS groups share one budget between the bdevs that join them.  Rates are given in IOs or bytes
+ * per second, indexed by enum spdk_bdev_qos_rate_limit_type, with 0 meaning no limit.
+ */
+int bdev_qos_group_create(const char *name, const char *parent_name, const uint64_t *limits,
+			  const uint64_t *reservations, uint32_t weight);
+int bdev_qos_group_delete(const char *name);
+void bdev_qos_group_add_bdev(struct spdk_bdev *bdev, const char *group_name,
+			     void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+void bdev_qos_group_remove_bdev(struct spdk_bdev *bdev,
+				void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+bool bdev_qos_group_exists(const char *name);
+void bdev_qos_group_dump_info_json(const char *name, struct spdk_json_write_ctx *w);
+
 #endif /* SPDK_BDEV_INTERNAL_H */
@@ -27,12 +27,14 @@ struct spdk_rpc_set_bdev_opts {
 	uint32_t bdev_io_pool_size;
 	uint32_t bdev_io_cache_size;
 	bool bdev_auto_examine;
+	bool qos_distributed;
 };
 
 static const struct spdk_json_object_decoder rpc_set_bdev_opts_decoders[] = {
 	{"bdev_io_pool_size", offsetof(struct spdk_rpc_set_bdev_opts, bdev_io_pool_size), spdk_json_decode_uint32, true},
 	{"bdev_io_cache_size", offsetof(struct spdk_rpc_set_bdev_opts, bdev_io_cache_size), spdk_json_decode_uint32, true},
 	{"bdev_auto_examine", offsetof(struct spdk_rpc_set_bdev_opts, bdev_auto_examine), spdk_json_decode_bool, true},
+	{"qos_distributed", offsetof(struct spdk_rpc_set_bdev_opts, qos_distributed), spdk_json_decode_bool, true},
 };
 
 static void
@@ -45,6 +47,7 @@ rpc_bdev_set_options(struct spdk_jsonrpc_request *request, const struct spdk_jso
 	rpc_opts.bdev_io_pool_size = UINT32_MAX;
 	rpc_opts.bdev_io_cache_size = UINT32_MAX;
 	rpc_opts.bdev_auto_examine = true;
+	rpc_opts.qos_distributed = false;
 
 	if (params != NULL) {
 		if (spdk_json_decode_object(params, rpc_set_bdev_opts_decoders,
@@ -64,6 +67,7 @@ rpc_bdev_set_options(struct spdk_jsonrpc_request *request, const struct spdk_jso
 		bdev_opts.bdev_io_cache_size = rpc_opts.bdev_io_cache_size;
 	}
 	bdev_opts.bdev_auto_examine = rpc_opts.bdev_auto_examine;
+	bdev_opts.qos_distributed = rpc_opts.qos_distributed;
 
 	rc = spdk_bdev_set_opts(&bdev_opts);
 
@@ -1050,6 +1054,478 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_set_qos_limit", rpc_bdev_set_qos_limit, SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_get_qos_stats {
+	char *name;
+};
+
+static void
+free_rpc_bdev_get_qos_stats(struct rpc_bdev_get_qos_stats *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_get_qos_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_get_qos_stats, name), spdk_json_decode_string, true},
+};
+
+static int
+rpc_dump_bdev_qos_stats(void *ctx, struct spdk_bdev *bdev)
+{
+	struct spdk_json_write_ctx *w = ctx;
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	uint64_t rates[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	double achieved;
+	int i;
+
+	spdk_bdev_get_qos_rate_limits(bdev, limits);
+	spdk_bdev_get_qos_achieved_rates(bdev, rates);
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (limits[i] != 0) {
+			break;
+		}
+	}
+	if (i == SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		/* No rate limits on this bdev */
+		return 0;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(bdev));
+	spdk_json_write_named_object_begin(w, "rate_limits");
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (limits[i] == 0) {
+			continue;
+		}
+
+		achieved = rates[i];
+		if (i != SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT) {
+			/* Report the bandwidth in megabytes, like the limit */
+			achieved /= 1024 * 1024;
+		}
+
+		spdk_json_write_named_object_begin(w, spdk_bdev_get_qos_rpc_type(i));
+		spdk_json_write_named_uint64(w, "limit", limits[i]);
+		spdk_json_write_named_double(w, "achieved", achieved);
+		spdk_json_write_named_double(w, "accuracy", achieved * 100 / limits[i]);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_object_end(w);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static void
+rpc_bdev_get_qos_stats(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_qos_stats req = {};
+	struct spdk_json_write_ctx *w;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_bdev_opts opts;
+	int rc;
+
+	if (params && spdk_json_decode_object(params, rpc_bdev_get_qos_stats_decoders,
+					      SPDK_COUNTOF(rpc_bdev_get_qos_stats_decoders),
+					      &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	if (req.name) {
+		rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+			spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+			goto cleanup;
+		}
+	}
+
+	spdk_bdev_get_opts(&opts, sizeof(opts));
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_bool(w, "distributed", opts.qos_distributed);
+	spdk_json_write_named_array_begin(w, "bdevs");
+	if (desc != NULL) {
+		rpc_dump_bdev_qos_stats(w, spdk_bdev_desc_get_bdev(desc));
+		spdk_bdev_close(desc);
+	} else {
+		spdk_for_each_bdev(w, rpc_dump_bdev_qos_stats);
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_get_qos_stats(&req);
+}
+SPDK_RPC_REGISTER("bdev_get_qos_stats", rpc_bdev_get_qos_stats, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_qos_group_create {
+	char		*name;
+	char		*parent;
+	uint32_t	weight;
+	uint64_t	limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	uint64_t	reservations[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+};
+
+static void
+free_rpc_bdev_qos_group_create(struct rpc_bdev_qos_group_create *r)
+{
+	free(r->name);
+	free(r->parent);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_create_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_create, name), spdk_json_decode_string},
+	{"parent", offsetof(struct rpc_bdev_qos_group_create, parent), spdk_json_decode_string, true},
+	{"weight", offsetof(struct rpc_bdev_qos_group_create, weight), spdk_json_decode_uint32, true},
+	{
+		"rw_ios_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					   limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"rw_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					      limits[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"r_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					     limits[SPDK_BDEV_QOS_R_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"w_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+					     limits[SPDK_BDEV_QOS_W_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"reserved_rw_ios_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+						    reservations[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"reserved_rw_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+						       reservations[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"reserved_r_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+						      reservations[SPDK_BDEV_QOS_R_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+	{
+		"reserved_w_mbytes_per_sec", offsetof(struct rpc_bdev_qos_group_create,
+						      reservations[SPDK_BDEV_QOS_W_BPS_RATE_LIMIT]),
+		spdk_json_decode_uint64, true
+	},
+};
+
+static void
+rpc_bdev_qos_group_create(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_create req = {.weight = 1};
+	int i, rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_create_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (i != SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT) {
+			/* Change from megabyte to byte rate limit */
+			req.limits[i] *= 1024 * 1024;
+			req.reservations[i] *= 1024 * 1024;
+		}
+	}
+
+	rc = bdev_qos_group_create(req.name, req.parent, req.limits, req.reservations, req.weight);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_qos_group_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_create", rpc_bdev_qos_group_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_qos_group_delete {
+	char *name;
+};
+
+static void
+free_rpc_bdev_qos_group_delete(struct rpc_bdev_qos_group_delete *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_delete_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_delete, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_qos_group_delete(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_delete req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_delete_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_qos_group_delete(req.name);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_qos_group_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_delete", rpc_bdev_qos_group_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_qos_group_bdev {
+	char *name;
+	char *group;
+};
+
+static void
+free_rpc_bdev_qos_group_bdev(struct rpc_bdev_qos_group_bdev *r)
+{
+	free(r->name);
+	free(r->group);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_add_bdev_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_bdev, name), spdk_json_decode_string},
+	{"group", offsetof(struct rpc_bdev_qos_group_bdev, group), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_qos_group_bdev_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(request, status, spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_qos_group_add_bdev(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_bdev req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_add_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_add_bdev_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	bdev_qos_group_add_bdev(spdk_bdev_desc_get_bdev(desc), req.group,
+				rpc_bdev_qos_group_bdev_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_qos_group_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_add_bdev", rpc_bdev_qos_group_add_bdev, SPDK_RPC_RUNTIME)
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_remove_bdev_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_bdev, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_qos_group_remove_bdev(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_bdev req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_remove_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_remove_bdev_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	bdev_qos_group_remove_bdev(spdk_bdev_desc_get_bdev(desc),
+				   rpc_bdev_qos_group_bdev_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_qos_group_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_remove_bdev", rpc_bdev_qos_group_remove_bdev, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_qos_group_get_stats {
+	char *name;
+};
+
+static void
+free_rpc_bdev_qos_group_get_stats(struct rpc_bdev_qos_group_get_stats *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_qos_group_get_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_qos_group_get_stats, name), spdk_json_decode_string, true},
+};
+
+static void
+rpc_bdev_qos_group_get_stats(struct spdk_jsonrpc_request *request,
+			     const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_get_stats req = {};
+	struct spdk_json_write_ctx *w;
+
+	if (params && spdk_json_decode_object(params, rpc_bdev_qos_group_get_stats_decoders,
+					      SPDK_COUNTOF(rpc_bdev_qos_group_get_stats_decoders),
+					      &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	/* Groups are only created and deleted by RPCs, so the group cannot go away meanwhile */
+	if (req.name != NULL && !bdev_qos_group_exists(req.name)) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	bdev_qos_group_dump_info_json(req.name, w);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_qos_group_get_stats(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_get_stats", rpc_bdev_qos_group_get_stats, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_set_write_coalescing {
+	char		*name;
+	uint64_t	window_us;
+	uint32_t	max_size_kb;
+};
+
+static void
+free_rpc_bdev_set_write_coalescing(struct rpc_bdev_set_write_coalescing *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_set_write_coalescing_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_write_coalescing, name), spdk_json_decode_string},
+	{"window_us", offsetof(struct rpc_bdev_set_write_coalescing, window_us), spdk_json_decode_uint64},
+	{"max_size_kb", offsetof(struct rpc_bdev_set_write_coalescing, max_size_kb), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_set_write_coalescing_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to configure write coalescing: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_set_write_coalescing(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_write_coalescing req = {.max_size_kb = 128};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_write_coalescing_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_write_coalescing_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	if (req.max_size_kb > UINT32_MAX / 1024) {
+		spdk_jsonrpc_send_error_response(request, -EINVAL, "max_size_kb is too large");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_set_write_coalescing(spdk_bdev_desc_get_bdev(desc), req.window_us,
+				       req.max_size_kb * 1024,
+				       rpc_bdev_set_write_coalescing_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_set_write_coalescing(&req);
+}
+SPDK_RPC_REGISTER("bdev_set_write_coalescing", rpc_bdev_set_write_coalescing, SPDK_RPC_RUNTIME)
+
 /* SPDK_RPC_ENABLE_BDEV_HISTOGRAM */
 
 struct rpc_bdev_enable_histogram_request {
@@ -1218,3 +1694,169 @@ cleanup:
 }
 
 SPDK_RPC_REGISTER("bdev_get_histogram", rpc_bdev_get_histogram, SPDK_RPC_RUNTIME)
+
+static const char *g_rpc_bdev_io_type_names[SPDK_BDEV_NUM_IO_TYPES] = {
+	[SPDK_BDEV_IO_TYPE_INVALID] = "invalid",
+	[SPDK_BDEV_IO_TYPE_READ] = "read",
+	[SPDK_BDEV_IO_TYPE_WRITE] = "write",
+	[SPDK_BDEV_IO_TYPE_UNMAP] = "unmap",
+	[SPDK_BDEV_IO_TYPE_FLUSH] = "flush",
+	[SPDK_BDEV_IO_TYPE_RESET] = "reset",
+	[SPDK_BDEV_IO_TYPE_NVME_ADMIN] = "nvme_admin",
+	[SPDK_BDEV_IO_TYPE_NVME_IO] = "nvme_io",
+	[SPDK_BDEV_IO_TYPE_NVME_IO_MD] = "nvme_io_md",
+	[SPDK_BDEV_IO_TYPE_WRITE_ZEROES] = "write_zeroes",
+	[SPDK_BDEV_IO_TYPE_ZCOPY] = "zcopy",
+	[SPDK_BDEV_IO_TYPE_GET_ZONE_INFO] = "get_zone_info",
+	[SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT] = "zone_management",
+	[SPDK_BDEV_IO_TYPE_ZONE_APPEND] = "zone_append",
+	[SPDK_BDEV_IO_TYPE_COMPARE] = "compare",
+	[SPDK_BDEV_IO_TYPE_COMPARE_AND_WRITE] = "compare_and_write",
+	[SPDK_BDEV_IO_TYPE_ABORT] = "abort",
+	[SPDK_BDEV_IO_TYPE_SEEK_HOLE] = "seek_hole",
+	[SPDK_BDEV_IO_TYPE_SEEK_DATA] = "seek_data",
+	[SPDK_BDEV_IO_TYPE_COPY] = "copy",
+};
+
+static const char *g_rpc_bdev_histogram_size_class_names[SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES] = {
+	[SPDK_BDEV_HISTOGRAM_SIZE_4K] = "4k",
+	[SPDK_BDEV_HISTOGRAM_SIZE_16K] = "16k",
+	[SPDK_BDEV_HISTOGRAM_SIZE_64K] = "64k",
+	[SPDK_BDEV_HISTOGRAM_SIZE_256K] = "256k",
+	[SPDK_BDEV_HISTOGRAM_SIZE_LARGE] = "large",
+};
+
+#define RPC_BDEV_HISTOGRAM_NUM_PERCENTILES 4
+
+static const struct {
+	const char	*name;
+	double		value;
+} g_rpc_bdev_histogram_percentiles[RPC_BDEV_HISTOGRAM_NUM_PERCENTILES] = {
+	{ "p50", 50.0 },
+	{ "p99", 99.0 },
+	{ "p99.9", 99.9 },
+	{ "p99.99", 99.99 },
+};
+
+struct rpc_bdev_histogram_percentiles {
+	uint64_t	count;
+	uint64_t	ticks[RPC_BDEV_HISTOGRAM_NUM_PERCENTILES];
+	int		num_found;
+};
+
+static void
+rpc_bdev_histogram_percentile_iter(void *cb_arg, uint64_t start, uint64_t end, uint64_t count,
+				   uint64_t total, uint64_t so_far)
+{
+	struct rpc_bdev_histogram_percentiles *ctx = cb_arg;
+
+	ctx->count = total;
+	if (count == 0) {
+		return;
+	}
+
+	while (ctx->num_found < RPC_BDEV_HISTOGRAM_NUM_PERCENTILES &&
+	       (double)so_far * 100 >= g_rpc_bdev_histogram_percentiles[ctx->num_found].value * total) {
+		ctx->ticks[ctx->num_found++] = end;
+	}
+}
+
+struct rpc_bdev_get_histogram_percentiles {
+	char	*name;
+	bool	reset;
+};
+
+static void
+free_rpc_bdev_get_histogram_percentiles(struct rpc_bdev_get_histogram_percentiles *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_get_histogram_percentiles_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_get_histogram_percentiles, name), spdk_json_decode_string},
+	{"reset", offsetof(struct rpc_bdev_get_histogram_percentiles, reset), spdk_json_decode_bool, true},
+};
+
+static void
+rpc_bdev_histogram_classes_cb(void *cb_arg, int status,
+			      struct spdk_histogram_data *histograms[][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES])
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	struct rpc_bdev_histogram_percentiles ctx;
+	uint64_t tsc_rate = spdk_get_ticks_hz();
+	int type, size_class, i;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(-status));
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "tsc_rate", tsc_rate);
+	spdk_json_write_named_array_begin(w, "histograms");
+	for (type = 0; type < SPDK_BDEV_NUM_IO_TYPES; type++) {
+		for (size_class = 0; size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size_class++) {
+			if (histograms[type][size_class] == NULL) {
+				continue;
+			}
+
+			memset(&ctx, 0, sizeof(ctx));
+			spdk_histogram_data_iterate(histograms[type][size_class],
+						    rpc_bdev_histogram_percentile_iter, &ctx);
+			if (ctx.count == 0) {
+				continue;
+			}
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "io_type", g_rpc_bdev_io_type_names[type]);
+			spdk_json_write_named_string(w, "size_class",
+						     g_rpc_bdev_histogram_size_class_names[size_class]);
+			spdk_json_write_named_uint64(w, "count", ctx.count);
+			for (i = 0; i < RPC_BDEV_HISTOGRAM_NUM_PERCENTILES; i++) {
+				spdk_json_write_named_double(w, g_rpc_bdev_histogram_percentiles[i].name,
+							     (double)ctx.ticks[i] * SPDK_SEC_TO_USEC / tsc_rate);
+			}
+			spdk_json_write_object_end(w);
+		}
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_bdev_get_histogram_percentiles(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_histogram_percentiles req = {NULL};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_get_histogram_percentiles_decoders,
+				    SPDK_COUNTOF(rpc_bdev_get_histogram_percentiles_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_histogram_get_classes(spdk_bdev_desc_get_bdev(desc), req.reset,
+					rpc_bdev_histogram_classes_cb, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_get_histogram_percentiles(&req);
+}
+SPDK_RPC_REGISTER("bdev_get_histogram_percentiles", rpc_bdev_get_histogram_percentiles,
+		  SPDK_RPC_RUNTIME)
@@ -209,6 +209,89 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 	return 0;
 }
 
+/*
+ * A channel cache is refilled with at most 1/BS_CLUSTER_CACHE_FREE_SHARE of the free
+ * clusters, so that clusters held by idle channels don't make allocations on other
+ * channels fail. Nearly full blobstores allocate straight from the shared pool.
+ */
+#define BS_CLUSTER_CACHE_FREE_SHARE 64
+
+static void
+bs_channel_refill_cluster_cache(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	uint32_t cluster_num, count, i;
+
+	assert(ch->cluster_cache.count == 0);
+
+	spdk_spin_lock(&bs->used_lock);
+	count = spdk_min(SPDK_BS_CHANNEL_CLUSTER_CACHE_SIZE,
+			 bs->num_free_clusters / BS_CLUSTER_CACHE_FREE_SHARE);
+	for (i = 0; i < count; i++) {
+		cluster_num = bs_claim_cluster(bs);
+		if (cluster_num == UINT32_MAX) {
+			break;
+		}
+		ch->cluster_cache.clusters[i] = cluster_num;
+	}
+	__atomic_fetch_add(&bs->num_reserved_clusters, i, __ATOMIC_RELAXED);
+	spdk_spin_unlock(&bs->used_lock);
+
+	ch->cluster_cache.head = 0;
+	ch->cluster_cache.count = i;
+}
+
+static void
+bs_channel_release_cluster_cache(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	uint32_t i;
+
+	if (ch->cluster_cache.count == 0) {
+		return;
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+	for (i = 0; i < ch->cluster_cache.count; i++) {
+		bs_release_cluster(bs, ch->cluster_cache.clusters[ch->cluster_cache.head + i]);
+	}
+	__atomic_fetch_sub(&bs->num_reserved_clusters, ch->cluster_cache.count, __ATOMIC_RELAXED);
+	spdk_spin_unlock(&bs->used_lock);
+
+	ch->cluster_cache.head = 0;
+	ch->cluster_cache.count = 0;
+}
+
+static int
+bs_channel_allocate_cluster(struct spdk_bs_channel *ch, struct spdk_blob *blob,
+			    uint32_t cluster_num, uint64_t *cluster, uint32_t *lowest_free_md_page)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	int rc;
+
+	if (ch->cluster_cache.count == 0) {
+		bs_channel_refill_cluster_cache(ch);
+	}
+
+	/* Extent pages are not cached, claiming one needs the used_lock anyway */
+	if (ch->cluster_cache.count == 0 ||
+	    (blob->use_extent_table && *bs_cluster_to_extent_page(blob, cluster_num) == 0)) {
+		spdk_spin_lock(&bs->used_lock);
+		rc = bs_allocate_cluster(blob, cluster_num, cluster, lowest_free_md_page, false);
+		spdk_spin_unlock(&bs->used_lock);
+		return rc;
+	}
+
+	*cluster = ch->cluster_cache.clusters[ch->cluster_cache.head++];
+	ch->cluster_cache.count--;
+	__atomic_fetch_sub(&bs->num_reserved_clusters, 1, __ATOMIC_RELAXED);
+
+	SPDK_DEBUGLOG(blob, "Claiming cached cluster %" PRIu64 " for blob 0x%" PRIx64 "\n", *cluster,
+		      blob->id);
+
+	return 0;
+}
+
 static void
 blob_xattrs_init(struct spdk_blob_xattr_opts *xattrs)
 {
@@ -317,6 +400,8 @@ blob_alloc(struct spdk_blob_store *bs, spdk_blob_id id)
 	TAILQ_INIT(&blob->xattrs_internal);
 	TAILQ_INIT(&blob->pending_persists);
 	TAILQ_INIT(&blob->persists_to_complete);
+	TAILQ_INIT(&blob->pending_cluster_inserts);
+	TAILQ_INIT(&blob->cluster_inserts_in_progress);
 
 	return blob;
 }
@@ -340,6 +425,8 @@ blob_free(struct spdk_blob *blob)
 	assert(blob != NULL);
 	assert(TAILQ_EMPTY(&blob->pending_persists));
 	assert(TAILQ_EMPTY(&blob->persists_to_complete));
+	assert(TAILQ_EMPTY(&blob->pending_cluster_inserts));
+	assert(TAILQ_EMPTY(&blob->cluster_inserts_in_progress));
 
 	free(blob->active.extent_pages);
 	free(blob->clean.extent_pages);
@@ -2664,10 +2751,8 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		}
 	}
 
-	spdk_spin_lock(&blob->bs->used_lock);
-	rc = bs_allocate_cluster(blob, cluster_number, &ctx->new_cluster, &ctx->new_extent_page,
-				 false);
-	spdk_spin_unlock(&blob->bs->used_lock);
+	rc = bs_channel_allocate_cluster(ch, blob, cluster_number, &ctx->new_cluster,
+					 &ctx->new_extent_page);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
 		free(ctx);
@@ -3348,6 +3433,8 @@ bs_channel_create(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&channel->need_cluster_alloc);
 	TAILQ_INIT(&channel->queued_io);
 	RB_INIT(&channel->esnap_channels);
+	channel->cluster_cache.head = 0;
+	channel->cluster_cache.count = 0;
 
 	return 0;
 }
@@ -3371,6 +3458,7 @@ bs_channel_destroy(void *io_device, void *ctx_buf)
 	}
 
 	blob_esnap_destroy_bs_channel(channel);
+	bs_channel_release_cluster_cache(channel);
 
 	free(channel->req_mem);
 	spdk_free(channel->new_cluster_page);
@@ -3561,6 +3649,38 @@ bs_opts_verify(struct spdk_bs_opts *opts)
 
 /* START spdk_bs_load */
 
+/*
+ * Recovery replays the whole md region to rebuild the used md page, blobid and cluster maps.
+ * The region is read sequentially in large chunks, several of them at a time, and the first
+ * page of each blob is parsed as soon as its chunk arrives.  The remaining pages of a blob
+ * (further md pages and extent pages) can be anywhere in the region, so they are read
+ * separately, with several blobs being replayed concurrently.
+ */
+#define BS_LOAD_REPLAY_CHUNK_PAGES	128
+#define BS_LOAD_REPLAY_QD		4
+#define BS_LOAD_REPLAY_MAX_CHAINS	32
+
+struct bs_load_replay_chunk {
+	struct spdk_bs_load_ctx		*ctx;
+	struct spdk_blob_md_page	*pages;
+	uint32_t			start_page;
+	uint32_t			num_pages;
+	bool				busy;
+};
+
+struct bs_load_replay_chain {
+	struct spdk_bs_load_ctx		*ctx;
+	/* Next md page of the blob, SPDK_INVALID_MD_PAGE once the whole chain was read */
+	uint32_t			cur_page;
+	struct spdk_blob_md_page	*page;
+
+	uint64_t			num_extent_pages;
+	uint32_t			*extent_page_num;
+	struct spdk_blob_md_page	*extent_pages;
+
+	TAILQ_ENTRY(bs_load_replay_chain) link;
+};
+
 /* spdk_bs_load_ctx is used for init, load, unload and dump code paths. */
 
 struct spdk_bs_load_ctx {
@@ -3568,16 +3688,29 @@ struct spdk_bs_load_ctx {
 	struct spdk_bs_super_block	*super;
 
 	struct spdk_bs_md_mask		*mask;
-	bool				in_page_chain;
-	uint32_t			page_index;
 	uint32_t			cur_page;
 	struct spdk_blob_md_page	*page;
 
-	uint64_t			num_extent_pages;
-	uint32_t			*extent_page_num;
-	struct spdk_blob_md_page	*extent_pages;
 	struct spdk_bit_array		*used_clusters;
 
+	/* md region chunks being read while replaying the metadata */
+	struct bs_load_replay_chunk	*replay_chunks;
+	uint32_t			replay_next_page;
+	uint32_t			replay_chunks_outstanding;
+	/* Blobs whose md spans more than their first page, waiting to be replayed */
+	TAILQ_HEAD(, bs_load_replay_chain) replay_chains;
+	uint32_t			replay_chains_outstanding;
+	uint32_t			replay_num_blobs;
+	/* Non-zero while new replay requests are being submitted */
+	uint32_t			replay_submitting;
+	int				replay_rc;
+	bool				replayed;
+
+	/* Timestamps of the load phases, reported once the load is done */
+	uint64_t			start_tsc;
+	uint64_t			super_tsc;
+	uint64_t			md_tsc;
+
 	spdk_bs_sequence_t			*seq;
 	spdk_blob_op_with_handle_complete	iter_cb_fn;
 	void					*iter_cb_arg;
@@ -3627,6 +3760,7 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	}
 
 	ctx->bs = bs;
+	ctx->start_tsc = spdk_get_ticks();
 	ctx->iter_cb_fn = opts->iter_cb_fn;
 	ctx->iter_cb_arg = opts->iter_cb_arg;
 	ctx->force_recover = opts->force_recover;
@@ -3950,6 +4084,29 @@ bs_examine_clone(void *cb_arg, struct spdk_blob *blob, int bserrno)
 	}
 }
 
+static void
+bs_load_log_times(struct spdk_bs_load_ctx *ctx)
+{
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t now = spdk_get_ticks();
+	uint64_t total_ms, super_ms, md_ms, blobs_ms;
+
+	total_ms = (now - ctx->start_tsc) * 1000 / ticks_hz;
+	super_ms = (ctx->super_tsc - ctx->start_tsc) * 1000 / ticks_hz;
+	md_ms = (ctx->md_tsc - ctx->super_tsc) * 1000 / ticks_hz;
+	blobs_ms = (now - ctx->md_tsc) * 1000 / ticks_hz;
+
+	if (ctx->replayed) {
+		SPDK_NOTICELOG("Blobstore load took %" PRIu64 " ms: super block %" PRIu64 " ms, "
+			       "metadata replay %" PRIu64 " ms (%" PRIu32 " blobs), blobs %" PRIu64 " ms\n",
+			       total_ms, super_ms, md_ms, ctx->replay_num_blobs, blobs_ms);
+	} else {
+		SPDK_INFOLOG(blob, "Blobstore load took %" PRIu64 " ms: super block %" PRIu64 " ms, "
+			     "metadata %" PRIu64 " ms, blobs %" PRIu64 " ms\n",
+			     total_ms, super_ms, md_ms, blobs_ms);
+	}
+}
+
 static void
 bs_load_iter(void *arg, struct spdk_blob *blob, int bserrno)
 {
@@ -3998,6 +4155,10 @@ bs_load_iter(void *arg, struct spdk_blob *blob, int bserrno)
 
 	ctx->iter_cb_fn = NULL;
 
+	if (bserrno == 0) {
+		bs_load_log_times(ctx);
+	}
+
 	spdk_free(ctx->super);
 	spdk_free(ctx->mask);
 	bs_sequence_finish(ctx->seq, bserrno);
@@ -4009,6 +4170,7 @@ static void bs_dump_read_md_page(spdk_bs_sequence_t *seq, void *cb_arg);
 static void
 bs_load_complete(struct spdk_bs_load_ctx *ctx)
 {
+	ctx->md_tsc = spdk_get_ticks();
 	ctx->bs->used_clusters = spdk_bit_pool_create_from_array(ctx->used_clusters);
 	if (ctx->dumping) {
 		bs_dump_read_md_page(ctx->seq, ctx);
@@ -4169,7 +4331,8 @@ bs_load_read_used_pages(struct spdk_bs_load_ctx *ctx)
 }
 
 static int
-bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_page *page)
+bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_page *page,
+			     struct bs_load_replay_chain *chain)
 {
 	struct spdk_blob_store *bs = ctx->bs;
 	struct spdk_blob_md_descriptor *desc;
@@ -4257,7 +4420,7 @@ bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_p
 			/* Skip this item */
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_EXTENT_TABLE) {
 			struct spdk_blob_md_descriptor_extent_table *desc_extent_table;
-			uint32_t num_extent_pages = ctx->num_extent_pages;
+			uint32_t num_extent_pages = chain->num_extent_pages;
 			uint32_t i;
 			size_t extent_pages_length;
 			void *tmp;
@@ -4280,19 +4443,19 @@ bs_load_replay_md_parse_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_p
 			}
 
 			if (num_extent_pages > 0) {
-				tmp = realloc(ctx->extent_page_num, num_extent_pages * sizeof(uint32_t));
+				tmp = realloc(chain->extent_page_num, num_extent_pages * sizeof(uint32_t));
 				if (tmp == NULL) {
 					return -ENOMEM;
 				}
-				ctx->extent_page_num = tmp;
+				chain->extent_page_num = tmp;
 
 				/* Extent table entries contain md page numbers for extent pages.
 				 * Zeroes represent unallocated extent pages, those are run-length-encoded.
 				 */
 				for (i = 0; i < extent_pages_length / sizeof(desc_extent_table->extent_page[0]); i++) {
 					if (desc_extent_table->extent_page[i].page_idx != 0) {
-						ctx->extent_page_num[ctx->num_extent_pages] = desc_extent_table->extent_page[i].page_idx;
-						ctx->num_extent_pages += 1;
+						chain->extent_page_num[chain->num_extent_pages] = desc_extent_table->extent_page[i].page_idx;
+						chain->num_extent_pages += 1;
 					}
 				}
 			}
@@ -4350,10 +4513,9 @@ bs_load_cur_extent_page_valid(struct spdk_blob_md_page *page)
 }
 
 static bool
-bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
+bs_load_md_page_valid(struct spdk_blob_md_page *page, uint32_t page_num)
 {
 	uint32_t crc;
-	struct spdk_blob_md_page *page = ctx->page;
 
 	crc = blob_md_page_calc_crc(page);
 	if (crc != page->crc) {
@@ -4362,7 +4524,7 @@ bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
 
 	/* First page of a sequence should match the blobid. */
 	if (page->sequence_num == 0 &&
-	    bs_page_to_blobid(ctx->cur_page) != page->id) {
+	    bs_page_to_blobid(page_num) != page->id) {
 		return false;
 	}
 	assert(bs_load_cur_extent_page_valid(page) == false);
@@ -4370,8 +4532,6 @@ bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
 	return true;
 }
 
-static void bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx);
-
 static void
 bs_load_write_used_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
@@ -4423,95 +4583,148 @@ bs_load_write_used_md(struct spdk_bs_load_ctx *ctx)
 	bs_write_used_md(ctx->seq, ctx, bs_load_write_used_pages_cpl);
 }
 
+static void bs_load_replay_chunks_start(struct spdk_bs_load_ctx *ctx);
+static void bs_load_replay_chains_start(struct spdk_bs_load_ctx *ctx);
+static void bs_load_replay_chain_read_page(spdk_bs_sequence_t *seq,
+		struct bs_load_replay_chain *chain);
+
+static void
+bs_load_replay_chain_free(struct bs_load_replay_chain *chain)
+{
+	spdk_free(chain->page);
+	spdk_free(chain->extent_pages);
+	free(chain->extent_page_num);
+	free(chain);
+}
+
 static void
-bs_load_replay_md_chain_cpl(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_md_done(struct spdk_bs_load_ctx *ctx)
 {
+	struct bs_load_replay_chain *chain;
 	uint64_t num_md_clusters;
 	uint64_t i;
 
-	ctx->in_page_chain = false;
+	/* Requests may complete synchronously while new ones are being submitted */
+	if (ctx->replay_chunks_outstanding > 0 || ctx->replay_chains_outstanding > 0 ||
+	    ctx->replay_submitting > 0) {
+		return;
+	}
 
-	do {
-		ctx->page_index++;
-	} while (spdk_bit_array_get(ctx->bs->used_md_pages, ctx->page_index) == true);
+	assert(ctx->replay_rc != 0 || (ctx->replay_next_page == ctx->super->md_len &&
+				       TAILQ_EMPTY(&ctx->replay_chains)));
 
-	if (ctx->page_index < ctx->super->md_len) {
-		ctx->cur_page = ctx->page_index;
-		bs_load_replay_cur_md_page(ctx);
-	} else {
-		/* Claim all of the clusters used by the metadata */
-		num_md_clusters = spdk_divide_round_up(
-					  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
-		for (i = 0; i < num_md_clusters; i++) {
-			spdk_bit_array_set(ctx->used_clusters, i);
-		}
-		ctx->bs->num_free_clusters -= num_md_clusters;
-		spdk_free(ctx->page);
-		bs_load_write_used_md(ctx);
+	for (i = 0; i < BS_LOAD_REPLAY_QD; i++) {
+		spdk_free(ctx->replay_chunks[i].pages);
+	}
+	free(ctx->replay_chunks);
+	ctx->replay_chunks = NULL;
+
+	while (!TAILQ_EMPTY(&ctx->replay_chains)) {
+		chain = TAILQ_FIRST(&ctx->replay_chains);
+		TAILQ_REMOVE(&ctx->replay_chains, chain, link);
+		bs_load_replay_chain_free(chain);
+	}
+
+	if (ctx->replay_rc != 0) {
+		bs_load_ctx_fail(ctx, ctx->replay_rc);
+		return;
+	}
+
+	/* Claim all of the clusters used by the metadata */
+	num_md_clusters = spdk_divide_round_up(
+				  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
+	for (i = 0; i < num_md_clusters; i++) {
+		spdk_bit_array_set(ctx->used_clusters, i);
+	}
+	ctx->bs->num_free_clusters -= num_md_clusters;
+	bs_load_write_used_md(ctx);
+}
+
+static void
+bs_load_replay_fail(struct spdk_bs_load_ctx *ctx, int bserrno)
+{
+	/* Keep the first error, the load fails once all outstanding reads are done */
+	if (ctx->replay_rc == 0) {
+		ctx->replay_rc = bserrno;
 	}
 }
 
+static void
+bs_load_replay_chain_done(void *cb_arg, int bserrno)
+{
+	struct bs_load_replay_chain *chain = cb_arg;
+	struct spdk_bs_load_ctx *ctx = chain->ctx;
+
+	assert(ctx->replay_chains_outstanding > 0);
+	ctx->replay_chains_outstanding--;
+	bs_load_replay_chain_free(chain);
+
+	if (bserrno != 0) {
+		bs_load_replay_fail(ctx, bserrno);
+	}
+
+	ctx->replay_submitting++;
+	bs_load_replay_chunks_start(ctx);
+	bs_load_replay_chains_start(ctx);
+	ctx->replay_submitting--;
+	bs_load_replay_md_done(ctx);
+}
+
 static void
 bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
-	struct spdk_bs_load_ctx *ctx = cb_arg;
+	struct bs_load_replay_chain *chain = cb_arg;
+	struct spdk_bs_load_ctx *ctx = chain->ctx;
 	uint32_t page_num;
 	uint64_t i;
 
 	if (bserrno != 0) {
-		spdk_free(ctx->extent_pages);
-		bs_load_ctx_fail(ctx, bserrno);
+		bs_sequence_finish(seq, bserrno);
 		return;
 	}
 
-	for (i = 0; i < ctx->num_extent_pages; i++) {
+	for (i = 0; i < chain->num_extent_pages; i++) {
 		/* Extent pages are only read when present within in chain md.
 		 * Integrity of md is not right if that page was not a valid extent page. */
-		if (bs_load_cur_extent_page_valid(&ctx->extent_pages[i]) != true) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
+		if (bs_load_cur_extent_page_valid(&chain->extent_pages[i]) != true) {
+			bs_sequence_finish(seq, -EILSEQ);
 			return;
 		}
 
-		page_num = ctx->extent_page_num[i];
+		page_num = chain->extent_page_num[i];
 		spdk_bit_array_set(ctx->bs->used_md_pages, page_num);
-		if (bs_load_replay_md_parse_page(ctx, &ctx->extent_pages[i])) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
+		if (bs_load_replay_md_parse_page(ctx, &chain->extent_pages[i], chain)) {
+			bs_sequence_finish(seq, -EILSEQ);
 			return;
 		}
 	}
 
-	spdk_free(ctx->extent_pages);
-	free(ctx->extent_page_num);
-	ctx->extent_page_num = NULL;
-	ctx->num_extent_pages = 0;
-
-	bs_load_replay_md_chain_cpl(ctx);
+	bs_sequence_finish(seq, 0);
 }
 
 static void
-bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_extent_pages(spdk_bs_sequence_t *seq, struct bs_load_replay_chain *chain)
 {
+	struct spdk_bs_load_ctx *ctx = chain->ctx;
 	spdk_bs_batch_t *batch;
 	uint32_t page;
 	uint64_t lba;
 	uint64_t i;
 
-	ctx->extent_pages = spdk_zmalloc(SPDK_BS_PAGE_SIZE * ctx->num_extent_pages, 0,
-					 NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (!ctx->extent_pages) {
-		bs_load_ctx_fail(ctx, -ENOMEM);
+	chain->extent_pages = spdk_zmalloc(SPDK_BS_PAGE_SIZE * chain->num_extent_pages, 0,
+					   NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (!chain->extent_pages) {
+		bs_sequence_finish(seq, -ENOMEM);
 		return;
 	}
 
-	batch = bs_sequence_to_batch(ctx->seq, bs_load_replay_extent_page_cpl, ctx);
+	batch = bs_sequence_to_batch(seq, bs_load_replay_extent_page_cpl, chain);
 
-	for (i = 0; i < ctx->num_extent_pages; i++) {
-		page = ctx->extent_page_num[i];
+	for (i = 0; i < chain->num_extent_pages; i++) {
+		page = chain->extent_page_num[i];
 		assert(page < ctx->super->md_len);
 		lba = bs_md_page_to_lba(ctx->bs, page);
-		bs_batch_read_dev(batch, &ctx->extent_pages[i], lba,
+		bs_batch_read_dev(batch, &chain->extent_pages[i], lba,
 				  bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE));
 	}
 
@@ -4519,71 +4732,249 @@ bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
 }
 
 static void
-bs_load_replay_md_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+bs_load_replay_chain_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
-	struct spdk_bs_load_ctx *ctx = cb_arg;
-	uint32_t page_num;
-	struct spdk_blob_md_page *page;
+	struct bs_load_replay_chain *chain = cb_arg;
+	struct spdk_bs_load_ctx *ctx = chain->ctx;
+	struct spdk_blob_md_page *page = chain->page;
+	uint32_t page_num = chain->cur_page;
 
 	if (bserrno != 0) {
-		bs_load_ctx_fail(ctx, bserrno);
+		bs_sequence_finish(seq, bserrno);
 		return;
 	}
 
-	page_num = ctx->cur_page;
-	page = ctx->page;
-	if (bs_load_cur_md_page_valid(ctx) == true) {
-		if (page->sequence_num == 0 || ctx->in_page_chain == true) {
-			spdk_spin_lock(&ctx->bs->used_lock);
-			bs_claim_md_page(ctx->bs, page_num);
-			spdk_spin_unlock(&ctx->bs->used_lock);
-			if (page->sequence_num == 0) {
-				SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
-				spdk_bit_array_set(ctx->bs->used_blobids, page_num);
-			}
-			if (bs_load_replay_md_parse_page(ctx, page)) {
-				bs_load_ctx_fail(ctx, -EILSEQ);
-				return;
-			}
-			if (page->next != SPDK_INVALID_MD_PAGE) {
-				ctx->in_page_chain = true;
-				ctx->cur_page = page->next;
-				bs_load_replay_cur_md_page(ctx);
-				return;
+	if (bs_load_md_page_valid(page, page_num) == false) {
+		/* The chain is broken, ignore the rest of this blob's md */
+		bs_sequence_finish(seq, 0);
+		return;
+	}
+
+	spdk_spin_lock(&ctx->bs->used_lock);
+	bs_claim_md_page(ctx->bs, page_num);
+	spdk_spin_unlock(&ctx->bs->used_lock);
+	if (page->sequence_num == 0) {
+		SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
+		spdk_bit_array_set(ctx->bs->used_blobids, page_num);
+	}
+	if (bs_load_replay_md_parse_page(ctx, page, chain)) {
+		bs_sequence_finish(seq, -EILSEQ);
+		return;
+	}
+
+	chain->cur_page = page->next;
+	if (chain->cur_page != SPDK_INVALID_MD_PAGE) {
+		bs_load_replay_chain_read_page(seq, chain);
+	} else if (chain->num_extent_pages != 0) {
+		bs_load_replay_extent_pages(seq, chain);
+	} else {
+		bs_sequence_finish(seq, 0);
+	}
+}
+
+static void
+bs_load_replay_chain_read_page(spdk_bs_sequence_t *seq, struct bs_load_replay_chain *chain)
+{
+	struct spdk_bs_load_ctx *ctx = chain->ctx;
+	uint64_t lba;
+
+	assert(chain->cur_page < ctx->super->md_len);
+	lba = bs_md_page_to_lba(ctx->bs, chain->cur_page);
+	bs_sequence_read_dev(seq, chain->page, lba,
+			     bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
+			     bs_load_replay_chain_page_cpl, chain);
+}
+
+static void
+bs_load_replay_chains_start(struct spdk_bs_load_ctx *ctx)
+{
+	struct bs_load_replay_chain *chain;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+
+	while (ctx->replay_rc == 0 && ctx->replay_chains_outstanding < BS_LOAD_REPLAY_MAX_CHAINS) {
+		chain = TAILQ_FIRST(&ctx->replay_chains);
+		if (chain == NULL) {
+			break;
+		}
+
+		if (chain->cur_page != SPDK_INVALID_MD_PAGE && chain->page == NULL) {
+			chain->page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+						   SPDK_MALLOC_DMA);
+			if (chain->page == NULL) {
+				bs_load_replay_fail(ctx, -ENOMEM);
+				break;
 			}
-			if (ctx->num_extent_pages != 0) {
-				bs_load_replay_extent_pages(ctx);
-				return;
+		}
+
+		cpl.type = SPDK_BS_CPL_TYPE_BS_BASIC;
+		cpl.u.bs_basic.cb_fn = bs_load_replay_chain_done;
+		cpl.u.bs_basic.cb_arg = chain;
+
+		seq = bs_sequence_start_bs(ctx->bs->md_channel, &cpl);
+		if (seq == NULL) {
+			if (ctx->replay_chains_outstanding + ctx->replay_chunks_outstanding == 0) {
+				bs_load_replay_fail(ctx, -ENOMEM);
 			}
+			/* Otherwise, try again once one of the outstanding requests completes */
+			break;
+		}
+
+		TAILQ_REMOVE(&ctx->replay_chains, chain, link);
+		ctx->replay_chains_outstanding++;
+
+		if (chain->cur_page != SPDK_INVALID_MD_PAGE) {
+			bs_load_replay_chain_read_page(seq, chain);
+		} else {
+			bs_load_replay_extent_pages(seq, chain);
 		}
 	}
-	bs_load_replay_md_chain_cpl(ctx);
+}
+
+static int
+bs_load_replay_first_page(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_page *page,
+			  uint32_t page_num)
+{
+	struct bs_load_replay_chain *chain;
+
+	if (page->sequence_num != 0 || bs_load_md_page_valid(page, page_num) == false) {
+		return 0;
+	}
+
+	chain = calloc(1, sizeof(*chain));
+	if (chain == NULL) {
+		return -ENOMEM;
+	}
+	chain->ctx = ctx;
+
+	spdk_spin_lock(&ctx->bs->used_lock);
+	bs_claim_md_page(ctx->bs, page_num);
+	spdk_spin_unlock(&ctx->bs->used_lock);
+	SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
+	spdk_bit_array_set(ctx->bs->used_blobids, page_num);
+	ctx->replay_num_blobs++;
+
+	if (bs_load_replay_md_parse_page(ctx, page, chain)) {
+		bs_load_replay_chain_free(chain);
+		return -EILSEQ;
+	}
+
+	if (page->next == SPDK_INVALID_MD_PAGE && chain->num_extent_pages == 0) {
+		/* The whole md of this blob fits in a single page */
+		bs_load_replay_chain_free(chain);
+		return 0;
+	}
+
+	chain->cur_page = page->next;
+	TAILQ_INSERT_TAIL(&ctx->replay_chains, chain, link);
+
+	return 0;
 }
 
 static void
-bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_chunk_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
-	uint64_t lba;
+	struct bs_load_replay_chunk *chunk = cb_arg;
+	struct spdk_bs_load_ctx *ctx = chunk->ctx;
+	uint32_t i;
+	int rc;
 
-	assert(ctx->cur_page < ctx->super->md_len);
-	lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
-	bs_sequence_read_dev(ctx->seq, ctx->page, lba,
-			     bs_byte_to_lba(ctx->bs, SPDK_BS_PAGE_SIZE),
-			     bs_load_replay_md_cpl, ctx);
+	bs_sequence_finish(seq, bserrno);
+
+	assert(ctx->replay_chunks_outstanding > 0);
+	ctx->replay_chunks_outstanding--;
+	chunk->busy = false;
+
+	if (bserrno != 0) {
+		bs_load_replay_fail(ctx, bserrno);
+	}
+
+	for (i = 0; i < chunk->num_pages && ctx->replay_rc == 0; i++) {
+		rc = bs_load_replay_first_page(ctx, &chunk->pages[i], chunk->start_page + i);
+		if (rc != 0) {
+			bs_load_replay_fail(ctx, rc);
+		}
+	}
+
+	ctx->replay_submitting++;
+	/* Keep the md region reads going before starting the chains parsed from this chunk */
+	bs_load_replay_chunks_start(ctx);
+	bs_load_replay_chains_start(ctx);
+	ctx->replay_submitting--;
+	bs_load_replay_md_done(ctx);
+}
+
+static void
+bs_load_replay_chunks_start(struct spdk_bs_load_ctx *ctx)
+{
+	struct bs_load_replay_chunk *chunk;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+	uint32_t i;
+
+	for (i = 0; i < BS_LOAD_REPLAY_QD; i++) {
+		if (ctx->replay_rc != 0 || ctx->replay_next_page == ctx->super->md_len) {
+			break;
+		}
+
+		chunk = &ctx->replay_chunks[i];
+		if (chunk->busy) {
+			continue;
+		}
+
+		cpl.type = SPDK_BS_CPL_TYPE_NONE;
+		seq = bs_sequence_start_bs(ctx->bs->md_channel, &cpl);
+		if (seq == NULL) {
+			if (ctx->replay_chains_outstanding + ctx->replay_chunks_outstanding == 0) {
+				bs_load_replay_fail(ctx, -ENOMEM);
+			}
+			/* Otherwise, try again once one of the outstanding requests completes */
+			break;
+		}
+
+		chunk->busy = true;
+		chunk->start_page = ctx->replay_next_page;
+		chunk->num_pages = spdk_min(BS_LOAD_REPLAY_CHUNK_PAGES,
+					    ctx->super->md_len - chunk->start_page);
+		ctx->replay_next_page += chunk->num_pages;
+		ctx->replay_chunks_outstanding++;
+
+		bs_sequence_read_dev(seq, chunk->pages, bs_md_page_to_lba(ctx->bs, chunk->start_page),
+				     bs_byte_to_lba(ctx->bs, chunk->num_pages * SPDK_BS_PAGE_SIZE),
+				     bs_load_replay_chunk_cpl, chunk);
+	}
 }
 
 static void
 bs_load_replay_md(struct spdk_bs_load_ctx *ctx)
 {
-	ctx->page_index = 0;
-	ctx->cur_page = 0;
-	ctx->page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0,
-				 NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (!ctx->page) {
+	uint32_t i;
+
+	TAILQ_INIT(&ctx->replay_chains);
+	ctx->replay_next_page = 0;
+	ctx->replayed = true;
+
+	ctx->replay_chunks = calloc(BS_LOAD_REPLAY_QD, sizeof(*ctx->replay_chunks));
+	if (!ctx->replay_chunks) {
 		bs_load_ctx_fail(ctx, -ENOMEM);
 		return;
 	}
-	bs_load_replay_cur_md_page(ctx);
+
+	for (i = 0; i < BS_LOAD_REPLAY_QD; i++) {
+		ctx->replay_chunks[i].ctx = ctx;
+		ctx->replay_chunks[i].pages = spdk_zmalloc(BS_LOAD_REPLAY_CHUNK_PAGES * SPDK_BS_PAGE_SIZE,
+					      0, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+		if (!ctx->replay_chunks[i].pages) {
+			bs_load_replay_fail(ctx, -ENOMEM);
+			bs_load_replay_md_done(ctx);
+			return;
+		}
+	}
+
+	ctx->replay_submitting++;
+	bs_load_replay_chunks_start(ctx);
+	ctx->replay_submitting--;
+	bs_load_replay_md_done(ctx);
 }
 
 static void
@@ -4710,6 +5101,7 @@ bs_load_super_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 		bs_load_ctx_fail(ctx, rc);
 		return;
 	}
+	ctx->super_tsc = spdk_get_ticks();
 
 	if (ctx->super->used_blobid_mask_len == 0 || ctx->super->clean == 0 || ctx->force_recover) {
 		bs_recover(ctx);
@@ -5597,6 +5989,29 @@ bs_unload_read_super_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	bs_write_used_md(seq, cb_arg, bs_unload_write_used_pages_cpl);
 }
 
+static void
+bs_unload_release_cluster_caches(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+
+	bs_channel_release_cluster_cache(spdk_io_channel_get_ctx(_ch));
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+bs_unload_release_cluster_caches_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_load_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	assert(ctx->bs->num_reserved_clusters == 0);
+
+	/* Read super block */
+	bs_sequence_read_dev(ctx->seq, ctx->super, bs_page_to_lba(ctx->bs, 0),
+			     bs_byte_to_lba(ctx->bs, sizeof(*ctx->super)),
+			     bs_unload_read_super_cpl, ctx);
+}
+
 void
 spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_arg)
 {
@@ -5663,10 +6078,9 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 		return;
 	}
 
-	/* Read super block */
-	bs_sequence_read_dev(ctx->seq, ctx->super, bs_page_to_lba(bs, 0),
-			     bs_byte_to_lba(bs, sizeof(*ctx->super)),
-			     bs_unload_read_super_cpl, ctx);
+	/* Return the clusters reserved by channel caches, so they are not persisted as used */
+	spdk_for_each_channel(bs, bs_unload_release_cluster_caches, ctx,
+			      bs_unload_release_cluster_caches_cpl);
 }
 
 /* END spdk_bs_unload */
@@ -5790,7 +6204,8 @@ spdk_bs_get_io_unit_size(struct spdk_blob_store *bs)
 uint64_t
 spdk_bs_free_cluster_count(struct spdk_blob_store *bs)
 {
-	return bs->num_free_clusters;
+	/* Clusters reserved by channel caches are still free */
+	return bs->num_free_clusters + __atomic_load_n(&bs->num_reserved_clusters, __ATOMIC_RELAXED);
 }
 
 uint64_t
@@ -7812,6 +8227,7 @@ struct spdk_blob_insert_cluster_ctx {
 	int			rc;
 	spdk_blob_op_complete	cb_fn;
 	void			*cb_arg;
+	TAILQ_ENTRY(spdk_blob_insert_cluster_ctx) link;
 };
 
 static void
@@ -7823,27 +8239,6 @@ blob_insert_cluster_msg_cpl(void *arg)
 	free(ctx);
 }
 
-static void
-blob_insert_cluster_msg_cb(void *arg, int bserrno)
-{
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-
-	ctx->rc = bserrno;
-	spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
-}
-
-static void
-blob_insert_new_ep_cb(void *arg, int bserrno)
-{
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-	uint32_t *extent_page;
-
-	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
-	*extent_page = ctx->extent_page;
-	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob_sync_md(ctx->blob, blob_insert_cluster_msg_cb, ctx);
-}
-
 struct spdk_blob_write_extent_page_ctx {
 	struct spdk_blob_store		*bs;
 
@@ -7916,48 +8311,150 @@ blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster
 	bs_mark_dirty(seq, blob->bs, blob_write_extent_page_ready, ctx);
 }
 
+static void blob_persist_cluster_inserts(struct spdk_blob *blob);
+
 static void
-blob_insert_cluster_msg(void *arg)
+blob_cluster_inserts_persisted(void *cb_arg, int bserrno)
 {
-	struct spdk_blob_insert_cluster_ctx *ctx = arg;
-	uint32_t *extent_page;
+	struct spdk_blob *blob = cb_arg;
+	struct spdk_blob_insert_cluster_ctx *ctx;
 
-	ctx->rc = blob_insert_cluster(ctx->blob, ctx->cluster_num, ctx->cluster);
-	if (ctx->rc != 0) {
+	/* Completions were held until the metadata covering the new clusters was written */
+	while ((ctx = TAILQ_FIRST(&blob->cluster_inserts_in_progress)) != NULL) {
+		TAILQ_REMOVE(&blob->cluster_inserts_in_progress, ctx, link);
+		ctx->rc = bserrno;
 		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+	}
+
+	if (!TAILQ_EMPTY(&blob->pending_cluster_inserts)) {
+		blob_persist_cluster_inserts(blob);
+	}
+}
+
+static void
+blob_cluster_inserts_extent_pages_written(void *cb_arg, int bserrno)
+{
+	struct spdk_blob *blob = cb_arg;
+	struct spdk_blob_insert_cluster_ctx *ctx;
+	bool sync_md = !blob->use_extent_table;
+
+	if (bserrno != 0) {
+		blob->cluster_inserts_status = bserrno;
+	}
+
+	assert(blob->cluster_inserts_writes > 0);
+	if (--blob->cluster_inserts_writes > 0) {
 		return;
 	}
 
-	if (ctx->blob->use_extent_table == false) {
-		/* Extent table is not used, proceed with sync of md that will only use extents_rle. */
-		ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-		blob_sync_md(ctx->blob, blob_insert_cluster_msg_cb, ctx);
+	if (blob->cluster_inserts_status != 0) {
+		blob_cluster_inserts_persisted(blob, blob->cluster_inserts_status);
 		return;
 	}
 
-	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
-	if (*extent_page == 0) {
-		/* Extent page requires allocation.
-		 * It was already claimed in the used_md_pages map and placed in ctx. */
-		assert(ctx->extent_page != 0);
-		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-		blob_write_extent_page(ctx->blob, ctx->extent_page, ctx->cluster_num, ctx->page,
-				       blob_insert_new_ep_cb, ctx);
-	} else {
-		/* It is possible for original thread to allocate extent page for
-		 * different cluster in the same extent page. In such case proceed with
-		 * updating the existing extent page, but release the additional one. */
+	/* New extent pages are only referenced by the extent table once they are written */
+	TAILQ_FOREACH(ctx, &blob->cluster_inserts_in_progress, link) {
 		if (ctx->extent_page != 0) {
-			spdk_spin_lock(&ctx->blob->bs->used_lock);
-			assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-			bs_release_md_page(ctx->blob->bs, ctx->extent_page);
-			spdk_spin_unlock(&ctx->blob->bs->used_lock);
+			*bs_cluster_to_extent_page(blob, ctx->cluster_num) = ctx->extent_page;
+			sync_md = true;
+		}
+	}
+
+	if (sync_md) {
+		blob->state = SPDK_BLOB_STATE_DIRTY;
+		blob_sync_md(blob, blob_cluster_inserts_persisted, blob);
+	} else {
+		blob_cluster_inserts_persisted(blob, 0);
+	}
+}
+
+/*
+ * Persist all the clusters inserted into the blob since the previous batch. Each
+ * extent page touched by the batch is written once, and the blob metadata is synced
+ * once if any extent page is new (or if the extent table is not used).
+ */
+static void
+blob_persist_cluster_inserts(struct spdk_blob *blob)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx, *prev;
+	uint32_t *extent_page;
+	bool extent_page_written;
+
+	assert(TAILQ_EMPTY(&blob->cluster_inserts_in_progress));
+	TAILQ_SWAP(&blob->cluster_inserts_in_progress, &blob->pending_cluster_inserts,
+		   spdk_blob_insert_cluster_ctx, link);
+
+	/* Hold a reference until all the extent page writes are submitted */
+	blob->cluster_inserts_writes = 1;
+	blob->cluster_inserts_status = 0;
+
+	if (!blob->use_extent_table) {
+		/* Extent table is not used, sync of md will only use extents_rle. */
+		blob_cluster_inserts_extent_pages_written(blob, 0);
+		return;
+	}
+
+	TAILQ_FOREACH(ctx, &blob->cluster_inserts_in_progress, link) {
+		extent_page = bs_cluster_to_extent_page(blob, ctx->cluster_num);
+
+		extent_page_written = false;
+		for (prev = TAILQ_FIRST(&blob->cluster_inserts_in_progress); prev != ctx;
+		     prev = TAILQ_NEXT(prev, link)) {
+			if (bs_cluster_to_extent_page(blob, prev->cluster_num) == extent_page) {
+				extent_page_written = true;
+				break;
+			}
+		}
+
+		/* It is possible for original threads to allocate an extent page for
+		 * different clusters in the same extent page. In such case only the first
+		 * one is used, the additional ones are released. */
+		if (ctx->extent_page != 0 && (*extent_page != 0 || extent_page_written)) {
+			spdk_spin_lock(&blob->bs->used_lock);
+			assert(spdk_bit_array_get(blob->bs->used_md_pages, ctx->extent_page) == true);
+			bs_release_md_page(blob->bs, ctx->extent_page);
+			spdk_spin_unlock(&blob->bs->used_lock);
 			ctx->extent_page = 0;
 		}
-		/* Extent page already allocated.
-		 * Every cluster allocation, requires just an update of single extent page. */
-		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num, ctx->page,
-				       blob_insert_cluster_msg_cb, ctx);
+
+		if (extent_page_written) {
+			/* The write of this extent page already covers the cluster */
+			continue;
+		}
+
+		if (*extent_page == 0) {
+			/* Extent page requires allocation.
+			 * It was already claimed in the used_md_pages map and placed in ctx. */
+			assert(ctx->extent_page != 0);
+			assert(spdk_bit_array_get(blob->bs->used_md_pages, ctx->extent_page) == true);
+		}
+
+		blob->cluster_inserts_writes++;
+		blob_write_extent_page(blob, *extent_page != 0 ? *extent_page : ctx->extent_page,
+				       ctx->cluster_num, ctx->page,
+				       blob_cluster_inserts_extent_pages_written, blob);
+	}
+
+	blob_cluster_inserts_extent_pages_written(blob, 0);
+}
+
+static void
+blob_insert_cluster_msg(void *arg)
+{
+	struct spdk_blob_insert_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	ctx->rc = blob_insert_cluster(blob, ctx->cluster_num, ctx->cluster);
+	if (ctx->rc != 0) {
+		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_msg_cpl, ctx);
+		return;
+	}
+
+	/* Clusters inserted while the metadata of a previous batch is being written are
+	 * persisted together, once that batch completes. */
+	TAILQ_INSERT_TAIL(&blob->pending_cluster_inserts, ctx, link);
+	if (TAILQ_EMPTY(&blob->cluster_inserts_in_progress)) {
+		blob_persist_cluster_inserts(blob);
 	}
 }
 
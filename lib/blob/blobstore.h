@@ -26,6 +26,7 @@
 #define SPDK_BLOB_OPTS_MAX_MD_OPS 32
 #define SPDK_BLOB_OPTS_DEFAULT_CHANNEL_OPS 512
 #define SPDK_BLOB_BLOBID_HIGH_BIT (1ULL << 32)
+#define SPDK_BS_CHANNEL_CLUSTER_CACHE_SIZE 16
 
 struct spdk_xattr {
 	uint32_t	index;
@@ -145,6 +146,13 @@ struct spdk_blob {
 	TAILQ_HEAD(, spdk_blob_persist_ctx) pending_persists;
 	TAILQ_HEAD(, spdk_blob_persist_ctx) persists_to_complete;
 
+	/* Cluster insertions waiting for the current batch to be persisted */
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx) pending_cluster_inserts;
+	/* Cluster insertions covered by the metadata writes in progress */
+	TAILQ_HEAD(, spdk_blob_insert_cluster_ctx) cluster_inserts_in_progress;
+	uint32_t cluster_inserts_writes;
+	int cluster_inserts_status;
+
 	/* Number of data clusters retrieved from extent table,
 	 * that many have to be read from extent pages. */
 	uint64_t	remaining_clusters_in_et;
@@ -172,6 +180,8 @@ struct spdk_blob_store {
 	uint64_t			total_clusters;
 	uint64_t			total_data_clusters;
 	uint64_t			num_free_clusters;	/* Protected by used_lock */
+	/* Clusters claimed into channel caches but not used by any blob yet, updated atomically */
+	uint64_t			num_reserved_clusters;
 	uint64_t			pages_per_cluster;
 	uint8_t				pages_per_cluster_shift;
 	uint32_t			io_unit_size;
@@ -214,6 +224,14 @@ struct spdk_bs_channel {
 	TAILQ_HEAD(, spdk_bs_request_set) need_cluster_alloc;
 	TAILQ_HEAD(, spdk_bs_request_set) queued_io;
 
+	/* Clusters claimed in advance for allocations on this channel, so that the
+	 * used_lock is taken once per batch instead of once per allocated cluster. */
+	struct {
+		uint32_t	clusters[SPDK_BS_CHANNEL_CLUSTER_CACHE_SIZE];
+		uint32_t	head;
+		uint32_t	count;
+	} cluster_cache;
+
 	RB_HEAD(blob_esnap_channel_tree, blob_esnap_channel) esnap_channels;
 };
 
@@ -488,6 +488,11 @@ struct spdk_nvme_poll_group {
 	void						*ctx;
 	struct spdk_nvme_accel_fn_table			accel_fn_table;
 	STAILQ_HEAD(, spdk_nvme_transport_poll_group)	tgroups;
+	/* Interrupt support, see spdk_nvme_poll_group_get_fd_group() */
+	struct spdk_fd_group				*fgrp;
+	int						event_fd;
+	bool						event_pending;
+	uint32_t					num_polled_tgroups;
 };
 
 struct spdk_nvme_transport_poll_group {
@@ -495,6 +500,10 @@ struct spdk_nvme_transport_poll_group {
 	const struct spdk_nvme_transport		*transport;
 	STAILQ_HEAD(, spdk_nvme_qpair)			connected_qpairs;
 	STAILQ_HEAD(, spdk_nvme_qpair)			disconnected_qpairs;
+	/* Set if the transport's fds were added to the group's fd group */
+	bool						interrupts;
+	/* Set if the transport cannot signal events and must always be polled */
+	bool						polled;
 	STAILQ_ENTRY(spdk_nvme_transport_poll_group)	link;
 };
 
@@ -1102,6 +1111,7 @@ nvme_robust_mutex_unlock(pthread_mutex_t *mtx)
 /* Poll group management functions. */
 int nvme_poll_group_connect_qpair(struct spdk_nvme_qpair *qpair);
 int nvme_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair);
+void nvme_poll_group_kick(struct spdk_nvme_poll_group *group);
 
 /* Admin functions */
 int	nvme_ctrlr_cmd_identify(struct spdk_nvme_ctrlr *ctrlr,
@@ -1553,6 +1563,10 @@ int nvme_transport_poll_group_connect_qpair(struct spdk_nvme_qpair *qpair);
 int64_t nvme_transport_poll_group_process_completions(struct spdk_nvme_transport_poll_group *tgroup,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb);
 int nvme_transport_poll_group_destroy(struct spdk_nvme_transport_poll_group *tgroup);
+int nvme_transport_poll_group_register_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp);
+void nvme_transport_poll_group_unregister_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp);
 int nvme_transport_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 					struct spdk_nvme_transport_poll_group_stat **stats);
 void nvme_transport_poll_group_free_stats(struct spdk_nvme_transport_poll_group *tgroup,
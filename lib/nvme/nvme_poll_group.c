@@ -5,6 +5,8 @@
  */
 
 #include "nvme_internal.h"
+#include "spdk/fd_group.h"
+#include "spdk/string.h"
 
 struct spdk_nvme_poll_group *
 spdk_nvme_poll_group_create(void *ctx, struct spdk_nvme_accel_fn_table *table)
@@ -33,6 +35,7 @@ spdk_nvme_poll_group_create(void *ctx, struct spdk_nvme_accel_fn_table *table)
 	}
 
 	group->ctx = ctx;
+	group->event_fd = -1;
 	STAILQ_INIT(&group->tgroups);
 
 	return group;
@@ -52,11 +55,150 @@ spdk_nvme_qpair_get_optimal_poll_group(struct spdk_nvme_qpair *qpair)
 	return tgroup->group;
 }
 
+void
+nvme_poll_group_kick(struct spdk_nvme_poll_group *group)
+{
+	uint64_t notify = 1;
+	int rc;
+
+	if (group->fgrp == NULL || group->event_pending) {
+		return;
+	}
+
+	rc = write(group->event_fd, &notify, sizeof(notify));
+	if (rc < 0) {
+		SPDK_ERRLOG("Failed to notify poll group %p: %s\n", group, spdk_strerror(errno));
+		return;
+	}
+
+	group->event_pending = true;
+}
+
+static int
+nvme_poll_group_register_interrupts(struct spdk_nvme_poll_group *group,
+				    struct spdk_nvme_transport_poll_group *tgroup)
+{
+	int rc;
+
+	rc = nvme_transport_poll_group_register_interrupts(tgroup, group->fgrp);
+	if (rc == 0) {
+		tgroup->interrupts = true;
+	} else if (rc == -ENOTSUP) {
+		/* Fall back to polling the transport by keeping the event fd signalled */
+		SPDK_DEBUGLOG(nvme, "Transport poll group %p does not support interrupts\n", tgroup);
+		tgroup->polled = true;
+		group->num_polled_tgroups++;
+		nvme_poll_group_kick(group);
+	} else {
+		return rc;
+	}
+
+	return 0;
+}
+
+static void
+nvme_poll_group_unregister_interrupts(struct spdk_nvme_poll_group *group,
+				      struct spdk_nvme_transport_poll_group *tgroup)
+{
+	if (tgroup->interrupts) {
+		nvme_transport_poll_group_unregister_interrupts(tgroup, group->fgrp);
+		tgroup->interrupts = false;
+	} else if (tgroup->polled) {
+		assert(group->num_polled_tgroups > 0);
+		group->num_polled_tgroups--;
+		tgroup->polled = false;
+	}
+}
+
+static int
+nvme_poll_group_event(void *ctx)
+{
+	/* Events are consumed by spdk_nvme_poll_group_wait() */
+	return 0;
+}
+
+static void
+nvme_poll_group_free_fd_group(struct spdk_nvme_poll_group *group)
+{
+	struct spdk_nvme_transport_poll_group *tgroup;
+
+	if (group->fgrp == NULL) {
+		return;
+	}
+
+	STAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		nvme_poll_group_unregister_interrupts(group, tgroup);
+	}
+
+	spdk_fd_group_remove(group->fgrp, group->event_fd);
+	close(group->event_fd);
+	spdk_fd_group_destroy(group->fgrp);
+	group->fgrp = NULL;
+	group->event_fd = -1;
+	group->event_pending = false;
+}
+
+struct spdk_fd_group *
+spdk_nvme_poll_group_get_fd_group(struct spdk_nvme_poll_group *group)
+{
+#ifdef __linux__
+	struct spdk_nvme_transport_poll_group *tgroup;
+	int rc;
+
+	if (group->fgrp != NULL) {
+		return group->fgrp;
+	}
+
+	rc = spdk_fd_group_create(&group->fgrp);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to create fd group: %s\n", spdk_strerror(-rc));
+		group->fgrp = NULL;
+		return NULL;
+	}
+
+	group->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (group->event_fd < 0) {
+		SPDK_ERRLOG("Failed to create eventfd: %s\n", spdk_strerror(errno));
+		spdk_fd_group_destroy(group->fgrp);
+		group->fgrp = NULL;
+		return NULL;
+	}
+
+	rc = SPDK_FD_GROUP_ADD(group->fgrp, group->event_fd, nvme_poll_group_event, group);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to add eventfd to fd group: %s\n", spdk_strerror(-rc));
+		close(group->event_fd);
+		spdk_fd_group_destroy(group->fgrp);
+		group->fgrp = NULL;
+		group->event_fd = -1;
+		return NULL;
+	}
+
+	STAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		rc = nvme_poll_group_register_interrupts(group, tgroup);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to register transport poll group %p interrupts: %s\n",
+				    tgroup, spdk_strerror(-rc));
+			nvme_poll_group_free_fd_group(group);
+			return NULL;
+		}
+	}
+
+	/* Qpairs may already have work pending, so make sure the group is processed once */
+	nvme_poll_group_kick(group);
+
+	return group->fgrp;
+#else
+	return NULL;
+#endif
+}
+
 int
 spdk_nvme_poll_group_add(struct spdk_nvme_poll_group *group, struct spdk_nvme_qpair *qpair)
 {
 	struct spdk_nvme_transport_poll_group *tgroup;
 	const struct spdk_nvme_transport *transport;
+	int rc;
 
 	if (nvme_qpair_get_state(qpair) != NVME_QPAIR_DISCONNECTED) {
 		return -EINVAL;
@@ -78,6 +220,13 @@ spdk_nvme_poll_group_add(struct spdk_nvme_poll_group *group, struct spdk_nvme_qp
 					return -ENOMEM;
 				}
 				tgroup->group = group;
+				if (group->fgrp != NULL) {
+					rc = nvme_poll_group_register_interrupts(group, tgroup);
+					if (rc != 0) {
+						nvme_transport_poll_group_destroy(tgroup);
+						return rc;
+					}
+				}
 				STAILQ_INSERT_TAIL(&group->tgroups, tgroup, link);
 				break;
 			}
@@ -105,12 +254,18 @@ spdk_nvme_poll_group_remove(struct spdk_nvme_poll_group *group, struct spdk_nvme
 int
 nvme_poll_group_connect_qpair(struct spdk_nvme_qpair *qpair)
 {
+	/* Connecting qpairs make progress only when the group is processed */
+	nvme_poll_group_kick(qpair->poll_group->group);
+
 	return nvme_transport_poll_group_connect_qpair(qpair);
 }
 
 int
 nvme_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair)
 {
+	/* Disconnected qpairs are reported only when the group is processed */
+	nvme_poll_group_kick(qpair->poll_group->group);
+
 	return nvme_transport_poll_group_disconnect_qpair(qpair);
 }
 
@@ -140,6 +295,35 @@ spdk_nvme_poll_group_process_completions(struct spdk_nvme_poll_group *group,
 	return error_reason ? error_reason : num_completions;
 }
 
+int64_t
+spdk_nvme_poll_group_wait(struct spdk_nvme_poll_group *group,
+			  spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
+{
+	uint64_t notify;
+	int64_t num_completions;
+	int rc;
+
+	if (group->event_pending) {
+		rc = read(group->event_fd, &notify, sizeof(notify));
+		if (rc < 0 && errno != EAGAIN) {
+			SPDK_ERRLOG("Failed to acknowledge poll group %p notification: %s\n", group,
+				    spdk_strerror(errno));
+		}
+		group->event_pending = false;
+	}
+
+	num_completions = spdk_nvme_poll_group_process_completions(group, 0, disconnected_qpair_cb);
+
+	/* Sockets may hold data that has already been read from the kernel, so they won't
+	 * signal it again. Come back for another pass while there is activity or while some
+	 * transport has to be polled. */
+	if (num_completions != 0 || group->num_polled_tgroups > 0) {
+		nvme_poll_group_kick(group);
+	}
+
+	return num_completions;
+}
+
 int
 spdk_nvme_poll_group_all_connected(struct spdk_nvme_poll_group *group)
 {
@@ -183,13 +367,20 @@ spdk_nvme_poll_group_destroy(struct spdk_nvme_poll_group *group)
 
 	STAILQ_FOREACH_SAFE(tgroup, &group->tgroups, link, tmp_tgroup) {
 		STAILQ_REMOVE(&group->tgroups, tgroup, spdk_nvme_transport_poll_group, link);
+		if (group->fgrp != NULL) {
+			nvme_poll_group_unregister_interrupts(group, tgroup);
+		}
 		if (nvme_transport_poll_group_destroy(tgroup) != 0) {
+			if (group->fgrp != NULL && nvme_poll_group_register_interrupts(group, tgroup) != 0) {
+				SPDK_ERRLOG("Failed to re-register interrupts of poll group %p\n", tgroup);
+			}
 			STAILQ_INSERT_TAIL(&group->tgroups, tgroup, link);
 			return -EBUSY;
 		}
 
 	}
 
+	nvme_poll_group_free_fd_group(group);
 	free(group);
 
 	return 0;
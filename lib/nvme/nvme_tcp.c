@@ -402,6 +402,7 @@ _pdu_write_done(void *cb_arg, int err)
 
 		TAILQ_INSERT_TAIL(&pgroup->needs_poll, tqpair, link);
 		tqpair->needs_poll = true;
+		nvme_poll_group_kick(pgroup->group.group);
 	}
 
 	TAILQ_REMOVE(&tqpair->send_queue, pdu, tailq);
@@ -1102,6 +1103,7 @@ tcp_data_recv_crc32_done(void *cb_arg, int status)
 		pgroup = nvme_tcp_poll_group(tqpair->qpair.poll_group);
 		TAILQ_INSERT_TAIL(&pgroup->needs_poll, tqpair, link);
 		tqpair->needs_poll = true;
+		nvme_poll_group_kick(pgroup->group.group);
 	}
 
 	if (spdk_unlikely(status)) {
@@ -2477,6 +2479,32 @@ nvme_tcp_poll_group_process_completions(struct spdk_nvme_transport_poll_group *t
 	return group->num_completions;
 }
 
+static int
+nvme_tcp_poll_group_sock_event(void *ctx)
+{
+	/* Socket events are handled by nvme_tcp_poll_group_process_completions() */
+	return 0;
+}
+
+static int
+nvme_tcp_poll_group_register_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+					struct spdk_fd_group *fgrp)
+{
+	struct nvme_tcp_poll_group *group = nvme_tcp_poll_group(tgroup);
+
+	return spdk_sock_group_register_interrupts(group->sock_group, fgrp,
+			nvme_tcp_poll_group_sock_event, group);
+}
+
+static void
+nvme_tcp_poll_group_unregister_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp)
+{
+	struct nvme_tcp_poll_group *group = nvme_tcp_poll_group(tgroup);
+
+	spdk_sock_group_unregister_interrupts(group->sock_group, fgrp);
+}
+
 static int
 nvme_tcp_poll_group_destroy(struct spdk_nvme_transport_poll_group *tgroup)
 {
@@ -2574,6 +2602,8 @@ const struct spdk_nvme_transport_ops tcp_ops = {
 	.poll_group_destroy = nvme_tcp_poll_group_destroy,
 	.poll_group_get_stats = nvme_tcp_poll_group_get_stats,
 	.poll_group_free_stats = nvme_tcp_poll_group_free_stats,
+	.poll_group_register_interrupts = nvme_tcp_poll_group_register_interrupts,
+	.poll_group_unregister_interrupts = nvme_tcp_poll_group_unregister_interrupts,
 };
 
 SPDK_NVME_TRANSPORT_REGISTER(tcp, &tcp_ops);
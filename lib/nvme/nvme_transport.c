@@ -719,6 +719,26 @@ nvme_transport_poll_group_destroy(struct spdk_nvme_transport_poll_group *tgroup)
 	return tgroup->transport->ops.poll_group_destroy(tgroup);
 }
 
+int
+nvme_transport_poll_group_register_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp)
+{
+	if (tgroup->transport->ops.poll_group_register_interrupts == NULL) {
+		return -ENOTSUP;
+	}
+
+	return tgroup->transport->ops.poll_group_register_interrupts(tgroup, fgrp);
+}
+
+void
+nvme_transport_poll_group_unregister_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp)
+{
+	if (tgroup->transport->ops.poll_group_unregister_interrupts != NULL) {
+		tgroup->transport->ops.poll_group_unregister_interrupts(tgroup, fgrp);
+	}
+}
+
 int
 nvme_transport_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair)
 {
@@ -22,6 +22,19 @@ SPDK_LOG_REGISTER_COMPONENT(nvmf)
 
 #define SPDK_NVMF_DEFAULT_MAX_SUBSYSTEMS 1024
 
+/* How often each poll group samples its load for qpair placement */
+#define NVMF_POLL_GROUP_LOAD_PERIOD_US	(100 * 1000)
+/* Load charged to a poll group for each qpair placed on it since its last sample, so that
+ * a burst of connections doesn't all land on the same group */
+#define NVMF_POLL_GROUP_LOAD_NEW_QPAIR	20
+/* Load charged to a poll group for each I/O qpair it hosts, so that idle connections are
+ * still spread evenly */
+#define NVMF_POLL_GROUP_LOAD_QPAIR	10
+
+/* How often a qpair being migrated is checked for being drained, and how long it may take */
+#define NVMF_QPAIR_MIGRATE_POLL_PERIOD_US	100
+#define NVMF_QPAIR_MIGRATE_TIMEOUT_US		(1000 * 1000)
+
 static TAILQ_HEAD(, spdk_nvmf_tgt) g_nvmf_tgts = TAILQ_HEAD_INITIALIZER(g_nvmf_tgts);
 
 typedef void (*nvmf_qpair_disconnect_cpl)(void *ctx, int status);
@@ -77,6 +90,50 @@ nvmf_poll_group_poll(void *ctx)
 	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+static void
+nvmf_poll_group_sample_load(struct spdk_nvmf_poll_group *group, uint64_t now, uint32_t busy)
+{
+	uint64_t completed, iops;
+
+	completed = __atomic_load_n(&group->stat.completed_nvme_io, __ATOMIC_RELAXED);
+	iops = (completed - group->load_completed_nvme_io) * spdk_get_ticks_hz() /
+	       (now - group->load_tsc);
+
+	group->load_tsc = now;
+	group->load_completed_nvme_io = completed;
+
+	/* Smooth the samples out so that a single burst doesn't steer placement */
+	__atomic_store_n(&group->load_busy, (group->load_busy * 3 + busy) / 4, __ATOMIC_RELAXED);
+	__atomic_store_n(&group->load_iops, (group->load_iops * 3 + iops) / 4, __ATOMIC_RELAXED);
+	__atomic_store_n(&group->load_new_qpairs, 0, __ATOMIC_RELAXED);
+}
+
+static int
+nvmf_poll_group_update_load(void *ctx)
+{
+	struct spdk_nvmf_poll_group *group = ctx;
+	struct spdk_thread_stats stats;
+	uint64_t now, busy_tsc, idle_tsc;
+	uint32_t busy = 0;
+
+	now = spdk_get_ticks();
+	if (spdk_thread_get_stats(&stats) != 0 || now <= group->load_tsc) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	busy_tsc = stats.busy_tsc - group->load_busy_tsc;
+	idle_tsc = stats.idle_tsc - group->load_idle_tsc;
+	if (busy_tsc + idle_tsc > 0) {
+		busy = busy_tsc * 1000 / (busy_tsc + idle_tsc);
+	}
+
+	group->load_busy_tsc = stats.busy_tsc;
+	group->load_idle_tsc = stats.idle_tsc;
+	nvmf_poll_group_sample_load(group, now, busy);
+
+	return SPDK_POLLER_IDLE;
+}
+
 /*
  * Reset and clean up the poll group (I/O channel code will actually free the
  * group).
@@ -111,6 +168,7 @@ nvmf_tgt_cleanup_poll_group(struct spdk_nvmf_poll_group *group)
 	free(group->sgroups);
 
 	spdk_poller_unregister(&group->poller);
+	spdk_poller_unregister(&group->load_poller);
 
 	if (group->destroy_cb_fn) {
 		group->destroy_cb_fn(group->destroy_cb_arg, 0);
@@ -129,6 +187,9 @@ nvmf_tgt_destroy_poll_group(void *io_device, void *ctx_buf)
 	SPDK_DTRACE_PROBE1_TICKS(nvmf_destroy_poll_group, spdk_thread_get_id(group->thread));
 
 	pthread_mutex_lock(&tgt->mutex);
+	if (tgt->next_poll_group == group) {
+		tgt->next_poll_group = TAILQ_NEXT(group, link);
+	}
 	TAILQ_REMOVE(&tgt->poll_groups, group, link);
 	tgt->num_poll_groups--;
 	pthread_mutex_unlock(&tgt->mutex);
@@ -181,6 +242,13 @@ nvmf_tgt_create_poll_group(void *io_device, void *ctx_buf)
 	pthread_mutex_init(&group->mutex, NULL);
 
 	group->poller = SPDK_POLLER_REGISTER(nvmf_poll_group_poll, group, 0);
+	group->load_tsc = spdk_get_ticks();
+	/* A timed poller would keep waking up a reactor in interrupt mode. The IOPS of the
+	 * group are sampled when placing qpairs instead, see nvmf_tgt_sample_load(). */
+	if (!spdk_interrupt_mode_is_enabled()) {
+		group->load_poller = SPDK_POLLER_REGISTER(nvmf_poll_group_update_load, group,
+				     NVMF_POLL_GROUP_LOAD_PERIOD_US);
+	}
 
 	SPDK_DTRACE_PROBE1_TICKS(nvmf_create_poll_group, spdk_thread_get_id(thread));
 
@@ -985,24 +1053,112 @@ _nvmf_poll_group_add(void *_ctx)
 	}
 }
 
+/*
+ * In interrupt mode the poll groups don't sample their own load. Sample their IOPS here,
+ * with the target's mutex held, once per period. The busy time of another thread isn't
+ * available, so only the IOPS count.
+ */
+static void
+nvmf_tgt_sample_load(struct spdk_nvmf_tgt *tgt)
+{
+	struct spdk_nvmf_poll_group *group;
+	uint64_t now, period;
+
+	if (!spdk_interrupt_mode_is_enabled()) {
+		return;
+	}
+
+	now = spdk_get_ticks();
+	period = NVMF_POLL_GROUP_LOAD_PERIOD_US * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		if (now - group->load_tsc >= period) {
+			nvmf_poll_group_sample_load(group, now, 0);
+		}
+	}
+}
+
+static uint32_t
+nvmf_poll_group_get_io_qpair_count(struct spdk_nvmf_poll_group *group)
+{
+	uint32_t count;
+
+	/* Just assume that unassociated qpairs will eventually be io
+	 * qpairs.  This is close enough for placing new qpairs.
+	 */
+	pthread_mutex_lock(&group->mutex);
+	count = group->stat.current_io_qpairs + group->current_unassociated_qpairs;
+	pthread_mutex_unlock(&group->mutex);
+
+	return count;
+}
+
+/*
+ * Pick the poll group with the lowest load. The load of a group is the share of time its
+ * thread was busy plus its IOPS relative to the busiest group, both in units of 0.1%, plus
+ * a fixed charge for each I/O qpair it hosts. Groups with the same load are picked in
+ * round-robin order.
+ */
+static struct spdk_nvmf_poll_group *
+nvmf_tgt_get_least_loaded_poll_group(struct spdk_nvmf_tgt *tgt)
+{
+	struct spdk_nvmf_poll_group *group, *first, *best = NULL;
+	uint64_t load, best_load = UINT64_MAX, iops, max_iops = 0;
+
+	pthread_mutex_lock(&tgt->mutex);
+	first = tgt->next_poll_group ? tgt->next_poll_group : TAILQ_FIRST(&tgt->poll_groups);
+	if (first == NULL) {
+		pthread_mutex_unlock(&tgt->mutex);
+		return NULL;
+	}
+
+	nvmf_tgt_sample_load(tgt);
+
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		max_iops = spdk_max(max_iops, __atomic_load_n(&group->load_iops, __ATOMIC_RELAXED));
+	}
+
+	group = first;
+	do {
+		iops = __atomic_load_n(&group->load_iops, __ATOMIC_RELAXED);
+		load = __atomic_load_n(&group->load_busy, __ATOMIC_RELAXED);
+		load += max_iops > 0 ? iops * 1000 / max_iops : 0;
+		load += (uint64_t)__atomic_load_n(&group->load_new_qpairs, __ATOMIC_RELAXED) *
+			NVMF_POLL_GROUP_LOAD_NEW_QPAIR;
+		load += (uint64_t)nvmf_poll_group_get_io_qpair_count(group) * NVMF_POLL_GROUP_LOAD_QPAIR;
+		if (load < best_load) {
+			best = group;
+			best_load = load;
+		}
+
+		group = TAILQ_NEXT(group, link);
+		if (group == NULL) {
+			group = TAILQ_FIRST(&tgt->poll_groups);
+		}
+	} while (group != first);
+
+	tgt->next_poll_group = TAILQ_NEXT(best, link);
+	__atomic_fetch_add(&best->load_new_qpairs, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&tgt->mutex);
+
+	return best;
+}
+
 void
 spdk_nvmf_tgt_new_qpair(struct spdk_nvmf_tgt *tgt, struct spdk_nvmf_qpair *qpair)
 {
 	struct spdk_nvmf_poll_group *group;
 	struct nvmf_new_qpair_ctx *ctx;
 
+	/* The transport only picks the poll group if the qpair has an affinity to one */
 	group = spdk_nvmf_get_optimal_poll_group(qpair);
 	if (group == NULL) {
-		if (tgt->next_poll_group == NULL) {
-			tgt->next_poll_group = TAILQ_FIRST(&tgt->poll_groups);
-			if (tgt->next_poll_group == NULL) {
-				SPDK_ERRLOG("No poll groups exist.\n");
-				spdk_nvmf_qpair_disconnect(qpair, NULL, NULL);
-				return;
-			}
+		group = nvmf_tgt_get_least_loaded_poll_group(tgt);
+		if (group == NULL) {
+			SPDK_ERRLOG("No poll groups exist.\n");
+			spdk_nvmf_qpair_disconnect(qpair, NULL, NULL);
+			return;
 		}
-		group = tgt->next_poll_group;
-		tgt->next_poll_group = TAILQ_NEXT(group, link);
 	}
 
 	ctx = calloc(1, sizeof(*ctx));
@@ -1060,6 +1216,7 @@ spdk_nvmf_poll_group_add(struct spdk_nvmf_poll_group *group,
 	qpair->group = group;
 	qpair->ctrlr = NULL;
 	qpair->disconnect_started = false;
+	qpair->migrate_ctx = NULL;
 
 	TAILQ_FOREACH(tgroup, &group->tgroups, link) {
 		if (tgroup->transport == qpair->transport) {
@@ -1223,6 +1380,234 @@ _nvmf_qpair_destroy(void *ctx, int status)
 	nvmf_transport_qpair_fini(qpair, _nvmf_transport_qpair_fini_complete, qpair_ctx);
 }
 
+struct nvmf_qpair_migrate_ctx {
+	struct spdk_nvmf_qpair			*qpair;
+	struct spdk_nvmf_tgt			*tgt;
+	struct spdk_nvmf_poll_group		*src;
+	/* The destination poll group is looked up again on this thread, as it may be
+	 * destroyed while the qpair drains */
+	struct spdk_thread			*dst_thread;
+	struct spdk_thread			*thread;
+	struct spdk_poller			*poller;
+	uint64_t				timeout_tsc;
+	/* Set once the qpair has left the source poll group */
+	bool					detached;
+	int					status;
+	spdk_nvmf_qpair_migrate_done_fn		cb_fn;
+	void					*cb_arg;
+};
+
+/* Whether the qpair is on its way between two poll groups and belongs to neither of them */
+static bool
+nvmf_qpair_is_migrating(struct spdk_nvmf_qpair *qpair)
+{
+	return qpair->migrate_ctx != NULL && qpair->migrate_ctx->detached;
+}
+
+static struct spdk_nvmf_transport_poll_group *
+nvmf_poll_group_get_tgroup(struct spdk_nvmf_poll_group *group,
+			   struct spdk_nvmf_transport *transport)
+{
+	struct spdk_nvmf_transport_poll_group *tgroup;
+
+	TAILQ_FOREACH(tgroup, &group->tgroups, link) {
+		if (tgroup->transport == transport) {
+			return tgroup;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+nvmf_qpair_migrate_done(void *_ctx)
+{
+	struct nvmf_qpair_migrate_ctx *ctx = _ctx;
+
+	if (ctx->cb_fn) {
+		ctx->cb_fn(ctx->cb_arg, ctx->status);
+	}
+
+	free(ctx);
+}
+
+static void
+nvmf_qpair_migrate_cancel(struct nvmf_qpair_migrate_ctx *ctx, int status)
+{
+	struct spdk_nvmf_qpair *qpair = ctx->qpair;
+
+	assert(!ctx->detached);
+	spdk_poller_unregister(&ctx->poller);
+	qpair->migrate_ctx = NULL;
+	nvmf_transport_qpair_quiesce(qpair, false);
+
+	ctx->status = status;
+	nvmf_qpair_migrate_done(ctx);
+}
+
+static struct spdk_nvmf_poll_group *
+nvmf_tgt_get_poll_group_by_thread(struct spdk_nvmf_tgt *tgt, struct spdk_thread *thread)
+{
+	struct spdk_nvmf_poll_group *group;
+
+	pthread_mutex_lock(&tgt->mutex);
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		if (group->thread == thread) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	return group;
+}
+
+static void
+_nvmf_qpair_migrate_attach(void *_ctx)
+{
+	struct nvmf_qpair_migrate_ctx *ctx = _ctx;
+	struct spdk_nvmf_qpair *qpair = ctx->qpair;
+	struct spdk_nvmf_poll_group *group;
+	struct spdk_nvmf_transport_poll_group *tgroup;
+	int rc = -EINVAL;
+
+	/* A poll group is only destroyed on its own thread, so it stays valid from here on */
+	group = nvmf_tgt_get_poll_group_by_thread(ctx->tgt, spdk_get_thread());
+	if (spdk_unlikely(group == NULL)) {
+		if (spdk_get_thread() != ctx->thread) {
+			SPDK_ERRLOG("Poll group of qpair %u of ctrlr %u is gone, moving it back\n",
+				    qpair->qid, qpair->ctrlr->cntlid);
+			ctx->status = -ENODEV;
+			spdk_thread_send_msg(ctx->thread, _nvmf_qpair_migrate_attach, ctx);
+			return;
+		}
+
+		SPDK_ERRLOG("No poll group left for qpair %u of ctrlr %u\n", qpair->qid,
+			    qpair->ctrlr->cntlid);
+		qpair->migrate_ctx = NULL;
+		ctx->status = -ENODEV;
+		nvmf_qpair_migrate_done(ctx);
+		return;
+	}
+
+	qpair->group = group;
+	qpair->migrate_ctx = NULL;
+	TAILQ_INSERT_TAIL(&group->qpairs, qpair, link);
+	group->stat.current_io_qpairs++;
+
+	tgroup = nvmf_poll_group_get_tgroup(group, qpair->transport);
+	if (tgroup != NULL) {
+		rc = nvmf_transport_poll_group_migrate(tgroup, qpair);
+	}
+
+	if (rc != 0) {
+		SPDK_ERRLOG("Unable to attach qpair %u of ctrlr %u to poll group %p: %s\n",
+			    qpair->qid, qpair->ctrlr->cntlid, group, spdk_strerror(-rc));
+		ctx->status = rc;
+		spdk_nvmf_qpair_disconnect(qpair, NULL, NULL);
+	} else {
+		nvmf_transport_qpair_quiesce(qpair, false);
+		/* The controller may have started disconnecting its qpairs while this one
+		 * wasn't on any poll group's list */
+		if (qpair->ctrlr->in_destruct) {
+			spdk_nvmf_qpair_disconnect(qpair, NULL, NULL);
+		}
+	}
+
+	spdk_thread_send_msg(ctx->thread, nvmf_qpair_migrate_done, ctx);
+}
+
+static int
+nvmf_qpair_migrate_poll(void *_ctx)
+{
+	struct nvmf_qpair_migrate_ctx *ctx = _ctx;
+	struct spdk_nvmf_qpair *qpair = ctx->qpair;
+	struct spdk_nvmf_poll_group *group = ctx->src;
+	struct spdk_nvmf_transport_poll_group *tgroup;
+	int rc;
+
+	if (!TAILQ_EMPTY(&qpair->outstanding) || !nvmf_transport_qpair_is_idle(qpair)) {
+		if (spdk_get_ticks() > ctx->timeout_tsc) {
+			SPDK_NOTICELOG("Qpair %u of ctrlr %u did not drain, cancelling migration\n",
+				       qpair->qid, qpair->ctrlr->cntlid);
+			nvmf_qpair_migrate_cancel(ctx, -ETIMEDOUT);
+		}
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&ctx->poller);
+
+	tgroup = nvmf_poll_group_get_tgroup(group, qpair->transport);
+	assert(tgroup != NULL);
+	rc = nvmf_transport_poll_group_remove(tgroup, qpair);
+	if (rc != 0) {
+		SPDK_ERRLOG("Cannot remove qpair=%p from transport group=%p\n", qpair, tgroup);
+	}
+
+	TAILQ_REMOVE(&group->qpairs, qpair, link);
+	assert(group->stat.current_io_qpairs > 0);
+	group->stat.current_io_qpairs--;
+	ctx->detached = true;
+
+	SPDK_DTRACE_PROBE3_TICKS(nvmf_qpair_migrate, qpair, spdk_thread_get_id(group->thread),
+				 spdk_thread_get_id(ctx->dst_thread));
+	spdk_thread_send_msg(ctx->dst_thread, _nvmf_qpair_migrate_attach, ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
+int
+spdk_nvmf_qpair_migrate(struct spdk_nvmf_qpair *qpair, struct spdk_nvmf_poll_group *group,
+			spdk_nvmf_qpair_migrate_done_fn cb_fn, void *cb_arg)
+{
+	struct nvmf_qpair_migrate_ctx *ctx;
+
+	assert(qpair->group->thread == spdk_get_thread());
+
+	if (qpair->qid == 0 || qpair->ctrlr == NULL || group == NULL) {
+		return -EINVAL;
+	}
+
+	if (qpair->group == group) {
+		return -EALREADY;
+	}
+
+	if (!nvmf_transport_qpair_migrate_supported(qpair)) {
+		return -ENOTSUP;
+	}
+
+	if (qpair->state != SPDK_NVMF_QPAIR_ACTIVE || qpair->disconnect_started ||
+	    qpair->migrate_ctx != NULL) {
+		return -EBUSY;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->qpair = qpair;
+	ctx->tgt = qpair->group->tgt;
+	ctx->src = qpair->group;
+	ctx->dst_thread = group->thread;
+	ctx->thread = spdk_get_thread();
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->timeout_tsc = spdk_get_ticks() + NVMF_QPAIR_MIGRATE_TIMEOUT_US * spdk_get_ticks_hz() /
+			   SPDK_SEC_TO_USEC;
+
+	ctx->poller = SPDK_POLLER_REGISTER(nvmf_qpair_migrate_poll, ctx,
+					   NVMF_QPAIR_MIGRATE_POLL_PERIOD_US);
+	if (ctx->poller == NULL) {
+		free(ctx);
+		return -ENOMEM;
+	}
+
+	qpair->migrate_ctx = ctx;
+	nvmf_transport_qpair_quiesce(qpair, true);
+
+	return 0;
+}
+
 static void
 _nvmf_qpair_disconnect_msg(void *ctx)
 {
@@ -1259,7 +1644,7 @@ spdk_nvmf_qpair_disconnect(struct spdk_nvmf_qpair *qpair, nvmf_qpair_disconnect_
 	}
 
 	assert(group != NULL);
-	if (spdk_get_thread() != group->thread) {
+	if (spdk_get_thread() != group->thread || nvmf_qpair_is_migrating(qpair)) {
 		/* clear the atomic so we can set it on the next call on the proper thread. */
 		__atomic_clear(&qpair->disconnect_started, __ATOMIC_RELAXED);
 		qpair_ctx = calloc(1, sizeof(struct nvmf_qpair_disconnect_ctx));
@@ -1275,6 +1660,11 @@ spdk_nvmf_qpair_disconnect(struct spdk_nvmf_qpair *qpair, nvmf_qpair_disconnect_
 		return 0;
 	}
 
+	if (qpair->migrate_ctx != NULL) {
+		/* The qpair hasn't drained yet, so it can simply stay where it is */
+		nvmf_qpair_migrate_cancel(qpair->migrate_ctx, -ECONNABORTED);
+	}
+
 	SPDK_DTRACE_PROBE2_TICKS(nvmf_qpair_disconnect, qpair, spdk_thread_get_id(group->thread));
 	assert(qpair->state == SPDK_NVMF_QPAIR_ACTIVE);
 	nvmf_qpair_set_state(qpair, SPDK_NVMF_QPAIR_DEACTIVATING);
@@ -1793,6 +2183,8 @@ spdk_nvmf_poll_group_dump_stat(struct spdk_nvmf_poll_group *group, struct spdk_j
 	spdk_json_write_named_uint32(w, "current_io_qpairs", group->stat.current_io_qpairs);
 	spdk_json_write_named_uint64(w, "pending_bdev_io", group->stat.pending_bdev_io);
 	spdk_json_write_named_uint64(w, "completed_nvme_io", group->stat.completed_nvme_io);
+	spdk_json_write_named_uint64(w, "load_iops", group->load_iops);
+	spdk_json_write_named_uint32(w, "load_busy", group->load_busy);
 
 	spdk_json_write_named_array_begin(w, "transports");
 
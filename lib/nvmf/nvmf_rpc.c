@@ -2196,6 +2196,157 @@ rpc_nvmf_get_stats(struct spdk_jsonrpc_request *request,
 
 SPDK_RPC_REGISTER("nvmf_get_stats", rpc_nvmf_get_stats, SPDK_RPC_RUNTIME)
 
+struct rpc_nvmf_migrate_qpair_ctx {
+	char				*tgt_name;
+	char				*nqn;
+	uint16_t			cntlid;
+	uint16_t			qid;
+	char				*thread;
+
+	struct spdk_nvmf_tgt		*tgt;
+	struct spdk_jsonrpc_request	*request;
+	bool				found;
+};
+
+static const struct spdk_json_object_decoder rpc_nvmf_migrate_qpair_decoders[] = {
+	{"tgt_name", offsetof(struct rpc_nvmf_migrate_qpair_ctx, tgt_name), spdk_json_decode_string, true},
+	{"nqn", offsetof(struct rpc_nvmf_migrate_qpair_ctx, nqn), spdk_json_decode_string},
+	{"cntlid", offsetof(struct rpc_nvmf_migrate_qpair_ctx, cntlid), spdk_json_decode_uint16},
+	{"qid", offsetof(struct rpc_nvmf_migrate_qpair_ctx, qid), spdk_json_decode_uint16},
+	{"thread", offsetof(struct rpc_nvmf_migrate_qpair_ctx, thread), spdk_json_decode_string},
+};
+
+static void
+free_rpc_nvmf_migrate_qpair_ctx(struct rpc_nvmf_migrate_qpair_ctx *ctx)
+{
+	free(ctx->tgt_name);
+	free(ctx->nqn);
+	free(ctx->thread);
+	free(ctx);
+}
+
+static void
+rpc_nvmf_migrate_qpair_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct rpc_nvmf_migrate_qpair_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, status, spdk_strerror(-status));
+	} else if (!ctx->found) {
+		spdk_jsonrpc_send_error_response(ctx->request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Qpair not found");
+	} else {
+		spdk_jsonrpc_send_bool_response(ctx->request, true);
+	}
+
+	free_rpc_nvmf_migrate_qpair_ctx(ctx);
+}
+
+static void
+rpc_nvmf_migrate_qpair_cb(void *cb_arg, int status)
+{
+	struct spdk_io_channel_iter *i = cb_arg;
+
+	spdk_for_each_channel_continue(i, status);
+}
+
+static void
+_rpc_nvmf_migrate_qpair(struct spdk_io_channel_iter *i)
+{
+	struct rpc_nvmf_migrate_qpair_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_nvmf_poll_group *group = spdk_io_channel_get_ctx(ch);
+	struct spdk_nvmf_poll_group *dst;
+	struct spdk_nvmf_qpair *qpair;
+	int rc;
+
+	if (ctx->found) {
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+
+	TAILQ_FOREACH(qpair, &group->qpairs, link) {
+		if (qpair->ctrlr != NULL && qpair->ctrlr->cntlid == ctx->cntlid &&
+		    qpair->qid == ctx->qid &&
+		    strcmp(spdk_nvmf_subsystem_get_nqn(qpair->ctrlr->subsys), ctx->nqn) == 0) {
+			ctx->found = true;
+			/* The destination poll group can't go away while tgt->mutex is held */
+			rc = -ENODEV;
+			pthread_mutex_lock(&ctx->tgt->mutex);
+			TAILQ_FOREACH(dst, &ctx->tgt->poll_groups, link) {
+				if (strcmp(spdk_thread_get_name(dst->thread), ctx->thread) == 0) {
+					rc = spdk_nvmf_qpair_migrate(qpair, dst, rpc_nvmf_migrate_qpair_cb, i);
+					break;
+				}
+			}
+			pthread_mutex_unlock(&ctx->tgt->mutex);
+			if (rc != 0) {
+				spdk_for_each_channel_continue(i, rc);
+			}
+			return;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+rpc_nvmf_migrate_qpair(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_nvmf_migrate_qpair_ctx *ctx;
+	struct spdk_nvmf_poll_group *group;
+	struct spdk_nvmf_tgt *tgt;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Memory allocation error");
+		return;
+	}
+	ctx->request = request;
+
+	if (spdk_json_decode_object(params, rpc_nvmf_migrate_qpair_decoders,
+				    SPDK_COUNTOF(rpc_nvmf_migrate_qpair_decoders),
+				    ctx)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		free_rpc_nvmf_migrate_qpair_ctx(ctx);
+		return;
+	}
+
+	tgt = spdk_nvmf_get_tgt(ctx->tgt_name);
+	if (!tgt) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Unable to find a target.");
+		free_rpc_nvmf_migrate_qpair_ctx(ctx);
+		return;
+	}
+
+	ctx->tgt = tgt;
+
+	pthread_mutex_lock(&tgt->mutex);
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		if (strcmp(spdk_thread_get_name(group->thread), ctx->thread) == 0) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	if (!group) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "No poll group on thread %s", ctx->thread);
+		free_rpc_nvmf_migrate_qpair_ctx(ctx);
+		return;
+	}
+
+	spdk_for_each_channel(tgt,
+			      _rpc_nvmf_migrate_qpair,
+			      ctx,
+			      rpc_nvmf_migrate_qpair_done);
+}
+SPDK_RPC_REGISTER("nvmf_migrate_qpair", rpc_nvmf_migrate_qpair, SPDK_RPC_RUNTIME)
+
 static void
 dump_nvmf_ctrlr(struct spdk_json_write_ctx *w, struct spdk_nvmf_ctrlr *ctrlr)
 {
@@ -428,11 +428,6 @@ struct spdk_nvmf_rdma_poll_group {
 	TAILQ_ENTRY(spdk_nvmf_rdma_poll_group)		link;
 };
 
-struct spdk_nvmf_rdma_conn_sched {
-	struct spdk_nvmf_rdma_poll_group *next_admin_pg;
-	struct spdk_nvmf_rdma_poll_group *next_io_pg;
-};
-
 /* Assuming rdma_cm uses just one protection domain per ibv_context. */
 struct spdk_nvmf_rdma_device {
 	struct ibv_device_attr			attr;
@@ -468,8 +463,6 @@ struct spdk_nvmf_rdma_transport {
 	struct spdk_nvmf_transport	transport;
 	struct rdma_transport_opts	rdma_opts;
 
-	struct spdk_nvmf_rdma_conn_sched conn_sched;
-
 	struct rdma_event_channel	*event_channel;
 
 	struct spdk_mempool		*data_wr_pool;
@@ -3969,86 +3962,10 @@ nvmf_rdma_poll_group_create(struct spdk_nvmf_transport *transport,
 	}
 
 	TAILQ_INSERT_TAIL(&rtransport->poll_groups, rgroup, link);
-	if (rtransport->conn_sched.next_admin_pg == NULL) {
-		rtransport->conn_sched.next_admin_pg = rgroup;
-		rtransport->conn_sched.next_io_pg = rgroup;
-	}
 
 	return &rgroup->group;
 }
 
-static uint32_t
-nvmf_poll_group_get_io_qpair_count(struct spdk_nvmf_poll_group *pg)
-{
-	uint32_t count;
-
-	/* Just assume that unassociated qpairs will eventually be io
-	 * qpairs.  This is close enough for the use cases for this
-	 * function.
-	 */
-	pthread_mutex_lock(&pg->mutex);
-	count = pg->stat.current_io_qpairs + pg->current_unassociated_qpairs;
-	pthread_mutex_unlock(&pg->mutex);
-
-	return count;
-}
-
-static struct spdk_nvmf_transport_poll_group *
-nvmf_rdma_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
-{
-	struct spdk_nvmf_rdma_transport *rtransport;
-	struct spdk_nvmf_rdma_poll_group **pg;
-	struct spdk_nvmf_transport_poll_group *result;
-	uint32_t count;
-
-	rtransport = SPDK_CONTAINEROF(qpair->transport, struct spdk_nvmf_rdma_transport, transport);
-
-	if (TAILQ_EMPTY(&rtransport->poll_groups)) {
-		return NULL;
-	}
-
-	if (qpair->qid == 0) {
-		pg = &rtransport->conn_sched.next_admin_pg;
-	} else {
-		struct spdk_nvmf_rdma_poll_group *pg_min, *pg_start, *pg_current;
-		uint32_t min_value;
-
-		pg = &rtransport->conn_sched.next_io_pg;
-		pg_min = *pg;
-		pg_start = *pg;
-		pg_current = *pg;
-		min_value = nvmf_poll_group_get_io_qpair_count(pg_current->group.group);
-
-		while ((count = nvmf_poll_group_get_io_qpair_count(pg_current->group.group)) > 0) {
-			pg_current = TAILQ_NEXT(pg_current, link);
-			if (pg_current == NULL) {
-				pg_current = TAILQ_FIRST(&rtransport->poll_groups);
-			}
-
-			if (count < min_value) {
-				min_value = count;
-				pg_min = pg_current;
-			}
-
-			if (pg_current == pg_start) {
-				break;
-			}
-		}
-		*pg = pg_min;
-	}
-
-	assert(*pg != NULL);
-
-	result = &(*pg)->group;
-
-	*pg = TAILQ_NEXT(*pg, link);
-	if (*pg == NULL) {
-		*pg = TAILQ_FIRST(&rtransport->poll_groups);
-	}
-
-	return result;
-}
-
 static void
 nvmf_rdma_poller_destroy(struct spdk_nvmf_rdma_poller *poller)
 {
@@ -4086,7 +4003,7 @@ nvmf_rdma_poller_destroy(struct spdk_nvmf_rdma_poller *poller)
 static void
 nvmf_rdma_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 {
-	struct spdk_nvmf_rdma_poll_group	*rgroup, *next_rgroup;
+	struct spdk_nvmf_rdma_poll_group	*rgroup;
 	struct spdk_nvmf_rdma_poller		*poller, *tmp;
 	struct spdk_nvmf_rdma_transport		*rtransport;
 
@@ -4108,17 +4025,7 @@ nvmf_rdma_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 
 	rtransport = SPDK_CONTAINEROF(rgroup->group.transport, struct spdk_nvmf_rdma_transport, transport);
 
-	next_rgroup = TAILQ_NEXT(rgroup, link);
 	TAILQ_REMOVE(&rtransport->poll_groups, rgroup, link);
-	if (next_rgroup == NULL) {
-		next_rgroup = TAILQ_FIRST(&rtransport->poll_groups);
-	}
-	if (rtransport->conn_sched.next_admin_pg == rgroup) {
-		rtransport->conn_sched.next_admin_pg = next_rgroup;
-	}
-	if (rtransport->conn_sched.next_io_pg == rgroup) {
-		rtransport->conn_sched.next_io_pg = next_rgroup;
-	}
 
 	free(rgroup);
 }
@@ -4989,7 +4896,6 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_rdma = {
 	.listener_discover = nvmf_rdma_discover,
 
 	.poll_group_create = nvmf_rdma_poll_group_create,
-	.get_optimal_poll_group = nvmf_rdma_get_optimal_poll_group,
 	.poll_group_destroy = nvmf_rdma_poll_group_destroy,
 	.poll_group_add = nvmf_rdma_poll_group_add,
 	.poll_group_remove = nvmf_rdma_poll_group_remove,
@@ -45,6 +45,9 @@
 #define SPDK_NVMF_TCP_DEFAULT_BUFFER_CACHE_SIZE UINT32_MAX
 #define SPDK_NVMF_TCP_DEFAULT_DIF_INSERT_OR_STRIP false
 #define SPDK_NVMF_TCP_DEFAULT_ABORT_TIMEOUT_SEC 1
+/* Period of the abort retry poller in interrupt mode, where a busy poller would keep the
+ * reactor from sleeping until the abort timeout expires. */
+#define NVMF_TCP_ABORT_INTR_POLL_PERIOD_US 1000
 
 #define TCP_PSK_INVALID_PERMISSIONS 0177
 
@@ -276,6 +279,9 @@ struct spdk_nvmf_tcp_qpair {
 	bool					host_hdgst_enable;
 	bool					host_ddgst_enable;
 
+	/* Don't start reading new PDUs, the qpair is being moved to another poll group */
+	bool					quiesced;
+
 	/* This is a spare PDU used for sending special management
 	 * operations. Primarily, this is used for the initial
 	 * connection response and c2h termination request. */
@@ -329,12 +335,22 @@ struct spdk_nvmf_tcp_poll_group {
 	struct spdk_io_channel			*accel_channel;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
+	/* Interrupt mode: the sock group's fds and an eventfd used to ask for another poll */
+	struct spdk_fd_group			*fgrp;
+	struct spdk_interrupt			*intr;
+	int					event_fd;
+	bool					event_pending;
+
 	TAILQ_ENTRY(spdk_nvmf_tcp_poll_group)	link;
 };
 
 struct spdk_nvmf_tcp_port {
 	const struct spdk_nvme_transport_id	*trid;
 	struct spdk_sock			*listen_sock;
+	struct spdk_nvmf_transport		*transport;
+	struct spdk_interrupt			*listen_intr;
+	/* Accepts connections in interrupt mode if the socket has no interrupt support */
+	struct spdk_poller			*accept_poller;
 	TAILQ_ENTRY(spdk_nvmf_tcp_port)		link;
 };
 
@@ -622,6 +638,12 @@ nvmf_tcp_destroy(struct spdk_nvmf_transport *transport,
 
 static int nvmf_tcp_accept(void *ctx);
 
+static void
+nvmf_tcp_set_intr_mode_noop(struct spdk_poller *poller, void *arg, bool interrupt_mode)
+{
+	/* Nothing to do, the interrupts are registered for the whole lifetime of the poller. */
+}
+
 static struct spdk_nvmf_transport *
 nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 {
@@ -748,9 +770,39 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		return NULL;
 	}
 
+	/* In interrupt mode, connections are accepted when the listening sockets become readable */
+	spdk_poller_register_interrupt(ttransport->accept_poller, nvmf_tcp_set_intr_mode_noop,
+				       NULL);
+
 	return &ttransport->transport;
 }
 
+static int _nvmf_tcp_port_accept(void *ctx);
+
+static int
+nvmf_tcp_port_register_interrupt(struct spdk_nvmf_tcp_port *port)
+{
+	int fd;
+
+	fd = spdk_sock_get_interrupt_fd(port->listen_sock);
+	if (fd < 0) {
+		/* The transport's accept poller doesn't run in interrupt mode, so poll this port */
+		SPDK_WARNLOG("Socket implementation %s does not support interrupts, polling %s port %s\n",
+			     spdk_sock_get_impl_name(port->listen_sock), port->trid->traddr,
+			     port->trid->trsvcid);
+		port->accept_poller = SPDK_POLLER_REGISTER(_nvmf_tcp_port_accept, port,
+				      port->transport->opts.acceptor_poll_rate);
+		return port->accept_poller != NULL ? 0 : -ENOMEM;
+	}
+
+	port->listen_intr = SPDK_INTERRUPT_REGISTER(fd, _nvmf_tcp_port_accept, port);
+	if (port->listen_intr == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int
 nvmf_tcp_trsvcid_to_int(const char *trsvcid)
 {
@@ -876,6 +928,7 @@ nvmf_tcp_listen(struct spdk_nvmf_transport *transport, const struct spdk_nvme_tr
 	struct spdk_sock_impl_opts impl_opts;
 	size_t impl_opts_size = sizeof(impl_opts);
 	struct spdk_sock_opts opts;
+	int rc;
 
 	if (!strlen(trid->trsvcid)) {
 		SPDK_ERRLOG("Service id is required\n");
@@ -897,6 +950,7 @@ nvmf_tcp_listen(struct spdk_nvmf_transport *transport, const struct spdk_nvme_tr
 	}
 
 	port->trid = trid;
+	port->transport = transport;
 
 	sock_impl_name = NULL;
 
@@ -940,6 +994,15 @@ nvmf_tcp_listen(struct spdk_nvmf_transport *transport, const struct spdk_nvme_tr
 		return -EINVAL;
 	}
 
+	if (spdk_interrupt_mode_is_enabled()) {
+		rc = nvmf_tcp_port_register_interrupt(port);
+		if (rc != 0) {
+			spdk_sock_close(&port->listen_sock);
+			free(port);
+			return rc;
+		}
+	}
+
 	SPDK_NOTICELOG("*** NVMe/TCP Target Listening on %s port %s ***\n",
 		       trid->traddr, trid->trsvcid);
 
@@ -962,6 +1025,8 @@ nvmf_tcp_stop_listen(struct spdk_nvmf_transport *transport,
 	port = nvmf_tcp_find_port(ttransport, trid);
 	if (port) {
 		TAILQ_REMOVE(&ttransport->ports, port, link);
+		spdk_interrupt_unregister(&port->listen_intr);
+		spdk_poller_unregister(&port->accept_poller);
 		spdk_sock_close(&port->listen_sock);
 		free(port);
 	}
@@ -1363,6 +1428,17 @@ nvmf_tcp_accept(void *ctx)
 	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+static int
+_nvmf_tcp_port_accept(void *ctx)
+{
+	struct spdk_nvmf_tcp_port *port = ctx;
+	uint32_t count;
+
+	count = nvmf_tcp_port_accept(port->transport, port);
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 nvmf_tcp_discover(struct spdk_nvmf_transport *transport,
 		  struct spdk_nvme_transport_id *trid,
@@ -1434,18 +1510,147 @@ nvmf_tcp_control_msg_list_free(struct spdk_nvmf_tcp_control_msg_list *list)
 	free(list);
 }
 
+static void
+nvmf_tcp_poll_group_kick(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	uint64_t notify = 1;
+	int rc;
+
+	if (tgroup->intr == NULL || tgroup->event_pending) {
+		return;
+	}
+
+	rc = write(tgroup->event_fd, &notify, sizeof(notify));
+	if (rc < 0) {
+		SPDK_ERRLOG("Failed to notify tgroup=%p: %s\n", tgroup, spdk_strerror(errno));
+		return;
+	}
+
+	tgroup->event_pending = true;
+}
+
+static int nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group);
+
+static int
+nvmf_tcp_poll_group_intr(void *ctx)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = ctx;
+	uint64_t notify;
+	int rc;
+
+	/* Polling is paused, see spdk_nvmf_tgt_pause_polling() */
+	if (spdk_unlikely(tgroup->group.group->poller == NULL)) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	if (tgroup->event_pending) {
+		rc = read(tgroup->event_fd, &notify, sizeof(notify));
+		if (rc < 0 && errno != EAGAIN) {
+			SPDK_ERRLOG("Failed to acknowledge tgroup=%p notification: %s\n", tgroup,
+				    spdk_strerror(errno));
+		}
+		tgroup->event_pending = false;
+	}
+
+	rc = nvmf_tcp_poll_group_poll(&tgroup->group);
+
+	/* Sockets with data left in their receive pipe won't signal it again, and requests
+	 * waiting for buffers or for a free request slot need to be retried, so come back
+	 * for another pass. */
+	if (rc > 0 || !STAILQ_EMPTY(&tgroup->group.pending_buf_queue) ||
+	    !TAILQ_EMPTY(&tgroup->await_req)) {
+		nvmf_tcp_poll_group_kick(tgroup);
+	}
+
+	return rc > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static int
+nvmf_tcp_poll_group_event(void *ctx)
+{
+	/* Events are handled by nvmf_tcp_poll_group_intr() */
+	return 0;
+}
+
+static void
+nvmf_tcp_poll_group_unregister_interrupt(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	if (tgroup->fgrp == NULL) {
+		return;
+	}
+
+	spdk_interrupt_unregister(&tgroup->intr);
+	spdk_sock_group_unregister_interrupts(tgroup->sock_group, tgroup->fgrp);
+	if (tgroup->event_fd >= 0) {
+		spdk_fd_group_remove(tgroup->fgrp, tgroup->event_fd);
+		close(tgroup->event_fd);
+		tgroup->event_fd = -1;
+	}
+	spdk_fd_group_destroy(tgroup->fgrp);
+	tgroup->fgrp = NULL;
+}
+
+static int
+nvmf_tcp_poll_group_register_interrupt(struct spdk_nvmf_tcp_poll_group *tgroup,
+				       struct spdk_nvmf_poll_group *group)
+{
+	int rc;
+
+	rc = spdk_fd_group_create(&tgroup->fgrp);
+	if (rc != 0) {
+		tgroup->fgrp = NULL;
+		return rc;
+	}
+
+	tgroup->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (tgroup->event_fd < 0) {
+		rc = -errno;
+		goto err;
+	}
+
+	rc = SPDK_FD_GROUP_ADD(tgroup->fgrp, tgroup->event_fd, nvmf_tcp_poll_group_event, tgroup);
+	if (rc != 0) {
+		close(tgroup->event_fd);
+		tgroup->event_fd = -1;
+		goto err;
+	}
+
+	rc = spdk_sock_group_register_interrupts(tgroup->sock_group, tgroup->fgrp,
+			nvmf_tcp_poll_group_event, tgroup);
+	if (rc != 0) {
+		goto err;
+	}
+
+	tgroup->intr = SPDK_INTERRUPT_REGISTER(spdk_fd_group_get_fd(tgroup->fgrp),
+					       nvmf_tcp_poll_group_intr, tgroup);
+	if (tgroup->intr == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	/* The poll group's poller is driven by our interrupt from now on */
+	spdk_poller_register_interrupt(group->poller, nvmf_tcp_set_intr_mode_noop, NULL);
+
+	return 0;
+err:
+	nvmf_tcp_poll_group_unregister_interrupt(tgroup);
+	return rc;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 			   struct spdk_nvmf_poll_group *group)
 {
 	struct spdk_nvmf_tcp_transport	*ttransport;
 	struct spdk_nvmf_tcp_poll_group *tgroup;
+	int rc;
 
 	tgroup = calloc(1, sizeof(*tgroup));
 	if (!tgroup) {
 		return NULL;
 	}
 
+	tgroup->event_fd = -1;
 	tgroup->sock_group = spdk_sock_group_create(&tgroup->group);
 	if (!tgroup->sock_group) {
 		goto cleanup;
@@ -1472,6 +1677,19 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 		goto cleanup;
 	}
 
+	if (spdk_interrupt_mode_is_enabled()) {
+		rc = nvmf_tcp_poll_group_register_interrupt(tgroup, group);
+		if (rc == -ENOTSUP) {
+			/* The poll group's poller stays a busy poller */
+			SPDK_WARNLOG("Socket implementation does not support interrupts, polling tgroup=%p\n",
+				     tgroup);
+		} else if (rc != 0) {
+			SPDK_ERRLOG("Cannot register interrupts for tgroup=%p: %s\n", tgroup,
+				    spdk_strerror(-rc));
+			goto cleanup;
+		}
+	}
+
 	TAILQ_INSERT_TAIL(&ttransport->poll_groups, tgroup, link);
 	if (ttransport->next_pg == NULL) {
 		ttransport->next_pg = tgroup;
@@ -1505,20 +1723,20 @@ nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 
 	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
 	rc = spdk_sock_get_optimal_sock_group(tqpair->sock, &group, hint);
-	if (rc != 0) {
+	if (rc != 0 || group == NULL) {
+		/* No affinity, let the target place the qpair by the load of its poll groups */
 		return NULL;
-	} else if (group != NULL) {
-		/* Optimal poll group was found */
-		return spdk_sock_group_get_ctx(group);
 	}
 
-	/* The hint was used for optimal poll group, advance next_pg. */
-	*pg = TAILQ_NEXT(*pg, link);
-	if (*pg == NULL) {
-		*pg = TAILQ_FIRST(&ttransport->poll_groups);
+	if (group == hint) {
+		/* The hint was used for a new placement id, advance next_pg. */
+		*pg = TAILQ_NEXT(*pg, link);
+		if (*pg == NULL) {
+			*pg = TAILQ_FIRST(&ttransport->poll_groups);
+		}
 	}
 
-	return spdk_sock_group_get_ctx(hint);
+	return spdk_sock_group_get_ctx(group);
 }
 
 static void
@@ -1528,6 +1746,7 @@ nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 	struct spdk_nvmf_tcp_transport *ttransport;
 
 	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	nvmf_tcp_poll_group_unregister_interrupt(tgroup);
 	spdk_sock_group_close(&tgroup->sock_group);
 	if (tgroup->control_msg_list) {
 		nvmf_tcp_control_msg_list_free(tgroup->control_msg_list);
@@ -2315,19 +2534,28 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				return rc;
 			}
 
-			rc = nvme_tcp_read_data(tqpair->sock,
-						sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
-						(void *)&pdu->hdr.common + pdu->ch_valid_bytes);
-			if (rc < 0) {
-				SPDK_DEBUGLOG(nvmf_tcp, "will disconnect tqpair=%p\n", tqpair);
-				nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
-				break;
-			} else if (rc > 0) {
-				pdu->ch_valid_bytes += rc;
-				spdk_trace_record(TRACE_TCP_READ_FROM_SOCKET_DONE, tqpair->qpair.qid, rc, 0, tqpair);
+			if (pdu->ch_valid_bytes < sizeof(struct spdk_nvme_tcp_common_pdu_hdr)) {
+				rc = nvme_tcp_read_data(tqpair->sock,
+							sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
+							(void *)&pdu->hdr.common + pdu->ch_valid_bytes);
+				if (rc < 0) {
+					SPDK_DEBUGLOG(nvmf_tcp, "will disconnect tqpair=%p\n", tqpair);
+					nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
+					break;
+				} else if (rc > 0) {
+					pdu->ch_valid_bytes += rc;
+					spdk_trace_record(TRACE_TCP_READ_FROM_SOCKET_DONE, tqpair->qpair.qid, rc, 0, tqpair);
+				}
+
+				if (pdu->ch_valid_bytes < sizeof(struct spdk_nvme_tcp_common_pdu_hdr)) {
+					return NVME_TCP_PDU_IN_PROGRESS;
+				}
 			}
 
-			if (pdu->ch_valid_bytes < sizeof(struct spdk_nvme_tcp_common_pdu_hdr)) {
+			/* Hold new commands back while the qpair is quiesced. The other PDUs (H2C data,
+			 * term requests) belong to commands already received and are let through. */
+			if (spdk_unlikely(tqpair->quiesced) &&
+			    pdu->hdr.common.pdu_type == SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD) {
 				return NVME_TCP_PDU_IN_PROGRESS;
 			}
 
@@ -3239,6 +3467,9 @@ nvmf_tcp_poll_group_add(struct spdk_nvmf_transport_poll_group *group,
 	nvmf_tcp_qpair_set_state(tqpair, NVME_TCP_QPAIR_STATE_INVALID);
 	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
 
+	/* The socket may already have data buffered in user space */
+	nvmf_tcp_poll_group_kick(tgroup);
+
 	return 0;
 }
 
@@ -3271,6 +3502,70 @@ nvmf_tcp_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 	return rc;
 }
 
+static int
+nvmf_tcp_poll_group_migrate(struct spdk_nvmf_transport_poll_group *group,
+			    struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvmf_tcp_poll_group	*tgroup;
+	struct spdk_nvmf_tcp_qpair	*tqpair;
+	int				rc;
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
+
+	SPDK_DEBUGLOG(nvmf_tcp, "migrate tqpair=%p to the tgroup=%p\n", tqpair, tgroup);
+	assert(tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY ||
+	       tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH);
+
+	tqpair->group = tgroup;
+	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
+
+	rc = spdk_sock_group_add_sock(tgroup->sock_group, tqpair->sock,
+				      nvmf_tcp_sock_cb, tqpair);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not add sock to sock_group: %s (%d)\n",
+			    spdk_strerror(errno), errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+nvmf_tcp_qpair_quiesce(struct spdk_nvmf_qpair *qpair, bool quiesce)
+{
+	struct spdk_nvmf_tcp_qpair *tqpair;
+
+	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
+	tqpair->quiesced = quiesce;
+	if (!quiesce) {
+		/* The header of a held back command has already been read from the socket,
+		 * so the socket won't necessarily report it again */
+		if (tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH) {
+			nvmf_tcp_sock_cb(tqpair, tqpair->group->sock_group, tqpair->sock);
+		}
+		/* Commands may have been left in the socket while the qpair was quiesced */
+		nvmf_tcp_poll_group_kick(tqpair->group);
+	}
+}
+
+static bool
+nvmf_tcp_qpair_is_idle(struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvmf_tcp_qpair *tqpair;
+
+	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
+
+	/* A response is only freed once it has been written out, so with every request
+	 * free there's nothing left in the socket's send queue either. With no request
+	 * in flight, a PDU whose header is being read can only be a new command, which
+	 * is picked up again on the other poll group. */
+	return tqpair->state == NVME_TCP_QPAIR_STATE_RUNNING &&
+	       (tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY ||
+		tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH) &&
+	       tqpair->state_cntr[TCP_REQUEST_STATE_FREE] == tqpair->resource_count;
+}
+
 static int
 nvmf_tcp_req_complete(struct spdk_nvmf_request *req)
 {
@@ -3459,7 +3754,9 @@ _nvmf_tcp_qpair_abort_request(void *ctx)
 	case TCP_REQUEST_STATE_AWAITING_R2T_ACK:
 	case TCP_REQUEST_STATE_TRANSFERRING_HOST_TO_CONTROLLER:
 		if (spdk_get_ticks() < req->timeout_tsc) {
-			req->poller = SPDK_POLLER_REGISTER(_nvmf_tcp_qpair_abort_request, req, 0);
+			req->poller = SPDK_POLLER_REGISTER(_nvmf_tcp_qpair_abort_request, req,
+							   spdk_interrupt_mode_is_enabled() ?
+							   NVMF_TCP_ABORT_INTR_POLL_PERIOD_US : 0);
 			return SPDK_POLLER_BUSY;
 		}
 		break;
@@ -3764,6 +4061,7 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.poll_group_destroy = nvmf_tcp_poll_group_destroy,
 	.poll_group_add = nvmf_tcp_poll_group_add,
 	.poll_group_remove = nvmf_tcp_poll_group_remove,
+	.poll_group_migrate = nvmf_tcp_poll_group_migrate,
 	.poll_group_poll = nvmf_tcp_poll_group_poll,
 
 	.req_free = nvmf_tcp_req_free,
@@ -3774,6 +4072,8 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.qpair_get_peer_trid = nvmf_tcp_qpair_get_peer_trid,
 	.qpair_get_listen_trid = nvmf_tcp_qpair_get_listen_trid,
 	.qpair_abort_request = nvmf_tcp_qpair_abort_request,
+	.qpair_quiesce = nvmf_tcp_qpair_quiesce,
+	.qpair_is_idle = nvmf_tcp_qpair_is_idle,
 	.subsystem_add_host = nvmf_tcp_subsystem_add_host,
 	.subsystem_remove_host = nvmf_tcp_subsystem_remove_host,
 };
@@ -709,6 +709,38 @@ nvmf_transport_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 	return rc;
 }
 
+int
+nvmf_transport_poll_group_migrate(struct spdk_nvmf_transport_poll_group *group,
+				  struct spdk_nvmf_qpair *qpair)
+{
+	SPDK_DTRACE_PROBE3(nvmf_transport_poll_group_migrate, qpair, qpair->qid,
+			   spdk_thread_get_id(group->group->thread));
+
+	assert(qpair->transport == group->transport);
+	return group->transport->ops->poll_group_migrate(group, qpair);
+}
+
+bool
+nvmf_transport_qpair_migrate_supported(struct spdk_nvmf_qpair *qpair)
+{
+	const struct spdk_nvmf_transport_ops *ops = qpair->transport->ops;
+
+	return ops->qpair_quiesce != NULL && ops->qpair_is_idle != NULL &&
+	       ops->poll_group_migrate != NULL && ops->poll_group_remove != NULL;
+}
+
+void
+nvmf_transport_qpair_quiesce(struct spdk_nvmf_qpair *qpair, bool quiesce)
+{
+	qpair->transport->ops->qpair_quiesce(qpair, quiesce);
+}
+
+bool
+nvmf_transport_qpair_is_idle(struct spdk_nvmf_qpair *qpair)
+{
+	return qpair->transport->ops->qpair_is_idle(qpair);
+}
+
 int
 nvmf_transport_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 {
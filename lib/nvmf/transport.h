@@ -31,6 +31,15 @@ int nvmf_transport_poll_group_remove(struct spdk_nvmf_transport_poll_group *grou
 
 int nvmf_transport_poll_group_poll(struct spdk_nvmf_transport_poll_group *group);
 
+int nvmf_transport_poll_group_migrate(struct spdk_nvmf_transport_poll_group *group,
+				      struct spdk_nvmf_qpair *qpair);
+
+bool nvmf_transport_qpair_migrate_supported(struct spdk_nvmf_qpair *qpair);
+
+void nvmf_transport_qpair_quiesce(struct spdk_nvmf_qpair *qpair, bool quiesce);
+
+bool nvmf_transport_qpair_is_idle(struct spdk_nvmf_qpair *qpair);
+
 int nvmf_transport_req_free(struct spdk_nvmf_request *req);
 
 int nvmf_transport_req_complete(struct spdk_nvmf_request *req);
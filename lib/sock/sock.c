@@ -562,6 +562,16 @@ spdk_sock_is_connected(struct spdk_sock *sock)
 	return sock->net_impl->is_connected(sock);
 }
 
+int
+spdk_sock_get_interrupt_fd(struct spdk_sock *sock)
+{
+	if (sock->net_impl->get_interrupt_fd == NULL) {
+		return -1;
+	}
+
+	return sock->net_impl->get_interrupt_fd(sock);
+}
+
 struct spdk_sock_group *
 spdk_sock_group_create(void *ctx)
 {
@@ -793,6 +803,47 @@ spdk_sock_group_close(struct spdk_sock_group **group)
 	return 0;
 }
 
+int
+spdk_sock_group_register_interrupts(struct spdk_sock_group *group, struct spdk_fd_group *fgrp,
+				    spdk_fd_fn fn, void *arg)
+{
+	struct spdk_sock_group_impl *group_impl;
+	int rc;
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		if (group_impl->net_impl->group_impl_register_interrupt == NULL) {
+			SPDK_DEBUGLOG(sock, "net(%s) does not support interrupts\n",
+				      group_impl->net_impl->name);
+			rc = -ENOTSUP;
+			goto err;
+		}
+
+		rc = group_impl->net_impl->group_impl_register_interrupt(group_impl, fgrp, fn, arg);
+		if (rc != 0) {
+			SPDK_ERRLOG("group_impl_register_interrupt for net(%s) failed\n",
+				    group_impl->net_impl->name);
+			goto err;
+		}
+	}
+
+	return 0;
+err:
+	spdk_sock_group_unregister_interrupts(group, fgrp);
+	return rc;
+}
+
+void
+spdk_sock_group_unregister_interrupts(struct spdk_sock_group *group, struct spdk_fd_group *fgrp)
+{
+	struct spdk_sock_group_impl *group_impl;
+
+	STAILQ_FOREACH(group_impl, &group->group_impls, link) {
+		if (group_impl->net_impl->group_impl_unregister_interrupt != NULL) {
+			group_impl->net_impl->group_impl_unregister_interrupt(group_impl, fgrp);
+		}
+	}
+}
+
 static inline struct spdk_net_impl *
 sock_get_impl_by_name(const char *impl_name)
 {
@@ -23,12 +23,50 @@
  * for the default. */
 #define IOBUF_DEFAULT_LARGE_BUFSIZE	(132 * 1024)
 
+/* Number of batches of released buffers kept on each thread for reuse by any module */
+#define IOBUF_DEPOT_SIZE		4
+/* Buffers are only kept in a depot while the global pool has more than 1/n of its buffers */
+#define IOBUF_DEPOT_POOL_RESERVE	4
+#define IOBUF_MAX_NUMA_NODES		8
+
+#define IOBUF_BATCH_SIZE 32
+
 SPDK_STATIC_ASSERT(sizeof(struct spdk_iobuf_buffer) <= IOBUF_MIN_SMALL_BUFSIZE,
 		   "Invalid data offset");
 
+struct iobuf_magazine {
+	spdk_iobuf_buffer_stailq_t	bufs;
+	uint32_t			count;
+};
+
+/*
+ * Per-thread stash of buffers released by the channels' caches.  Instead of going back to the
+ * global pool, buffers overflowing one module's cache are kept here in batches (magazines) and
+ * handed out to whichever module on the same thread runs out of buffers next.  This keeps buffers
+ * allocated by one module and freed by another on the same thread off the shared ring.
+ */
+struct iobuf_depot {
+	struct spdk_ring		*pool;
+	uint64_t			pool_count;
+	struct iobuf_magazine		mags[IOBUF_DEPOT_SIZE];
+	uint32_t			count;
+};
+
 struct iobuf_channel {
 	spdk_iobuf_entry_stailq_t small_queue;
 	spdk_iobuf_entry_stailq_t large_queue;
+	struct iobuf_depot small_depot;
+	struct iobuf_depot large_depot;
+	TAILQ_HEAD(, spdk_iobuf_channel) channels;
+	/* NUMA node of the thread owning this channel */
+	uint32_t node;
+};
+
+struct iobuf_get_stats_ctx {
+	struct spdk_iobuf_module_stats	*modules;
+	uint32_t			num_modules;
+	spdk_iobuf_get_stats_cb		cb_fn;
+	void				*cb_arg;
 };
 
 struct iobuf_module {
@@ -36,11 +74,17 @@ struct iobuf_module {
 	TAILQ_ENTRY(iobuf_module)	tailq;
 };
 
-struct iobuf {
+/* Buffers allocated from the memory of a single NUMA node */
+struct iobuf_node {
 	struct spdk_ring		*small_pool;
 	struct spdk_ring		*large_pool;
 	void				*small_pool_base;
 	void				*large_pool_base;
+};
+
+struct iobuf {
+	struct iobuf_node		nodes[IOBUF_MAX_NUMA_NODES];
+	uint32_t			num_nodes;
 	struct spdk_iobuf_opts		opts;
 	TAILQ_HEAD(, iobuf_module)	modules;
 	spdk_iobuf_finish_cb		finish_cb;
@@ -49,10 +93,7 @@ struct iobuf {
 
 static struct iobuf g_iobuf = {
 	.modules = TAILQ_HEAD_INITIALIZER(g_iobuf.modules),
-	.small_pool = NULL,
-	.large_pool = NULL,
-	.small_pool_base = NULL,
-	.large_pool_base = NULL,
+	.num_nodes = 0,
 	.opts = {
 		.small_pool_count = IOBUF_DEFAULT_SMALL_POOL_SIZE,
 		.large_pool_count = IOBUF_DEFAULT_LARGE_POOL_SIZE,
@@ -61,13 +102,115 @@ static struct iobuf g_iobuf = {
 	},
 };
 
+static void
+iobuf_depot_init(struct iobuf_depot *depot, struct spdk_ring *pool, uint64_t pool_count)
+{
+	depot->pool = pool;
+	depot->pool_count = pool_count;
+	depot->count = 0;
+}
+
+static bool
+iobuf_depot_pool_low(struct iobuf_depot *depot)
+{
+	return spdk_ring_count(depot->pool) < depot->pool_count / IOBUF_DEPOT_POOL_RESERVE;
+}
+
+static void
+iobuf_depot_release(struct iobuf_depot *depot)
+{
+	struct spdk_iobuf_buffer *bufs[IOBUF_BATCH_SIZE];
+	struct iobuf_magazine *mag;
+	uint32_t count;
+
+	while (depot->count > 0) {
+		mag = &depot->mags[--depot->count];
+		while (!STAILQ_EMPTY(&mag->bufs)) {
+			for (count = 0; count < IOBUF_BATCH_SIZE && !STAILQ_EMPTY(&mag->bufs); count++) {
+				bufs[count] = STAILQ_FIRST(&mag->bufs);
+				STAILQ_REMOVE_HEAD(&mag->bufs, stailq);
+			}
+			spdk_ring_enqueue(depot->pool, (void **)bufs, count, NULL);
+		}
+	}
+}
+
+/* Give the buffers kept on this thread back once the global pool runs low, so that other
+ * threads waiting for buffers aren't starved by them */
+static inline void
+iobuf_depot_trim(struct iobuf_depot *depot)
+{
+	if (spdk_unlikely(depot->count > 0) && iobuf_depot_pool_low(depot)) {
+		iobuf_depot_release(depot);
+	}
+}
+
+static bool
+iobuf_depot_put(struct iobuf_depot *depot, spdk_iobuf_buffer_stailq_t *bufs, uint32_t count)
+{
+	struct iobuf_magazine *mag;
+
+	if (iobuf_depot_pool_low(depot)) {
+		iobuf_depot_release(depot);
+		return false;
+	}
+
+	if (depot->count == IOBUF_DEPOT_SIZE) {
+		return false;
+	}
+
+	mag = &depot->mags[depot->count++];
+	STAILQ_INIT(&mag->bufs);
+	STAILQ_CONCAT(&mag->bufs, bufs);
+	mag->count = count;
+
+	return true;
+}
+
+static uint32_t
+iobuf_depot_get(struct iobuf_depot *depot, spdk_iobuf_buffer_stailq_t *bufs)
+{
+	struct iobuf_magazine *mag;
+
+	if (depot->count == 0) {
+		return 0;
+	}
+
+	mag = &depot->mags[--depot->count];
+	STAILQ_CONCAT(bufs, &mag->bufs);
+
+	return mag->count;
+}
+
+static uint32_t
+iobuf_get_local_node(void)
+{
+	uint32_t core = spdk_env_get_current_core();
+	uint32_t node;
+
+	if (g_iobuf.num_nodes == 1 || core == SPDK_ENV_LCORE_ID_ANY) {
+		return 0;
+	}
+
+	node = spdk_env_get_socket_id(core);
+
+	return node < g_iobuf.num_nodes ? node : 0;
+}
+
 static int
 iobuf_channel_create_cb(void *io_device, void *ctx)
 {
 	struct iobuf_channel *ch = ctx;
+	struct iobuf_node *node;
+
+	ch->node = iobuf_get_local_node();
+	node = &g_iobuf.nodes[ch->node];
 
 	STAILQ_INIT(&ch->small_queue);
 	STAILQ_INIT(&ch->large_queue);
+	iobuf_depot_init(&ch->small_depot, node->small_pool, g_iobuf.opts.small_pool_count);
+	iobuf_depot_init(&ch->large_depot, node->large_pool, g_iobuf.opts.large_pool_count);
+	TAILQ_INIT(&ch->channels);
 
 	return 0;
 }
@@ -75,64 +218,114 @@ iobuf_channel_create_cb(void *io_device, void *ctx)
 static void
 iobuf_channel_destroy_cb(void *io_device, void *ctx)
 {
-	struct iobuf_channel *ch __attribute__((unused)) = ctx;
+	struct iobuf_channel *ch = ctx;
 
 	assert(STAILQ_EMPTY(&ch->small_queue));
 	assert(STAILQ_EMPTY(&ch->large_queue));
+	assert(TAILQ_EMPTY(&ch->channels));
+
+	iobuf_depot_release(&ch->small_depot);
+	iobuf_depot_release(&ch->large_depot);
 }
 
-int
-spdk_iobuf_initialize(void)
+static int
+iobuf_node_initialize(struct iobuf_node *node, int socket_id)
 {
 	struct spdk_iobuf_opts *opts = &g_iobuf.opts;
-	int rc = 0;
-	uint64_t i;
 	struct spdk_iobuf_buffer *buf;
+	uint64_t i;
 
-	g_iobuf.small_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->small_pool_count,
-					      SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_iobuf.small_pool) {
+	node->small_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->small_pool_count, socket_id);
+	if (!node->small_pool) {
 		SPDK_ERRLOG("Failed to create small iobuf pool\n");
-		rc = -ENOMEM;
-		goto error;
+		return -ENOMEM;
 	}
 
-	/* Round up to the nearest alignment so that each element remains aligned */
-	opts->small_bufsize = SPDK_ALIGN_CEIL(opts->small_bufsize, IOBUF_ALIGNMENT);
-	g_iobuf.small_pool_base = spdk_malloc(opts->small_bufsize * opts->small_pool_count, IOBUF_ALIGNMENT,
-					      NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (g_iobuf.small_pool_base == NULL) {
+	node->small_pool_base = spdk_malloc(opts->small_bufsize * opts->small_pool_count, IOBUF_ALIGNMENT,
+					    NULL, socket_id, SPDK_MALLOC_DMA);
+	if (node->small_pool_base == NULL) {
 		SPDK_ERRLOG("Unable to allocate requested small iobuf pool size\n");
-		rc = -ENOMEM;
-		goto error;
+		return -ENOMEM;
 	}
 
-	g_iobuf.large_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->large_pool_count,
-					      SPDK_ENV_SOCKET_ID_ANY);
-	if (!g_iobuf.large_pool) {
+	node->large_pool = spdk_ring_create(SPDK_RING_TYPE_MP_MC, opts->large_pool_count, socket_id);
+	if (!node->large_pool) {
 		SPDK_ERRLOG("Failed to create large iobuf pool\n");
-		rc = -ENOMEM;
-		goto error;
+		return -ENOMEM;
 	}
 
-	/* Round up to the nearest alignment so that each element remains aligned */
-	opts->large_bufsize = SPDK_ALIGN_CEIL(opts->large_bufsize, IOBUF_ALIGNMENT);
-	g_iobuf.large_pool_base = spdk_malloc(opts->large_bufsize * opts->large_pool_count, IOBUF_ALIGNMENT,
-					      NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
-	if (g_iobuf.large_pool_base == NULL) {
+	node->large_pool_base = spdk_malloc(opts->large_bufsize * opts->large_pool_count, IOBUF_ALIGNMENT,
+					    NULL, socket_id, SPDK_MALLOC_DMA);
+	if (node->large_pool_base == NULL) {
 		SPDK_ERRLOG("Unable to allocate requested large iobuf pool size\n");
-		rc = -ENOMEM;
-		goto error;
+		return -ENOMEM;
 	}
 
 	for (i = 0; i < opts->small_pool_count; i++) {
-		buf = g_iobuf.small_pool_base + i * opts->small_bufsize;
-		spdk_ring_enqueue(g_iobuf.small_pool, (void **)&buf, 1, NULL);
+		buf = node->small_pool_base + i * opts->small_bufsize;
+		spdk_ring_enqueue(node->small_pool, (void **)&buf, 1, NULL);
 	}
 
 	for (i = 0; i < opts->large_pool_count; i++) {
-		buf = g_iobuf.large_pool_base + i * opts->large_bufsize;
-		spdk_ring_enqueue(g_iobuf.large_pool, (void **)&buf, 1, NULL);
+		buf = node->large_pool_base + i * opts->large_bufsize;
+		spdk_ring_enqueue(node->large_pool, (void **)&buf, 1, NULL);
+	}
+
+	return 0;
+}
+
+static void
+iobuf_node_free(struct iobuf_node *node)
+{
+	spdk_free(node->small_pool_base);
+	node->small_pool_base = NULL;
+	spdk_ring_free(node->small_pool);
+	node->small_pool = NULL;
+
+	spdk_free(node->large_pool_base);
+	node->large_pool_base = NULL;
+	spdk_ring_free(node->large_pool);
+	node->large_pool = NULL;
+}
+
+static uint32_t
+iobuf_get_num_nodes(void)
+{
+	uint32_t core, num_nodes = 1;
+
+	SPDK_ENV_FOREACH_CORE(core) {
+		if (spdk_env_get_socket_id(core) != (uint32_t)SPDK_ENV_SOCKET_ID_ANY) {
+			num_nodes = spdk_max(num_nodes, spdk_env_get_socket_id(core) + 1);
+		}
+	}
+
+	if (num_nodes > IOBUF_MAX_NUMA_NODES) {
+		SPDK_WARNLOG("Only %u NUMA nodes are supported, buffers of the remaining ones will be "
+			     "shared\n", IOBUF_MAX_NUMA_NODES);
+		num_nodes = IOBUF_MAX_NUMA_NODES;
+	}
+
+	return num_nodes;
+}
+
+int
+spdk_iobuf_initialize(void)
+{
+	struct spdk_iobuf_opts *opts = &g_iobuf.opts;
+	uint32_t i;
+	int rc = 0;
+
+	/* Round up to the nearest alignment so that each element remains aligned */
+	opts->small_bufsize = SPDK_ALIGN_CEIL(opts->small_bufsize, IOBUF_ALIGNMENT);
+	opts->large_bufsize = SPDK_ALIGN_CEIL(opts->large_bufsize, IOBUF_ALIGNMENT);
+
+	g_iobuf.num_nodes = opts->enable_numa ? iobuf_get_num_nodes() : 1;
+	for (i = 0; i < g_iobuf.num_nodes; i++) {
+		rc = iobuf_node_initialize(&g_iobuf.nodes[i], opts->enable_numa ? (int)i :
+					   SPDK_ENV_SOCKET_ID_ANY);
+		if (rc != 0) {
+			goto error;
+		}
 	}
 
 	spdk_io_device_register(&g_iobuf, iobuf_channel_create_cb, iobuf_channel_destroy_cb,
@@ -140,10 +333,10 @@ spdk_iobuf_initialize(void)
 
 	return 0;
 error:
-	spdk_free(g_iobuf.small_pool_base);
-	spdk_ring_free(g_iobuf.small_pool);
-	spdk_free(g_iobuf.large_pool_base);
-	spdk_ring_free(g_iobuf.large_pool);
+	for (i = 0; i < g_iobuf.num_nodes; i++) {
+		iobuf_node_free(&g_iobuf.nodes[i]);
+	}
+	g_iobuf.num_nodes = 0;
 
 	return rc;
 }
@@ -152,6 +345,8 @@ static void
 iobuf_unregister_cb(void *io_device)
 {
 	struct iobuf_module *module;
+	struct iobuf_node *node;
+	uint32_t i;
 
 	while (!TAILQ_EMPTY(&g_iobuf.modules)) {
 		module = TAILQ_FIRST(&g_iobuf.modules);
@@ -160,25 +355,22 @@ iobuf_unregister_cb(void *io_device)
 		free(module);
 	}
 
-	if (spdk_ring_count(g_iobuf.small_pool) != g_iobuf.opts.small_pool_count) {
-		SPDK_ERRLOG("small iobuf pool count is %zu, expected %"PRIu64"\n",
-			    spdk_ring_count(g_iobuf.small_pool), g_iobuf.opts.small_pool_count);
-	}
+	for (i = 0; i < g_iobuf.num_nodes; i++) {
+		node = &g_iobuf.nodes[i];
 
-	if (spdk_ring_count(g_iobuf.large_pool) != g_iobuf.opts.large_pool_count) {
-		SPDK_ERRLOG("large iobuf pool count is %zu, expected %"PRIu64"\n",
-			    spdk_ring_count(g_iobuf.large_pool), g_iobuf.opts.large_pool_count);
-	}
+		if (spdk_ring_count(node->small_pool) != g_iobuf.opts.small_pool_count) {
+			SPDK_ERRLOG("small iobuf pool count is %zu, expected %"PRIu64"\n",
+				    spdk_ring_count(node->small_pool), g_iobuf.opts.small_pool_count);
+		}
 
-	spdk_free(g_iobuf.small_pool_base);
-	g_iobuf.small_pool_base = NULL;
-	spdk_ring_free(g_iobuf.small_pool);
-	g_iobuf.small_pool = NULL;
+		if (spdk_ring_count(node->large_pool) != g_iobuf.opts.large_pool_count) {
+			SPDK_ERRLOG("large iobuf pool count is %zu, expected %"PRIu64"\n",
+				    spdk_ring_count(node->large_pool), g_iobuf.opts.large_pool_count);
+		}
 
-	spdk_free(g_iobuf.large_pool_base);
-	g_iobuf.large_pool_base = NULL;
-	spdk_ring_free(g_iobuf.large_pool);
-	g_iobuf.large_pool = NULL;
+		iobuf_node_free(node);
+	}
+	g_iobuf.num_nodes = 0;
 
 	if (g_iobuf.finish_cb != NULL) {
 		g_iobuf.finish_cb(g_iobuf.finish_arg);
@@ -262,8 +454,8 @@ spdk_iobuf_channel_init(struct spdk_iobuf_channel *ch, const char *name,
 
 	ch->small.queue = &iobuf_ch->small_queue;
 	ch->large.queue = &iobuf_ch->large_queue;
-	ch->small.pool = g_iobuf.small_pool;
-	ch->large.pool = g_iobuf.large_pool;
+	ch->small.pool = g_iobuf.nodes[iobuf_ch->node].small_pool;
+	ch->large.pool = g_iobuf.nodes[iobuf_ch->node].large_pool;
 	ch->small.bufsize = g_iobuf.opts.small_bufsize;
 	ch->large.bufsize = g_iobuf.opts.large_bufsize;
 	ch->parent = ioch;
@@ -272,12 +464,31 @@ spdk_iobuf_channel_init(struct spdk_iobuf_channel *ch, const char *name,
 	ch->large.cache_size = large_cache_size;
 	ch->small.cache_count = 0;
 	ch->large.cache_count = 0;
+	memset(&ch->small.stats, 0, sizeof(ch->small.stats));
+	memset(&ch->large.stats, 0, sizeof(ch->large.stats));
 
 	STAILQ_INIT(&ch->small.cache);
 	STAILQ_INIT(&ch->large.cache);
+	TAILQ_INSERT_TAIL(&iobuf_ch->channels, ch, tailq);
 
-	for (i = 0; i < small_cache_size; ++i) {
-		if (spdk_ring_dequeue(g_iobuf.small_pool, (void **)&buf, 1) == 0) {
+	/* Prefer the buffers released on this thread over the global pool */
+	while (ch->small.cache_count < small_cache_size) {
+		i = iobuf_depot_get(&iobuf_ch->small_depot, &ch->small.cache);
+		if (i == 0) {
+			break;
+		}
+		ch->small.cache_count += i;
+	}
+	while (ch->large.cache_count < large_cache_size) {
+		i = iobuf_depot_get(&iobuf_ch->large_depot, &ch->large.cache);
+		if (i == 0) {
+			break;
+		}
+		ch->large.cache_count += i;
+	}
+
+	for (i = ch->small.cache_count; i < small_cache_size; ++i) {
+		if (spdk_ring_dequeue(ch->small.pool, (void **)&buf, 1) == 0) {
 			SPDK_ERRLOG("Failed to populate iobuf small buffer cache. "
 				    "You may need to increase spdk_iobuf_opts.small_pool_count.\n");
 			SPDK_ERRLOG("See scripts/calc-iobuf.py for guidance on how to calculate "
@@ -287,8 +498,8 @@ spdk_iobuf_channel_init(struct spdk_iobuf_channel *ch, const char *name,
 		STAILQ_INSERT_TAIL(&ch->small.cache, buf, stailq);
 		ch->small.cache_count++;
 	}
-	for (i = 0; i < large_cache_size; ++i) {
-		if (spdk_ring_dequeue(g_iobuf.large_pool, (void **)&buf, 1) == 0) {
+	for (i = ch->large.cache_count; i < large_cache_size; ++i) {
+		if (spdk_ring_dequeue(ch->large.pool, (void **)&buf, 1) == 0) {
 			SPDK_ERRLOG("Failed to populate iobuf large buffer cache. "
 				    "You may need to increase spdk_iobuf_opts.large_pool_count.\n");
 			SPDK_ERRLOG("See scripts/calc-iobuf.py for guidance on how to calculate "
@@ -311,6 +522,7 @@ spdk_iobuf_channel_fini(struct spdk_iobuf_channel *ch)
 {
 	struct spdk_iobuf_entry *entry __attribute__((unused));
 	struct spdk_iobuf_buffer *buf;
+	struct iobuf_channel *iobuf_ch = spdk_io_channel_get_ctx(ch->parent);
 
 	/* Make sure none of the wait queue entries are coming from this module */
 	STAILQ_FOREACH(entry, ch->small.queue, stailq) {
@@ -324,19 +536,20 @@ spdk_iobuf_channel_fini(struct spdk_iobuf_channel *ch)
 	while (!STAILQ_EMPTY(&ch->small.cache)) {
 		buf = STAILQ_FIRST(&ch->small.cache);
 		STAILQ_REMOVE_HEAD(&ch->small.cache, stailq);
-		spdk_ring_enqueue(g_iobuf.small_pool, (void **)&buf, 1, NULL);
+		spdk_ring_enqueue(ch->small.pool, (void **)&buf, 1, NULL);
 		ch->small.cache_count--;
 	}
 	while (!STAILQ_EMPTY(&ch->large.cache)) {
 		buf = STAILQ_FIRST(&ch->large.cache);
 		STAILQ_REMOVE_HEAD(&ch->large.cache, stailq);
-		spdk_ring_enqueue(g_iobuf.large_pool, (void **)&buf, 1, NULL);
+		spdk_ring_enqueue(ch->large.pool, (void **)&buf, 1, NULL);
 		ch->large.cache_count--;
 	}
 
 	assert(ch->small.cache_count == 0);
 	assert(ch->large.cache_count == 0);
 
+	TAILQ_REMOVE(&iobuf_ch->channels, ch, tailq);
 	spdk_put_io_channel(ch->parent);
 	ch->parent = NULL;
 }
@@ -423,13 +636,76 @@ spdk_iobuf_entry_abort(struct spdk_iobuf_channel *ch, struct spdk_iobuf_entry *e
 	STAILQ_REMOVE(pool->queue, entry, spdk_iobuf_entry, stailq);
 }
 
-#define IOBUF_BATCH_SIZE 32
+static inline struct iobuf_depot *
+iobuf_get_depot(struct spdk_iobuf_channel *ch, struct spdk_iobuf_pool *pool)
+{
+	struct iobuf_channel *iobuf_ch = spdk_io_channel_get_ctx(ch->parent);
+
+	return pool == &ch->small ? &iobuf_ch->small_depot : &iobuf_ch->large_depot;
+}
+
+static inline struct spdk_ring *
+iobuf_node_get_ring(struct iobuf_node *node, struct spdk_iobuf_channel *ch,
+		    struct spdk_iobuf_pool *pool)
+{
+	return pool == &ch->small ? node->small_pool : node->large_pool;
+}
+
+/* Returns the NUMA node the buffer was allocated from */
+static struct iobuf_node *
+iobuf_get_buf_node(struct spdk_iobuf_channel *ch, struct spdk_iobuf_pool *pool, void *buf)
+{
+	struct iobuf_node *node;
+	uint64_t size;
+	char *base;
+	uint32_t i;
+
+	for (i = 0; i < g_iobuf.num_nodes; i++) {
+		node = &g_iobuf.nodes[i];
+		if (pool == &ch->small) {
+			base = node->small_pool_base;
+			size = g_iobuf.opts.small_pool_count * g_iobuf.opts.small_bufsize;
+		} else {
+			base = node->large_pool_base;
+			size = g_iobuf.opts.large_pool_count * g_iobuf.opts.large_bufsize;
+		}
+
+		if ((char *)buf >= base && (char *)buf < base + size) {
+			return node;
+		}
+	}
+
+	assert(0 && "buffer doesn't belong to any iobuf pool");
+	return NULL;
+}
+
+static void *
+iobuf_get_remote(struct spdk_iobuf_channel *ch, struct spdk_iobuf_pool *pool)
+{
+	struct iobuf_channel *iobuf_ch = spdk_io_channel_get_ctx(ch->parent);
+	void *buf;
+	uint32_t i;
+
+	for (i = 0; i < g_iobuf.num_nodes; i++) {
+		if (i == iobuf_ch->node) {
+			continue;
+		}
+
+		if (spdk_ring_dequeue(iobuf_node_get_ring(&g_iobuf.nodes[i], ch, pool), &buf, 1) != 0) {
+			pool->stats.remote++;
+			return buf;
+		}
+	}
+
+	return NULL;
+}
 
 void *
 spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 	       struct spdk_iobuf_entry *entry, spdk_iobuf_get_cb cb_fn)
 {
 	struct spdk_iobuf_pool *pool;
+	uint32_t count;
 	void *buf;
 
 	assert(spdk_io_channel_get_thread(ch->parent) == spdk_get_thread());
@@ -445,6 +721,12 @@ spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 		STAILQ_REMOVE_HEAD(&pool->cache, stailq);
 		assert(pool->cache_count > 0);
 		pool->cache_count--;
+		pool->stats.cache++;
+	} else if ((count = iobuf_depot_get(iobuf_get_depot(ch, pool), &pool->cache)) > 0) {
+		buf = (void *)STAILQ_FIRST(&pool->cache);
+		STAILQ_REMOVE_HEAD(&pool->cache, stailq);
+		pool->cache_count += count - 1;
+		pool->stats.depot++;
 	} else {
 		struct spdk_iobuf_buffer *bufs[IOBUF_BATCH_SIZE];
 		size_t sz, i;
@@ -453,15 +735,28 @@ spdk_iobuf_get(struct spdk_iobuf_channel *ch, uint64_t len,
 		sz = spdk_ring_dequeue(pool->pool, (void **)bufs, spdk_min(IOBUF_BATCH_SIZE,
 				       spdk_max(pool->cache_size, 1)));
 		if (sz == 0) {
+			/* Remote buffers are handed out one by one and never cached, so that the caches
+			 * only hold memory local to the thread.
+			 */
+			if (spdk_unlikely(g_iobuf.opts.numa_fallback && g_iobuf.num_nodes > 1)) {
+				buf = iobuf_get_remote(ch, pool);
+				if (buf != NULL) {
+					return (char *)buf;
+				}
+			}
+
 			if (entry) {
 				STAILQ_INSERT_TAIL(pool->queue, entry, stailq);
 				entry->module = ch->module;
 				entry->cb_fn = cb_fn;
+				pool->stats.retry++;
 			}
 
 			return NULL;
 		}
 
+		pool->stats.main++;
+
 		for (i = 0; i < (sz - 1); i++) {
 			STAILQ_INSERT_HEAD(&pool->cache, bufs[i], stailq);
 			pool->cache_count++;
@@ -489,6 +784,18 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 		pool = &ch->large;
 	}
 
+	if (spdk_unlikely(g_iobuf.num_nodes > 1)) {
+		struct iobuf_node *node = iobuf_get_buf_node(ch, pool, buf);
+		struct iobuf_channel *iobuf_ch = spdk_io_channel_get_ctx(ch->parent);
+
+		/* Send buffers from other NUMA nodes straight back to their pool */
+		if (node != &g_iobuf.nodes[iobuf_ch->node] &&
+		    (STAILQ_EMPTY(pool->queue) || !g_iobuf.opts.numa_fallback)) {
+			spdk_ring_enqueue(iobuf_node_get_ring(node, ch, pool), (void **)&buf, 1, NULL);
+			return;
+		}
+	}
+
 	if (STAILQ_EMPTY(pool->queue)) {
 		if (pool->cache_size == 0) {
 			spdk_ring_enqueue(pool->pool, (void **)&buf, 1, NULL);
@@ -506,16 +813,24 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 		sz = spdk_min(IOBUF_BATCH_SIZE, pool->cache_size);
 		if (pool->cache_count >= pool->cache_size + sz) {
 			struct spdk_iobuf_buffer *bufs[IOBUF_BATCH_SIZE];
+			spdk_iobuf_buffer_stailq_t mag;
 			size_t i;
 
+			STAILQ_INIT(&mag);
 			for (i = 0; i < sz; i++) {
 				bufs[i] = STAILQ_FIRST(&pool->cache);
 				STAILQ_REMOVE_HEAD(&pool->cache, stailq);
+				STAILQ_INSERT_TAIL(&mag, bufs[i], stailq);
 				assert(pool->cache_count > 0);
 				pool->cache_count--;
 			}
 
-			spdk_ring_enqueue(pool->pool, (void **)bufs, sz, NULL);
+			/* Keep the batch on this thread for other modules, unless the pool runs low */
+			if (!iobuf_depot_put(iobuf_get_depot(ch, pool), &mag, sz)) {
+				spdk_ring_enqueue(pool->pool, (void **)bufs, sz, NULL);
+			}
+		} else {
+			iobuf_depot_trim(iobuf_get_depot(ch, pool));
 		}
 	} else {
 		entry = STAILQ_FIRST(pool->queue);
@@ -523,3 +838,84 @@ spdk_iobuf_put(struct spdk_iobuf_channel *ch, void *buf, uint64_t len)
 		entry->cb_fn(entry, buf);
 	}
 }
+
+static void
+iobuf_pool_stats_add(struct spdk_iobuf_pool_stats *total, const struct spdk_iobuf_pool_stats *stats)
+{
+	total->cache += stats->cache;
+	total->depot += stats->depot;
+	total->main += stats->main;
+	total->retry += stats->retry;
+	total->remote += stats->remote;
+}
+
+static void
+iobuf_get_channel_stats(struct spdk_io_channel_iter *iter)
+{
+	struct iobuf_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(iter);
+	struct spdk_io_channel *ioch = spdk_io_channel_iter_get_channel(iter);
+	struct iobuf_channel *iobuf_ch = spdk_io_channel_get_ctx(ioch);
+	struct spdk_iobuf_channel *ch;
+	struct iobuf_module *module;
+	uint32_t i;
+
+	TAILQ_FOREACH(ch, &iobuf_ch->channels, tailq) {
+		module = (struct iobuf_module *)ch->module;
+		for (i = 0; i < ctx->num_modules; i++) {
+			if (ctx->modules[i].module == module->name) {
+				iobuf_pool_stats_add(&ctx->modules[i].small_pool, &ch->small.stats);
+				iobuf_pool_stats_add(&ctx->modules[i].large_pool, &ch->large.stats);
+				break;
+			}
+		}
+	}
+
+	spdk_for_each_channel_continue(iter, 0);
+}
+
+static void
+iobuf_get_channel_stats_done(struct spdk_io_channel_iter *iter, int status)
+{
+	struct iobuf_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(iter);
+
+	ctx->cb_fn(ctx->modules, ctx->num_modules, ctx->cb_arg);
+
+	free(ctx->modules);
+	free(ctx);
+}
+
+int
+spdk_iobuf_get_stats(spdk_iobuf_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct iobuf_module *module;
+	struct iobuf_get_stats_ctx *ctx;
+	uint32_t i;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_FOREACH(module, &g_iobuf.modules, tailq) {
+		++ctx->num_modules;
+	}
+
+	ctx->modules = calloc(ctx->num_modules, sizeof(struct spdk_iobuf_module_stats));
+	if (ctx->modules == NULL) {
+		free(ctx);
+		return -ENOMEM;
+	}
+
+	i = 0;
+	TAILQ_FOREACH(module, &g_iobuf.modules, tailq) {
+		ctx->modules[i].module = module->name;
+		++i;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(&g_iobuf, iobuf_get_channel_stats, ctx,
+			      iobuf_get_channel_stats_done);
+	return 0;
+}
@@ -33,6 +33,7 @@
 #endif
 
 #define SPDK_MSG_BATCH_SIZE		8
+#define SPDK_MSG_BATCH_SIZE_MAX		64
 #define SPDK_MAX_DEVICE_NAME_LEN	256
 #define SPDK_THREAD_EXIT_TIMEOUT_SEC	5
 #define SPDK_MAX_POLLER_NAME_LEN	256
@@ -129,6 +130,14 @@ struct spdk_thread {
 	int				msg_fd;
 	SLIST_HEAD(, spdk_msg)		msg_cache;
 	size_t				msg_cache_count;
+	/*
+	 * Number of messages dequeued per poll when the caller doesn't set a limit.
+	 * It grows while messages are backing up and pollers are idle and shrinks
+	 * back to SPDK_MSG_BATCH_SIZE otherwise.
+	 */
+	uint32_t			msg_batch_size;
+	/* Whether any poller did work during the last poll */
+	bool				pollers_busy;
 	spdk_msg_fn			critical_msg;
 	uint64_t			id;
 	uint64_t			next_poller_id;
@@ -505,6 +514,7 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 	TAILQ_INIT(&thread->paused_pollers);
 	SLIST_INIT(&thread->msg_cache);
 	thread->msg_cache_count = 0;
+	thread->msg_batch_size = SPDK_MSG_BATCH_SIZE;
 
 	thread->tsc_last = spdk_get_ticks();
 
@@ -797,11 +807,30 @@ spdk_thread_get_from_ctx(void *ctx)
 	return SPDK_CONTAINEROF(ctx, struct spdk_thread, ctx);
 }
 
+static inline void
+msg_queue_shrink_batch_size(struct spdk_thread *thread)
+{
+	thread->msg_batch_size = spdk_max(thread->msg_batch_size / 2, SPDK_MSG_BATCH_SIZE);
+}
+
+static inline void
+msg_queue_update_batch_size(struct spdk_thread *thread, uint32_t count, uint32_t max_msgs)
+{
+	if (count == max_msgs && !thread->pollers_busy &&
+	    spdk_ring_count(thread->messages) != 0) {
+		/* Messages are backing up and there's nothing else to do, drain faster. */
+		thread->msg_batch_size = spdk_min(thread->msg_batch_size * 2, SPDK_MSG_BATCH_SIZE_MAX);
+	} else if (count < max_msgs / 2) {
+		msg_queue_shrink_batch_size(thread);
+	}
+}
+
 static inline uint32_t
 msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 {
 	unsigned count, i;
-	void *messages[SPDK_MSG_BATCH_SIZE];
+	void *messages[SPDK_MSG_BATCH_SIZE_MAX];
+	bool adaptive = false;
 	uint64_t notify = 1;
 	int rc;
 
@@ -817,10 +846,18 @@ msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 	if (max_msgs > 0) {
 		max_msgs = spdk_min(max_msgs, SPDK_MSG_BATCH_SIZE);
 	} else {
-		max_msgs = SPDK_MSG_BATCH_SIZE;
+		if (thread->pollers_busy) {
+			/* Don't let messages starve the pollers while they have work to do. */
+			msg_queue_shrink_batch_size(thread);
+		}
+		max_msgs = thread->msg_batch_size;
+		adaptive = true;
 	}
 
 	count = spdk_ring_dequeue(thread->messages, messages, max_msgs);
+	if (adaptive) {
+		msg_queue_update_batch_size(thread, count, max_msgs);
+	}
 	if (spdk_unlikely(thread->in_interrupt) &&
 	    spdk_ring_count(thread->messages) != 0) {
 		rc = write(thread->msg_fd, &notify, sizeof(notify));
@@ -1050,7 +1087,7 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 	uint32_t msg_count;
 	struct spdk_poller *poller, *tmp;
 	spdk_msg_fn critical_msg;
-	int rc = 0;
+	int rc = 0, pollers_rc = 0;
 
 	thread->tsc_last = now;
 
@@ -1071,8 +1108,8 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		int poller_rc;
 
 		poller_rc = thread_execute_poller(thread, poller);
-		if (poller_rc > rc) {
-			rc = poller_rc;
+		if (poller_rc > pollers_rc) {
+			pollers_rc = poller_rc;
 		}
 	}
 
@@ -1096,14 +1133,16 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		}
 
 		timer_rc = thread_execute_timed_poller(thread, poller, now);
-		if (timer_rc > rc) {
-			rc = timer_rc;
+		if (timer_rc > pollers_rc) {
+			pollers_rc = timer_rc;
 		}
 
 		poller = tmp;
 	}
 
-	return rc;
+	thread->pollers_busy = pollers_rc > 0;
+
+	return spdk_max(rc, pollers_rc);
 }
 
 static void
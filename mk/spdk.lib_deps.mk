@@ -136,6 +136,9 @@ DEPDIRS-bdev_rpc := $(BDEV_DEPS)
 DEPDIRS-bdev_split := $(BDEV_DEPS)
 
 DEPDIRS-bdev_aio := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_cache := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_readahead := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_dedup := $(BDEV_DEPS_THREAD) accel
 DEPDIRS-bdev_compress := $(BDEV_DEPS_THREAD) reduce accel
 DEPDIRS-bdev_crypto := $(BDEV_DEPS_THREAD) accel
 DEPDIRS-bdev_delay := $(BDEV_DEPS_THREAD)
@@ -0,0 +1,1456 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * This is a virtual block device module that keeps recently read data of the
+ * bdev it is attached to in hugepage memory and serves subsequent reads of
+ * the same blocks without going to the base bdev.
+ *
+ * The cache is split into shards, each protecting its own index and data
+ * buffer with a spinlock, so that I/O channels on different threads rarely
+ * contend. Within a shard, cache lines are managed with the 2Q algorithm:
+ * lines read for the first time enter a short FIFO (A1in) and only the lines
+ * that are read again after they were evicted from it, which is remembered
+ * in a ghost queue (A1out), are promoted to the main LRU queue (Am). This
+ * keeps large sequential scans from flushing the frequently read lines.
+ *
+ * Writes, write zeroes, unmaps and copies invalidate the lines they touch
+ * both when they are submitted and when they complete. A read miss fills the
+ * cache only if no write to the same lines was seen while the read was
+ * outstanding, which is tracked with per-stripe generation counters.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_cache.h"
+#include "spdk/env.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* Namespace the cache bdev UUIDs are derived from, together with the base bdev UUID */
+#define BDEV_CACHE_NAMESPACE_UUID "5c1d38e4-4c8f-4d7a-9b2e-0f6a1d83c7b9"
+
+#define CACHE_DEFAULT_LINE_SIZE		4096
+#define CACHE_MAX_LINE_SIZE		(1024 * 1024)
+#define CACHE_DEFAULT_NUM_SHARDS	16
+#define CACHE_MAX_NUM_SHARDS		256
+#define CACHE_MIN_LINES_PER_SHARD	4
+#define CACHE_NUM_STRIPES		1024
+/* Reads spanning more lines than this are served but do not fill the cache. */
+#define CACHE_MAX_FILL_LINES		64
+#define CACHE_SLOT_INVALID		UINT32_MAX
+
+static int vbdev_cache_init(void);
+static int vbdev_cache_get_ctx_size(void);
+static void vbdev_cache_examine(struct spdk_bdev *bdev);
+static void vbdev_cache_finish(void);
+static int vbdev_cache_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module cache_if = {
+	.name = "cache",
+	.module_init = vbdev_cache_init,
+	.get_ctx_size = vbdev_cache_get_ctx_size,
+	.examine_config = vbdev_cache_examine,
+	.module_fini = vbdev_cache_finish,
+	.config_json = vbdev_cache_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(cache, &cache_if)
+
+/* List of cache bdev names, their base bdevs and options. Kept so that the
+ * cache bdev can be created in examine() once its base bdev shows up.
+ */
+struct bdev_names {
+	char			*vbdev_name;
+	char			*bdev_name;
+	struct vbdev_cache_opts	opts;
+	TAILQ_ENTRY(bdev_names)	link;
+};
+static TAILQ_HEAD(, bdev_names) g_bdev_names = TAILQ_HEAD_INITIALIZER(g_bdev_names);
+
+enum cache_entry_state {
+	CACHE_ENTRY_FREE,
+	/* Resident, read once, in the FIFO queue */
+	CACHE_ENTRY_A1IN,
+	/* Resident, read again after being evicted from A1in, in the LRU queue */
+	CACHE_ENTRY_AM,
+	/* Not resident, only remembers that the line was recently evicted from A1in */
+	CACHE_ENTRY_A1OUT,
+};
+
+struct cache_entry {
+	uint64_t			line;
+	struct cache_entry		*hnext;
+	TAILQ_ENTRY(cache_entry)	link;
+	/* Index of the line in the data buffer of the shard, valid for resident entries */
+	uint32_t			slot;
+	enum cache_entry_state		state;
+};
+
+TAILQ_HEAD(cache_entry_list, cache_entry);
+
+struct cache_shard {
+	struct spdk_spinlock		lock;
+
+	uint32_t			line_size;
+	/* Number of lines that can be resident in the shard */
+	uint32_t			capacity;
+	/* Target size of A1in and maximum size of A1out */
+	uint32_t			kin;
+	uint32_t			kout;
+
+	uint8_t				*data;
+	struct cache_entry		*entries;
+	uint32_t			num_entries;
+	struct cache_entry		**buckets;
+	uint32_t			bucket_shift;
+	uint32_t			*free_slots;
+	uint32_t			num_free_slots;
+
+	struct cache_entry_list		free_entries;
+	struct cache_entry_list		a1in;
+	struct cache_entry_list		am;
+	struct cache_entry_list		a1out;
+	uint32_t			a1in_cnt;
+	uint32_t			am_cnt;
+	uint32_t			a1out_cnt;
+
+	uint64_t			inserts;
+	uint64_t			evictions;
+	uint64_t			invalidations;
+	uint64_t			promotions;
+};
+
+/* A cache bdev, its base bdev and the cached data, split into shards */
+struct vbdev_cache {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		cache_bdev;
+	TAILQ_ENTRY(vbdev_cache)	link;
+	struct spdk_thread		*thread;    /* thread base_desc was opened on and must be closed on */
+
+	struct vbdev_cache_opts		opts;
+	uint32_t			line_blocks;
+	uint32_t			num_shards;
+	struct cache_shard		*shards;
+	/* Bumped by every write before and after it invalidates the lines it touches */
+	uint64_t			stripe_gen[CACHE_NUM_STRIPES];
+};
+static TAILQ_HEAD(, vbdev_cache) g_cache_nodes = TAILQ_HEAD_INITIALIZER(g_cache_nodes);
+
+struct cache_io_channel {
+	struct spdk_io_channel	*base_ch; /* used for misses, bypassed reads and all writes */
+
+	uint64_t		read_hits;
+	uint64_t		read_misses;
+	uint64_t		read_bypassed;
+};
+
+struct cache_bdev_io {
+	/* Sum of the stripe generations of the lines read, sampled at submission */
+	uint64_t			gen;
+	bool				fill;
+
+	/* bdev related */
+	struct spdk_io_channel		*ch;
+
+	/* for bdev_io_wait */
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static void vbdev_cache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+
+static inline uint32_t
+cache_shard_hash(struct cache_shard *shard, uint64_t line)
+{
+	return (line * 0x9E3779B97F4A7C15ULL) >> shard->bucket_shift;
+}
+
+static inline uint8_t *
+cache_shard_line_buf(struct cache_shard *shard, struct cache_entry *entry)
+{
+	return shard->data + (uint64_t)entry->slot * shard->line_size;
+}
+
+static inline bool
+cache_entry_is_resident(struct cache_entry *entry)
+{
+	return entry->state == CACHE_ENTRY_A1IN || entry->state == CACHE_ENTRY_AM;
+}
+
+static int
+cache_shard_init(struct cache_shard *shard, uint32_t capacity, uint32_t line_size)
+{
+	uint64_t num_buckets;
+	uint32_t i;
+
+	shard->line_size = line_size;
+	shard->capacity = capacity;
+	shard->kin = spdk_max(capacity / 4, 1);
+	shard->kout = spdk_max(capacity / 2, 1);
+	/* A1out may exceed kout by one entry before it is trimmed on eviction. */
+	shard->num_entries = capacity + shard->kout + 1;
+
+	num_buckets = spdk_align64pow2(shard->num_entries);
+	shard->bucket_shift = 64 - spdk_u64log2(num_buckets);
+
+	TAILQ_INIT(&shard->free_entries);
+	TAILQ_INIT(&shard->a1in);
+	TAILQ_INIT(&shard->am);
+	TAILQ_INIT(&shard->a1out);
+
+	shard->data = spdk_zmalloc((uint64_t)capacity * line_size, 0x1000, NULL,
+				   SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	shard->entries = calloc(shard->num_entries, sizeof(*shard->entries));
+	shard->buckets = calloc(num_buckets, sizeof(*shard->buckets));
+	shard->free_slots = calloc(capacity, sizeof(*shard->free_slots));
+	if (!shard->data || !shard->entries || !shard->buckets || !shard->free_slots) {
+		spdk_free(shard->data);
+		free(shard->entries);
+		free(shard->buckets);
+		free(shard->free_slots);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < shard->num_entries; i++) {
+		shard->entries[i].slot = CACHE_SLOT_INVALID;
+		TAILQ_INSERT_TAIL(&shard->free_entries, &shard->entries[i], link);
+	}
+	for (i = 0; i < capacity; i++) {
+		shard->free_slots[i] = capacity - i - 1;
+	}
+	shard->num_free_slots = capacity;
+
+	spdk_spin_init(&shard->lock);
+
+	return 0;
+}
+
+static void
+cache_shard_fini(struct cache_shard *shard)
+{
+	spdk_spin_destroy(&shard->lock);
+	spdk_free(shard->data);
+	free(shard->entries);
+	free(shard->buckets);
+	free(shard->free_slots);
+}
+
+static struct cache_entry *
+cache_shard_lookup(struct cache_shard *shard, uint64_t line)
+{
+	struct cache_entry *entry;
+
+	for (entry = shard->buckets[cache_shard_hash(shard, line)]; entry; entry = entry->hnext) {
+		if (entry->line == line) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+cache_shard_release_slot(struct cache_shard *shard, struct cache_entry *entry)
+{
+	assert(entry->slot != CACHE_SLOT_INVALID);
+	shard->free_slots[shard->num_free_slots++] = entry->slot;
+	entry->slot = CACHE_SLOT_INVALID;
+}
+
+/* Remove the entry from its queue and from the index and return it to the free list. */
+static void
+cache_shard_drop(struct cache_shard *shard, struct cache_entry *entry)
+{
+	struct cache_entry **prev;
+
+	switch (entry->state) {
+	case CACHE_ENTRY_A1IN:
+		TAILQ_REMOVE(&shard->a1in, entry, link);
+		shard->a1in_cnt--;
+		cache_shard_release_slot(shard, entry);
+		break;
+	case CACHE_ENTRY_AM:
+		TAILQ_REMOVE(&shard->am, entry, link);
+		shard->am_cnt--;
+		cache_shard_release_slot(shard, entry);
+		break;
+	case CACHE_ENTRY_A1OUT:
+		TAILQ_REMOVE(&shard->a1out, entry, link);
+		shard->a1out_cnt--;
+		break;
+	default:
+		assert(false);
+		return;
+	}
+
+	prev = &shard->buckets[cache_shard_hash(shard, entry->line)];
+	while (*prev != entry) {
+		prev = &(*prev)->hnext;
+	}
+	*prev = entry->hnext;
+	entry->hnext = NULL;
+
+	entry->state = CACHE_ENTRY_FREE;
+	TAILQ_INSERT_HEAD(&shard->free_entries, entry, link);
+}
+
+/* Free up one slot. A1in is shrunk back to its target size first and the lines evicted
+ * from it are remembered in A1out. Otherwise the least recently used line of Am goes.
+ */
+static void
+cache_shard_reclaim(struct cache_shard *shard)
+{
+	struct cache_entry *entry;
+
+	if (shard->a1in_cnt > shard->kin || TAILQ_EMPTY(&shard->am)) {
+		entry = TAILQ_LAST(&shard->a1in, cache_entry_list);
+		assert(entry != NULL);
+		TAILQ_REMOVE(&shard->a1in, entry, link);
+		shard->a1in_cnt--;
+		cache_shard_release_slot(shard, entry);
+
+		entry->state = CACHE_ENTRY_A1OUT;
+		TAILQ_INSERT_HEAD(&shard->a1out, entry, link);
+		shard->a1out_cnt++;
+		if (shard->a1out_cnt > shard->kout) {
+			cache_shard_drop(shard, TAILQ_LAST(&shard->a1out, cache_entry_list));
+		}
+	} else {
+		cache_shard_drop(shard, TAILQ_LAST(&shard->am, cache_entry_list));
+	}
+
+	shard->evictions++;
+}
+
+/* Make the line resident and return the buffer the caller has to fill with its data,
+ * or NULL if the line is already resident.
+ */
+static uint8_t *
+cache_shard_insert(struct cache_shard *shard, uint64_t line)
+{
+	struct cache_entry *entry;
+	uint32_t hash;
+
+	entry = cache_shard_lookup(shard, line);
+	if (entry != NULL) {
+		if (cache_entry_is_resident(entry)) {
+			return NULL;
+		}
+		/* Detach the ghost first so that reclaiming a slot cannot drop it. */
+		TAILQ_REMOVE(&shard->a1out, entry, link);
+		shard->a1out_cnt--;
+	}
+
+	if (shard->num_free_slots == 0) {
+		cache_shard_reclaim(shard);
+	}
+
+	if (entry != NULL) {
+		entry->state = CACHE_ENTRY_AM;
+		TAILQ_INSERT_HEAD(&shard->am, entry, link);
+		shard->am_cnt++;
+		shard->promotions++;
+	} else {
+		entry = TAILQ_FIRST(&shard->free_entries);
+		assert(entry != NULL);
+		TAILQ_REMOVE(&shard->free_entries, entry, link);
+
+		entry->line = line;
+		hash = cache_shard_hash(shard, line);
+		entry->hnext = shard->buckets[hash];
+		shard->buckets[hash] = entry;
+
+		entry->state = CACHE_ENTRY_A1IN;
+		TAILQ_INSERT_HEAD(&shard->a1in, entry, link);
+		shard->a1in_cnt++;
+	}
+
+	entry->slot = shard->free_slots[--shard->num_free_slots];
+	shard->inserts++;
+
+	return cache_shard_line_buf(shard, entry);
+}
+
+/* Update the recency of a resident line after a hit. A1in is a FIFO, so only Am lines move. */
+static void
+cache_shard_touch(struct cache_shard *shard, struct cache_entry *entry)
+{
+	if (entry->state == CACHE_ENTRY_AM && TAILQ_FIRST(&shard->am) != entry) {
+		TAILQ_REMOVE(&shard->am, entry, link);
+		TAILQ_INSERT_HEAD(&shard->am, entry, link);
+	}
+}
+
+static void
+cache_shard_invalidate_line(struct cache_shard *shard, uint64_t line)
+{
+	struct cache_entry *entry;
+
+	entry = cache_shard_lookup(shard, line);
+	if (entry != NULL) {
+		if (cache_entry_is_resident(entry)) {
+			shard->invalidations++;
+		}
+		cache_shard_drop(shard, entry);
+	}
+}
+
+static void
+cache_shard_invalidate_range(struct cache_shard *shard, uint64_t first_line, uint64_t last_line)
+{
+	struct cache_entry *entry;
+	uint32_t i;
+
+	for (i = 0; i < shard->num_entries; i++) {
+		entry = &shard->entries[i];
+		if (entry->state != CACHE_ENTRY_FREE &&
+		    entry->line >= first_line && entry->line <= last_line) {
+			if (cache_entry_is_resident(entry)) {
+				shard->invalidations++;
+			}
+			cache_shard_drop(shard, entry);
+		}
+	}
+}
+
+static inline struct cache_shard *
+cache_get_shard(struct vbdev_cache *node, uint64_t line)
+{
+	return &node->shards[line % node->num_shards];
+}
+
+static uint64_t
+cache_get_gen(struct vbdev_cache *node, uint64_t first_line, uint64_t last_line)
+{
+	uint64_t line, gen = 0;
+
+	for (line = first_line; line <= last_line; line++) {
+		gen += __atomic_load_n(&node->stripe_gen[line % CACHE_NUM_STRIPES], __ATOMIC_SEQ_CST);
+	}
+
+	return gen;
+}
+
+static void
+cache_invalidate(struct vbdev_cache *node, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct cache_shard *shard;
+	uint64_t first_line, last_line, line;
+	uint32_t i;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	first_line = offset_blocks / node->line_blocks;
+	last_line = (offset_blocks + num_blocks - 1) / node->line_blocks;
+
+	/* Readers that are about to fill any of these lines must notice this write, so bump
+	 * the generations before dropping the lines.
+	 */
+	if (last_line - first_line >= CACHE_NUM_STRIPES) {
+		for (i = 0; i < CACHE_NUM_STRIPES; i++) {
+			__atomic_fetch_add(&node->stripe_gen[i], 1, __ATOMIC_SEQ_CST);
+		}
+	} else {
+		for (line = first_line; line <= last_line; line++) {
+			__atomic_fetch_add(&node->stripe_gen[line % CACHE_NUM_STRIPES], 1, __ATOMIC_SEQ_CST);
+		}
+	}
+
+	if (last_line - first_line >= node->shards[0].num_entries * (uint64_t)node->num_shards) {
+		/* Walking the entries is cheaper than looking up every line of the range. */
+		for (i = 0; i < node->num_shards; i++) {
+			shard = &node->shards[i];
+			spdk_spin_lock(&shard->lock);
+			cache_shard_invalidate_range(shard, first_line, last_line);
+			spdk_spin_unlock(&shard->lock);
+		}
+		return;
+	}
+
+	for (line = first_line; line <= last_line; line++) {
+		shard = cache_get_shard(node, line);
+		spdk_spin_lock(&shard->lock);
+		cache_shard_invalidate_line(shard, line);
+		spdk_spin_unlock(&shard->lock);
+	}
+}
+
+/* Try to serve the whole read from the cache. */
+static bool
+cache_read_lines(struct vbdev_cache *node, struct spdk_bdev_io *bdev_io)
+{
+	struct cache_shard *shard;
+	struct cache_entry *entry;
+	struct spdk_iov_xfer ix;
+	uint32_t blocklen = node->cache_bdev.blocklen;
+	uint64_t offset = bdev_io->u.bdev.offset_blocks;
+	uint64_t end = offset + bdev_io->u.bdev.num_blocks;
+	uint64_t line, line_start, start, num;
+
+	spdk_iov_xfer_init(&ix, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+
+	for (line = offset / node->line_blocks; line * node->line_blocks < end; line++) {
+		line_start = line * node->line_blocks;
+		start = spdk_max(offset, line_start);
+		num = spdk_min(end, line_start + node->line_blocks) - start;
+
+		shard = cache_get_shard(node, line);
+		spdk_spin_lock(&shard->lock);
+		entry = cache_shard_lookup(shard, line);
+		if (entry == NULL || !cache_entry_is_resident(entry)) {
+			spdk_spin_unlock(&shard->lock);
+			return false;
+		}
+		spdk_iov_xfer_from_buf(&ix, cache_shard_line_buf(shard, entry) + (start - line_start) * blocklen,
+				       num * blocklen);
+		cache_shard_touch(shard, entry);
+		spdk_spin_unlock(&shard->lock);
+	}
+
+	return true;
+}
+
+static void
+cache_iov_xfer_skip(struct spdk_iov_xfer *ix, size_t len)
+{
+	size_t n;
+
+	while (len > 0 && ix->cur_iov_idx < ix->iovcnt) {
+		n = spdk_min(len, ix->iovs[ix->cur_iov_idx].iov_len - ix->cur_iov_offset);
+		len -= n;
+		ix->cur_iov_offset += n;
+		if (ix->cur_iov_offset == ix->iovs[ix->cur_iov_idx].iov_len) {
+			ix->cur_iov_idx++;
+			ix->cur_iov_offset = 0;
+		}
+	}
+}
+
+/* Insert the lines fully covered by a completed read, unless a write to any of them
+ * was submitted in the meantime.
+ */
+static void
+cache_fill_lines(struct vbdev_cache *node, struct spdk_bdev_io *bdev_io, uint64_t gen)
+{
+	struct cache_shard *shard;
+	struct spdk_iov_xfer ix;
+	uint32_t blocklen = node->cache_bdev.blocklen;
+	uint64_t offset = bdev_io->u.bdev.offset_blocks;
+	uint64_t end = offset + bdev_io->u.bdev.num_blocks;
+	uint64_t first_line, last_line, line;
+	uint8_t *buf;
+
+	first_line = offset / node->line_blocks;
+	last_line = (end - 1) / node->line_blocks;
+
+	spdk_iov_xfer_init(&ix, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+
+	line = first_line;
+	if (offset % node->line_blocks != 0) {
+		/* Partially covered head line, skip it. */
+		line++;
+		cache_iov_xfer_skip(&ix, (line * node->line_blocks - offset) * blocklen);
+	}
+
+	for (; (line + 1) * node->line_blocks <= end; line++) {
+		shard = cache_get_shard(node, line);
+		spdk_spin_lock(&shard->lock);
+		/* A write invalidates the lines under the shard lock after bumping the generation,
+		 * so checking it under the same lock guarantees that either the write sees the
+		 * inserted line or this read sees the write.
+		 */
+		if (cache_get_gen(node, first_line, last_line) != gen) {
+			spdk_spin_unlock(&shard->lock);
+			return;
+		}
+		buf = cache_shard_insert(shard, line);
+		if (buf != NULL) {
+			spdk_iov_xfer_to_buf(&ix, buf, shard->line_size);
+		} else {
+			cache_iov_xfer_skip(&ix, shard->line_size);
+		}
+		spdk_spin_unlock(&shard->lock);
+	}
+}
+
+/* The last channel is gone, so no I/O can look up the shards anymore. */
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_cache *cache_node = io_device;
+	uint32_t i;
+
+	for (i = 0; i < cache_node->num_shards; i++) {
+		cache_shard_fini(&cache_node->shards[i]);
+	}
+	free(cache_node->shards);
+	free(cache_node->cache_bdev.name);
+	free(cache_node);
+}
+
+static void
+_vbdev_cache_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+/* Called when the cache bdev is unregistered, either by bdev_cache_delete or because
+ * its base bdev went away. The cached data is freed once the io_device is gone.
+ */
+static int
+vbdev_cache_destruct(void *ctx)
+{
+	struct vbdev_cache *cache_node = (struct vbdev_cache *)ctx;
+
+	TAILQ_REMOVE(&g_cache_nodes, cache_node, link);
+
+	spdk_bdev_module_release_bdev(cache_node->base_bdev);
+
+	/* A descriptor has to be closed on the thread that opened it */
+	if (cache_node->thread && cache_node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(cache_node->thread, _vbdev_cache_destruct, cache_node->base_desc);
+	} else {
+		spdk_bdev_close(cache_node->base_desc);
+	}
+
+	spdk_io_device_unregister(cache_node, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+_cache_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	int status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
+
+	spdk_bdev_io_complete(orig_io, status);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+_cache_complete_read(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_cache *cache_node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_cache, cache_bdev);
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)orig_io->driver_ctx;
+
+	if (success && io_ctx->fill) {
+		cache_fill_lines(cache_node, orig_io, io_ctx->gen);
+	}
+
+	_cache_complete_io(bdev_io, success, cb_arg);
+}
+
+static void
+_cache_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_cache *cache_node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_cache, cache_bdev);
+
+	/* Drop whatever reads filled in while the write was outstanding. */
+	cache_invalidate(cache_node, orig_io->u.bdev.offset_blocks, orig_io->u.bdev.num_blocks);
+
+	_cache_complete_io(bdev_io, success, cb_arg);
+}
+
+static void
+vbdev_cache_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_cache_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_cache_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_cache_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	/* Retry once the base bdev has a bdev_io to spare, a hit never gets here. */
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, cache_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_cache_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+cache_init_ext_io_opts(struct spdk_bdev_io *bdev_io, struct spdk_bdev_ext_io_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->size = sizeof(*opts);
+	opts->memory_domain = bdev_io->u.bdev.memory_domain;
+	opts->memory_domain_ctx = bdev_io->u.bdev.memory_domain_ctx;
+	opts->metadata = bdev_io->u.bdev.md_buf;
+}
+
+static void
+cache_handle_submit_error(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, int rc)
+{
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+
+	if (rc == -ENOMEM) {
+		SPDK_ERRLOG("No memory, start to queue io for cache.\n");
+		io_ctx->ch = ch;
+		vbdev_cache_queue_io(bdev_io);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+cache_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_cache *cache_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache,
+					 cache_bdev);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	struct cache_bdev_io *io_ctx = (struct cache_bdev_io *)bdev_io->driver_ctx;
+	struct spdk_bdev_ext_io_opts io_opts;
+	uint64_t first_line, last_line;
+	int rc;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Separate metadata is not cached and data in foreign memory cannot be copied. */
+	if (bdev_io->u.bdev.md_buf != NULL || bdev_io->u.bdev.memory_domain != NULL) {
+		cache_ch->read_bypassed++;
+		io_ctx->fill = false;
+	} else if (cache_read_lines(cache_node, bdev_io)) {
+		cache_ch->read_hits++;
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	} else {
+		cache_ch->read_misses++;
+		first_line = bdev_io->u.bdev.offset_blocks / cache_node->line_blocks;
+		last_line = (bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks - 1) /
+			    cache_node->line_blocks;
+		io_ctx->fill = last_line - first_line < CACHE_MAX_FILL_LINES;
+		if (io_ctx->fill) {
+			io_ctx->gen = cache_get_gen(cache_node, first_line, last_line);
+		}
+	}
+
+	cache_init_ext_io_opts(bdev_io, &io_opts);
+	rc = spdk_bdev_readv_blocks_ext(cache_node->base_desc, cache_ch->base_ch, bdev_io->u.bdev.iovs,
+					bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					bdev_io->u.bdev.num_blocks, _cache_complete_read,
+					bdev_io, &io_opts);
+	if (rc != 0) {
+		cache_handle_submit_error(ch, bdev_io, rc);
+	}
+}
+
+/* Called when someone above submits IO to this cache vbdev. Reads are served from the
+ * cache when possible, all the other I/O is passed on to the base bdev.
+ */
+static void
+vbdev_cache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_cache *cache_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_cache, cache_bdev);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_bdev_ext_io_opts io_opts;
+	int rc = 0;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, cache_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		cache_invalidate(cache_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		cache_init_ext_io_opts(bdev_io, &io_opts);
+		rc = spdk_bdev_writev_blocks_ext(cache_node->base_desc, cache_ch->base_ch, bdev_io->u.bdev.iovs,
+						 bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+						 bdev_io->u.bdev.num_blocks, _cache_complete_write,
+						 bdev_io, &io_opts);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		cache_invalidate(cache_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_write_zeroes_blocks(cache_node->base_desc, cache_ch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _cache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		cache_invalidate(cache_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_unmap_blocks(cache_node->base_desc, cache_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _cache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		cache_invalidate(cache_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_copy_blocks(cache_node->base_desc, cache_ch->base_ch,
+					   bdev_io->u.bdev.offset_blocks,
+					   bdev_io->u.bdev.copy.src_offset_blocks,
+					   bdev_io->u.bdev.num_blocks,
+					   _cache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(cache_node->base_desc, cache_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _cache_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(cache_node->base_desc, cache_ch->base_ch,
+				     _cache_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_ABORT:
+		rc = spdk_bdev_abort(cache_node->base_desc, cache_ch->base_ch, bdev_io->u.abort.bio_to_abort,
+				     _cache_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("cache: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+	if (rc != 0) {
+		cache_handle_submit_error(ch, bdev_io, rc);
+	}
+}
+
+/* I/O that may modify data without the cache noticing, such as NVMe passthru or zcopy
+ * writes, is not supported.
+ */
+static bool
+vbdev_cache_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_cache *cache_node = (struct vbdev_cache *)ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_COPY:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+	case SPDK_BDEV_IO_TYPE_ABORT:
+		return spdk_bdev_io_type_supported(cache_node->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_cache_get_io_channel(void *ctx)
+{
+	struct vbdev_cache *cache_node = (struct vbdev_cache *)ctx;
+
+	return spdk_get_io_channel(cache_node);
+}
+
+static void
+vbdev_cache_write_opts(struct spdk_json_write_ctx *w, struct vbdev_cache *cache_node)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&cache_node->cache_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(cache_node->base_bdev));
+	spdk_json_write_named_uint64(w, "size_mb", cache_node->opts.size_mb);
+	spdk_json_write_named_uint32(w, "line_size", cache_node->opts.line_size);
+	spdk_json_write_named_uint32(w, "num_shards", cache_node->opts.num_shards);
+}
+
+/* Reported under "cache" in driver_specific of bdev_get_bdevs */
+static int
+vbdev_cache_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache_node = (struct vbdev_cache *)ctx;
+
+	spdk_json_write_name(w, "cache");
+	spdk_json_write_object_begin(w);
+	vbdev_cache_write_opts(w, cache_node);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* Emit a bdev_cache_create call for each cache bdev, with the options it was created with. */
+static int
+vbdev_cache_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_cache *cache_node;
+
+	TAILQ_FOREACH(cache_node, &g_cache_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_cache_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_cache_write_opts(w, cache_node);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+cache_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct cache_io_channel *cache_ch = ctx_buf;
+	struct vbdev_cache *cache_node = io_device;
+
+	cache_ch->base_ch = spdk_bdev_get_io_channel(cache_node->base_desc);
+	if (cache_ch->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+cache_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct cache_io_channel *cache_ch = ctx_buf;
+
+	spdk_put_io_channel(cache_ch->base_ch);
+}
+
+/* Create the cache association from the bdev and vbdev name and insert
+ * on the global list. */
+static int
+vbdev_cache_insert_name(const char *bdev_name, const char *vbdev_name,
+			const struct vbdev_cache_opts *opts)
+{
+	struct bdev_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("cache bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	if (!name->bdev_name) {
+		SPDK_ERRLOG("could not allocate name->bdev_name\n");
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate name->vbdev_name\n");
+		free(name->bdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->opts = *opts;
+	if (name->opts.num_shards == 0) {
+		name->opts.num_shards = CACHE_DEFAULT_NUM_SHARDS;
+	}
+
+	TAILQ_INSERT_TAIL(&g_bdev_names, name, link);
+
+	return 0;
+}
+
+static void
+vbdev_cache_remove_name(struct bdev_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_cache_init(void)
+{
+	return 0;
+}
+
+/* The cache bdevs themselves are gone by now, only the configured names are left. */
+static void
+vbdev_cache_finish(void)
+{
+	struct bdev_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_names))) {
+		vbdev_cache_remove_name(name);
+	}
+}
+
+static int
+vbdev_cache_get_ctx_size(void)
+{
+	return sizeof(struct cache_bdev_io);
+}
+
+/* Per bdev configuration is entirely covered by bdev_cache_create. */
+static void
+vbdev_cache_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+}
+
+/* When we register our bdev this is how we specify our entry points. The cache copies
+ * data from and to the buffers of the I/O, so no memory domains are reported and the
+ * bdev layer bounces data in foreign memory for us.
+ */
+static const struct spdk_bdev_fn_table vbdev_cache_fn_table = {
+	.destruct		= vbdev_cache_destruct,
+	.submit_request		= vbdev_cache_submit_request,
+	.io_type_supported	= vbdev_cache_io_type_supported,
+	.get_io_channel		= vbdev_cache_get_io_channel,
+	.dump_info_json		= vbdev_cache_dump_info_json,
+	.write_config_json	= vbdev_cache_write_config_json,
+};
+
+static void
+vbdev_cache_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_cache *cache_node, *tmp;
+
+	TAILQ_FOREACH_SAFE(cache_node, &g_cache_nodes, link, tmp) {
+		if (bdev_find == cache_node->base_bdev) {
+			spdk_bdev_unregister(&cache_node->cache_bdev, NULL, NULL);
+		}
+	}
+}
+
+/* The cached data is useless without the base bdev, so the cache bdev goes with it. */
+static void
+vbdev_cache_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			       void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_cache_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+vbdev_cache_init_shards(struct vbdev_cache *cache_node)
+{
+	uint64_t capacity;
+	uint32_t i;
+	int rc;
+
+	capacity = cache_node->opts.size_mb * 1024 * 1024 / cache_node->opts.line_size /
+		   cache_node->num_shards;
+	if (capacity < CACHE_MIN_LINES_PER_SHARD || capacity > UINT32_MAX / 2) {
+		SPDK_ERRLOG("cache of %" PRIu64 " MiB cannot be split into %u shards of %u byte lines\n",
+			    cache_node->opts.size_mb, cache_node->num_shards, cache_node->opts.line_size);
+		return -EINVAL;
+	}
+
+	cache_node->shards = calloc(cache_node->num_shards, sizeof(*cache_node->shards));
+	if (cache_node->shards == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < cache_node->num_shards; i++) {
+		rc = cache_shard_init(&cache_node->shards[i], capacity, cache_node->opts.line_size);
+		if (rc != 0) {
+			SPDK_ERRLOG("could not allocate %" PRIu64 " cache lines\n", capacity);
+			while (i-- > 0) {
+				cache_shard_fini(&cache_node->shards[i]);
+			}
+			free(cache_node->shards);
+			cache_node->shards = NULL;
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static void
+vbdev_cache_free_shards(struct vbdev_cache *cache_node)
+{
+	uint32_t i;
+
+	for (i = 0; i < cache_node->num_shards; i++) {
+		cache_shard_fini(&cache_node->shards[i]);
+	}
+	free(cache_node->shards);
+}
+
+/* Create and register the cache vbdev if we find it in our list of bdev names.
+ * This can be called either by the examine path or RPC method.
+ */
+static int
+vbdev_cache_register(const char *bdev_name)
+{
+	struct bdev_names *name;
+	struct vbdev_cache *cache_node;
+	struct spdk_bdev *bdev;
+	struct spdk_uuid ns_uuid;
+	int rc = 0;
+
+	spdk_uuid_parse(&ns_uuid, BDEV_CACHE_NAMESPACE_UUID);
+
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(name->bdev_name, bdev_name) != 0) {
+			continue;
+		}
+
+		cache_node = calloc(1, sizeof(struct vbdev_cache));
+		if (!cache_node) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate cache_node\n");
+			break;
+		}
+
+		cache_node->cache_bdev.name = strdup(name->vbdev_name);
+		if (!cache_node->cache_bdev.name) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate cache_bdev name\n");
+			free(cache_node);
+			break;
+		}
+		cache_node->cache_bdev.product_name = "cache";
+
+		/* Writes go through the cache bdev to the base bdev, so open it read-write. */
+		rc = spdk_bdev_open_ext(bdev_name, true, vbdev_cache_base_bdev_event_cb,
+					NULL, &cache_node->base_desc);
+		if (rc) {
+			if (rc != -ENODEV) {
+				SPDK_ERRLOG("could not open bdev %s\n", bdev_name);
+			}
+			free(cache_node->cache_bdev.name);
+			free(cache_node);
+			break;
+		}
+
+		bdev = spdk_bdev_desc_get_bdev(cache_node->base_desc);
+		cache_node->base_bdev = bdev;
+
+		cache_node->opts = name->opts;
+		if (cache_node->opts.line_size == 0) {
+			cache_node->opts.line_size = spdk_max(CACHE_DEFAULT_LINE_SIZE / bdev->blocklen, 1) *
+						     bdev->blocklen;
+		}
+		cache_node->line_blocks = cache_node->opts.line_size / bdev->blocklen;
+		cache_node->num_shards = cache_node->opts.num_shards;
+		if (cache_node->opts.line_size % bdev->blocklen != 0 ||
+		    cache_node->opts.line_size > CACHE_MAX_LINE_SIZE) {
+			SPDK_ERRLOG("line size %u is not a multiple of block size %u of bdev %s or is too large\n",
+				    cache_node->opts.line_size, bdev->blocklen, bdev_name);
+			rc = -EINVAL;
+		} else {
+			rc = vbdev_cache_init_shards(cache_node);
+		}
+		if (rc) {
+			spdk_bdev_close(cache_node->base_desc);
+			free(cache_node->cache_bdev.name);
+			free(cache_node);
+			break;
+		}
+
+		/* Keep the UUID stable across restarts on the same base bdev */
+		rc = spdk_uuid_generate_sha1(&cache_node->cache_bdev.uuid, &ns_uuid,
+					     (const char *)&cache_node->base_bdev->uuid, sizeof(struct spdk_uuid));
+		if (rc) {
+			SPDK_ERRLOG("Unable to generate new UUID for cache bdev\n");
+			spdk_bdev_close(cache_node->base_desc);
+			vbdev_cache_free_shards(cache_node);
+			free(cache_node->cache_bdev.name);
+			free(cache_node);
+			break;
+		}
+
+		/* Same geometry as the base bdev, the cache is invisible to the user. */
+		cache_node->cache_bdev.write_cache = bdev->write_cache;
+		cache_node->cache_bdev.required_alignment = bdev->required_alignment;
+		cache_node->cache_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+		cache_node->cache_bdev.blocklen = bdev->blocklen;
+		cache_node->cache_bdev.blockcnt = bdev->blockcnt;
+
+		cache_node->cache_bdev.md_interleave = bdev->md_interleave;
+		cache_node->cache_bdev.md_len = bdev->md_len;
+		cache_node->cache_bdev.dif_type = bdev->dif_type;
+		cache_node->cache_bdev.dif_is_head_of_md = bdev->dif_is_head_of_md;
+		cache_node->cache_bdev.dif_check_flags = bdev->dif_check_flags;
+
+		cache_node->cache_bdev.ctxt = cache_node;
+		cache_node->cache_bdev.fn_table = &vbdev_cache_fn_table;
+		cache_node->cache_bdev.module = &cache_if;
+		TAILQ_INSERT_TAIL(&g_cache_nodes, cache_node, link);
+
+		spdk_io_device_register(cache_node, cache_bdev_ch_create_cb, cache_bdev_ch_destroy_cb,
+					sizeof(struct cache_io_channel),
+					name->vbdev_name);
+
+		/* vbdev_cache_destruct() closes base_desc on this thread. */
+		cache_node->thread = spdk_get_thread();
+
+		rc = spdk_bdev_module_claim_bdev(bdev, cache_node->base_desc, cache_node->cache_bdev.module);
+		if (rc) {
+			SPDK_ERRLOG("could not claim bdev %s\n", bdev_name);
+			spdk_bdev_close(cache_node->base_desc);
+			TAILQ_REMOVE(&g_cache_nodes, cache_node, link);
+			spdk_io_device_unregister(cache_node, _device_unregister_cb);
+			break;
+		}
+
+		rc = spdk_bdev_register(&cache_node->cache_bdev);
+		if (rc) {
+			SPDK_ERRLOG("could not register cache_bdev\n");
+			spdk_bdev_module_release_bdev(bdev);
+			spdk_bdev_close(cache_node->base_desc);
+			TAILQ_REMOVE(&g_cache_nodes, cache_node, link);
+			spdk_io_device_unregister(cache_node, _device_unregister_cb);
+			break;
+		}
+		SPDK_NOTICELOG("created cache_bdev %s of %" PRIu64 " MiB for: %s\n", name->vbdev_name,
+			       cache_node->opts.size_mb, bdev_name);
+	}
+
+	return rc;
+}
+
+/* Create the cache disk from the given bdev and vbdev name. */
+int
+bdev_cache_create_disk(const char *bdev_name, const char *vbdev_name,
+		       const struct vbdev_cache_opts *opts)
+{
+	struct bdev_names *name;
+	int rc;
+
+	if (opts->size_mb == 0 || opts->num_shards > CACHE_MAX_NUM_SHARDS) {
+		return -EINVAL;
+	}
+
+	/* Remember the configuration even if the base bdev doesn't exist yet, the cache
+	 * bdev is then created when it's examined.
+	 */
+	rc = vbdev_cache_insert_name(bdev_name, vbdev_name, opts);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_cache_register(bdev_name);
+	if (rc == -ENODEV) {
+		/* The base bdev isn't there yet, examine will pick it up. */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc != 0) {
+		/* E.g. a bad line size, which wouldn't work on any later examine either. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, vbdev_name) == 0) {
+				vbdev_cache_remove_name(name);
+				break;
+			}
+		}
+	}
+
+	return rc;
+}
+
+void
+bdev_cache_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_names *name;
+	int rc;
+
+	/* The shards are freed by vbdev_cache_destruct() once the bdev is unregistered. */
+	rc = spdk_bdev_unregister_by_name(bdev_name, &cache_if, cb_fn, cb_arg);
+	if (rc == 0) {
+		/* Forget the configuration, or the cache would come back with the base bdev. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, bdev_name) == 0) {
+				vbdev_cache_remove_name(name);
+				break;
+			}
+		}
+	} else {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+struct cache_get_stats_ctx {
+	struct vbdev_cache_stats	*stats;
+	struct vbdev_cache		**nodes;
+	uint32_t			num_nodes;
+	uint32_t			cur;
+	bdev_cache_get_stats_cb		cb_fn;
+	void				*cb_arg;
+};
+
+static void cache_get_stats_next(struct cache_get_stats_ctx *ctx);
+
+static void
+cache_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct cache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct cache_io_channel *cache_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_cache_stats *stats = &ctx->stats[ctx->cur];
+
+	stats->read_hits += cache_ch->read_hits;
+	stats->read_misses += cache_ch->read_misses;
+	stats->read_bypassed += cache_ch->read_bypassed;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+cache_get_stats_channel_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct cache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cur++;
+	cache_get_stats_next(ctx);
+}
+
+static void
+cache_get_stats_done(struct cache_get_stats_ctx *ctx)
+{
+	uint32_t i;
+
+	ctx->cb_fn(ctx->cb_arg, ctx->stats, ctx->num_nodes);
+
+	for (i = 0; i < ctx->num_nodes; i++) {
+		free(ctx->stats[i].name);
+		free(ctx->stats[i].base_bdev_name);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+}
+
+static void
+cache_get_stats_next(struct cache_get_stats_ctx *ctx)
+{
+	struct vbdev_cache *cache_node;
+
+	while (ctx->cur < ctx->num_nodes) {
+		/* Skip cache bdevs deleted while the stats of the previous one were collected. */
+		TAILQ_FOREACH(cache_node, &g_cache_nodes, link) {
+			if (cache_node == ctx->nodes[ctx->cur]) {
+				spdk_for_each_channel(cache_node, cache_get_stats_channel, ctx,
+						      cache_get_stats_channel_done);
+				return;
+			}
+		}
+		ctx->cur++;
+	}
+
+	cache_get_stats_done(ctx);
+}
+
+static void
+cache_get_node_stats(struct vbdev_cache *cache_node, struct vbdev_cache_stats *stats)
+{
+	struct cache_shard *shard;
+	uint32_t i;
+
+	stats->size = cache_node->opts.size_mb * 1024 * 1024;
+	stats->line_size = cache_node->opts.line_size;
+
+	for (i = 0; i < cache_node->num_shards; i++) {
+		shard = &cache_node->shards[i];
+		spdk_spin_lock(&shard->lock);
+		stats->num_lines += shard->capacity;
+		stats->lines_cached += shard->a1in_cnt + shard->am_cnt;
+		stats->inserts += shard->inserts;
+		stats->evictions += shard->evictions;
+		stats->invalidations += shard->invalidations;
+		stats->promotions += shard->promotions;
+		spdk_spin_unlock(&shard->lock);
+	}
+}
+
+int
+bdev_cache_get_stats(const char *bdev_name, bdev_cache_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct cache_get_stats_ctx *ctx;
+	struct vbdev_cache *cache_node;
+	uint32_t num_nodes = 0;
+
+	TAILQ_FOREACH(cache_node, &g_cache_nodes, link) {
+		if (bdev_name == NULL || strcmp(bdev_name, cache_node->cache_bdev.name) == 0) {
+			num_nodes++;
+		}
+	}
+	if (bdev_name != NULL && num_nodes == 0) {
+		return -ENODEV;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+	ctx->stats = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->stats));
+	ctx->nodes = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->nodes));
+	if (ctx->stats == NULL || ctx->nodes == NULL) {
+		goto err;
+	}
+
+	TAILQ_FOREACH(cache_node, &g_cache_nodes, link) {
+		if (bdev_name != NULL && strcmp(bdev_name, cache_node->cache_bdev.name) != 0) {
+			continue;
+		}
+		ctx->nodes[ctx->num_nodes] = cache_node;
+		ctx->stats[ctx->num_nodes].name = strdup(cache_node->cache_bdev.name);
+		ctx->stats[ctx->num_nodes].base_bdev_name = strdup(spdk_bdev_get_name(cache_node->base_bdev));
+		ctx->num_nodes++;
+		if (ctx->stats[ctx->num_nodes - 1].name == NULL ||
+		    ctx->stats[ctx->num_nodes - 1].base_bdev_name == NULL) {
+			goto err;
+		}
+		cache_get_node_stats(cache_node, &ctx->stats[ctx->num_nodes - 1]);
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	cache_get_stats_next(ctx);
+
+	return 0;
+
+err:
+	while (ctx->num_nodes-- > 0) {
+		free(ctx->stats[ctx->num_nodes].name);
+		free(ctx->stats[ctx->num_nodes].base_bdev_name);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+	return -ENOMEM;
+}
+
+/* Because we specified this function in our cache bdev function table when we
+ * registered our cache bdev, we'll get this call anytime a new bdev shows up.
+ */
+static void
+vbdev_cache_examine(struct spdk_bdev *bdev)
+{
+	vbdev_cache_register(bdev->name);
+
+	spdk_bdev_module_examine_done(&cache_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_cache)
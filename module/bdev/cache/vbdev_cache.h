@@ -0,0 +1,76 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_CACHE_H
+#define SPDK_VBDEV_CACHE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+struct vbdev_cache_opts {
+	/* Size of the cache in megabytes */
+	uint64_t	size_mb;
+
+	/* Size of a cache line in bytes, a multiple of the base bdev's block size, 0 for default */
+	uint32_t	line_size;
+
+	/* Number of independently locked shards of the cache, 0 for default */
+	uint32_t	num_shards;
+};
+
+/**
+ * Create new read cache bdev.
+ *
+ * \param bdev_name Bdev on which the read cache vbdev will be created.
+ * \param vbdev_name Name of the read cache bdev.
+ * \param opts Options of the cache.
+ * \return 0 on success, other on failure.
+ */
+int bdev_cache_create_disk(const char *bdev_name, const char *vbdev_name,
+			   const struct vbdev_cache_opts *opts);
+
+/**
+ * Delete read cache bdev.
+ *
+ * \param bdev_name Name of the read cache bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_cache_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn,
+			    void *cb_arg);
+
+struct vbdev_cache_stats {
+	char		*name;
+	char		*base_bdev_name;
+	uint64_t	size;
+	uint32_t	line_size;
+	uint64_t	num_lines;
+	uint64_t	lines_cached;
+	uint64_t	read_hits;
+	uint64_t	read_misses;
+	uint64_t	read_bypassed;
+	uint64_t	inserts;
+	uint64_t	evictions;
+	uint64_t	invalidations;
+	uint64_t	promotions;
+};
+
+typedef void (*bdev_cache_get_stats_cb)(void *cb_arg, const struct vbdev_cache_stats *stats,
+					uint32_t num_stats);
+
+/**
+ * Collect the statistics of read cache bdevs.
+ *
+ * \param bdev_name Name of the read cache bdev, or NULL for all of them.
+ * \param cb_fn Function to call with the statistics once they are collected from all channels.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 on success, -ENODEV if bdev_name is not a read cache bdev, -ENOMEM if memory
+ * could not be allocated. cb_fn is called only on success.
+ */
+int bdev_cache_get_stats(const char *bdev_name, bdev_cache_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_CACHE_H */
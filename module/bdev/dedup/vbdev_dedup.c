@@ -0,0 +1,2377 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * This is a virtual block device module that deduplicates the data written to
+ * the bdev it is attached to. The dedup bdev is made of fixed size chunks, its
+ * block size. Every logical chunk is mapped to a physical chunk of the base bdev
+ * by a mapping table and physical chunks holding the same data are shared.
+ *
+ * Writes are fingerprinted with CRC32C through the accel framework and looked up
+ * in a hash index of the stored chunks. A candidate found in the index is read
+ * back and compared, so fingerprint collisions never merge different data, and
+ * the logical chunk is remapped to it instead of being written. Chunks of zeroes
+ * are not stored at all. The index uses open addressing over buckets of one cache
+ * line each, so a lookup touches very few cache lines however large the bdev is. It is
+ * split in shards with a lock each, and the mapping table in lock stripes.
+ *
+ * The base bdev is laid out as a superblock, the mapping table, the hash index and
+ * the data chunks. The mapping table and the index are kept in memory and the pages
+ * changed since the last time are written back when the dedup bdev is flushed,
+ * periodically and when it is deleted. The dedup bdev therefore reports a volatile
+ * write cache. Reference counts of the physical chunks are rebuilt from the mapping
+ * table when the bdev is loaded, and a physical chunk that is no longer referenced
+ * is reused only after the metadata that stopped referencing it is written.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_dedup.h"
+#include "spdk/accel.h"
+#include "spdk/bit_array.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* Combined with the base bdev UUID to give each dedup bdev a stable UUID */
+#define BDEV_DEDUP_NAMESPACE_UUID "4c61e0f7-93b2-4d18-8a5e-2f07b6c3d914"
+
+#define DEDUP_SB_MAGIC			"SPDKDDUP"
+#define DEDUP_SB_VERSION		1
+#define DEDUP_DEFAULT_CHUNK_SIZE	4096
+#define DEDUP_MIN_CHUNK_SIZE		512
+#define DEDUP_BUCKET_SLOTS		8
+/* Number of stored chunks per bucket the index is sized for */
+#define DEDUP_BUCKET_FILL		6
+#define DEDUP_SLOT_EMPTY		0
+#define DEDUP_SLOT_TOMBSTONE		UINT32_MAX
+/* A shard is rehashed once more than 1/DEDUP_TOMBSTONE_RATIO of its slots are tombstones */
+#define DEDUP_TOMBSTONE_RATIO		8
+/* Number of locks the mapping table and the index are split over */
+#define DEDUP_L2P_LOCKS			16
+#define DEDUP_INDEX_SHARDS		16
+#define DEDUP_NO_CHUNK			UINT32_MAX
+/* Largest number of metadata chunks read or written by a single I/O */
+#define DEDUP_MD_IO_CHUNKS		32
+#define DEDUP_SYNC_PERIOD_US		(1000 * 1000)
+#define DEDUP_IOBUF_NAME		"bdev_dedup"
+
+static int vbdev_dedup_init(void);
+static int vbdev_dedup_get_ctx_size(void);
+static void vbdev_dedup_examine_config(struct spdk_bdev *bdev);
+static void vbdev_dedup_examine_disk(struct spdk_bdev *bdev);
+static void vbdev_dedup_finish(void);
+static int vbdev_dedup_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module dedup_if = {
+	.name = "dedup",
+	.module_init = vbdev_dedup_init,
+	.get_ctx_size = vbdev_dedup_get_ctx_size,
+	.examine_config = vbdev_dedup_examine_config,
+	.examine_disk = vbdev_dedup_examine_disk,
+	.module_fini = vbdev_dedup_finish,
+	.config_json = vbdev_dedup_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(dedup, &dedup_if)
+
+/* List of dedup bdev names, their base bdevs and options. Kept so that the
+ * dedup bdev can be created in examine() once its base bdev shows up.
+ */
+struct bdev_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_dedup_opts		opts;
+	TAILQ_ENTRY(bdev_names)		link;
+};
+static TAILQ_HEAD(, bdev_names) g_bdev_names = TAILQ_HEAD_INITIALIZER(g_bdev_names);
+
+/* Stored in the first chunk of the base bdev. Offsets are in chunks. */
+struct dedup_superblock {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	chunk_size;
+	uint64_t	num_logical_chunks;
+	uint64_t	num_physical_chunks;
+	uint64_t	num_buckets;
+	uint64_t	l2p_offset;
+	uint64_t	index_offset;
+	uint64_t	data_offset;
+	uint32_t	reserved;
+	/* CRC32C of all the fields above */
+	uint32_t	crc;
+};
+SPDK_STATIC_ASSERT(sizeof(struct dedup_superblock) <= DEDUP_MIN_CHUNK_SIZE,
+		   "dedup superblock does not fit in a block");
+
+struct dedup_index_slot {
+	uint32_t	fp;
+	/* Physical chunk + 1, DEDUP_SLOT_EMPTY or DEDUP_SLOT_TOMBSTONE */
+	uint32_t	chunk;
+};
+
+struct dedup_bucket {
+	struct dedup_index_slot	slots[DEDUP_BUCKET_SLOTS];
+};
+SPDK_STATIC_ASSERT(sizeof(struct dedup_bucket) == 64, "dedup bucket is not a cache line");
+
+/* A contiguous range of buckets of the index. Probes wrap around within their shard. */
+struct dedup_index_shard {
+	struct spdk_spinlock	lock;
+	uint64_t		entries;
+	uint64_t		tombstones;
+};
+
+/* Position of a lookup in the index, so that it can go on with the next candidate */
+struct dedup_index_probe {
+	uint64_t	bucket;
+	uint32_t	slot;
+	uint32_t	count;
+};
+
+enum dedup_state {
+	DEDUP_STATE_LOADING,
+	DEDUP_STATE_ONLINE,
+	DEDUP_STATE_DESTRUCTING,
+};
+
+enum dedup_sync_step {
+	/* Make the data chunks durable before the metadata referencing them */
+	DEDUP_SYNC_FLUSH_DATA,
+	DEDUP_SYNC_WRITE_MD,
+	DEDUP_SYNC_FLUSH_MD,
+	DEDUP_SYNC_DONE,
+};
+
+/* A dedup bdev with its in-memory mapping table and hash index */
+struct vbdev_dedup {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		dd_bdev;
+	TAILQ_ENTRY(vbdev_dedup)	link;
+	struct spdk_thread		*thread;    /* metadata is loaded and written back on this thread */
+	enum dedup_state		state;
+
+	struct vbdev_dedup_opts		opts;
+	uint32_t			chunk_size;
+	/* Number of base bdev blocks in a chunk */
+	uint32_t			blocks_per_chunk;
+	uint64_t			num_logical_chunks;
+	uint64_t			num_physical_chunks;
+	uint64_t			num_buckets;
+	uint64_t			shard_buckets;
+	uint32_t			num_shards;
+	uint64_t			l2p_chunks;
+	uint64_t			data_offset;
+	uint64_t			md_chunks;
+
+	/* Mapping table followed by the hash index, exactly as stored on the base bdev */
+	uint8_t				*md;
+	uint32_t			*l2p;
+	struct dedup_bucket		*index;
+	struct dedup_superblock		*sb;
+
+	/* Entries of the mapping table are protected by the lock of their stripe and slots of
+	 * the index by the lock of their shard. Locks are taken in this order, the lock of the
+	 * node last.
+	 */
+	struct spdk_spinlock		l2p_locks[DEDUP_L2P_LOCKS];
+	struct dedup_index_shard	shards[DEDUP_INDEX_SHARDS];
+	/* Reference counts are atomic, a chunk is only looked up while it has references */
+	uint32_t			*refcnt;
+	uint32_t			*chunk_fp;
+	/* One flag per metadata page, set without a lock and cleared by the sync */
+	uint8_t				*dirty_pages;
+	bool				md_dirty;
+	uint64_t			mapped_chunks;
+
+	/* Everything below up to the sync state is protected by the lock */
+	struct spdk_spinlock		lock;
+	struct spdk_bit_array		*free_chunks;
+	/* Chunks freed since the last metadata sync started and during the current one */
+	struct spdk_bit_array		*pending_free;
+	struct spdk_bit_array		*syncing_free;
+	bool				sync_in_progress;
+	bool				sync_requested;
+	uint64_t			num_free;
+	uint64_t			num_pending;
+	uint64_t			num_syncing;
+	uint64_t			used_chunks;
+	uint32_t			alloc_hint;
+	TAILQ_HEAD(, spdk_bdev_io)	flush_waiters;
+	TAILQ_HEAD(, spdk_bdev_io)	alloc_waiters;
+
+	/* Metadata sync state, only used on the thread of the node */
+	struct spdk_io_channel		*md_ch;
+	struct spdk_poller		*sync_poller;
+	enum dedup_sync_step		sync_step;
+	int				sync_status;
+	uint32_t			sync_page;
+	uint32_t			sync_num_pages;
+	TAILQ_HEAD(, spdk_bdev_io)	sync_waiters;
+	struct spdk_bdev_io_wait_entry	md_io_wait;
+
+	bdev_dedup_create_cb		load_cb_fn;
+	void				*load_cb_arg;
+};
+static TAILQ_HEAD(, vbdev_dedup) g_dedup_nodes = TAILQ_HEAD_INITIALIZER(g_dedup_nodes);
+
+struct dedup_io_channel {
+	struct spdk_io_channel		*base_ch; /* data chunks, metadata goes through md_ch */
+	struct spdk_io_channel		*accel_ch;
+	struct spdk_iobuf_channel	iobuf;
+	struct vbdev_dedup		*node;
+
+	uint64_t			writes_deduplicated;
+	uint64_t			writes_unique;
+	uint64_t			writes_zero;
+	uint64_t			hash_collisions;
+	uint64_t			reads_unmapped;
+};
+
+struct dedup_bdev_io {
+	/* bdev related */
+	struct spdk_io_channel		*ch;
+	uint32_t			fp;
+	uint32_t			chunk;
+	struct dedup_index_probe	probe;
+	/* Buffer the candidate chunk is read into to be compared with the written data */
+	void				*buf;
+	struct spdk_iobuf_entry		iobuf_entry;
+	enum spdk_bdev_io_status	status;
+
+	/* for bdev_io_wait */
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static void dedup_md_sync(struct vbdev_dedup *node);
+static void dedup_load_format_done(struct vbdev_dedup *node, int status);
+static void dedup_destruct_done(struct vbdev_dedup *node);
+static void dedup_write_alloc(struct spdk_bdev_io *bdev_io);
+static void dedup_write_lookup(struct spdk_bdev_io *bdev_io);
+
+static inline uint64_t
+dedup_chunk_to_base_block(struct vbdev_dedup *node, uint64_t chunk)
+{
+	return chunk * node->blocks_per_chunk;
+}
+
+static inline uint64_t
+dedup_data_base_block(struct vbdev_dedup *node, uint32_t chunk)
+{
+	return dedup_chunk_to_base_block(node, node->data_offset + chunk);
+}
+
+/* Metadata pages are marked dirty without a lock, the sync clears the flags as it takes
+ * the pages.
+ */
+static void
+dedup_md_mark_dirty(struct vbdev_dedup *node, const void *ptr)
+{
+	uint64_t page = ((const uint8_t *)ptr - node->md) / node->chunk_size;
+
+	__atomic_store_n(&node->dirty_pages[page], 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&node->md_dirty, true, __ATOMIC_SEQ_CST);
+}
+
+static inline struct spdk_spinlock *
+dedup_l2p_lock(struct vbdev_dedup *node, uint64_t lchunk)
+{
+	return &node->l2p_locks[lchunk % DEDUP_L2P_LOCKS];
+}
+
+static inline uint64_t
+dedup_index_home(struct vbdev_dedup *node, uint32_t fp)
+{
+	/* CRC32C spreads well over its low bits, the bucket count is a power of two. */
+	return fp & (node->num_buckets - 1);
+}
+
+static inline struct dedup_index_shard *
+dedup_index_shard(struct vbdev_dedup *node, uint64_t b)
+{
+	return &node->shards[b / node->shard_buckets];
+}
+
+static inline uint32_t
+dedup_index_shard_slots(struct vbdev_dedup *node)
+{
+	return node->shard_buckets * DEDUP_BUCKET_SLOTS;
+}
+
+/* Return the first slot following slot i of bucket b in probe order. */
+static inline struct dedup_index_slot *
+dedup_index_next_slot(struct vbdev_dedup *node, uint64_t *b, uint32_t *i)
+{
+	if (++(*i) == DEDUP_BUCKET_SLOTS) {
+		*i = 0;
+		*b = (*b & ~(node->shard_buckets - 1)) | ((*b + 1) & (node->shard_buckets - 1));
+	}
+
+	return &node->index[*b].slots[*i];
+}
+
+/* Take a reference to a chunk, unless its last one is being dropped. */
+static bool
+dedup_chunk_get(struct vbdev_dedup *node, uint32_t chunk)
+{
+	uint32_t refcnt = __atomic_load_n(&node->refcnt[chunk], __ATOMIC_RELAXED);
+
+	do {
+		if (refcnt == 0) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&node->refcnt[chunk], &refcnt, refcnt + 1, true,
+					      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	return true;
+}
+
+static void
+dedup_index_probe_init(struct vbdev_dedup *node, uint32_t fp, struct dedup_index_probe *probe)
+{
+	probe->bucket = dedup_index_home(node, fp);
+	probe->slot = 0;
+	probe->count = 0;
+}
+
+/* Find the next stored chunk with the given fingerprint and take a reference to it. Slots
+ * are filled in probe order and removed entries leave tombstones behind, so the probe stops
+ * at the first empty slot. The shard may change between two calls with the same probe,
+ * which can only make a candidate be missed or compared twice.
+ */
+static uint32_t
+dedup_index_lookup(struct vbdev_dedup *node, uint32_t fp, struct dedup_index_probe *probe)
+{
+	struct dedup_index_shard *shard = dedup_index_shard(node, dedup_index_home(node, fp));
+	struct dedup_index_slot *slot;
+	uint32_t chunk = DEDUP_NO_CHUNK;
+
+	spdk_spin_lock(&shard->lock);
+	while (probe->count < dedup_index_shard_slots(node)) {
+		slot = &node->index[probe->bucket].slots[probe->slot];
+		if (slot->chunk == DEDUP_SLOT_EMPTY) {
+			probe->count = dedup_index_shard_slots(node);
+			break;
+		}
+		dedup_index_next_slot(node, &probe->bucket, &probe->slot);
+		probe->count++;
+		if (slot->chunk != DEDUP_SLOT_TOMBSTONE && slot->fp == fp &&
+		    dedup_chunk_get(node, slot->chunk - 1)) {
+			chunk = slot->chunk - 1;
+			break;
+		}
+	}
+	spdk_spin_unlock(&shard->lock);
+
+	return chunk;
+}
+
+/* Put an entry in the first free slot of its probe sequence. Called with the lock of the
+ * shard held.
+ */
+static int
+dedup_index_place(struct vbdev_dedup *node, uint32_t fp, uint32_t chunk)
+{
+	struct dedup_index_shard *shard;
+	struct dedup_index_slot *slot;
+	uint64_t b = dedup_index_home(node, fp);
+	uint32_t i = 0, n;
+
+	shard = dedup_index_shard(node, b);
+	slot = &node->index[b].slots[0];
+	for (n = 0; n < dedup_index_shard_slots(node); n++) {
+		if (slot->chunk == DEDUP_SLOT_EMPTY || slot->chunk == DEDUP_SLOT_TOMBSTONE) {
+			if (slot->chunk == DEDUP_SLOT_TOMBSTONE) {
+				shard->tombstones--;
+			}
+			slot->fp = fp;
+			slot->chunk = chunk + 1;
+			dedup_md_mark_dirty(node, slot);
+			return 0;
+		}
+		slot = dedup_index_next_slot(node, &b, &i);
+	}
+
+	return -ENOSPC;
+}
+
+static int
+dedup_index_insert(struct vbdev_dedup *node, uint32_t fp, uint32_t chunk)
+{
+	struct dedup_index_shard *shard = dedup_index_shard(node, dedup_index_home(node, fp));
+	int rc;
+
+	spdk_spin_lock(&shard->lock);
+	rc = dedup_index_place(node, fp, chunk);
+	if (rc == 0) {
+		shard->entries++;
+	}
+	spdk_spin_unlock(&shard->lock);
+
+	return rc;
+}
+
+/* Turn the tombstones of a shard into empty slots and move its entries back towards their
+ * home bucket. The walk starts after an empty slot, so every entry is placed again before
+ * the entries that probe past it. Called with the lock of the shard held.
+ */
+static void
+dedup_index_rehash(struct vbdev_dedup *node, struct dedup_index_shard *shard)
+{
+	struct dedup_index_slot *slot, entry;
+	uint64_t first = (shard - node->shards) * node->shard_buckets, b, start = UINT64_MAX;
+	uint32_t i, n, start_slot = 0;
+
+	for (b = first; b < first + node->shard_buckets; b++) {
+		for (i = 0; i < DEDUP_BUCKET_SLOTS; i++) {
+			slot = &node->index[b].slots[i];
+			if (slot->chunk == DEDUP_SLOT_TOMBSTONE) {
+				slot->chunk = DEDUP_SLOT_EMPTY;
+			}
+			if (slot->chunk == DEDUP_SLOT_EMPTY && start == UINT64_MAX) {
+				start = b;
+				start_slot = i;
+			}
+		}
+		dedup_md_mark_dirty(node, &node->index[b]);
+	}
+	shard->tombstones = 0;
+
+	if (start == UINT64_MAX) {
+		return;
+	}
+
+	b = start;
+	i = start_slot;
+	for (n = 1; n < dedup_index_shard_slots(node); n++) {
+		slot = dedup_index_next_slot(node, &b, &i);
+		if (slot->chunk == DEDUP_SLOT_EMPTY) {
+			continue;
+		}
+		entry = *slot;
+		slot->chunk = DEDUP_SLOT_EMPTY;
+		dedup_index_place(node, entry.fp, entry.chunk - 1);
+	}
+}
+
+static void
+dedup_index_remove(struct vbdev_dedup *node, uint32_t fp, uint32_t chunk)
+{
+	struct dedup_index_shard *shard;
+	struct dedup_index_slot *slot, *next;
+	uint64_t b = dedup_index_home(node, fp);
+	uint32_t i = 0, n;
+
+	shard = dedup_index_shard(node, b);
+	spdk_spin_lock(&shard->lock);
+	slot = &node->index[b].slots[0];
+	for (n = 0; n < dedup_index_shard_slots(node); n++) {
+		if (slot->chunk == DEDUP_SLOT_EMPTY) {
+			break;
+		}
+		next = dedup_index_next_slot(node, &b, &i);
+		if (slot->fp == fp && slot->chunk == chunk + 1) {
+			/* No probe goes past an empty slot, so the entry can be emptied if the next
+			 * slot is, otherwise it has to stay as a tombstone.
+			 */
+			if (next->chunk == DEDUP_SLOT_EMPTY) {
+				slot->chunk = DEDUP_SLOT_EMPTY;
+			} else {
+				slot->chunk = DEDUP_SLOT_TOMBSTONE;
+				shard->tombstones++;
+			}
+			shard->entries--;
+			dedup_md_mark_dirty(node, slot);
+			if (shard->tombstones * DEDUP_TOMBSTONE_RATIO > dedup_index_shard_slots(node)) {
+				dedup_index_rehash(node, shard);
+			}
+			break;
+		}
+		slot = next;
+	}
+	spdk_spin_unlock(&shard->lock);
+}
+
+/* Called with the lock held. */
+static uint32_t
+dedup_chunk_alloc(struct vbdev_dedup *node)
+{
+	uint32_t chunk;
+
+	if (node->num_free == 0) {
+		return DEDUP_NO_CHUNK;
+	}
+
+	chunk = spdk_bit_array_find_first_set(node->free_chunks, node->alloc_hint);
+	if (chunk == UINT32_MAX) {
+		chunk = spdk_bit_array_find_first_set(node->free_chunks, 0);
+	}
+	assert(chunk != UINT32_MAX);
+
+	spdk_bit_array_clear(node->free_chunks, chunk);
+	node->num_free--;
+	node->alloc_hint = chunk + 1;
+	__atomic_store_n(&node->refcnt[chunk], 1, __ATOMIC_RELAXED);
+	node->used_chunks++;
+
+	return chunk;
+}
+
+/* Drop a reference to a physical chunk. The last one removes the chunk from the index,
+ * but it can only be allocated again once the metadata is synced. Must not be called with
+ * the lock of the node held.
+ */
+static void
+dedup_chunk_put(struct vbdev_dedup *node, uint32_t chunk)
+{
+	uint32_t refcnt;
+
+	refcnt = __atomic_sub_fetch(&node->refcnt[chunk], 1, __ATOMIC_ACQ_REL);
+	assert(refcnt != UINT32_MAX);
+	if (refcnt > 0) {
+		return;
+	}
+
+	dedup_index_remove(node, node->chunk_fp[chunk], chunk);
+
+	spdk_spin_lock(&node->lock);
+	node->used_chunks--;
+	spdk_bit_array_set(node->pending_free, chunk);
+	node->num_pending++;
+	spdk_spin_unlock(&node->lock);
+}
+
+/* Map a logical chunk to a physical chunk, or unmap it if chunk is DEDUP_NO_CHUNK.
+ * The caller passes its own reference to the physical chunk on to the mapping table.
+ */
+static void
+dedup_remap(struct vbdev_dedup *node, uint64_t lchunk, uint32_t chunk)
+{
+	uint32_t old, new = chunk == DEDUP_NO_CHUNK ? 0 : chunk + 1;
+
+	spdk_spin_lock(dedup_l2p_lock(node, lchunk));
+	old = node->l2p[lchunk];
+	if (old != new) {
+		node->l2p[lchunk] = new;
+		dedup_md_mark_dirty(node, &node->l2p[lchunk]);
+	}
+	spdk_spin_unlock(dedup_l2p_lock(node, lchunk));
+
+	if (old == 0 && new != 0) {
+		__atomic_fetch_add(&node->mapped_chunks, 1, __ATOMIC_RELAXED);
+	} else if (old != 0 && new == 0) {
+		__atomic_fetch_sub(&node->mapped_chunks, 1, __ATOMIC_RELAXED);
+	}
+	if (old != 0) {
+		dedup_chunk_put(node, old - 1);
+	}
+}
+
+/* Frees the tables and the locks of a node. Also called directly when creating the
+ * node fails before it is registered as an io_device.
+ */
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_dedup *node = io_device;
+	int i;
+
+	spdk_spin_destroy(&node->lock);
+	for (i = 0; i < DEDUP_L2P_LOCKS; i++) {
+		spdk_spin_destroy(&node->l2p_locks[i]);
+	}
+	for (i = 0; i < DEDUP_INDEX_SHARDS; i++) {
+		spdk_spin_destroy(&node->shards[i].lock);
+	}
+	spdk_bit_array_free(&node->free_chunks);
+	spdk_bit_array_free(&node->pending_free);
+	spdk_bit_array_free(&node->syncing_free);
+	free(node->dirty_pages);
+	free(node->refcnt);
+	free(node->chunk_fp);
+	spdk_free(node->md);
+	spdk_free(node->sb);
+	free(node->dd_bdev.name);
+	free(node);
+}
+
+static void
+dedup_complete_io_msg(void *ctx)
+{
+	struct spdk_bdev_io *bdev_io = ctx;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	spdk_bdev_io_complete(bdev_io, io_ctx->status);
+}
+
+static void
+dedup_write_alloc_msg(void *ctx)
+{
+	dedup_write_alloc(ctx);
+}
+
+static void
+dedup_md_sync_msg(void *ctx)
+{
+	struct vbdev_dedup *node = ctx;
+
+	if (node->state == DEDUP_STATE_ONLINE) {
+		dedup_md_sync(node);
+	}
+}
+
+/* Hand I/O waiting for a metadata sync back to the threads it was submitted on. */
+static void
+dedup_md_sync_release_waiters(struct vbdev_dedup *node, int status)
+{
+	TAILQ_HEAD(, spdk_bdev_io) flush_waiters, alloc_waiters;
+	struct dedup_bdev_io *io_ctx;
+	struct spdk_bdev_io *bdev_io;
+	uint32_t chunk;
+
+	TAILQ_INIT(&flush_waiters);
+	TAILQ_INIT(&alloc_waiters);
+
+	spdk_spin_lock(&node->lock);
+	/* On failure the chunks may still be referenced on the base bdev, so they wait for
+	 * the next sync.
+	 */
+	for (chunk = spdk_bit_array_find_first_set(node->syncing_free, 0); chunk != UINT32_MAX;
+	     chunk = spdk_bit_array_find_first_set(node->syncing_free, chunk + 1)) {
+		spdk_bit_array_clear(node->syncing_free, chunk);
+		spdk_bit_array_set(status == 0 ? node->free_chunks : node->pending_free, chunk);
+	}
+	if (status == 0) {
+		node->num_free += node->num_syncing;
+	} else {
+		node->num_pending += node->num_syncing;
+	}
+	node->num_syncing = 0;
+	TAILQ_SWAP(&alloc_waiters, &node->alloc_waiters, spdk_bdev_io, module_link);
+	node->sync_in_progress = false;
+	spdk_spin_unlock(&node->lock);
+
+	TAILQ_SWAP(&flush_waiters, &node->sync_waiters, spdk_bdev_io, module_link);
+	while ((bdev_io = TAILQ_FIRST(&flush_waiters))) {
+		TAILQ_REMOVE(&flush_waiters, bdev_io, module_link);
+		io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+		io_ctx->status = status == 0 ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
+		spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io), dedup_complete_io_msg, bdev_io);
+	}
+
+	while ((bdev_io = TAILQ_FIRST(&alloc_waiters))) {
+		TAILQ_REMOVE(&alloc_waiters, bdev_io, module_link);
+		if (status == 0) {
+			spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io), dedup_write_alloc_msg, bdev_io);
+		} else {
+			io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+			io_ctx->status = SPDK_BDEV_IO_STATUS_FAILED;
+			spdk_thread_send_msg(spdk_bdev_io_get_thread(bdev_io), dedup_complete_io_msg, bdev_io);
+		}
+	}
+}
+
+static void
+dedup_md_sync_done(struct vbdev_dedup *node)
+{
+	int status = node->sync_status;
+	bool again;
+
+	if (status != 0) {
+		SPDK_ERRLOG("could not write metadata of dedup bdev %s: %s\n", node->dd_bdev.name,
+			    spdk_strerror(-status));
+	}
+
+	dedup_md_sync_release_waiters(node, status);
+
+	if (node->state == DEDUP_STATE_LOADING) {
+		dedup_load_format_done(node, status);
+		return;
+	}
+
+	spdk_spin_lock(&node->lock);
+	again = node->sync_requested || !TAILQ_EMPTY(&node->flush_waiters);
+	spdk_spin_unlock(&node->lock);
+
+	if (again) {
+		dedup_md_sync(node);
+	} else if (node->state == DEDUP_STATE_DESTRUCTING) {
+		dedup_destruct_done(node);
+	}
+}
+
+/* Take the next run of dirty metadata pages, starting at the sync cursor. */
+static uint32_t
+dedup_md_take_dirty(struct vbdev_dedup *node, uint32_t *num_pages)
+{
+	uint32_t page, n = 0;
+
+	for (page = node->sync_page; page < node->md_chunks; page++) {
+		if (__atomic_load_n(&node->dirty_pages[page], __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	while (n < DEDUP_MD_IO_CHUNKS && page + n < node->md_chunks &&
+	       __atomic_exchange_n(&node->dirty_pages[page + n], 0, __ATOMIC_SEQ_CST)) {
+		n++;
+	}
+
+	*num_pages = n;
+	return page;
+}
+
+static void
+dedup_md_redirty(struct vbdev_dedup *node, uint32_t page, uint32_t num_pages)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_pages; i++) {
+		__atomic_store_n(&node->dirty_pages[page + i], 1, __ATOMIC_SEQ_CST);
+	}
+	__atomic_store_n(&node->md_dirty, true, __ATOMIC_SEQ_CST);
+}
+
+static void dedup_md_sync_next(void *ctx);
+
+static void
+dedup_md_sync_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *node = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		if (node->sync_step == DEDUP_SYNC_WRITE_MD) {
+			dedup_md_redirty(node, node->sync_page, node->sync_num_pages);
+		}
+		node->sync_status = -EIO;
+		node->sync_step = DEDUP_SYNC_DONE;
+	} else if (node->sync_step == DEDUP_SYNC_WRITE_MD) {
+		node->sync_page += node->sync_num_pages;
+	} else {
+		node->sync_step++;
+	}
+
+	dedup_md_sync_next(node);
+}
+
+static void
+dedup_md_sync_next(void *ctx)
+{
+	struct vbdev_dedup *node = ctx;
+	uint32_t page, num_pages = 0;
+	int rc;
+
+	switch (node->sync_step) {
+	case DEDUP_SYNC_FLUSH_DATA:
+	case DEDUP_SYNC_FLUSH_MD:
+		if (!spdk_bdev_io_type_supported(node->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+			node->sync_step++;
+			dedup_md_sync_next(node);
+			return;
+		}
+		rc = spdk_bdev_flush_blocks(node->base_desc, node->md_ch, 0,
+					    spdk_bdev_get_num_blocks(node->base_bdev),
+					    dedup_md_sync_io_done, node);
+		break;
+	case DEDUP_SYNC_WRITE_MD:
+		page = dedup_md_take_dirty(node, &num_pages);
+		if (num_pages == 0) {
+			node->sync_step++;
+			dedup_md_sync_next(node);
+			return;
+		}
+		node->sync_page = page;
+		node->sync_num_pages = num_pages;
+		rc = spdk_bdev_write_blocks(node->base_desc, node->md_ch,
+					    node->md + (uint64_t)page * node->chunk_size,
+					    dedup_chunk_to_base_block(node, 1 + page),
+					    dedup_chunk_to_base_block(node, num_pages),
+					    dedup_md_sync_io_done, node);
+		if (rc != 0) {
+			dedup_md_redirty(node, page, num_pages);
+		}
+		break;
+	default:
+		dedup_md_sync_done(node);
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		node->md_io_wait.bdev = node->base_bdev;
+		node->md_io_wait.cb_fn = dedup_md_sync_next;
+		node->md_io_wait.cb_arg = node;
+		rc = spdk_bdev_queue_io_wait(node->base_bdev, node->md_ch, &node->md_io_wait);
+	}
+	if (rc != 0) {
+		node->sync_status = rc;
+		node->sync_step = DEDUP_SYNC_DONE;
+		dedup_md_sync_done(node);
+	}
+}
+
+/* Write the metadata pages changed since the last sync to the base bdev. Runs on the
+ * thread of the node, a sync requested while one is in progress starts once it is done.
+ */
+static void
+dedup_md_sync(struct vbdev_dedup *node)
+{
+	struct spdk_bit_array *tmp;
+
+	assert(spdk_get_thread() == node->thread);
+
+	spdk_spin_lock(&node->lock);
+	if (node->sync_in_progress) {
+		node->sync_requested = true;
+		spdk_spin_unlock(&node->lock);
+		return;
+	}
+
+	node->sync_in_progress = true;
+	node->sync_requested = false;
+	__atomic_store_n(&node->md_dirty, false, __ATOMIC_SEQ_CST);
+	TAILQ_SWAP(&node->sync_waiters, &node->flush_waiters, spdk_bdev_io, module_link);
+
+	/* Chunks freed so far become reusable once this sync writes the metadata. */
+	assert(node->num_syncing == 0);
+	tmp = node->syncing_free;
+	node->syncing_free = node->pending_free;
+	node->pending_free = tmp;
+	node->num_syncing = node->num_pending;
+	node->num_pending = 0;
+	spdk_spin_unlock(&node->lock);
+
+	node->sync_status = 0;
+	node->sync_page = 0;
+	node->sync_step = DEDUP_SYNC_FLUSH_DATA;
+	dedup_md_sync_next(node);
+}
+
+static int
+dedup_md_sync_poller(void *ctx)
+{
+	struct vbdev_dedup *node = ctx;
+	bool dirty;
+
+	spdk_spin_lock(&node->lock);
+	dirty = !node->sync_in_progress &&
+		(__atomic_load_n(&node->md_dirty, __ATOMIC_SEQ_CST) || node->num_pending > 0);
+	spdk_spin_unlock(&node->lock);
+
+	if (!dirty) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	dedup_md_sync(node);
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+dedup_destruct_done(struct vbdev_dedup *node)
+{
+	spdk_put_io_channel(node->md_ch);
+	spdk_bdev_close(node->base_desc);
+	spdk_io_device_unregister(node, _device_unregister_cb);
+	spdk_bdev_destruct_done(&node->dd_bdev, node->sync_status);
+}
+
+/* Write the metadata one last time before the base bdev is closed. */
+static void
+_vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *node = ctx;
+
+	node->state = DEDUP_STATE_DESTRUCTING;
+	spdk_poller_unregister(&node->sync_poller);
+	dedup_md_sync(node);
+}
+
+/* Called when the dedup bdev is unregistered. The dirty metadata pages are written back
+ * first, the destruction completes once that's done.
+ */
+static int
+vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *node = (struct vbdev_dedup *)ctx;
+
+	TAILQ_REMOVE(&g_dedup_nodes, node, link);
+
+	spdk_bdev_module_release_bdev(node->base_bdev);
+
+	/* The metadata is written on the thread the underlying bdev was opened on. */
+	if (node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(node->thread, _vbdev_dedup_destruct, node);
+	} else {
+		_vbdev_dedup_destruct(node);
+	}
+
+	return 1;
+}
+
+static void
+dedup_queue_io(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn, int *rc)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+
+	if (*rc != -ENOMEM) {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		return;
+	}
+
+	SPDK_ERRLOG("No memory, start to queue io for dedup.\n");
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = cb_fn;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	/* Resumed at the same step of the request once the base bdev has a bdev_io free. */
+	*rc = spdk_bdev_queue_io_wait(bdev_io->bdev, dd_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (*rc != 0) {
+		SPDK_ERRLOG("Queue io failed in dedup_queue_io, rc=%d.\n", *rc);
+	}
+}
+
+static void
+dedup_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)orig_io->driver_ctx;
+	struct vbdev_dedup *node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_dedup, dd_bdev);
+
+	spdk_bdev_free_io(bdev_io);
+
+	dedup_chunk_put(node, io_ctx->chunk);
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+dedup_read_submit(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(node->base_desc, dd_ch->base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, dedup_data_base_block(node, io_ctx->chunk),
+				    node->blocks_per_chunk, dedup_read_done, bdev_io);
+	if (rc != 0) {
+		dedup_queue_io(bdev_io, dedup_read_submit, &rc);
+		if (rc != 0) {
+			dedup_chunk_put(node, io_ctx->chunk);
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+static void
+dedup_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	uint32_t mapping;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Hold a reference, so that the chunk is not reused while it is being read. */
+	spdk_spin_lock(dedup_l2p_lock(node, bdev_io->u.bdev.offset_blocks));
+	mapping = node->l2p[bdev_io->u.bdev.offset_blocks];
+	if (mapping != 0) {
+		__atomic_fetch_add(&node->refcnt[mapping - 1], 1, __ATOMIC_RELAXED);
+	}
+	spdk_spin_unlock(dedup_l2p_lock(node, bdev_io->u.bdev.offset_blocks));
+
+	if (mapping == 0) {
+		dd_ch->reads_unmapped++;
+		spdk_iov_memset(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, 0);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	io_ctx->ch = ch;
+	io_ctx->chunk = mapping - 1;
+	dedup_read_submit(bdev_io);
+}
+
+static void
+dedup_write_data_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)orig_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (success) {
+		/* A full index only costs deduplication of this chunk. */
+		node->chunk_fp[io_ctx->chunk] = io_ctx->fp;
+		dedup_index_insert(node, io_ctx->fp, io_ctx->chunk);
+		dedup_remap(node, orig_io->u.bdev.offset_blocks, io_ctx->chunk);
+	} else {
+		node->chunk_fp[io_ctx->chunk] = 0;
+		dedup_chunk_put(node, io_ctx->chunk);
+	}
+
+	if (success) {
+		dd_ch->writes_unique++;
+	}
+	spdk_bdev_io_complete(orig_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+dedup_write_data(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	int rc;
+
+	rc = spdk_bdev_writev_blocks(node->base_desc, dd_ch->base_ch, bdev_io->u.bdev.iovs,
+				     bdev_io->u.bdev.iovcnt, dedup_data_base_block(node, io_ctx->chunk),
+				     node->blocks_per_chunk, dedup_write_data_done, bdev_io);
+	if (rc != 0) {
+		dedup_queue_io(bdev_io, dedup_write_data, &rc);
+		if (rc != 0) {
+			dedup_chunk_put(node, io_ctx->chunk);
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+/* Store the data of a write in a newly allocated chunk. When no chunk is free but some
+ * are waiting for the metadata to be synced, the write waits for the sync.
+ */
+static void
+dedup_write_alloc(struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct vbdev_dedup *node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedup, dd_bdev);
+	bool wait = false;
+
+	spdk_spin_lock(&node->lock);
+	io_ctx->chunk = dedup_chunk_alloc(node);
+	if (io_ctx->chunk == DEDUP_NO_CHUNK && (node->num_pending > 0 || node->num_syncing > 0)) {
+		TAILQ_INSERT_TAIL(&node->alloc_waiters, bdev_io, module_link);
+		node->sync_requested = true;
+		wait = true;
+	}
+	spdk_spin_unlock(&node->lock);
+
+	if (wait) {
+		spdk_thread_send_msg(node->thread, dedup_md_sync_msg, node);
+		return;
+	}
+
+	if (io_ctx->chunk == DEDUP_NO_CHUNK) {
+		SPDK_ERRLOG("dedup bdev %s is out of space\n", node->dd_bdev.name);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedup_write_data(bdev_io);
+}
+
+static bool
+dedup_iovs_equal(struct iovec *iovs, int iovcnt, const uint8_t *buf)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (memcmp(iovs[i].iov_base, buf, iovs[i].iov_len) != 0) {
+			return false;
+		}
+		buf += iovs[i].iov_len;
+	}
+
+	return true;
+}
+
+static bool
+dedup_iovs_zero(struct iovec *iovs, int iovcnt)
+{
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		if (!spdk_mem_all_zero(iovs[i].iov_base, iovs[i].iov_len)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+dedup_write_cmp_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)orig_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	bool equal;
+
+	spdk_bdev_free_io(bdev_io);
+
+	equal = success && dedup_iovs_equal(orig_io->u.bdev.iovs, orig_io->u.bdev.iovcnt, io_ctx->buf);
+	spdk_iobuf_put(&dd_ch->iobuf, io_ctx->buf, node->chunk_size);
+	io_ctx->buf = NULL;
+
+	if (!equal) {
+		dedup_chunk_put(node, io_ctx->chunk);
+		if (success) {
+			/* Different data with the same fingerprint, try the next candidate. */
+			dd_ch->hash_collisions++;
+			dedup_write_lookup(orig_io);
+		} else {
+			dedup_write_alloc(orig_io);
+		}
+		return;
+	}
+
+	dedup_remap(node, orig_io->u.bdev.offset_blocks, io_ctx->chunk);
+
+	dd_ch->writes_deduplicated++;
+	spdk_bdev_io_complete(orig_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+dedup_write_read_candidate(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	int rc;
+
+	rc = spdk_bdev_read_blocks(node->base_desc, dd_ch->base_ch, io_ctx->buf,
+				   dedup_data_base_block(node, io_ctx->chunk), node->blocks_per_chunk,
+				   dedup_write_cmp_done, bdev_io);
+	if (rc != 0) {
+		dedup_queue_io(bdev_io, dedup_write_read_candidate, &rc);
+		if (rc != 0) {
+			spdk_iobuf_put(&dd_ch->iobuf, io_ctx->buf, node->chunk_size);
+			dedup_chunk_put(node, io_ctx->chunk);
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+static void
+dedup_write_iobuf_get_cb(struct spdk_iobuf_entry *entry, void *buf)
+{
+	struct dedup_bdev_io *io_ctx = SPDK_CONTAINEROF(entry, struct dedup_bdev_io, iobuf_entry);
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io_ctx);
+
+	io_ctx->buf = buf;
+	dedup_write_read_candidate(bdev_io);
+}
+
+static void
+dedup_write_lookup(struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct vbdev_dedup *node = dd_ch->node;
+
+	/* Hold a reference to the candidate, so that it does not go away while compared. */
+	io_ctx->chunk = dedup_index_lookup(node, io_ctx->fp, &io_ctx->probe);
+
+	if (io_ctx->chunk == DEDUP_NO_CHUNK) {
+		dedup_write_alloc(bdev_io);
+		return;
+	}
+
+	io_ctx->buf = spdk_iobuf_get(&dd_ch->iobuf, node->chunk_size, &io_ctx->iobuf_entry,
+				     dedup_write_iobuf_get_cb);
+	if (io_ctx->buf != NULL) {
+		dedup_write_read_candidate(bdev_io);
+	}
+}
+
+static void
+dedup_write_fp_done(void *cb_arg, int status)
+{
+	struct spdk_bdev_io *bdev_io = cb_arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	if (status != 0) {
+		/* Same value as the accel framework computes. */
+		io_ctx->fp = spdk_crc32c_iov_update(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, ~0u);
+	}
+
+	dedup_index_probe_init(SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedup, dd_bdev),
+			       io_ctx->fp, &io_ctx->probe);
+	dedup_write_lookup(bdev_io);
+}
+
+static void
+dedup_write(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	int rc;
+
+	/* The bdev is split on every chunk, so each write covers exactly one. */
+	assert(bdev_io->u.bdev.num_blocks == 1);
+
+	if (dedup_iovs_zero(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt)) {
+		dedup_remap(node, bdev_io->u.bdev.offset_blocks, DEDUP_NO_CHUNK);
+		dd_ch->writes_zero++;
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	io_ctx->ch = ch;
+	rc = spdk_accel_submit_crc32cv(dd_ch->accel_ch, &io_ctx->fp, bdev_io->u.bdev.iovs,
+				       bdev_io->u.bdev.iovcnt, 0, dedup_write_fp_done, bdev_io);
+	if (rc != 0) {
+		dedup_write_fp_done(bdev_io, rc);
+	}
+}
+
+static void
+dedup_unmap(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedup *node = dd_ch->node;
+	uint64_t lchunk;
+
+	for (lchunk = bdev_io->u.bdev.offset_blocks;
+	     lchunk < bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks; lchunk++) {
+		dedup_remap(node, lchunk, DEDUP_NO_CHUNK);
+	}
+
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+/* Flushing the dedup bdev writes its metadata, which also flushes the base bdev. */
+static void
+dedup_flush(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedup *node = dd_ch->node;
+
+	spdk_spin_lock(&node->lock);
+	TAILQ_INSERT_TAIL(&node->flush_waiters, bdev_io, module_link);
+	spdk_spin_unlock(&node->lock);
+
+	/* If the message cannot be sent, the periodic sync picks the flush up. */
+	spdk_thread_send_msg(node->thread, dedup_md_sync_msg, node);
+}
+
+static void
+_dedup_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	int status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
+
+	spdk_bdev_io_complete(orig_io, status);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+dedup_reset(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = arg;
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	rc = spdk_bdev_reset(dd_ch->node->base_desc, dd_ch->base_ch, _dedup_complete_io, bdev_io);
+	if (rc != 0) {
+		dedup_queue_io(bdev_io, dedup_reset, &rc);
+		if (rc != 0) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+/* Called when someone above submits IO to this dedup vbdev. */
+static void
+vbdev_dedup_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct dedup_bdev_io *io_ctx = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, dedup_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		dedup_write(ch, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		dedup_unmap(ch, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		dedup_flush(ch, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		io_ctx->ch = ch;
+		dedup_reset(bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("dedup: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static bool
+vbdev_dedup_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_dedup *node = (struct vbdev_dedup *)ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return true;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(node->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_dedup_get_io_channel(void *ctx)
+{
+	struct vbdev_dedup *node = (struct vbdev_dedup *)ctx;
+
+	return spdk_get_io_channel(node);
+}
+
+static void
+vbdev_dedup_write_opts(struct spdk_json_write_ctx *w, struct vbdev_dedup *node)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&node->dd_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(node->base_bdev));
+	spdk_json_write_named_uint32(w, "chunk_size", node->opts.chunk_size);
+	spdk_json_write_named_uint64(w, "logical_size_mb", node->opts.logical_size_mb);
+}
+
+/* bdev_get_bdevs reports the options and the size of the tables under "dedup" */
+static int
+vbdev_dedup_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *node = (struct vbdev_dedup *)ctx;
+
+	spdk_json_write_name(w, "dedup");
+	spdk_json_write_object_begin(w);
+	vbdev_dedup_write_opts(w, node);
+	spdk_json_write_named_uint64(w, "physical_chunks", node->num_physical_chunks);
+	spdk_json_write_named_uint64(w, "index_buckets", node->num_buckets);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* A bdev_dedup_create call per dedup bdev. The existing metadata is loaded from the
+ * base bdev again, the options only matter for the sizes of a new one.
+ */
+static int
+vbdev_dedup_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *node;
+
+	TAILQ_FOREACH(node, &g_dedup_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_dedup_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_dedup_write_opts(w, node);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+dedup_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct dedup_io_channel *dd_ch = ctx_buf;
+	struct vbdev_dedup *node = io_device;
+	int rc;
+
+	dd_ch->node = node;
+
+	rc = spdk_iobuf_channel_init(&dd_ch->iobuf, DEDUP_IOBUF_NAME, 0, 0);
+	if (rc != 0) {
+		return rc;
+	}
+
+	dd_ch->accel_ch = spdk_accel_get_io_channel();
+	if (dd_ch->accel_ch == NULL) {
+		spdk_iobuf_channel_fini(&dd_ch->iobuf);
+		return -ENOMEM;
+	}
+
+	dd_ch->base_ch = spdk_bdev_get_io_channel(node->base_desc);
+	if (dd_ch->base_ch == NULL) {
+		spdk_put_io_channel(dd_ch->accel_ch);
+		spdk_iobuf_channel_fini(&dd_ch->iobuf);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+dedup_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct dedup_io_channel *dd_ch = ctx_buf;
+
+	spdk_iobuf_channel_fini(&dd_ch->iobuf);
+	spdk_put_io_channel(dd_ch->accel_ch);
+	spdk_put_io_channel(dd_ch->base_ch);
+}
+
+/* Create the dedup association from the bdev and vbdev name and insert
+ * on the global list. */
+static int
+vbdev_dedup_insert_name(const char *bdev_name, const char *vbdev_name,
+			const struct vbdev_dedup_opts *opts, struct bdev_names **_name)
+{
+	struct bdev_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("dedup bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	if (!name->bdev_name) {
+		SPDK_ERRLOG("could not allocate name->bdev_name\n");
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate name->vbdev_name\n");
+		free(name->bdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->opts = *opts;
+	if (name->opts.chunk_size == 0) {
+		name->opts.chunk_size = DEDUP_DEFAULT_CHUNK_SIZE;
+	}
+
+	TAILQ_INSERT_TAIL(&g_bdev_names, name, link);
+	*_name = name;
+
+	return 0;
+}
+
+static void
+vbdev_dedup_remove_name(struct bdev_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_dedup_init(void)
+{
+	return spdk_iobuf_register_module(DEDUP_IOBUF_NAME);
+}
+
+/* The dedup bdevs have written back their metadata by now, forget their configs. */
+static void
+vbdev_dedup_finish(void)
+{
+	struct bdev_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_names))) {
+		vbdev_dedup_remove_name(name);
+	}
+
+	spdk_iobuf_unregister_module(DEDUP_IOBUF_NAME);
+}
+
+static int
+vbdev_dedup_get_ctx_size(void)
+{
+	return sizeof(struct dedup_bdev_io);
+}
+
+/* Per bdev configuration is entirely covered by bdev_dedup_create. */
+static void
+vbdev_dedup_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+}
+
+/* When we register our bdev this is how we specify our entry points. Data is compared
+ * and checked for zeroes in the buffers of the I/O, so no memory domains are reported.
+ */
+static const struct spdk_bdev_fn_table vbdev_dedup_fn_table = {
+	.destruct		= vbdev_dedup_destruct,
+	.submit_request		= vbdev_dedup_submit_request,
+	.io_type_supported	= vbdev_dedup_io_type_supported,
+	.get_io_channel		= vbdev_dedup_get_io_channel,
+	.dump_info_json		= vbdev_dedup_dump_info_json,
+	.write_config_json	= vbdev_dedup_write_config_json,
+};
+
+static void
+vbdev_dedup_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_dedup *node, *tmp;
+
+	TAILQ_FOREACH_SAFE(node, &g_dedup_nodes, link, tmp) {
+		if (bdev_find == node->base_bdev) {
+			spdk_bdev_unregister(&node->dd_bdev, NULL, NULL);
+		}
+	}
+}
+
+/* The chunks live on the base bdev, so the dedup bdev can't outlive it. */
+static void
+vbdev_dedup_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			       void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_dedup_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static uint32_t
+dedup_sb_crc(const struct dedup_superblock *sb)
+{
+	return spdk_crc32c_update(sb, offsetof(struct dedup_superblock, crc), ~0u);
+}
+
+/* Chunks are read from the base bdev into buffers of the iobuf pool, so a chunk
+ * cannot be larger than its buffer size.
+ */
+static int
+dedup_check_chunk_size(struct vbdev_dedup *node, uint32_t chunk_size)
+{
+	struct spdk_iobuf_opts iobuf_opts;
+
+	spdk_iobuf_get_opts(&iobuf_opts);
+	if (chunk_size < DEDUP_MIN_CHUNK_SIZE || !spdk_u32_is_pow2(chunk_size) ||
+	    chunk_size % node->base_bdev->blocklen != 0 || chunk_size > iobuf_opts.large_bufsize) {
+		SPDK_ERRLOG("chunk size %u is invalid for bdev %s with block size %u\n", chunk_size,
+			    node->base_bdev->name, node->base_bdev->blocklen);
+		return -EINVAL;
+	}
+
+	node->chunk_size = chunk_size;
+	node->blocks_per_chunk = chunk_size / node->base_bdev->blocklen;
+	return 0;
+}
+
+static uint64_t
+dedup_l2p_chunks(struct vbdev_dedup *node, uint64_t num_logical_chunks)
+{
+	return spdk_divide_round_up(num_logical_chunks * sizeof(uint32_t), node->chunk_size);
+}
+
+static uint64_t
+dedup_index_chunks(struct vbdev_dedup *node, uint64_t num_buckets)
+{
+	return spdk_divide_round_up(num_buckets * sizeof(struct dedup_bucket), node->chunk_size);
+}
+
+/* Lay the base bdev out as the superblock, the mapping table, the index and the data. */
+static int
+dedup_format_layout(struct vbdev_dedup *node)
+{
+	uint64_t total, num_logical, num_physical, index_chunks;
+	int rc;
+
+	rc = dedup_check_chunk_size(node, node->opts.chunk_size);
+	if (rc != 0) {
+		return rc;
+	}
+	total = spdk_bdev_get_num_blocks(node->base_bdev) / node->blocks_per_chunk;
+
+	/* Without a logical size, the mapping table is sized for the whole base bdev. */
+	num_logical = node->opts.logical_size_mb * 1024 * 1024 / node->chunk_size;
+	node->l2p_chunks = dedup_l2p_chunks(node, num_logical != 0 ? num_logical : total);
+	if (1 + node->l2p_chunks >= total) {
+		goto no_space;
+	}
+
+	num_physical = total - 1 - node->l2p_chunks;
+	node->num_buckets = spdk_align64pow2(spdk_divide_round_up(num_physical, DEDUP_BUCKET_FILL));
+	index_chunks = dedup_index_chunks(node, node->num_buckets);
+	if (index_chunks >= num_physical) {
+		goto no_space;
+	}
+
+	node->num_physical_chunks = num_physical - index_chunks;
+	node->num_logical_chunks = num_logical != 0 ? num_logical : node->num_physical_chunks;
+	node->data_offset = 1 + node->l2p_chunks + index_chunks;
+	node->opts.logical_size_mb = node->num_logical_chunks * node->chunk_size / (1024 * 1024);
+
+	if (node->num_physical_chunks >= UINT32_MAX - 1 || node->num_logical_chunks >= UINT32_MAX) {
+		SPDK_ERRLOG("bdev %s has too many chunks of %u bytes\n", node->base_bdev->name,
+			    node->chunk_size);
+		return -EINVAL;
+	}
+
+	memset(node->sb, 0, sizeof(*node->sb));
+	memcpy(node->sb->magic, DEDUP_SB_MAGIC, sizeof(node->sb->magic));
+	node->sb->version = DEDUP_SB_VERSION;
+	node->sb->chunk_size = node->chunk_size;
+	node->sb->num_logical_chunks = node->num_logical_chunks;
+	node->sb->num_physical_chunks = node->num_physical_chunks;
+	node->sb->num_buckets = node->num_buckets;
+	node->sb->l2p_offset = 1;
+	node->sb->index_offset = 1 + node->l2p_chunks;
+	node->sb->data_offset = node->data_offset;
+	node->sb->crc = dedup_sb_crc(node->sb);
+
+	return 0;
+
+no_space:
+	SPDK_ERRLOG("bdev %s is too small for a dedup bdev\n", node->base_bdev->name);
+	return -ENOSPC;
+}
+
+static int
+dedup_load_layout(struct vbdev_dedup *node)
+{
+	struct dedup_superblock *sb = node->sb;
+	uint64_t total = spdk_bdev_get_num_blocks(node->base_bdev);
+	int rc;
+
+	if (sb->version != DEDUP_SB_VERSION || sb->crc != dedup_sb_crc(sb)) {
+		SPDK_ERRLOG("dedup superblock on bdev %s is corrupted\n", node->base_bdev->name);
+		return -EILSEQ;
+	}
+
+	rc = dedup_check_chunk_size(node, sb->chunk_size);
+	if (rc != 0) {
+		return rc;
+	}
+
+	node->num_logical_chunks = sb->num_logical_chunks;
+	node->num_physical_chunks = sb->num_physical_chunks;
+	node->num_buckets = sb->num_buckets;
+	node->l2p_chunks = dedup_l2p_chunks(node, sb->num_logical_chunks);
+	node->data_offset = sb->data_offset;
+
+	if (sb->l2p_offset != 1 || sb->index_offset != 1 + node->l2p_chunks ||
+	    sb->data_offset != sb->index_offset + dedup_index_chunks(node, sb->num_buckets) ||
+	    !spdk_u64_is_pow2(sb->num_buckets) || sb->num_physical_chunks >= UINT32_MAX - 1 ||
+	    sb->num_logical_chunks >= UINT32_MAX ||
+	    dedup_chunk_to_base_block(node, sb->data_offset + sb->num_physical_chunks) > total) {
+		SPDK_ERRLOG("dedup superblock on bdev %s has an invalid layout\n", node->base_bdev->name);
+		return -EILSEQ;
+	}
+
+	node->opts.chunk_size = node->chunk_size;
+	node->opts.logical_size_mb = node->num_logical_chunks * node->chunk_size / (1024 * 1024);
+
+	return 0;
+}
+
+static int
+dedup_alloc_md(struct vbdev_dedup *node)
+{
+	node->md_chunks = node->data_offset - 1;
+	node->md = spdk_zmalloc(node->md_chunks * node->chunk_size,
+				spdk_bdev_get_buf_align(node->base_bdev), NULL,
+				SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	node->refcnt = calloc(node->num_physical_chunks, sizeof(*node->refcnt));
+	node->chunk_fp = calloc(node->num_physical_chunks, sizeof(*node->chunk_fp));
+	node->free_chunks = spdk_bit_array_create(node->num_physical_chunks);
+	node->pending_free = spdk_bit_array_create(node->num_physical_chunks);
+	node->syncing_free = spdk_bit_array_create(node->num_physical_chunks);
+	node->dirty_pages = calloc(node->md_chunks, sizeof(*node->dirty_pages));
+	if (node->md == NULL || node->refcnt == NULL || node->chunk_fp == NULL ||
+	    node->free_chunks == NULL || node->pending_free == NULL || node->syncing_free == NULL ||
+	    node->dirty_pages == NULL) {
+		SPDK_ERRLOG("could not allocate metadata of dedup bdev %s\n", node->dd_bdev.name);
+		return -ENOMEM;
+	}
+
+	node->l2p = (uint32_t *)node->md;
+	node->index = (struct dedup_bucket *)(node->md + node->l2p_chunks * node->chunk_size);
+	node->num_shards = spdk_min(node->num_buckets, DEDUP_INDEX_SHARDS);
+	node->shard_buckets = node->num_buckets / node->num_shards;
+
+	return 0;
+}
+
+/* Reference counts are not stored, they are rebuilt from the mapping table. Index
+ * entries of chunks that are not referenced anymore are dropped and shards with too many
+ * tombstones are rehashed.
+ */
+static void
+dedup_rebuild(struct vbdev_dedup *node)
+{
+	struct dedup_index_shard *shard;
+	struct dedup_index_slot *slot;
+	uint64_t lchunk, b;
+	uint32_t chunk, i;
+
+	for (lchunk = 0; lchunk < node->num_logical_chunks; lchunk++) {
+		if (node->l2p[lchunk] == 0) {
+			continue;
+		}
+		chunk = node->l2p[lchunk] - 1;
+		if (chunk >= node->num_physical_chunks) {
+			SPDK_ERRLOG("dedup bdev %s maps chunk %" PRIu64 " out of range, unmapping it\n",
+				    node->dd_bdev.name, lchunk);
+			node->l2p[lchunk] = 0;
+			dedup_md_mark_dirty(node, &node->l2p[lchunk]);
+			continue;
+		}
+		if (node->refcnt[chunk]++ == 0) {
+			node->used_chunks++;
+		}
+		node->mapped_chunks++;
+	}
+
+	for (b = 0; b < node->num_buckets; b++) {
+		shard = dedup_index_shard(node, b);
+		for (i = 0; i < DEDUP_BUCKET_SLOTS; i++) {
+			slot = &node->index[b].slots[i];
+			if (slot->chunk == DEDUP_SLOT_EMPTY) {
+				continue;
+			}
+			if (slot->chunk == DEDUP_SLOT_TOMBSTONE) {
+				shard->tombstones++;
+				continue;
+			}
+			chunk = slot->chunk - 1;
+			if (chunk >= node->num_physical_chunks || node->refcnt[chunk] == 0) {
+				slot->chunk = DEDUP_SLOT_TOMBSTONE;
+				shard->tombstones++;
+				dedup_md_mark_dirty(node, slot);
+				continue;
+			}
+			node->chunk_fp[chunk] = slot->fp;
+			shard->entries++;
+		}
+	}
+
+	for (i = 0; i < node->num_shards; i++) {
+		shard = &node->shards[i];
+		if (shard->tombstones * DEDUP_TOMBSTONE_RATIO > dedup_index_shard_slots(node)) {
+			dedup_index_rehash(node, shard);
+		}
+	}
+
+	for (chunk = 0; chunk < node->num_physical_chunks; chunk++) {
+		if (node->refcnt[chunk] == 0) {
+			spdk_bit_array_set(node->free_chunks, chunk);
+			node->num_free++;
+		}
+	}
+}
+
+static void
+dedup_load_fail(struct vbdev_dedup *node, int rc)
+{
+	bdev_dedup_create_cb cb_fn = node->load_cb_fn;
+	void *cb_arg = node->load_cb_arg;
+
+	spdk_put_io_channel(node->md_ch);
+	spdk_bdev_module_release_bdev(node->base_bdev);
+	spdk_bdev_close(node->base_desc);
+	_device_unregister_cb(node);
+
+	cb_fn(cb_arg, rc);
+}
+
+static void
+dedup_load_finish(struct vbdev_dedup *node)
+{
+	struct spdk_uuid ns_uuid;
+	int rc;
+
+	spdk_uuid_parse(&ns_uuid, BDEV_DEDUP_NAMESPACE_UUID);
+
+	/* Reloading the same base bdev gives the same UUID. */
+	rc = spdk_uuid_generate_sha1(&node->dd_bdev.uuid, &ns_uuid,
+				     (const char *)&node->base_bdev->uuid, sizeof(struct spdk_uuid));
+	if (rc) {
+		SPDK_ERRLOG("Unable to generate new UUID for dedup bdev\n");
+		dedup_load_fail(node, rc);
+		return;
+	}
+
+	/* The metadata is written back lazily, so the bdev has to be flushed for it to
+	 * be persistent. Every I/O covers a single chunk.
+	 */
+	node->dd_bdev.write_cache = 1;
+	node->dd_bdev.required_alignment = node->base_bdev->required_alignment;
+	node->dd_bdev.optimal_io_boundary = 1;
+	node->dd_bdev.split_on_optimal_io_boundary = true;
+	node->dd_bdev.blocklen = node->chunk_size;
+	node->dd_bdev.blockcnt = node->num_logical_chunks;
+
+	node->dd_bdev.ctxt = node;
+	node->dd_bdev.fn_table = &vbdev_dedup_fn_table;
+	node->dd_bdev.module = &dedup_if;
+	node->state = DEDUP_STATE_ONLINE;
+	TAILQ_INSERT_TAIL(&g_dedup_nodes, node, link);
+
+	spdk_io_device_register(node, dedup_bdev_ch_create_cb, dedup_bdev_ch_destroy_cb,
+				sizeof(struct dedup_io_channel), node->dd_bdev.name);
+
+	rc = spdk_bdev_register(&node->dd_bdev);
+	if (rc) {
+		SPDK_ERRLOG("could not register dd_bdev\n");
+		TAILQ_REMOVE(&g_dedup_nodes, node, link);
+		spdk_put_io_channel(node->md_ch);
+		spdk_bdev_module_release_bdev(node->base_bdev);
+		spdk_bdev_close(node->base_desc);
+		spdk_io_device_unregister(node, _device_unregister_cb);
+		node->load_cb_fn(node->load_cb_arg, rc);
+		return;
+	}
+
+	node->sync_poller = SPDK_POLLER_REGISTER(dedup_md_sync_poller, node, DEDUP_SYNC_PERIOD_US);
+	SPDK_NOTICELOG("created dedup bdev %s for: %s\n", node->dd_bdev.name, node->base_bdev->name);
+	node->load_cb_fn(node->load_cb_arg, 0);
+}
+
+static void
+dedup_load_sb_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *node = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("could not write dedup superblock to bdev %s\n", node->base_bdev->name);
+		dedup_load_fail(node, -EIO);
+		return;
+	}
+
+	dedup_load_finish(node);
+}
+
+/* The superblock is written only after the zeroed metadata, so that a format that did
+ * not finish is not mistaken for a valid dedup bdev.
+ */
+static void
+dedup_load_format_done(struct vbdev_dedup *node, int status)
+{
+	int rc;
+
+	if (status != 0) {
+		dedup_load_fail(node, status);
+		return;
+	}
+
+	rc = spdk_bdev_write_blocks(node->base_desc, node->md_ch, node->sb, 0, 1,
+				    dedup_load_sb_write_done, node);
+	if (rc != 0) {
+		dedup_load_fail(node, rc);
+	}
+}
+
+static void dedup_load_read_md(struct vbdev_dedup *node);
+
+static void
+dedup_load_read_md_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *node = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("could not read metadata of dedup bdev %s\n", node->dd_bdev.name);
+		dedup_load_fail(node, -EIO);
+		return;
+	}
+
+	node->sync_page += node->sync_num_pages;
+	dedup_load_read_md(node);
+}
+
+static void
+dedup_load_read_md(struct vbdev_dedup *node)
+{
+	int rc;
+
+	if (node->sync_page == node->md_chunks) {
+		dedup_rebuild(node);
+		dedup_load_finish(node);
+		return;
+	}
+
+	node->sync_num_pages = spdk_min(node->md_chunks - node->sync_page, DEDUP_MD_IO_CHUNKS);
+	rc = spdk_bdev_read_blocks(node->base_desc, node->md_ch,
+				   node->md + (uint64_t)node->sync_page * node->chunk_size,
+				   dedup_chunk_to_base_block(node, 1 + node->sync_page),
+				   dedup_chunk_to_base_block(node, node->sync_num_pages),
+				   dedup_load_read_md_done, node);
+	if (rc != 0) {
+		dedup_load_fail(node, rc);
+	}
+}
+
+static void
+dedup_load_sb_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *node = cb_arg;
+	bool format;
+	uint32_t page;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("could not read dedup superblock from bdev %s\n", node->base_bdev->name);
+		dedup_load_fail(node, -EIO);
+		return;
+	}
+
+	format = memcmp(node->sb->magic, DEDUP_SB_MAGIC, sizeof(node->sb->magic)) != 0;
+	rc = format ? dedup_format_layout(node) : dedup_load_layout(node);
+	if (rc == 0) {
+		rc = dedup_alloc_md(node);
+	}
+	if (rc != 0) {
+		dedup_load_fail(node, rc);
+		return;
+	}
+
+	node->sync_page = 0;
+	if (!format) {
+		SPDK_NOTICELOG("loading dedup bdev %s from %s\n", node->dd_bdev.name, node->base_bdev->name);
+		dedup_load_read_md(node);
+		return;
+	}
+
+	SPDK_NOTICELOG("formatting %s for dedup bdev %s\n", node->base_bdev->name, node->dd_bdev.name);
+	memset(node->dirty_pages, 1, node->md_chunks);
+	for (page = 0; page < node->num_physical_chunks; page++) {
+		spdk_bit_array_set(node->free_chunks, page);
+	}
+	node->num_free = node->num_physical_chunks;
+	dedup_md_sync(node);
+}
+
+/* Open and claim the base bdev of a dedup bdev and load or format it. cb_fn is called
+ * once the dedup bdev is registered, unless an error is returned.
+ */
+static int
+vbdev_dedup_register(const struct bdev_names *name, bdev_dedup_create_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_dedup *node;
+	struct spdk_bdev *bdev;
+	int i, rc;
+
+	node = calloc(1, sizeof(struct vbdev_dedup));
+	if (!node) {
+		SPDK_ERRLOG("could not allocate dedup node\n");
+		return -ENOMEM;
+	}
+
+	node->dd_bdev.name = strdup(name->vbdev_name);
+	if (!node->dd_bdev.name) {
+		SPDK_ERRLOG("could not allocate dd_bdev name\n");
+		free(node);
+		return -ENOMEM;
+	}
+	node->dd_bdev.product_name = "dedup";
+	node->opts = name->opts;
+	node->load_cb_fn = cb_fn;
+	node->load_cb_arg = cb_arg;
+	node->state = DEDUP_STATE_LOADING;
+	spdk_spin_init(&node->lock);
+	for (i = 0; i < DEDUP_L2P_LOCKS; i++) {
+		spdk_spin_init(&node->l2p_locks[i]);
+	}
+	for (i = 0; i < DEDUP_INDEX_SHARDS; i++) {
+		spdk_spin_init(&node->shards[i].lock);
+	}
+	TAILQ_INIT(&node->flush_waiters);
+	TAILQ_INIT(&node->alloc_waiters);
+	TAILQ_INIT(&node->sync_waiters);
+
+	/* Both the data chunks and the metadata are written to the base bdev. */
+	rc = spdk_bdev_open_ext(name->bdev_name, true, vbdev_dedup_base_bdev_event_cb,
+				NULL, &node->base_desc);
+	if (rc) {
+		if (rc != -ENODEV) {
+			SPDK_ERRLOG("could not open bdev %s\n", name->bdev_name);
+		}
+		_device_unregister_cb(node);
+		return rc;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(node->base_desc);
+	node->base_bdev = bdev;
+
+	if (spdk_bdev_get_md_size(bdev) != 0) {
+		SPDK_ERRLOG("dedup bdev cannot be created on bdev %s with metadata\n", name->bdev_name);
+		spdk_bdev_close(node->base_desc);
+		_device_unregister_cb(node);
+		return -EINVAL;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(bdev, node->base_desc, &dedup_if);
+	if (rc) {
+		SPDK_ERRLOG("could not claim bdev %s\n", name->bdev_name);
+		spdk_bdev_close(node->base_desc);
+		_device_unregister_cb(node);
+		return rc;
+	}
+
+	/* The superblock is read, and the metadata later synced, on this thread. */
+	node->thread = spdk_get_thread();
+
+	node->md_ch = spdk_bdev_get_io_channel(node->base_desc);
+	node->sb = spdk_zmalloc(bdev->blocklen, spdk_bdev_get_buf_align(bdev), NULL,
+				SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+	if (node->md_ch == NULL || node->sb == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_bdev_read_blocks(node->base_desc, node->md_ch, node->sb, 0, 1,
+				   dedup_load_sb_read_done, node);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+
+err:
+	if (node->md_ch != NULL) {
+		spdk_put_io_channel(node->md_ch);
+	}
+	spdk_bdev_module_release_bdev(bdev);
+	spdk_bdev_close(node->base_desc);
+	_device_unregister_cb(node);
+	return rc;
+}
+
+struct dedup_create_ctx {
+	char			*vbdev_name;
+	bdev_dedup_create_cb	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+dedup_create_done(void *cb_arg, int rc)
+{
+	struct dedup_create_ctx *ctx = cb_arg;
+	struct bdev_names *name;
+
+	if (rc != 0) {
+		/* E.g. a corrupted superblock, examine would only fail the same way again. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, ctx->vbdev_name) == 0) {
+				vbdev_dedup_remove_name(name);
+				break;
+			}
+		}
+	}
+
+	ctx->cb_fn(ctx->cb_arg, rc);
+	free(ctx->vbdev_name);
+	free(ctx);
+}
+
+/* Create the dedup disk from the given bdev and vbdev name. */
+void
+bdev_dedup_create_disk(const char *bdev_name, const char *vbdev_name,
+		       const struct vbdev_dedup_opts *opts, bdev_dedup_create_cb cb_fn, void *cb_arg)
+{
+	struct dedup_create_ctx *ctx;
+	struct bdev_names *name;
+	int rc;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->vbdev_name = strdup(vbdev_name);
+	if (ctx->vbdev_name == NULL) {
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	/* The configuration is kept if the base bdev doesn't exist yet, its metadata is loaded
+	 * when it is examined.
+	 */
+	rc = vbdev_dedup_insert_name(bdev_name, vbdev_name, opts, &name);
+	if (rc) {
+		free(ctx->vbdev_name);
+		free(ctx);
+		cb_fn(cb_arg, rc);
+		return;
+	}
+
+	rc = vbdev_dedup_register(name, dedup_create_done, ctx);
+	if (rc == -ENODEV) {
+		/* Loaded later, when the base bdev is registered. */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		dedup_create_done(ctx, 0);
+	} else if (rc != 0) {
+		dedup_create_done(ctx, rc);
+	}
+}
+
+void
+bdev_dedup_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_names *name;
+	int rc;
+
+	/* Destruct writes the metadata back before cb_fn is called. */
+	rc = spdk_bdev_unregister_by_name(bdev_name, &dedup_if, cb_fn, cb_arg);
+	if (rc == 0) {
+		/* The metadata stays on the base bdev, but it's no longer loaded on examine. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, bdev_name) == 0) {
+				vbdev_dedup_remove_name(name);
+				break;
+			}
+		}
+	} else {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+struct dedup_get_stats_ctx {
+	struct vbdev_dedup_stats	*stats;
+	struct vbdev_dedup		**nodes;
+	uint32_t			num_nodes;
+	uint32_t			cur;
+	bdev_dedup_get_stats_cb		cb_fn;
+	void				*cb_arg;
+};
+
+static void dedup_get_stats_next(struct dedup_get_stats_ctx *ctx);
+
+static void
+dedup_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct dedup_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct dedup_io_channel *dd_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_dedup_stats *stats = &ctx->stats[ctx->cur];
+
+	stats->writes_deduplicated += dd_ch->writes_deduplicated;
+	stats->writes_unique += dd_ch->writes_unique;
+	stats->writes_zero += dd_ch->writes_zero;
+	stats->hash_collisions += dd_ch->hash_collisions;
+	stats->reads_unmapped += dd_ch->reads_unmapped;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+dedup_get_stats_channel_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct dedup_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cur++;
+	dedup_get_stats_next(ctx);
+}
+
+static void
+dedup_get_stats_done(struct dedup_get_stats_ctx *ctx)
+{
+	uint32_t i;
+
+	ctx->cb_fn(ctx->cb_arg, ctx->stats, ctx->num_nodes);
+
+	for (i = 0; i < ctx->num_nodes; i++) {
+		free(ctx->stats[i].name);
+		free(ctx->stats[i].base_bdev_name);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+}
+
+static void
+dedup_get_stats_next(struct dedup_get_stats_ctx *ctx)
+{
+	struct vbdev_dedup_stats *stats;
+	struct vbdev_dedup *node;
+	uint32_t i;
+
+	while (ctx->cur < ctx->num_nodes) {
+		/* Skip dedup bdevs deleted while the channels of the previous one were walked. */
+		TAILQ_FOREACH(node, &g_dedup_nodes, link) {
+			if (node != ctx->nodes[ctx->cur]) {
+				continue;
+			}
+			stats = &ctx->stats[ctx->cur];
+			stats->index_entries = 0;
+			for (i = 0; i < node->num_shards; i++) {
+				spdk_spin_lock(&node->shards[i].lock);
+				stats->index_entries += node->shards[i].entries;
+				spdk_spin_unlock(&node->shards[i].lock);
+			}
+			stats->mapped_chunks = __atomic_load_n(&node->mapped_chunks, __ATOMIC_RELAXED);
+			spdk_spin_lock(&node->lock);
+			stats->used_chunks = node->used_chunks;
+			stats->free_chunks = node->num_free;
+			spdk_spin_unlock(&node->lock);
+			spdk_for_each_channel(node, dedup_get_stats_channel, ctx,
+					      dedup_get_stats_channel_done);
+			return;
+		}
+		ctx->cur++;
+	}
+
+	dedup_get_stats_done(ctx);
+}
+
+int
+bdev_dedup_get_stats(const char *bdev_name, bdev_dedup_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct dedup_get_stats_ctx *ctx;
+	struct vbdev_dedup_stats *stats;
+	struct vbdev_dedup *node;
+	uint32_t num_nodes = 0;
+
+	TAILQ_FOREACH(node, &g_dedup_nodes, link) {
+		if (bdev_name == NULL || strcmp(bdev_name, node->dd_bdev.name) == 0) {
+			num_nodes++;
+		}
+	}
+	if (bdev_name != NULL && num_nodes == 0) {
+		return -ENODEV;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+	ctx->stats = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->stats));
+	ctx->nodes = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->nodes));
+	if (ctx->stats == NULL || ctx->nodes == NULL) {
+		goto err;
+	}
+
+	TAILQ_FOREACH(node, &g_dedup_nodes, link) {
+		if (bdev_name != NULL && strcmp(bdev_name, node->dd_bdev.name) != 0) {
+			continue;
+		}
+		ctx->nodes[ctx->num_nodes] = node;
+		stats = &ctx->stats[ctx->num_nodes++];
+		stats->name = strdup(node->dd_bdev.name);
+		stats->base_bdev_name = strdup(spdk_bdev_get_name(node->base_bdev));
+		stats->chunk_size = node->chunk_size;
+		stats->logical_chunks = node->num_logical_chunks;
+		stats->physical_chunks = node->num_physical_chunks;
+		stats->index_buckets = node->num_buckets;
+		if (stats->name == NULL || stats->base_bdev_name == NULL) {
+			goto err;
+		}
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	dedup_get_stats_next(ctx);
+
+	return 0;
+
+err:
+	while (ctx->num_nodes-- > 0) {
+		free(ctx->stats[ctx->num_nodes].name);
+		free(ctx->stats[ctx->num_nodes].base_bdev_name);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+	return -ENOMEM;
+}
+
+/* Loading a dedup bdev requires I/O, it is done in examine_disk. */
+static void
+vbdev_dedup_examine_config(struct spdk_bdev *bdev)
+{
+	spdk_bdev_module_examine_done(&dedup_if);
+}
+
+struct dedup_examine_ctx {
+	uint32_t	outstanding;
+};
+
+static void
+vbdev_dedup_examine_done(void *cb_arg, int rc)
+{
+	struct dedup_examine_ctx *ctx = cb_arg;
+
+	if (--ctx->outstanding == 0) {
+		spdk_bdev_module_examine_done(&dedup_if);
+		free(ctx);
+	}
+}
+
+/* Because we specified this function in our dedup bdev function table when we
+ * registered our dedup bdev, we'll get this call anytime a new bdev shows up.
+ */
+static void
+vbdev_dedup_examine_disk(struct spdk_bdev *bdev)
+{
+	struct dedup_examine_ctx *ctx;
+	struct bdev_names *name;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	ctx->outstanding = 1;
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(name->bdev_name, bdev->name) != 0) {
+			continue;
+		}
+		ctx->outstanding++;
+		if (vbdev_dedup_register(name, vbdev_dedup_examine_done, ctx) != 0) {
+			ctx->outstanding--;
+		}
+	}
+
+	vbdev_dedup_examine_done(ctx, 0);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_dedup)
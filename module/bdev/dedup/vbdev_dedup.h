@@ -0,0 +1,87 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_DEDUP_H
+#define SPDK_VBDEV_DEDUP_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+struct vbdev_dedup_opts {
+	/* Deduplication granularity and block size of the dedup bdev in bytes, 0 for default */
+	uint32_t	chunk_size;
+
+	/* Size exposed by the dedup bdev in megabytes, 0 for the size of its data region */
+	uint64_t	logical_size_mb;
+};
+
+typedef void (*bdev_dedup_create_cb)(void *cb_arg, int rc);
+
+/**
+ * Create new dedup bdev.
+ *
+ * The metadata of the dedup bdev is loaded from the base bdev, or the base bdev is
+ * formatted if it does not hold any. Options given for a base bdev that was formatted
+ * before are replaced by the ones stored on it.
+ *
+ * \param bdev_name Bdev on which the dedup vbdev will be created.
+ * \param vbdev_name Name of the dedup bdev.
+ * \param opts Options of the dedup bdev, only used when the base bdev is formatted.
+ * \param cb_fn Function to call once the dedup bdev is registered, or creation failed.
+ * If the base bdev does not exist yet, the creation is deferred and cb_fn is called
+ * with 0 right away.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_dedup_create_disk(const char *bdev_name, const char *vbdev_name,
+			    const struct vbdev_dedup_opts *opts, bdev_dedup_create_cb cb_fn,
+			    void *cb_arg);
+
+/**
+ * Delete dedup bdev. Its metadata is written to the base bdev before it goes away.
+ *
+ * \param bdev_name Name of the dedup bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_dedup_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn,
+			    void *cb_arg);
+
+struct vbdev_dedup_stats {
+	char		*name;
+	char		*base_bdev_name;
+	uint32_t	chunk_size;
+	uint64_t	logical_chunks;
+	uint64_t	physical_chunks;
+	/* Logical chunks that were written and not unmapped */
+	uint64_t	mapped_chunks;
+	/* Physical chunks referenced by at least one logical chunk */
+	uint64_t	used_chunks;
+	uint64_t	free_chunks;
+	uint64_t	index_buckets;
+	uint64_t	index_entries;
+	uint64_t	writes_deduplicated;
+	uint64_t	writes_unique;
+	uint64_t	writes_zero;
+	uint64_t	hash_collisions;
+	uint64_t	reads_unmapped;
+};
+
+typedef void (*bdev_dedup_get_stats_cb)(void *cb_arg, const struct vbdev_dedup_stats *stats,
+					uint32_t num_stats);
+
+/**
+ * Collect the statistics of dedup bdevs.
+ *
+ * \param bdev_name Name of the dedup bdev, or NULL for all of them.
+ * \param cb_fn Function to call with the statistics once they are collected from all channels.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 on success, -ENODEV if bdev_name is not a dedup bdev, -ENOMEM if memory
+ * could not be allocated. cb_fn is called only on success.
+ */
+int bdev_dedup_get_stats(const char *bdev_name, bdev_dedup_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_DEDUP_H */
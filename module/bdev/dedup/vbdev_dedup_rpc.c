@@ -0,0 +1,198 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_dedup.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_bdev_dedup_create {
+	char *base_bdev_name;
+	char *name;
+	struct vbdev_dedup_opts opts;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+free_rpc_bdev_dedup_create(struct rpc_bdev_dedup_create *r)
+{
+	free(r->base_bdev_name);
+	free(r->name);
+	free(r);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_dedup_create_decoders[] = {
+	{"base_bdev_name", offsetof(struct rpc_bdev_dedup_create, base_bdev_name), spdk_json_decode_string},
+	{"name", offsetof(struct rpc_bdev_dedup_create, name), spdk_json_decode_string},
+	{"chunk_size", offsetof(struct rpc_bdev_dedup_create, opts.chunk_size), spdk_json_decode_uint32, true},
+	{"logical_size_mb", offsetof(struct rpc_bdev_dedup_create, opts.logical_size_mb), spdk_json_decode_uint64, true},
+};
+
+static void
+rpc_bdev_dedup_create_cb(void *cb_arg, int rc)
+{
+	struct rpc_bdev_dedup_create *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+	} else {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, req->name);
+		spdk_jsonrpc_end_result(req->request, w);
+	}
+
+	free_rpc_bdev_dedup_create(req);
+}
+
+static void
+rpc_bdev_dedup_create(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_create *req;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_bdev_dedup_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_dedup_create_decoders),
+				    req)) {
+		SPDK_DEBUGLOG(vbdev_dedup, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		free_rpc_bdev_dedup_create(req);
+		return;
+	}
+
+	req->request = request;
+	bdev_dedup_create_disk(req->base_bdev_name, req->name, &req->opts, rpc_bdev_dedup_create_cb,
+			       req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_create", rpc_bdev_dedup_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_dedup_delete {
+	char *name;
+};
+
+static void
+free_rpc_bdev_dedup_delete(struct rpc_bdev_dedup_delete *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_dedup_delete_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_dedup_delete, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_dedup_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_dedup_delete(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_delete req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_bdev_dedup_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_dedup_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev_dedup_delete_disk(req.name, rpc_bdev_dedup_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_dedup_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_delete", rpc_bdev_dedup_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_dedup_get_stats {
+	char *name;
+};
+
+static void
+free_rpc_bdev_dedup_get_stats(struct rpc_bdev_dedup_get_stats *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_dedup_get_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_dedup_get_stats, name), spdk_json_decode_string, true},
+};
+
+static void
+rpc_bdev_dedup_get_stats_cb(void *cb_arg, const struct vbdev_dedup_stats *stats,
+			    uint32_t num_stats)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	uint32_t i;
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+	for (i = 0; i < num_stats; i++) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", stats[i].name);
+		spdk_json_write_named_string(w, "base_bdev_name", stats[i].base_bdev_name);
+		spdk_json_write_named_uint32(w, "chunk_size", stats[i].chunk_size);
+		spdk_json_write_named_uint64(w, "logical_chunks", stats[i].logical_chunks);
+		spdk_json_write_named_uint64(w, "physical_chunks", stats[i].physical_chunks);
+		spdk_json_write_named_uint64(w, "mapped_chunks", stats[i].mapped_chunks);
+		spdk_json_write_named_uint64(w, "used_chunks", stats[i].used_chunks);
+		spdk_json_write_named_uint64(w, "free_chunks", stats[i].free_chunks);
+		spdk_json_write_named_double(w, "dedup_ratio", stats[i].used_chunks == 0 ? 1.0 :
+					     (double)stats[i].mapped_chunks / stats[i].used_chunks);
+		spdk_json_write_named_uint64(w, "index_buckets", stats[i].index_buckets);
+		spdk_json_write_named_uint64(w, "index_entries", stats[i].index_entries);
+		spdk_json_write_named_uint64(w, "writes_deduplicated", stats[i].writes_deduplicated);
+		spdk_json_write_named_uint64(w, "writes_unique", stats[i].writes_unique);
+		spdk_json_write_named_uint64(w, "writes_zero", stats[i].writes_zero);
+		spdk_json_write_named_uint64(w, "hash_collisions", stats[i].hash_collisions);
+		spdk_json_write_named_uint64(w, "reads_unmapped", stats[i].reads_unmapped);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_bdev_dedup_get_stats(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_dedup_get_stats req = {NULL};
+	int rc;
+
+	if (params && spdk_json_decode_object(params, rpc_bdev_dedup_get_stats_decoders,
+					      SPDK_COUNTOF(rpc_bdev_dedup_get_stats_decoders),
+					      &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_dedup_get_stats(req.name, rpc_bdev_dedup_get_stats_cb, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+
+cleanup:
+	free_rpc_bdev_dedup_get_stats(&req);
+}
+SPDK_RPC_REGISTER("bdev_dedup_get_stats", rpc_bdev_dedup_get_stats, SPDK_RPC_RUNTIME)
@@ -13,13 +13,41 @@
 #include "spdk/dma.h"
 #include "spdk/likely.h"
 #include "spdk/string.h"
+#include "spdk/util.h"
 
 #include "spdk/log.h"
 
+#define MALLOC_DEFAULT_EXTENT_SIZE	(1024 * 1024)
+
+/* Set in num_users while an unmap releases the extent's buffer */
+#define MALLOC_EXTENT_RELEASING		(1U << 31)
+
+/*
+ * The extents are accessed without a lock. An I/O pins an extent by incrementing num_users
+ * before loading buf, and an unmap only releases buf if it can flag an extent without users.
+ */
+struct malloc_extent {
+	/* NULL until the extent is written for the first time */
+	void				*buf;
+	/* Number of I/Os that are accessing buf */
+	uint32_t			num_users;
+};
+
 struct malloc_disk {
 	struct spdk_bdev		disk;
 	void				*malloc_buf;
 	void				*malloc_md_buf;
+	int32_t				numa_id;
+
+	/* Sparse mode only, the data is kept in extents instead of malloc_buf */
+	struct malloc_extent		*extents;
+	uint64_t			num_extents;
+	uint64_t			num_allocated_extents;
+	uint32_t			extent_size;
+	uint32_t			extent_blocks;
+	/* Source of the data read from extents that were never written */
+	void				*zero_buf;
+
 	TAILQ_ENTRY(malloc_disk)	link;
 };
 
@@ -27,6 +55,7 @@ struct malloc_task {
 	struct iovec			iov;
 	int				num_outstanding;
 	enum spdk_bdev_io_status	status;
+	struct malloc_extent		*extent;
 	TAILQ_ENTRY(malloc_task)	tailq;
 };
 
@@ -96,6 +125,159 @@ malloc_verify_pi(struct spdk_bdev_io *bdev_io)
 	return rc;
 }
 
+static bool
+malloc_extent_get(struct malloc_extent *extent)
+{
+	uint32_t users;
+
+	users = __atomic_fetch_add(&extent->num_users, 1, __ATOMIC_ACQUIRE);
+	if (spdk_unlikely(users & MALLOC_EXTENT_RELEASING)) {
+		__atomic_fetch_sub(&extent->num_users, 1, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+malloc_extent_put(struct malloc_extent *extent)
+{
+	assert((__atomic_load_n(&extent->num_users, __ATOMIC_RELAXED) & ~MALLOC_EXTENT_RELEASING) > 0);
+	__atomic_fetch_sub(&extent->num_users, 1, __ATOMIC_RELEASE);
+}
+
+static void
+malloc_sparse_put_extent(struct malloc_disk *mdisk, struct malloc_task *task)
+{
+	malloc_extent_put(task->extent);
+	task->extent = NULL;
+}
+
+/*
+ * Resolve the part of the sparse disk accessed by bdev_io. The bdev layer splits reads
+ * and writes on extent boundaries, so it always lies within a single extent. Unwritten
+ * extents are allocated if alloc is set, or read from the zero buffer otherwise.
+ */
+static int
+malloc_sparse_get_buf(struct malloc_disk *mdisk, struct malloc_task *task,
+		      struct spdk_bdev_io *bdev_io, bool alloc, void **buf)
+{
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t extent_offset = offset_blocks % mdisk->extent_blocks;
+	struct malloc_extent *extent;
+	void *extent_buf, *new_buf;
+
+	if (spdk_unlikely(extent_offset + bdev_io->u.bdev.num_blocks > mdisk->extent_blocks)) {
+		SPDK_ERRLOG("I/O at block %" PRIu64 " of %" PRIu64 " blocks spans multiple extents\n",
+			    offset_blocks, bdev_io->u.bdev.num_blocks);
+		return -EINVAL;
+	}
+
+	extent = &mdisk->extents[offset_blocks / mdisk->extent_blocks];
+	extent_offset *= mdisk->disk.blocklen;
+
+	while (!malloc_extent_get(extent)) {
+		/* An unmap is releasing the extent, which reads back as zeroes already. Writes
+		 * wait for the release, it is only a couple of atomic operations. */
+		if (!alloc) {
+			*buf = (uint8_t *)mdisk->zero_buf + extent_offset;
+			return 0;
+		}
+	}
+
+	extent_buf = __atomic_load_n(&extent->buf, __ATOMIC_ACQUIRE);
+	if (extent_buf == NULL && alloc) {
+		new_buf = spdk_zmalloc(mdisk->extent_size, 0x1000, NULL, mdisk->numa_id,
+				       SPDK_MALLOC_DMA);
+		if (new_buf == NULL) {
+			malloc_extent_put(extent);
+			return -ENOMEM;
+		}
+
+		/* Another write may have allocated the extent in the meantime */
+		if (__atomic_compare_exchange_n(&extent->buf, &extent_buf, new_buf, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			extent_buf = new_buf;
+			__atomic_fetch_add(&mdisk->num_allocated_extents, 1, __ATOMIC_RELAXED);
+		} else {
+			spdk_free(new_buf);
+		}
+	}
+
+	if (extent_buf != NULL) {
+		task->extent = extent;
+		*buf = (uint8_t *)extent_buf + extent_offset;
+	} else {
+		malloc_extent_put(extent);
+		*buf = (uint8_t *)mdisk->zero_buf + extent_offset;
+	}
+
+	return 0;
+}
+
+static void
+malloc_sparse_unmap(struct malloc_disk *mdisk, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct malloc_extent *extent;
+	uint64_t extent_offset, extent_blocks;
+	uint32_t users;
+	void *buf;
+
+	while (num_blocks > 0) {
+		extent = &mdisk->extents[offset_blocks / mdisk->extent_blocks];
+		extent_offset = offset_blocks % mdisk->extent_blocks;
+		extent_blocks = spdk_min(num_blocks, mdisk->extent_blocks - extent_offset);
+		offset_blocks += extent_blocks;
+		num_blocks -= extent_blocks;
+
+		if (__atomic_load_n(&extent->buf, __ATOMIC_ACQUIRE) == NULL) {
+			continue;
+		}
+
+		/* Extents covered as a whole are released, unless they are still accessed
+		 * by other I/Os. Everything else is zeroed in place. */
+		users = 0;
+		if (extent_offset == 0 &&
+		    (extent_blocks == mdisk->extent_blocks || offset_blocks == mdisk->disk.blockcnt) &&
+		    __atomic_compare_exchange_n(&extent->num_users, &users, MALLOC_EXTENT_RELEASING,
+						false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			buf = __atomic_exchange_n(&extent->buf, NULL, __ATOMIC_ACQ_REL);
+			__atomic_fetch_and(&extent->num_users, ~MALLOC_EXTENT_RELEASING, __ATOMIC_RELEASE);
+			if (buf != NULL) {
+				__atomic_fetch_sub(&mdisk->num_allocated_extents, 1, __ATOMIC_RELAXED);
+				spdk_free(buf);
+			}
+			continue;
+		}
+
+		if (!malloc_extent_get(extent)) {
+			/* Another unmap is releasing the extent */
+			continue;
+		}
+
+		buf = __atomic_load_n(&extent->buf, __ATOMIC_ACQUIRE);
+		if (buf != NULL) {
+			memset((uint8_t *)buf + extent_offset * mdisk->disk.blocklen, 0,
+			       extent_blocks * mdisk->disk.blocklen);
+		}
+		malloc_extent_put(extent);
+	}
+}
+
+static uint64_t
+malloc_sparse_seek(struct malloc_disk *mdisk, uint64_t offset_blocks, bool data)
+{
+	uint64_t i;
+
+	for (i = offset_blocks / mdisk->extent_blocks; i < mdisk->num_extents; i++) {
+		if ((__atomic_load_n(&mdisk->extents[i].buf, __ATOMIC_RELAXED) != NULL) == data) {
+			return spdk_max(offset_blocks, i * mdisk->extent_blocks);
+		}
+	}
+
+	return UINT64_MAX;
+}
+
 static void
 malloc_done(void *ref, int status)
 {
@@ -117,6 +299,10 @@ malloc_done(void *ref, int status)
 		return;
 	}
 
+	if (task->extent != NULL) {
+		malloc_sparse_put_extent(bdev_io->bdev->ctxt, task);
+	}
+
 	if (bdev_io->bdev->dif_type != SPDK_DIF_DISABLE &&
 	    bdev_io->type == SPDK_BDEV_IO_TYPE_READ &&
 	    task->status == SPDK_BDEV_IO_STATUS_SUCCESS) {
@@ -168,9 +354,19 @@ malloc_disk_free(struct malloc_disk *malloc_disk)
 		return;
 	}
 
+	if (malloc_disk->extents != NULL) {
+		uint64_t i;
+
+		for (i = 0; i < malloc_disk->num_extents; i++) {
+			spdk_free(malloc_disk->extents[i].buf);
+		}
+		free(malloc_disk->extents);
+	}
+
 	free(malloc_disk->disk.name);
 	spdk_free(malloc_disk->malloc_buf);
 	spdk_free(malloc_disk->malloc_md_buf);
+	spdk_free(malloc_disk->zero_buf);
 	free(malloc_disk);
 }
 
@@ -200,6 +396,25 @@ bdev_malloc_check_iov_len(struct iovec *iovs, int iovcnt, size_t nbytes)
 	return nbytes != 0;
 }
 
+static int
+malloc_get_buf(struct malloc_disk *mdisk, struct malloc_task *task,
+	       struct spdk_bdev_io *bdev_io, bool alloc, void **buf)
+{
+	if (mdisk->extents != NULL) {
+		return malloc_sparse_get_buf(mdisk, task, bdev_io, alloc, buf);
+	}
+
+	*buf = (uint8_t *)mdisk->malloc_buf + bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen;
+	return 0;
+}
+
+static void
+malloc_get_buf_fail(struct malloc_task *task, int status)
+{
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(task), status == -ENOMEM ?
+			      SPDK_BDEV_IO_STATUS_NOMEM : SPDK_BDEV_IO_STATUS_FAILED);
+}
+
 static void
 malloc_sequence_fail(struct malloc_task *task, int status)
 {
@@ -229,12 +444,11 @@ static void
 bdev_malloc_readv(struct malloc_disk *mdisk, struct spdk_io_channel *ch,
 		  struct malloc_task *task, struct spdk_bdev_io *bdev_io)
 {
-	uint64_t len, offset, md_offset;
+	uint64_t len, md_offset;
 	int res = 0;
 	size_t md_len;
 
 	len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-	offset = bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen;
 
 	if (bdev_malloc_check_iov_len(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, len)) {
 		spdk_bdev_io_complete(spdk_bdev_io_from_ctx(task),
@@ -242,13 +456,19 @@ bdev_malloc_readv(struct malloc_disk *mdisk, struct spdk_io_channel *ch,
 		return;
 	}
 
+	res = malloc_get_buf(mdisk, task, bdev_io, false, &task->iov.iov_base);
+	if (spdk_unlikely(res != 0)) {
+		malloc_get_buf_fail(task, res);
+		return;
+	}
+
 	task->status = SPDK_BDEV_IO_STATUS_SUCCESS;
 	task->num_outstanding = 0;
-	task->iov.iov_base = mdisk->malloc_buf + offset;
 	task->iov.iov_len = len;
 
 	SPDK_DEBUGLOG(bdev_malloc, "read %zu bytes from offset %#" PRIx64 ", iovcnt=%d\n",
-		      len, offset, bdev_io->u.bdev.iovcnt);
+		      len, bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen,
+		      bdev_io->u.bdev.iovcnt);
 
 	task->num_outstanding++;
 	res = spdk_accel_append_copy(&bdev_io->u.bdev.accel_sequence, ch,
@@ -286,12 +506,11 @@ static void
 bdev_malloc_writev(struct malloc_disk *mdisk, struct spdk_io_channel *ch,
 		   struct malloc_task *task, struct spdk_bdev_io *bdev_io)
 {
-	uint64_t len, offset, md_offset;
+	uint64_t len, md_offset;
 	int res = 0;
 	size_t md_len;
 
 	len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
-	offset = bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen;
 
 	if (bdev_malloc_check_iov_len(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, len)) {
 		spdk_bdev_io_complete(spdk_bdev_io_from_ctx(task),
@@ -299,13 +518,19 @@ bdev_malloc_writev(struct malloc_disk *mdisk, struct spdk_io_channel *ch,
 		return;
 	}
 
+	res = malloc_get_buf(mdisk, task, bdev_io, true, &task->iov.iov_base);
+	if (spdk_unlikely(res != 0)) {
+		malloc_get_buf_fail(task, res);
+		return;
+	}
+
 	task->status = SPDK_BDEV_IO_STATUS_SUCCESS;
 	task->num_outstanding = 0;
-	task->iov.iov_base = mdisk->malloc_buf + offset;
 	task->iov.iov_len = len;
 
 	SPDK_DEBUGLOG(bdev_malloc, "wrote %zu bytes to offset %#" PRIx64 ", iovcnt=%d\n",
-		      len, offset, bdev_io->u.bdev.iovcnt);
+		      len, bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen,
+		      bdev_io->u.bdev.iovcnt);
 
 	task->num_outstanding++;
 	res = spdk_accel_append_copy(&bdev_io->u.bdev.accel_sequence, ch, &task->iov, 1, NULL, NULL,
@@ -372,6 +597,21 @@ bdev_malloc_copy(struct malloc_disk *mdisk, struct spdk_io_channel *ch,
 	}
 }
 
+static void
+malloc_sparse_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
+			      bool success)
+{
+	struct malloc_channel *mch = spdk_io_channel_get_ctx(ch);
+	struct malloc_task *task = (struct malloc_task *)bdev_io->driver_ctx;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	bdev_malloc_readv(bdev_io->bdev->ctxt, mch->accel_channel, task, bdev_io);
+}
+
 static int
 _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bdev_io)
 {
@@ -380,9 +620,18 @@ _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bde
 	uint32_t block_size = bdev_io->bdev->blocklen;
 	int rc;
 
+	task->extent = NULL;
+
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 		if (bdev_io->u.bdev.iovs[0].iov_base == NULL) {
+			if (disk->extents != NULL) {
+				/* Extents can be released by unmap, so don't hand them out */
+				spdk_bdev_io_get_buf(bdev_io, malloc_sparse_read_get_buf_cb,
+						     bdev_io->u.bdev.num_blocks * block_size);
+				return 0;
+			}
+
 			assert(bdev_io->u.bdev.iovcnt == 1);
 			assert(bdev_io->u.bdev.memory_domain == NULL);
 			bdev_io->u.bdev.iovs[0].iov_base =
@@ -416,11 +665,14 @@ _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bde
 		return 0;
 
 	case SPDK_BDEV_IO_TYPE_UNMAP:
-		return bdev_malloc_unmap(disk, mch->accel_channel, task,
-					 bdev_io->u.bdev.offset_blocks * block_size,
-					 bdev_io->u.bdev.num_blocks * block_size);
-
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		if (disk->extents != NULL) {
+			/* Released extents read back as zeroes, so both are handled the same way */
+			malloc_sparse_unmap(disk, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+			malloc_complete_task(task, mch, SPDK_BDEV_IO_STATUS_SUCCESS);
+			return 0;
+		}
+
 		/* bdev_malloc_unmap is implemented with a call to mem_cpy_fill which zeroes out all of the requested bytes. */
 		return bdev_malloc_unmap(disk, mch->accel_channel, task,
 					 bdev_io->u.bdev.offset_blocks * block_size,
@@ -448,6 +700,13 @@ _bdev_malloc_submit_request(struct malloc_channel *mch, struct spdk_bdev_io *bde
 				 bdev_io->u.bdev.num_blocks * block_size);
 		return 0;
 
+	case SPDK_BDEV_IO_TYPE_SEEK_DATA:
+	case SPDK_BDEV_IO_TYPE_SEEK_HOLE:
+		bdev_io->u.bdev.seek.offset = malloc_sparse_seek(disk, bdev_io->u.bdev.offset_blocks,
+					      bdev_io->type == SPDK_BDEV_IO_TYPE_SEEK_DATA);
+		malloc_complete_task(task, mch, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return 0;
+
 	default:
 		return -1;
 	}
@@ -468,6 +727,8 @@ bdev_malloc_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev
 static bool
 bdev_malloc_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
+	struct malloc_disk *malloc_disk = ctx;
+
 	switch (io_type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -475,11 +736,19 @@ bdev_malloc_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_RESET:
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
-	case SPDK_BDEV_IO_TYPE_ZCOPY:
 	case SPDK_BDEV_IO_TYPE_ABORT:
-	case SPDK_BDEV_IO_TYPE_COPY:
 		return true;
 
+	/* Sparse disks have no flat buffer to expose or copy within, the bdev layer
+	 * emulates copy with reads and writes. */
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+	case SPDK_BDEV_IO_TYPE_COPY:
+		return malloc_disk->extents == NULL;
+
+	case SPDK_BDEV_IO_TYPE_SEEK_DATA:
+	case SPDK_BDEV_IO_TYPE_SEEK_HOLE:
+		return malloc_disk->extents != NULL;
+
 	default:
 		return false;
 	}
@@ -491,9 +760,29 @@ bdev_malloc_get_io_channel(void *ctx)
 	return spdk_get_io_channel(&g_malloc_disks);
 }
 
+static int
+bdev_malloc_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct malloc_disk *malloc_disk = ctx;
+
+	spdk_json_write_named_object_begin(w, "malloc");
+	spdk_json_write_named_int32(w, "numa_id", malloc_disk->numa_id);
+	spdk_json_write_named_bool(w, "sparse", malloc_disk->extents != NULL);
+	if (malloc_disk->extents != NULL) {
+		spdk_json_write_named_uint32(w, "extent_size", malloc_disk->extent_size);
+		spdk_json_write_named_uint64(w, "num_extents", malloc_disk->num_extents);
+		spdk_json_write_named_uint64(w, "allocated_extents",
+					     __atomic_load_n(&malloc_disk->num_allocated_extents, __ATOMIC_RELAXED));
+	}
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
 static void
 bdev_malloc_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
+	struct malloc_disk *malloc_disk = bdev->ctxt;
 	char uuid_str[SPDK_UUID_STRING_LEN];
 
 	spdk_json_write_object_begin(w);
@@ -508,6 +797,13 @@ bdev_malloc_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx
 	spdk_uuid_fmt_lower(uuid_str, sizeof(uuid_str), &bdev->uuid);
 	spdk_json_write_named_string(w, "uuid", uuid_str);
 	spdk_json_write_named_uint32(w, "optimal_io_boundary", bdev->optimal_io_boundary);
+	if (malloc_disk->numa_id != SPDK_ENV_SOCKET_ID_ANY) {
+		spdk_json_write_named_int32(w, "numa_id", malloc_disk->numa_id);
+	}
+	if (malloc_disk->extents != NULL) {
+		spdk_json_write_named_bool(w, "sparse", true);
+		spdk_json_write_named_uint32(w, "extent_size", malloc_disk->extent_size);
+	}
 
 	spdk_json_write_object_end(w);
 
@@ -560,11 +856,36 @@ static const struct spdk_bdev_fn_table malloc_fn_table = {
 	.submit_request			= bdev_malloc_submit_request,
 	.io_type_supported		= bdev_malloc_io_type_supported,
 	.get_io_channel			= bdev_malloc_get_io_channel,
+	.dump_info_json			= bdev_malloc_dump_info_json,
 	.write_config_json		= bdev_malloc_write_json_config,
 	.get_memory_domains		= bdev_malloc_get_memory_domains,
 	.accel_sequence_supported	= bdev_malloc_accel_sequence_supported,
 };
 
+static int
+malloc_disk_setup_sparse(struct malloc_disk *mdisk, const struct malloc_bdev_opts *opts,
+			 uint32_t block_size)
+{
+	mdisk->extent_size = opts->extent_size != 0 ? opts->extent_size : MALLOC_DEFAULT_EXTENT_SIZE;
+	mdisk->extent_blocks = mdisk->extent_size / block_size;
+	mdisk->num_extents = spdk_divide_round_up(opts->num_blocks, mdisk->extent_blocks);
+
+	mdisk->extents = calloc(mdisk->num_extents, sizeof(*mdisk->extents));
+	if (!mdisk->extents) {
+		SPDK_ERRLOG("extents calloc() failed\n");
+		return -ENOMEM;
+	}
+
+	mdisk->zero_buf = spdk_zmalloc(mdisk->extent_size, 0x1000, NULL, mdisk->numa_id,
+				       SPDK_MALLOC_DMA);
+	if (!mdisk->zero_buf) {
+		SPDK_ERRLOG("zero_buf spdk_zmalloc() failed\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int
 malloc_disk_setup_pi(struct malloc_disk *mdisk)
 {
@@ -662,29 +983,60 @@ create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->sparse) {
+		uint32_t extent_size = opts->extent_size != 0 ? opts->extent_size :
+				       MALLOC_DEFAULT_EXTENT_SIZE;
+
+		if (opts->md_size != 0) {
+			SPDK_ERRLOG("Metadata is not supported by sparse disks\n");
+			return -EINVAL;
+		}
+
+		if (extent_size < block_size || extent_size % block_size) {
+			SPDK_ERRLOG("Extent size %u must be a multiple of the block size %u\n",
+				    extent_size, block_size);
+			return -EINVAL;
+		}
+
+		if (opts->optimal_io_boundary && (extent_size / block_size) % opts->optimal_io_boundary) {
+			SPDK_ERRLOG("Extent size %u must be a multiple of the optimal I/O boundary\n",
+				    extent_size);
+			return -EINVAL;
+		}
+	} else if (opts->extent_size != 0) {
+		SPDK_ERRLOG("Extent size can only be set for sparse disks\n");
+		return -EINVAL;
+	}
+
 	mdisk = calloc(1, sizeof(*mdisk));
 	if (!mdisk) {
 		SPDK_ERRLOG("mdisk calloc() failed\n");
 		return -ENOMEM;
 	}
 
-	/*
-	 * Allocate the large backend memory buffer from pinned memory.
-	 *
-	 * TODO: need to pass a hint so we know which socket to allocate
-	 *  from on multi-socket systems.
-	 */
-	mdisk->malloc_buf = spdk_zmalloc(opts->num_blocks * block_size, 2 * 1024 * 1024, NULL,
-					 SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
-	if (!mdisk->malloc_buf) {
-		SPDK_ERRLOG("malloc_buf spdk_zmalloc() failed\n");
-		malloc_disk_free(mdisk);
-		return -ENOMEM;
+	mdisk->numa_id = opts->numa_id;
+
+	if (opts->sparse) {
+		/* Extents are allocated from pinned memory on first write */
+		rc = malloc_disk_setup_sparse(mdisk, opts, block_size);
+		if (rc) {
+			malloc_disk_free(mdisk);
+			return rc;
+		}
+	} else {
+		/* Allocate the large backend memory buffer from pinned memory */
+		mdisk->malloc_buf = spdk_zmalloc(opts->num_blocks * block_size, 2 * 1024 * 1024, NULL,
+						 opts->numa_id, SPDK_MALLOC_DMA);
+		if (!mdisk->malloc_buf) {
+			SPDK_ERRLOG("malloc_buf spdk_zmalloc() failed\n");
+			malloc_disk_free(mdisk);
+			return -ENOMEM;
+		}
 	}
 
 	if (!opts->md_interleave && opts->md_size != 0) {
 		mdisk->malloc_md_buf = spdk_zmalloc(opts->num_blocks * opts->md_size, 2 * 1024 * 1024, NULL,
-						    SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
+						    opts->numa_id, SPDK_MALLOC_DMA);
 		if (!mdisk->malloc_md_buf) {
 			SPDK_ERRLOG("malloc_md_buf spdk_zmalloc() failed\n");
 			malloc_disk_free(mdisk);
@@ -742,6 +1094,10 @@ create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts)
 	if (opts->optimal_io_boundary) {
 		mdisk->disk.optimal_io_boundary = opts->optimal_io_boundary;
 		mdisk->disk.split_on_optimal_io_boundary = true;
+	} else if (mdisk->extents != NULL) {
+		/* Make sure reads and writes never span multiple extents */
+		mdisk->disk.optimal_io_boundary = mdisk->extent_blocks;
+		mdisk->disk.split_on_optimal_io_boundary = true;
 	}
 	if (!spdk_uuid_is_null(&opts->uuid)) {
 		spdk_uuid_copy(&mdisk->disk.uuid, &opts->uuid);
@@ -24,6 +24,12 @@ struct malloc_bdev_opts {
 	bool md_interleave;
 	enum spdk_dif_type dif_type;
 	bool dif_is_head_of_md;
+	/* NUMA node to allocate the memory from, or SPDK_ENV_SOCKET_ID_ANY */
+	int32_t numa_id;
+	/* Allocate the memory in extents on first write instead of up front */
+	bool sparse;
+	/* Size of the extents of a sparse disk in bytes, 0 for the default of 1 MiB */
+	uint32_t extent_size;
 };
 
 int create_malloc_disk(struct spdk_bdev **bdev, const struct malloc_bdev_opts *opts);
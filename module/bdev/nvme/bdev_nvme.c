@@ -36,7 +36,31 @@
 
 #define NSID_STR_LEN 10
 
+/* Weight of a new latency sample in the service-time selector is 1 / 2^NVME_IO_PATH_EWMA_SHIFT. */
+#define NVME_IO_PATH_EWMA_SHIFT			3
+/* Paths not selected by the service-time selector for this long get an I/O to refresh their latency. */
+#define NVME_IO_PATH_PROBE_INTERVAL_MS		100
+
+/* Period of the poller which issues hedged reads. */
+#define NVME_HEDGE_POLL_PERIOD_US		50
+/* Hedging thresholds are recalculated this often from the read latencies of each I/O path. */
+#define NVME_HEDGE_UPDATE_INTERVAL_MS		100
+/* Minimum number of read latencies needed to calculate a hedging threshold. */
+#define NVME_HEDGE_MIN_SAMPLES			1000
+/* Read latency histograms of I/O paths have 2^5 buckets per power of two. */
+#define NVME_HEDGE_HISTOGRAM_SHIFT		5
+/* Reads larger than this are not hedged. */
+#define NVME_HEDGE_MAX_IO_SIZE			(128 * 1024)
+/* Number of reads per poll group which may be hedged at the same time. */
+#define NVME_HEDGE_POOL_SIZE			256
+/* Every hedgeable read earns its budget percent in tokens, a hedged read costs a full read. */
+#define NVME_HEDGE_TOKEN_COST			100
+#define NVME_HEDGE_MAX_TOKENS			(NVME_HEDGE_TOKEN_COST * 8)
+#define NVME_HEDGE_DEFAULT_BUDGET_PERCENT	5
+#define NVME_IOBUF_NAME				"bdev_nvme"
+
 static int bdev_nvme_config_json(struct spdk_json_write_ctx *w);
+static int bdev_nvme_hedge_poll(void *arg);
 
 struct nvme_bdev_io {
 	/** array of iovecs to transfer. */
@@ -94,6 +118,40 @@ struct nvme_bdev_io {
 
 	/* Current tsc at submit time. */
 	uint64_t submit_tsc;
+
+	/** I/O path whose hedge candidates the current read is linked to. */
+	struct nvme_io_path *hedge_io_path;
+
+	TAILQ_ENTRY(nvme_bdev_io) hedge_link;
+
+	/** Bounce buffers of the current read if it may be hedged. */
+	struct nvme_bdev_hedge *hedge;
+};
+
+struct nvme_bdev_hedge;
+
+struct nvme_bdev_hedge_read {
+	struct nvme_bdev_hedge		*hedge;
+	struct spdk_nvme_ctrlr		*ctrlr;
+	struct spdk_nvme_qpair		*qpair;
+	void				*buf;
+	bool				outstanding;
+};
+
+/* A read which may be hedged and its duplicate both read into bounce buffers. Whichever
+ * completes first completes the bdev_io, the other one only returns its buffer when it is done.
+ */
+struct nvme_bdev_hedge {
+	/* Read the copies are made for, or NULL once it was completed. */
+	struct nvme_bdev_io		*bio;
+	/* Poll group whose iobuf channel the bounce buffers come from. */
+	struct nvme_poll_group		*group;
+	uint64_t			lba;
+	uint64_t			lba_count;
+	uint64_t			len;
+	/* The original read and its duplicate. */
+	struct nvme_bdev_hedge_read	reads[2];
+	STAILQ_ENTRY(nvme_bdev_hedge)	stailq;
 };
 
 struct nvme_probe_skip_entry {
@@ -137,6 +195,8 @@ static int g_hot_insert_nvme_controller_index = 0;
 static uint64_t g_nvme_hotplug_poll_period_us = NVME_HOTPLUG_POLL_PERIOD_DEFAULT;
 static bool g_nvme_hotplug_enabled = false;
 struct spdk_thread *g_bdev_nvme_init_thread;
+/* Largest read which is hedged, bounded by the size of the iobuf bounce buffers. */
+static uint64_t g_nvme_hedge_max_io_size = NVME_HEDGE_MAX_IO_SIZE;
 static struct spdk_poller *g_hotplug_poller;
 static struct spdk_poller *g_hotplug_probe_poller;
 static struct spdk_nvme_probe_ctx *g_hotplug_probe_ctx;
@@ -617,12 +677,17 @@ nvme_io_path_alloc(void)
 		spdk_bdev_reset_io_stat(io_path->stat, SPDK_BDEV_RESET_STAT_MAXMIN);
 	}
 
+	TAILQ_INIT(&io_path->hedge_candidates);
+
 	return io_path;
 }
 
 static void
 nvme_io_path_free(struct nvme_io_path *io_path)
 {
+	if (io_path->read_latency != NULL) {
+		spdk_histogram_data_free(io_path->read_latency);
+	}
 	free(io_path->stat);
 	free(io_path);
 }
@@ -642,6 +707,15 @@ _bdev_nvme_add_io_path(struct nvme_bdev_channel *nbdev_ch, struct nvme_ns *nvme_
 
 	io_path->nvme_ns = nvme_ns;
 
+	if (nbdev_ch->hedge_percentile != 0) {
+		io_path->read_latency = spdk_histogram_data_alloc_sized(NVME_HEDGE_HISTOGRAM_SHIFT);
+		if (io_path->read_latency == NULL) {
+			nvme_io_path_free(io_path);
+			SPDK_ERRLOG("Failed to alloc read latency histogram.\n");
+			return -ENOMEM;
+		}
+	}
+
 	ch = spdk_get_io_channel(nvme_ns->ctrlr);
 	if (ch == NULL) {
 		nvme_io_path_free(io_path);
@@ -680,6 +754,17 @@ bdev_nvme_clear_retry_io_path(struct nvme_bdev_channel *nbdev_ch,
 	}
 }
 
+static void
+bdev_nvme_clear_hedge_candidates(struct nvme_io_path *io_path)
+{
+	struct nvme_bdev_io *bio;
+
+	while ((bio = TAILQ_FIRST(&io_path->hedge_candidates)) != NULL) {
+		TAILQ_REMOVE(&io_path->hedge_candidates, bio, hedge_link);
+		bio->hedge_io_path = NULL;
+	}
+}
+
 static void
 _bdev_nvme_delete_io_path(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_path *io_path)
 {
@@ -699,6 +784,7 @@ _bdev_nvme_delete_io_path(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_pat
 
 	bdev_nvme_clear_current_io_path(nbdev_ch);
 	bdev_nvme_clear_retry_io_path(nbdev_ch, io_path);
+	bdev_nvme_clear_hedge_candidates(io_path);
 
 	STAILQ_REMOVE(&nbdev_ch->io_path_list, io_path, nvme_io_path, stailq);
 	io_path->nbdev_ch = NULL;
@@ -745,6 +831,9 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	nbdev_ch->mp_policy = nbdev->mp_policy;
 	nbdev_ch->mp_selector = nbdev->mp_selector;
 	nbdev_ch->rr_min_io = nbdev->rr_min_io;
+	nbdev_ch->probe_interval_ticks = NVME_IO_PATH_PROBE_INTERVAL_MS * spdk_get_ticks_hz() / 1000;
+	nbdev_ch->hedge_percentile = nbdev->hedge_percentile;
+	nbdev_ch->hedge_budget_percent = nbdev->hedge_budget_percent;
 
 	TAILQ_FOREACH(nvme_ns, &nbdev->nvme_ns_list, tailq) {
 		rc = _bdev_nvme_add_io_path(nbdev_ch, nvme_ns);
@@ -757,6 +846,12 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	}
 	pthread_mutex_unlock(&nbdev->mutex);
 
+	if (nbdev_ch->hedge_percentile != 0) {
+		nbdev_ch->hedge_update_tsc = spdk_get_ticks();
+		nbdev_ch->hedge_poller = SPDK_POLLER_REGISTER(bdev_nvme_hedge_poll, nbdev_ch,
+					 NVME_HEDGE_POLL_PERIOD_US);
+	}
+
 	return 0;
 }
 
@@ -783,6 +878,7 @@ bdev_nvme_destroy_bdev_channel_cb(void *io_device, void *ctx_buf)
 {
 	struct nvme_bdev_channel *nbdev_ch = ctx_buf;
 
+	spdk_poller_unregister(&nbdev_ch->hedge_poller);
 	bdev_nvme_abort_retry_ios(nbdev_ch);
 	_bdev_nvme_delete_io_paths(nbdev_ch);
 }
@@ -1012,6 +1108,74 @@ _bdev_nvme_find_io_path_min_qd(struct nvme_bdev_channel *nbdev_ch)
 	return non_optimized;
 }
 
+/* Select the path with the lowest expected service time, i.e. the moving average of its
+ * latency scaled by the number of I/Os that are already queued on it. A path that is slow
+ * but not failed is avoided until its latency gets better. As its latency is only sampled
+ * when it is used, a path that was not selected for a while is probed by the next I/O.
+ * Non-optimized paths are used only if there is no optimized one.
+ */
+static struct nvme_io_path *
+_bdev_nvme_find_io_path_service_time(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_io_path *io_path;
+	struct nvme_io_path *optimized = NULL, *non_optimized = NULL;
+	struct nvme_io_path *opt_probe = NULL, *non_opt_probe = NULL;
+	uint64_t opt_min_st = UINT64_MAX, non_opt_min_st = UINT64_MAX;
+	uint64_t service_time, now = spdk_get_ticks();
+	bool probe;
+
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		if (spdk_unlikely(!nvme_qpair_is_connected(io_path->qpair))) {
+			/* The device is currently resetting. */
+			continue;
+		}
+
+		if (spdk_unlikely(io_path->nvme_ns->ana_state_updating)) {
+			continue;
+		}
+
+		service_time = io_path->ewma_latency_ticks *
+			       (spdk_nvme_qpair_get_num_outstanding_reqs(io_path->qpair->qpair) + 1);
+		probe = now - io_path->last_select_tsc > nbdev_ch->probe_interval_ticks;
+
+		switch (io_path->nvme_ns->ana_state) {
+		case SPDK_NVME_ANA_OPTIMIZED_STATE:
+			if (probe && opt_probe == NULL) {
+				opt_probe = io_path;
+			}
+			if (service_time < opt_min_st) {
+				opt_min_st = service_time;
+				optimized = io_path;
+			}
+			break;
+		case SPDK_NVME_ANA_NON_OPTIMIZED_STATE:
+			if (probe && non_opt_probe == NULL) {
+				non_opt_probe = io_path;
+			}
+			if (service_time < non_opt_min_st) {
+				non_opt_min_st = service_time;
+				non_optimized = io_path;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* don't cache io path for BDEV_NVME_MP_SELECTOR_SERVICE_TIME selector */
+	if (optimized != NULL) {
+		io_path = opt_probe != NULL ? opt_probe : optimized;
+	} else if (non_optimized != NULL) {
+		io_path = non_opt_probe != NULL ? non_opt_probe : non_optimized;
+	} else {
+		return NULL;
+	}
+
+	io_path->last_select_tsc = now;
+
+	return io_path;
+}
+
 static inline struct nvme_io_path *
 bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 {
@@ -1029,11 +1193,20 @@ bdev_nvme_find_io_path(struct nvme_bdev_channel *nbdev_ch)
 	if (nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ACTIVE_PASSIVE ||
 	    nbdev_ch->mp_selector == BDEV_NVME_MP_SELECTOR_ROUND_ROBIN) {
 		return _bdev_nvme_find_io_path(nbdev_ch);
-	} else {
+	} else if (nbdev_ch->mp_selector == BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH) {
 		return _bdev_nvme_find_io_path_min_qd(nbdev_ch);
+	} else {
+		return _bdev_nvme_find_io_path_service_time(nbdev_ch);
 	}
 }
 
+static inline bool
+bdev_nvme_channel_tracks_latency(struct nvme_bdev_channel *nbdev_ch)
+{
+	return nbdev_ch->mp_policy == BDEV_NVME_MP_POLICY_ACTIVE_ACTIVE &&
+	       nbdev_ch->mp_selector == BDEV_NVME_MP_SELECTOR_SERVICE_TIME;
+}
+
 /* Return true if there is any io_path whose qpair is active or ctrlr is not failed,
  * or false otherwise.
  *
@@ -1300,6 +1473,27 @@ bdev_nvme_update_io_path_stat(struct nvme_bdev_io *bio)
 	}
 }
 
+static inline void
+bdev_nvme_update_io_path_latency(struct nvme_bdev_io *bio)
+{
+	struct nvme_io_path *io_path = bio->io_path;
+	uint64_t tsc_diff;
+
+	if (io_path->nbdev_ch == NULL || !bdev_nvme_channel_tracks_latency(io_path->nbdev_ch)) {
+		return;
+	}
+
+	tsc_diff = spdk_get_ticks() - bio->submit_tsc;
+
+	if (spdk_unlikely(io_path->ewma_latency_ticks == 0)) {
+		io_path->ewma_latency_ticks = tsc_diff;
+	} else {
+		io_path->ewma_latency_ticks = io_path->ewma_latency_ticks -
+					      (io_path->ewma_latency_ticks >> NVME_IO_PATH_EWMA_SHIFT) +
+					      (tsc_diff >> NVME_IO_PATH_EWMA_SHIFT);
+	}
+}
+
 static bool
 bdev_nvme_check_retry_io(struct nvme_bdev_io *bio,
 			 const struct spdk_nvme_cpl *cpl,
@@ -1352,6 +1546,7 @@ bdev_nvme_io_complete_nvme_status(struct nvme_bdev_io *bio,
 
 	if (spdk_likely(spdk_nvme_cpl_is_success(cpl))) {
 		bdev_nvme_update_io_path_stat(bio);
+		bdev_nvme_update_io_path_latency(bio);
 		goto complete;
 	}
 
@@ -1619,6 +1814,33 @@ bdev_nvme_poll(void *arg)
 	return num_completions > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+static int
+bdev_nvme_poll_group_interrupt(void *arg)
+{
+	struct nvme_poll_group *group = arg;
+	int64_t num_completions;
+
+	num_completions = spdk_nvme_poll_group_wait(group->group, bdev_nvme_disconnected_qpair_cb);
+
+	if (spdk_unlikely(num_completions < 0)) {
+		bdev_nvme_check_io_qpairs(group);
+	}
+
+	return num_completions > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+bdev_nvme_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg, bool interrupt_mode)
+{
+	struct nvme_poll_group *group = cb_arg;
+
+	/* The poller stops once the thread is in interrupt mode, so pick up anything it left
+	 * behind that won't signal the poll group's fd again. */
+	if (interrupt_mode) {
+		bdev_nvme_poll_group_interrupt(group);
+	}
+}
+
 static int bdev_nvme_poll_adminq(void *arg);
 
 static void
@@ -3299,21 +3521,67 @@ static int
 bdev_nvme_create_poll_group_cb(void *io_device, void *ctx_buf)
 {
 	struct nvme_poll_group *group = ctx_buf;
+	struct spdk_fd_group *fgrp;
+	uint32_t i;
 
 	TAILQ_INIT(&group->qpair_list);
 
+	group->hedges = calloc(NVME_HEDGE_POOL_SIZE, sizeof(*group->hedges));
+	if (group->hedges == NULL) {
+		SPDK_ERRLOG("Failed to allocate read hedging contexts for the NVMe poll group\n");
+		return -1;
+	}
+
+	STAILQ_INIT(&group->free_hedges);
+	for (i = 0; i < NVME_HEDGE_POOL_SIZE; i++) {
+		STAILQ_INSERT_TAIL(&group->free_hedges, &group->hedges[i], stailq);
+	}
+
+	if (spdk_iobuf_channel_init(&group->iobuf, NVME_IOBUF_NAME, 0, 0) != 0) {
+		SPDK_ERRLOG("Failed to create an iobuf channel for the NVMe poll group\n");
+		free(group->hedges);
+		return -1;
+	}
+
 	group->group = spdk_nvme_poll_group_create(group, &g_bdev_nvme_accel_fn_table);
 	if (group->group == NULL) {
+		spdk_iobuf_channel_fini(&group->iobuf);
+		free(group->hedges);
 		return -1;
 	}
 
+	if (spdk_interrupt_mode_is_enabled()) {
+		fgrp = spdk_nvme_poll_group_get_fd_group(group->group);
+		if (fgrp == NULL) {
+			SPDK_ERRLOG("Failed to get fd group of the NVMe poll group\n");
+			spdk_nvme_poll_group_destroy(group->group);
+			spdk_iobuf_channel_fini(&group->iobuf);
+			free(group->hedges);
+			return -1;
+		}
+
+		group->intr = SPDK_INTERRUPT_REGISTER(spdk_fd_group_get_fd(fgrp),
+						      bdev_nvme_poll_group_interrupt, group);
+		if (group->intr == NULL) {
+			spdk_nvme_poll_group_destroy(group->group);
+			spdk_iobuf_channel_fini(&group->iobuf);
+			free(group->hedges);
+			return -1;
+		}
+	}
+
 	group->poller = SPDK_POLLER_REGISTER(bdev_nvme_poll, group, g_opts.nvme_ioq_poll_period_us);
 
 	if (group->poller == NULL) {
+		spdk_interrupt_unregister(&group->intr);
 		spdk_nvme_poll_group_destroy(group->group);
+		spdk_iobuf_channel_fini(&group->iobuf);
+		free(group->hedges);
 		return -1;
 	}
 
+	spdk_poller_register_interrupt(group->poller, bdev_nvme_poller_set_interrupt_mode, group);
+
 	return 0;
 }
 
@@ -3329,10 +3597,13 @@ bdev_nvme_destroy_poll_group_cb(void *io_device, void *ctx_buf)
 	}
 
 	spdk_poller_unregister(&group->poller);
+	spdk_interrupt_unregister(&group->intr);
 	if (spdk_nvme_poll_group_destroy(group->group)) {
 		SPDK_ERRLOG("Unable to destroy a poll group for the NVMe bdev module.\n");
 		assert(false);
 	}
+	spdk_iobuf_channel_fini(&group->iobuf);
+	free(group->hedges);
 }
 
 static struct spdk_io_channel *
@@ -4879,12 +5150,19 @@ _bdev_nvme_set_multipath_policy(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
 	struct nvme_bdev_channel *nbdev_ch = spdk_io_channel_get_ctx(_ch);
 	struct nvme_bdev *nbdev = spdk_io_channel_get_io_device(_ch);
+	struct nvme_io_path *io_path;
 
 	nbdev_ch->mp_policy = nbdev->mp_policy;
 	nbdev_ch->mp_selector = nbdev->mp_selector;
 	nbdev_ch->rr_min_io = nbdev->rr_min_io;
 	bdev_nvme_clear_current_io_path(nbdev_ch);
 
+	/* Latencies are not sampled by the other selectors, start over. */
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		io_path->ewma_latency_ticks = 0;
+		io_path->last_select_tsc = 0;
+	}
+
 	spdk_for_each_channel_continue(i, 0);
 }
 
@@ -4957,6 +5235,152 @@ exit:
 	cb_fn(cb_arg, rc);
 }
 
+struct bdev_nvme_set_read_hedging_ctx {
+	struct spdk_bdev_desc *desc;
+	bdev_nvme_set_read_hedging_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+bdev_nvme_set_read_hedging_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct bdev_nvme_set_read_hedging_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	assert(ctx != NULL);
+	assert(ctx->desc != NULL);
+	assert(ctx->cb_fn != NULL);
+
+	spdk_bdev_close(ctx->desc);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+
+	free(ctx);
+}
+
+static int
+bdev_nvme_channel_init_read_hedging(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_io_path *io_path;
+
+	/* Latencies learnt for another percentile are of no use, start over. */
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		bdev_nvme_clear_hedge_candidates(io_path);
+		io_path->hedge_threshold_ticks = 0;
+
+		if (nbdev_ch->hedge_percentile == 0) {
+			if (io_path->read_latency != NULL) {
+				spdk_histogram_data_free(io_path->read_latency);
+				io_path->read_latency = NULL;
+			}
+		} else if (io_path->read_latency != NULL) {
+			spdk_histogram_data_reset(io_path->read_latency);
+		} else {
+			io_path->read_latency = spdk_histogram_data_alloc_sized(NVME_HEDGE_HISTOGRAM_SHIFT);
+			if (io_path->read_latency == NULL) {
+				SPDK_ERRLOG("Failed to alloc read latency histogram.\n");
+				return -ENOMEM;
+			}
+		}
+	}
+
+	nbdev_ch->hedge_tokens = 0;
+
+	if (nbdev_ch->hedge_percentile == 0) {
+		spdk_poller_unregister(&nbdev_ch->hedge_poller);
+	} else if (nbdev_ch->hedge_poller == NULL) {
+		nbdev_ch->hedge_update_tsc = spdk_get_ticks();
+		nbdev_ch->hedge_poller = SPDK_POLLER_REGISTER(bdev_nvme_hedge_poll, nbdev_ch,
+					 NVME_HEDGE_POLL_PERIOD_US);
+	}
+
+	return 0;
+}
+
+static void
+_bdev_nvme_set_read_hedging(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct nvme_bdev_channel *nbdev_ch = spdk_io_channel_get_ctx(_ch);
+	struct nvme_bdev *nbdev = spdk_io_channel_get_io_device(_ch);
+	int rc;
+
+	nbdev_ch->hedge_percentile = nbdev->hedge_percentile;
+	nbdev_ch->hedge_budget_percent = nbdev->hedge_budget_percent;
+
+	rc = bdev_nvme_channel_init_read_hedging(nbdev_ch);
+	if (rc != 0) {
+		/* Leave hedging disabled on this channel. */
+		nbdev_ch->hedge_percentile = 0;
+		bdev_nvme_channel_init_read_hedging(nbdev_ch);
+	}
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+void
+bdev_nvme_set_read_hedging(const char *name, double percentile, uint32_t budget_percent,
+			   bdev_nvme_set_read_hedging_cb cb_fn, void *cb_arg)
+{
+	struct bdev_nvme_set_read_hedging_ctx *ctx;
+	struct spdk_bdev *bdev;
+	struct nvme_bdev *nbdev;
+	int rc;
+
+	assert(cb_fn != NULL);
+
+	if (budget_percent == 0) {
+		budget_percent = NVME_HEDGE_DEFAULT_BUDGET_PERCENT;
+	}
+
+	if (percentile < 0 || percentile >= 100 || budget_percent > 100) {
+		rc = -EINVAL;
+		goto exit;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to alloc context.\n");
+		rc = -ENOMEM;
+		goto exit;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	rc = spdk_bdev_open_ext(name, false, dummy_bdev_event_cb, NULL, &ctx->desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev %s.\n", name);
+		rc = -ENODEV;
+		goto err_open;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(ctx->desc);
+	if (bdev->module != &nvme_if) {
+		SPDK_ERRLOG("bdev %s is not registered in this module.\n", name);
+		rc = -ENODEV;
+		goto err_module;
+	}
+	nbdev = SPDK_CONTAINEROF(bdev, struct nvme_bdev, disk);
+
+	pthread_mutex_lock(&nbdev->mutex);
+	nbdev->hedge_percentile = percentile;
+	nbdev->hedge_budget_percent = budget_percent;
+	pthread_mutex_unlock(&nbdev->mutex);
+
+	spdk_for_each_channel(nbdev,
+			      _bdev_nvme_set_read_hedging,
+			      ctx,
+			      bdev_nvme_set_read_hedging_done);
+	return;
+
+err_module:
+	spdk_bdev_close(ctx->desc);
+err_open:
+	free(ctx);
+exit:
+	cb_fn(cb_arg, rc);
+}
+
 static void
 aer_cb(void *arg, const struct spdk_nvme_cpl *cpl)
 {
@@ -6700,8 +7124,20 @@ bdev_nvme_stop_discovery(const char *name, spdk_bdev_nvme_stop_discovery_fn cb_f
 static int
 bdev_nvme_library_init(void)
 {
+	struct spdk_iobuf_opts iobuf_opts;
+	int rc;
+
 	g_bdev_nvme_init_thread = spdk_get_thread();
 
+	rc = spdk_iobuf_register_module(NVME_IOBUF_NAME);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to register iobuf module: %s\n", spdk_strerror(-rc));
+		return rc;
+	}
+
+	spdk_iobuf_get_opts(&iobuf_opts);
+	g_nvme_hedge_max_io_size = spdk_min(NVME_HEDGE_MAX_IO_SIZE, iobuf_opts.large_bufsize);
+
 	spdk_io_device_register(&g_nvme_bdev_ctrlrs, bdev_nvme_create_poll_group_cb,
 				bdev_nvme_destroy_poll_group_cb,
 				sizeof(struct nvme_poll_group),  "nvme_poll_groups");
@@ -6834,6 +7270,308 @@ bdev_nvme_no_pi_readv_done(void *ref, const struct spdk_nvme_cpl *cpl)
 	bdev_nvme_io_complete_nvme_status(bio, &bio->cpl);
 }
 
+static inline void
+bdev_nvme_hedge_untrack(struct nvme_bdev_io *bio)
+{
+	if (bio->hedge_io_path != NULL) {
+		TAILQ_REMOVE(&bio->hedge_io_path->hedge_candidates, bio, hedge_link);
+		bio->hedge_io_path = NULL;
+	}
+}
+
+static void bdev_nvme_hedge_read_done(void *ref, const struct spdk_nvme_cpl *cpl);
+
+/* Make a read a candidate for hedging if its I/O path has learned a hedging threshold and
+ * there is another I/O path to hedge it to. Such a read goes to a bounce buffer, so that a
+ * duplicate can complete the bdev_io while it is still outstanding. Return -EAGAIN if the
+ * read is to be submitted as usual.
+ */
+static int
+bdev_nvme_hedge_submit(struct nvme_bdev_io *bio, void *md, uint64_t lba_count, uint64_t lba,
+		       uint32_t flags)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	struct nvme_io_path *io_path = bio->io_path;
+	struct nvme_bdev_channel *nbdev_ch = io_path->nbdev_ch;
+	struct nvme_poll_group *group;
+	struct nvme_bdev_hedge *hedge;
+	struct nvme_bdev_hedge_read *read;
+	uint64_t len = lba_count * bdev_io->bdev->blocklen;
+	int rc;
+
+	if (spdk_likely(io_path->read_latency == NULL) || nbdev_ch == NULL) {
+		return -EAGAIN;
+	}
+
+	/* While the latencies are being learned, or with a single I/O path, the read could
+	 * not be hedged anyway and isn't worth a bounce buffer and a copy.
+	 */
+	if (io_path->hedge_threshold_ticks == 0 ||
+	    STAILQ_NEXT(STAILQ_FIRST(&nbdev_ch->io_path_list), stailq) == NULL) {
+		return -EAGAIN;
+	}
+
+	/* Bounce buffers cannot carry separate metadata. */
+	if (md != NULL || bdev_io->bdev->md_len != 0 || len > g_nvme_hedge_max_io_size) {
+		return -EAGAIN;
+	}
+
+	group = io_path->qpair->group;
+	hedge = STAILQ_FIRST(&group->free_hedges);
+	if (hedge == NULL) {
+		return -EAGAIN;
+	}
+
+	/* Rather than waiting for a buffer, the read is not hedged. */
+	read = &hedge->reads[0];
+	read->buf = spdk_iobuf_get(&group->iobuf, len, NULL, NULL);
+	if (read->buf == NULL) {
+		return -EAGAIN;
+	}
+
+	STAILQ_REMOVE_HEAD(&group->free_hedges, stailq);
+	hedge->group = group;
+	hedge->lba = lba;
+	hedge->lba_count = lba_count;
+	hedge->len = len;
+	read->hedge = hedge;
+	hedge->reads[1].hedge = hedge;
+
+	rc = spdk_nvme_ns_cmd_read_with_md(io_path->nvme_ns->ns, io_path->qpair->qpair, read->buf,
+					   NULL, lba, lba_count, bdev_nvme_hedge_read_done, read,
+					   flags, 0, 0);
+	if (rc != 0) {
+		spdk_iobuf_put(&group->iobuf, read->buf, len);
+		read->buf = NULL;
+		STAILQ_INSERT_HEAD(&group->free_hedges, hedge, stailq);
+		return rc;
+	}
+
+	read->ctrlr = io_path->qpair->ctrlr->ctrlr;
+	read->qpair = io_path->qpair->qpair;
+	read->outstanding = true;
+	hedge->bio = bio;
+	bio->hedge = hedge;
+
+	nbdev_ch->hedge_tokens = spdk_min(nbdev_ch->hedge_tokens + nbdev_ch->hedge_budget_percent,
+					  NVME_HEDGE_MAX_TOKENS);
+
+	bio->hedge_io_path = io_path;
+	TAILQ_INSERT_TAIL(&io_path->hedge_candidates, bio, hedge_link);
+
+	return 0;
+}
+
+static void
+bdev_nvme_hedge_abort_done(void *ref, const struct spdk_nvme_cpl *cpl)
+{
+	/* Whichever read lost completes on its own, nothing to do here. */
+}
+
+static int
+bdev_nvme_hedge_abort(struct nvme_bdev_hedge_read *read, spdk_nvme_cmd_cb cb_fn, void *cb_arg)
+{
+	return spdk_nvme_ctrlr_cmd_abort_ext(read->ctrlr, read->qpair, read, cb_fn, cb_arg);
+}
+
+/* The first copy which succeeds completes the bdev_io and the other one is aborted. A copy
+ * which fails only completes the bdev_io if the other one is not outstanding anymore.
+ */
+static void
+bdev_nvme_hedge_read_done(void *ref, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_bdev_hedge_read *read = ref;
+	struct nvme_bdev_hedge *hedge = read->hedge;
+	struct nvme_bdev_hedge_read *other = &hedge->reads[read == &hedge->reads[0] ? 1 : 0];
+	struct nvme_bdev_io *bio = hedge->bio;
+	bool success = spdk_nvme_cpl_is_success(cpl);
+
+	read->outstanding = false;
+
+	if (bio != NULL && (success || !other->outstanding)) {
+		hedge->bio = NULL;
+		bio->hedge = NULL;
+		bdev_nvme_hedge_untrack(bio);
+
+		if (other->outstanding) {
+			bdev_nvme_hedge_abort(other, bdev_nvme_hedge_abort_done, NULL);
+		}
+
+		if (success) {
+			spdk_copy_buf_to_iovs(bio->iovs, bio->iovcnt, read->buf, hedge->len);
+
+			if (bio->io_path != NULL && read == &hedge->reads[0]) {
+				if (bio->io_path->read_latency != NULL) {
+					spdk_histogram_data_tally(bio->io_path->read_latency,
+								  spdk_get_ticks() - bio->submit_tsc);
+				}
+			} else if (bio->io_path != NULL) {
+				bio->io_path->num_hedges_won++;
+			}
+		}
+	} else {
+		bio = NULL;
+	}
+
+	spdk_iobuf_put(&hedge->group->iobuf, read->buf, hedge->len);
+	read->buf = NULL;
+	if (!other->outstanding) {
+		STAILQ_INSERT_HEAD(&hedge->group->free_hedges, hedge, stailq);
+	}
+
+	if (bio != NULL) {
+		bdev_nvme_io_complete_nvme_status(bio, cpl);
+	}
+}
+
+static struct nvme_io_path *
+bdev_nvme_find_hedge_io_path(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_path *orig)
+{
+	struct nvme_io_path *io_path, *optimized = NULL, *non_optimized = NULL;
+	uint32_t opt_min_qd = UINT32_MAX, non_opt_min_qd = UINT32_MAX;
+	uint32_t num_outstanding_reqs;
+
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		if (io_path == orig || !nvme_io_path_is_available(io_path)) {
+			continue;
+		}
+
+		num_outstanding_reqs = spdk_nvme_qpair_get_num_outstanding_reqs(io_path->qpair->qpair);
+		switch (io_path->nvme_ns->ana_state) {
+		case SPDK_NVME_ANA_OPTIMIZED_STATE:
+			if (num_outstanding_reqs < opt_min_qd) {
+				opt_min_qd = num_outstanding_reqs;
+				optimized = io_path;
+			}
+			break;
+		case SPDK_NVME_ANA_NON_OPTIMIZED_STATE:
+			if (num_outstanding_reqs < non_opt_min_qd) {
+				non_opt_min_qd = num_outstanding_reqs;
+				non_optimized = io_path;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return optimized != NULL ? optimized : non_optimized;
+}
+
+static int
+bdev_nvme_hedge_readv(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio)
+{
+	struct nvme_bdev_hedge *hedge = bio->hedge;
+	struct nvme_bdev_hedge_read *read = &hedge->reads[1];
+	struct nvme_io_path *io_path;
+	int rc;
+
+	io_path = bdev_nvme_find_hedge_io_path(nbdev_ch, bio->io_path);
+	if (io_path == NULL) {
+		return -ENXIO;
+	}
+
+	read->buf = spdk_iobuf_get(&hedge->group->iobuf, hedge->len, NULL, NULL);
+	if (read->buf == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_nvme_ns_cmd_read_with_md(io_path->nvme_ns->ns, io_path->qpair->qpair, read->buf,
+					   NULL, hedge->lba, hedge->lba_count, bdev_nvme_hedge_read_done,
+					   read, 0, 0, 0);
+	if (rc != 0) {
+		spdk_iobuf_put(&hedge->group->iobuf, read->buf, hedge->len);
+		read->buf = NULL;
+		return rc;
+	}
+
+	read->ctrlr = io_path->qpair->ctrlr->ctrlr;
+	read->qpair = io_path->qpair->qpair;
+	read->outstanding = true;
+
+	nbdev_ch->hedge_tokens -= NVME_HEDGE_TOKEN_COST;
+	bio->io_path->num_hedged_reads++;
+
+	return 0;
+}
+
+struct nvme_hedge_threshold_ctx {
+	double		percentile;
+	uint64_t	total;
+	uint64_t	threshold;
+};
+
+static void
+bdev_nvme_hedge_threshold_cb(void *cb_arg, uint64_t start, uint64_t end, uint64_t count,
+			     uint64_t total, uint64_t so_far)
+{
+	struct nvme_hedge_threshold_ctx *ctx = cb_arg;
+
+	ctx->total = total;
+	if (count != 0 && ctx->threshold == 0 && so_far >= total * ctx->percentile / 100) {
+		ctx->threshold = end;
+	}
+}
+
+static void
+bdev_nvme_update_hedge_threshold(struct nvme_io_path *io_path, double percentile)
+{
+	struct nvme_hedge_threshold_ctx ctx = { .percentile = percentile };
+
+	if (io_path->read_latency == NULL) {
+		return;
+	}
+
+	spdk_histogram_data_iterate(io_path->read_latency, bdev_nvme_hedge_threshold_cb, &ctx);
+
+	/* Keep the current threshold until enough reads were sampled. */
+	if (ctx.total < NVME_HEDGE_MIN_SAMPLES) {
+		return;
+	}
+
+	io_path->hedge_threshold_ticks = ctx.threshold;
+	spdk_histogram_data_reset(io_path->read_latency);
+}
+
+static int
+bdev_nvme_hedge_poll(void *arg)
+{
+	struct nvme_bdev_channel *nbdev_ch = arg;
+	struct nvme_io_path *io_path;
+	struct nvme_bdev_io *bio;
+	uint64_t now = spdk_get_ticks();
+	int num_hedged = 0;
+
+	if (now - nbdev_ch->hedge_update_tsc >= NVME_HEDGE_UPDATE_INTERVAL_MS * spdk_get_ticks_hz() / 1000) {
+		STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+			bdev_nvme_update_hedge_threshold(io_path, nbdev_ch->hedge_percentile);
+		}
+		nbdev_ch->hedge_update_tsc = now;
+	}
+
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		if (io_path->hedge_threshold_ticks == 0) {
+			continue;
+		}
+
+		while ((bio = TAILQ_FIRST(&io_path->hedge_candidates)) != NULL) {
+			if (now - bio->submit_tsc < io_path->hedge_threshold_ticks) {
+				break;
+			}
+
+			/* A read gets a single chance to be hedged. */
+			bdev_nvme_hedge_untrack(bio);
+
+			if (nbdev_ch->hedge_tokens >= NVME_HEDGE_TOKEN_COST &&
+			    bdev_nvme_hedge_readv(nbdev_ch, bio) == 0) {
+				num_hedged++;
+			}
+		}
+	}
+
+	return num_hedged > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 bdev_nvme_readv_done(void *ref, const struct spdk_nvme_cpl *cpl)
 {
@@ -6841,6 +7579,10 @@ bdev_nvme_readv_done(void *ref, const struct spdk_nvme_cpl *cpl)
 	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
 	int ret;
 
+	if (spdk_unlikely(bio->io_path->read_latency != NULL) && spdk_nvme_cpl_is_success(cpl)) {
+		spdk_histogram_data_tally(bio->io_path->read_latency, spdk_get_ticks() - bio->submit_tsc);
+	}
+
 	if (spdk_unlikely(spdk_nvme_cpl_is_pi_error(cpl))) {
 		SPDK_ERRLOG("readv completed with PI error (sct=%d, sc=%d)\n",
 			    cpl->status.sct, cpl->status.sc);
@@ -7262,6 +8004,15 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 	bio->iovcnt = iovcnt;
 	bio->iovpos = 0;
 	bio->iov_offset = 0;
+	bio->hedge_io_path = NULL;
+	bio->hedge = NULL;
+
+	if (domain == NULL) {
+		rc = bdev_nvme_hedge_submit(bio, md, lba_count, lba, flags);
+		if (rc != -EAGAIN) {
+			goto done;
+		}
+	}
 
 	if (domain != NULL) {
 		bio->ext_opts.size = SPDK_SIZEOF(&bio->ext_opts, cdw13);
@@ -7286,6 +8037,7 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 						    bdev_nvme_queued_next_sge, md, 0, 0);
 	}
 
+done:
 	if (rc != 0 && rc != -ENOMEM) {
 		SPDK_ERRLOG("readv failed: rc = %d\n", rc);
 	}
@@ -7679,6 +8431,7 @@ bdev_nvme_abort(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
 		struct nvme_bdev_io *bio_to_abort)
 {
 	struct nvme_io_path *io_path;
+	struct nvme_bdev_hedge *hedge;
 	int rc = 0;
 
 	rc = bdev_nvme_abort_retry_io(nbdev_ch, bio_to_abort);
@@ -7687,6 +8440,20 @@ bdev_nvme_abort(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio,
 		return;
 	}
 
+	/* The copies of a read which may be hedged are known by their own context. */
+	if (bio_to_abort->hedge != NULL) {
+		hedge = bio_to_abort->hedge;
+		if (hedge->reads[0].outstanding && hedge->reads[1].outstanding) {
+			bdev_nvme_hedge_abort(&hedge->reads[1], bdev_nvme_hedge_abort_done, NULL);
+		}
+		rc = bdev_nvme_hedge_abort(&hedge->reads[hedge->reads[0].outstanding ? 0 : 1],
+					   bdev_nvme_abort_done, bio);
+		if (rc != 0) {
+			bdev_nvme_admin_complete(bio, rc);
+		}
+		return;
+	}
+
 	io_path = bio_to_abort->io_path;
 	if (io_path != NULL) {
 		rc = spdk_nvme_ctrlr_cmd_abort_ext(io_path->qpair->ctrlr->ctrlr,
@@ -7928,6 +8695,20 @@ nvme_io_path_info_json(struct spdk_json_write_ctx *w, struct nvme_io_path *io_pa
 				   io_path == io_path->nbdev_ch->current_io_path);
 	spdk_json_write_named_bool(w, "connected", nvme_qpair_is_connected(io_path->qpair));
 	spdk_json_write_named_bool(w, "accessible", nvme_ns_is_accessible(nvme_ns));
+	if (io_path->nbdev_ch != NULL && bdev_nvme_channel_tracks_latency(io_path->nbdev_ch)) {
+		spdk_json_write_named_uint64(w, "ewma_latency_us",
+					     io_path->ewma_latency_ticks * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+		if (nvme_qpair_is_connected(io_path->qpair)) {
+			spdk_json_write_named_uint32(w, "num_outstanding_reqs",
+						     spdk_nvme_qpair_get_num_outstanding_reqs(io_path->qpair->qpair));
+		}
+	}
+	if (io_path->read_latency != NULL) {
+		spdk_json_write_named_uint64(w, "hedge_threshold_us",
+					     io_path->hedge_threshold_ticks * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+		spdk_json_write_named_uint64(w, "num_hedged_reads", io_path->num_hedged_reads);
+		spdk_json_write_named_uint64(w, "num_hedges_won", io_path->num_hedges_won);
+	}
 
 	spdk_json_write_named_object_begin(w, "transport");
 	spdk_json_write_named_string(w, "trtype", trid->trstring);
@@ -14,6 +14,7 @@
 #include "spdk/nvme.h"
 #include "spdk/bdev_module.h"
 #include "spdk/jsonrpc.h"
+#include "spdk/histogram_data.h"
 
 TAILQ_HEAD(nvme_bdev_ctrlrs, nvme_bdev_ctrlr);
 extern struct nvme_bdev_ctrlrs g_nvme_bdev_ctrlrs;
@@ -31,6 +32,7 @@ enum bdev_nvme_multipath_policy {
 enum bdev_nvme_multipath_selector {
 	BDEV_NVME_MP_SELECTOR_ROUND_ROBIN = 1,
 	BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH,
+	BDEV_NVME_MP_SELECTOR_SERVICE_TIME,
 };
 
 typedef void (*spdk_bdev_create_nvme_fn)(void *ctx, size_t bdev_count, int rc);
@@ -176,6 +178,8 @@ struct nvme_bdev {
 	enum bdev_nvme_multipath_policy	mp_policy;
 	enum bdev_nvme_multipath_selector mp_selector;
 	uint32_t			rr_min_io;
+	double				hedge_percentile;
+	uint32_t			hedge_budget_percent;
 	TAILQ_HEAD(, nvme_ns)		nvme_ns_list;
 	bool				opal;
 	TAILQ_ENTRY(nvme_bdev)		tailq;
@@ -213,6 +217,17 @@ struct nvme_io_path {
 
 	/* allocation of stat is decided by option io_path_stat of RPC bdev_nvme_set_options */
 	struct spdk_bdev_io_stat	*stat;
+
+	/* The following are used by the service-time selector. */
+	uint64_t			ewma_latency_ticks;
+	uint64_t			last_select_tsc;
+
+	/* The following are used by read hedging. */
+	struct spdk_histogram_data	*read_latency;
+	uint64_t			hedge_threshold_ticks;
+	TAILQ_HEAD(, nvme_bdev_io)	hedge_candidates;
+	uint64_t			num_hedged_reads;
+	uint64_t			num_hedges_won;
 };
 
 struct nvme_bdev_channel {
@@ -221,15 +236,29 @@ struct nvme_bdev_channel {
 	enum bdev_nvme_multipath_selector	mp_selector;
 	uint32_t				rr_min_io;
 	uint32_t				rr_counter;
+	uint64_t				probe_interval_ticks;
 	STAILQ_HEAD(, nvme_io_path)		io_path_list;
 	TAILQ_HEAD(retry_io_head, spdk_bdev_io)	retry_io_list;
 	struct spdk_poller			*retry_io_poller;
+	double					hedge_percentile;
+	uint32_t				hedge_budget_percent;
+	uint32_t				hedge_tokens;
+	uint64_t				hedge_update_tsc;
+	struct spdk_poller			*hedge_poller;
 };
 
+struct nvme_bdev_hedge;
+
 struct nvme_poll_group {
 	struct spdk_nvme_poll_group		*group;
 	struct spdk_io_channel			*accel_channel;
+	/* Bounce buffers of hedged reads */
+	struct spdk_iobuf_channel		iobuf;
+	/* Contexts of hedged reads, which may outlive their bdev_io and bdev channel */
+	struct nvme_bdev_hedge			*hedges;
+	STAILQ_HEAD(, nvme_bdev_hedge)		free_hedges;
 	struct spdk_poller			*poller;
+	struct spdk_interrupt			*intr;
 	bool					collect_spin_stat;
 	uint64_t				spin_ticks;
 	uint64_t				start_ticks;
@@ -396,7 +425,7 @@ typedef void (*bdev_nvme_set_multipath_policy_cb)(void *cb_arg, int rc);
  *
  * \param name NVMe bdev name
  * \param policy Multipath policy (active-passive or active-active)
- * \param selector Multipath selector (round_robin, queue_depth)
+ * \param selector Multipath selector (round_robin, queue_depth, service_time)
  * \param rr_min_io Number of IO to route to a path before switching to another for round-robin
  * \param cb_fn Function to be called back after completion.
  */
@@ -407,4 +436,21 @@ void bdev_nvme_set_multipath_policy(const char *name,
 				    bdev_nvme_set_multipath_policy_cb cb_fn,
 				    void *cb_arg);
 
+typedef void (*bdev_nvme_set_read_hedging_cb)(void *cb_arg, int rc);
+
+/**
+ * Set read hedging of the NVMe bdev.
+ *
+ * A read which is still outstanding after the given latency percentile of its I/O path
+ * is duplicated on another I/O path and completed by whichever copy finishes first.
+ *
+ * \param name NVMe bdev name
+ * \param percentile Latency percentile after which a read is hedged, 0 to disable hedging
+ * \param budget_percent Maximum number of hedged reads as a percentage of all reads
+ * \param cb_fn Function to be called back after completion.
+ * \param cb_arg Argument for callback function.
+ */
+void bdev_nvme_set_read_hedging(const char *name, double percentile, uint32_t budget_percent,
+				bdev_nvme_set_read_hedging_cb cb_fn, void *cb_arg);
+
 #endif /* SPDK_BDEV_NVME_H */
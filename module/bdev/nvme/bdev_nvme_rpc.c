@@ -2272,6 +2272,8 @@ rpc_decode_mp_selector(const struct spdk_json_val *val, void *out)
 		*selector = BDEV_NVME_MP_SELECTOR_ROUND_ROBIN;
 	} else if (spdk_json_strequal(val, "queue_depth") == true) {
 		*selector = BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH;
+	} else if (spdk_json_strequal(val, "service_time") == true) {
+		*selector = BDEV_NVME_MP_SELECTOR_SERVICE_TIME;
 	} else {
 		SPDK_NOTICELOG("Invalid parameter value: selector\n");
 		return -EINVAL;
@@ -2351,6 +2353,101 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_nvme_set_multipath_policy", rpc_bdev_nvme_set_multipath_policy,
 		  SPDK_RPC_RUNTIME)
 
+struct rpc_set_read_hedging {
+	char *name;
+	double percentile;
+	uint32_t budget_percent;
+};
+
+static void
+free_rpc_set_read_hedging(struct rpc_set_read_hedging *req)
+{
+	free(req->name);
+}
+
+static int
+rpc_decode_percentile(const struct spdk_json_val *val, void *out)
+{
+	double *percentile = out;
+	char buf[32], *end;
+
+	if (val->type != SPDK_JSON_VAL_NUMBER || val->len >= sizeof(buf)) {
+		return -EINVAL;
+	}
+
+	memcpy(buf, val->start, val->len);
+	buf[val->len] = '\0';
+
+	errno = 0;
+	*percentile = strtod(buf, &end);
+	if (errno != 0 || *end != '\0') {
+		SPDK_NOTICELOG("Invalid parameter value: percentile\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct spdk_json_object_decoder rpc_set_read_hedging_decoders[] = {
+	{"name", offsetof(struct rpc_set_read_hedging, name), spdk_json_decode_string},
+	{"percentile", offsetof(struct rpc_set_read_hedging, percentile), rpc_decode_percentile},
+	{"budget_percent", offsetof(struct rpc_set_read_hedging, budget_percent), spdk_json_decode_uint32, true},
+};
+
+struct rpc_set_read_hedging_ctx {
+	struct rpc_set_read_hedging req;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+rpc_bdev_nvme_set_read_hedging_done(void *cb_arg, int rc)
+{
+	struct rpc_set_read_hedging_ctx *ctx = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(ctx->request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+	}
+
+	free_rpc_set_read_hedging(&ctx->req);
+	free(ctx);
+}
+
+static void
+rpc_bdev_nvme_set_read_hedging(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_set_read_hedging_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_set_read_hedging_decoders,
+				    SPDK_COUNTOF(rpc_set_read_hedging_decoders),
+				    &ctx->req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	ctx->request = request;
+
+	bdev_nvme_set_read_hedging(ctx->req.name, ctx->req.percentile, ctx->req.budget_percent,
+				   rpc_bdev_nvme_set_read_hedging_done, ctx);
+	return;
+
+cleanup:
+	free_rpc_set_read_hedging(&ctx->req);
+	free(ctx);
+}
+SPDK_RPC_REGISTER("bdev_nvme_set_read_hedging", rpc_bdev_nvme_set_read_hedging,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_nvme_start_mdns_discovery {
 	char *name;
 	char *svcname;
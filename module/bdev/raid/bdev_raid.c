@@ -11,9 +11,91 @@
 #include "spdk/string.h"
 #include "spdk/util.h"
 #include "spdk/json.h"
+#include "spdk/likely.h"
+
+#define RAID_OFFSET_BLOCKS_INVALID	UINT64_MAX
+#define RAID_BDEV_PROCESS_WINDOW_SIZE_KB_DEFAULT	1024
+#define RAID_BDEV_PROCESS_REQUEST_SIZE_KB	128
+#define RAID_BDEV_PROCESS_MAX_QD	16
 
 static bool g_shutdown_started = false;
 
+static struct raid_bdev_opts g_opts = {
+	.process_window_size_kb = RAID_BDEV_PROCESS_WINDOW_SIZE_KB_DEFAULT,
+	.process_max_bandwidth_mb_sec = 0,
+};
+
+enum raid_bdev_process_state {
+	RAID_PROCESS_STATE_INIT,
+	RAID_PROCESS_STATE_RUNNING,
+	RAID_PROCESS_STATE_STOPPING,
+	RAID_PROCESS_STATE_STOPPED,
+};
+
+/*
+ * raid_bdev_process rebuilds a base bdev of an online raid bdev. The address space
+ * is processed in windows. Each window is quiesced for foreground I/O while the raid
+ * module reconstructs it onto the target base bdev.
+ */
+struct raid_bdev_process {
+	/* The raid bdev being processed */
+	struct raid_bdev		*raid_bdev;
+
+	/* The base bdev being rebuilt */
+	struct raid_base_bdev_info	*target;
+
+	enum raid_bdev_process_state	state;
+
+	/* Status of the process, the first error encountered */
+	int				status;
+
+	/* Descriptor of the raid bdev, keeps it registered until the process is finished */
+	struct spdk_bdev_desc		*desc;
+
+	/* Raid bdev IO channel of the process thread */
+	struct spdk_io_channel		*raid_ch_ref;
+
+	/* The channel of the process, includes the target base bdev */
+	struct raid_bdev_io_channel	*raid_ch;
+
+	/* Start of the current window, all blocks below it have been processed */
+	uint64_t			window_offset;
+
+	/* Size of the current window */
+	uint64_t			window_size;
+
+	/* Number of blocks of the current window not submitted yet */
+	uint64_t			window_remaining;
+
+	/* Status of the current window */
+	int				window_status;
+
+	/* Number of requests of the current window in progress */
+	uint32_t			window_requests;
+
+	/* Time when the current window was started, for bandwidth throttling */
+	uint64_t			window_start_tsc;
+
+	/* Size of a window in blocks */
+	uint64_t			max_window_size;
+
+	/* Size of the buffer of a request in blocks */
+	uint32_t			request_size;
+
+	/* Poller delaying the next window to keep within the bandwidth limit */
+	struct spdk_poller		*throttle_poller;
+
+	/* Free requests */
+	TAILQ_HEAD(, raid_bdev_process_request) requests;
+
+	/* Whether the raid bdev was quiesced when finishing the process */
+	bool				quiesced;
+
+	/* Called when the process is finished after it was stopped */
+	void				(*stop_cb)(void *ctx);
+	void				*stop_cb_ctx;
+};
+
 /* List of all raid bdevs */
 struct raid_all_tailq g_raid_bdev_list = TAILQ_HEAD_INITIALIZER(g_raid_bdev_list);
 
@@ -50,6 +132,122 @@ static void	raid_bdev_examine(struct spdk_bdev *bdev);
 static int	raid_bdev_init(void);
 static void	raid_bdev_deconfigure(struct raid_bdev *raid_bdev,
 				      raid_bdev_destruct_cb cb_fn, void *cb_arg);
+static struct raid_bdev_process *raid_bdev_process_alloc(struct raid_bdev *raid_bdev,
+		struct raid_base_bdev_info *target, uint64_t offset_blocks);
+static void	raid_bdev_process_start(struct raid_bdev_process *process);
+static void	raid_bdev_process_free(struct raid_bdev_process *process);
+
+static inline bool
+raid_bdev_process_target_is_rebuilt(struct raid_bdev_process *process)
+{
+	return process->state == RAID_PROCESS_STATE_STOPPED && process->status == 0;
+}
+
+/*
+ * brief:
+ * raid_bdev_ch_include_base_bdev checks if a raid bdev io channel should get a
+ * channel of the base bdev in the given slot. A base bdev being rebuilt is only
+ * accessed through the channel for the already processed range.
+ * Must be called with the base_bdev_lock held.
+ */
+static bool
+raid_bdev_ch_include_base_bdev(struct raid_bdev *raid_bdev, struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev_process *process = raid_bdev->process;
+
+	if (base_info->desc == NULL || base_info->remove_scheduled) {
+		return false;
+	}
+
+	if (process != NULL && process->target == base_info) {
+		return raid_bdev_process_target_is_rebuilt(process);
+	}
+
+	return true;
+}
+
+static void
+raid_bdev_ch_process_cleanup(struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io_channel *raid_ch_processed = raid_ch->process.ch_processed;
+	uint8_t i;
+
+	raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+
+	if (raid_ch_processed == NULL) {
+		return;
+	}
+
+	for (i = 0; i < raid_ch_processed->num_channels; i++) {
+		if (raid_ch_processed->base_channel[i] != NULL) {
+			spdk_put_io_channel(raid_ch_processed->base_channel[i]);
+		}
+	}
+
+	if (raid_ch_processed->module_channel != NULL) {
+		spdk_put_io_channel(raid_ch_processed->module_channel);
+	}
+
+	free(raid_ch_processed->base_channel);
+	free(raid_ch_processed);
+	raid_ch->process.ch_processed = NULL;
+}
+
+/*
+ * brief:
+ * raid_bdev_ch_process_setup creates the channel used by a raid bdev io channel for
+ * the range already processed by the background process. It has the same base bdev
+ * channels as raid_ch plus the channel of the process target.
+ * Must be called with the base_bdev_lock held.
+ */
+static int
+raid_bdev_ch_process_setup(struct raid_bdev_io_channel *raid_ch, struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch_processed;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+
+	raid_ch_processed = calloc(1, sizeof(*raid_ch_processed));
+	if (raid_ch_processed == NULL) {
+		return -ENOMEM;
+	}
+	raid_ch->process.ch_processed = raid_ch_processed;
+
+	raid_ch_processed->num_channels = raid_ch->num_channels;
+	raid_ch_processed->base_channel = calloc(raid_ch->num_channels,
+					  sizeof(struct spdk_io_channel *));
+	if (raid_ch_processed->base_channel == NULL) {
+		goto err;
+	}
+
+	for (i = 0; i < raid_ch->num_channels; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+
+		if (base_info != process->target && raid_ch->base_channel[i] == NULL) {
+			continue;
+		}
+
+		raid_ch_processed->base_channel[i] = spdk_bdev_get_io_channel(base_info->desc);
+		if (raid_ch_processed->base_channel[i] == NULL) {
+			goto err;
+		}
+	}
+
+	if (raid_ch->module_channel != NULL) {
+		raid_ch_processed->module_channel = raid_bdev->module->get_io_channel(raid_bdev);
+		if (raid_ch_processed->module_channel == NULL) {
+			goto err;
+		}
+	}
+
+	raid_ch->process.offset = process->window_offset;
+
+	return 0;
+err:
+	raid_bdev_ch_process_cleanup(raid_ch);
+	return -ENOMEM;
+}
 
 /*
  * brief:
@@ -76,6 +274,7 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 	assert(raid_bdev->state == RAID_BDEV_STATE_ONLINE);
 
 	raid_ch->num_channels = raid_bdev->num_base_bdevs;
+	raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
 
 	raid_ch->base_channel = calloc(raid_ch->num_channels,
 				       sizeof(struct spdk_io_channel *));
@@ -91,7 +290,7 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		 * split logic to send the respective child bdev ios to respective base
 		 * bdev io channel.
 		 */
-		if (raid_bdev->base_bdev_info[i].desc == NULL) {
+		if (!raid_bdev_ch_include_base_bdev(raid_bdev, &raid_bdev->base_bdev_info[i])) {
 			continue;
 		}
 		raid_ch->base_channel[i] = spdk_bdev_get_io_channel(
@@ -102,7 +301,6 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 			break;
 		}
 	}
-	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
 
 	if (!ret && raid_bdev->module->get_io_channel) {
 		raid_ch->module_channel = raid_bdev->module->get_io_channel(raid_bdev);
@@ -112,7 +310,20 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		}
 	}
 
+	if (!ret && raid_bdev->process != NULL &&
+	    raid_bdev->process->state != RAID_PROCESS_STATE_STOPPED) {
+		ret = raid_bdev_ch_process_setup(raid_ch, raid_bdev->process);
+		if (ret != 0) {
+			SPDK_ERRLOG("Failed to setup process io channel\n");
+		}
+	}
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
 	if (ret) {
+		if (raid_ch->module_channel) {
+			spdk_put_io_channel(raid_ch->module_channel);
+			raid_ch->module_channel = NULL;
+		}
 		for (i = 0; i < raid_ch->num_channels; i++) {
 			if (raid_ch->base_channel[i] != NULL) {
 				spdk_put_io_channel(raid_ch->base_channel[i]);
@@ -145,6 +356,8 @@ raid_bdev_destroy_cb(void *io_device, void *ctx_buf)
 	assert(raid_ch != NULL);
 	assert(raid_ch->base_channel);
 
+	raid_bdev_ch_process_cleanup(raid_ch);
+
 	if (raid_ch->module_channel) {
 		spdk_put_io_channel(raid_ch->module_channel);
 	}
@@ -265,6 +478,8 @@ _raid_bdev_destruct(void *ctxt)
 
 	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_destruct\n");
 
+	assert(raid_bdev->process == NULL);
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		/*
 		 * Close all base bdev descriptors for which call has come from below
@@ -469,13 +684,54 @@ raid_bdev_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
  * returns:
  * none
  */
+/*
+ * brief:
+ * raid_bdev_io_get_channel selects the raid bdev io channel for an I/O. When a
+ * background process is running, I/O to the already processed range also goes to
+ * the process target. The range being processed is quiesced so an I/O can't
+ * overlap it.
+ */
+static struct raid_bdev_io_channel *
+raid_bdev_io_get_channel(struct raid_bdev_io_channel *raid_ch, struct spdk_bdev_io *bdev_io)
+{
+	uint64_t offset = raid_ch->process.offset;
+
+	if (spdk_likely(raid_ch->process.ch_processed == NULL) ||
+	    offset == RAID_OFFSET_BLOCKS_INVALID) {
+		return raid_ch;
+	}
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		if (bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks <= offset) {
+			return raid_ch->process.ch_processed;
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		/*
+		 * Writing also to the not yet processed part of the target is harmless,
+		 * it will be overwritten by the process.
+		 */
+		if (bdev_io->u.bdev.offset_blocks < offset) {
+			return raid_ch->process.ch_processed;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return raid_ch;
+}
+
 static void
 raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
 {
 	struct raid_bdev_io *raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
 
 	raid_io->raid_bdev = bdev_io->bdev->ctxt;
-	raid_io->raid_ch = spdk_io_channel_get_ctx(ch);
+	raid_io->raid_ch = raid_bdev_io_get_channel(spdk_io_channel_get_ctx(ch), bdev_io);
 	raid_io->base_bdev_io_remaining = 0;
 	raid_io->base_bdev_io_submitted = 0;
 	raid_io->base_bdev_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
@@ -603,6 +859,10 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 	spdk_json_write_named_uint32(w, "strip_size_kb", raid_bdev->strip_size_kb);
 	spdk_json_write_named_string(w, "state", raid_bdev_state_to_str(raid_bdev->state));
 	spdk_json_write_named_string(w, "raid_level", raid_bdev_level_to_str(raid_bdev->level));
+	if (raid_bdev->level == RAID1) {
+		spdk_json_write_named_string(w, "read_policy",
+					     raid_bdev_read_policy_to_str(raid_bdev->read_policy));
+	}
 	spdk_json_write_named_uint32(w, "num_base_bdevs", raid_bdev->num_base_bdevs);
 	spdk_json_write_named_uint32(w, "num_base_bdevs_discovered", raid_bdev->num_base_bdevs_discovered);
 	spdk_json_write_name(w, "base_bdevs_list");
@@ -615,6 +875,23 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 		}
 	}
 	spdk_json_write_array_end(w);
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	if (raid_bdev->process != NULL &&
+	    raid_bdev->process->state != RAID_PROCESS_STATE_STOPPED) {
+		struct raid_bdev_process *process = raid_bdev->process;
+		uint64_t offset = process->window_offset;
+
+		spdk_json_write_named_object_begin(w, "process");
+		spdk_json_write_named_string(w, "type", "rebuild");
+		spdk_json_write_named_string(w, "target", process->target->name);
+		spdk_json_write_named_object_begin(w, "progress");
+		spdk_json_write_named_uint64(w, "blocks", offset);
+		spdk_json_write_named_uint32(w, "percent", offset * 100 / raid_bdev->bdev.blockcnt);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
 }
 
 /*
@@ -667,6 +944,10 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 	spdk_json_write_named_string(w, "name", bdev->name);
 	spdk_json_write_named_uint32(w, "strip_size_kb", raid_bdev->strip_size_kb);
 	spdk_json_write_named_string(w, "raid_level", raid_bdev_level_to_str(raid_bdev->level));
+	if (raid_bdev->level == RAID1) {
+		spdk_json_write_named_string(w, "read_policy",
+					     raid_bdev_read_policy_to_str(raid_bdev->read_policy));
+	}
 
 	spdk_json_write_named_array_begin(w, "base_bdevs");
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
@@ -675,6 +956,16 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 		}
 	}
 	spdk_json_write_array_end(w);
+
+	/* Save the rebuild checkpoint so that the rebuild can be resumed */
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	if (raid_bdev->process != NULL &&
+	    raid_bdev->process->state != RAID_PROCESS_STATE_STOPPED) {
+		spdk_json_write_named_string(w, "rebuild_base_bdev", raid_bdev->process->target->name);
+		spdk_json_write_named_uint64(w, "rebuild_offset", raid_bdev->process->window_offset);
+	}
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -779,9 +1070,20 @@ static struct {
 	{ }
 };
 
+static struct {
+	const char *name;
+	enum raid_read_policy value;
+} g_raid_read_policy_names[] = {
+	{ "least_outstanding", RAID_READ_POLICY_LEAST_OUTSTANDING },
+	{ "round_robin", RAID_READ_POLICY_ROUND_ROBIN },
+	{ "sequential", RAID_READ_POLICY_SEQUENTIAL },
+	{ }
+};
+
 /* We have to use the typedef in the function declaration to appease astyle. */
 typedef enum raid_level raid_level_t;
 typedef enum raid_bdev_state raid_bdev_state_t;
+typedef enum raid_read_policy raid_read_policy_t;
 
 raid_level_t
 raid_bdev_str_to_level(const char *str)
@@ -844,6 +1146,36 @@ raid_bdev_state_to_str(enum raid_bdev_state state)
 	return "";
 }
 
+raid_read_policy_t
+raid_bdev_str_to_read_policy(const char *str)
+{
+	unsigned int i;
+
+	assert(str != NULL);
+
+	for (i = 0; g_raid_read_policy_names[i].name != NULL; i++) {
+		if (strcasecmp(g_raid_read_policy_names[i].name, str) == 0) {
+			return g_raid_read_policy_names[i].value;
+		}
+	}
+
+	return INVALID_RAID_READ_POLICY;
+}
+
+const char *
+raid_bdev_read_policy_to_str(enum raid_read_policy read_policy)
+{
+	unsigned int i;
+
+	for (i = 0; g_raid_read_policy_names[i].name != NULL; i++) {
+		if (g_raid_read_policy_names[i].value == read_policy) {
+			return g_raid_read_policy_names[i].name;
+		}
+	}
+
+	return "";
+}
+
 /*
  * brief:
  * raid_bdev_fini_start is called when bdev layer is starting the
@@ -896,6 +1228,42 @@ raid_bdev_get_ctx_size(void)
 	return sizeof(struct raid_bdev_io);
 }
 
+static int
+raid_bdev_config_json(struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "method", "bdev_raid_set_options");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_uint32(w, "process_window_size_kb", g_opts.process_window_size_kb);
+	spdk_json_write_named_uint32(w, "process_max_bandwidth_mb_sec",
+				     g_opts.process_max_bandwidth_mb_sec);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+void
+raid_bdev_get_opts(struct raid_bdev_opts *opts)
+{
+	*opts = g_opts;
+}
+
+int
+raid_bdev_set_opts(const struct raid_bdev_opts *opts)
+{
+	if (opts->process_window_size_kb == 0) {
+		return -EINVAL;
+	}
+
+	g_opts = *opts;
+
+	return 0;
+}
+
 static struct spdk_bdev_module g_raid_if = {
 	.name = "raid",
 	.module_init = raid_bdev_init,
@@ -903,6 +1271,7 @@ static struct spdk_bdev_module g_raid_if = {
 	.module_fini = raid_bdev_exit,
 	.get_ctx_size = raid_bdev_get_ctx_size,
 	.examine_config = raid_bdev_examine,
+	.config_json = raid_bdev_config_json,
 	.async_init = false,
 	.async_fini = false,
 };
@@ -931,6 +1300,7 @@ raid_bdev_init(void)
  * strip_size - strip size in KB
  * num_base_bdevs - number of base bdevs
  * level - raid level
+ * read_policy - policy for distributing reads among base bdevs (raid1 only)
  * raid_bdev_out - the created raid bdev
  * returns:
  * 0 - success
@@ -938,7 +1308,8 @@ raid_bdev_init(void)
  */
 int
 raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bdevs,
-		 enum raid_level level, struct raid_bdev **raid_bdev_out, const struct spdk_uuid *uuid)
+		 enum raid_level level, enum raid_read_policy read_policy,
+		 struct raid_bdev **raid_bdev_out, const struct spdk_uuid *uuid)
 {
 	struct raid_bdev *raid_bdev;
 	struct spdk_bdev *raid_bdev_gen;
@@ -961,6 +1332,14 @@ raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bdevs,
 		return -EINVAL;
 	}
 
+	if (read_policy == INVALID_RAID_READ_POLICY) {
+		SPDK_ERRLOG("Invalid read policy\n");
+		return -EINVAL;
+	} else if (level != RAID1 && read_policy != RAID_READ_POLICY_LEAST_OUTSTANDING) {
+		SPDK_ERRLOG("Read policy is supported only by raid1\n");
+		return -EINVAL;
+	}
+
 	module = raid_bdev_module_find(level);
 	if (module == NULL) {
 		SPDK_ERRLOG("Unsupported raid level '%d'\n", level);
@@ -1030,6 +1409,7 @@ raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bdevs,
 	raid_bdev->strip_size_kb = strip_size;
 	raid_bdev->state = RAID_BDEV_STATE_CONFIGURING;
 	raid_bdev->level = level;
+	raid_bdev->read_policy = read_policy;
 	raid_bdev->min_base_bdevs_operational = min_operational;
 
 	raid_bdev_gen = &raid_bdev->bdev;
@@ -1167,6 +1547,20 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 		SPDK_ERRLOG("raid module startup callback failed\n");
 		return rc;
 	}
+
+	if (raid_bdev->rebuild_checkpoint.target != NULL) {
+		/* Resume the rebuild, the target is not operational until it is finished */
+		raid_bdev->process = raid_bdev_process_alloc(raid_bdev, raid_bdev->rebuild_checkpoint.target,
+				     raid_bdev->rebuild_checkpoint.offset);
+		if (raid_bdev->process == NULL) {
+			if (raid_bdev->module->stop != NULL) {
+				raid_bdev->module->stop(raid_bdev);
+			}
+			return -ENOMEM;
+		}
+		raid_bdev->rebuild_checkpoint.target = NULL;
+	}
+
 	raid_bdev->state = RAID_BDEV_STATE_ONLINE;
 	SPDK_DEBUGLOG(bdev_raid, "io device register %p\n", raid_bdev);
 	SPDK_DEBUGLOG(bdev_raid, "blockcnt %" PRIu64 ", blocklen %u\n",
@@ -1177,6 +1571,10 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 	rc = spdk_bdev_register(raid_bdev_gen);
 	if (rc != 0) {
 		SPDK_ERRLOG("Unable to register raid bdev and stay at configuring state\n");
+		if (raid_bdev->process != NULL) {
+			raid_bdev_process_free(raid_bdev->process);
+			raid_bdev->process = NULL;
+		}
 		if (raid_bdev->module->stop != NULL) {
 			raid_bdev->module->stop(raid_bdev);
 		}
@@ -1188,6 +1586,10 @@ raid_bdev_configure(struct raid_bdev *raid_bdev)
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev is created with name %s, raid_bdev %p\n",
 		      raid_bdev_gen->name, raid_bdev);
 
+	if (raid_bdev->process != NULL) {
+		raid_bdev_process_start(raid_bdev->process);
+	}
+
 	return 0;
 }
 
@@ -1247,76 +1649,726 @@ raid_bdev_find_base_info_by_bdev(struct spdk_bdev *base_bdev)
 	return NULL;
 }
 
+static void raid_bdev_process_thread_run(struct raid_bdev_process *process);
+
 static void
-raid_bdev_remove_base_bdev_on_unquiesced(void *ctx, int status)
+raid_bdev_process_free(struct raid_bdev_process *process)
 {
-	struct raid_base_bdev_info *base_info = ctx;
-	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	struct raid_bdev_process_request *process_req;
 
-	base_info->remove_scheduled = false;
-
-	if (status != 0) {
-		SPDK_ERRLOG("Failed to unquiesce raid bdev %s: %s\n",
-			    raid_bdev->bdev.name, spdk_strerror(-status));
-		goto out;
+	while ((process_req = TAILQ_FIRST(&process->requests)) != NULL) {
+		TAILQ_REMOVE(&process->requests, process_req, link);
+		spdk_dma_free(process_req->iov.iov_base);
+		spdk_dma_free(process_req->md_buf);
+		free(process_req);
 	}
 
-	spdk_spin_lock(&raid_bdev->base_bdev_lock);
-	raid_bdev_free_base_bdev_resource(base_info);
-	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
-out:
-	if (base_info->remove_cb != NULL) {
-		base_info->remove_cb(base_info->remove_cb_ctx, status);
-	}
+	free(process);
 }
 
-static void
-raid_bdev_channel_remove_base_bdev(struct spdk_io_channel_iter *i)
+/*
+ * brief:
+ * raid_bdev_process_alloc allocates a background process rebuilding the target
+ * base bdev, starting from offset_blocks. The offset is rounded down to the
+ * process granularity of the raid module.
+ */
+static struct raid_bdev_process *
+raid_bdev_process_alloc(struct raid_bdev *raid_bdev, struct raid_base_bdev_info *target,
+			uint64_t offset_blocks)
 {
-	struct raid_base_bdev_info *base_info = spdk_io_channel_iter_get_ctx(i);
-	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
-	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
-	uint8_t idx = base_info - base_info->raid_bdev->base_bdev_info;
-
-	SPDK_DEBUGLOG(bdev_raid, "slot: %u raid_ch: %p\n", idx, raid_ch);
+	struct raid_bdev_process *process;
+	uint32_t granularity = spdk_max(raid_bdev->process_granularity, 1);
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t window_size;
 
-	if (raid_ch->base_channel[idx] != NULL) {
-		spdk_put_io_channel(raid_ch->base_channel[idx]);
-		raid_ch->base_channel[idx] = NULL;
+	process = calloc(1, sizeof(*process));
+	if (process == NULL) {
+		return NULL;
 	}
 
-	spdk_for_each_channel_continue(i, 0);
-}
+	process->raid_bdev = raid_bdev;
+	process->target = target;
+	process->state = RAID_PROCESS_STATE_INIT;
+	TAILQ_INIT(&process->requests);
 
-static void
-raid_bdev_channels_remove_base_bdev_done(struct spdk_io_channel_iter *i, int status)
-{
-	struct raid_base_bdev_info *base_info = spdk_io_channel_iter_get_ctx(i);
-	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	offset_blocks = spdk_min(offset_blocks, raid_bdev->bdev.blockcnt);
+	process->window_offset = offset_blocks - offset_blocks % granularity;
 
-	spdk_bdev_unquiesce(&raid_bdev->bdev, &g_raid_if, raid_bdev_remove_base_bdev_on_unquiesced,
-			    base_info);
+	process->request_size = spdk_divide_round_up(RAID_BDEV_PROCESS_REQUEST_SIZE_KB * 1024,
+				blocklen);
+	process->request_size = spdk_divide_round_up(process->request_size, granularity) * granularity;
+
+	window_size = (uint64_t)g_opts.process_window_size_kb * 1024 / blocklen;
+	process->max_window_size = spdk_max(spdk_divide_round_up(window_size, process->request_size), 1) *
+				   process->request_size;
+
+	return process;
 }
 
-static void
-raid_bdev_remove_base_bdev_on_quiesced(void *ctx, int status)
+static int
+raid_bdev_process_alloc_requests(struct raid_bdev_process *process)
 {
-	struct raid_base_bdev_info *base_info = ctx;
-	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_process_request *process_req;
+	struct raid_base_bdev_info *base_info;
+	size_t alignment = 0;
+	int i;
 
-	if (status != 0) {
-		SPDK_ERRLOG("Failed to quiesce raid bdev %s: %s\n",
-			    raid_bdev->bdev.name, spdk_strerror(-status));
-		base_info->remove_scheduled = false;
-		if (base_info->remove_cb != NULL) {
-			base_info->remove_cb(base_info->remove_cb_ctx, status);
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc != NULL) {
+			alignment = spdk_max(alignment,
+					     spdk_bdev_get_buf_align(spdk_bdev_desc_get_bdev(base_info->desc)));
 		}
-		return;
 	}
 
-	spdk_for_each_channel(raid_bdev, raid_bdev_channel_remove_base_bdev, base_info,
-			      raid_bdev_channels_remove_base_bdev_done);
-}
+	for (i = 0; i < RAID_BDEV_PROCESS_MAX_QD; i++) {
+		process_req = calloc(1, sizeof(*process_req));
+		if (process_req == NULL) {
+			return -ENOMEM;
+		}
+		process_req->process = process;
+		TAILQ_INSERT_TAIL(&process->requests, process_req, link);
+
+		process_req->iov.iov_base = spdk_dma_malloc(process->request_size * raid_bdev->bdev.blocklen,
+					    alignment, NULL);
+		if (process_req->iov.iov_base == NULL) {
+			return -ENOMEM;
+		}
+
+		if (spdk_bdev_is_md_separate(&raid_bdev->bdev)) {
+			process_req->md_buf = spdk_dma_malloc(process->request_size * raid_bdev->bdev.md_len,
+							      alignment, NULL);
+			if (process_req->md_buf == NULL) {
+				return -ENOMEM;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void
+raid_bdev_process_finish_unquiesced(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to unquiesce raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	if (process->desc != NULL) {
+		spdk_bdev_close(process->desc);
+	}
+
+	if (process->stop_cb != NULL) {
+		process->stop_cb(process->stop_cb_ctx);
+	}
+
+	raid_bdev_process_free(process);
+}
+
+static void
+raid_bdev_channels_process_finish_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_base_bdev_info *target = process->target;
+	int rc;
+
+	if (process->status == 0) {
+		SPDK_NOTICELOG("Finished rebuild on raid bdev %s\n", raid_bdev->bdev.name);
+	} else {
+		SPDK_WARNLOG("Finished rebuild on raid bdev %s with error: %s\n",
+			     raid_bdev->bdev.name, spdk_strerror(-process->status));
+
+		/* The target contains incomplete data, it can't be a part of the raid bdev */
+		if (raid_bdev->state == RAID_BDEV_STATE_ONLINE && !target->remove_scheduled &&
+		    target->desc != NULL) {
+			rc = raid_bdev_remove_base_bdev(spdk_bdev_desc_get_bdev(target->desc), NULL, NULL);
+			if (rc != 0) {
+				SPDK_ERRLOG("Failed to remove base bdev %s: %s\n",
+					    target->name, spdk_strerror(-rc));
+			}
+		}
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	raid_bdev->process = NULL;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	if (process->quiesced) {
+		rc = spdk_bdev_unquiesce(&raid_bdev->bdev, &g_raid_if,
+					 raid_bdev_process_finish_unquiesced, process);
+		if (rc != 0) {
+			raid_bdev_process_finish_unquiesced(process, rc);
+		}
+	} else {
+		raid_bdev_process_finish_unquiesced(process, 0);
+	}
+}
+
+static void
+raid_bdev_channel_process_finish(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	struct raid_bdev_io_channel *raid_ch_processed = raid_ch->process.ch_processed;
+	uint8_t idx = process->target - process->raid_bdev->base_bdev_info;
+
+	if (process->status == 0 && raid_ch_processed != NULL &&
+	    raid_ch->base_channel[idx] == NULL) {
+		/* Take over the channel of the rebuilt base bdev */
+		raid_ch->base_channel[idx] = raid_ch_processed->base_channel[idx];
+		raid_ch_processed->base_channel[idx] = NULL;
+	}
+
+	raid_bdev_ch_process_cleanup(raid_ch);
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+raid_bdev_process_finish_quiesced(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to quiesce raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	} else {
+		process->quiesced = true;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	process->state = RAID_PROCESS_STATE_STOPPED;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	if (process->raid_ch_ref != NULL) {
+		spdk_put_io_channel(process->raid_ch_ref);
+		process->raid_ch_ref = NULL;
+		process->raid_ch = NULL;
+	}
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_process_finish, process,
+			      raid_bdev_channels_process_finish_done);
+}
+
+static void
+raid_bdev_process_finish(struct raid_bdev_process *process)
+{
+	int rc;
+
+	assert(process->throttle_poller == NULL);
+
+	/* Don't let a stop request fail a completed process */
+	process->state = RAID_PROCESS_STATE_STOPPING;
+
+	rc = spdk_bdev_quiesce(&process->raid_bdev->bdev, &g_raid_if,
+			       raid_bdev_process_finish_quiesced, process);
+	if (rc != 0) {
+		raid_bdev_process_finish_quiesced(process, rc);
+	}
+}
+
+static int
+raid_bdev_process_throttle_done(void *arg)
+{
+	struct raid_bdev_process *process = arg;
+
+	spdk_poller_unregister(&process->throttle_poller);
+	raid_bdev_process_thread_run(process);
+
+	return SPDK_POLLER_BUSY;
+}
+
+/*
+ * brief:
+ * raid_bdev_process_throttle delays the next window if processing the last one
+ * took less time than allowed by the bandwidth limit.
+ * returns:
+ * true - the next window is delayed
+ * false - the next window can be started immediately
+ */
+static bool
+raid_bdev_process_throttle(struct raid_bdev_process *process)
+{
+	uint64_t max_bw = g_opts.process_max_bandwidth_mb_sec;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+	uint64_t bytes, min_ticks, ticks;
+
+	if (max_bw == 0) {
+		return false;
+	}
+
+	bytes = process->window_size * process->raid_bdev->bdev.blocklen;
+	min_ticks = bytes * ticks_hz / (max_bw * 1024 * 1024);
+	ticks = spdk_get_ticks() - process->window_start_tsc;
+	if (ticks >= min_ticks) {
+		return false;
+	}
+
+	process->throttle_poller = SPDK_POLLER_REGISTER(raid_bdev_process_throttle_done, process,
+				   (min_ticks - ticks) * SPDK_SEC_TO_USEC / ticks_hz);
+
+	return process->throttle_poller != NULL;
+}
+
+static void
+raid_bdev_process_window_range_unlocked(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to unquiesce range on raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+		if (process->status == 0) {
+			process->status = status;
+		}
+	}
+
+	if (process->window_status != 0 && process->status == 0) {
+		process->status = process->window_status;
+	}
+
+	if (process->state == RAID_PROCESS_STATE_RUNNING && process->status == 0 &&
+	    raid_bdev_process_throttle(process)) {
+		return;
+	}
+
+	raid_bdev_process_thread_run(process);
+}
+
+static void
+raid_bdev_process_window_unlock(struct raid_bdev_process *process, uint64_t offset)
+{
+	int rc;
+
+	rc = spdk_bdev_unquiesce_range(&process->raid_bdev->bdev, &g_raid_if, offset,
+				       process->window_size, raid_bdev_process_window_range_unlocked,
+				       process);
+	if (rc != 0) {
+		raid_bdev_process_window_range_unlocked(process, rc);
+	}
+}
+
+static void
+raid_bdev_channels_update_process_offset_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+
+	raid_bdev_process_window_unlock(process, process->window_offset - process->window_size);
+}
+
+static void
+raid_bdev_channel_update_process_offset(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+
+	if (raid_ch->process.ch_processed != NULL) {
+		raid_ch->process.offset = process->window_offset;
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+raid_bdev_process_window_done(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+
+	if (process->window_remaining != 0 || process->window_status != 0) {
+		/* The window was not completed, it will not be counted as processed */
+		raid_bdev_process_window_unlock(process, process->window_offset);
+		return;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	process->window_offset += process->window_size;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_update_process_offset, process,
+			      raid_bdev_channels_update_process_offset_done);
+}
+
+static int
+raid_bdev_submit_process_request(struct raid_bdev_process *process,
+				 struct raid_bdev_process_request *process_req)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = process->raid_ch;
+	uint8_t idx = process->target - raid_bdev->base_bdev_info;
+	int ret;
+
+	process_req->target = process->target;
+	process_req->target_ch = raid_ch->base_channel[idx];
+	process_req->offset_blocks = process->window_offset + process->window_size -
+				     process->window_remaining;
+	process_req->num_blocks = spdk_min(process->request_size, process->window_remaining);
+	process_req->iov.iov_len = process_req->num_blocks * raid_bdev->bdev.blocklen;
+
+	TAILQ_REMOVE(&process->requests, process_req, link);
+
+	ret = raid_bdev->module->submit_process_request(process_req, raid_ch);
+	if (ret <= 0) {
+		TAILQ_INSERT_HEAD(&process->requests, process_req, link);
+		return ret == 0 ? -EINVAL : ret;
+	}
+	assert((uint32_t)ret <= process_req->num_blocks);
+
+	process->window_remaining -= ret;
+	process->window_requests++;
+
+	return 0;
+}
+
+static void _raid_bdev_process_window_submit(void *ctx);
+
+static void
+raid_bdev_process_window_submit(struct raid_bdev_process *process)
+{
+	struct raid_bdev_process_request *process_req;
+	int ret;
+
+	while (process->window_remaining > 0 && process->window_status == 0 &&
+	       process->state == RAID_PROCESS_STATE_RUNNING) {
+		process_req = TAILQ_FIRST(&process->requests);
+		if (process_req == NULL) {
+			break;
+		}
+
+		ret = raid_bdev_submit_process_request(process, process_req);
+		if (ret == -ENOMEM) {
+			if (process->window_requests == 0) {
+				/* Nothing to wait for, retry later */
+				spdk_thread_send_msg(spdk_get_thread(), _raid_bdev_process_window_submit, process);
+				return;
+			}
+			break;
+		} else if (ret != 0) {
+			process->window_status = ret;
+		}
+	}
+
+	if (process->window_requests == 0) {
+		raid_bdev_process_window_done(process);
+	}
+}
+
+static void
+_raid_bdev_process_window_submit(void *ctx)
+{
+	raid_bdev_process_window_submit(ctx);
+}
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	struct raid_bdev_process *process = process_req->process;
+
+	TAILQ_INSERT_TAIL(&process->requests, process_req, link);
+
+	assert(process->window_requests > 0);
+	process->window_requests--;
+
+	if (status != 0) {
+		process->window_status = status;
+	}
+
+	raid_bdev_process_window_submit(process);
+}
+
+static void
+raid_bdev_process_window_range_locked(void *ctx, int status)
+{
+	struct raid_bdev_process *process = ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to quiesce range on raid bdev %s: %s\n",
+			    process->raid_bdev->bdev.name, spdk_strerror(-status));
+		process->status = status;
+		raid_bdev_process_thread_run(process);
+		return;
+	}
+
+	process->window_remaining = process->window_size;
+	process->window_status = 0;
+
+	raid_bdev_process_window_submit(process);
+}
+
+static void
+raid_bdev_process_thread_run(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	int rc;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (process->state == RAID_PROCESS_STATE_STOPPING || process->status != 0 ||
+	    process->window_offset == raid_bdev->bdev.blockcnt) {
+		raid_bdev_process_finish(process);
+		return;
+	}
+
+	process->window_size = spdk_min(process->max_window_size,
+					 raid_bdev->bdev.blockcnt - process->window_offset);
+	process->window_start_tsc = spdk_get_ticks();
+
+	rc = spdk_bdev_quiesce_range(&raid_bdev->bdev, &g_raid_if, process->window_offset,
+				     process->window_size, raid_bdev_process_window_range_locked, process);
+	if (rc != 0) {
+		raid_bdev_process_window_range_locked(process, rc);
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_process_stop stops a running process. The current window is finished
+ * first. The optional cb_fn is called when the process is finished.
+ */
+static void
+raid_bdev_process_stop(struct raid_bdev_process *process, void (*cb_fn)(void *ctx), void *cb_ctx)
+{
+	assert(process->state != RAID_PROCESS_STATE_STOPPED);
+
+	if (cb_fn != NULL) {
+		assert(process->stop_cb == NULL);
+		process->stop_cb = cb_fn;
+		process->stop_cb_ctx = cb_ctx;
+	}
+
+	if (process->state == RAID_PROCESS_STATE_STOPPING) {
+		return;
+	}
+
+	SPDK_NOTICELOG("Stopping rebuild on raid bdev %s\n", process->raid_bdev->bdev.name);
+
+	process->state = RAID_PROCESS_STATE_STOPPING;
+	if (process->status == 0) {
+		process->status = -ECANCELED;
+	}
+
+	if (process->throttle_poller != NULL) {
+		spdk_poller_unregister(&process->throttle_poller);
+		raid_bdev_process_thread_run(process);
+	}
+}
+
+static void
+raid_bdev_process_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+			   void *event_ctx)
+{
+	struct raid_bdev_process *process = event_ctx;
+
+	if (type == SPDK_BDEV_EVENT_REMOVE && process->state != RAID_PROCESS_STATE_STOPPED) {
+		raid_bdev_process_stop(process, NULL, NULL);
+	}
+}
+
+static void
+raid_bdev_channels_process_setup_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch;
+
+	if (status != 0 && process->status == 0) {
+		process->status = status;
+	}
+
+	if (process->state == RAID_PROCESS_STATE_INIT) {
+		process->state = RAID_PROCESS_STATE_RUNNING;
+	}
+
+	if (process->status == 0) {
+		process->raid_ch_ref = spdk_get_io_channel(raid_bdev);
+		if (process->raid_ch_ref == NULL) {
+			process->status = -ENOMEM;
+		} else {
+			raid_ch = spdk_io_channel_get_ctx(process->raid_ch_ref);
+			process->raid_ch = raid_ch->process.ch_processed;
+			assert(process->raid_ch != NULL);
+		}
+	}
+
+	raid_bdev_process_thread_run(process);
+}
+
+static void
+raid_bdev_channel_process_setup(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	int rc = 0;
+
+	spdk_spin_lock(&process->raid_bdev->base_bdev_lock);
+	if (raid_ch->process.ch_processed == NULL) {
+		rc = raid_bdev_ch_process_setup(raid_ch, process);
+	}
+	spdk_spin_unlock(&process->raid_bdev->base_bdev_lock);
+
+	spdk_for_each_channel_continue(i, rc);
+}
+
+/*
+ * brief:
+ * raid_bdev_process_start starts a process allocated with raid_bdev_process_alloc()
+ * and set as raid_bdev->process. Errors are handled by the process itself, so the
+ * target is removed from the raid bdev if the process can't be started.
+ */
+static void
+raid_bdev_process_start(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	int rc;
+
+	assert(raid_bdev->process == process);
+
+	SPDK_NOTICELOG("Started rebuild on raid bdev %s from offset %" PRIu64 " to base bdev %s\n",
+		       raid_bdev->bdev.name, process->window_offset, process->target->name);
+
+	rc = raid_bdev_process_alloc_requests(process);
+	if (rc == 0) {
+		rc = spdk_bdev_open_ext(raid_bdev->bdev.name, false, raid_bdev_process_event_cb, process,
+					&process->desc);
+	}
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to start rebuild on raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-rc));
+		process->status = rc;
+	}
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_process_setup, process,
+			      raid_bdev_channels_process_setup_done);
+}
+
+static void
+raid_bdev_remove_base_bdev_on_unquiesced(void *ctx, int status)
+{
+	struct raid_base_bdev_info *base_info = ctx;
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+
+	base_info->remove_scheduled = false;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to unquiesce raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+		goto out;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	raid_bdev_free_base_bdev_resource(base_info);
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+out:
+	if (base_info->remove_cb != NULL) {
+		base_info->remove_cb(base_info->remove_cb_ctx, status);
+	}
+}
+
+static void
+raid_bdev_channel_remove_base_bdev(struct spdk_io_channel_iter *i)
+{
+	struct raid_base_bdev_info *base_info = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	uint8_t idx = base_info - base_info->raid_bdev->base_bdev_info;
+
+	SPDK_DEBUGLOG(bdev_raid, "slot: %u raid_ch: %p\n", idx, raid_ch);
+
+	if (raid_ch->base_channel[idx] != NULL) {
+		spdk_put_io_channel(raid_ch->base_channel[idx]);
+		raid_ch->base_channel[idx] = NULL;
+	}
+
+	if (raid_ch->process.ch_processed != NULL &&
+	    raid_ch->process.ch_processed->base_channel[idx] != NULL) {
+		spdk_put_io_channel(raid_ch->process.ch_processed->base_channel[idx]);
+		raid_ch->process.ch_processed->base_channel[idx] = NULL;
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+raid_bdev_channels_remove_base_bdev_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_base_bdev_info *base_info = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+
+	spdk_bdev_unquiesce(&raid_bdev->bdev, &g_raid_if, raid_bdev_remove_base_bdev_on_unquiesced,
+			    base_info);
+}
+
+static void raid_bdev_remove_base_bdev_on_quiesced(void *ctx, int status);
+
+static void
+raid_bdev_remove_base_bdev_on_process_stopped(void *ctx)
+{
+	struct raid_base_bdev_info *base_info = ctx;
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	int ret;
+
+	ret = spdk_bdev_quiesce(&raid_bdev->bdev, &g_raid_if,
+				raid_bdev_remove_base_bdev_on_quiesced, base_info);
+	if (ret != 0) {
+		raid_bdev_remove_base_bdev_on_quiesced(base_info, ret);
+	}
+}
+
+static void
+raid_bdev_remove_base_bdev_on_quiesced(void *ctx, int status)
+{
+	struct raid_base_bdev_info *base_info = ctx;
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to quiesce raid bdev %s: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+		base_info->remove_scheduled = false;
+		if (base_info->remove_cb != NULL) {
+			base_info->remove_cb(base_info->remove_cb_ctx, status);
+		}
+		return;
+	}
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_remove_base_bdev, base_info,
+			      raid_bdev_channels_remove_base_bdev_done);
+}
+
+/*
+ * brief:
+ * raid_bdev_is_process_target checks if the base bdev is being rebuilt, i.e. it
+ * is not yet operational.
+ */
+static bool
+raid_bdev_is_process_target(struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev_process *process = base_info->raid_bdev->process;
+
+	return process != NULL && process->target == base_info &&
+	       !raid_bdev_process_target_is_rebuilt(process);
+}
+
+static uint8_t
+raid_bdev_num_base_bdevs_operational(struct raid_bdev *raid_bdev)
+{
+	uint8_t num = raid_bdev->num_base_bdevs_discovered;
+	struct raid_base_bdev_info *base_info;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc != NULL && raid_bdev_is_process_target(base_info)) {
+			num--;
+		}
+	}
+
+	return num;
+}
 
 /*
  * brief:
@@ -1369,12 +2421,18 @@ raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev, raid_bdev_remove_base_bd
 			/* There is no base bdev for this raid, so free the raid device. */
 			raid_bdev_cleanup_and_free(raid_bdev);
 		}
-	} else if (raid_bdev->num_base_bdevs_discovered == raid_bdev->min_base_bdevs_operational) {
+	} else if (raid_bdev_num_base_bdevs_operational(raid_bdev) ==
+		   raid_bdev->min_base_bdevs_operational && !raid_bdev_is_process_target(base_info)) {
 		/*
 		 * After this base bdev is removed there will not be enough base bdevs
 		 * to keep the raid bdev operational.
 		 */
 		raid_bdev_deconfigure(raid_bdev, cb_fn, cb_ctx);
+	} else if (raid_bdev_is_process_target(base_info) &&
+		   raid_bdev->process->state != RAID_PROCESS_STATE_STOPPED) {
+		/* Stop rebuilding the base bdev before removing it */
+		raid_bdev_process_stop(raid_bdev->process, raid_bdev_remove_base_bdev_on_process_stopped,
+				       base_info);
 	} else {
 		int ret;
 
@@ -1509,9 +2567,8 @@ raid_bdev_delete(struct raid_bdev *raid_bdev, raid_bdev_destruct_cb cb_fn, void
 }
 
 static int
-raid_bdev_configure_base_bdev(struct raid_base_bdev_info *base_info)
+raid_bdev_claim_base_bdev(struct raid_base_bdev_info *base_info, struct spdk_bdev_desc **_desc)
 {
-	struct raid_bdev *raid_bdev = base_info->raid_bdev;
 	struct spdk_bdev_desc *desc;
 	struct spdk_bdev *bdev;
 	int rc;
@@ -1539,6 +2596,26 @@ raid_bdev_configure_base_bdev(struct raid_base_bdev_info *base_info)
 
 	SPDK_DEBUGLOG(bdev_raid, "bdev %s is claimed\n", bdev->name);
 
+	*_desc = desc;
+
+	return 0;
+}
+
+static int
+raid_bdev_configure_base_bdev(struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	struct spdk_bdev_desc *desc;
+	struct spdk_bdev *bdev;
+	int rc;
+
+	rc = raid_bdev_claim_base_bdev(base_info, &desc);
+	if (rc != 0) {
+		return rc;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(desc);
+
 	assert(raid_bdev->state != RAID_BDEV_STATE_ONLINE);
 
 	base_info->desc = desc;
@@ -1604,6 +2681,145 @@ raid_bdev_add_base_device(struct raid_bdev *raid_bdev, const char *name, uint8_t
 	return 0;
 }
 
+/*
+ * brief:
+ * raid_bdev_add_base_bdev adds a base bdev to an empty slot of an online raid
+ * bdev and starts rebuilding it in the background. The base bdev becomes
+ * operational when the rebuild is finished.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * name - name of the base bdev
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *name)
+{
+	struct raid_base_bdev_info *base_info, *iter;
+	struct raid_bdev_process *process;
+	struct spdk_bdev_desc *desc;
+	struct spdk_bdev *bdev;
+	uint64_t min_blockcnt = UINT64_MAX;
+	int rc;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (raid_bdev->state != RAID_BDEV_STATE_ONLINE || raid_bdev->destroy_started) {
+		SPDK_ERRLOG("Raid bdev '%s' is not online\n", raid_bdev->bdev.name);
+		return -EINVAL;
+	}
+
+	if (raid_bdev->module->submit_process_request == NULL) {
+		SPDK_ERRLOG("Raid level '%s' does not support rebuild\n",
+			    raid_bdev_level_to_str(raid_bdev->level));
+		return -ENOTSUP;
+	}
+
+	if (raid_bdev->process != NULL) {
+		SPDK_ERRLOG("Raid bdev '%s' already has a background process running\n",
+			    raid_bdev->bdev.name);
+		return -EBUSY;
+	}
+
+	base_info = NULL;
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, iter) {
+		if (base_info == NULL && iter->name == NULL && iter->desc == NULL) {
+			base_info = iter;
+		}
+		min_blockcnt = spdk_min(min_blockcnt, iter->blockcnt);
+	}
+
+	if (base_info == NULL) {
+		SPDK_ERRLOG("No empty slot on raid bdev '%s'\n", raid_bdev->bdev.name);
+		return -ENOSPC;
+	}
+
+	base_info->name = strdup(name);
+	if (base_info->name == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = raid_bdev_claim_base_bdev(base_info, &desc);
+	if (rc != 0) {
+		goto err;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(desc);
+
+	if (bdev->blocklen != raid_bdev->bdev.blocklen ||
+	    spdk_bdev_get_md_size(bdev) != raid_bdev->bdev.md_len ||
+	    spdk_bdev_is_md_interleaved(bdev) != raid_bdev->bdev.md_interleave ||
+	    spdk_bdev_get_dif_type(bdev) != raid_bdev->bdev.dif_type) {
+		SPDK_ERRLOG("Base bdev '%s' has a different block format than raid bdev '%s'\n",
+			    name, raid_bdev->bdev.name);
+		rc = -EINVAL;
+		goto err_release;
+	}
+
+	if (bdev->blockcnt < min_blockcnt) {
+		SPDK_ERRLOG("Base bdev '%s' is too small\n", name);
+		rc = -EINVAL;
+		goto err_release;
+	}
+
+	process = raid_bdev_process_alloc(raid_bdev, base_info, 0);
+	if (process == NULL) {
+		rc = -ENOMEM;
+		goto err_release;
+	}
+
+	spdk_spin_lock(&raid_bdev->base_bdev_lock);
+	raid_bdev->process = process;
+	base_info->desc = desc;
+	base_info->blockcnt = bdev->blockcnt;
+	raid_bdev->num_base_bdevs_discovered++;
+	spdk_spin_unlock(&raid_bdev->base_bdev_lock);
+	assert(raid_bdev->num_base_bdevs_discovered <= raid_bdev->num_base_bdevs);
+
+	raid_bdev_process_start(process);
+
+	return 0;
+err_release:
+	spdk_bdev_module_release_bdev(bdev);
+	spdk_bdev_close(desc);
+err:
+	free(base_info->name);
+	base_info->name = NULL;
+	return rc;
+}
+
+/*
+ * brief:
+ * raid_bdev_set_rebuild_checkpoint sets the base bdev to be rebuilt when the raid
+ * bdev is configured, and the offset to resume the rebuild from. Blocks below the
+ * offset are expected to be already rebuilt.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * slot - slot of the base bdev to rebuild
+ * offset_blocks - offset to start the rebuild from
+ * returns:
+ * 0 - success
+ * non zero - failure
+ */
+int
+raid_bdev_set_rebuild_checkpoint(struct raid_bdev *raid_bdev, uint8_t slot,
+				 uint64_t offset_blocks)
+{
+	if (raid_bdev->state != RAID_BDEV_STATE_CONFIGURING || slot >= raid_bdev->num_base_bdevs) {
+		return -EINVAL;
+	}
+
+	if (raid_bdev->module->submit_process_request == NULL) {
+		return -ENOTSUP;
+	}
+
+	raid_bdev->rebuild_checkpoint.target = &raid_bdev->base_bdev_info[slot];
+	raid_bdev->rebuild_checkpoint.offset = offset_blocks;
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_examine function is the examine function call by the below layers
@@ -17,6 +17,26 @@ enum raid_level {
 	CONCAT			= 99,
 };
 
+/*
+ * Read policy determines how reads are distributed among the base bdevs of
+ * a raid level that keeps full copies of the data (raid1).
+ */
+enum raid_read_policy {
+	INVALID_RAID_READ_POLICY		= -1,
+
+	/* Read from the base bdev with the fewest outstanding reads on the channel */
+	RAID_READ_POLICY_LEAST_OUTSTANDING	= 0,
+
+	/* Rotate reads across all base bdevs */
+	RAID_READ_POLICY_ROUND_ROBIN		= 1,
+
+	/*
+	 * Keep reads that continue a sequential stream on the base bdev serving
+	 * the stream, otherwise behave as least outstanding.
+	 */
+	RAID_READ_POLICY_SEQUENTIAL		= 2,
+};
+
 /*
  * Raid state describes the state of the raid. This raid bdev can be either in
  * configured list or configuring list
@@ -43,6 +63,15 @@ enum raid_bdev_state {
 
 typedef void (*raid_bdev_remove_base_bdev_cb)(void *ctx, int status);
 
+/* Global options of the raid bdev module */
+struct raid_bdev_opts {
+	/* Size of the range of a raid bdev processed at a time by a background process */
+	uint32_t process_window_size_kb;
+
+	/* Bandwidth limit of a background process, 0 means unlimited */
+	uint32_t process_max_bandwidth_mb_sec;
+};
+
 /*
  * raid_base_bdev_info contains information for the base bdevs which are part of some
  * raid. This structure contains the per base bdev information. Whatever is
@@ -143,6 +172,9 @@ struct raid_bdev {
 	/* Raid Level of this raid bdev */
 	enum raid_level			level;
 
+	/* Policy for distributing reads among base bdevs */
+	enum raid_read_policy		read_policy;
+
 	/* Set to true if destroy of this raid bdev is started. */
 	bool				destroy_started;
 
@@ -151,6 +183,21 @@ struct raid_bdev {
 
 	/* Private data for the raid module */
 	void				*module_private;
+
+	/*
+	 * Granularity in blocks of the ranges processed by a background process,
+	 * may be set by the module in start(). 0 is equivalent to 1.
+	 */
+	uint32_t			process_granularity;
+
+	/* Background process (rebuild) running on this raid bdev */
+	struct raid_bdev_process	*process;
+
+	/* Rebuild to start when the raid bdev is configured, restored from the config */
+	struct {
+		struct raid_base_bdev_info	*target;
+		uint64_t			offset;
+	} rebuild_checkpoint;
 };
 
 #define RAID_FOR_EACH_BASE_BDEV(r, i) \
@@ -169,6 +216,50 @@ struct raid_bdev_io_channel {
 
 	/* Private raid module IO channel */
 	struct spdk_io_channel	*module_channel;
+
+	/* State of a background process running on the raid bdev */
+	struct {
+		/*
+		 * Blocks below this offset have already been processed and are accessed
+		 * through ch_processed, which also includes the process target.
+		 */
+		uint64_t			offset;
+
+		/* Channel used for the already processed range */
+		struct raid_bdev_io_channel	*ch_processed;
+	} process;
+};
+
+/*
+ * raid_bdev_process_request describes a range of a raid bdev that a raid module
+ * processes in the background, e.g. rebuilds onto the target base bdev.
+ */
+struct raid_bdev_process_request {
+	/* The background process that this request belongs to */
+	struct raid_bdev_process	*process;
+
+	/* The base bdev being rebuilt */
+	struct raid_base_bdev_info	*target;
+
+	/* IO channel of the target base bdev */
+	struct spdk_io_channel		*target_ch;
+
+	/* Offset of the range in blocks of the raid bdev */
+	uint64_t			offset_blocks;
+
+	/* Length of the range in blocks of the raid bdev */
+	uint32_t			num_blocks;
+
+	/* Buffer for the data of the range */
+	struct iovec			iov;
+
+	/* Buffer for the io metadata of the range, NULL if the raid bdev has no separate metadata */
+	void				*md_buf;
+
+	/* WaitQ entry, may be used by the module to retry submitting base bdev I/O */
+	struct spdk_bdev_io_wait_entry	waitq_entry;
+
+	TAILQ_ENTRY(raid_bdev_process_request) link;
 };
 
 /* TAIL head for raid bdev list */
@@ -179,7 +270,8 @@ extern struct raid_all_tailq		g_raid_bdev_list;
 typedef void (*raid_bdev_destruct_cb)(void *cb_ctx, int rc);
 
 int raid_bdev_create(const char *name, uint32_t strip_size, uint8_t num_base_bdevs,
-		     enum raid_level level, struct raid_bdev **raid_bdev_out, const struct spdk_uuid *uuid);
+		     enum raid_level level, enum raid_read_policy read_policy,
+		     struct raid_bdev **raid_bdev_out, const struct spdk_uuid *uuid);
 void raid_bdev_delete(struct raid_bdev *raid_bdev, raid_bdev_destruct_cb cb_fn, void *cb_ctx);
 int raid_bdev_add_base_device(struct raid_bdev *raid_bdev, const char *name, uint8_t slot);
 struct raid_bdev *raid_bdev_find_by_name(const char *name);
@@ -187,9 +279,16 @@ enum raid_level raid_bdev_str_to_level(const char *str);
 const char *raid_bdev_level_to_str(enum raid_level level);
 enum raid_bdev_state raid_bdev_str_to_state(const char *str);
 const char *raid_bdev_state_to_str(enum raid_bdev_state state);
+enum raid_read_policy raid_bdev_str_to_read_policy(const char *str);
+const char *raid_bdev_read_policy_to_str(enum raid_read_policy read_policy);
 void raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
 int raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev, raid_bdev_remove_base_bdev_cb cb_fn,
 			       void *cb_ctx);
+int raid_bdev_add_base_bdev(struct raid_bdev *raid_bdev, const char *name);
+int raid_bdev_set_rebuild_checkpoint(struct raid_bdev *raid_bdev, uint8_t slot,
+				     uint64_t offset_blocks);
+void raid_bdev_get_opts(struct raid_bdev_opts *opts);
+int raid_bdev_set_opts(const struct raid_bdev_opts *opts);
 
 /*
  * RAID module descriptor
@@ -254,6 +353,19 @@ struct raid_bdev_module {
 	 */
 	void (*resize)(struct raid_bdev *raid_bdev);
 
+	/*
+	 * Handler for background process requests, used to rebuild a base bdev
+	 * added to an online raid bdev. The module should process a part of the
+	 * request's range starting at its offset, using raid_ch which includes the
+	 * target base bdev's channel, and return the number of blocks it is going
+	 * to process or a negative errno. When done, the module must call
+	 * raid_bdev_process_request_complete(), but not from within this function.
+	 * The processed range is quiesced for foreground I/O. Optional, rebuild is
+	 * not supported without it.
+	 */
+	int (*submit_process_request)(struct raid_bdev_process_request *process_req,
+				      struct raid_bdev_io_channel *raid_ch);
+
 	TAILQ_ENTRY(raid_bdev_module) link;
 };
 
@@ -275,5 +387,6 @@ void raid_bdev_queue_io_wait(struct raid_bdev_io *raid_io, struct spdk_bdev *bde
 			     struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn);
 void raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status);
 void raid_bdev_module_stop_done(struct raid_bdev *raid_bdev);
+void raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status);
 
 #endif /* SPDK_BDEV_RAID_INTERNAL_H */
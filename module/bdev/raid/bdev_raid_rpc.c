@@ -125,11 +125,20 @@ struct rpc_bdev_raid_create {
 	/* RAID raid level */
 	enum raid_level                      level;
 
+	/* RAID read policy */
+	enum raid_read_policy                read_policy;
+
 	/* Base bdevs information */
 	struct rpc_bdev_raid_create_base_bdevs base_bdevs;
 
 	/* UUID for this raid bdev */
 	char *uuid;
+
+	/* Base bdev being rebuilt, if any */
+	char *rebuild_base_bdev;
+
+	/* Offset to resume the rebuild from */
+	uint64_t rebuild_offset;
 };
 
 /*
@@ -147,6 +156,7 @@ free_rpc_bdev_raid_create(struct rpc_bdev_raid_create *req)
 
 	free(req->name);
 	free(req->uuid);
+	free(req->rebuild_base_bdev);
 	for (i = 0; i < req->base_bdevs.num_base_bdevs; i++) {
 		free(req->base_bdevs.base_bdevs[i]);
 	}
@@ -176,6 +186,30 @@ decode_raid_level(const struct spdk_json_val *val, void *out)
 	return ret;
 }
 
+/*
+ * Decoder function for RPC bdev_raid_create to decode read policy
+ */
+static int
+decode_read_policy(const struct spdk_json_val *val, void *out)
+{
+	int ret;
+	char *str = NULL;
+	enum raid_read_policy read_policy;
+
+	ret = spdk_json_decode_string(val, &str);
+	if (ret == 0 && str != NULL) {
+		read_policy = raid_bdev_str_to_read_policy(str);
+		if (read_policy == INVALID_RAID_READ_POLICY) {
+			ret = -EINVAL;
+		} else {
+			*(enum raid_read_policy *)out = read_policy;
+		}
+	}
+
+	free(str);
+	return ret;
+}
+
 /*
  * Decoder function for RPC bdev_raid_create to decode base bdevs list
  */
@@ -196,12 +230,16 @@ static const struct spdk_json_object_decoder rpc_bdev_raid_create_decoders[] = {
 	{"raid_level", offsetof(struct rpc_bdev_raid_create, level), decode_raid_level},
 	{"base_bdevs", offsetof(struct rpc_bdev_raid_create, base_bdevs), decode_base_bdevs},
 	{"uuid", offsetof(struct rpc_bdev_raid_create, uuid), spdk_json_decode_string, true},
+	{"read_policy", offsetof(struct rpc_bdev_raid_create, read_policy), decode_read_policy, true},
+	{"rebuild_base_bdev", offsetof(struct rpc_bdev_raid_create, rebuild_base_bdev), spdk_json_decode_string, true},
+	{"rebuild_offset", offsetof(struct rpc_bdev_raid_create, rebuild_offset), spdk_json_decode_uint64, true},
 };
 
 /*
  * brief:
  * rpc_bdev_raid_create function is the RPC for creating RAID bdevs. It takes
- * input as raid bdev name, raid level, strip size in KB and list of base bdev names.
+ * input as raid bdev name, raid level, strip size in KB, optional read policy
+ * and list of base bdev names.
  * params:
  * request - pointer to json rpc request
  * params - pointer to request parameters
@@ -236,8 +274,21 @@ rpc_bdev_raid_create(struct spdk_jsonrpc_request *request,
 		uuid = &decoded_uuid;
 	}
 
+	if (req.rebuild_base_bdev) {
+		for (i = 0; i < req.base_bdevs.num_base_bdevs; i++) {
+			if (strcmp(req.base_bdevs.base_bdevs[i], req.rebuild_base_bdev) == 0) {
+				break;
+			}
+		}
+		if (i == req.base_bdevs.num_base_bdevs) {
+			spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+							 "Rebuild base bdev is not in the base bdevs list");
+			goto cleanup;
+		}
+	}
+
 	rc = raid_bdev_create(req.name, req.strip_size_kb, req.base_bdevs.num_base_bdevs,
-			      req.level, &raid_bdev, uuid);
+			      req.level, req.read_policy, &raid_bdev, uuid);
 	if (rc != 0) {
 		spdk_jsonrpc_send_error_response_fmt(request, rc,
 						     "Failed to create RAID bdev %s: %s",
@@ -245,6 +296,17 @@ rpc_bdev_raid_create(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
+	if (req.rebuild_base_bdev) {
+		rc = raid_bdev_set_rebuild_checkpoint(raid_bdev, i, req.rebuild_offset);
+		if (rc != 0) {
+			raid_bdev_delete(raid_bdev, NULL, NULL);
+			spdk_jsonrpc_send_error_response_fmt(request, rc,
+							     "Failed to resume rebuild on RAID bdev %s: %s",
+							     req.name, spdk_strerror(-rc));
+			goto cleanup;
+		}
+	}
+
 	for (i = 0; i < req.base_bdevs.num_base_bdevs; i++) {
 		const char *base_bdev_name = req.base_bdevs.base_bdevs[i];
 
@@ -451,3 +513,124 @@ err:
 	rpc_bdev_raid_remove_base_bdev_done(request, rc);
 }
 SPDK_RPC_REGISTER("bdev_raid_remove_base_bdev", rpc_bdev_raid_remove_base_bdev, SPDK_RPC_RUNTIME)
+
+/*
+ * Input structure for RPC bdev_raid_add_base_bdev
+ */
+struct rpc_bdev_raid_add_base_bdev {
+	/* Raid bdev name */
+	char *raid_bdev;
+
+	/* Base bdev name */
+	char *base_bdev;
+};
+
+static void
+free_rpc_bdev_raid_add_base_bdev(struct rpc_bdev_raid_add_base_bdev *req)
+{
+	free(req->raid_bdev);
+	free(req->base_bdev);
+}
+
+/*
+ * Decoder object for RPC bdev_raid_add_base_bdev
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_add_base_bdev_decoders[] = {
+	{"raid_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, raid_bdev), spdk_json_decode_string},
+	{"base_bdev", offsetof(struct rpc_bdev_raid_add_base_bdev, base_bdev), spdk_json_decode_string},
+};
+
+/*
+ * brief:
+ * bdev_raid_add_base_bdev function is the RPC for adding a base bdev to an online
+ * raid bdev. The base bdev is rebuilt in the background.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_add_base_bdev(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_raid_add_base_bdev req = {};
+	struct raid_bdev *raid_bdev;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_raid_add_base_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_raid_add_base_bdev_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	raid_bdev = raid_bdev_find_by_name(req.raid_bdev);
+	if (raid_bdev == NULL) {
+		spdk_jsonrpc_send_error_response_fmt(request, -ENODEV,
+						     "raid bdev %s not found",
+						     req.raid_bdev);
+		goto cleanup;
+	}
+
+	rc = raid_bdev_add_base_bdev(raid_bdev, req.base_bdev);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, rc,
+						     "Failed to add base bdev %s to RAID bdev %s: %s",
+						     req.base_bdev, req.raid_bdev,
+						     spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_raid_add_base_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_raid_add_base_bdev", rpc_bdev_raid_add_base_bdev, SPDK_RPC_RUNTIME)
+
+/*
+ * Decoder object for RPC bdev_raid_set_options
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_set_options_decoders[] = {
+	{"process_window_size_kb", offsetof(struct raid_bdev_opts, process_window_size_kb), spdk_json_decode_uint32, true},
+	{"process_max_bandwidth_mb_sec", offsetof(struct raid_bdev_opts, process_max_bandwidth_mb_sec), spdk_json_decode_uint32, true},
+};
+
+/*
+ * brief:
+ * bdev_raid_set_options function is the RPC for setting the options of raid
+ * bdev background processes.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct raid_bdev_opts opts;
+	int rc;
+
+	raid_bdev_get_opts(&opts);
+	if (params && spdk_json_decode_object(params, rpc_bdev_raid_set_options_decoders,
+					      SPDK_COUNTOF(rpc_bdev_raid_set_options_decoders),
+					      &opts)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	rc = raid_bdev_set_opts(&opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+SPDK_RPC_REGISTER("bdev_raid_set_options", rpc_bdev_raid_set_options,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
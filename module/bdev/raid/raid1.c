@@ -7,12 +7,36 @@
 
 #include "spdk/likely.h"
 #include "spdk/log.h"
+#include "spdk/thread.h"
+
+/*
+ * With the sequential read policy a read continuing a stream stays on the base
+ * bdev serving that stream unless it has this many more outstanding reads than
+ * the least loaded base bdev.
+ */
+#define RAID1_SEQUENTIAL_MAX_OUTSTANDING_DELTA 8
 
 struct raid1_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
 };
 
+struct raid1_base_read_state {
+	/* Number of reads submitted to the base bdev and not completed yet */
+	uint64_t reads_outstanding;
+
+	/* Offset of the block following the last read submitted to the base bdev */
+	uint64_t next_read_offset;
+};
+
+struct raid1_io_channel {
+	/* Base bdev index to start looking for the next read target from */
+	uint8_t next_read_idx;
+
+	/* Per base bdev read state on this channel */
+	struct raid1_base_read_state base[0];
+};
+
 static void
 raid1_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -25,6 +49,18 @@ raid1_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_ar
 				   SPDK_BDEV_IO_STATUS_FAILED);
 }
 
+static void
+raid1_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+	struct raid1_base_read_state *read_state = raid_io->module_private;
+
+	assert(read_state->reads_outstanding > 0);
+	read_state->reads_outstanding--;
+
+	raid1_bdev_io_completion(bdev_io, success, cb_arg);
+}
+
 static void raid1_submit_rw_request(struct raid_bdev_io *raid_io);
 
 static void
@@ -45,44 +81,89 @@ raid1_init_ext_io_opts(struct spdk_bdev_io *bdev_io, struct spdk_bdev_ext_io_opt
 	opts->metadata = bdev_io->u.bdev.md_buf;
 }
 
+static uint8_t
+raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				  uint64_t offset_blocks)
+{
+	struct raid1_io_channel *r1ch = spdk_io_channel_get_ctx(raid_ch->module_channel);
+	uint64_t min_outstanding = UINT64_MAX;
+	uint8_t idx = UINT8_MAX;
+	uint8_t seq_idx = UINT8_MAX;
+	uint8_t i, j;
+
+	for (j = 0; j < raid_bdev->num_base_bdevs; j++) {
+		i = (r1ch->next_read_idx + j) % raid_bdev->num_base_bdevs;
+
+		if (raid_ch->base_channel[i] == NULL) {
+			continue;
+		}
+
+		if (raid_bdev->read_policy == RAID_READ_POLICY_ROUND_ROBIN) {
+			idx = i;
+			break;
+		}
+
+		if (r1ch->base[i].reads_outstanding < min_outstanding) {
+			min_outstanding = r1ch->base[i].reads_outstanding;
+			idx = i;
+		}
+
+		if (seq_idx == UINT8_MAX && r1ch->base[i].next_read_offset == offset_blocks) {
+			seq_idx = i;
+		}
+	}
+
+	if (raid_bdev->read_policy == RAID_READ_POLICY_SEQUENTIAL && seq_idx != UINT8_MAX &&
+	    r1ch->base[seq_idx].reads_outstanding <= min_outstanding +
+	    RAID1_SEQUENTIAL_MAX_OUTSTANDING_DELTA) {
+		idx = seq_idx;
+	}
+
+	if (idx != UINT8_MAX) {
+		r1ch->next_read_idx = (idx + 1) % raid_bdev->num_base_bdevs;
+	}
+
+	return idx;
+}
+
 static int
 raid1_submit_read_request(struct raid_bdev_io *raid_io)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
 	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid1_io_channel *r1ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
 	struct spdk_bdev_ext_io_opts io_opts;
-	uint8_t idx = 0;
 	struct raid_base_bdev_info *base_info;
-	struct spdk_io_channel *base_ch = NULL;
+	struct spdk_io_channel *base_ch;
 	uint64_t pd_lba, pd_blocks;
+	uint8_t idx;
 	int ret;
 
-	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
-		base_ch = raid_io->raid_ch->base_channel[idx];
-		if (base_ch != NULL) {
-			break;
-		}
-		idx++;
-	}
+	pd_lba = bdev_io->u.bdev.offset_blocks;
+	pd_blocks = bdev_io->u.bdev.num_blocks;
 
-	if (base_ch == NULL) {
+	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_io->raid_ch, pd_lba);
+	if (spdk_unlikely(idx == UINT8_MAX)) {
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 		return 0;
 	}
 
-	pd_lba = bdev_io->u.bdev.offset_blocks;
-	pd_blocks = bdev_io->u.bdev.num_blocks;
+	base_info = &raid_bdev->base_bdev_info[idx];
+	base_ch = raid_io->raid_ch->base_channel[idx];
 
 	raid_io->base_bdev_io_remaining = 1;
+	raid_io->module_private = &r1ch->base[idx];
 
 	raid1_init_ext_io_opts(bdev_io, &io_opts);
 	ret = spdk_bdev_readv_blocks_ext(base_info->desc, base_ch,
 					 bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
-					 pd_lba, pd_blocks, raid1_bdev_io_completion,
+					 pd_lba, pd_blocks, raid1_read_bdev_io_completion,
 					 raid_io, &io_opts);
 
 	if (spdk_likely(ret == 0)) {
 		raid_io->base_bdev_io_submitted++;
+		r1ch->base[idx].reads_outstanding++;
+		r1ch->base[idx].next_read_offset = pd_lba + pd_blocks;
 	} else if (spdk_unlikely(ret == -ENOMEM)) {
 		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
 					base_ch, _raid1_submit_rw_request);
@@ -175,6 +256,108 @@ raid1_submit_rw_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+static void
+raid1_process_write_completed(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_process_request *process_req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid_bdev_process_request_complete(process_req, success ? 0 : -EIO);
+}
+
+static void raid1_process_submit_write(struct raid_bdev_process_request *process_req);
+
+static void
+_raid1_process_submit_write(void *ctx)
+{
+	struct raid_bdev_process_request *process_req = ctx;
+
+	raid1_process_submit_write(process_req);
+}
+
+static void
+raid1_process_submit_write(struct raid_bdev_process_request *process_req)
+{
+	struct raid_base_bdev_info *target = process_req->target;
+	int ret;
+
+	ret = spdk_bdev_writev_blocks_with_md(target->desc, process_req->target_ch,
+					      &process_req->iov, 1, process_req->md_buf,
+					      process_req->offset_blocks, process_req->num_blocks,
+					      raid1_process_write_completed, process_req);
+	if (spdk_unlikely(ret != 0)) {
+		if (ret == -ENOMEM) {
+			process_req->waitq_entry.bdev = spdk_bdev_desc_get_bdev(target->desc);
+			process_req->waitq_entry.cb_fn = _raid1_process_submit_write;
+			process_req->waitq_entry.cb_arg = process_req;
+			spdk_bdev_queue_io_wait(process_req->waitq_entry.bdev, process_req->target_ch,
+						&process_req->waitq_entry);
+			return;
+		}
+
+		raid_bdev_process_request_complete(process_req, ret);
+	}
+}
+
+static void
+raid1_process_read_completed(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_process_request *process_req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		raid_bdev_process_request_complete(process_req, -EIO);
+		return;
+	}
+
+	raid1_process_submit_write(process_req);
+}
+
+static int
+raid1_submit_process_request(struct raid_bdev_process_request *process_req,
+			     struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev *raid_bdev = process_req->target->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+	int ret;
+
+	/* Copy the range from the first operational base bdev to the target */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+		if (base_info != process_req->target && raid_ch->base_channel[i] != NULL) {
+			break;
+		}
+	}
+
+	if (i == raid_bdev->num_base_bdevs) {
+		return -ENODEV;
+	}
+
+	ret = spdk_bdev_readv_blocks_with_md(base_info->desc, raid_ch->base_channel[i],
+					     &process_req->iov, 1, process_req->md_buf,
+					     process_req->offset_blocks, process_req->num_blocks,
+					     raid1_process_read_completed, process_req);
+	if (ret != 0) {
+		return ret;
+	}
+
+	return process_req->num_blocks;
+}
+
+static int
+raid1_ioch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+raid1_ioch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
 static int
 raid1_start(struct raid_bdev *raid_bdev)
 {
@@ -196,17 +379,40 @@ raid1_start(struct raid_bdev *raid_bdev)
 	raid_bdev->bdev.blockcnt = min_blockcnt;
 	raid_bdev->module_private = r1info;
 
+	spdk_io_device_register(r1info, raid1_ioch_create, raid1_ioch_destroy,
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(struct raid1_base_read_state),
+				NULL);
+
 	return 0;
 }
 
+static void
+raid1_io_device_unregister_done(void *io_device)
+{
+	struct raid1_info *r1info = io_device;
+
+	raid_bdev_module_stop_done(r1info->raid_bdev);
+
+	free(r1info);
+}
+
 static bool
 raid1_stop(struct raid_bdev *raid_bdev)
 {
 	struct raid1_info *r1info = raid_bdev->module_private;
 
-	free(r1info);
+	spdk_io_device_unregister(r1info, raid1_io_device_unregister_done);
+
+	return false;
+}
+
+static struct spdk_io_channel *
+raid1_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid1_info *r1info = raid_bdev->module_private;
 
-	return true;
+	return spdk_get_io_channel(r1info);
 }
 
 static struct raid_bdev_module g_raid1_module = {
@@ -217,6 +423,8 @@ static struct raid_bdev_module g_raid1_module = {
 	.start = raid1_start,
 	.stop = raid1_stop,
 	.submit_rw_request = raid1_submit_rw_request,
+	.get_io_channel = raid1_get_io_channel,
+	.submit_process_request = raid1_submit_process_request,
 };
 RAID_MODULE_REGISTER(&g_raid1_module)
 
@@ -16,6 +16,18 @@
 /* Maximum concurrent full stripe writes per io channel */
 #define RAID5F_MAX_STRIPES 32
 
+/* Maximum concurrent degraded reads (chunk reconstructions) per io channel */
+#define RAID5F_MAX_RECONSTRUCT_STRIPES 8
+
+/* Maximum concurrent partial stripe writes per io channel */
+#define RAID5F_MAX_PARTIAL_STRIPES 8
+
+/* Number of stripes per io channel for which chunk writes can be merged */
+#define RAID5F_STRIPE_CACHE_SIZE 4
+
+/* Number of buckets in the table of locked stripes */
+#define RAID5F_STRIPE_LOCK_BUCKETS 1024
+
 struct chunk {
 	/* Corresponds to base_bdev index */
 	uint8_t index;
@@ -32,6 +44,9 @@ struct chunk {
 	/* Pointer to buffer with I/O metadata */
 	void *md_buf;
 
+	/* The raid_bdev_io providing data for this chunk (writes only) */
+	struct raid_bdev_io *raid_io;
+
 	/* Shallow copy of IO request parameters */
 	struct spdk_bdev_ext_io_opts ext_opts;
 };
@@ -42,6 +57,8 @@ typedef void (*stripe_req_xor_cb)(struct stripe_request *stripe_req, int status)
 struct stripe_request {
 	enum stripe_request_type {
 		STRIPE_REQ_WRITE,
+		STRIPE_REQ_RECONSTRUCT,
+		STRIPE_REQ_PARTIAL_WRITE,
 	} type;
 
 	struct raid5f_io_channel *r5ch;
@@ -63,6 +80,68 @@ struct stripe_request {
 			/* Buffer for stripe io metadata parity */
 			void *parity_md_buf;
 		} write;
+		struct {
+			/* The chunk being reconstructed */
+			struct chunk *chunk;
+
+			/* Offset of the reconstructed range within the chunk */
+			uint64_t chunk_offset;
+
+			/* Length of the reconstructed range in blocks */
+			uint64_t chunk_len;
+
+			/* Buffer for the reads from the remaining chunks, strip_size per chunk */
+			void *chunk_buffers;
+
+			/* Buffer for io metadata of the reads from the remaining chunks */
+			void *chunk_md_buffers;
+
+			/* State of rebuilding a stripe for a background process request */
+			struct {
+				/* The process request, NULL if reconstructing for a raid_bdev_io */
+				struct raid_bdev_process_request *req;
+
+				/* The raid bdev io channel of the process */
+				struct raid_bdev_io_channel *raid_ch;
+
+				/* Index of the next chunk to read */
+				uint8_t next_chunk;
+
+				/* Number of chunk reads not completed yet */
+				uint8_t remaining;
+
+				/* Status of the chunk reads */
+				int status;
+			} process;
+		} reconstruct;
+		struct {
+			/* Calculate parity from all data chunks instead of updating the old parity */
+			bool rcw;
+
+			/* Set when the old data has been read and the new parity calculated */
+			bool reads_done;
+
+			/* Offset of the written range within the chunks */
+			uint64_t chunk_offset;
+
+			/* Length of the written range in blocks */
+			uint64_t chunk_len;
+
+			/* Buffer for the old data of the chunks, strip_size per chunk */
+			void *chunk_buffers;
+
+			/* Buffer for the old io metadata of the chunks */
+			void *chunk_md_buffers;
+
+			/* Array of iovecs describing chunk_buffers, one per chunk */
+			struct iovec *chunk_buffer_iovs;
+
+			/* Buffer for the new stripe parity */
+			void *parity_buf;
+
+			/* Buffer for the new stripe io metadata parity */
+			void *parity_md_buf;
+		} partial;
 	};
 
 	/* Array of iovec iterators for each chunk */
@@ -78,16 +157,33 @@ struct stripe_request {
 		size_t len;
 		size_t remaining;
 		size_t remaining_md;
+		uint8_t n_src;
 		int status;
 		stripe_req_xor_cb cb;
 	} xor;
 
 	TAILQ_ENTRY(stripe_request) link;
 
+	/* Link in the table of locked stripes or in the queue of requests waiting for a lock */
+	TAILQ_ENTRY(stripe_request) lock_link;
+
 	/* Array of chunks corresponding to base_bdevs */
 	struct chunk chunks[0];
 };
 
+struct raid5f_cached_stripe {
+	/* The stripe's index in the raid array */
+	uint64_t stripe_index;
+
+	/* Number of data chunks with a pending write */
+	uint8_t num_chunks;
+
+	/* Pending full chunk writes, indexed by data chunk */
+	struct raid_bdev_io **raid_ios;
+
+	TAILQ_ENTRY(raid5f_cached_stripe) link;
+};
+
 struct raid5f_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
@@ -100,14 +196,35 @@ struct raid5f_info {
 
 	/* Alignment for buffer allocation */
 	size_t buf_alignment;
+
+	/* Protects the table of locked stripes */
+	struct spdk_spinlock stripe_lock;
+
+	/* Stripe requests in progress on all io channels, hashed by stripe index */
+	struct {
+		TAILQ_HEAD(, stripe_request) locked;
+
+		/* Stripe requests waiting for their stripe to be unlocked */
+		TAILQ_HEAD(, stripe_request) waiting;
+	} locked_stripes[RAID5F_STRIPE_LOCK_BUCKETS];
 };
 
 struct raid5f_io_channel {
 	/* All available stripe requests on this channel */
 	struct {
 		TAILQ_HEAD(, stripe_request) write;
+		TAILQ_HEAD(, stripe_request) reconstruct;
+		TAILQ_HEAD(, stripe_request) partial_write;
 	} free_stripe_requests;
 
+	/* Chunk writes held back to be merged into full stripe writes */
+	struct {
+		struct raid5f_cached_stripe entries[RAID5F_STRIPE_CACHE_SIZE];
+		TAILQ_HEAD(, raid5f_cached_stripe) free;
+		TAILQ_HEAD(, raid5f_cached_stripe) active;
+		bool flush_pending;
+	} stripe_cache;
+
 	/* accel_fw channel */
 	struct spdk_io_channel *accel_ch;
 
@@ -118,6 +235,9 @@ struct raid5f_io_channel {
 	void **chunk_xor_buffers;
 	struct iovec **chunk_xor_iovs;
 	size_t *chunk_xor_iovcnt;
+
+	/* For passing the written data chunks when submitting a write */
+	struct raid_bdev_io **chunk_raid_ios;
 };
 
 #define __CHUNK_IN_RANGE(req, c) \
@@ -160,14 +280,211 @@ raid5f_stripe_parity_chunk_index(const struct raid_bdev *raid_bdev, uint64_t str
 	return raid5f_stripe_data_chunks_num(raid_bdev) - stripe_index % raid_bdev->num_base_bdevs;
 }
 
+static inline void *
+raid5f_partial_chunk_md_buf(struct stripe_request *stripe_req, struct chunk *chunk)
+{
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(stripe_req->r5ch)->raid_bdev;
+
+	if (stripe_req->partial.chunk_md_buffers == NULL) {
+		return NULL;
+	}
+
+	return stripe_req->partial.chunk_md_buffers +
+	       chunk->index * raid_bdev->strip_size * spdk_bdev_get_md_size(&raid_bdev->bdev);
+}
+
+static void raid5f_stripe_request_start(struct stripe_request *stripe_req);
+
+/*
+ * Stripe requests modifying a stripe or depending on its parity are serialized across
+ * all io channels of the raid bdev. A request for a stripe that is already locked waits
+ * until the current holder releases the stripe and is then started on its own thread.
+ */
+static bool
+raid5f_stripe_lock(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	uint64_t bucket = stripe_req->stripe_index % RAID5F_STRIPE_LOCK_BUCKETS;
+	struct stripe_request *locked;
+	bool ret = true;
+
+	spdk_spin_lock(&r5f_info->stripe_lock);
+
+	TAILQ_FOREACH(locked, &r5f_info->locked_stripes[bucket].locked, lock_link) {
+		if (locked->stripe_index == stripe_req->stripe_index) {
+			TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[bucket].waiting, stripe_req, lock_link);
+			ret = false;
+			break;
+		}
+	}
+
+	if (ret) {
+		TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[bucket].locked, stripe_req, lock_link);
+	}
+
+	spdk_spin_unlock(&r5f_info->stripe_lock);
+
+	return ret;
+}
+
+static void
+_raid5f_stripe_request_start(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+
+	raid5f_stripe_request_start(stripe_req);
+}
+
+static void
+raid5f_stripe_unlock(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	uint64_t bucket = stripe_req->stripe_index % RAID5F_STRIPE_LOCK_BUCKETS;
+	struct stripe_request *waiting;
+	struct spdk_thread *thread;
+	int rc;
+
+	spdk_spin_lock(&r5f_info->stripe_lock);
+
+	TAILQ_REMOVE(&r5f_info->locked_stripes[bucket].locked, stripe_req, lock_link);
+
+	TAILQ_FOREACH(waiting, &r5f_info->locked_stripes[bucket].waiting, lock_link) {
+		if (waiting->stripe_index == stripe_req->stripe_index) {
+			TAILQ_REMOVE(&r5f_info->locked_stripes[bucket].waiting, waiting, lock_link);
+			TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[bucket].locked, waiting, lock_link);
+			break;
+		}
+	}
+
+	spdk_spin_unlock(&r5f_info->stripe_lock);
+
+	if (waiting == NULL) {
+		return;
+	}
+
+	thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(waiting->r5ch));
+	if (thread == spdk_get_thread()) {
+		raid5f_stripe_request_start(waiting);
+	} else {
+		rc = spdk_thread_send_msg(thread, _raid5f_stripe_request_start, waiting);
+		assert(rc == 0);
+		(void)rc;
+	}
+}
+
 static inline void
 raid5f_stripe_request_release(struct stripe_request *stripe_req)
 {
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+
 	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
-		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.write, stripe_req, link);
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.write, stripe_req, link);
+	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
 	} else {
 		assert(false);
+		return;
+	}
+
+	raid5f_stripe_unlock(stripe_req);
+}
+
+static void
+raid5f_stripe_request_complete(struct stripe_request *stripe_req, enum spdk_bdev_io_status status)
+{
+	struct chunk *chunk;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		if (chunk->raid_io != NULL && chunk->raid_io != stripe_req->raid_io) {
+			raid_bdev_io_complete(chunk->raid_io, status);
+		}
+	}
+	raid_bdev_io_complete(stripe_req->raid_io, status);
+
+	raid5f_stripe_request_release(stripe_req);
+}
+
+static inline void
+raid5f_xor_add_source(struct stripe_request *stripe_req, uint8_t idx, struct iovec *iovs,
+		      int iovcnt, void *md_buf)
+{
+	stripe_req->r5ch->chunk_xor_iovs[idx] = iovs;
+	stripe_req->r5ch->chunk_xor_iovcnt[idx] = iovcnt;
+	stripe_req->chunk_xor_md_buffers[idx] = md_buf;
+}
+
+/*
+ * Set up the sources and the destination of the xor calculation for a stripe request.
+ * Full stripe writes calculate parity from all data chunks and reconstruction
+ * calculates the missing chunk from all other chunks. Partial writes either update the
+ * old parity with the old and new data of the written chunks (read-modify-write) or
+ * calculate it from the new data and the old data of the other chunks (reconstruct-write).
+ * Returns the number of sources.
+ */
+static uint8_t
+raid5f_stripe_request_xor_setup(struct stripe_request *stripe_req, uint64_t *xor_blocks,
+				void **dst_md_buf)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(r5ch)->raid_bdev;
+	struct chunk *dst_chunk;
+	struct chunk *chunk;
+	uint8_t c = 0;
+
+	switch (stripe_req->type) {
+	case STRIPE_REQ_WRITE:
+	case STRIPE_REQ_RECONSTRUCT:
+		if (stripe_req->type == STRIPE_REQ_WRITE) {
+			dst_chunk = stripe_req->parity_chunk;
+			*xor_blocks = raid_bdev->strip_size;
+		} else {
+			dst_chunk = stripe_req->reconstruct.chunk;
+			*xor_blocks = stripe_req->reconstruct.chunk_len;
+		}
+
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			if (chunk == dst_chunk) {
+				continue;
+			}
+			raid5f_xor_add_source(stripe_req, c++, chunk->iovs, chunk->iovcnt, chunk->md_buf);
+		}
+		break;
+	case STRIPE_REQ_PARTIAL_WRITE:
+		dst_chunk = stripe_req->parity_chunk;
+		*xor_blocks = stripe_req->partial.chunk_len;
+
+		if (!stripe_req->partial.rcw) {
+			raid5f_xor_add_source(stripe_req, c++,
+					      &stripe_req->partial.chunk_buffer_iovs[dst_chunk->index], 1,
+					      raid5f_partial_chunk_md_buf(stripe_req, dst_chunk));
+		}
+
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			struct iovec *old_data_iov = &stripe_req->partial.chunk_buffer_iovs[chunk->index];
+			void *old_md_buf = raid5f_partial_chunk_md_buf(stripe_req, chunk);
+
+			if (chunk->raid_io != NULL) {
+				if (!stripe_req->partial.rcw) {
+					raid5f_xor_add_source(stripe_req, c++, old_data_iov, 1, old_md_buf);
+				}
+				raid5f_xor_add_source(stripe_req, c++, chunk->iovs, chunk->iovcnt, chunk->md_buf);
+			} else if (stripe_req->partial.rcw) {
+				raid5f_xor_add_source(stripe_req, c++, old_data_iov, 1, old_md_buf);
+			}
+		}
+		break;
+	default:
+		assert(false);
+		return 0;
 	}
+
+	r5ch->chunk_xor_iovs[c] = dst_chunk->iovs;
+	r5ch->chunk_xor_iovcnt[c] = dst_chunk->iovcnt;
+	*dst_md_buf = dst_chunk->md_buf;
+
+	return c;
 }
 
 static void raid5f_xor_stripe_retry(struct stripe_request *stripe_req);
@@ -234,9 +551,7 @@ static void
 raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint8_t n_src = stripe_req->xor.n_src;
 	uint8_t i;
 	int ret;
 
@@ -264,48 +579,42 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
-	void *raid_md = spdk_bdev_io_get_md_buf(bdev_io);
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(r5ch)->raid_bdev;
+	void *raid_md;
 	uint32_t raid_md_size = spdk_bdev_get_md_size(&raid_bdev->bdev);
-	struct chunk *chunk;
-	uint8_t c;
+	uint64_t xor_blocks;
+	void *dst_md_buf;
+	uint8_t n_src;
 
 	assert(cb != NULL);
-	assert(stripe_req->type == STRIPE_REQ_WRITE);
 
-	c = 0;
-	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
-		r5ch->chunk_xor_iovs[c] = chunk->iovs;
-		r5ch->chunk_xor_iovcnt[c] = chunk->iovcnt;
-		c++;
+	if (raid_io != NULL) {
+		raid_md = spdk_bdev_io_get_md_buf(spdk_bdev_io_from_ctx(raid_io));
+	} else {
+		/* Rebuilding a stripe for a background process request */
+		assert(stripe_req->type == STRIPE_REQ_RECONSTRUCT);
+		raid_md = stripe_req->reconstruct.process.req->md_buf;
 	}
-	r5ch->chunk_xor_iovs[c] = stripe_req->parity_chunk->iovs;
-	r5ch->chunk_xor_iovcnt[c] = stripe_req->parity_chunk->iovcnt;
+
+	n_src = raid5f_stripe_request_xor_setup(stripe_req, &xor_blocks, &dst_md_buf);
 
 	stripe_req->xor.len = spdk_ioviter_firstv(stripe_req->chunk_iov_iters,
-			      raid_bdev->num_base_bdevs,
+			      n_src + 1,
 			      r5ch->chunk_xor_iovs,
 			      r5ch->chunk_xor_iovcnt,
 			      r5ch->chunk_xor_buffers);
-	stripe_req->xor.remaining = raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	stripe_req->xor.remaining = xor_blocks << raid_bdev->blocklen_shift;
+	stripe_req->xor.n_src = n_src;
 	stripe_req->xor.status = 0;
 	stripe_req->xor.cb = cb;
 
 	if (raid_md != NULL) {
-		uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
-		uint64_t len = raid_bdev->strip_size * raid_md_size;
+		uint64_t len = xor_blocks * raid_md_size;
 		int ret;
 
 		stripe_req->xor.remaining_md = len;
 
-		c = 0;
-		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
-			stripe_req->chunk_xor_md_buffers[c] = chunk->md_buf;
-			c++;
-		}
-
-		ret = spdk_accel_submit_xor(stripe_req->r5ch->accel_ch, stripe_req->write.parity_md_buf,
+		ret = spdk_accel_submit_xor(stripe_req->r5ch->accel_ch, dst_md_buf,
 					    stripe_req->chunk_xor_md_buffers, n_src, len,
 					    raid5f_xor_stripe_md_cb, stripe_req);
 		if (spdk_unlikely(ret)) {
@@ -332,12 +641,72 @@ raid5f_xor_stripe_retry(struct stripe_request *stripe_req)
 	}
 }
 
+static void raid5f_stripe_request_submit_chunks(struct stripe_request *stripe_req);
+
+static void
+raid5f_stripe_request_xor_done(struct stripe_request *stripe_req, int status)
+{
+	raid5f_stripe_request_complete(stripe_req, status == 0 ? SPDK_BDEV_IO_STATUS_SUCCESS :
+				       SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid5f_stripe_partial_write_xor_done(struct stripe_request *stripe_req, int status)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	if (status != 0) {
+		raid5f_stripe_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	stripe_req->partial.reads_done = true;
+
+	raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+	raid_io->base_bdev_io_submitted = 0;
+
+	raid5f_stripe_request_submit_chunks(stripe_req);
+}
+
 static void
-raid5f_stripe_request_chunk_write_complete(struct stripe_request *stripe_req,
-		enum spdk_bdev_io_status status)
+raid5f_stripe_request_chunks_complete(struct stripe_request *stripe_req, uint64_t completed,
+				      enum spdk_bdev_io_status status)
 {
-	if (raid_bdev_io_complete_part(stripe_req->raid_io, 1, status)) {
-		raid5f_stripe_request_release(stripe_req);
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	assert(raid_io->base_bdev_io_remaining >= completed);
+	raid_io->base_bdev_io_remaining -= completed;
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid_io->base_bdev_io_status = status;
+	}
+
+	if (raid_io->base_bdev_io_remaining > 0) {
+		return;
+	}
+
+	if (raid_io->base_bdev_io_status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid5f_stripe_request_complete(stripe_req, raid_io->base_bdev_io_status);
+		return;
+	}
+
+	switch (stripe_req->type) {
+	case STRIPE_REQ_WRITE:
+		raid5f_stripe_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_SUCCESS);
+		break;
+	case STRIPE_REQ_RECONSTRUCT:
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_request_xor_done);
+		break;
+	case STRIPE_REQ_PARTIAL_WRITE:
+		if (stripe_req->partial.reads_done) {
+			raid5f_stripe_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_SUCCESS);
+		} else {
+			raid5f_xor_stripe(stripe_req, raid5f_stripe_partial_write_xor_done);
+		}
+		break;
+	default:
+		assert(false);
+		break;
 	}
 }
 
@@ -351,15 +720,9 @@ raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *
 
 	spdk_bdev_free_io(bdev_io);
 
-	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
-		raid5f_stripe_request_chunk_write_complete(stripe_req, status);
-	} else {
-		assert(false);
-	}
+	raid5f_stripe_request_chunks_complete(stripe_req, 1, status);
 }
 
-static void raid5f_stripe_request_submit_chunks(struct stripe_request *stripe_req);
-
 static void
 raid5f_chunk_submit_retry(void *_raid_io)
 {
@@ -401,6 +764,36 @@ raid5f_chunk_submit(struct chunk *chunk)
 						  raid5f_chunk_complete_bdev_io, chunk,
 						  &chunk->ext_opts);
 		break;
+	case STRIPE_REQ_RECONSTRUCT:
+		/* The chunks are read into the stripe request's own buffers */
+		chunk->ext_opts.memory_domain = NULL;
+		chunk->ext_opts.memory_domain_ctx = NULL;
+		ret = spdk_bdev_readv_blocks_ext(base_info->desc, base_ch, chunk->iovs, chunk->iovcnt,
+						 base_offset_blocks + stripe_req->reconstruct.chunk_offset,
+						 stripe_req->reconstruct.chunk_len,
+						 raid5f_chunk_complete_bdev_io, chunk,
+						 &chunk->ext_opts);
+		break;
+	case STRIPE_REQ_PARTIAL_WRITE:
+		base_offset_blocks += stripe_req->partial.chunk_offset;
+		if (!stripe_req->partial.reads_done || chunk == stripe_req->parity_chunk) {
+			chunk->ext_opts.memory_domain = NULL;
+			chunk->ext_opts.memory_domain_ctx = NULL;
+		}
+		if (!stripe_req->partial.reads_done) {
+			chunk->ext_opts.metadata = raid5f_partial_chunk_md_buf(stripe_req, chunk);
+			ret = spdk_bdev_readv_blocks_ext(base_info->desc, base_ch,
+							 &stripe_req->partial.chunk_buffer_iovs[chunk->index], 1,
+							 base_offset_blocks, stripe_req->partial.chunk_len,
+							 raid5f_chunk_complete_bdev_io, chunk,
+							 &chunk->ext_opts);
+		} else {
+			ret = spdk_bdev_writev_blocks_ext(base_info->desc, base_ch, chunk->iovs, chunk->iovcnt,
+							  base_offset_blocks, stripe_req->partial.chunk_len,
+							  raid5f_chunk_complete_bdev_io, chunk,
+							  &chunk->ext_opts);
+		}
+		break;
 	default:
 		assert(false);
 		ret = -EINVAL;
@@ -420,10 +813,8 @@ raid5f_chunk_submit(struct chunk *chunk)
 			uint64_t base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
 							      raid_io->base_bdev_io_submitted;
 
-			if (raid_bdev_io_complete_part(stripe_req->raid_io, base_bdev_io_not_submitted,
-						       SPDK_BDEV_IO_STATUS_FAILED)) {
-				raid5f_stripe_request_release(stripe_req);
-			}
+			raid5f_stripe_request_chunks_complete(stripe_req, base_bdev_io_not_submitted,
+							      SPDK_BDEV_IO_STATUS_FAILED);
 		}
 	}
 
@@ -448,6 +839,24 @@ raid5f_chunk_set_iovcnt(struct chunk *chunk, int iovcnt)
 	return 0;
 }
 
+static int
+raid5f_chunk_map_raid_io(struct chunk *chunk, struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	int ret;
+
+	ret = raid5f_chunk_set_iovcnt(chunk, bdev_io->u.bdev.iovcnt);
+	if (spdk_unlikely(ret)) {
+		return ret;
+	}
+
+	memcpy(chunk->iovs, bdev_io->u.bdev.iovs, sizeof(*chunk->iovs) * chunk->iovcnt);
+	chunk->md_buf = spdk_bdev_io_get_md_buf(bdev_io);
+	chunk->raid_io = raid_io;
+
+	return 0;
+}
+
 static int
 raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 {
@@ -508,46 +917,110 @@ raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 		if (spdk_unlikely(len > 0)) {
 			return -EINVAL;
 		}
+
+		chunk->raid_io = stripe_req->raid_io;
 	}
 
 	stripe_req->parity_chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
 	stripe_req->parity_chunk->iovs[0].iov_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
 	stripe_req->parity_chunk->iovcnt = 1;
 	stripe_req->parity_chunk->md_buf = stripe_req->write.parity_md_buf;
+	stripe_req->parity_chunk->raid_io = NULL;
 
 	return 0;
 }
 
+static inline bool
+raid5f_stripe_request_chunk_active(struct stripe_request *stripe_req, struct chunk *chunk)
+{
+	if (spdk_unlikely(stripe_req->raid_io->raid_ch->base_channel[chunk->index] == NULL)) {
+		return false;
+	}
+
+	if (stripe_req->type != STRIPE_REQ_PARTIAL_WRITE) {
+		return true;
+	}
+
+	if (stripe_req->partial.reads_done) {
+		return chunk == stripe_req->parity_chunk || chunk->raid_io != NULL;
+	}
+
+	if (chunk == stripe_req->parity_chunk) {
+		return !stripe_req->partial.rcw;
+	}
+
+	return stripe_req->partial.rcw ? chunk->raid_io == NULL : chunk->raid_io != NULL;
+}
+
 static void
 raid5f_stripe_request_submit_chunks(struct stripe_request *stripe_req)
 {
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
 	struct chunk *start = &stripe_req->chunks[raid_io->base_bdev_io_submitted];
 	struct chunk *chunk;
+	uint64_t skipped = 0;
 
 	FOR_EACH_CHUNK_FROM(stripe_req, chunk, start) {
+		if (!raid5f_stripe_request_chunk_active(stripe_req, chunk)) {
+			/* a missing base bdev's chunk or a chunk this request does not access */
+			raid_io->base_bdev_io_submitted++;
+			skipped++;
+			continue;
+		}
 		if (spdk_unlikely(raid5f_chunk_submit(chunk) != 0)) {
 			break;
 		}
 		raid_io->base_bdev_io_submitted++;
 	}
+
+	if (skipped > 0) {
+		raid5f_stripe_request_chunks_complete(stripe_req, skipped, SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
 }
 
 static void
 raid5f_stripe_write_request_xor_done(struct stripe_request *stripe_req, int status)
 {
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-
 	if (status != 0) {
-		raid5f_stripe_request_release(stripe_req);
-		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		raid5f_stripe_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
 	} else {
 		raid5f_stripe_request_submit_chunks(stripe_req);
 	}
 }
 
+static void
+raid5f_stripe_request_start(struct stripe_request *stripe_req)
+{
+	switch (stripe_req->type) {
+	case STRIPE_REQ_WRITE:
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+		break;
+	case STRIPE_REQ_RECONSTRUCT:
+	case STRIPE_REQ_PARTIAL_WRITE:
+		raid5f_stripe_request_submit_chunks(stripe_req);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+static void
+raid5f_stripe_request_submit(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	raid_io->module_private = stripe_req;
+	raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+	raid_io->base_bdev_io_submitted = 0;
+
+	if (raid5f_stripe_lock(stripe_req)) {
+		raid5f_stripe_request_start(stripe_req);
+	}
+}
+
 static int
-raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
+raid5f_submit_full_stripe_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
 	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
@@ -571,18 +1044,275 @@ raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 
 	TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
 
-	raid_io->module_private = stripe_req;
-	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
-
-	raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+	raid5f_stripe_request_submit(stripe_req);
 
 	return 0;
 }
 
-static void
-raid5f_chunk_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+/*
+ * Submit a write of the same range of one or more data chunks of a stripe. raid_ios
+ * holds the raid_bdev_io for each data chunk, or NULL if the chunk is not written.
+ * If all data chunks are fully written it is a full stripe write, otherwise the old
+ * data is read first to update the parity. Read-modify-write needs the old data of the
+ * written chunks and the old parity, reconstruct-write needs the old data of all other
+ * data chunks. The one needing fewer reads is used, unless a missing base bdev leaves
+ * only one of them possible.
+ */
+static int
+raid5f_submit_chunk_writes(struct raid5f_io_channel *r5ch, uint64_t stripe_index,
+			   struct raid_bdev_io **raid_ios, uint64_t chunk_offset, uint64_t chunk_len)
 {
-	struct raid_bdev_io *raid_io = cb_arg;
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(r5ch)->raid_bdev;
+	uint8_t n_data = raid5f_stripe_data_chunks_num(raid_bdev);
+	size_t strip_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	struct stripe_request *stripe_req;
+	struct raid_bdev_io_channel *raid_ch;
+	struct chunk *chunk, *missing_chunk;
+	uint8_t num_written = 0;
+	uint8_t d = 0;
+	int ret;
+
+	for (d = 0; d < n_data; d++) {
+		if (raid_ios[d] != NULL) {
+			num_written++;
+		}
+	}
+	assert(num_written > 0);
+
+	if (num_written == n_data && chunk_len == raid_bdev->strip_size) {
+		stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write);
+	} else {
+		stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial_write);
+	}
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	stripe_req->stripe_index = stripe_index;
+	stripe_req->parity_chunk = stripe_req->chunks + raid5f_stripe_parity_chunk_index(raid_bdev,
+				   stripe_req->stripe_index);
+	stripe_req->raid_io = NULL;
+
+	d = 0;
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		chunk->raid_io = NULL;
+		if (chunk == stripe_req->parity_chunk) {
+			continue;
+		}
+		if (raid_ios[d] != NULL) {
+			ret = raid5f_chunk_map_raid_io(chunk, raid_ios[d]);
+			if (spdk_unlikely(ret)) {
+				return ret;
+			}
+			if (stripe_req->raid_io == NULL) {
+				stripe_req->raid_io = raid_ios[d];
+			}
+		}
+		d++;
+	}
+
+	chunk = stripe_req->parity_chunk;
+	chunk->iovcnt = 1;
+	chunk->raid_io = NULL;
+
+	if (stripe_req->type == STRIPE_REQ_WRITE) {
+		chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
+		chunk->iovs[0].iov_len = strip_len;
+		chunk->md_buf = stripe_req->write.parity_md_buf;
+
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
+		raid5f_stripe_request_submit(stripe_req);
+
+		return 0;
+	}
+
+	chunk->iovs[0].iov_base = stripe_req->partial.parity_buf;
+	chunk->iovs[0].iov_len = chunk_len << raid_bdev->blocklen_shift;
+	chunk->md_buf = stripe_req->partial.parity_md_buf;
+
+	stripe_req->partial.chunk_offset = chunk_offset;
+	stripe_req->partial.chunk_len = chunk_len;
+
+	raid_ch = stripe_req->raid_io->raid_ch;
+	missing_chunk = NULL;
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		stripe_req->partial.chunk_buffer_iovs[chunk->index].iov_base =
+			stripe_req->partial.chunk_buffers + chunk->index * strip_len;
+		stripe_req->partial.chunk_buffer_iovs[chunk->index].iov_len =
+			chunk_len << raid_bdev->blocklen_shift;
+
+		if (raid_ch->base_channel[chunk->index] == NULL) {
+			missing_chunk = chunk;
+		}
+	}
+
+	if (missing_chunk == stripe_req->parity_chunk) {
+		/* no parity to update, just write the data */
+		stripe_req->partial.rcw = false;
+		stripe_req->partial.reads_done = true;
+	} else {
+		stripe_req->partial.reads_done = false;
+		if (missing_chunk != NULL) {
+			/* the old data of a missing chunk is not available for read-modify-write */
+			stripe_req->partial.rcw = missing_chunk->raid_io != NULL;
+		} else {
+			stripe_req->partial.rcw = n_data - num_written < num_written + 1;
+		}
+	}
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+	raid5f_stripe_request_submit(stripe_req);
+
+	return 0;
+}
+
+static void
+raid5f_stripe_cache_flush_entry(struct raid5f_io_channel *r5ch, struct raid5f_cached_stripe *entry)
+{
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(r5ch)->raid_bdev;
+	uint8_t n_data = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint8_t d;
+	int ret;
+
+	TAILQ_REMOVE(&r5ch->stripe_cache.active, entry, link);
+
+	ret = raid5f_submit_chunk_writes(r5ch, entry->stripe_index, entry->raid_ios, 0,
+					 raid_bdev->strip_size);
+	for (d = 0; d < n_data; d++) {
+		if (spdk_unlikely(ret != 0) && entry->raid_ios[d] != NULL) {
+			raid_bdev_io_complete(entry->raid_ios[d], ret == -ENOMEM ? SPDK_BDEV_IO_STATUS_NOMEM :
+					      SPDK_BDEV_IO_STATUS_FAILED);
+		}
+		entry->raid_ios[d] = NULL;
+	}
+	entry->num_chunks = 0;
+
+	TAILQ_INSERT_TAIL(&r5ch->stripe_cache.free, entry, link);
+}
+
+static void
+raid5f_stripe_cache_flush(void *ctx)
+{
+	struct raid5f_io_channel *r5ch = ctx;
+	struct raid5f_cached_stripe *entry;
+
+	r5ch->stripe_cache.flush_pending = false;
+
+	while ((entry = TAILQ_FIRST(&r5ch->stripe_cache.active))) {
+		raid5f_stripe_cache_flush_entry(r5ch, entry);
+	}
+}
+
+static struct raid5f_cached_stripe *
+raid5f_stripe_cache_find(struct raid5f_io_channel *r5ch, uint64_t stripe_index)
+{
+	struct raid5f_cached_stripe *entry;
+
+	TAILQ_FOREACH(entry, &r5ch->stripe_cache.active, link) {
+		if (entry->stripe_index == stripe_index) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+raid5f_stripe_cache_flush_stripe(struct raid5f_io_channel *r5ch, uint64_t stripe_index)
+{
+	struct raid5f_cached_stripe *entry;
+
+	entry = raid5f_stripe_cache_find(r5ch, stripe_index);
+	if (entry != NULL) {
+		raid5f_stripe_cache_flush_entry(r5ch, entry);
+	}
+}
+
+/*
+ * Full chunk writes are held back until the current thread returns to polling, so that
+ * writes to the other chunks of the stripe submitted in the meantime (e.g. the children
+ * of a split sequential write) can be merged into a single full stripe write.
+ */
+static void
+raid5f_stripe_cache_add(struct raid5f_io_channel *r5ch, struct raid_bdev_io *raid_io,
+			uint64_t stripe_index, uint8_t data_chunk_idx)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_cached_stripe *entry;
+
+	entry = raid5f_stripe_cache_find(r5ch, stripe_index);
+	if (entry != NULL && entry->raid_ios[data_chunk_idx] != NULL) {
+		/* the chunk is written again, write out what is cached for the stripe first */
+		raid5f_stripe_cache_flush_entry(r5ch, entry);
+		entry = NULL;
+	}
+
+	if (entry == NULL) {
+		entry = TAILQ_FIRST(&r5ch->stripe_cache.free);
+		if (entry == NULL) {
+			raid5f_stripe_cache_flush_entry(r5ch, TAILQ_FIRST(&r5ch->stripe_cache.active));
+			entry = TAILQ_FIRST(&r5ch->stripe_cache.free);
+		}
+		TAILQ_REMOVE(&r5ch->stripe_cache.free, entry, link);
+		entry->stripe_index = stripe_index;
+		TAILQ_INSERT_TAIL(&r5ch->stripe_cache.active, entry, link);
+	}
+
+	entry->raid_ios[data_chunk_idx] = raid_io;
+	entry->num_chunks++;
+
+	if (entry->num_chunks == raid5f_stripe_data_chunks_num(raid_bdev)) {
+		raid5f_stripe_cache_flush_entry(r5ch, entry);
+	} else if (!r5ch->stripe_cache.flush_pending) {
+		if (spdk_thread_send_msg(spdk_get_thread(), raid5f_stripe_cache_flush, r5ch) == 0) {
+			r5ch->stripe_cache.flush_pending = true;
+		} else {
+			raid5f_stripe_cache_flush_entry(r5ch, entry);
+		}
+	}
+}
+
+static int
+raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			    uint64_t stripe_offset)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint8_t data_chunk_idx;
+	uint64_t chunk_offset;
+
+	if (stripe_offset == 0 && num_blocks == r5f_info->stripe_blocks) {
+		raid5f_stripe_cache_flush_stripe(r5ch, stripe_index);
+		return raid5f_submit_full_stripe_write_request(raid_io, stripe_index);
+	}
+
+	data_chunk_idx = stripe_offset >> raid_bdev->strip_size_shift;
+	chunk_offset = stripe_offset - ((uint64_t)data_chunk_idx << raid_bdev->strip_size_shift);
+	assert(chunk_offset + num_blocks <= raid_bdev->strip_size);
+
+	if (chunk_offset == 0 && num_blocks == raid_bdev->strip_size &&
+	    bdev_io->u.bdev.memory_domain == NULL) {
+		raid5f_stripe_cache_add(r5ch, raid_io, stripe_index, data_chunk_idx);
+		return 0;
+	}
+
+	raid5f_stripe_cache_flush_stripe(r5ch, stripe_index);
+
+	memset(r5ch->chunk_raid_ios, 0,
+	       raid5f_stripe_data_chunks_num(raid_bdev) * sizeof(*r5ch->chunk_raid_ios));
+	r5ch->chunk_raid_ios[data_chunk_idx] = raid_io;
+
+	return raid5f_submit_chunk_writes(r5ch, stripe_index, r5ch->chunk_raid_ios, chunk_offset,
+					  num_blocks);
+}
+
+static void
+raid5f_chunk_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
 
 	spdk_bdev_free_io(bdev_io);
 
@@ -600,6 +1330,67 @@ _raid5f_submit_rw_request(void *_raid_io)
 	raid5f_submit_rw_request(raid_io);
 }
 
+static int
+raid5f_submit_reconstruct_read(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			       uint8_t chunk_idx, uint64_t chunk_offset)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_io->raid_ch->module_channel);
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	void *raid_io_md = spdk_bdev_io_get_md_buf(bdev_io);
+	uint32_t raid_io_md_size = spdk_bdev_get_md_size(&raid_bdev->bdev);
+	uint64_t len = bdev_io->u.bdev.num_blocks << raid_bdev->blocklen_shift;
+	struct stripe_request *stripe_req;
+	struct chunk *chunk;
+	uint8_t c;
+	int ret;
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.reconstruct);
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	stripe_req->stripe_index = stripe_index;
+	stripe_req->parity_chunk = stripe_req->chunks + raid5f_stripe_parity_chunk_index(raid_bdev,
+				   stripe_req->stripe_index);
+	stripe_req->raid_io = raid_io;
+	stripe_req->reconstruct.process.req = NULL;
+	stripe_req->reconstruct.chunk = &stripe_req->chunks[chunk_idx];
+	stripe_req->reconstruct.chunk_offset = chunk_offset;
+	stripe_req->reconstruct.chunk_len = bdev_io->u.bdev.num_blocks;
+
+	c = 0;
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		chunk->raid_io = NULL;
+
+		if (chunk == stripe_req->reconstruct.chunk) {
+			ret = raid5f_chunk_set_iovcnt(chunk, bdev_io->u.bdev.iovcnt);
+			if (spdk_unlikely(ret)) {
+				return ret;
+			}
+			memcpy(chunk->iovs, bdev_io->u.bdev.iovs, sizeof(*chunk->iovs) * chunk->iovcnt);
+			chunk->md_buf = raid_io_md;
+			continue;
+		}
+
+		chunk->iovs[0].iov_base = stripe_req->reconstruct.chunk_buffers +
+					  c * (raid_bdev->strip_size << raid_bdev->blocklen_shift);
+		chunk->iovs[0].iov_len = len;
+		chunk->iovcnt = 1;
+		if (raid_io_md) {
+			chunk->md_buf = stripe_req->reconstruct.chunk_md_buffers +
+					c * raid_bdev->strip_size * raid_io_md_size;
+		}
+		c++;
+	}
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+
+	raid5f_stripe_request_submit(stripe_req);
+
+	return 0;
+}
+
 static int
 raid5f_submit_read_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
 			   uint64_t stripe_offset)
@@ -616,6 +1407,10 @@ raid5f_submit_read_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
 	struct spdk_bdev_ext_io_opts io_opts;
 	int ret;
 
+	if (spdk_unlikely(base_ch == NULL)) {
+		return raid5f_submit_reconstruct_read(raid_io, stripe_index, chunk_idx, chunk_offset);
+	}
+
 	raid5f_init_ext_io_opts(bdev_io, &io_opts);
 	ret = spdk_bdev_readv_blocks_ext(base_info->desc, base_ch, bdev_io->u.bdev.iovs,
 					 bdev_io->u.bdev.iovcnt,
@@ -648,9 +1443,8 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 		ret = raid5f_submit_read_request(raid_io, stripe_index, stripe_offset);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		assert(stripe_offset == 0);
-		assert(bdev_io->u.bdev.num_blocks == r5f_info->stripe_blocks);
-		ret = raid5f_submit_write_request(raid_io, stripe_index);
+		assert(stripe_offset + bdev_io->u.bdev.num_blocks <= r5f_info->stripe_blocks);
+		ret = raid5f_submit_write_request(raid_io, stripe_index, stripe_offset);
 		break;
 	default:
 		ret = -EINVAL;
@@ -663,6 +1457,266 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+static void
+raid5f_process_stripe_done(struct stripe_request *stripe_req, int status)
+{
+	struct raid_bdev_process_request *process_req = stripe_req->reconstruct.process.req;
+
+	/* The stripe was not locked, the processed range is quiesced */
+	TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+
+	raid_bdev_process_request_complete(process_req, status);
+}
+
+static void
+raid5f_process_chunk_write_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct chunk *chunk = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid5f_process_stripe_done(raid5f_chunk_stripe_req(chunk), success ? 0 : -EIO);
+}
+
+static void raid5f_process_stripe_write(struct stripe_request *stripe_req);
+
+static void
+_raid5f_process_stripe_write(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+
+	raid5f_process_stripe_write(stripe_req);
+}
+
+static void
+raid5f_process_stripe_write(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_process_request *process_req = stripe_req->reconstruct.process.req;
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(stripe_req->r5ch)->raid_bdev;
+	struct chunk *chunk = stripe_req->reconstruct.chunk;
+	int ret;
+
+	ret = spdk_bdev_writev_blocks_with_md(process_req->target->desc, process_req->target_ch,
+					      chunk->iovs, chunk->iovcnt, chunk->md_buf,
+					      stripe_req->stripe_index << raid_bdev->strip_size_shift,
+					      raid_bdev->strip_size, raid5f_process_chunk_write_complete,
+					      chunk);
+	if (spdk_unlikely(ret != 0)) {
+		if (ret == -ENOMEM) {
+			process_req->waitq_entry.bdev = spdk_bdev_desc_get_bdev(process_req->target->desc);
+			process_req->waitq_entry.cb_fn = _raid5f_process_stripe_write;
+			process_req->waitq_entry.cb_arg = stripe_req;
+			spdk_bdev_queue_io_wait(process_req->waitq_entry.bdev, process_req->target_ch,
+						&process_req->waitq_entry);
+			return;
+		}
+
+		raid5f_process_stripe_done(stripe_req, ret);
+	}
+}
+
+static void
+raid5f_process_stripe_xor_done(struct stripe_request *stripe_req, int status)
+{
+	if (status != 0) {
+		raid5f_process_stripe_done(stripe_req, status);
+		return;
+	}
+
+	raid5f_process_stripe_write(stripe_req);
+}
+
+static void
+raid5f_process_stripe_reads_complete(struct stripe_request *stripe_req, uint8_t completed,
+				     int status)
+{
+	assert(stripe_req->reconstruct.process.remaining >= completed);
+	stripe_req->reconstruct.process.remaining -= completed;
+
+	if (status != 0) {
+		stripe_req->reconstruct.process.status = status;
+	}
+
+	if (stripe_req->reconstruct.process.remaining > 0) {
+		return;
+	}
+
+	if (stripe_req->reconstruct.process.status != 0) {
+		raid5f_process_stripe_done(stripe_req, stripe_req->reconstruct.process.status);
+		return;
+	}
+
+	/* Calculate the target chunk from the other chunks of the stripe */
+	raid5f_xor_stripe(stripe_req, raid5f_process_stripe_xor_done);
+}
+
+static void
+raid5f_process_chunk_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct chunk *chunk = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid5f_process_stripe_reads_complete(raid5f_chunk_stripe_req(chunk), 1, success ? 0 : -EIO);
+}
+
+static void _raid5f_process_stripe_submit_reads(void *_stripe_req);
+
+/*
+ * Returns an error only if no read was submitted, so the stripe request can be
+ * released by the caller.
+ */
+static int
+raid5f_process_stripe_submit_reads(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_process_request *process_req = stripe_req->reconstruct.process.req;
+	struct raid_bdev_io_channel *raid_ch = stripe_req->reconstruct.process.raid_ch;
+	struct raid_bdev *raid_bdev = raid5f_ch_to_r5f_info(stripe_req->r5ch)->raid_bdev;
+	uint64_t base_offset_blocks = stripe_req->stripe_index << raid_bdev->strip_size_shift;
+	struct raid_base_bdev_info *base_info;
+	struct chunk *chunk;
+	uint8_t not_submitted = 0;
+	uint8_t i;
+	int ret = 0;
+
+	for (i = stripe_req->reconstruct.process.next_chunk; i < raid_bdev->num_base_bdevs; i++) {
+		chunk = &stripe_req->chunks[i];
+		if (chunk == stripe_req->reconstruct.chunk) {
+			continue;
+		}
+
+		base_info = &raid_bdev->base_bdev_info[i];
+		ret = spdk_bdev_readv_blocks_with_md(base_info->desc, raid_ch->base_channel[i],
+						     chunk->iovs, chunk->iovcnt, chunk->md_buf,
+						     base_offset_blocks, raid_bdev->strip_size,
+						     raid5f_process_chunk_read_complete, chunk);
+		if (spdk_unlikely(ret != 0)) {
+			break;
+		}
+	}
+	stripe_req->reconstruct.process.next_chunk = i;
+
+	if (spdk_likely(ret == 0)) {
+		return 0;
+	}
+
+	if (ret == -ENOMEM) {
+		process_req->waitq_entry.bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+		process_req->waitq_entry.cb_fn = _raid5f_process_stripe_submit_reads;
+		process_req->waitq_entry.cb_arg = stripe_req;
+		spdk_bdev_queue_io_wait(process_req->waitq_entry.bdev, raid_ch->base_channel[i],
+					&process_req->waitq_entry);
+		return 0;
+	}
+
+	for (; i < raid_bdev->num_base_bdevs; i++) {
+		if (&stripe_req->chunks[i] != stripe_req->reconstruct.chunk) {
+			not_submitted++;
+		}
+	}
+
+	if (not_submitted == stripe_req->reconstruct.process.remaining) {
+		return ret;
+	}
+
+	raid5f_process_stripe_reads_complete(stripe_req, not_submitted, ret);
+
+	return 0;
+}
+
+static void
+_raid5f_process_stripe_submit_reads(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+	int ret;
+
+	ret = raid5f_process_stripe_submit_reads(stripe_req);
+	if (spdk_unlikely(ret != 0)) {
+		raid5f_process_stripe_done(stripe_req, ret);
+	}
+}
+
+/*
+ * Rebuild one stripe onto the target base bdev. The target chunk is calculated
+ * from the other chunks of the stripe, like in a degraded read, and written to the
+ * target.
+ */
+static int
+raid5f_submit_process_request(struct raid_bdev_process_request *process_req,
+			      struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev *raid_bdev = process_req->target->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_ch->module_channel);
+	uint32_t raid_md_size = spdk_bdev_get_md_size(&raid_bdev->bdev);
+	size_t strip_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
+	uint8_t target_idx = process_req->target - raid_bdev->base_bdev_info;
+	struct stripe_request *stripe_req;
+	struct chunk *chunk;
+	uint8_t c;
+	int ret;
+
+	assert(process_req->offset_blocks % r5f_info->stripe_blocks == 0);
+	assert(process_req->num_blocks >= r5f_info->stripe_blocks);
+
+	for (c = 0; c < raid_bdev->num_base_bdevs; c++) {
+		if (c != target_idx && raid_ch->base_channel[c] == NULL) {
+			/* Another base bdev is missing, the stripe can't be rebuilt */
+			return -ENODEV;
+		}
+	}
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.reconstruct);
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	stripe_req->stripe_index = process_req->offset_blocks / r5f_info->stripe_blocks;
+	stripe_req->parity_chunk = stripe_req->chunks + raid5f_stripe_parity_chunk_index(raid_bdev,
+				   stripe_req->stripe_index);
+	stripe_req->raid_io = NULL;
+	stripe_req->reconstruct.chunk = &stripe_req->chunks[target_idx];
+	stripe_req->reconstruct.chunk_offset = 0;
+	stripe_req->reconstruct.chunk_len = raid_bdev->strip_size;
+	stripe_req->reconstruct.process.req = process_req;
+	stripe_req->reconstruct.process.raid_ch = raid_ch;
+	stripe_req->reconstruct.process.next_chunk = 0;
+	stripe_req->reconstruct.process.remaining = raid_bdev->num_base_bdevs - 1;
+	stripe_req->reconstruct.process.status = 0;
+
+	c = 0;
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		chunk->raid_io = NULL;
+		chunk->iovcnt = 1;
+
+		if (chunk == stripe_req->reconstruct.chunk) {
+			chunk->iovs[0].iov_base = process_req->iov.iov_base;
+			chunk->iovs[0].iov_len = strip_len;
+			chunk->md_buf = process_req->md_buf;
+			continue;
+		}
+
+		chunk->iovs[0].iov_base = stripe_req->reconstruct.chunk_buffers + c * strip_len;
+		chunk->iovs[0].iov_len = strip_len;
+		chunk->md_buf = NULL;
+		if (process_req->md_buf != NULL) {
+			chunk->md_buf = stripe_req->reconstruct.chunk_md_buffers +
+					c * raid_bdev->strip_size * raid_md_size;
+		}
+		c++;
+	}
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+
+	ret = raid5f_process_stripe_submit_reads(stripe_req);
+	if (spdk_unlikely(ret != 0)) {
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+		return ret;
+	}
+
+	return r5f_info->stripe_blocks;
+}
+
 static void
 raid5f_stripe_request_free(struct stripe_request *stripe_req)
 {
@@ -675,6 +1729,15 @@ raid5f_stripe_request_free(struct stripe_request *stripe_req)
 	if (stripe_req->type == STRIPE_REQ_WRITE) {
 		spdk_dma_free(stripe_req->write.parity_buf);
 		spdk_dma_free(stripe_req->write.parity_md_buf);
+	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
+		spdk_dma_free(stripe_req->reconstruct.chunk_buffers);
+		spdk_dma_free(stripe_req->reconstruct.chunk_md_buffers);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		spdk_dma_free(stripe_req->partial.chunk_buffers);
+		spdk_dma_free(stripe_req->partial.chunk_md_buffers);
+		spdk_dma_free(stripe_req->partial.parity_buf);
+		spdk_dma_free(stripe_req->partial.parity_md_buf);
+		free(stripe_req->partial.chunk_buffer_iovs);
 	} else {
 		assert(false);
 	}
@@ -692,6 +1755,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(r5ch);
 	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
 	uint32_t raid_io_md_size = spdk_bdev_get_md_size(&raid_bdev->bdev);
+	size_t strip_len = raid_bdev->strip_size << raid_bdev->blocklen_shift;
 	struct stripe_request *stripe_req;
 	struct chunk *chunk;
 
@@ -713,8 +1777,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 	}
 
 	if (type == STRIPE_REQ_WRITE) {
-		stripe_req->write.parity_buf = spdk_dma_malloc(raid_bdev->strip_size << raid_bdev->blocklen_shift,
-					       r5f_info->buf_alignment, NULL);
+		stripe_req->write.parity_buf = spdk_dma_malloc(strip_len, r5f_info->buf_alignment, NULL);
 		if (!stripe_req->write.parity_buf) {
 			goto err;
 		}
@@ -726,23 +1789,75 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 				goto err;
 			}
 		}
+	} else if (type == STRIPE_REQ_RECONSTRUCT) {
+		uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
+
+		stripe_req->reconstruct.chunk_buffers = spdk_dma_malloc(n_src * strip_len,
+							r5f_info->buf_alignment, NULL);
+		if (!stripe_req->reconstruct.chunk_buffers) {
+			goto err;
+		}
+
+		if (raid_io_md_size != 0) {
+			stripe_req->reconstruct.chunk_md_buffers = spdk_dma_malloc(n_src * raid_bdev->strip_size *
+					raid_io_md_size, r5f_info->buf_alignment, NULL);
+			if (!stripe_req->reconstruct.chunk_md_buffers) {
+				goto err;
+			}
+		}
+	} else if (type == STRIPE_REQ_PARTIAL_WRITE) {
+		stripe_req->partial.chunk_buffers = spdk_dma_malloc(raid_bdev->num_base_bdevs * strip_len,
+						    r5f_info->buf_alignment, NULL);
+		if (!stripe_req->partial.chunk_buffers) {
+			goto err;
+		}
+
+		stripe_req->partial.chunk_buffer_iovs = calloc(raid_bdev->num_base_bdevs,
+							sizeof(*stripe_req->partial.chunk_buffer_iovs));
+		if (!stripe_req->partial.chunk_buffer_iovs) {
+			goto err;
+		}
+
+		stripe_req->partial.parity_buf = spdk_dma_malloc(strip_len, r5f_info->buf_alignment, NULL);
+		if (!stripe_req->partial.parity_buf) {
+			goto err;
+		}
+
+		if (raid_io_md_size != 0) {
+			stripe_req->partial.chunk_md_buffers = spdk_dma_malloc(raid_bdev->num_base_bdevs *
+							       raid_bdev->strip_size * raid_io_md_size,
+							       r5f_info->buf_alignment, NULL);
+			if (!stripe_req->partial.chunk_md_buffers) {
+				goto err;
+			}
+
+			stripe_req->partial.parity_md_buf = spdk_dma_malloc(raid_bdev->strip_size * raid_io_md_size,
+							    r5f_info->buf_alignment, NULL);
+			if (!stripe_req->partial.parity_md_buf) {
+				goto err;
+			}
+		}
 	} else {
 		assert(false);
 		return NULL;
 	}
 
-	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid_bdev->num_base_bdevs));
+	/*
+	 * Read-modify-write of a partial stripe uses up to two sources per written chunk and
+	 * the old parity, so the xor arrays are sized for twice the number of chunks.
+	 */
+	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid_bdev->num_base_bdevs * 2));
 	if (!stripe_req->chunk_iov_iters) {
 		goto err;
 	}
 
-	stripe_req->chunk_xor_buffers = calloc(raid5f_stripe_data_chunks_num(raid_bdev),
+	stripe_req->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs * 2,
 					       sizeof(stripe_req->chunk_xor_buffers[0]));
 	if (!stripe_req->chunk_xor_buffers) {
 		goto err;
 	}
 
-	stripe_req->chunk_xor_md_buffers = calloc(raid5f_stripe_data_chunks_num(raid_bdev),
+	stripe_req->chunk_xor_md_buffers = calloc(raid_bdev->num_base_bdevs * 2,
 					   sizeof(stripe_req->chunk_xor_md_buffers[0]));
 	if (!stripe_req->chunk_xor_md_buffers) {
 		goto err;
@@ -759,14 +1874,30 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 {
 	struct raid5f_io_channel *r5ch = ctx_buf;
 	struct stripe_request *stripe_req;
+	int i;
 
 	assert(TAILQ_EMPTY(&r5ch->xor_retry_queue));
+	assert(TAILQ_EMPTY(&r5ch->stripe_cache.active));
 
 	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write))) {
 		TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
 		raid5f_stripe_request_free(stripe_req);
 	}
 
+	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.reconstruct))) {
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+		raid5f_stripe_request_free(stripe_req);
+	}
+
+	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial_write))) {
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+		raid5f_stripe_request_free(stripe_req);
+	}
+
+	for (i = 0; i < RAID5F_STRIPE_CACHE_SIZE; i++) {
+		free(r5ch->stripe_cache.entries[i].raid_ios);
+	}
+
 	if (r5ch->accel_ch) {
 		spdk_put_io_channel(r5ch->accel_ch);
 	}
@@ -774,6 +1905,7 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 	free(r5ch->chunk_xor_buffers);
 	free(r5ch->chunk_xor_iovs);
 	free(r5ch->chunk_xor_iovcnt);
+	free(r5ch->chunk_raid_ios);
 }
 
 static int
@@ -782,9 +1914,14 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 	struct raid5f_io_channel *r5ch = ctx_buf;
 	struct raid5f_info *r5f_info = io_device;
 	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint8_t n_data = raid5f_stripe_data_chunks_num(raid_bdev);
 	int i;
 
 	TAILQ_INIT(&r5ch->free_stripe_requests.write);
+	TAILQ_INIT(&r5ch->free_stripe_requests.reconstruct);
+	TAILQ_INIT(&r5ch->free_stripe_requests.partial_write);
+	TAILQ_INIT(&r5ch->stripe_cache.free);
+	TAILQ_INIT(&r5ch->stripe_cache.active);
 	TAILQ_INIT(&r5ch->xor_retry_queue);
 
 	for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
@@ -798,27 +1935,67 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.write, stripe_req, link);
 	}
 
+	for (i = 0; i < RAID5F_MAX_RECONSTRUCT_STRIPES; i++) {
+		struct stripe_request *stripe_req;
+
+		stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_RECONSTRUCT);
+		if (!stripe_req) {
+			goto err;
+		}
+
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+	}
+
+	for (i = 0; i < RAID5F_MAX_PARTIAL_STRIPES; i++) {
+		struct stripe_request *stripe_req;
+
+		stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_PARTIAL_WRITE);
+		if (!stripe_req) {
+			goto err;
+		}
+
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+	}
+
+	for (i = 0; i < RAID5F_STRIPE_CACHE_SIZE; i++) {
+		struct raid5f_cached_stripe *entry = &r5ch->stripe_cache.entries[i];
+
+		entry->raid_ios = calloc(n_data, sizeof(*entry->raid_ios));
+		if (!entry->raid_ios) {
+			goto err;
+		}
+
+		TAILQ_INSERT_TAIL(&r5ch->stripe_cache.free, entry, link);
+	}
+
 	r5ch->accel_ch = spdk_accel_get_io_channel();
 	if (!r5ch->accel_ch) {
 		SPDK_ERRLOG("Failed to get accel framework's IO channel\n");
 		goto err;
 	}
 
-	r5ch->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_buffers));
+	r5ch->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs * 2,
+					 sizeof(*r5ch->chunk_xor_buffers));
 	if (!r5ch->chunk_xor_buffers) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovs));
+	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs * 2, sizeof(*r5ch->chunk_xor_iovs));
 	if (!r5ch->chunk_xor_iovs) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovcnt));
+	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs * 2,
+					sizeof(*r5ch->chunk_xor_iovcnt));
 	if (!r5ch->chunk_xor_iovcnt) {
 		goto err;
 	}
 
+	r5ch->chunk_raid_ios = calloc(n_data, sizeof(*r5ch->chunk_raid_ios));
+	if (!r5ch->chunk_raid_ios) {
+		goto err;
+	}
+
 	return 0;
 err:
 	SPDK_ERRLOG("Failed to initialize io channel\n");
@@ -833,6 +2010,7 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	struct raid_base_bdev_info *base_info;
 	struct raid5f_info *r5f_info;
 	size_t alignment = 0;
+	int i;
 
 	r5f_info = calloc(1, sizeof(*r5f_info));
 	if (!r5f_info) {
@@ -841,6 +2019,12 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	}
 	r5f_info->raid_bdev = raid_bdev;
 
+	spdk_spin_init(&r5f_info->stripe_lock);
+	for (i = 0; i < RAID5F_STRIPE_LOCK_BUCKETS; i++) {
+		TAILQ_INIT(&r5f_info->locked_stripes[i].locked);
+		TAILQ_INIT(&r5f_info->locked_stripes[i].waiting);
+	}
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		struct spdk_bdev *base_bdev;
 
@@ -853,11 +2037,20 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	r5f_info->stripe_blocks = raid_bdev->strip_size * raid5f_stripe_data_chunks_num(raid_bdev);
 	r5f_info->buf_alignment = alignment;
 
+	/*
+	 * Both reads and writes are split on strip boundaries. Writes of full chunks are
+	 * merged back into full stripe writes by the stripe cache. The full stripe remains
+	 * the preferred write unit, but it is only advisory because the bdev layer fails
+	 * writes smaller than a mandatory write unit.
+	 */
 	raid_bdev->bdev.blockcnt = r5f_info->stripe_blocks * r5f_info->total_stripes;
 	raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
 	raid_bdev->bdev.split_on_optimal_io_boundary = true;
 	raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
-	raid_bdev->bdev.split_on_write_unit = true;
+	raid_bdev->bdev.split_on_write_unit = false;
+
+	/* Background processes rebuild whole stripes */
+	raid_bdev->process_granularity = r5f_info->stripe_blocks;
 
 	raid_bdev->module_private = r5f_info;
 
@@ -874,6 +2067,7 @@ raid5f_io_device_unregister_done(void *io_device)
 
 	raid_bdev_module_stop_done(r5f_info->raid_bdev);
 
+	spdk_spin_destroy(&r5f_info->stripe_lock);
 	free(r5f_info);
 }
 
@@ -903,6 +2097,7 @@ static struct raid_bdev_module g_raid5f_module = {
 	.stop = raid5f_stop,
 	.submit_rw_request = raid5f_submit_rw_request,
 	.get_io_channel = raid5f_get_io_channel,
+	.submit_process_request = raid5f_submit_process_request,
 };
 RAID_MODULE_REGISTER(&g_raid5f_module)
 
@@ -0,0 +1,1485 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * This is a virtual block device module that detects sequential read streams
+ * on the bdev it is attached to and reads ahead of them, so that the reads
+ * that follow are served from memory instead of waiting for the base bdev.
+ *
+ * Every I/O channel tracks a fixed number of streams. A read that continues
+ * where a stream stopped extends it, any other read replaces the least
+ * recently used stream. Once a stream has seen a few sequential reads, up to
+ * two prefetches of its current window size are kept in flight ahead of it,
+ * into buffers taken from the iobuf pool. Reads that fall within a prefetched
+ * buffer are copied from it, or wait for it if the prefetch is still
+ * outstanding. The window of a stream doubles every time a buffer is used up
+ * and halves when a buffer is released with data that was never read, so it
+ * follows the hit rate of the stream.
+ *
+ * Writes, write zeroes, unmaps and copies bump per-stripe generation counters
+ * when they are submitted and when they complete. Prefetched data is used only
+ * if the generation of the blocks it covers did not change since the prefetch
+ * was issued, which keeps channels from serving data overwritten elsewhere.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_readahead.h"
+#include "spdk/env.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* Readahead bdev UUIDs are derived from this and the UUID of their base bdev */
+#define BDEV_READAHEAD_NAMESPACE_UUID "9a7e3c52-1b0d-4f86-a3c4-6e2d58b1f907"
+
+#define READAHEAD_DEFAULT_MAX_STREAMS		8
+#define READAHEAD_MAX_STREAMS			64
+#define READAHEAD_DEFAULT_MAX_WINDOW_KB		128
+#define READAHEAD_DEFAULT_MAX_MEMORY_MB		64
+#define READAHEAD_MIN_WINDOW_SIZE		(16 * 1024)
+/* Number of sequential reads a stream needs before it is read ahead */
+#define READAHEAD_SEQUENTIAL_THRESHOLD		2
+#define READAHEAD_BUFS_PER_STREAM		2
+#define READAHEAD_NUM_STRIPES			1024
+#define READAHEAD_IOBUF_NAME			"bdev_readahead"
+
+static int vbdev_readahead_init(void);
+static int vbdev_readahead_get_ctx_size(void);
+static void vbdev_readahead_examine(struct spdk_bdev *bdev);
+static void vbdev_readahead_finish(void);
+static int vbdev_readahead_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module readahead_if = {
+	.name = "readahead",
+	.module_init = vbdev_readahead_init,
+	.get_ctx_size = vbdev_readahead_get_ctx_size,
+	.examine_config = vbdev_readahead_examine,
+	.module_fini = vbdev_readahead_finish,
+	.config_json = vbdev_readahead_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(readahead, &readahead_if)
+
+/* List of readahead bdev names, their base bdevs and options. Kept so that the
+ * readahead bdev can be created in examine() once its base bdev shows up.
+ */
+struct bdev_names {
+	char				*vbdev_name;
+	char				*bdev_name;
+	struct vbdev_readahead_opts	opts;
+	TAILQ_ENTRY(bdev_names)		link;
+};
+static TAILQ_HEAD(, bdev_names) g_bdev_names = TAILQ_HEAD_INITIALIZER(g_bdev_names);
+
+/* A readahead bdev and the limits shared by the streams of all its channels */
+struct vbdev_readahead {
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		ra_bdev;
+	TAILQ_ENTRY(vbdev_readahead)	link;
+	struct spdk_thread		*thread;    /* owns base_desc, the last reference is dropped here */
+
+	struct vbdev_readahead_opts	opts;
+	uint32_t			min_window_blocks;
+	uint32_t			max_window_blocks;
+	uint64_t			memory_cap;
+	/* Bytes held by prefetch buffers of all channels */
+	uint64_t			memory_used;
+	/* One reference for the registered bdev and one for every outstanding prefetch */
+	uint32_t			refs;
+	/* Bumped by every write before and after it is sent to the base bdev */
+	uint64_t			stripe_gen[READAHEAD_NUM_STRIPES];
+};
+static TAILQ_HEAD(, vbdev_readahead) g_readahead_nodes = TAILQ_HEAD_INITIALIZER(
+			g_readahead_nodes);
+
+enum readahead_buf_state {
+	READAHEAD_BUF_FREE,
+	/* The prefetch is outstanding, reads within the buffer wait for it */
+	READAHEAD_BUF_PENDING,
+	READAHEAD_BUF_VALID,
+};
+
+struct readahead_buf {
+	struct readahead_stream		*stream;
+	enum readahead_buf_state	state;
+	/* Release the buffer as soon as its prefetch completes */
+	bool				drop;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	/* Number of blocks copied out of the buffer so far */
+	uint64_t			used_blocks;
+	/* Sum of the stripe generations of the blocks, sampled when the prefetch was issued */
+	uint64_t			gen;
+	void				*data;
+	uint64_t			len;
+	struct spdk_iobuf_entry		iobuf_entry;
+	TAILQ_HEAD(, spdk_bdev_io)	waiters;
+};
+
+struct readahead_stream {
+	struct readahead_io_channel	*ra_ch;
+	/* Block right after the last read of the stream */
+	uint64_t			next_offset;
+	uint64_t			last_used;
+	uint64_t			sequential_reads;
+	uint32_t			window_blocks;
+	struct readahead_buf		bufs[READAHEAD_BUFS_PER_STREAM];
+
+	uint64_t			hits;
+	uint64_t			misses;
+	uint64_t			prefetches;
+	uint64_t			prefetched_bytes;
+	uint64_t			wasted_bytes;
+};
+
+struct readahead_io_channel {
+	struct spdk_io_channel		*base_ch; /* prefetches and pass-through I/O */
+	struct spdk_iobuf_channel	iobuf;
+	struct vbdev_readahead		*node;
+	struct readahead_stream		*streams;
+	uint32_t			num_streams;
+	uint64_t			tick;
+
+	uint64_t			read_hits;
+	uint64_t			read_misses;
+	uint64_t			read_bypassed;
+	uint64_t			prefetches_skipped;
+};
+
+struct readahead_bdev_io {
+	/* bdev related */
+	struct spdk_io_channel		*ch;
+
+	/* for bdev_io_wait */
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+static void vbdev_readahead_submit_request(struct spdk_io_channel *ch,
+		struct spdk_bdev_io *bdev_io);
+
+static uint64_t
+readahead_get_gen(struct vbdev_readahead *node, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t first, last, stripe, gen = 0;
+
+	first = offset_blocks / node->max_window_blocks;
+	last = (offset_blocks + num_blocks - 1) / node->max_window_blocks;
+
+	for (stripe = first; stripe <= last; stripe++) {
+		gen += __atomic_load_n(&node->stripe_gen[stripe % READAHEAD_NUM_STRIPES],
+				       __ATOMIC_SEQ_CST);
+	}
+
+	return gen;
+}
+
+static void
+readahead_bump_gen(struct vbdev_readahead *node, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t first, last, stripe;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	first = offset_blocks / node->max_window_blocks;
+	last = (offset_blocks + num_blocks - 1) / node->max_window_blocks;
+	if (last - first >= READAHEAD_NUM_STRIPES) {
+		first = 0;
+		last = READAHEAD_NUM_STRIPES - 1;
+	}
+
+	for (stripe = first; stripe <= last; stripe++) {
+		__atomic_fetch_add(&node->stripe_gen[stripe % READAHEAD_NUM_STRIPES], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static bool
+readahead_reserve_memory(struct vbdev_readahead *node, uint64_t len)
+{
+	uint64_t used = __atomic_load_n(&node->memory_used, __ATOMIC_RELAXED);
+
+	do {
+		if (used + len > node->memory_cap) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&node->memory_used, &used, used + len, false,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return true;
+}
+
+static void
+readahead_buf_free(struct readahead_io_channel *ra_ch, struct readahead_buf *buf)
+{
+	assert(buf->state != READAHEAD_BUF_FREE);
+	assert(TAILQ_EMPTY(&buf->waiters));
+
+	spdk_iobuf_put(&ra_ch->iobuf, buf->data, buf->len);
+	__atomic_fetch_sub(&ra_ch->node->memory_used, buf->len, __ATOMIC_RELAXED);
+	buf->data = NULL;
+	buf->drop = false;
+	buf->state = READAHEAD_BUF_FREE;
+}
+
+/* Give a buffer that is no longer needed back and adapt the window of its stream to
+ * how much of it was read.
+ */
+static void
+readahead_buf_release(struct readahead_io_channel *ra_ch, struct readahead_buf *buf)
+{
+	struct readahead_stream *stream = buf->stream;
+	struct vbdev_readahead *node = ra_ch->node;
+
+	if (buf->used_blocks >= buf->num_blocks) {
+		stream->window_blocks = spdk_min(stream->window_blocks * 2, node->max_window_blocks);
+	} else {
+		stream->wasted_bytes += (buf->num_blocks - buf->used_blocks) * node->ra_bdev.blocklen;
+		stream->window_blocks = spdk_max(stream->window_blocks / 2, node->min_window_blocks);
+	}
+
+	readahead_buf_free(ra_ch, buf);
+}
+
+/* Drop a buffer whose data must not be used anymore. An outstanding prefetch cannot be
+ * stopped, so its buffer is only marked and released when the prefetch completes.
+ */
+static void
+readahead_buf_discard(struct readahead_io_channel *ra_ch, struct readahead_buf *buf)
+{
+	switch (buf->state) {
+	case READAHEAD_BUF_PENDING:
+		buf->drop = true;
+		break;
+	case READAHEAD_BUF_VALID:
+		buf->stream->wasted_bytes += (buf->num_blocks - spdk_min(buf->used_blocks, buf->num_blocks)) *
+					     ra_ch->node->ra_bdev.blocklen;
+		readahead_buf_free(ra_ch, buf);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+readahead_discard_range(struct readahead_io_channel *ra_ch, uint64_t offset_blocks,
+			uint64_t num_blocks)
+{
+	struct readahead_buf *buf;
+	uint32_t i, j;
+
+	for (i = 0; i < ra_ch->num_streams; i++) {
+		for (j = 0; j < READAHEAD_BUFS_PER_STREAM; j++) {
+			buf = &ra_ch->streams[i].bufs[j];
+			if (buf->state != READAHEAD_BUF_FREE &&
+			    buf->offset_blocks < offset_blocks + num_blocks &&
+			    offset_blocks < buf->offset_blocks + buf->num_blocks) {
+				readahead_buf_discard(ra_ch, buf);
+			}
+		}
+	}
+}
+
+/* Find the buffer that holds, or is about to hold, all of the blocks of a read. */
+static struct readahead_buf *
+readahead_find_buf(struct readahead_io_channel *ra_ch, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct readahead_buf *buf;
+	uint32_t i, j;
+
+	for (i = 0; i < ra_ch->num_streams; i++) {
+		for (j = 0; j < READAHEAD_BUFS_PER_STREAM; j++) {
+			buf = &ra_ch->streams[i].bufs[j];
+			if (buf->state != READAHEAD_BUF_FREE && !buf->drop &&
+			    offset_blocks >= buf->offset_blocks &&
+			    offset_blocks + num_blocks <= buf->offset_blocks + buf->num_blocks) {
+				return buf;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static struct readahead_stream *
+readahead_find_stream(struct readahead_io_channel *ra_ch, uint64_t offset_blocks)
+{
+	uint32_t i;
+
+	for (i = 0; i < ra_ch->num_streams; i++) {
+		if (ra_ch->streams[i].sequential_reads > 0 &&
+		    ra_ch->streams[i].next_offset == offset_blocks) {
+			return &ra_ch->streams[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Start tracking a new stream in place of the least recently used one. */
+static struct readahead_stream *
+readahead_stream_replace(struct readahead_io_channel *ra_ch)
+{
+	struct readahead_stream *stream = &ra_ch->streams[0];
+	uint32_t i;
+
+	for (i = 1; i < ra_ch->num_streams; i++) {
+		if (ra_ch->streams[i].last_used < stream->last_used) {
+			stream = &ra_ch->streams[i];
+		}
+	}
+
+	for (i = 0; i < READAHEAD_BUFS_PER_STREAM; i++) {
+		readahead_buf_discard(ra_ch, &stream->bufs[i]);
+	}
+
+	stream->sequential_reads = 0;
+	stream->window_blocks = ra_ch->node->min_window_blocks;
+	stream->hits = 0;
+	stream->misses = 0;
+	stream->prefetches = 0;
+	stream->prefetched_bytes = 0;
+	stream->wasted_bytes = 0;
+
+	return stream;
+}
+
+static void
+readahead_iobuf_get_cb(struct spdk_iobuf_entry *entry, void *data)
+{
+	struct readahead_buf *buf = SPDK_CONTAINEROF(entry, struct readahead_buf, iobuf_entry);
+
+	/* Waiting for a buffer is aborted right away, this is not expected to be called. */
+	spdk_iobuf_put(&buf->stream->ra_ch->iobuf, data, buf->len);
+}
+
+static void readahead_read_base(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+static void _device_unregister_cb(void *io_device);
+
+static void
+readahead_copy_to_io(struct vbdev_readahead *node, struct readahead_buf *buf,
+		     struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_iov_xfer ix;
+	uint32_t blocklen = node->ra_bdev.blocklen;
+
+	spdk_iov_xfer_init(&ix, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+	spdk_iov_xfer_from_buf(&ix, (uint8_t *)buf->data +
+			       (bdev_io->u.bdev.offset_blocks - buf->offset_blocks) * blocklen,
+			       bdev_io->u.bdev.num_blocks * blocklen);
+	buf->used_blocks += bdev_io->u.bdev.num_blocks;
+}
+
+static void
+readahead_node_put_ref_msg(void *ctx)
+{
+	struct vbdev_readahead *node = ctx;
+
+	spdk_bdev_close(node->base_desc);
+	spdk_io_device_unregister(node, _device_unregister_cb);
+	spdk_bdev_destruct_done(&node->ra_bdev, 0);
+}
+
+/* The last reference is dropped by the last prefetch of a destructed bdev, which
+ * finishes the destruction.
+ */
+static void
+readahead_node_put_ref(struct vbdev_readahead *node)
+{
+	if (__atomic_sub_fetch(&node->refs, 1, __ATOMIC_SEQ_CST) == 0) {
+		spdk_thread_send_msg(node->thread, readahead_node_put_ref_msg, node);
+	}
+}
+
+static void
+readahead_prefetch_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct readahead_buf *buf = cb_arg;
+	struct readahead_stream *stream = buf->stream;
+	struct readahead_io_channel *ra_ch = stream->ra_ch;
+	struct vbdev_readahead *node = ra_ch->node;
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(ra_ch);
+	TAILQ_HEAD(, spdk_bdev_io) waiters;
+	struct spdk_bdev_io *orig_io;
+	bool valid;
+
+	spdk_bdev_free_io(bdev_io);
+
+	valid = success && readahead_get_gen(node, buf->offset_blocks, buf->num_blocks) == buf->gen;
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &buf->waiters, spdk_bdev_io, module_link);
+
+	/* Settle the state of the buffer before any completion callback can submit new I/O. */
+	if (valid) {
+		TAILQ_FOREACH(orig_io, &waiters, module_link) {
+			readahead_copy_to_io(node, buf, orig_io);
+		}
+		buf->state = READAHEAD_BUF_VALID;
+		if (buf->drop) {
+			readahead_buf_discard(ra_ch, buf);
+		} else if (buf->offset_blocks + buf->num_blocks <= stream->next_offset) {
+			readahead_buf_release(ra_ch, buf);
+		}
+	} else {
+		readahead_buf_free(ra_ch, buf);
+	}
+
+	while ((orig_io = TAILQ_FIRST(&waiters))) {
+		TAILQ_REMOVE(&waiters, orig_io, module_link);
+		if (valid) {
+			spdk_bdev_io_complete(orig_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		} else {
+			readahead_read_base(ch, orig_io);
+		}
+	}
+
+	/* Drop the references taken when the prefetch was issued. */
+	spdk_put_io_channel(ch);
+	readahead_node_put_ref(node);
+}
+
+/* Keep up to READAHEAD_BUFS_PER_STREAM windows of data in flight ahead of the stream. */
+static void
+readahead_stream_prefetch(struct readahead_io_channel *ra_ch, struct readahead_stream *stream)
+{
+	struct vbdev_readahead *node = ra_ch->node;
+	struct readahead_buf *buf;
+	uint64_t end = stream->next_offset, num_blocks, len;
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < READAHEAD_BUFS_PER_STREAM; i++) {
+		buf = &stream->bufs[i];
+		if (buf->state != READAHEAD_BUF_FREE && !buf->drop) {
+			end = spdk_max(end, buf->offset_blocks + buf->num_blocks);
+		}
+	}
+
+	for (i = 0; i < READAHEAD_BUFS_PER_STREAM && end < node->ra_bdev.blockcnt; i++) {
+		buf = &stream->bufs[i];
+		if (buf->state != READAHEAD_BUF_FREE) {
+			continue;
+		}
+
+		num_blocks = spdk_min(stream->window_blocks, node->ra_bdev.blockcnt - end);
+		len = num_blocks * node->ra_bdev.blocklen;
+		if (!readahead_reserve_memory(node, len)) {
+			ra_ch->prefetches_skipped++;
+			return;
+		}
+
+		buf->data = spdk_iobuf_get(&ra_ch->iobuf, len, &buf->iobuf_entry, readahead_iobuf_get_cb);
+		if (buf->data == NULL) {
+			/* Do not wait for a buffer, the stream may have moved on by then. */
+			spdk_iobuf_entry_abort(&ra_ch->iobuf, &buf->iobuf_entry, len);
+			__atomic_fetch_sub(&node->memory_used, len, __ATOMIC_RELAXED);
+			ra_ch->prefetches_skipped++;
+			return;
+		}
+
+		buf->offset_blocks = end;
+		buf->num_blocks = num_blocks;
+		buf->used_blocks = 0;
+		buf->len = len;
+		buf->drop = false;
+		buf->gen = readahead_get_gen(node, end, num_blocks);
+		buf->state = READAHEAD_BUF_PENDING;
+
+		rc = spdk_bdev_read_blocks(node->base_desc, ra_ch->base_ch, buf->data, end, num_blocks,
+					   readahead_prefetch_done, buf);
+		if (rc != 0) {
+			readahead_buf_free(ra_ch, buf);
+			ra_ch->prefetches_skipped++;
+			return;
+		}
+
+		/* The channel and the node must outlive the prefetch, which no user I/O waits for. */
+		spdk_get_io_channel(node);
+		__atomic_fetch_add(&node->refs, 1, __ATOMIC_SEQ_CST);
+
+		stream->prefetches++;
+		stream->prefetched_bytes += len;
+		end += num_blocks;
+	}
+}
+
+/* Account a read to a stream, or to a new one if it does not continue any, release the
+ * buffers the stream has read past and read ahead of it if it is sequential.
+ */
+static void
+readahead_stream_access(struct readahead_io_channel *ra_ch, struct readahead_stream *stream,
+			uint64_t offset_blocks, uint64_t num_blocks, bool hit)
+{
+	struct readahead_buf *buf;
+	uint32_t i;
+
+	if (stream == NULL) {
+		stream = readahead_stream_replace(ra_ch);
+		stream->next_offset = offset_blocks + num_blocks;
+	} else {
+		stream->next_offset = spdk_max(stream->next_offset, offset_blocks + num_blocks);
+	}
+
+	stream->sequential_reads++;
+	stream->last_used = ++ra_ch->tick;
+	if (hit) {
+		stream->hits++;
+	} else {
+		stream->misses++;
+	}
+
+	for (i = 0; i < READAHEAD_BUFS_PER_STREAM; i++) {
+		buf = &stream->bufs[i];
+		if (buf->state == READAHEAD_BUF_VALID &&
+		    buf->offset_blocks + buf->num_blocks <= stream->next_offset) {
+			readahead_buf_release(ra_ch, buf);
+		}
+	}
+
+	if (stream->sequential_reads >= READAHEAD_SEQUENTIAL_THRESHOLD) {
+		readahead_stream_prefetch(ra_ch, stream);
+	}
+}
+
+/* The channels have released their streams and prefetch buffers by now. */
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_readahead *ra_node = io_device;
+
+	free(ra_node->ra_bdev.name);
+	free(ra_node);
+}
+
+static void
+_vbdev_readahead_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+/* Called when the readahead bdev is unregistered. Prefetches may still be running on
+ * the base bdev, in which case the last of them finishes the destruction, see
+ * readahead_node_put_ref().
+ */
+static int
+vbdev_readahead_destruct(void *ctx)
+{
+	struct vbdev_readahead *ra_node = (struct vbdev_readahead *)ctx;
+
+	TAILQ_REMOVE(&g_readahead_nodes, ra_node, link);
+
+	spdk_bdev_module_release_bdev(ra_node->base_bdev);
+
+	/* Drop the reference taken at registration. */
+	if (__atomic_sub_fetch(&ra_node->refs, 1, __ATOMIC_SEQ_CST) != 0) {
+		return 1;
+	}
+
+	/* Nothing is in flight, base_desc can be closed right away on its thread. */
+	if (ra_node->thread && ra_node->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(ra_node->thread, _vbdev_readahead_destruct, ra_node->base_desc);
+	} else {
+		spdk_bdev_close(ra_node->base_desc);
+	}
+
+	spdk_io_device_unregister(ra_node, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+_readahead_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	int status = success ? SPDK_BDEV_IO_STATUS_SUCCESS : SPDK_BDEV_IO_STATUS_FAILED;
+
+	spdk_bdev_io_complete(orig_io, status);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+_readahead_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+
+	/* Prefetches that read the blocks while the write was outstanding are stale. */
+	readahead_bump_gen(ra_node, orig_io->u.bdev.offset_blocks, orig_io->u.bdev.num_blocks);
+
+	_readahead_complete_io(bdev_io, success, cb_arg);
+}
+
+static void
+vbdev_readahead_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct readahead_bdev_io *io_ctx = (struct readahead_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_readahead_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_readahead_queue_io(struct spdk_bdev_io *bdev_io)
+{
+	struct readahead_bdev_io *io_ctx = (struct readahead_bdev_io *)bdev_io->driver_ctx;
+	struct readahead_io_channel *ra_ch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = vbdev_readahead_resubmit_io;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	/* Wait for a base bdev_io; prefetches never get here, they're just skipped. */
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, ra_ch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in vbdev_readahead_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+readahead_init_ext_io_opts(struct spdk_bdev_io *bdev_io, struct spdk_bdev_ext_io_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->size = sizeof(*opts);
+	opts->memory_domain = bdev_io->u.bdev.memory_domain;
+	opts->memory_domain_ctx = bdev_io->u.bdev.memory_domain_ctx;
+	opts->metadata = bdev_io->u.bdev.md_buf;
+}
+
+static void
+readahead_handle_submit_error(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, int rc)
+{
+	struct readahead_bdev_io *io_ctx = (struct readahead_bdev_io *)bdev_io->driver_ctx;
+
+	if (rc == -ENOMEM) {
+		SPDK_ERRLOG("No memory, start to queue io for readahead.\n");
+		io_ctx->ch = ch;
+		vbdev_readahead_queue_io(bdev_io);
+	} else {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+readahead_read_base(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct readahead_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_bdev_ext_io_opts io_opts;
+	int rc;
+
+	readahead_init_ext_io_opts(bdev_io, &io_opts);
+	rc = spdk_bdev_readv_blocks_ext(ra_node->base_desc, ra_ch->base_ch, bdev_io->u.bdev.iovs,
+					bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					bdev_io->u.bdev.num_blocks, _readahead_complete_io,
+					bdev_io, &io_opts);
+	if (rc != 0) {
+		readahead_handle_submit_error(ch, bdev_io, rc);
+	}
+}
+
+static void
+readahead_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct readahead_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	uint64_t offset_blocks = bdev_io->u.bdev.offset_blocks;
+	uint64_t num_blocks = bdev_io->u.bdev.num_blocks;
+	struct readahead_buf *buf;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Separate metadata is not read ahead and data in foreign memory cannot be copied. */
+	if (bdev_io->u.bdev.md_buf != NULL || bdev_io->u.bdev.memory_domain != NULL) {
+		ra_ch->read_bypassed++;
+		readahead_read_base(ch, bdev_io);
+		return;
+	}
+
+	buf = readahead_find_buf(ra_ch, offset_blocks, num_blocks);
+	if (buf != NULL && buf->state == READAHEAD_BUF_VALID &&
+	    readahead_get_gen(ra_node, buf->offset_blocks, buf->num_blocks) != buf->gen) {
+		/* The blocks were written since they were prefetched. */
+		readahead_buf_discard(ra_ch, buf);
+		buf = NULL;
+	}
+
+	if (buf == NULL) {
+		ra_ch->read_misses++;
+		readahead_stream_access(ra_ch, readahead_find_stream(ra_ch, offset_blocks), offset_blocks,
+					num_blocks, false);
+		readahead_read_base(ch, bdev_io);
+		return;
+	}
+
+	ra_ch->read_hits++;
+	if (buf->state == READAHEAD_BUF_PENDING) {
+		TAILQ_INSERT_TAIL(&buf->waiters, bdev_io, module_link);
+		readahead_stream_access(ra_ch, buf->stream, offset_blocks, num_blocks, true);
+		return;
+	}
+
+	readahead_copy_to_io(ra_node, buf, bdev_io);
+	readahead_stream_access(ra_ch, buf->stream, offset_blocks, num_blocks, true);
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+/* Drop the data this channel read ahead over the blocks an I/O modifies and make the
+ * other channels notice it. The generations are bumped again when the I/O completes.
+ */
+static void
+readahead_invalidate(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+
+	readahead_bump_gen(ra_node, bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks);
+	readahead_discard_range(spdk_io_channel_get_ctx(ch), bdev_io->u.bdev.offset_blocks,
+				bdev_io->u.bdev.num_blocks);
+}
+
+/* Called when someone above submits IO to this readahead vbdev. Reads are served from
+ * the prefetched data when possible, all the other I/O is passed on to the base bdev.
+ */
+static void
+vbdev_readahead_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_readahead *ra_node = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_readahead,
+					  ra_bdev);
+	struct readahead_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_bdev_ext_io_opts io_opts;
+	int rc = 0;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, readahead_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		readahead_invalidate(ch, bdev_io);
+		readahead_init_ext_io_opts(bdev_io, &io_opts);
+		rc = spdk_bdev_writev_blocks_ext(ra_node->base_desc, ra_ch->base_ch, bdev_io->u.bdev.iovs,
+						 bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+						 bdev_io->u.bdev.num_blocks, _readahead_complete_write,
+						 bdev_io, &io_opts);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		readahead_invalidate(ch, bdev_io);
+		rc = spdk_bdev_write_zeroes_blocks(ra_node->base_desc, ra_ch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _readahead_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		readahead_invalidate(ch, bdev_io);
+		rc = spdk_bdev_unmap_blocks(ra_node->base_desc, ra_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _readahead_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		readahead_invalidate(ch, bdev_io);
+		rc = spdk_bdev_copy_blocks(ra_node->base_desc, ra_ch->base_ch,
+					   bdev_io->u.bdev.offset_blocks,
+					   bdev_io->u.bdev.copy.src_offset_blocks,
+					   bdev_io->u.bdev.num_blocks,
+					   _readahead_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(ra_node->base_desc, ra_ch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _readahead_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(ra_node->base_desc, ra_ch->base_ch,
+				     _readahead_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_ABORT:
+		rc = spdk_bdev_abort(ra_node->base_desc, ra_ch->base_ch, bdev_io->u.abort.bio_to_abort,
+				     _readahead_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("readahead: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+	if (rc != 0) {
+		readahead_handle_submit_error(ch, bdev_io, rc);
+	}
+}
+
+/* I/O that may modify data without the readahead bdev noticing, such as NVMe passthru
+ * or zcopy writes, is not supported.
+ */
+static bool
+vbdev_readahead_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_readahead *ra_node = (struct vbdev_readahead *)ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_COPY:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+	case SPDK_BDEV_IO_TYPE_ABORT:
+		return spdk_bdev_io_type_supported(ra_node->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_readahead_get_io_channel(void *ctx)
+{
+	struct vbdev_readahead *ra_node = (struct vbdev_readahead *)ctx;
+
+	return spdk_get_io_channel(ra_node);
+}
+
+static void
+vbdev_readahead_write_opts(struct spdk_json_write_ctx *w, struct vbdev_readahead *ra_node)
+{
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&ra_node->ra_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(ra_node->base_bdev));
+	spdk_json_write_named_uint32(w, "max_streams", ra_node->opts.max_streams);
+	spdk_json_write_named_uint32(w, "max_window_kb", ra_node->opts.max_window_kb);
+	spdk_json_write_named_uint32(w, "max_memory_mb", ra_node->opts.max_memory_mb);
+}
+
+/* The readahead options show up under "readahead" in bdev_get_bdevs */
+static int
+vbdev_readahead_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_readahead *ra_node = (struct vbdev_readahead *)ctx;
+
+	spdk_json_write_name(w, "readahead");
+	spdk_json_write_object_begin(w);
+	vbdev_readahead_write_opts(w, ra_node);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+/* Each readahead bdev is saved as a bdev_readahead_create call with its options. */
+static int
+vbdev_readahead_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_readahead *ra_node;
+
+	TAILQ_FOREACH(ra_node, &g_readahead_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_readahead_create");
+		spdk_json_write_named_object_begin(w, "params");
+		vbdev_readahead_write_opts(w, ra_node);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+	return 0;
+}
+
+static int
+readahead_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct readahead_io_channel *ra_ch = ctx_buf;
+	struct vbdev_readahead *ra_node = io_device;
+	struct readahead_stream *stream;
+	uint32_t i, j;
+	int rc;
+
+	ra_ch->node = ra_node;
+	ra_ch->num_streams = ra_node->opts.max_streams;
+	ra_ch->streams = calloc(ra_ch->num_streams, sizeof(*ra_ch->streams));
+	if (ra_ch->streams == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < ra_ch->num_streams; i++) {
+		stream = &ra_ch->streams[i];
+		stream->ra_ch = ra_ch;
+		stream->window_blocks = ra_node->min_window_blocks;
+		for (j = 0; j < READAHEAD_BUFS_PER_STREAM; j++) {
+			stream->bufs[j].stream = stream;
+			TAILQ_INIT(&stream->bufs[j].waiters);
+		}
+	}
+
+	rc = spdk_iobuf_channel_init(&ra_ch->iobuf, READAHEAD_IOBUF_NAME, 0, 0);
+	if (rc != 0) {
+		free(ra_ch->streams);
+		return rc;
+	}
+
+	ra_ch->base_ch = spdk_bdev_get_io_channel(ra_node->base_desc);
+	if (ra_ch->base_ch == NULL) {
+		spdk_iobuf_channel_fini(&ra_ch->iobuf);
+		free(ra_ch->streams);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+readahead_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct readahead_io_channel *ra_ch = ctx_buf;
+	struct readahead_buf *buf;
+	uint32_t i, j;
+
+	/* Outstanding prefetches hold a reference to the channel, so only valid data is left. */
+	for (i = 0; i < ra_ch->num_streams; i++) {
+		for (j = 0; j < READAHEAD_BUFS_PER_STREAM; j++) {
+			buf = &ra_ch->streams[i].bufs[j];
+			assert(buf->state != READAHEAD_BUF_PENDING);
+			if (buf->state == READAHEAD_BUF_VALID) {
+				readahead_buf_free(ra_ch, buf);
+			}
+		}
+	}
+
+	spdk_iobuf_channel_fini(&ra_ch->iobuf);
+	spdk_put_io_channel(ra_ch->base_ch);
+	free(ra_ch->streams);
+}
+
+/* Create the readahead association from the bdev and vbdev name and insert
+ * on the global list. */
+static int
+vbdev_readahead_insert_name(const char *bdev_name, const char *vbdev_name,
+			    const struct vbdev_readahead_opts *opts)
+{
+	struct bdev_names *name;
+
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(vbdev_name, name->vbdev_name) == 0) {
+			SPDK_ERRLOG("readahead bdev %s already exists\n", vbdev_name);
+			return -EEXIST;
+		}
+	}
+
+	name = calloc(1, sizeof(struct bdev_names));
+	if (!name) {
+		SPDK_ERRLOG("could not allocate bdev_names\n");
+		return -ENOMEM;
+	}
+
+	name->bdev_name = strdup(bdev_name);
+	if (!name->bdev_name) {
+		SPDK_ERRLOG("could not allocate name->bdev_name\n");
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->vbdev_name = strdup(vbdev_name);
+	if (!name->vbdev_name) {
+		SPDK_ERRLOG("could not allocate name->vbdev_name\n");
+		free(name->bdev_name);
+		free(name);
+		return -ENOMEM;
+	}
+
+	name->opts = *opts;
+	if (name->opts.max_streams == 0) {
+		name->opts.max_streams = READAHEAD_DEFAULT_MAX_STREAMS;
+	}
+	if (name->opts.max_window_kb == 0) {
+		name->opts.max_window_kb = READAHEAD_DEFAULT_MAX_WINDOW_KB;
+	}
+	if (name->opts.max_memory_mb == 0) {
+		name->opts.max_memory_mb = READAHEAD_DEFAULT_MAX_MEMORY_MB;
+	}
+
+	TAILQ_INSERT_TAIL(&g_bdev_names, name, link);
+
+	return 0;
+}
+
+static void
+vbdev_readahead_remove_name(struct bdev_names *name)
+{
+	TAILQ_REMOVE(&g_bdev_names, name, link);
+	free(name->bdev_name);
+	free(name->vbdev_name);
+	free(name);
+}
+
+static int
+vbdev_readahead_init(void)
+{
+	return spdk_iobuf_register_module(READAHEAD_IOBUF_NAME);
+}
+
+/* All readahead bdevs are unregistered by now, drop the configs and the iobuf module. */
+static void
+vbdev_readahead_finish(void)
+{
+	struct bdev_names *name;
+
+	while ((name = TAILQ_FIRST(&g_bdev_names))) {
+		vbdev_readahead_remove_name(name);
+	}
+
+	spdk_iobuf_unregister_module(READAHEAD_IOBUF_NAME);
+}
+
+static int
+vbdev_readahead_get_ctx_size(void)
+{
+	return sizeof(struct readahead_bdev_io);
+}
+
+/* Per bdev configuration is entirely covered by bdev_readahead_create. */
+static void
+vbdev_readahead_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+}
+
+/* When we register our bdev this is how we specify our entry points. Prefetched data is
+ * copied to the buffers of the I/O, so no memory domains are reported and the bdev
+ * layer bounces data in foreign memory for us.
+ */
+static const struct spdk_bdev_fn_table vbdev_readahead_fn_table = {
+	.destruct		= vbdev_readahead_destruct,
+	.submit_request		= vbdev_readahead_submit_request,
+	.io_type_supported	= vbdev_readahead_io_type_supported,
+	.get_io_channel		= vbdev_readahead_get_io_channel,
+	.dump_info_json		= vbdev_readahead_dump_info_json,
+	.write_config_json	= vbdev_readahead_write_config_json,
+};
+
+static void
+vbdev_readahead_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_readahead *ra_node, *tmp;
+
+	TAILQ_FOREACH_SAFE(ra_node, &g_readahead_nodes, link, tmp) {
+		if (bdev_find == ra_node->base_bdev) {
+			spdk_bdev_unregister(&ra_node->ra_bdev, NULL, NULL);
+		}
+	}
+}
+
+/* Removing the base bdev takes the readahead bdev down, other events don't matter. */
+static void
+vbdev_readahead_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+				   void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_readahead_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+/* Prefetch buffers come from the large iobuf pool, so the window cannot exceed its
+ * buffer size.
+ */
+static int
+vbdev_readahead_init_windows(struct vbdev_readahead *ra_node, struct spdk_bdev *bdev)
+{
+	struct spdk_iobuf_opts iobuf_opts;
+	uint64_t max_window;
+
+	spdk_iobuf_get_opts(&iobuf_opts);
+	max_window = spdk_min((uint64_t)ra_node->opts.max_window_kb * 1024, iobuf_opts.large_bufsize);
+
+	ra_node->max_window_blocks = max_window / bdev->blocklen;
+	if (ra_node->max_window_blocks == 0) {
+		SPDK_ERRLOG("readahead window of %" PRIu64 " bytes is smaller than block size %u of bdev %s\n",
+			    max_window, bdev->blocklen, bdev->name);
+		return -EINVAL;
+	}
+	ra_node->min_window_blocks = spdk_min(spdk_max(READAHEAD_MIN_WINDOW_SIZE / bdev->blocklen, 1),
+					      ra_node->max_window_blocks);
+	ra_node->memory_cap = (uint64_t)ra_node->opts.max_memory_mb * 1024 * 1024;
+
+	return 0;
+}
+
+/* Create and register the readahead vbdev if we find it in our list of bdev names.
+ * This can be called either by the examine path or RPC method.
+ */
+static int
+vbdev_readahead_register(const char *bdev_name)
+{
+	struct bdev_names *name;
+	struct vbdev_readahead *ra_node;
+	struct spdk_bdev *bdev;
+	struct spdk_uuid ns_uuid;
+	int rc = 0;
+
+	spdk_uuid_parse(&ns_uuid, BDEV_READAHEAD_NAMESPACE_UUID);
+
+	TAILQ_FOREACH(name, &g_bdev_names, link) {
+		if (strcmp(name->bdev_name, bdev_name) != 0) {
+			continue;
+		}
+
+		ra_node = calloc(1, sizeof(struct vbdev_readahead));
+		if (!ra_node) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate ra_node\n");
+			break;
+		}
+
+		ra_node->ra_bdev.name = strdup(name->vbdev_name);
+		if (!ra_node->ra_bdev.name) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate ra_bdev name\n");
+			free(ra_node);
+			break;
+		}
+		ra_node->ra_bdev.product_name = "readahead";
+
+		/* Opened for writing too, writes pass straight through to it. */
+		rc = spdk_bdev_open_ext(bdev_name, true, vbdev_readahead_base_bdev_event_cb,
+					NULL, &ra_node->base_desc);
+		if (rc) {
+			if (rc != -ENODEV) {
+				SPDK_ERRLOG("could not open bdev %s\n", bdev_name);
+			}
+			free(ra_node->ra_bdev.name);
+			free(ra_node);
+			break;
+		}
+
+		bdev = spdk_bdev_desc_get_bdev(ra_node->base_desc);
+		ra_node->base_bdev = bdev;
+		ra_node->opts = name->opts;
+
+		rc = vbdev_readahead_init_windows(ra_node, bdev);
+		if (rc) {
+			spdk_bdev_close(ra_node->base_desc);
+			free(ra_node->ra_bdev.name);
+			free(ra_node);
+			break;
+		}
+
+		/* The same base bdev always yields the same readahead bdev UUID. */
+		rc = spdk_uuid_generate_sha1(&ra_node->ra_bdev.uuid, &ns_uuid,
+					     (const char *)&ra_node->base_bdev->uuid, sizeof(struct spdk_uuid));
+		if (rc) {
+			SPDK_ERRLOG("Unable to generate new UUID for readahead bdev\n");
+			spdk_bdev_close(ra_node->base_desc);
+			free(ra_node->ra_bdev.name);
+			free(ra_node);
+			break;
+		}
+
+		/* Prefetching doesn't change the layout, expose that of the base bdev. */
+		ra_node->ra_bdev.write_cache = bdev->write_cache;
+		ra_node->ra_bdev.required_alignment = bdev->required_alignment;
+		ra_node->ra_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+		ra_node->ra_bdev.blocklen = bdev->blocklen;
+		ra_node->ra_bdev.blockcnt = bdev->blockcnt;
+
+		ra_node->ra_bdev.md_interleave = bdev->md_interleave;
+		ra_node->ra_bdev.md_len = bdev->md_len;
+		ra_node->ra_bdev.dif_type = bdev->dif_type;
+		ra_node->ra_bdev.dif_is_head_of_md = bdev->dif_is_head_of_md;
+		ra_node->ra_bdev.dif_check_flags = bdev->dif_check_flags;
+
+		ra_node->ra_bdev.ctxt = ra_node;
+		ra_node->ra_bdev.fn_table = &vbdev_readahead_fn_table;
+		ra_node->ra_bdev.module = &readahead_if;
+		ra_node->refs = 1;
+		TAILQ_INSERT_TAIL(&g_readahead_nodes, ra_node, link);
+
+		spdk_io_device_register(ra_node, readahead_bdev_ch_create_cb, readahead_bdev_ch_destroy_cb,
+					sizeof(struct readahead_io_channel),
+					name->vbdev_name);
+
+		/* base_desc is closed on this thread, by destruct or by the last prefetch. */
+		ra_node->thread = spdk_get_thread();
+
+		rc = spdk_bdev_module_claim_bdev(bdev, ra_node->base_desc, ra_node->ra_bdev.module);
+		if (rc) {
+			SPDK_ERRLOG("could not claim bdev %s\n", bdev_name);
+			spdk_bdev_close(ra_node->base_desc);
+			TAILQ_REMOVE(&g_readahead_nodes, ra_node, link);
+			spdk_io_device_unregister(ra_node, _device_unregister_cb);
+			break;
+		}
+
+		rc = spdk_bdev_register(&ra_node->ra_bdev);
+		if (rc) {
+			SPDK_ERRLOG("could not register ra_bdev\n");
+			spdk_bdev_module_release_bdev(bdev);
+			spdk_bdev_close(ra_node->base_desc);
+			TAILQ_REMOVE(&g_readahead_nodes, ra_node, link);
+			spdk_io_device_unregister(ra_node, _device_unregister_cb);
+			break;
+		}
+		SPDK_NOTICELOG("created readahead bdev %s for: %s\n", name->vbdev_name, bdev_name);
+	}
+
+	return rc;
+}
+
+/* Create the readahead disk from the given bdev and vbdev name. */
+int
+bdev_readahead_create_disk(const char *bdev_name, const char *vbdev_name,
+			   const struct vbdev_readahead_opts *opts)
+{
+	struct bdev_names *name;
+	int rc;
+
+	if (opts->max_streams > READAHEAD_MAX_STREAMS) {
+		return -EINVAL;
+	}
+
+	/* Keep the configuration around so that the readahead bdev is created when its
+	 * base bdev is examined, if it isn't there yet.
+	 */
+	rc = vbdev_readahead_insert_name(bdev_name, vbdev_name, opts);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_readahead_register(bdev_name);
+	if (rc == -ENODEV) {
+		/* Created later, once the base bdev is registered. */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc != 0) {
+		/* E.g. a window smaller than a block, examine wouldn't fix that either. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, vbdev_name) == 0) {
+				vbdev_readahead_remove_name(name);
+				break;
+			}
+		}
+	}
+
+	return rc;
+}
+
+void
+bdev_readahead_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct bdev_names *name;
+	int rc;
+
+	/* Streams and prefetch buffers are released when the bdev is destructed. */
+	rc = spdk_bdev_unregister_by_name(bdev_name, &readahead_if, cb_fn, cb_arg);
+	if (rc == 0) {
+		/* Don't bring the readahead bdev back when its base bdev reappears. */
+		TAILQ_FOREACH(name, &g_bdev_names, link) {
+			if (strcmp(name->vbdev_name, bdev_name) == 0) {
+				vbdev_readahead_remove_name(name);
+				break;
+			}
+		}
+	} else {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+struct readahead_get_stats_ctx {
+	struct vbdev_readahead_stats	*stats;
+	struct vbdev_readahead		**nodes;
+	uint32_t			num_nodes;
+	uint32_t			cur;
+	bdev_readahead_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void readahead_get_stats_next(struct readahead_get_stats_ctx *ctx);
+
+static void
+readahead_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct readahead_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct readahead_io_channel *ra_ch = spdk_io_channel_get_ctx(ch);
+	struct vbdev_readahead_stats *stats = &ctx->stats[ctx->cur];
+	struct vbdev_readahead_stream_stats *streams, *s;
+	struct readahead_stream *stream;
+	uint32_t j, num_streams = 0;
+
+	stats->read_hits += ra_ch->read_hits;
+	stats->read_misses += ra_ch->read_misses;
+	stats->read_bypassed += ra_ch->read_bypassed;
+	stats->prefetches_skipped += ra_ch->prefetches_skipped;
+
+	for (j = 0; j < ra_ch->num_streams; j++) {
+		if (ra_ch->streams[j].sequential_reads > 0) {
+			num_streams++;
+		}
+	}
+	if (num_streams == 0) {
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+
+	streams = realloc(stats->streams, (stats->num_streams + num_streams) * sizeof(*streams));
+	if (streams == NULL) {
+		SPDK_ERRLOG("could not allocate stream statistics of %s\n", stats->name);
+		spdk_for_each_channel_continue(i, 0);
+		return;
+	}
+	stats->streams = streams;
+
+	for (j = 0; j < ra_ch->num_streams; j++) {
+		stream = &ra_ch->streams[j];
+		if (stream->sequential_reads == 0) {
+			continue;
+		}
+		s = &stats->streams[stats->num_streams++];
+		s->thread_id = spdk_thread_get_id(spdk_io_channel_get_thread(ch));
+		s->next_offset_blocks = stream->next_offset;
+		s->window_size = stream->window_blocks * ra_ch->node->ra_bdev.blocklen;
+		s->sequential_reads = stream->sequential_reads;
+		s->hits = stream->hits;
+		s->misses = stream->misses;
+		s->prefetches = stream->prefetches;
+		s->prefetched_bytes = stream->prefetched_bytes;
+		s->wasted_bytes = stream->wasted_bytes;
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+readahead_get_stats_channel_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct readahead_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cur++;
+	readahead_get_stats_next(ctx);
+}
+
+static void
+readahead_get_stats_done(struct readahead_get_stats_ctx *ctx)
+{
+	uint32_t i;
+
+	ctx->cb_fn(ctx->cb_arg, ctx->stats, ctx->num_nodes);
+
+	for (i = 0; i < ctx->num_nodes; i++) {
+		free(ctx->stats[i].name);
+		free(ctx->stats[i].base_bdev_name);
+		free(ctx->stats[i].streams);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+}
+
+static void
+readahead_get_stats_next(struct readahead_get_stats_ctx *ctx)
+{
+	struct vbdev_readahead *ra_node;
+
+	while (ctx->cur < ctx->num_nodes) {
+		/* A readahead bdev may have been deleted while walking the channels of the previous one. */
+		TAILQ_FOREACH(ra_node, &g_readahead_nodes, link) {
+			if (ra_node == ctx->nodes[ctx->cur]) {
+				ctx->stats[ctx->cur].memory_used = __atomic_load_n(&ra_node->memory_used,
+								   __ATOMIC_RELAXED);
+				spdk_for_each_channel(ra_node, readahead_get_stats_channel, ctx,
+						      readahead_get_stats_channel_done);
+				return;
+			}
+		}
+		ctx->cur++;
+	}
+
+	readahead_get_stats_done(ctx);
+}
+
+int
+bdev_readahead_get_stats(const char *bdev_name, bdev_readahead_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct readahead_get_stats_ctx *ctx;
+	struct vbdev_readahead *ra_node;
+	uint32_t num_nodes = 0;
+
+	TAILQ_FOREACH(ra_node, &g_readahead_nodes, link) {
+		if (bdev_name == NULL || strcmp(bdev_name, ra_node->ra_bdev.name) == 0) {
+			num_nodes++;
+		}
+	}
+	if (bdev_name != NULL && num_nodes == 0) {
+		return -ENODEV;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+	ctx->stats = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->stats));
+	ctx->nodes = calloc(spdk_max(num_nodes, 1), sizeof(*ctx->nodes));
+	if (ctx->stats == NULL || ctx->nodes == NULL) {
+		goto err;
+	}
+
+	TAILQ_FOREACH(ra_node, &g_readahead_nodes, link) {
+		if (bdev_name != NULL && strcmp(bdev_name, ra_node->ra_bdev.name) != 0) {
+			continue;
+		}
+		ctx->nodes[ctx->num_nodes] = ra_node;
+		ctx->stats[ctx->num_nodes].name = strdup(ra_node->ra_bdev.name);
+		ctx->stats[ctx->num_nodes].base_bdev_name = strdup(spdk_bdev_get_name(ra_node->base_bdev));
+		ctx->stats[ctx->num_nodes].memory_cap = ra_node->memory_cap;
+		ctx->num_nodes++;
+		if (ctx->stats[ctx->num_nodes - 1].name == NULL ||
+		    ctx->stats[ctx->num_nodes - 1].base_bdev_name == NULL) {
+			goto err;
+		}
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	readahead_get_stats_next(ctx);
+
+	return 0;
+
+err:
+	while (ctx->num_nodes-- > 0) {
+		free(ctx->stats[ctx->num_nodes].name);
+		free(ctx->stats[ctx->num_nodes].base_bdev_name);
+	}
+	free(ctx->stats);
+	free(ctx->nodes);
+	free(ctx);
+	return -ENOMEM;
+}
+
+/* Because we specified this function in our readahead bdev function table when we
+ * registered our readahead bdev, we'll get this call anytime a new bdev shows up.
+ */
+static void
+vbdev_readahead_examine(struct spdk_bdev *bdev)
+{
+	vbdev_readahead_register(bdev->name);
+
+	spdk_bdev_module_examine_done(&readahead_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_readahead)
@@ -0,0 +1,86 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_READAHEAD_H
+#define SPDK_VBDEV_READAHEAD_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+struct vbdev_readahead_opts {
+	/* Number of sequential streams tracked by each I/O channel, 0 for default */
+	uint32_t	max_streams;
+
+	/* Largest prefetch issued for a stream in kilobytes, 0 for default */
+	uint32_t	max_window_kb;
+
+	/* Upper limit of the memory held by prefetched data in megabytes, 0 for default */
+	uint32_t	max_memory_mb;
+};
+
+/**
+ * Create new readahead bdev.
+ *
+ * \param bdev_name Bdev on which the readahead vbdev will be created.
+ * \param vbdev_name Name of the readahead bdev.
+ * \param opts Options of the readahead bdev.
+ * \return 0 on success, other on failure.
+ */
+int bdev_readahead_create_disk(const char *bdev_name, const char *vbdev_name,
+			       const struct vbdev_readahead_opts *opts);
+
+/**
+ * Delete readahead bdev.
+ *
+ * \param bdev_name Name of the readahead bdev.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void bdev_readahead_delete_disk(const char *bdev_name, spdk_bdev_unregister_cb cb_fn,
+				void *cb_arg);
+
+struct vbdev_readahead_stream_stats {
+	uint64_t	thread_id;
+	uint64_t	next_offset_blocks;
+	uint32_t	window_size;
+	uint64_t	sequential_reads;
+	uint64_t	hits;
+	uint64_t	misses;
+	uint64_t	prefetches;
+	uint64_t	prefetched_bytes;
+	uint64_t	wasted_bytes;
+};
+
+struct vbdev_readahead_stats {
+	char					*name;
+	char					*base_bdev_name;
+	uint64_t				memory_used;
+	uint64_t				memory_cap;
+	uint64_t				read_hits;
+	uint64_t				read_misses;
+	uint64_t				read_bypassed;
+	uint64_t				prefetches_skipped;
+	uint32_t				num_streams;
+	struct vbdev_readahead_stream_stats	*streams;
+};
+
+typedef void (*bdev_readahead_get_stats_cb)(void *cb_arg, const struct vbdev_readahead_stats *stats,
+		uint32_t num_stats);
+
+/**
+ * Collect the statistics of readahead bdevs and of the streams they currently track.
+ *
+ * \param bdev_name Name of the readahead bdev, or NULL for all of them.
+ * \param cb_fn Function to call with the statistics once they are collected from all channels.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 on success, -ENODEV if bdev_name is not a readahead bdev, -ENOMEM if memory
+ * could not be allocated. cb_fn is called only on success.
+ */
+int bdev_readahead_get_stats(const char *bdev_name, bdev_readahead_get_stats_cb cb_fn,
+			     void *cb_arg);
+
+#endif /* SPDK_VBDEV_READAHEAD_H */
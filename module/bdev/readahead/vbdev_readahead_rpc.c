@@ -0,0 +1,192 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_readahead.h"
+#include "spdk/rpc.h"
+#include "spdk/util.h"
+#include "spdk/string.h"
+#include "spdk/log.h"
+
+struct rpc_bdev_readahead_create {
+	char *base_bdev_name;
+	char *name;
+	struct vbdev_readahead_opts opts;
+};
+
+static void
+free_rpc_bdev_readahead_create(struct rpc_bdev_readahead_create *r)
+{
+	free(r->base_bdev_name);
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_readahead_create_decoders[] = {
+	{"base_bdev_name", offsetof(struct rpc_bdev_readahead_create, base_bdev_name), spdk_json_decode_string},
+	{"name", offsetof(struct rpc_bdev_readahead_create, name), spdk_json_decode_string},
+	{"max_streams", offsetof(struct rpc_bdev_readahead_create, opts.max_streams), spdk_json_decode_uint32, true},
+	{"max_window_kb", offsetof(struct rpc_bdev_readahead_create, opts.max_window_kb), spdk_json_decode_uint32, true},
+	{"max_memory_mb", offsetof(struct rpc_bdev_readahead_create, opts.max_memory_mb), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_bdev_readahead_create(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_readahead_create req = {NULL};
+	struct spdk_json_write_ctx *w;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_readahead_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_readahead_create_decoders),
+				    &req)) {
+		SPDK_DEBUGLOG(vbdev_readahead, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_readahead_create_disk(req.base_bdev_name, req.name, &req.opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_string(w, req.name);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_readahead_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_readahead_create", rpc_bdev_readahead_create, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_readahead_delete {
+	char *name;
+};
+
+static void
+free_rpc_bdev_readahead_delete(struct rpc_bdev_readahead_delete *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_readahead_delete_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_readahead_delete, name), spdk_json_decode_string},
+};
+
+static void
+rpc_bdev_readahead_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_readahead_delete(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_readahead_delete req = {NULL};
+
+	if (spdk_json_decode_object(params, rpc_bdev_readahead_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_readahead_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev_readahead_delete_disk(req.name, rpc_bdev_readahead_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_readahead_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_readahead_delete", rpc_bdev_readahead_delete, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_readahead_get_stats {
+	char *name;
+};
+
+static void
+free_rpc_bdev_readahead_get_stats(struct rpc_bdev_readahead_get_stats *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_readahead_get_stats_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_readahead_get_stats, name), spdk_json_decode_string, true},
+};
+
+static void
+rpc_bdev_readahead_get_stats_cb(void *cb_arg, const struct vbdev_readahead_stats *stats,
+				uint32_t num_stats)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	const struct vbdev_readahead_stream_stats *stream;
+	struct spdk_json_write_ctx *w;
+	uint32_t i, j;
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+	for (i = 0; i < num_stats; i++) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", stats[i].name);
+		spdk_json_write_named_string(w, "base_bdev_name", stats[i].base_bdev_name);
+		spdk_json_write_named_uint64(w, "memory_used", stats[i].memory_used);
+		spdk_json_write_named_uint64(w, "memory_cap", stats[i].memory_cap);
+		spdk_json_write_named_uint64(w, "read_hits", stats[i].read_hits);
+		spdk_json_write_named_uint64(w, "read_misses", stats[i].read_misses);
+		spdk_json_write_named_uint64(w, "read_bypassed", stats[i].read_bypassed);
+		spdk_json_write_named_uint64(w, "prefetches_skipped", stats[i].prefetches_skipped);
+		spdk_json_write_named_array_begin(w, "streams");
+		for (j = 0; j < stats[i].num_streams; j++) {
+			stream = &stats[i].streams[j];
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_uint64(w, "thread_id", stream->thread_id);
+			spdk_json_write_named_uint64(w, "next_offset_blocks", stream->next_offset_blocks);
+			spdk_json_write_named_uint32(w, "window_size", stream->window_size);
+			spdk_json_write_named_uint64(w, "sequential_reads", stream->sequential_reads);
+			spdk_json_write_named_uint64(w, "hits", stream->hits);
+			spdk_json_write_named_uint64(w, "misses", stream->misses);
+			spdk_json_write_named_uint64(w, "prefetches", stream->prefetches);
+			spdk_json_write_named_uint64(w, "prefetched_bytes", stream->prefetched_bytes);
+			spdk_json_write_named_uint64(w, "wasted_bytes", stream->wasted_bytes);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_bdev_readahead_get_stats(struct spdk_jsonrpc_request *request,
+			     const struct spdk_json_val *params)
+{
+	struct rpc_bdev_readahead_get_stats req = {NULL};
+	int rc;
+
+	if (params && spdk_json_decode_object(params, rpc_bdev_readahead_get_stats_decoders,
+					      SPDK_COUNTOF(rpc_bdev_readahead_get_stats_decoders),
+					      &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = bdev_readahead_get_stats(req.name, rpc_bdev_readahead_get_stats_cb, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+
+cleanup:
+	free_rpc_bdev_readahead_get_stats(&req);
+}
+SPDK_RPC_REGISTER("bdev_readahead_get_stats", rpc_bdev_readahead_get_stats, SPDK_RPC_RUNTIME)
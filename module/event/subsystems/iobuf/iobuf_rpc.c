@@ -16,6 +16,8 @@ static const struct spdk_json_object_decoder rpc_iobuf_set_options_decoders[] =
 	{"large_pool_count", offsetof(struct spdk_iobuf_opts, large_pool_count), spdk_json_decode_uint64, true},
 	{"small_bufsize", offsetof(struct spdk_iobuf_opts, small_bufsize), spdk_json_decode_uint32, true},
 	{"large_bufsize", offsetof(struct spdk_iobuf_opts, large_bufsize), spdk_json_decode_uint32, true},
+	{"enable_numa", offsetof(struct spdk_iobuf_opts, enable_numa), spdk_json_decode_bool, true},
+	{"numa_fallback", offsetof(struct spdk_iobuf_opts, numa_fallback), spdk_json_decode_bool, true},
 };
 
 static void
@@ -42,3 +44,57 @@ rpc_iobuf_set_options(struct spdk_jsonrpc_request *request, const struct spdk_js
 	spdk_jsonrpc_send_bool_response(request, true);
 }
 SPDK_RPC_REGISTER("iobuf_set_options", rpc_iobuf_set_options, SPDK_RPC_STARTUP)
+
+static void
+rpc_iobuf_write_pool_stats(struct spdk_json_write_ctx *w, const char *name,
+			   const struct spdk_iobuf_pool_stats *stats)
+{
+	spdk_json_write_named_object_begin(w, name);
+	spdk_json_write_named_uint64(w, "cache", stats->cache);
+	spdk_json_write_named_uint64(w, "depot", stats->depot);
+	spdk_json_write_named_uint64(w, "main", stats->main);
+	spdk_json_write_named_uint64(w, "retry", stats->retry);
+	spdk_json_write_named_uint64(w, "remote", stats->remote);
+	spdk_json_write_object_end(w);
+}
+
+static void
+rpc_iobuf_get_stats_done(struct spdk_iobuf_module_stats *modules, uint32_t num_modules,
+			 void *cb_arg)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+	uint32_t i;
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_array_begin(w);
+
+	for (i = 0; i < num_modules; ++i) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "module", modules[i].module);
+		rpc_iobuf_write_pool_stats(w, "small_pool", &modules[i].small_pool);
+		rpc_iobuf_write_pool_stats(w, "large_pool", &modules[i].large_pool);
+		spdk_json_write_object_end(w);
+	}
+
+	spdk_json_write_array_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_iobuf_get_stats(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	int rc;
+
+	if (params) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "iobuf_get_stats requires no parameters");
+		return;
+	}
+
+	rc = spdk_iobuf_get_stats(rpc_iobuf_get_stats_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+SPDK_RPC_REGISTER("iobuf_get_stats", rpc_iobuf_get_stats, SPDK_RPC_RUNTIME)
@@ -50,6 +50,7 @@ struct spdk_posix_sock {
 	bool			pipe_has_data;
 	bool			socket_has_data;
 	bool			zcopy;
+	bool			pollout;
 
 	int			placement_id;
 
@@ -66,6 +67,7 @@ struct spdk_posix_sock_group_impl {
 	int				fd;
 	struct spdk_has_data_list	socks_with_data;
 	int				placement_id;
+	bool				interrupt;
 };
 
 static struct spdk_sock_impl_opts g_posix_impl_opts = {
@@ -1692,13 +1694,55 @@ posix_sock_recv_next(struct spdk_sock *_sock, void **buf, void **ctx)
 	return rc;
 }
 
+static int
+posix_sock_update_pollout(struct spdk_posix_sock_group_impl *group, struct spdk_posix_sock *sock,
+			  bool pollout)
+{
+#if defined(SPDK_EPOLL)
+	struct epoll_event event;
+	int rc;
+
+	if (sock->pollout == pollout) {
+		return 0;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLERR | (pollout ? EPOLLOUT : 0);
+	event.data.ptr = sock;
+
+	rc = epoll_ctl(group->fd, EPOLL_CTL_MOD, sock->fd, &event);
+	if (rc != 0) {
+		return rc;
+	}
+
+	sock->pollout = pollout;
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 static void
 posix_sock_writev_async(struct spdk_sock *sock, struct spdk_sock_request *req)
 {
+	struct spdk_posix_sock_group_impl *group;
 	int rc;
 
 	spdk_sock_request_queue(sock, req);
 
+	/* Nobody polls the group in interrupt mode, so flush right away and wait for
+	 * EPOLLOUT if the socket could not take everything. */
+	group = __posix_group_impl(sock->group_impl);
+	if (group != NULL && group->interrupt) {
+		rc = _sock_flush(sock);
+		if (rc < 0 && errno != EAGAIN) {
+			spdk_sock_abort_requests(sock);
+		} else if (!TAILQ_EMPTY(&sock->queued_reqs)) {
+			posix_sock_update_pollout(group, __posix_sock(sock), true);
+		}
+		return;
+	}
+
 	/* If there are a sufficient number queued, just flush them out immediately. */
 	if (sock->queued_iovcnt >= IOV_BATCH_SIZE) {
 		rc = _sock_flush(sock);
@@ -1790,6 +1834,14 @@ posix_sock_is_connected(struct spdk_sock *_sock)
 	return true;
 }
 
+static int
+posix_sock_get_interrupt_fd(struct spdk_sock *_sock)
+{
+	struct spdk_posix_sock *sock = __posix_sock(_sock);
+
+	return sock->fd;
+}
+
 static struct spdk_sock_group_impl *
 posix_sock_group_impl_get_optimal(struct spdk_sock *_sock, struct spdk_sock_group_impl *hint)
 {
@@ -1966,6 +2018,8 @@ posix_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group, struct sp
 		sock->socket_has_data = false;
 	}
 
+	sock->pollout = false;
+
 	if (sock->placement_id != -1) {
 		spdk_sock_map_release(&g_map, sock->placement_id);
 	}
@@ -2063,6 +2117,15 @@ posix_sock_group_impl_poll(struct spdk_sock_group_impl *_group, int max_events,
 		}
 	}
 
+	/* Only wait for the sockets to become writable while there is still something to send,
+	 * otherwise EPOLLOUT would keep the group's fd permanently readable. */
+	if (group->interrupt) {
+		TAILQ_FOREACH(sock, &_group->socks, link) {
+			posix_sock_update_pollout(group, __posix_sock(sock),
+						  !TAILQ_EMPTY(&sock->queued_reqs));
+		}
+	}
+
 	assert(max_events > 0);
 
 #if defined(SPDK_EPOLL)
@@ -2191,6 +2254,47 @@ _sock_group_impl_close(struct spdk_sock_group_impl *_group, uint32_t enable_plac
 	return rc;
 }
 
+static int
+posix_sock_group_impl_register_interrupt(struct spdk_sock_group_impl *_group,
+		struct spdk_fd_group *fgrp, spdk_fd_fn fn, void *arg)
+{
+#if defined(SPDK_EPOLL)
+	struct spdk_posix_sock_group_impl *group = __posix_group_impl(_group);
+	int rc;
+
+	assert(!group->interrupt);
+
+	rc = SPDK_FD_GROUP_ADD(fgrp, group->fd, fn, arg);
+	if (rc != 0) {
+		return rc;
+	}
+
+	group->interrupt = true;
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+static void
+posix_sock_group_impl_unregister_interrupt(struct spdk_sock_group_impl *_group,
+		struct spdk_fd_group *fgrp)
+{
+	struct spdk_posix_sock_group_impl *group = __posix_group_impl(_group);
+	struct spdk_sock *sock;
+
+	if (!group->interrupt) {
+		return;
+	}
+
+	TAILQ_FOREACH(sock, &_group->socks, link) {
+		posix_sock_update_pollout(group, __posix_sock(sock), false);
+	}
+
+	spdk_fd_group_remove(fgrp, group->fd);
+	group->interrupt = false;
+}
+
 static int
 posix_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 {
@@ -2222,12 +2326,15 @@ static struct spdk_net_impl g_posix_net_impl = {
 	.is_ipv6	= posix_sock_is_ipv6,
 	.is_ipv4	= posix_sock_is_ipv4,
 	.is_connected	= posix_sock_is_connected,
+	.get_interrupt_fd	= posix_sock_get_interrupt_fd,
 	.group_impl_get_optimal	= posix_sock_group_impl_get_optimal,
 	.group_impl_create	= posix_sock_group_impl_create,
 	.group_impl_add_sock	= posix_sock_group_impl_add_sock,
 	.group_impl_remove_sock = posix_sock_group_impl_remove_sock,
 	.group_impl_poll	= posix_sock_group_impl_poll,
 	.group_impl_close	= posix_sock_group_impl_close,
+	.group_impl_register_interrupt	= posix_sock_group_impl_register_interrupt,
+	.group_impl_unregister_interrupt	= posix_sock_group_impl_unregister_interrupt,
 	.get_opts	= posix_sock_impl_get_opts,
 	.set_opts	= posix_sock_impl_set_opts,
 };
@@ -2271,12 +2378,15 @@ static struct spdk_net_impl g_ssl_net_impl = {
 	.is_ipv6	= posix_sock_is_ipv6,
 	.is_ipv4	= posix_sock_is_ipv4,
 	.is_connected	= posix_sock_is_connected,
+	.get_interrupt_fd	= posix_sock_get_interrupt_fd,
 	.group_impl_get_optimal	= posix_sock_group_impl_get_optimal,
 	.group_impl_create	= ssl_sock_group_impl_create,
 	.group_impl_add_sock	= posix_sock_group_impl_add_sock,
 	.group_impl_remove_sock = posix_sock_group_impl_remove_sock,
 	.group_impl_poll	= posix_sock_group_impl_poll,
 	.group_impl_close	= ssl_sock_group_impl_close,
+	.group_impl_register_interrupt	= posix_sock_group_impl_register_interrupt,
+	.group_impl_unregister_interrupt	= posix_sock_group_impl_unregister_interrupt,
 	.get_opts	= ssl_sock_impl_get_opts,
 	.set_opts	= ssl_sock_impl_set_opts,
 };
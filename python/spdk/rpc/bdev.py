@@ -5,13 +5,14 @@
 
 
 def bdev_set_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None,
-                     bdev_auto_examine=None):
+                     bdev_auto_examine=None, qos_distributed=None):
     """Set parameters for the bdev subsystem.
 
     Args:
         bdev_io_pool_size: number of bdev_io structures in shared buffer pool (optional)
         bdev_io_cache_size: maximum number of bdev_io structures cached per thread (optional)
         bdev_auto_examine: if set to false, the bdev layer will not examine every disks automatically (optional)
+        qos_distributed: if set to true, rate limited I/O is submitted on the thread of each channel (optional)
     """
     params = {}
 
@@ -21,6 +22,8 @@ def bdev_set_options(client, bdev_io_pool_size=None, bdev_io_cache_size=None,
         params['bdev_io_cache_size'] = bdev_io_cache_size
     if bdev_auto_examine is not None:
         params["bdev_auto_examine"] = bdev_auto_examine
+    if qos_distributed is not None:
+        params["qos_distributed"] = qos_distributed
     return client.call('bdev_set_options', params)
 
 
@@ -277,7 +280,8 @@ def bdev_ocf_flush_status(client, name):
 
 
 def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None, name=None, uuid=None, optimal_io_boundary=None,
-                       md_size=None, md_interleave=None, dif_type=None, dif_is_head_of_md=None):
+                       md_size=None, md_interleave=None, dif_type=None, dif_is_head_of_md=None, numa_id=None, sparse=None,
+                       extent_size=None):
     """Construct a malloc block device.
 
     Args:
@@ -291,6 +295,9 @@ def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None,
         md_interleave: metadata location, interleaved if set, and separated if omitted (optional)
         dif_type: protection information type (optional)
         dif_is_head_of_md: protection information is in the first 8 bytes of metadata (optional)
+        numa_id: NUMA node to allocate the memory from, default any (optional)
+        sparse: allocate the memory in extents on first write instead of up front (optional)
+        extent_size: size of the extents of a sparse bdev in bytes, default 1 MiB (optional)
 
     Returns:
         Name of created block device.
@@ -312,6 +319,12 @@ def bdev_malloc_create(client, num_blocks, block_size, physical_block_size=None,
         params['dif_type'] = dif_type
     if dif_is_head_of_md:
         params['dif_is_head_of_md'] = dif_is_head_of_md
+    if numa_id is not None:
+        params['numa_id'] = numa_id
+    if sparse:
+        params['sparse'] = sparse
+    if extent_size:
+        params['extent_size'] = extent_size
 
     return client.call('bdev_malloc_create', params)
 
@@ -395,7 +408,26 @@ def bdev_raid_get_bdevs(client, category):
     return client.call('bdev_raid_get_bdevs', params)
 
 
-def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, strip_size_kb=None, uuid=None):
+def bdev_raid_set_options(client, process_window_size_kb=None, process_max_bandwidth_mb_sec=None):
+    """Set options for bdev raid.
+
+    Args:
+        process_window_size_kb: Background process (e.g. rebuild) window size in KiB
+        process_max_bandwidth_mb_sec: Background process (e.g. rebuild) maximum bandwidth in MiB/s (0 = unlimited)
+    """
+    params = {}
+
+    if process_window_size_kb is not None:
+        params['process_window_size_kb'] = process_window_size_kb
+
+    if process_max_bandwidth_mb_sec is not None:
+        params['process_max_bandwidth_mb_sec'] = process_max_bandwidth_mb_sec
+
+    return client.call('bdev_raid_set_options', params)
+
+
+def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, strip_size_kb=None, uuid=None,
+                     read_policy=None, rebuild_base_bdev=None, rebuild_offset=None):
     """Create raid bdev. Either strip size arg will work but one is required.
 
     Args:
@@ -405,6 +437,9 @@ def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, stri
         raid_level: raid level of raid bdev, supported values 0
         base_bdevs: Space separated names of Nvme bdevs in double quotes, like "Nvme0n1 Nvme1n1 Nvme2n1"
         uuid: UUID for this raid bdev (optional)
+        read_policy: read balancing policy for raid1: least_outstanding, round_robin or sequential (optional)
+        rebuild_base_bdev: base bdev to resume an interrupted rebuild onto (optional)
+        rebuild_offset: offset in blocks to resume the rebuild from (optional)
 
     Returns:
         None
@@ -420,6 +455,15 @@ def bdev_raid_create(client, name, raid_level, base_bdevs, strip_size=None, stri
     if uuid:
         params['uuid'] = uuid
 
+    if read_policy:
+        params['read_policy'] = read_policy
+
+    if rebuild_base_bdev:
+        params['rebuild_base_bdev'] = rebuild_base_bdev
+
+    if rebuild_offset is not None:
+        params['rebuild_offset'] = rebuild_offset
+
     return client.call('bdev_raid_create', params)
 
 
@@ -449,6 +493,20 @@ def bdev_raid_remove_base_bdev(client, name):
     return client.call('bdev_raid_remove_base_bdev', params)
 
 
+def bdev_raid_add_base_bdev(client, raid_bdev, base_bdev):
+    """Add base bdev to existing raid bdev and rebuild it
+
+    Args:
+        raid_bdev: raid bdev name
+        base_bdev: base bdev name
+
+    Returns:
+        None
+    """
+    params = {'raid_bdev': raid_bdev, 'base_bdev': base_bdev}
+    return client.call('bdev_raid_add_base_bdev', params)
+
+
 def bdev_aio_create(client, filename, name, block_size=None, readonly=False):
     """Construct a Linux AIO block device.
 
@@ -1023,7 +1081,7 @@ def bdev_nvme_set_multipath_policy(client, name, policy, selector, rr_min_io):
     Args:
         name: NVMe bdev name
         policy: Multipath policy (active_passive or active_active)
-        selector: Multipath selector (round_robin, queue_depth)
+        selector: Multipath selector (round_robin, queue_depth, service_time)
         rr_min_io: Number of IO to route to a path before switching to another one (optional)
     """
 
@@ -1037,6 +1095,23 @@ def bdev_nvme_set_multipath_policy(client, name, policy, selector, rr_min_io):
     return client.call('bdev_nvme_set_multipath_policy', params)
 
 
+def bdev_nvme_set_read_hedging(client, name, percentile, budget_percent=None):
+    """Set read hedging of the NVMe bdev
+
+    Args:
+        name: NVMe bdev name
+        percentile: Read latency percentile of an I/O path after which a read is duplicated on another one, 0 to disable
+        budget_percent: Maximum number of hedged reads as a percentage of all reads (optional)
+    """
+
+    params = {'name': name,
+              'percentile': percentile}
+    if budget_percent:
+        params['budget_percent'] = budget_percent
+
+    return client.call('bdev_nvme_set_read_hedging', params)
+
+
 def bdev_nvme_get_path_iostat(client, name):
     """Get I/O statistics for IO paths of the block device.
 
@@ -1370,6 +1445,156 @@ def bdev_passthru_delete(client, name):
     return client.call('bdev_passthru_delete', params)
 
 
+def bdev_cache_create(client, base_bdev_name, name, size_mb, line_size=None, num_shards=None):
+    """Construct a read cache block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        size_mb: size of the cache in MiB
+        line_size: size of a cache line in bytes, a multiple of the block size (optional)
+        num_shards: number of independently locked shards of the cache (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+        'size_mb': size_mb,
+    }
+    if line_size is not None:
+        params['line_size'] = line_size
+    if num_shards is not None:
+        params['num_shards'] = num_shards
+    return client.call('bdev_cache_create', params)
+
+
+def bdev_cache_delete(client, name):
+    """Remove read cache bdev from the system.
+
+    Args:
+        name: name of read cache bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_cache_delete', params)
+
+
+def bdev_cache_get_stats(client, name=None):
+    """Get hit, miss and eviction statistics of read cache bdevs.
+
+    Args:
+        name: name of read cache bdev (optional)
+
+    Returns:
+        List of statistics of read cache bdevs.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_cache_get_stats', params)
+
+
+def bdev_dedup_create(client, base_bdev_name, name, chunk_size=None, logical_size_mb=None):
+    """Construct a deduplicating block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        chunk_size: deduplication granularity and block size in bytes, used when the base bdev is formatted (optional)
+        logical_size_mb: size exposed by the block device in MiB, used when the base bdev is formatted (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+    }
+    if chunk_size is not None:
+        params['chunk_size'] = chunk_size
+    if logical_size_mb is not None:
+        params['logical_size_mb'] = logical_size_mb
+    return client.call('bdev_dedup_create', params)
+
+
+def bdev_dedup_delete(client, name):
+    """Remove dedup bdev from the system.
+
+    Args:
+        name: name of dedup bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_dedup_delete', params)
+
+
+def bdev_dedup_get_stats(client, name=None):
+    """Get space usage, dedup ratio and write statistics of dedup bdevs.
+
+    Args:
+        name: name of dedup bdev (optional)
+
+    Returns:
+        List of statistics of dedup bdevs.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_dedup_get_stats', params)
+
+
+def bdev_readahead_create(client, base_bdev_name, name, max_streams=None, max_window_kb=None,
+                          max_memory_mb=None):
+    """Construct a readahead block device.
+
+    Args:
+        base_bdev_name: name of the existing bdev
+        name: name of block device
+        max_streams: number of sequential streams tracked per I/O channel (optional)
+        max_window_kb: largest prefetch issued for a stream in KiB (optional)
+        max_memory_mb: limit of memory held by prefetched data in MiB (optional)
+
+    Returns:
+        Name of created block device.
+    """
+    params = {
+        'base_bdev_name': base_bdev_name,
+        'name': name,
+    }
+    if max_streams is not None:
+        params['max_streams'] = max_streams
+    if max_window_kb is not None:
+        params['max_window_kb'] = max_window_kb
+    if max_memory_mb is not None:
+        params['max_memory_mb'] = max_memory_mb
+    return client.call('bdev_readahead_create', params)
+
+
+def bdev_readahead_delete(client, name):
+    """Remove readahead bdev from the system.
+
+    Args:
+        name: name of readahead bdev to delete
+    """
+    params = {'name': name}
+    return client.call('bdev_readahead_delete', params)
+
+
+def bdev_readahead_get_stats(client, name=None):
+    """Get hit, miss and per stream statistics of readahead bdevs.
+
+    Args:
+        name: name of readahead bdev (optional)
+
+    Returns:
+        List of statistics of readahead bdevs.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_readahead_get_stats', params)
+
+
 def bdev_opal_create(client, nvme_ctrlr_name, nsid, locking_range_id, range_start, range_length, password):
     """Create opal virtual block devices from a base nvme bdev.
 
@@ -1657,6 +1882,19 @@ def bdev_get_histogram(client, name):
     return client.call('bdev_get_histogram', params)
 
 
+def bdev_get_histogram_percentiles(client, name, reset=None):
+    """Get latency percentiles by I/O type and size class for specified bdev.
+
+    Args:
+        name: name of bdev
+        reset: reset the histograms after they are read (optional)
+    """
+    params = {'name': name}
+    if reset is not None:
+        params['reset'] = reset
+    return client.call('bdev_get_histogram_percentiles', params)
+
+
 def bdev_error_inject_error(client, name, io_type, error_type, num,
                             corrupt_offset, corrupt_value):
     """Inject an error via an error bdev.
@@ -1728,6 +1966,136 @@ def bdev_set_qos_limit(
     return client.call('bdev_set_qos_limit', params)
 
 
+def bdev_get_qos_stats(client, name=None):
+    """Get the rates achieved under the QoS rate limits of block devices.
+
+    Args:
+        name: name of block device (optional)
+
+    Returns:
+        Achieved rates and accuracy of the rate limits of each block device with QoS enabled.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_get_qos_stats', params)
+
+
+def bdev_qos_group_create(
+        client,
+        name,
+        parent=None,
+        weight=None,
+        rw_ios_per_sec=None,
+        rw_mbytes_per_sec=None,
+        r_mbytes_per_sec=None,
+        w_mbytes_per_sec=None,
+        reserved_rw_ios_per_sec=None,
+        reserved_rw_mbytes_per_sec=None,
+        reserved_r_mbytes_per_sec=None,
+        reserved_w_mbytes_per_sec=None):
+    """Create a QoS group sharing its rate limits between the block devices that join it.
+
+    Args:
+        name: name of the QoS group
+        parent: name of the parent QoS group (optional)
+        weight: share of the parent's budget left over after the reservations (optional, default 1)
+        rw_ios_per_sec: R/W IOs per second limit. 0 means unlimited.
+        rw_mbytes_per_sec: R/W megabytes per second limit. 0 means unlimited.
+        r_mbytes_per_sec: Read megabytes per second limit. 0 means unlimited.
+        w_mbytes_per_sec: Write megabytes per second limit. 0 means unlimited.
+        reserved_rw_ios_per_sec: R/W IOs per second guaranteed out of the parent's limit
+        reserved_rw_mbytes_per_sec: R/W megabytes per second guaranteed out of the parent's limit
+        reserved_r_mbytes_per_sec: Read megabytes per second guaranteed out of the parent's limit
+        reserved_w_mbytes_per_sec: Write megabytes per second guaranteed out of the parent's limit
+    """
+    params = {}
+    params['name'] = name
+    if parent is not None:
+        params['parent'] = parent
+    if weight is not None:
+        params['weight'] = weight
+    if rw_ios_per_sec is not None:
+        params['rw_ios_per_sec'] = rw_ios_per_sec
+    if rw_mbytes_per_sec is not None:
+        params['rw_mbytes_per_sec'] = rw_mbytes_per_sec
+    if r_mbytes_per_sec is not None:
+        params['r_mbytes_per_sec'] = r_mbytes_per_sec
+    if w_mbytes_per_sec is not None:
+        params['w_mbytes_per_sec'] = w_mbytes_per_sec
+    if reserved_rw_ios_per_sec is not None:
+        params['reserved_rw_ios_per_sec'] = reserved_rw_ios_per_sec
+    if reserved_rw_mbytes_per_sec is not None:
+        params['reserved_rw_mbytes_per_sec'] = reserved_rw_mbytes_per_sec
+    if reserved_r_mbytes_per_sec is not None:
+        params['reserved_r_mbytes_per_sec'] = reserved_r_mbytes_per_sec
+    if reserved_w_mbytes_per_sec is not None:
+        params['reserved_w_mbytes_per_sec'] = reserved_w_mbytes_per_sec
+    return client.call('bdev_qos_group_create', params)
+
+
+def bdev_qos_group_delete(client, name):
+    """Delete a QoS group without block devices and child groups.
+
+    Args:
+        name: name of the QoS group
+    """
+    params = {'name': name}
+    return client.call('bdev_qos_group_delete', params)
+
+
+def bdev_qos_group_add_bdev(client, name, group):
+    """Add a block device to a QoS group.
+
+    Args:
+        name: name of block device
+        group: name of the QoS group, which must not have child groups
+    """
+    params = {'name': name, 'group': group}
+    return client.call('bdev_qos_group_add_bdev', params)
+
+
+def bdev_qos_group_remove_bdev(client, name):
+    """Remove a block device from its QoS group.
+
+    Args:
+        name: name of block device
+    """
+    params = {'name': name}
+    return client.call('bdev_qos_group_remove_bdev', params)
+
+
+def bdev_qos_group_get_stats(client, name=None):
+    """Get the configuration and achieved rates of QoS groups.
+
+    Args:
+        name: name of the QoS group (optional)
+
+    Returns:
+        List of QoS groups.
+    """
+    params = {}
+    if name:
+        params['name'] = name
+    return client.call('bdev_qos_group_get_stats', params)
+
+
+def bdev_set_write_coalescing(client, name, window_us, max_size_kb=None):
+    """Set write coalescing parameters of a block device.
+
+    Args:
+        name: name of block device
+        window_us: maximum time in microseconds a write is held back. 0 disables coalescing.
+        max_size_kb: maximum size in KiB of a coalesced write (optional, default 128)
+    """
+    params = {}
+    params['name'] = name
+    params['window_us'] = window_us
+    if max_size_kb is not None:
+        params['max_size_kb'] = max_size_kb
+    return client.call('bdev_set_write_coalescing', params)
+
+
 def bdev_nvme_apply_firmware(client, bdev_name, filename):
     """Download and commit firmware to NVMe device.
 
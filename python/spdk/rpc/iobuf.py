@@ -3,7 +3,8 @@
 #  All rights reserved.
 
 
-def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize, large_bufsize):
+def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize, large_bufsize,
+                      enable_numa=None, numa_fallback=None):
     """Set iobuf pool options.
 
     Args:
@@ -11,6 +12,8 @@ def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize,
         large_pool_count: number of large buffers in the global pool
         small_bufsize: size of a small buffer
         large_bufsize: size of a large buffer
+        enable_numa: create separate pools on each NUMA node
+        numa_fallback: allow taking buffers from other NUMA nodes when the local pool is exhausted
     """
     params = {}
 
@@ -22,5 +25,15 @@ def iobuf_set_options(client, small_pool_count, large_pool_count, small_bufsize,
         params['small_bufsize'] = small_bufsize
     if large_bufsize is not None:
         params['large_bufsize'] = large_bufsize
+    if enable_numa is not None:
+        params['enable_numa'] = enable_numa
+    if numa_fallback is not None:
+        params['numa_fallback'] = numa_fallback
 
     return client.call('iobuf_set_options', params)
+
+
+def iobuf_get_stats(client):
+    """Get iobuf statistics of each registered module"""
+
+    return client.call('iobuf_get_stats')
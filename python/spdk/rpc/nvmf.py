@@ -577,6 +577,33 @@ def nvmf_get_stats(client, tgt_name=None):
     return client.call('nvmf_get_stats', params)
 
 
+def nvmf_migrate_qpair(client, nqn, cntlid, qid, thread, tgt_name=None):
+    """Move an I/O qpair to the poll group running on another thread.
+
+    Args:
+        nqn: Subsystem NQN.
+        cntlid: ID of the controller the qpair belongs to.
+        qid: ID of the I/O qpair.
+        thread: Name of the thread of the destination poll group.
+        tgt_name: name of the parent NVMe-oF target (optional).
+
+    Returns:
+        True or False
+    """
+
+    params = {
+        'nqn': nqn,
+        'cntlid': cntlid,
+        'qid': qid,
+        'thread': thread,
+    }
+
+    if tgt_name:
+        params['tgt_name'] = tgt_name
+
+    return client.call('nvmf_migrate_qpair', params)
+
+
 def nvmf_set_crdt(client, crdt1=None, crdt2=None, crdt3=None):
     """Set the 3 crdt (Command Retry Delay Time) values
 
@@ -204,7 +204,8 @@ if __name__ == "__main__":
         rpc.bdev.bdev_set_options(args.client,
                                   bdev_io_pool_size=args.bdev_io_pool_size,
                                   bdev_io_cache_size=args.bdev_io_cache_size,
-                                  bdev_auto_examine=args.bdev_auto_examine)
+                                  bdev_auto_examine=args.bdev_auto_examine,
+                                  qos_distributed=args.qos_distributed)
 
     p = subparsers.add_parser('bdev_set_options',
                               help="""Set options of bdev subsystem""")
@@ -214,6 +215,8 @@ if __name__ == "__main__":
     group.add_argument('-e', '--enable-auto-examine', dest='bdev_auto_examine', help='Allow to auto examine', action='store_true')
     group.add_argument('-d', '--disable-auto-examine', dest='bdev_auto_examine', help='Not allow to auto examine', action='store_false')
     p.set_defaults(bdev_auto_examine=True)
+    p.add_argument('--qos-distributed', help='Submit rate limited I/O on the thread of each channel instead of a single QoS thread',
+                   action='store_true')
     p.set_defaults(func=bdev_set_options)
 
     def bdev_examine(args):
@@ -390,7 +393,10 @@ if __name__ == "__main__":
                                                md_size=args.md_size,
                                                md_interleave=args.md_interleave,
                                                dif_type=args.dif_type,
-                                               dif_is_head_of_md=args.dif_is_head_of_md))
+                                               dif_is_head_of_md=args.dif_is_head_of_md,
+                                               numa_id=args.numa_id,
+                                               sparse=args.sparse,
+                                               extent_size=args.extent_size))
     p = subparsers.add_parser('bdev_malloc_create', help='Create a bdev with malloc backend')
     p.add_argument('-b', '--name', help="Name of the bdev")
     p.add_argument('-u', '--uuid', help="UUID of the bdev")
@@ -409,6 +415,12 @@ if __name__ == "__main__":
                         'to be set along --dif-type. Default=0 - no protection.')
     p.add_argument('-d', '--dif-is-head-of-md', action='store_true',
                    help='Protection information is in the first 8 bytes of metadata. Default=false.')
+    p.add_argument('-n', '--numa-id', type=int,
+                   help='NUMA node to allocate the memory from. Default is any node.')
+    p.add_argument('-s', '--sparse', action='store_true',
+                   help='Allocate the memory in extents on first write instead of up front.')
+    p.add_argument('-e', '--extent-size', type=int,
+                   help='Size of the extents of a sparse bdev in bytes. Default is 1 MiB.')
     p.set_defaults(func=bdev_malloc_create)
 
     def bdev_malloc_delete(args):
@@ -904,12 +916,30 @@ if __name__ == "__main__":
                               help="""Set multipath policy of the NVMe bdev""")
     p.add_argument('-b', '--name', help='Name of the NVMe bdev', required=True)
     p.add_argument('-p', '--policy', help='Multipath policy (active_passive or active_active)', required=True)
-    p.add_argument('-s', '--selector', help='Multipath selector (round_robin, queue_depth)', required=False)
+    p.add_argument('-s', '--selector', help='Multipath selector (round_robin, queue_depth, service_time)',
+                   required=False)
     p.add_argument('-r', '--rr-min-io',
                    help='Number of IO to route to a path before switching to another for round-robin',
                    type=int, required=False)
     p.set_defaults(func=bdev_nvme_set_multipath_policy)
 
+    def bdev_nvme_set_read_hedging(args):
+        rpc.bdev.bdev_nvme_set_read_hedging(args.client,
+                                            name=args.name,
+                                            percentile=args.percentile,
+                                            budget_percent=args.budget_percent)
+
+    p = subparsers.add_parser('bdev_nvme_set_read_hedging',
+                              help="""Duplicate slow reads of the NVMe bdev on another I/O path""")
+    p.add_argument('-b', '--name', help='Name of the NVMe bdev', required=True)
+    p.add_argument('-p', '--percentile',
+                   help='Read latency percentile after which a read is hedged, e.g. 99.9. 0 disables hedging',
+                   type=float, required=True)
+    p.add_argument('-g', '--budget-percent',
+                   help='Maximum number of hedged reads as a percentage of all reads. Default: 5',
+                   type=int, required=False)
+    p.set_defaults(func=bdev_nvme_set_read_hedging)
+
     def bdev_nvme_get_path_iostat(args):
         print_dict(rpc.bdev.bdev_nvme_get_path_iostat(args.client,
                                                       name=args.name))
@@ -1167,6 +1197,108 @@ if __name__ == "__main__":
     p.add_argument('name', help='pass through bdev name')
     p.set_defaults(func=bdev_passthru_delete)
 
+    def bdev_cache_create(args):
+        print_json(rpc.bdev.bdev_cache_create(args.client,
+                                              base_bdev_name=args.base_bdev_name,
+                                              name=args.name,
+                                              size_mb=args.size_mb,
+                                              line_size=args.line_size,
+                                              num_shards=args.num_shards))
+
+    p = subparsers.add_parser('bdev_cache_create', help='Add a read cache bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the read cache bdev", required=True)
+    p.add_argument('-s', '--size-mb', help="Size of the cache in MiB", type=int, required=True)
+    p.add_argument('-l', '--line-size', help="""Size of a cache line in bytes, a multiple of the
+    block size of the base bdev. Default: 4096 rounded to the block size""", type=int)
+    p.add_argument('-n', '--num-shards', help="Number of independently locked shards. Default: 16",
+                   type=int)
+    p.set_defaults(func=bdev_cache_create)
+
+    def bdev_cache_delete(args):
+        rpc.bdev.bdev_cache_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_cache_delete', help='Delete a read cache bdev')
+    p.add_argument('name', help='read cache bdev name')
+    p.set_defaults(func=bdev_cache_delete)
+
+    def bdev_cache_get_stats(args):
+        print_dict(rpc.bdev.bdev_cache_get_stats(args.client,
+                                                 name=args.name))
+
+    p = subparsers.add_parser('bdev_cache_get_stats', help='Get statistics of read cache bdevs')
+    p.add_argument('-b', '--name', help='read cache bdev name')
+    p.set_defaults(func=bdev_cache_get_stats)
+
+    def bdev_dedup_create(args):
+        print_json(rpc.bdev.bdev_dedup_create(args.client,
+                                              base_bdev_name=args.base_bdev_name,
+                                              name=args.name,
+                                              chunk_size=args.chunk_size,
+                                              logical_size_mb=args.logical_size_mb))
+
+    p = subparsers.add_parser('bdev_dedup_create', help='Add a dedup bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the dedup bdev", required=True)
+    p.add_argument('-c', '--chunk-size', help="""Deduplication granularity and block size of the
+    dedup bdev in bytes, a power of two multiple of the base block size. Only used when the base
+    bdev is formatted. Default: 4096""", type=int)
+    p.add_argument('-s', '--logical-size-mb', help="""Size of the dedup bdev in MiB. Only used when
+    the base bdev is formatted. Default: size of the data region of the base bdev""", type=int)
+    p.set_defaults(func=bdev_dedup_create)
+
+    def bdev_dedup_delete(args):
+        rpc.bdev.bdev_dedup_delete(args.client,
+                                   name=args.name)
+
+    p = subparsers.add_parser('bdev_dedup_delete', help='Delete a dedup bdev')
+    p.add_argument('name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_delete)
+
+    def bdev_dedup_get_stats(args):
+        print_dict(rpc.bdev.bdev_dedup_get_stats(args.client,
+                                                 name=args.name))
+
+    p = subparsers.add_parser('bdev_dedup_get_stats', help='Get statistics of dedup bdevs')
+    p.add_argument('-b', '--name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_get_stats)
+
+    def bdev_readahead_create(args):
+        print_json(rpc.bdev.bdev_readahead_create(args.client,
+                                                  base_bdev_name=args.base_bdev_name,
+                                                  name=args.name,
+                                                  max_streams=args.max_streams,
+                                                  max_window_kb=args.max_window_kb,
+                                                  max_memory_mb=args.max_memory_mb))
+
+    p = subparsers.add_parser('bdev_readahead_create', help='Add a readahead bdev on existing bdev')
+    p.add_argument('-b', '--base-bdev-name', help="Name of the existing bdev", required=True)
+    p.add_argument('-p', '--name', help="Name of the readahead bdev", required=True)
+    p.add_argument('-s', '--max-streams', help="""Number of sequential streams tracked per I/O
+    channel. Default: 8, max: 64""", type=int)
+    p.add_argument('-w', '--max-window-kb', help="""Largest prefetch issued for a stream in KiB.
+    Default: 128, limited by the iobuf large buffer size""", type=int)
+    p.add_argument('-m', '--max-memory-mb', help="""Limit of the memory held by prefetched data
+    in MiB. Default: 64""", type=int)
+    p.set_defaults(func=bdev_readahead_create)
+
+    def bdev_readahead_delete(args):
+        rpc.bdev.bdev_readahead_delete(args.client,
+                                       name=args.name)
+
+    p = subparsers.add_parser('bdev_readahead_delete', help='Delete a readahead bdev')
+    p.add_argument('name', help='readahead bdev name')
+    p.set_defaults(func=bdev_readahead_delete)
+
+    def bdev_readahead_get_stats(args):
+        print_dict(rpc.bdev.bdev_readahead_get_stats(args.client,
+                                                     name=args.name))
+
+    p = subparsers.add_parser('bdev_readahead_get_stats', help='Get statistics of readahead bdevs')
+    p.add_argument('-b', '--name', help='readahead bdev name')
+    p.set_defaults(func=bdev_readahead_get_stats)
+
     def bdev_get_bdevs(args):
         print_dict(rpc.bdev.bdev_get_bdevs(args.client,
                                            name=args.name, timeout=args.timeout_ms))
@@ -1219,6 +1351,16 @@ if __name__ == "__main__":
     p.add_argument('name', help='bdev name')
     p.set_defaults(func=bdev_get_histogram)
 
+    def bdev_get_histogram_percentiles(args):
+        print_dict(rpc.bdev.bdev_get_histogram_percentiles(args.client, name=args.name,
+                                                           reset=args.reset))
+
+    p = subparsers.add_parser('bdev_get_histogram_percentiles',
+                              help='Get latency percentiles by I/O type and size class for specified bdev')
+    p.add_argument('-r', '--reset', help='Reset the histograms after reading them', action='store_true')
+    p.add_argument('name', help='bdev name')
+    p.set_defaults(func=bdev_get_histogram_percentiles)
+
     def bdev_set_qd_sampling_period(args):
         rpc.bdev.bdev_set_qd_sampling_period(args.client,
                                              name=args.name,
@@ -1257,6 +1399,99 @@ if __name__ == "__main__":
                    type=int, required=False)
     p.set_defaults(func=bdev_set_qos_limit)
 
+    def bdev_get_qos_stats(args):
+        print_dict(rpc.bdev.bdev_get_qos_stats(args.client,
+                                               name=args.name))
+
+    p = subparsers.add_parser('bdev_get_qos_stats',
+                              help='Get the rates achieved under the QoS rate limits of blockdevs')
+    p.add_argument('-b', '--name', help="Name of the blockdev. Example: Malloc0", required=False)
+    p.set_defaults(func=bdev_get_qos_stats)
+
+    def bdev_qos_group_create(args):
+        rpc.bdev.bdev_qos_group_create(args.client,
+                                       name=args.name,
+                                       parent=args.parent,
+                                       weight=args.weight,
+                                       rw_ios_per_sec=args.rw_ios_per_sec,
+                                       rw_mbytes_per_sec=args.rw_mbytes_per_sec,
+                                       r_mbytes_per_sec=args.r_mbytes_per_sec,
+                                       w_mbytes_per_sec=args.w_mbytes_per_sec,
+                                       reserved_rw_ios_per_sec=args.reserved_rw_ios_per_sec,
+                                       reserved_rw_mbytes_per_sec=args.reserved_rw_mbytes_per_sec,
+                                       reserved_r_mbytes_per_sec=args.reserved_r_mbytes_per_sec,
+                                       reserved_w_mbytes_per_sec=args.reserved_w_mbytes_per_sec)
+
+    p = subparsers.add_parser('bdev_qos_group_create',
+                              help='Create a QoS group sharing its rate limits between blockdevs')
+    p.add_argument('name', help='Name of the QoS group. Example: tenant0')
+    p.add_argument('-p', '--parent', help='Name of the parent QoS group', required=False)
+    p.add_argument('-w', '--weight', help="Share of the parent's budget left over after the reservations (default 1)",
+                   type=int, required=False)
+    p.add_argument('--rw-ios-per-sec', help='R/W IOs per second limit. 0 means unlimited.',
+                   type=int, required=False)
+    p.add_argument('--rw-mbytes-per-sec', help='R/W megabytes per second limit. 0 means unlimited.',
+                   type=int, required=False)
+    p.add_argument('--r-mbytes-per-sec', help='Read megabytes per second limit. 0 means unlimited.',
+                   type=int, required=False)
+    p.add_argument('--w-mbytes-per-sec', help='Write megabytes per second limit. 0 means unlimited.',
+                   type=int, required=False)
+    p.add_argument('--reserved-rw-ios-per-sec', help="R/W IOs per second guaranteed out of the parent's limit",
+                   type=int, required=False)
+    p.add_argument('--reserved-rw-mbytes-per-sec', help="R/W megabytes per second guaranteed out of the parent's limit",
+                   type=int, required=False)
+    p.add_argument('--reserved-r-mbytes-per-sec', help="Read megabytes per second guaranteed out of the parent's limit",
+                   type=int, required=False)
+    p.add_argument('--reserved-w-mbytes-per-sec', help="Write megabytes per second guaranteed out of the parent's limit",
+                   type=int, required=False)
+    p.set_defaults(func=bdev_qos_group_create)
+
+    def bdev_qos_group_delete(args):
+        rpc.bdev.bdev_qos_group_delete(args.client, name=args.name)
+
+    p = subparsers.add_parser('bdev_qos_group_delete', help='Delete a QoS group')
+    p.add_argument('name', help='Name of the QoS group')
+    p.set_defaults(func=bdev_qos_group_delete)
+
+    def bdev_qos_group_add_bdev(args):
+        rpc.bdev.bdev_qos_group_add_bdev(args.client, name=args.name, group=args.group)
+
+    p = subparsers.add_parser('bdev_qos_group_add_bdev', help='Add a blockdev to a QoS group')
+    p.add_argument('group', help='Name of the QoS group')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.set_defaults(func=bdev_qos_group_add_bdev)
+
+    def bdev_qos_group_remove_bdev(args):
+        rpc.bdev.bdev_qos_group_remove_bdev(args.client, name=args.name)
+
+    p = subparsers.add_parser('bdev_qos_group_remove_bdev', help='Remove a blockdev from its QoS group')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.set_defaults(func=bdev_qos_group_remove_bdev)
+
+    def bdev_qos_group_get_stats(args):
+        print_dict(rpc.bdev.bdev_qos_group_get_stats(args.client,
+                                                     name=args.name))
+
+    p = subparsers.add_parser('bdev_qos_group_get_stats',
+                              help='Get the configuration and achieved rates of QoS groups')
+    p.add_argument('-g', '--name', help="Name of the QoS group", required=False)
+    p.set_defaults(func=bdev_qos_group_get_stats)
+
+    def bdev_set_write_coalescing(args):
+        rpc.bdev.bdev_set_write_coalescing(args.client,
+                                           name=args.name,
+                                           window_us=args.window_us,
+                                           max_size_kb=args.max_size_kb)
+
+    p = subparsers.add_parser('bdev_set_write_coalescing',
+                              help='Merge adjacent writes submitted within a time window into a single write')
+    p.add_argument('name', help='Block device name')
+    p.add_argument('-w', '--window-us', help='Maximum time in microseconds a write is held back. 0 disables coalescing',
+                   type=int, required=True)
+    p.add_argument('-s', '--max-size-kb', help='Maximum size in KiB of a coalesced write. Default: 128',
+                   type=int, required=False)
+    p.set_defaults(func=bdev_set_write_coalescing)
+
     def bdev_error_inject_error(args):
         rpc.bdev.bdev_error_inject_error(args.client,
                                          name=args.name,
@@ -2105,6 +2340,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('category', help='all or online or configuring or offline')
     p.set_defaults(func=bdev_raid_get_bdevs)
 
+    def bdev_raid_set_options(args):
+        rpc.bdev.bdev_raid_set_options(args.client,
+                                       process_window_size_kb=args.process_window_size_kb,
+                                       process_max_bandwidth_mb_sec=args.process_max_bandwidth_mb_sec)
+    p = subparsers.add_parser('bdev_raid_set_options', help='Set options for bdev raid.')
+    p.add_argument('-w', '--process-window-size-kb', type=int,
+                   help="Background process (e.g. rebuild) window size in KiB")
+    p.add_argument('-b', '--process-max-bandwidth-mb-sec', type=int,
+                   help="Background process (e.g. rebuild) maximum bandwidth in MiB/s, 0 means unlimited")
+    p.set_defaults(func=bdev_raid_set_options)
+
     def bdev_raid_create(args):
         base_bdevs = []
         for u in args.base_bdevs.strip().split(" "):
@@ -2115,13 +2361,21 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                   strip_size_kb=args.strip_size_kb,
                                   raid_level=args.raid_level,
                                   base_bdevs=base_bdevs,
-                                  uuid=args.uuid)
+                                  uuid=args.uuid,
+                                  read_policy=args.read_policy,
+                                  rebuild_base_bdev=args.rebuild_base_bdev,
+                                  rebuild_offset=args.rebuild_offset)
     p = subparsers.add_parser('bdev_raid_create', help='Create new raid bdev')
     p.add_argument('-n', '--name', help='raid bdev name', required=True)
     p.add_argument('-z', '--strip-size-kb', help='strip size in KB', type=int)
     p.add_argument('-r', '--raid-level', help='raid level, raid0, raid1 and a special level concat are supported', required=True)
     p.add_argument('-b', '--base-bdevs', help='base bdevs name, whitespace separated list in quotes', required=True)
     p.add_argument('--uuid', help='UUID for this raid bdev', required=False)
+    p.add_argument('-p', '--read-policy', help='raid1 read balancing policy',
+                   choices=['least_outstanding', 'round_robin', 'sequential'], required=False)
+    p.add_argument('--rebuild-base-bdev', help='base bdev to resume an interrupted rebuild onto', required=False)
+    p.add_argument('--rebuild-offset', help='offset in blocks to resume the rebuild from', type=int,
+                   required=False)
     p.set_defaults(func=bdev_raid_create)
 
     def bdev_raid_delete(args):
@@ -2138,6 +2392,15 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='base bdev name')
     p.set_defaults(func=bdev_raid_remove_base_bdev)
 
+    def bdev_raid_add_base_bdev(args):
+        rpc.bdev.bdev_raid_add_base_bdev(args.client,
+                                         raid_bdev=args.raid_bdev,
+                                         base_bdev=args.base_bdev)
+    p = subparsers.add_parser('bdev_raid_add_base_bdev', help='Add base bdev to existing raid bdev')
+    p.add_argument('raid_bdev', help='raid bdev name')
+    p.add_argument('base_bdev', help='base bdev name')
+    p.set_defaults(func=bdev_raid_add_base_bdev)
+
     # split
     def bdev_split_create(args):
         print_array(rpc.bdev.bdev_split_create(args.client,
@@ -2637,6 +2900,23 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
     p.set_defaults(func=nvmf_get_stats)
 
+    def nvmf_migrate_qpair(args):
+        print_dict(rpc.nvmf.nvmf_migrate_qpair(args.client,
+                                               nqn=args.nqn,
+                                               cntlid=args.cntlid,
+                                               qid=args.qid,
+                                               thread=args.thread,
+                                               tgt_name=args.tgt_name))
+
+    p = subparsers.add_parser('nvmf_migrate_qpair',
+                              help='Move an I/O qpair to the poll group running on another thread')
+    p.add_argument('nqn', help='Subsystem NQN')
+    p.add_argument('cntlid', help='ID of the controller the qpair belongs to', type=int)
+    p.add_argument('qid', help='ID of the I/O qpair', type=int)
+    p.add_argument('thread', help='Name of the thread of the destination poll group')
+    p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
+    p.set_defaults(func=nvmf_migrate_qpair)
+
     def nvmf_set_crdt(args):
         print_dict(rpc.nvmf.nvmf_set_crdt(args.client, args.crdt1, args.crdt2, args.crdt3))
 
@@ -3405,14 +3685,26 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                     small_pool_count=args.small_pool_count,
                                     large_pool_count=args.large_pool_count,
                                     small_bufsize=args.small_bufsize,
-                                    large_bufsize=args.large_bufsize)
+                                    large_bufsize=args.large_bufsize,
+                                    enable_numa=args.enable_numa,
+                                    numa_fallback=args.numa_fallback)
     p = subparsers.add_parser('iobuf_set_options', help='Set iobuf pool options')
     p.add_argument('--small-pool-count', help='number of small buffers in the global pool', type=int)
     p.add_argument('--large-pool-count', help='number of large buffers in the global pool', type=int)
     p.add_argument('--small-bufsize', help='size of a small buffer', type=int)
     p.add_argument('--large-bufsize', help='size of a large buffer', type=int)
+    p.add_argument('--enable-numa', help='create separate pools on each NUMA node',
+                   action='store_true', default=None)
+    p.add_argument('--numa-fallback', help='allow taking buffers from other NUMA nodes when the local '
+                   'pool is exhausted', action='store_true', default=None)
     p.set_defaults(func=iobuf_set_options)
 
+    def iobuf_get_stats(args):
+        print_dict(rpc.iobuf.iobuf_get_stats(args.client))
+
+    p = subparsers.add_parser('iobuf_get_stats', help='Display iobuf statistics')
+    p.set_defaults(func=iobuf_get_stats)
+
     def bdev_nvme_start_mdns_discovery(args):
         rpc.bdev.bdev_nvme_start_mdns_discovery(args.client,
                                                 name=args.name,
@@ -42,4 +42,28 @@ create_job "job3"
 bdevperf_output=$($bdevperf -t 2 --json $jsonconf -j $testconf 2>&1)
 [[ $(get_num_jobs "$bdevperf_output") == "4" ]]
 cleanup
+#Test open-loop mode and JSON results.
+create_job "job0" "randread" "Malloc0"
+create_job "job1" "randwrite" "Malloc1"
+$bdevperf -t 2 --json $jsonconf -j $testconf -I 10000 -a -J $testdir/results.json
+[[ $(jq -r '.results | length' $testdir/results.json) == "2" ]]
+[[ $(jq -r '[.results[] | select(.open_loop and .rate_iops == 10000)] | length' $testdir/results.json) == "2" ]]
+[[ $(jq -r '.results[0].latency_us.percentiles[-1].percentile' $testdir/results.json) == "100" ]]
+rm -f $testdir/results.json
+cleanup
+#Test replay of a fio iolog trace.
+cat <<- EOF > $testdir/replay.iolog
+	fio version 2 iolog
+	/dev/sda add
+	/dev/sdb add
+	/dev/sda write 0 4096
+	/dev/sdb read 1048576 8192
+	/dev/sda wait 1000
+	/dev/sda trim 4096 4096
+	/dev/sdb read 8192 4096
+EOF
+$bdevperf -t 2 --json $jsonconf -T Malloc0 -q 4 -Y $testdir/replay.iolog -J $testdir/results.json
+[[ $(jq -r '.results | length' $testdir/results.json) == "2" ]]
+[[ $(jq -r '[.results[].replay.submitted] | add' $testdir/results.json) == "4" ]]
+rm -f $testdir/results.json $testdir/replay.iolog
 trap - SIGINT SIGTERM EXIT
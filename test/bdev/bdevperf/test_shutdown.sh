@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+#  SPDX-License-Identifier: BSD-3-Clause
+#  Copyright (C) 2023 Intel Corporation
+#  All rights reserved.
+#
+
+testdir=$(readlink -f $(dirname $0))
+rootdir=$(readlink -f $testdir/../../..)
+source $rootdir/test/common/autotest_common.sh
+source $testdir/common.sh
+
+jsonconf=$testdir/conf.json
+output=$testdir/bdevperf.log
+results=$testdir/results.json
+
+function cleanup_shutdown() {
+	rm -f $output $results $testdir/replay.iolog
+}
+
+# Start bdevperf, stop it with SIGINT once its jobs run and check that it exits in time,
+# even though its jobs have no I/O outstanding.
+function run_and_interrupt() {
+	local pid i
+
+	$bdevperf --json $jsonconf -J $results "$@" &> $output &
+	pid=$!
+	trap 'killprocess $pid; cleanup_shutdown; exit 1' SIGINT SIGTERM EXIT
+
+	for ((i = 0; i < 100; i++)); do
+		if grep -q "Running I/O" $output; then
+			break
+		fi
+		sleep 0.1
+	done
+	grep -q "Running I/O" $output
+	sleep 1
+
+	kill -SIGINT $pid
+	for ((i = 0; i < 100; i++)); do
+		if ! kill -0 $pid 2> /dev/null; then
+			break
+		fi
+		sleep 0.1
+	done
+	if kill -0 $pid 2> /dev/null; then
+		echo "bdevperf did not exit on SIGINT"
+		cat $output
+		return 1
+	fi
+	wait $pid
+
+	trap 'cleanup_shutdown; exit 1' SIGINT SIGTERM EXIT
+}
+
+trap 'cleanup_shutdown; exit 1' SIGINT SIGTERM EXIT
+
+#Test a fixed-rate job waiting for its next submission.
+run_and_interrupt -q 1 -o 4096 -w randread -t 120 -T Malloc0 -I 1
+[[ $(jq -r '.results | length' $results) == "1" ]]
+[[ $(jq -r '.results[0].open_loop' $results) == "true" ]]
+cleanup_shutdown
+
+#Test a replay job waiting in a gap of the trace.
+cat <<- EOF > $testdir/replay.iolog
+	fio version 2 iolog
+	/dev/sda add
+	/dev/sda read 0 4096
+	/dev/sda wait 600000
+	/dev/sda read 4096 4096
+EOF
+run_and_interrupt -q 4 -t 120 -T Malloc0 -Y $testdir/replay.iolog
+[[ $(jq -r '.results | length' $results) == "1" ]]
+[[ $(jq -r '.results[0].replay.submitted' $results) == "1" ]]
+cleanup_shutdown
+
+trap - SIGINT SIGTERM EXIT
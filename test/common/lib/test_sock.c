@@ -40,6 +40,11 @@ DEFINE_STUB(spdk_sock_group_remove_sock, int, (struct spdk_sock_group *group,
 DEFINE_STUB(spdk_sock_group_poll, int, (struct spdk_sock_group *group), 0);
 DEFINE_STUB(spdk_sock_group_poll_count, int, (struct spdk_sock_group *group, int max_events), 0);
 DEFINE_STUB(spdk_sock_group_close, int, (struct spdk_sock_group **group), 0);
+DEFINE_STUB(spdk_sock_get_interrupt_fd, int, (struct spdk_sock *sock), -1);
+DEFINE_STUB(spdk_sock_group_register_interrupts, int, (struct spdk_sock_group *group,
+		struct spdk_fd_group *fgrp, spdk_fd_fn fn, void *arg), 0);
+DEFINE_STUB_V(spdk_sock_group_unregister_interrupts, (struct spdk_sock_group *group,
+		struct spdk_fd_group *fgrp));
 DEFINE_STUB(spdk_sock_group_provide_buf, int, (struct spdk_sock_group *group, void *buf, size_t len,
 		void *ctx), 0);
 
@@ -3574,6 +3574,127 @@ bdev_histograms(void)
 	ut_fini_bdev();
 }
 
+static int64_t g_histogram_class_count[SPDK_BDEV_NUM_IO_TYPES][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES];
+
+static void
+histogram_classes_cb(void *cb_arg, int status,
+		     struct spdk_histogram_data *histograms[][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES])
+{
+	int type, size_class;
+
+	g_status = status;
+	if (status != 0) {
+		return;
+	}
+
+	for (type = 0; type < SPDK_BDEV_NUM_IO_TYPES; type++) {
+		for (size_class = 0; size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size_class++) {
+			g_histogram_class_count[type][size_class] = -1;
+			if (histograms[type][size_class] != NULL) {
+				g_count = 0;
+				spdk_histogram_data_iterate(histograms[type][size_class], histogram_io_count, NULL);
+				g_histogram_class_count[type][size_class] = g_count;
+			}
+		}
+	}
+}
+
+static void
+bdev_histograms_classes(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *ch;
+	static uint8_t buf[64 * 512];
+	int type, size_class, rc;
+
+	CU_ASSERT(spdk_bdev_histogram_size_class_get_max_size(SPDK_BDEV_HISTOGRAM_SIZE_4K) == 4096);
+	CU_ASSERT(spdk_bdev_histogram_size_class_get_max_size(SPDK_BDEV_HISTOGRAM_SIZE_256K) ==
+		  256 * 1024);
+	CU_ASSERT(spdk_bdev_histogram_size_class_get_max_size(SPDK_BDEV_HISTOGRAM_SIZE_LARGE) ==
+		  UINT64_MAX);
+
+	ut_init_bdev(NULL);
+
+	bdev = allocate_bdev("bdev");
+
+	rc = spdk_bdev_open_ext("bdev", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(desc != NULL);
+
+	ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(ch != NULL);
+
+	/* Histograms are not available until they are enabled */
+	g_status = 0;
+	spdk_bdev_histogram_get_classes(bdev, false, histogram_classes_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EFAULT);
+
+	g_status = -1;
+	spdk_bdev_histogram_enable(bdev, histogram_status_cb, NULL, true);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+
+	/* 512B write, 32KiB write and 512B read */
+	rc = spdk_bdev_write_blocks(desc, ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc, ch, buf, 0, 64, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(10);
+	stub_complete_io(3);
+	poll_threads();
+
+	g_status = -1;
+	spdk_bdev_histogram_get_classes(bdev, true, histogram_classes_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	for (type = 0; type < SPDK_BDEV_NUM_IO_TYPES; type++) {
+		for (size_class = 0; size_class < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size_class++) {
+			if ((type == SPDK_BDEV_IO_TYPE_WRITE && size_class == SPDK_BDEV_HISTOGRAM_SIZE_4K) ||
+			    (type == SPDK_BDEV_IO_TYPE_WRITE && size_class == SPDK_BDEV_HISTOGRAM_SIZE_64K) ||
+			    (type == SPDK_BDEV_IO_TYPE_READ && size_class == SPDK_BDEV_HISTOGRAM_SIZE_4K)) {
+				CU_ASSERT(g_histogram_class_count[type][size_class] == 1);
+			} else {
+				CU_ASSERT(g_histogram_class_count[type][size_class] == -1);
+			}
+		}
+	}
+
+	/* The previous call reset the histograms of the channels */
+	g_status = -1;
+	spdk_bdev_histogram_get_classes(bdev, false, histogram_classes_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(g_histogram_class_count[SPDK_BDEV_IO_TYPE_WRITE][SPDK_BDEV_HISTOGRAM_SIZE_4K] == 0);
+	CU_ASSERT(g_histogram_class_count[SPDK_BDEV_IO_TYPE_WRITE][SPDK_BDEV_HISTOGRAM_SIZE_64K] == 0);
+	CU_ASSERT(g_histogram_class_count[SPDK_BDEV_IO_TYPE_READ][SPDK_BDEV_HISTOGRAM_SIZE_4K] == 0);
+
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(10);
+	stub_complete_io(1);
+	poll_threads();
+
+	g_status = -1;
+	spdk_bdev_histogram_get_classes(bdev, false, histogram_classes_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(g_histogram_class_count[SPDK_BDEV_IO_TYPE_WRITE][SPDK_BDEV_HISTOGRAM_SIZE_4K] == 0);
+	CU_ASSERT(g_histogram_class_count[SPDK_BDEV_IO_TYPE_READ][SPDK_BDEV_HISTOGRAM_SIZE_4K] == 1);
+
+	spdk_bdev_histogram_enable(bdev, histogram_status_cb, NULL, false);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+
+	spdk_put_io_channel(ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 _bdev_compare(bool emulated)
 {
@@ -7224,6 +7345,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bdev_io_alignment_with_boundary);
 	CU_ADD_TEST(suite, bdev_io_alignment);
 	CU_ADD_TEST(suite, bdev_histograms);
+	CU_ADD_TEST(suite, bdev_histograms_classes);
 	CU_ADD_TEST(suite, bdev_write_zeroes);
 	CU_ADD_TEST(suite, bdev_compare_and_write);
 	CU_ADD_TEST(suite, bdev_compare);
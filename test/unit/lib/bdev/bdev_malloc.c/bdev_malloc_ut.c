@@ -0,0 +1,432 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "common/lib/test_env.c"
+#include "bdev/malloc/bdev_malloc.c"
+
+#define BLOCK_SIZE	512
+#define EXTENT_BLOCKS	8
+#define EXTENT_SIZE	(EXTENT_BLOCKS * BLOCK_SIZE)
+/* The last extent is only partially used */
+#define BLOCK_CNT	(3 * EXTENT_BLOCKS + EXTENT_BLOCKS / 2)
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "malloc");
+DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), BLOCK_SIZE);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), BLOCK_CNT);
+DEFINE_STUB(spdk_bdev_get_dif_type, enum spdk_dif_type, (const struct spdk_bdev *bdev),
+	    SPDK_DIF_DISABLE);
+DEFINE_STUB(spdk_bdev_get_dif_pi_format, enum spdk_dif_pi_format, (const struct spdk_bdev *bdev),
+	    SPDK_DIF_PI_FORMAT_16);
+DEFINE_STUB(spdk_bdev_is_dif_head_of_md, bool, (const struct spdk_bdev *bdev), false);
+DEFINE_STUB(spdk_bdev_is_md_interleaved, bool, (const struct spdk_bdev *bdev), false);
+DEFINE_STUB(spdk_bdev_get_md_size, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_is_dif_check_enabled, bool, (const struct spdk_bdev *bdev,
+		enum spdk_dif_check_type check_type), false);
+DEFINE_STUB_V(spdk_bdev_io_get_buf, (struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb,
+				     uint64_t len));
+DEFINE_STUB_V(spdk_bdev_io_set_buf, (struct spdk_bdev_io *bdev_io, void *buf, size_t len));
+DEFINE_STUB(spdk_accel_submit_copy, int, (struct spdk_io_channel *ch, void *dst, void *src,
+		uint64_t nbytes, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_submit_fill, int, (struct spdk_io_channel *ch, void *dst, uint8_t fill,
+		uint64_t nbytes, int flags, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_accel_sequence_reverse, (struct spdk_accel_sequence *seq));
+DEFINE_STUB_V(spdk_accel_sequence_abort, (struct spdk_accel_sequence *seq));
+DEFINE_STUB(spdk_accel_get_io_channel, struct spdk_io_channel *, (void), NULL);
+DEFINE_STUB(spdk_accel_get_memory_domain, struct spdk_memory_domain *, (void), NULL);
+DEFINE_STUB(spdk_dif_ctx_init, int, (struct spdk_dif_ctx *ctx, uint32_t block_size,
+				     uint32_t md_size, bool md_interleave, bool dif_loc, enum spdk_dif_type dif_type,
+				     uint32_t dif_flags, uint32_t init_ref_tag, uint16_t apptag_mask, uint16_t app_tag,
+				     uint32_t data_offset, uint32_t guard_seed, struct spdk_dif_ctx_init_ext_opts *opts), 0);
+DEFINE_STUB(spdk_dif_generate, int, (struct iovec *iovs, int iovcnt, uint32_t num_blocks,
+				     const struct spdk_dif_ctx *ctx), 0);
+DEFINE_STUB(spdk_dif_verify, int, (struct iovec *iovs, int iovcnt, uint32_t num_blocks,
+				   const struct spdk_dif_ctx *ctx, struct spdk_dif_error *err_blk), 0);
+DEFINE_STUB(spdk_dix_generate, int, (struct iovec *iovs, int iovcnt, struct iovec *md_iov,
+				     uint32_t num_blocks, const struct spdk_dif_ctx *ctx), 0);
+DEFINE_STUB(spdk_dix_verify, int, (struct iovec *iovs, int iovcnt, struct iovec *md_iov,
+				   uint32_t num_blocks, const struct spdk_dif_ctx *ctx,
+				   struct spdk_dif_error *err_blk), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_named_int32, int, (struct spdk_json_write_ctx *w,
+		const char *name, int32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_bool, int, (struct spdk_json_write_ctx *w,
+		const char *name, bool val), 0);
+DEFINE_STUB(spdk_json_write_named_uuid, int, (struct spdk_json_write_ctx *w,
+		const char *name, const struct spdk_uuid *val), 0);
+DEFINE_STUB(spdk_memory_domain_get_first, struct spdk_memory_domain *, (const char *id), NULL);
+DEFINE_STUB(spdk_memory_domain_get_next, struct spdk_memory_domain *,
+	    (struct spdk_memory_domain *prev, const char *id), NULL);
+
+static enum spdk_bdev_io_status g_io_status;
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+}
+
+/* Data moves synchronously, each sequence holds a single copy */
+int
+spdk_accel_append_copy(struct spdk_accel_sequence **seq, struct spdk_io_channel *ch,
+		       struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		       struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
+		       struct iovec *src_iovs, uint32_t src_iovcnt,
+		       struct spdk_memory_domain *src_domain, void *src_domain_ctx,
+		       int flags, spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	CU_ASSERT(dst_iovcnt == 1);
+	CU_ASSERT(src_iovcnt == 1);
+	CU_ASSERT(dst_iovs[0].iov_len == src_iovs[0].iov_len);
+	memcpy(dst_iovs[0].iov_base, src_iovs[0].iov_base, src_iovs[0].iov_len);
+
+	return 0;
+}
+
+void
+spdk_accel_sequence_finish(struct spdk_accel_sequence *seq,
+			   spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	cb_fn(cb_arg, 0);
+}
+
+static struct malloc_disk *
+ut_create_sparse_disk(void)
+{
+	struct malloc_disk *mdisk;
+
+	mdisk = calloc(1, sizeof(*mdisk));
+	SPDK_CU_ASSERT_FATAL(mdisk != NULL);
+
+	mdisk->disk.blocklen = BLOCK_SIZE;
+	mdisk->disk.blockcnt = BLOCK_CNT;
+	mdisk->disk.ctxt = mdisk;
+	mdisk->numa_id = SPDK_ENV_SOCKET_ID_ANY;
+	mdisk->extent_size = EXTENT_SIZE;
+	mdisk->extent_blocks = EXTENT_BLOCKS;
+	mdisk->num_extents = spdk_divide_round_up(BLOCK_CNT, EXTENT_BLOCKS);
+	mdisk->extents = calloc(mdisk->num_extents, sizeof(*mdisk->extents));
+	SPDK_CU_ASSERT_FATAL(mdisk->extents != NULL);
+	mdisk->zero_buf = spdk_zmalloc(EXTENT_SIZE, 0x1000, NULL, SPDK_ENV_SOCKET_ID_ANY,
+				       SPDK_MALLOC_DMA);
+	SPDK_CU_ASSERT_FATAL(mdisk->zero_buf != NULL);
+
+	return mdisk;
+}
+
+static struct spdk_bdev_io *
+ut_alloc_io(struct malloc_disk *mdisk, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	    uint64_t num_blocks, void *buf)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct malloc_task));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+
+	bdev_io->bdev = &mdisk->disk;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->iov.iov_base = buf;
+	bdev_io->iov.iov_len = num_blocks * BLOCK_SIZE;
+	bdev_io->u.bdev.iovs = &bdev_io->iov;
+	bdev_io->u.bdev.iovcnt = 1;
+
+	return bdev_io;
+}
+
+static int
+ut_submit_io(struct malloc_disk *mdisk, enum spdk_bdev_io_type type, uint64_t offset_blocks,
+	     uint64_t num_blocks, void *buf, uint64_t *seek_offset)
+{
+	struct malloc_channel mch = {};
+	struct spdk_bdev_io *bdev_io;
+	int rc;
+
+	TAILQ_INIT(&mch.completed_tasks);
+	bdev_io = ut_alloc_io(mdisk, type, offset_blocks, num_blocks, buf);
+
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = _bdev_malloc_submit_request(&mch, bdev_io);
+	CU_ASSERT(rc == 0);
+
+	/* Tasks completed inline are reported by the channel's poller */
+	if (!TAILQ_EMPTY(&mch.completed_tasks)) {
+		CU_ASSERT(malloc_completion_poller(&mch) == SPDK_POLLER_BUSY);
+	}
+	if (seek_offset != NULL) {
+		*seek_offset = bdev_io->u.bdev.seek.offset;
+	}
+
+	free(bdev_io);
+
+	return g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS ? 0 : -EIO;
+}
+
+static void
+ut_free_disk(struct malloc_disk *mdisk)
+{
+	uint64_t i;
+
+	for (i = 0; i < mdisk->num_extents; i++) {
+		CU_ASSERT(mdisk->extents[i].num_users == 0);
+	}
+	malloc_disk_free(mdisk);
+}
+
+static bool
+ut_buf_is(const uint8_t *buf, uint8_t val, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != val) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+test_sparse_read_write(void)
+{
+	struct malloc_disk *mdisk = ut_create_sparse_disk();
+	uint8_t buf[EXTENT_SIZE];
+	int rc;
+
+	/* Unwritten extents read back as zeroes without being allocated */
+	memset(buf, 0xff, sizeof(buf));
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_READ, 2, 4, buf, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_buf_is(buf, 0, 4 * BLOCK_SIZE));
+	CU_ASSERT(mdisk->num_allocated_extents == 0);
+
+	/* The first write allocates the extent */
+	memset(buf, 0xa5, sizeof(buf));
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, EXTENT_BLOCKS + 2, 4, buf, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->num_allocated_extents == 1);
+	SPDK_CU_ASSERT_FATAL(mdisk->extents[1].buf != NULL);
+	CU_ASSERT(mdisk->extents[0].buf == NULL);
+	CU_ASSERT(mdisk->extents[1].num_users == 0);
+
+	memset(buf, 0xff, sizeof(buf));
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_READ, EXTENT_BLOCKS, EXTENT_BLOCKS, buf, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_buf_is(buf, 0, 2 * BLOCK_SIZE));
+	CU_ASSERT(ut_buf_is(buf + 2 * BLOCK_SIZE, 0xa5, 4 * BLOCK_SIZE));
+	CU_ASSERT(ut_buf_is(buf + 6 * BLOCK_SIZE, 0, 2 * BLOCK_SIZE));
+
+	/* Writing to an allocated extent reuses its buffer */
+	memset(buf, 0x5a, sizeof(buf));
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, EXTENT_BLOCKS, 1, buf, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->num_allocated_extents == 1);
+	CU_ASSERT(ut_buf_is(mdisk->extents[1].buf, 0x5a, BLOCK_SIZE));
+
+	/* I/O spanning two extents is rejected, the bdev layer splits it */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, EXTENT_BLOCKS - 1, 2, buf, NULL);
+	CU_ASSERT(rc != 0);
+
+	ut_free_disk(mdisk);
+}
+
+static void
+test_sparse_unmap(void)
+{
+	struct malloc_disk *mdisk = ut_create_sparse_disk();
+	struct malloc_task task = {};
+	struct spdk_bdev_io *bdev_io;
+	uint8_t buf[EXTENT_SIZE];
+	void *extent_buf;
+	uint64_t i;
+	int rc;
+
+	memset(buf, 0xa5, sizeof(buf));
+	for (i = 0; i < mdisk->num_extents; i++) {
+		rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, i * EXTENT_BLOCKS,
+				  spdk_min(EXTENT_BLOCKS, BLOCK_CNT - i * EXTENT_BLOCKS), buf, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(mdisk->num_allocated_extents == 4);
+
+	/* Partially unmapped extents are zeroed in place */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_UNMAP, 2, 4, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->num_allocated_extents == 4);
+	CU_ASSERT(ut_buf_is(mdisk->extents[0].buf, 0xa5, 2 * BLOCK_SIZE));
+	CU_ASSERT(ut_buf_is((uint8_t *)mdisk->extents[0].buf + 2 * BLOCK_SIZE, 0, 4 * BLOCK_SIZE));
+	CU_ASSERT(ut_buf_is((uint8_t *)mdisk->extents[0].buf + 6 * BLOCK_SIZE, 0xa5, 2 * BLOCK_SIZE));
+
+	/* Extents covered as a whole are released, including the partial last one */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE_ZEROES, EXTENT_BLOCKS,
+			  BLOCK_CNT - EXTENT_BLOCKS, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->num_allocated_extents == 1);
+	CU_ASSERT(mdisk->extents[0].buf != NULL);
+	for (i = 1; i < mdisk->num_extents; i++) {
+		CU_ASSERT(mdisk->extents[i].buf == NULL);
+	}
+
+	/* An extent still accessed by an I/O is only zeroed */
+	bdev_io = ut_alloc_io(mdisk, SPDK_BDEV_IO_TYPE_READ, 0, 1, buf);
+	rc = malloc_sparse_get_buf(mdisk, &task, bdev_io, false, &extent_buf);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.extent == &mdisk->extents[0]);
+	CU_ASSERT(extent_buf == mdisk->extents[0].buf);
+	CU_ASSERT(mdisk->extents[0].num_users == 1);
+
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_UNMAP, 0, EXTENT_BLOCKS, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->extents[0].buf == extent_buf);
+	CU_ASSERT(ut_buf_is(extent_buf, 0, EXTENT_SIZE));
+	CU_ASSERT(mdisk->num_allocated_extents == 1);
+
+	malloc_sparse_put_extent(mdisk, &task);
+	CU_ASSERT(task.extent == NULL);
+	CU_ASSERT(mdisk->extents[0].num_users == 0);
+
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_UNMAP, 0, EXTENT_BLOCKS, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mdisk->extents[0].buf == NULL);
+	CU_ASSERT(mdisk->num_allocated_extents == 0);
+
+	free(bdev_io);
+	ut_free_disk(mdisk);
+}
+
+static void
+test_sparse_extent_releasing(void)
+{
+	struct malloc_disk *mdisk = ut_create_sparse_disk();
+	struct malloc_task task = {};
+	struct spdk_bdev_io *bdev_io;
+	uint8_t buf[EXTENT_SIZE];
+	void *extent_buf;
+	int rc;
+
+	memset(buf, 0xa5, sizeof(buf));
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, 0, EXTENT_BLOCKS, buf, NULL);
+	CU_ASSERT(rc == 0);
+
+	/* While an unmap releases the extent, reads get zeroes and don't pin it */
+	mdisk->extents[0].num_users = MALLOC_EXTENT_RELEASING;
+	CU_ASSERT(!malloc_extent_get(&mdisk->extents[0]));
+	CU_ASSERT(mdisk->extents[0].num_users == MALLOC_EXTENT_RELEASING);
+
+	bdev_io = ut_alloc_io(mdisk, SPDK_BDEV_IO_TYPE_READ, 1, 2, buf);
+	rc = malloc_sparse_get_buf(mdisk, &task, bdev_io, false, &extent_buf);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.extent == NULL);
+	CU_ASSERT(extent_buf == (uint8_t *)mdisk->zero_buf + BLOCK_SIZE);
+	CU_ASSERT(mdisk->extents[0].num_users == MALLOC_EXTENT_RELEASING);
+
+	/* Another unmap leaves the extent to the one releasing it */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_UNMAP, 0, 1, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_buf_is(mdisk->extents[0].buf, 0xa5, EXTENT_SIZE));
+	CU_ASSERT(mdisk->extents[0].num_users == MALLOC_EXTENT_RELEASING);
+
+	mdisk->extents[0].num_users = 0;
+	CU_ASSERT(malloc_extent_get(&mdisk->extents[0]));
+	CU_ASSERT(mdisk->extents[0].num_users == 1);
+	malloc_extent_put(&mdisk->extents[0]);
+
+	free(bdev_io);
+	ut_free_disk(mdisk);
+}
+
+static void
+test_sparse_seek(void)
+{
+	struct malloc_disk *mdisk = ut_create_sparse_disk();
+	uint8_t buf[BLOCK_SIZE] = {};
+	uint64_t offset;
+	int rc;
+
+	/* Nothing is allocated yet, the whole disk is a hole */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_DATA, 0, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == UINT64_MAX);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_HOLE, 5, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == 5);
+
+	/* Allocate the second and the last extents */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, EXTENT_BLOCKS + 3, 1, buf, NULL);
+	CU_ASSERT(rc == 0);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_WRITE, BLOCK_CNT - 1, 1, buf, NULL);
+	CU_ASSERT(rc == 0);
+
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_DATA, 0, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == EXTENT_BLOCKS);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_DATA, EXTENT_BLOCKS + 5, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == EXTENT_BLOCKS + 5);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_HOLE, EXTENT_BLOCKS + 5, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == 2 * EXTENT_BLOCKS);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_DATA, 2 * EXTENT_BLOCKS, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == 3 * EXTENT_BLOCKS);
+
+	/* There's no hole past the last allocated extent */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_HOLE, 3 * EXTENT_BLOCKS, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == UINT64_MAX);
+
+	/* Released extents become holes again */
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_UNMAP, EXTENT_BLOCKS, EXTENT_BLOCKS, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	rc = ut_submit_io(mdisk, SPDK_BDEV_IO_TYPE_SEEK_DATA, 0, 0, NULL, &offset);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(offset == 3 * EXTENT_BLOCKS);
+
+	ut_free_disk(mdisk);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("bdev_malloc", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_sparse_read_write);
+	CU_ADD_TEST(suite, test_sparse_unmap);
+	CU_ADD_TEST(suite, test_sparse_extent_releasing);
+	CU_ADD_TEST(suite, test_sparse_seek);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
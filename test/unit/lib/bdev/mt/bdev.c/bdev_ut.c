@@ -1838,6 +1838,329 @@ histogram_io_count(void *ctx, uint64_t start, uint64_t end, uint64_t count,
 	g_count += count;
 }
 
+static void
+qos_distributed(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev_channel *bdev_ch[2];
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status status[4];
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	uint64_t rates[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+	int qos_status, rc, i;
+
+	setup_test();
+	g_bdev_opts.qos_distributed = true;
+
+	/* 2000 read/write I/O per second, or 2 per millisecond */
+	bdev = &g_bdev.bdev;
+	bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+	TAILQ_INIT(&bdev->internal.qos->queued);
+	bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].limit = 2000;
+
+	g_get_io_channel = true;
+
+	set_thread(0);
+	io_ch[0] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[0] = spdk_io_channel_get_ctx(io_ch[0]);
+	CU_ASSERT(bdev_ch[0]->flags == BDEV_CH_QOS_ENABLED);
+
+	set_thread(1);
+	io_ch[1] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[1] = spdk_io_channel_get_ctx(io_ch[1]);
+	CU_ASSERT(bdev_ch[1]->flags == BDEV_CH_QOS_ENABLED);
+
+	CU_ASSERT(bdev->internal.qos->distributed == true);
+	CU_ASSERT(bdev->internal.qos->ch == bdev_ch[0]);
+
+	/*
+	 * I/O on thread 1 is submitted right away on thread 1, not on the QoS thread.  Only two
+	 * of them fit in the budget of this timeslice, the third one has to wait.
+	 */
+	set_thread(1);
+	for (i = 0; i < 3; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 2);
+	CU_ASSERT(!TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+
+	/* The budget is shared with thread 0 */
+	set_thread(0);
+	status[3] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status[3]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 0);
+	CU_ASSERT(!TAILQ_EMPTY(&bdev_ch[0]->qos_queued));
+
+	poll_threads();
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 0);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 2);
+
+	set_thread(1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[2] == SPDK_BDEV_IO_STATUS_PENDING);
+
+	/* The next timeslice lets the queued I/O through on both threads */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 1);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 1);
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch[0]->qos_queued));
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+	CU_ASSERT(bdev_ch[0]->qos_poller == NULL);
+	CU_ASSERT(bdev_ch[1]->qos_poller == NULL);
+
+	set_thread(0);
+	stub_complete_io(g_bdev.io_target, 0);
+	set_thread(1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[2] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[3] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* The achieved rate is measured over a second and stays within the limit */
+	spdk_delay_us(SPDK_SEC_TO_USEC);
+	poll_threads();
+	spdk_bdev_get_qos_achieved_rates(bdev, rates);
+	CU_ASSERT(rates[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] > 0);
+	CU_ASSERT(rates[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] <= 2000);
+	CU_ASSERT(rates[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT] == 0);
+
+	/* An overrun of the budget is charged to the next timeslice, a leftover expires */
+	bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice = -3;
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice
+		  == -1);
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].remaining_this_timeslice
+		  == 2);
+
+	/* Queue I/O on thread 1 again, then disable QoS, which resubmits it right away */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	set_thread(1);
+	for (i = 0; i < 3; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 2);
+	CU_ASSERT(!TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+
+	set_thread(0);
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limits[i] = UINT64_MAX;
+	}
+	limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 0;
+	qos_status = -1;
+	spdk_bdev_set_qos_rate_limits(bdev, limits, qos_dynamic_enable_done, &qos_status);
+	poll_threads();
+	CU_ASSERT(qos_status == 0);
+	CU_ASSERT(bdev->internal.qos == NULL);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 3);
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch[1]->qos_queued));
+	CU_ASSERT(bdev_ch[1]->qos_poller == NULL);
+
+	set_thread(1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* Tear down the channels */
+	set_thread(0);
+	spdk_put_io_channel(io_ch[0]);
+	set_thread(1);
+	spdk_put_io_channel(io_ch[1]);
+	poll_threads();
+	set_thread(0);
+
+	g_bdev_opts.qos_distributed = false;
+	teardown_test();
+}
+
+static void
+qos_group(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev_channel *bdev_ch[2];
+	struct ut_bdev *second_bdev;
+	struct spdk_bdev_desc *second_desc = NULL;
+	struct bdev_qos_group *group_a, *group_b;
+	enum spdk_bdev_io_status status[2][5];
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	uint64_t reservations[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES] = {};
+	int qos_status, rc, i;
+
+	setup_test();
+
+	second_bdev = calloc(1, sizeof(*second_bdev));
+	SPDK_CU_ASSERT_FATAL(second_bdev != NULL);
+	register_bdev(second_bdev, "ut_bdev2", g_bdev.io_target);
+	spdk_bdev_open_ext("ut_bdev2", true, _bdev_event_cb, NULL, &second_desc);
+	SPDK_CU_ASSERT_FATAL(second_desc != NULL);
+
+	/* 4000 I/O per second, or 4 per millisecond, shared by tenants a and b */
+	limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 4000;
+	rc = bdev_qos_group_create("root", NULL, limits, NULL, 1);
+	CU_ASSERT(rc == 0);
+	rc = bdev_qos_group_create("root", NULL, limits, NULL, 1);
+	CU_ASSERT(rc == -EEXIST);
+	rc = bdev_qos_group_create("a", "none", NULL, NULL, 1);
+	CU_ASSERT(rc == -ENODEV);
+	rc = bdev_qos_group_create("a", "root", NULL, NULL, 0);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Tenant a is guaranteed 1 I/O per millisecond */
+	reservations[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 1000;
+	rc = bdev_qos_group_create("a", "root", NULL, reservations, 1);
+	CU_ASSERT(rc == 0);
+	rc = bdev_qos_group_create("b", "root", NULL, NULL, 1);
+	CU_ASSERT(rc == 0);
+
+	/* The reservations cannot exceed the parent's limit */
+	reservations[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 4000;
+	rc = bdev_qos_group_create("c", "root", NULL, reservations, 1);
+	CU_ASSERT(rc == -EINVAL);
+
+	group_a = bdev_qos_group_find("a");
+	group_b = bdev_qos_group_find("b");
+	SPDK_CU_ASSERT_FATAL(group_a != NULL && group_b != NULL);
+
+	/* Bdevs can only join leaf groups */
+	qos_status = -1;
+	bdev_qos_group_add_bdev(&g_bdev.bdev, "root", qos_dynamic_enable_done, &qos_status);
+	poll_threads();
+	CU_ASSERT(qos_status == -EINVAL);
+
+	qos_status = -1;
+	bdev_qos_group_add_bdev(&g_bdev.bdev, "a", qos_dynamic_enable_done, &qos_status);
+	poll_threads();
+	CU_ASSERT(qos_status == 0);
+	qos_status = -1;
+	bdev_qos_group_add_bdev(&second_bdev->bdev, "b", qos_dynamic_enable_done, &qos_status);
+	poll_threads();
+	CU_ASSERT(qos_status == 0);
+	CU_ASSERT(group_a->num_bdevs == 1);
+	CU_ASSERT(group_b->num_bdevs == 1);
+
+	/* A bdev belongs to one group at most, and groups with bdevs cannot get children */
+	qos_status = -1;
+	bdev_qos_group_add_bdev(&g_bdev.bdev, "b", qos_dynamic_enable_done, &qos_status);
+	poll_threads();
+	CU_ASSERT(qos_status == -EBUSY);
+	rc = bdev_qos_group_create("a0", "a", NULL, NULL, 1);
+	CU_ASSERT(rc == -EBUSY);
+
+	set_thread(0);
+	io_ch[0] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[0] = spdk_io_channel_get_ctx(io_ch[0]);
+	io_ch[1] = spdk_bdev_get_io_channel(second_desc);
+	bdev_ch[1] = spdk_io_channel_get_ctx(io_ch[1]);
+	CU_ASSERT(bdev_ch[0]->flags == BDEV_CH_QOS_ENABLED);
+	CU_ASSERT(bdev_ch[1]->flags == BDEV_CH_QOS_ENABLED);
+
+	/*
+	 * Before either tenant is active, the 3 I/O left after a's reservation are split evenly.
+	 * Tenant a gets 1 + 2 and tenant b gets 2 I/O in this timeslice.
+	 */
+	for (i = 0; i < 5; i++) {
+		status[0][i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status[0][i]);
+		CU_ASSERT(rc == 0);
+		status[1][i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(second_desc, io_ch[1], NULL, 0, 1, io_during_io_done,
+					   &status[1][i]);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 3);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 2);
+	CU_ASSERT(group_a->throttled > 0);
+	CU_ASSERT(group_b->throttled > 0);
+	CU_ASSERT(group_a->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].consumed == 3);
+	CU_ASSERT(bdev_qos_group_find("root")->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].consumed == 5);
+
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+
+	/* Both tenants are active now, the queued I/O goes out in the next timeslices */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 2);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 2);
+	stub_complete_io(g_bdev.io_target, 0);
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(bdev_ch[0]->io_outstanding == 0);
+	CU_ASSERT(bdev_ch[1]->io_outstanding == 1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 5; i++) {
+		CU_ASSERT(status[0][i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(status[1][i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* When only b is active, it gets all the leftover while a keeps its reservation */
+	spdk_spin_lock(&g_bdev_qos_groups.spinlock);
+	group_a->active = false;
+	group_b->active = true;
+	g_bdev_qos_groups.last_timeslice = 0;
+	bdev_qos_groups_update(spdk_get_ticks());
+	CU_ASSERT(group_a->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].share == 1);
+	CU_ASSERT(group_b->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].share == 3);
+	spdk_spin_unlock(&g_bdev_qos_groups.spinlock);
+
+	/* Groups in use cannot be deleted */
+	rc = bdev_qos_group_delete("root");
+	CU_ASSERT(rc == -EBUSY);
+	rc = bdev_qos_group_delete("a");
+	CU_ASSERT(rc == -EBUSY);
+
+	/* Leaving the group disables QoS on a bdev without rate limits of its own */
+	qos_status = -1;
+	bdev_qos_group_remove_bdev(&g_bdev.bdev, qos_dynamic_enable_done, &qos_status);
+	/* The group is held until every channel stopped admitting I/O against it */
+	CU_ASSERT(g_bdev.bdev.internal.qos->group == NULL);
+	CU_ASSERT(group_a->num_bdevs == 1);
+	rc = bdev_qos_group_delete("a");
+	CU_ASSERT(rc == -EBUSY);
+	poll_threads();
+	CU_ASSERT(qos_status == 0);
+	CU_ASSERT(g_bdev.bdev.internal.qos == NULL);
+	CU_ASSERT(bdev_ch[0]->flags == 0);
+	CU_ASSERT(group_a->num_bdevs == 0);
+	rc = bdev_qos_group_delete("a");
+	CU_ASSERT(rc == 0);
+
+	spdk_put_io_channel(io_ch[0]);
+	spdk_put_io_channel(io_ch[1]);
+	poll_threads();
+
+	/* Unregistering a bdev removes it from its group */
+	spdk_bdev_close(second_desc);
+	unregister_bdev(second_bdev);
+	free(second_bdev);
+	CU_ASSERT(group_b->num_bdevs == 0);
+	rc = bdev_qos_group_delete("b");
+	CU_ASSERT(rc == 0);
+	rc = bdev_qos_group_delete("root");
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_qos_groups.groups));
+
+	teardown_test();
+}
+
 static void
 bdev_histograms_mt(void)
 {
@@ -2604,6 +2927,156 @@ event_notify_and_close(void)
 	teardown_test();
 }
 
+static void
+write_coalescing(void)
+{
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct ut_bdev_channel *ut_ch;
+	struct spdk_bdev_io *bdev_io;
+	enum spdk_bdev_io_status status[4], status_reset;
+	static char buf[4][4 * 4096];
+	uint32_t blocklen;
+	int rc, i;
+
+	setup_test();
+	blocklen = g_bdev.bdev.blocklen;
+
+	set_thread(0);
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+	ut_ch = spdk_io_channel_get_ctx(bdev_ch->channel);
+
+	/* The maximum size has to cover at least two blocks */
+	rc = -1;
+	spdk_bdev_set_write_coalescing(&g_bdev.bdev, 100, blocklen, qos_dynamic_enable_done, &rc);
+	CU_ASSERT(rc == -EINVAL);
+
+	rc = -1;
+	spdk_bdev_set_write_coalescing(&g_bdev.bdev, 100, 8 * blocklen, qos_dynamic_enable_done, &rc);
+	poll_threads();
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(bdev_ch->coalesce_max_blocks == 8);
+	CU_ASSERT(bdev_ch->coalesce_poller != NULL);
+
+	/* Adjacent writes are held back until the window expires and then merged */
+	for (i = 0; i < 3; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[i], i, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(ut_ch->outstanding_cnt == 0);
+
+	spdk_delay_us(100);
+	poll_threads();
+	CU_ASSERT(ut_ch->outstanding_cnt == 1);
+	bdev_io = TAILQ_FIRST(&ut_ch->outstanding_io);
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	CU_ASSERT(bdev_io->u.bdev.offset_blocks == 0);
+	CU_ASSERT(bdev_io->u.bdev.num_blocks == 3);
+	CU_ASSERT(bdev_io->u.bdev.iovcnt == 3);
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(bdev_io->u.bdev.iovs[i].iov_base == buf[i]);
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_PENDING);
+	}
+
+	/* The completion is reported to each of the original writes */
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_ops == 3);
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_batches == 1);
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch->io_submitted));
+
+	/* A write that is not adjacent flushes the held one, which is submitted unchanged */
+	status[0] = status[1] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[0], 10, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[1], 20, 1, io_during_io_done, &status[1]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_ch->outstanding_cnt == 1);
+	bdev_io = TAILQ_FIRST(&ut_ch->outstanding_io);
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	CU_ASSERT(bdev_io->u.bdev.offset_blocks == 10);
+	CU_ASSERT(bdev_io->internal.cb == io_during_io_done);
+
+	/* Reads do not flush the held writes */
+	status[2] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch, buf[2], 21, 1, io_during_io_done, &status[2]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_ch->outstanding_cnt == 2);
+
+	spdk_delay_us(100);
+	poll_threads();
+	CU_ASSERT(ut_ch->outstanding_cnt == 3);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 3; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_ops == 3);
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_batches == 1);
+
+	/* Reaching the maximum size submits the merged write right away */
+	status[0] = status[1] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[0], 100, 4, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_ch->outstanding_cnt == 0);
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[1], 104, 4, io_during_io_done, &status[1]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_ch->outstanding_cnt == 1);
+	bdev_io = TAILQ_FIRST(&ut_ch->outstanding_io);
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	CU_ASSERT(bdev_io->u.bdev.offset_blocks == 100);
+	CU_ASSERT(bdev_io->u.bdev.num_blocks == 8);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_ops == 5);
+	CU_ASSERT(bdev_ch->stat->num_coalesced_write_batches == 2);
+
+	/* A reset aborts the held writes */
+	status[0] = status[1] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[0], 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[1], 1, 1, io_during_io_done, &status[1]);
+	CU_ASSERT(rc == 0);
+	status_reset = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_reset(g_desc, io_ch, io_during_io_done, &status_reset);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_ABORTED);
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_ABORTED);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status_reset == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_ch->coalesce_batch == NULL);
+
+	/* Disabling coalescing flushes any held writes */
+	status[0] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_write_blocks(g_desc, io_ch, buf[0], 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(ut_ch->outstanding_cnt == 0);
+	rc = -1;
+	spdk_bdev_set_write_coalescing(&g_bdev.bdev, 0, 0, qos_dynamic_enable_done, &rc);
+	poll_threads();
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(bdev_ch->coalesce_max_blocks == 0);
+	CU_ASSERT(bdev_ch->coalesce_poller == NULL);
+	CU_ASSERT(ut_ch->outstanding_cnt == 1);
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+	teardown_test();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -2633,10 +3106,13 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, enomem_multi_bdev_unregister);
 	CU_ADD_TEST(suite, enomem_multi_io_target);
 	CU_ADD_TEST(suite, qos_dynamic_enable);
+	CU_ADD_TEST(suite, qos_distributed);
+	CU_ADD_TEST(suite, qos_group);
 	CU_ADD_TEST(suite, bdev_histograms_mt);
 	CU_ADD_TEST(suite, bdev_set_io_timeout_mt);
 	CU_ADD_TEST(suite, lock_lba_range_then_submit_io);
 	CU_ADD_TEST(suite, unregister_during_reset);
+	CU_ADD_TEST(suite, write_coalescing);
 	CU_ADD_TEST(suite_wt, spdk_bdev_register_wt);
 	CU_ADD_TEST(suite_wt, spdk_bdev_examine_wt);
 	CU_ADD_TEST(suite, event_notify_and_close);
@@ -225,6 +225,12 @@ DEFINE_STUB(spdk_opal_dev_construct, struct spdk_opal_dev *, (struct spdk_nvme_c
 
 DEFINE_STUB_V(spdk_opal_dev_destruct, (struct spdk_opal_dev *dev));
 
+DEFINE_STUB(spdk_nvme_poll_group_get_fd_group, struct spdk_fd_group *,
+	    (struct spdk_nvme_poll_group *group), NULL);
+
+DEFINE_STUB(spdk_nvme_poll_group_wait, int64_t, (struct spdk_nvme_poll_group *group,
+		spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb), 0);
+
 DEFINE_STUB(spdk_accel_submit_crc32cv, int, (struct spdk_io_channel *ch, uint32_t *dst,
 		struct iovec *iov,
 		uint32_t iov_cnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg), 0);
@@ -6044,6 +6050,93 @@ test_find_io_path_min_qd(void)
 	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
 }
 
+static void
+test_find_io_path_service_time(void)
+{
+	struct nvme_bdev_channel nbdev_ch = {
+		.io_path_list = STAILQ_HEAD_INITIALIZER(nbdev_ch.io_path_list),
+		.mp_policy = BDEV_NVME_MP_POLICY_ACTIVE_ACTIVE,
+		.mp_selector = BDEV_NVME_MP_SELECTOR_SERVICE_TIME,
+		.probe_interval_ticks = 1000,
+	};
+	struct spdk_nvme_qpair qpair1 = {}, qpair2 = {}, qpair3 = {};
+	struct spdk_nvme_ctrlr ctrlr1 = {}, ctrlr2 = {}, ctrlr3 = {};
+	struct nvme_ctrlr nvme_ctrlr1 = { .ctrlr = &ctrlr1, };
+	struct nvme_ctrlr nvme_ctrlr2 = { .ctrlr = &ctrlr2, };
+	struct nvme_ctrlr nvme_ctrlr3 = { .ctrlr = &ctrlr3, };
+	struct nvme_ctrlr_channel ctrlr_ch1 = {};
+	struct nvme_ctrlr_channel ctrlr_ch2 = {};
+	struct nvme_ctrlr_channel ctrlr_ch3 = {};
+	struct nvme_qpair nvme_qpair1 = { .ctrlr_ch = &ctrlr_ch1, .ctrlr = &nvme_ctrlr1, .qpair = &qpair1, };
+	struct nvme_qpair nvme_qpair2 = { .ctrlr_ch = &ctrlr_ch2, .ctrlr = &nvme_ctrlr2, .qpair = &qpair2, };
+	struct nvme_qpair nvme_qpair3 = { .ctrlr_ch = &ctrlr_ch3, .ctrlr = &nvme_ctrlr3, .qpair = &qpair3, };
+	struct nvme_ns nvme_ns1 = {}, nvme_ns2 = {}, nvme_ns3 = {};
+	struct nvme_io_path io_path1 = { .qpair = &nvme_qpair1, .nvme_ns = &nvme_ns1, .nbdev_ch = &nbdev_ch, };
+	struct nvme_io_path io_path2 = { .qpair = &nvme_qpair2, .nvme_ns = &nvme_ns2, .nbdev_ch = &nbdev_ch, };
+	struct nvme_io_path io_path3 = { .qpair = &nvme_qpair3, .nvme_ns = &nvme_ns3, .nbdev_ch = &nbdev_ch, };
+	struct nvme_bdev_io bio = {};
+	uint64_t now;
+
+	STAILQ_INSERT_TAIL(&nbdev_ch.io_path_list, &io_path1, stailq);
+	STAILQ_INSERT_TAIL(&nbdev_ch.io_path_list, &io_path2, stailq);
+	STAILQ_INSERT_TAIL(&nbdev_ch.io_path_list, &io_path3, stailq);
+
+	now = spdk_get_ticks();
+	io_path1.last_select_tsc = now;
+	io_path2.last_select_tsc = now;
+	io_path3.last_select_tsc = now;
+
+	/* The latency scaled by the queue depth is compared among the optimized paths. */
+	io_path1.ewma_latency_ticks = 100;
+	io_path2.ewma_latency_ticks = 300;
+	io_path3.ewma_latency_ticks = 10;
+	nvme_ns1.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	nvme_ns2.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	nvme_ns3.ana_state = SPDK_NVME_ANA_NON_OPTIMIZED_STATE;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	qpair1.num_outstanding_reqs = 3;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+
+	qpair1.num_outstanding_reqs = 1;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* Non-optimized paths are used only if there is no optimized path. */
+	nvme_ns1.ana_state = SPDK_NVME_ANA_INACCESSIBLE_STATE;
+	nvme_ns2.ana_state = SPDK_NVME_ANA_INACCESSIBLE_STATE;
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path3);
+
+	/* A path that was not selected for a while is probed once even if it is slower. */
+	nvme_ns1.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	nvme_ns2.ana_state = SPDK_NVME_ANA_OPTIMIZED_STATE;
+	spdk_delay_us(500);
+	io_path1.last_select_tsc = spdk_get_ticks();
+	spdk_delay_us(501);
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path2);
+	CU_ASSERT(io_path2.last_select_tsc == spdk_get_ticks());
+	CU_ASSERT(bdev_nvme_find_io_path(&nbdev_ch) == &io_path1);
+
+	/* The first completion sets the latency, the next ones are averaged. */
+	io_path1.ewma_latency_ticks = 0;
+	bio.io_path = &io_path1;
+	bio.submit_tsc = spdk_get_ticks();
+	spdk_delay_us(80);
+	bdev_nvme_update_io_path_latency(&bio);
+	CU_ASSERT(io_path1.ewma_latency_ticks == 80);
+
+	bio.submit_tsc = spdk_get_ticks();
+	spdk_delay_us(160);
+	bdev_nvme_update_io_path_latency(&bio);
+	CU_ASSERT(io_path1.ewma_latency_ticks == 80 - 10 + 20);
+
+	/* Latency is not sampled for the other selectors. */
+	nbdev_ch.mp_selector = BDEV_NVME_MP_SELECTOR_QUEUE_DEPTH;
+	bio.submit_tsc = spdk_get_ticks();
+	spdk_delay_us(1000);
+	bdev_nvme_update_io_path_latency(&bio);
+	CU_ASSERT(io_path1.ewma_latency_ticks == 90);
+}
+
 static void
 test_disable_auto_failback(void)
 {
@@ -6316,6 +6409,311 @@ test_set_multipath_policy(void)
 	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static void
+test_read_hedging(void)
+{
+	struct nvme_path_id path1 = {}, path2 = {};
+	struct spdk_nvme_ctrlr *ctrlr1, *ctrlr2;
+	struct nvme_bdev_ctrlr *nbdev_ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr1, *nvme_ctrlr2;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct nvme_bdev *bdev;
+	struct spdk_bdev_io *bdev_io;
+	struct nvme_bdev_io *bio;
+	struct spdk_io_channel *ch;
+	struct nvme_bdev_channel *nbdev_ch;
+	struct nvme_io_path *io_path1, *io_path2;
+	struct nvme_bdev_hedge *hedge;
+	STAILQ_HEAD(, nvme_bdev_hedge) free_hedges;
+	struct spdk_uuid uuid1 = { .u.raw = { 0x1 } };
+	uint8_t *buf;
+	uint64_t i;
+	int done;
+	int rc;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&path1.trid);
+	ut_init_trid2(&path2.trid);
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	set_thread(0);
+
+	ctrlr1 = ut_attach_ctrlr(&path1.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr1 != NULL);
+
+	ctrlr1->ns[0].uuid = &uuid1;
+
+	rc = bdev_nvme_create(&path1.trid, "nvme0", attached_names, STRING_SIZE,
+			      attach_ctrlr_done, NULL, NULL, NULL, true);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	ctrlr2 = ut_attach_ctrlr(&path2.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr2 != NULL);
+
+	ctrlr2->ns[0].uuid = &uuid1;
+
+	rc = bdev_nvme_create(&path2.trid, "nvme0", attached_names, STRING_SIZE,
+			      attach_ctrlr_done, NULL, NULL, NULL, true);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	nbdev_ctrlr = nvme_bdev_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nbdev_ctrlr != NULL);
+
+	nvme_ctrlr1 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path1.trid);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr1 != NULL);
+
+	nvme_ctrlr2 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path2.trid);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr2 != NULL);
+
+	bdev = nvme_bdev_ctrlr_get_bdev(nbdev_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(bdev != NULL);
+
+	ch = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	nbdev_ch = spdk_io_channel_get_ctx(ch);
+
+	io_path1 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr1);
+	SPDK_CU_ASSERT_FATAL(io_path1 != NULL);
+	io_path2 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr2);
+	SPDK_CU_ASSERT_FATAL(io_path2 != NULL);
+
+	CU_ASSERT(io_path1->read_latency == NULL);
+	CU_ASSERT(nbdev_ch->hedge_poller == NULL);
+
+	/* Invalid percentile or budget */
+	done = -1;
+	bdev_nvme_set_read_hedging(bdev->disk.name, 100, 5, ut_set_multipath_policy_done, &done);
+	CU_ASSERT(done == -EINVAL);
+
+	done = -1;
+	bdev_nvme_set_read_hedging(bdev->disk.name, 99, 101, ut_set_multipath_policy_done, &done);
+	CU_ASSERT(done == -EINVAL);
+
+	/* Every read earns a full hedge with a budget of 100 percent. */
+	done = -1;
+	bdev_nvme_set_read_hedging(bdev->disk.name, 99, 100, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == 0);
+	CU_ASSERT(bdev->hedge_percentile == 99);
+	CU_ASSERT(nbdev_ch->hedge_percentile == 99);
+	CU_ASSERT(nbdev_ch->hedge_budget_percent == 100);
+	CU_ASSERT(nbdev_ch->hedge_poller != NULL);
+	SPDK_CU_ASSERT_FATAL(io_path1->read_latency != NULL);
+	SPDK_CU_ASSERT_FATAL(io_path2->read_latency != NULL);
+
+	/* The threshold is not calculated until enough reads were sampled. */
+	for (i = 1; i < NVME_HEDGE_MIN_SAMPLES; i++) {
+		spdk_histogram_data_tally(io_path1->read_latency, i);
+	}
+	bdev_nvme_update_hedge_threshold(io_path1, 99);
+	CU_ASSERT(io_path1->hedge_threshold_ticks == 0);
+
+	/* Latencies are 1 to 1000 ticks, hence the 99th percentile is about 990 ticks. */
+	spdk_histogram_data_tally(io_path1->read_latency, NVME_HEDGE_MIN_SAMPLES);
+	bdev_nvme_update_hedge_threshold(io_path1, 99);
+	CU_ASSERT(io_path1->hedge_threshold_ticks >= 990);
+	CU_ASSERT(io_path1->hedge_threshold_ticks <= 1024);
+
+	/* The histogram starts over once the threshold is calculated. */
+	spdk_histogram_data_tally(io_path1->read_latency, 1);
+	bdev_nvme_update_hedge_threshold(io_path1, 99);
+	CU_ASSERT(io_path1->hedge_threshold_ticks >= 990);
+
+	io_path1->hedge_threshold_ticks = 100;
+	nbdev_ch->hedge_update_tsc = spdk_get_ticks();
+
+	/* Hedges read into a bounce buffer of the I/O size. */
+	bdev->disk.blocklen = 512;
+
+	buf = calloc(1, bdev->disk.blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	bdev_io = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_READ, bdev, ch);
+	ut_bdev_io_set_buf(bdev_io);
+	bdev_io->iov.iov_base = buf;
+	bdev_io->iov.iov_len = bdev->disk.blocklen;
+	bdev_io->u.bdev.num_blocks = 1;
+	bio = (struct nvme_bdev_io *)bdev_io->driver_ctx;
+
+	/* Case 1: The hedge completes first. The bdev_io completes with the data of the
+	 * hedge right away and the read is aborted.
+	 */
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+
+	CU_ASSERT(io_path1->qpair->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(bio->hedge_io_path == io_path1);
+	CU_ASSERT(TAILQ_FIRST(&io_path1->hedge_candidates) == bio);
+	SPDK_CU_ASSERT_FATAL(bio->hedge != NULL);
+	hedge = bio->hedge;
+	CU_ASSERT(hedge->reads[0].outstanding);
+	CU_ASSERT(hedge->reads[0].buf != NULL);
+
+	/* Not slow enough yet */
+	spdk_delay_us(50);
+	bdev_nvme_hedge_poll(nbdev_ch);
+	CU_ASSERT(!hedge->reads[1].outstanding);
+	CU_ASSERT(io_path2->qpair->qpair->num_outstanding_reqs == 0);
+
+	spdk_delay_us(50);
+	bdev_nvme_hedge_poll(nbdev_ch);
+	CU_ASSERT(hedge->reads[1].outstanding);
+	CU_ASSERT(bio->hedge_io_path == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&io_path1->hedge_candidates));
+	CU_ASSERT(io_path2->qpair->qpair->num_outstanding_reqs == 1);
+	CU_ASSERT(io_path1->num_hedged_reads == 1);
+	CU_ASSERT(nbdev_ch->hedge_tokens == 0);
+
+	memset(hedge->reads[0].buf, 0xA5, bdev->disk.blocklen);
+	memset(hedge->reads[1].buf, 0x5A, bdev->disk.blocklen);
+
+	spdk_nvme_qpair_process_completions(io_path2->qpair->qpair, 0);
+	CU_ASSERT(io_path2->qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(io_path1->num_hedges_won == 1);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bio->hedge == NULL);
+	CU_ASSERT(buf[0] == 0x5A && buf[bdev->disk.blocklen - 1] == 0x5A);
+	CU_ASSERT(ctrlr1->adminq.num_outstanding_reqs == 1);
+
+	/* The aborted read only returns its buffer, and the context goes back to the pool. */
+	memset(buf, 0, bdev->disk.blocklen);
+	CU_ASSERT(STAILQ_FIRST(&io_path1->qpair->group->free_hedges) != hedge);
+	spdk_nvme_qpair_process_completions(io_path1->qpair->qpair, 0);
+	CU_ASSERT(io_path1->qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(buf[0] == 0);
+	CU_ASSERT(STAILQ_FIRST(&io_path1->qpair->group->free_hedges) == hedge);
+
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+	CU_ASSERT(ctrlr1->adminq.num_outstanding_reqs == 0);
+
+	/* Case 2: The read completes first. The hedge is aborted. */
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+
+	spdk_delay_us(100);
+	bdev_nvme_hedge_poll(nbdev_ch);
+	SPDK_CU_ASSERT_FATAL(bio->hedge != NULL);
+	CU_ASSERT(bio->hedge->reads[1].outstanding);
+	CU_ASSERT(io_path1->num_hedged_reads == 2);
+	memset(bio->hedge->reads[0].buf, 0xA5, bdev->disk.blocklen);
+
+	spdk_nvme_qpair_process_completions(io_path1->qpair->qpair, 0);
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bio->hedge == NULL);
+	CU_ASSERT(buf[0] == 0xA5 && buf[bdev->disk.blocklen - 1] == 0xA5);
+	CU_ASSERT(ctrlr2->adminq.num_outstanding_reqs == 1);
+
+	/* The orphaned hedge frees itself. */
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+	CU_ASSERT(io_path2->qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(ctrlr2->adminq.num_outstanding_reqs == 0);
+	CU_ASSERT(io_path1->num_hedges_won == 1);
+
+	/* Case 3: The budget is exhausted, a slow read is not hedged. */
+	done = -1;
+	bdev_nvme_set_read_hedging(bdev->disk.name, 99, 1, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == 0);
+	CU_ASSERT(io_path1->hedge_threshold_ticks == 0);
+
+	/* Until the threshold is learned again, reads go straight to the buffer of the I/O. */
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+	CU_ASSERT(bio->hedge == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&io_path1->hedge_candidates));
+	CU_ASSERT(nbdev_ch->hedge_tokens == 0);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	io_path1->hedge_threshold_ticks = 100;
+	nbdev_ch->hedge_update_tsc = spdk_get_ticks();
+
+	/* Neither are reads when the poll group has no hedging context left. */
+	STAILQ_INIT(&free_hedges);
+	STAILQ_SWAP(&free_hedges, &io_path1->qpair->group->free_hedges, nvme_bdev_hedge);
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+	CU_ASSERT(bio->hedge == NULL);
+	CU_ASSERT(nbdev_ch->hedge_tokens == 0);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	STAILQ_SWAP(&free_hedges, &io_path1->qpair->group->free_hedges, nvme_bdev_hedge);
+
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+	CU_ASSERT(nbdev_ch->hedge_tokens == 1);
+
+	spdk_delay_us(100);
+	bdev_nvme_hedge_poll(nbdev_ch);
+	SPDK_CU_ASSERT_FATAL(bio->hedge != NULL);
+	CU_ASSERT(!bio->hedge->reads[1].outstanding);
+	CU_ASSERT(TAILQ_EMPTY(&io_path1->hedge_candidates));
+	CU_ASSERT(io_path2->qpair->qpair->num_outstanding_reqs == 0);
+	CU_ASSERT(io_path1->num_hedged_reads == 2);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Disable hedging. */
+	done = -1;
+	bdev_nvme_set_read_hedging(bdev->disk.name, 0, 0, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == 0);
+	CU_ASSERT(nbdev_ch->hedge_poller == NULL);
+	CU_ASSERT(io_path1->read_latency == NULL);
+	CU_ASSERT(io_path2->read_latency == NULL);
+
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_io->internal.in_submit_request = true;
+	bdev_nvme_submit_request(ch, bdev_io);
+	CU_ASSERT(bio->hedge_io_path == NULL);
+	CU_ASSERT(bio->hedge == NULL);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.in_submit_request == false);
+
+	MOCK_CLEAR(spdk_bdev_io_get_submit_tsc);
+
+	free(buf);
+	free(bdev_io);
+
+	spdk_put_io_channel(ch);
+
+	poll_threads();
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_bdev_ctrlr_get_by_name("nvme0") == NULL);
+}
+
 static void
 test_uuid_generation(void)
 {
@@ -7174,6 +7572,11 @@ test_disable_enable_ctrlr(void)
 	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static void
+ut_iobuf_finish_cb(void *arg)
+{
+}
+
 int
 main(int argc, const char **argv)
 {
@@ -7223,8 +7626,10 @@ main(int argc, const char **argv)
 	CU_ADD_TEST(suite, test_set_preferred_path);
 	CU_ADD_TEST(suite, test_find_next_io_path);
 	CU_ADD_TEST(suite, test_find_io_path_min_qd);
+	CU_ADD_TEST(suite, test_find_io_path_service_time);
 	CU_ADD_TEST(suite, test_disable_auto_failback);
 	CU_ADD_TEST(suite, test_set_multipath_policy);
+	CU_ADD_TEST(suite, test_read_hedging);
 	CU_ADD_TEST(suite, test_uuid_generation);
 	CU_ADD_TEST(suite, test_retry_io_to_same_path);
 	CU_ADD_TEST(suite, test_race_between_reset_and_disconnected);
@@ -7236,6 +7641,7 @@ main(int argc, const char **argv)
 
 	allocate_threads(3);
 	set_thread(0);
+	spdk_iobuf_initialize();
 	bdev_nvme_library_init();
 	init_accel();
 
@@ -7244,6 +7650,8 @@ main(int argc, const char **argv)
 	set_thread(0);
 	bdev_nvme_library_fini();
 	fini_accel();
+	spdk_iobuf_finish(ut_iobuf_finish_cb, NULL);
+	poll_threads();
 	free_threads();
 
 	num_failures = CU_get_number_of_failures();
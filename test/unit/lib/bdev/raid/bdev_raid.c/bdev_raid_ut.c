@@ -94,6 +94,7 @@ DEFINE_STUB_V(spdk_jsonrpc_send_bool_response, (struct spdk_jsonrpc_request *req
 		bool value));
 DEFINE_STUB(spdk_json_decode_string, int, (const struct spdk_json_val *val, void *out), 0);
 DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint64, int, (const struct spdk_json_val *val, void *out), 0);
 DEFINE_STUB(spdk_json_decode_array, int, (const struct spdk_json_val *values,
 		spdk_json_decode_fn decode_func,
 		void *out, size_t max_size, size_t *out_size, size_t stride), 0);
@@ -109,6 +110,8 @@ DEFINE_STUB(spdk_json_write_named_array_begin, int, (struct spdk_json_write_ctx
 		const char *name), 0);
 DEFINE_STUB(spdk_json_write_bool, int, (struct spdk_json_write_ctx *w, bool val), 0);
 DEFINE_STUB(spdk_json_write_null, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w, const char *name,
+		uint64_t val), 0);
 DEFINE_STUB(spdk_strerror, const char *, (int errnum), NULL);
 DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 		struct spdk_bdev_io_wait_entry *entry), 0);
@@ -121,6 +124,8 @@ DEFINE_STUB(spdk_bdev_get_dif_type, enum spdk_dif_type, (const struct spdk_bdev
 	    SPDK_DIF_DISABLE);
 DEFINE_STUB(spdk_bdev_is_dif_head_of_md, bool, (const struct spdk_bdev *bdev), false);
 DEFINE_STUB(spdk_bdev_notify_blockcnt_change, int, (struct spdk_bdev *bdev, uint64_t size), 0);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_is_md_separate, bool, (const struct spdk_bdev *bdev), false);
 
 struct spdk_io_channel *
 spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
@@ -385,7 +390,12 @@ spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event
 
 	bdev = spdk_bdev_get_by_name(bdev_name);
 	if (bdev == NULL) {
-		return -ENODEV;
+		struct raid_bdev *raid_bdev = raid_bdev_find_by_name(bdev_name);
+
+		if (raid_bdev == NULL) {
+			return -ENODEV;
+		}
+		bdev = &raid_bdev->bdev;
 	}
 
 	*_desc = (void *)bdev;
@@ -541,6 +551,7 @@ spdk_json_decode_object(const struct spdk_json_val *values,
 		SPDK_CU_ASSERT_FATAL(_out->name != NULL);
 		_out->strip_size_kb = req->strip_size_kb;
 		_out->level = req->level;
+		_out->read_policy = req->read_policy;
 		_out->base_bdevs.num_base_bdevs = req->base_bdevs.num_base_bdevs;
 		for (i = 0; i < req->base_bdevs.num_base_bdevs; i++) {
 			_out->base_bdevs.base_bdevs[i] = strdup(req->base_bdevs.base_bdevs[i]);
@@ -611,6 +622,30 @@ spdk_bdev_unquiesce(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
 	return 0;
 }
 
+int
+spdk_bdev_quiesce_range(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
+			uint64_t offset, uint64_t length,
+			spdk_bdev_quiesce_cb cb_fn, void *cb_arg)
+{
+	if (cb_fn) {
+		cb_fn(cb_arg, 0);
+	}
+
+	return 0;
+}
+
+int
+spdk_bdev_unquiesce_range(struct spdk_bdev *bdev, struct spdk_bdev_module *module,
+			  uint64_t offset, uint64_t length,
+			  spdk_bdev_quiesce_cb cb_fn, void *cb_arg)
+{
+	if (cb_fn) {
+		cb_fn(cb_arg, 0);
+	}
+
+	return 0;
+}
+
 static void
 bdev_io_cleanup(struct spdk_bdev_io *bdev_io)
 {
@@ -974,6 +1009,7 @@ create_test_req(struct rpc_bdev_raid_create *r, const char *raid_name,
 	SPDK_CU_ASSERT_FATAL(r->name != NULL);
 	r->strip_size_kb = (g_strip_size * g_block_len) / 1024;
 	r->level = RAID0;
+	r->read_policy = RAID_READ_POLICY_LEAST_OUTSTANDING;
 	r->base_bdevs.num_base_bdevs = g_max_base_drives;
 	for (i = 0; i < g_max_base_drives; i++, bbdev_idx++) {
 		snprintf(name, 16, "%s%u%s", "Nvme", bbdev_idx, "n1");
@@ -1126,6 +1162,20 @@ test_create_raid_invalid_args(void)
 	free_test_req(&req);
 	verify_raid_bdev_present("raid1", false);
 
+	create_raid_bdev_create_req(&req, "raid1", 0, false, 0);
+	req.read_policy = RAID_READ_POLICY_ROUND_ROBIN;
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 1);
+	free_test_req(&req);
+	verify_raid_bdev_present("raid1", false);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, false, 0);
+	req.read_policy = INVALID_RAID_READ_POLICY;
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 1);
+	free_test_req(&req);
+	verify_raid_bdev_present("raid1", false);
+
 	create_raid_bdev_create_req(&req, "raid1", 0, false, 0);
 	rpc_bdev_raid_create(NULL, NULL);
 	CU_ASSERT(g_rpc_err == 0);
@@ -1946,6 +1996,192 @@ test_raid_json_dump_info(void)
 	reset_globals();
 }
 
+TAILQ_HEAD(, raid_bdev_process_request) g_process_requests = TAILQ_HEAD_INITIALIZER(
+			g_process_requests);
+uint64_t g_process_next_offset;
+
+static int
+test_submit_process_request(struct raid_bdev_process_request *process_req,
+			    struct raid_bdev_io_channel *raid_ch)
+{
+	uint8_t idx = process_req->target - process_req->target->raid_bdev->base_bdev_info;
+
+	CU_ASSERT(process_req->offset_blocks == g_process_next_offset);
+	CU_ASSERT(process_req->target_ch != NULL);
+	CU_ASSERT(raid_ch->base_channel[idx] == process_req->target_ch);
+	CU_ASSERT(process_req->iov.iov_len == process_req->num_blocks * g_block_len);
+
+	g_process_next_offset += process_req->num_blocks;
+	TAILQ_INSERT_TAIL(&g_process_requests, process_req, link);
+
+	return process_req->num_blocks;
+}
+
+static void
+complete_process_requests(int status)
+{
+	struct raid_bdev_process_request *process_req;
+
+	while ((process_req = TAILQ_FIRST(&g_process_requests)) != NULL) {
+		TAILQ_REMOVE(&g_process_requests, process_req, link);
+		raid_bdev_process_request_complete(process_req, status);
+	}
+	poll_threads();
+}
+
+static void
+test_raid_process(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete destroy_req;
+	struct raid_bdev_opts opts, opts_orig;
+	struct raid_bdev *pbdev;
+	struct raid_base_bdev_info *base_info;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_io_channel *ch;
+	struct spdk_bdev_io *bdev_io;
+	char *base_bdev_name;
+	uint64_t blockcnt;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	raid_bdev_get_opts(&opts_orig);
+	opts = opts_orig;
+	opts.process_window_size_kb = 1024;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+
+	pbdev = raid_bdev_find_by_name("raid1");
+	SPDK_CU_ASSERT_FATAL(pbdev != NULL);
+	base_info = &pbdev->base_bdev_info[0];
+	base_bdev_name = strdup(base_info->name);
+	SPDK_CU_ASSERT_FATAL(base_bdev_name != NULL);
+
+	/* Shrink the raid bdev so that the process consists of a few windows */
+	blockcnt = pbdev->bdev.blockcnt;
+	pbdev->bdev.blockcnt = 1000;
+
+	ch = spdk_get_io_channel(pbdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	raid_ch = spdk_io_channel_get_ctx(ch);
+
+	/* No empty slot */
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == -ENOTSUP);
+	pbdev->module->submit_process_request = test_submit_process_request;
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == -ENOSPC);
+
+	/* Remove a base bdev, allowing the raid bdev to stay online without it */
+	pbdev->min_base_bdevs_operational--;
+	CU_ASSERT(raid_bdev_remove_base_bdev(spdk_bdev_desc_get_bdev(base_info->desc), NULL,
+					     NULL) == 0);
+	poll_threads();
+	CU_ASSERT(base_info->desc == NULL);
+	CU_ASSERT(raid_ch->base_channel[0] == NULL);
+
+	/* Add it back and rebuild it */
+	g_process_next_offset = 0;
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == 0);
+	SPDK_CU_ASSERT_FATAL(pbdev->process != NULL);
+	CU_ASSERT(base_info->desc != NULL);
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == -EBUSY);
+	poll_threads();
+
+	/* The first window */
+	SPDK_CU_ASSERT_FATAL(raid_ch->process.ch_processed != NULL);
+	CU_ASSERT(raid_ch->base_channel[0] == NULL);
+	CU_ASSERT(raid_ch->process.ch_processed->base_channel[0] != NULL);
+	CU_ASSERT(raid_ch->process.offset == 0);
+	CU_ASSERT(g_process_next_offset == 256);
+
+	complete_process_requests(0);
+	CU_ASSERT(raid_ch->process.offset == 256);
+	CU_ASSERT(g_process_next_offset == 512);
+
+	/* I/O to the processed range goes to the target too */
+	bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->type = SPDK_BDEV_IO_TYPE_READ;
+	bdev_io->u.bdev.offset_blocks = 128;
+	bdev_io->u.bdev.num_blocks = 128;
+	CU_ASSERT(raid_bdev_io_get_channel(raid_ch, bdev_io) == raid_ch->process.ch_processed);
+	bdev_io->u.bdev.num_blocks = 129;
+	CU_ASSERT(raid_bdev_io_get_channel(raid_ch, bdev_io) == raid_ch);
+	bdev_io->type = SPDK_BDEV_IO_TYPE_WRITE;
+	CU_ASSERT(raid_bdev_io_get_channel(raid_ch, bdev_io) == raid_ch->process.ch_processed);
+	bdev_io->u.bdev.offset_blocks = 256;
+	CU_ASSERT(raid_bdev_io_get_channel(raid_ch, bdev_io) == raid_ch);
+	free(bdev_io);
+
+	/* The remaining windows, the last one is shorter */
+	complete_process_requests(0);
+	CU_ASSERT(g_process_next_offset == 768);
+	complete_process_requests(0);
+	CU_ASSERT(g_process_next_offset == 1000);
+	complete_process_requests(0);
+	CU_ASSERT(TAILQ_EMPTY(&g_process_requests));
+
+	/* The rebuilt base bdev is now a part of the raid bdev */
+	CU_ASSERT(pbdev->process == NULL);
+	CU_ASSERT(raid_ch->process.ch_processed == NULL);
+	CU_ASSERT(raid_ch->process.offset == RAID_OFFSET_BLOCKS_INVALID);
+	CU_ASSERT(raid_ch->base_channel[0] != NULL);
+	CU_ASSERT(pbdev->num_base_bdevs_discovered == pbdev->num_base_bdevs);
+
+	/* A failed rebuild removes the target */
+	CU_ASSERT(raid_bdev_remove_base_bdev(spdk_bdev_desc_get_bdev(base_info->desc), NULL,
+					     NULL) == 0);
+	poll_threads();
+	CU_ASSERT(base_info->desc == NULL);
+	g_process_next_offset = 0;
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == 0);
+	poll_threads();
+	CU_ASSERT(g_process_next_offset == 256);
+	complete_process_requests(-EIO);
+	CU_ASSERT(pbdev->process == NULL);
+	CU_ASSERT(base_info->desc == NULL);
+	CU_ASSERT(base_info->name == NULL);
+	CU_ASSERT(raid_ch->base_channel[0] == NULL);
+	CU_ASSERT(raid_ch->process.ch_processed == NULL);
+
+	/* Removing the target stops the rebuild */
+	g_process_next_offset = 0;
+	CU_ASSERT(raid_bdev_add_base_bdev(pbdev, base_bdev_name) == 0);
+	poll_threads();
+	CU_ASSERT(raid_bdev_remove_base_bdev(spdk_bdev_desc_get_bdev(base_info->desc), NULL,
+					     NULL) == 0);
+	poll_threads();
+	CU_ASSERT(pbdev->process != NULL);
+	complete_process_requests(0);
+	CU_ASSERT(g_process_next_offset == 256);
+	CU_ASSERT(pbdev->process == NULL);
+	CU_ASSERT(base_info->desc == NULL);
+	CU_ASSERT(raid_ch->base_channel[0] == NULL);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+
+	pbdev->module->submit_process_request = NULL;
+	pbdev->min_base_bdevs_operational++;
+	pbdev->bdev.blockcnt = blockcnt;
+	CU_ASSERT(raid_bdev_set_opts(&opts_orig) == 0);
+	free(base_bdev_name);
+	free_test_req(&req);
+
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
 static void
 test_context_size(void)
 {
@@ -1970,6 +2206,22 @@ test_raid_level_conversions(void)
 	CU_ASSERT(raid_str != NULL && strcmp(raid_str, "raid0") == 0);
 }
 
+static void
+test_raid_read_policy_conversions(void)
+{
+	const char *policy_str;
+
+	CU_ASSERT(raid_bdev_str_to_read_policy("abcd123") == INVALID_RAID_READ_POLICY);
+	CU_ASSERT(raid_bdev_str_to_read_policy("least_outstanding") == RAID_READ_POLICY_LEAST_OUTSTANDING);
+	CU_ASSERT(raid_bdev_str_to_read_policy("round_robin") == RAID_READ_POLICY_ROUND_ROBIN);
+	CU_ASSERT(raid_bdev_str_to_read_policy("SEQUENTIAL") == RAID_READ_POLICY_SEQUENTIAL);
+
+	policy_str = raid_bdev_read_policy_to_str(INVALID_RAID_READ_POLICY);
+	CU_ASSERT(policy_str != NULL && strlen(policy_str) == 0);
+	policy_str = raid_bdev_read_policy_to_str(RAID_READ_POLICY_ROUND_ROBIN);
+	CU_ASSERT(policy_str != NULL && strcmp(policy_str, "round_robin") == 0);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1997,6 +2249,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid_json_dump_info);
 	CU_ADD_TEST(suite, test_context_size);
 	CU_ADD_TEST(suite, test_raid_level_conversions);
+	CU_ADD_TEST(suite, test_raid_read_policy_conversions);
+	CU_ADD_TEST(suite, test_raid_process);
 
 	allocate_threads(1);
 	set_thread(0);
@@ -8,10 +8,13 @@
 #include "spdk/env.h"
 #include "spdk_internal/mock.h"
 
+#include "common/lib/ut_multithread.c"
+
 #include "bdev/raid/raid1.c"
 #include "../common.c"
 
 DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
 DEFINE_STUB_V(raid_bdev_io_complete, (struct raid_bdev_io *raid_io,
 				      enum spdk_bdev_io_status status));
 DEFINE_STUB(raid_bdev_io_complete_part, bool, (struct raid_bdev_io *raid_io, uint64_t completed,
@@ -19,25 +22,80 @@ DEFINE_STUB(raid_bdev_io_complete_part, bool, (struct raid_bdev_io *raid_io, uin
 DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
 DEFINE_STUB_V(raid_bdev_queue_io_wait, (struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
 					struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn));
-DEFINE_STUB(spdk_bdev_readv_blocks_with_md, int, (struct spdk_bdev_desc *desc,
-		struct spdk_io_channel *ch,
-		struct iovec *iov, int iovcnt, void *md,
-		uint64_t offset_blocks, uint64_t num_blocks,
-		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
-DEFINE_STUB(spdk_bdev_writev_blocks_with_md, int, (struct spdk_bdev_desc *desc,
-		struct spdk_io_channel *ch,
-		struct iovec *iov, int iovcnt, void *md,
-		uint64_t offset_blocks, uint64_t num_blocks,
-		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
-DEFINE_STUB(spdk_bdev_readv_blocks_ext, int, (struct spdk_bdev_desc *desc,
-		struct spdk_io_channel *ch,
-		struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
-		spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts), 0);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
 DEFINE_STUB(spdk_bdev_writev_blocks_ext, int, (struct spdk_bdev_desc *desc,
 		struct spdk_io_channel *ch,
 		struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
 		spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts), 0);
 
+#define MAX_TEST_READS 64
+
+struct test_read {
+	struct spdk_bdev_desc *desc;
+	spdk_bdev_io_completion_cb cb;
+	void *cb_arg;
+};
+
+static struct test_read g_test_reads[MAX_TEST_READS];
+static uint32_t g_test_reads_count;
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	struct test_read *read;
+
+	SPDK_CU_ASSERT_FATAL(g_test_reads_count < MAX_TEST_READS);
+	read = &g_test_reads[g_test_reads_count++];
+	read->desc = desc;
+	read->cb = cb;
+	read->cb_arg = cb_arg;
+
+	return 0;
+}
+
+static struct test_read g_test_writes[MAX_TEST_READS];
+static uint32_t g_test_writes_count;
+
+int
+spdk_bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			       struct iovec *iov, int iovcnt, void *md,
+			       uint64_t offset_blocks, uint64_t num_blocks,
+			       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return spdk_bdev_readv_blocks_ext(desc, ch, iov, iovcnt, offset_blocks, num_blocks,
+					  cb, cb_arg, NULL);
+}
+
+int
+spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				struct iovec *iov, int iovcnt, void *md,
+				uint64_t offset_blocks, uint64_t num_blocks,
+				spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct test_read *write;
+
+	SPDK_CU_ASSERT_FATAL(g_test_writes_count < MAX_TEST_READS);
+	write = &g_test_writes[g_test_writes_count++];
+	write->desc = desc;
+	write->cb = cb;
+	write->cb_arg = cb_arg;
+
+	return 0;
+}
+
+static int g_process_request_status;
+static uint32_t g_process_requests_completed;
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	g_process_request_status = status;
+	g_process_requests_completed++;
+}
+
 static int
 test_setup(void)
 {
@@ -98,6 +156,7 @@ delete_raid1(struct raid1_info *r1_info)
 	struct raid_bdev *raid_bdev = r1_info->raid_bdev;
 
 	raid1_stop(raid_bdev);
+	poll_threads();
 
 	raid_test_delete_raid_bdev(raid_bdev);
 }
@@ -122,6 +181,282 @@ test_raid1_start(void)
 	}
 }
 
+struct test_raid1_read_ctx {
+	struct raid1_info *r1_info;
+	struct raid_bdev_io_channel raid_ch;
+};
+
+static void
+init_read_ctx(struct test_raid1_read_ctx *ctx, struct raid1_info *r1_info,
+	      enum raid_read_policy read_policy)
+{
+	struct raid_bdev *raid_bdev = r1_info->raid_bdev;
+	uint8_t i;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->r1_info = r1_info;
+	raid_bdev->read_policy = read_policy;
+
+	ctx->raid_ch.num_channels = raid_bdev->num_base_bdevs;
+	ctx->raid_ch.base_channel = calloc(raid_bdev->num_base_bdevs, sizeof(struct spdk_io_channel *));
+	SPDK_CU_ASSERT_FATAL(ctx->raid_ch.base_channel != NULL);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		ctx->raid_ch.base_channel[i] = (void *)(uintptr_t)(i + 1);
+	}
+
+	ctx->raid_ch.module_channel = raid1_get_io_channel(raid_bdev);
+	SPDK_CU_ASSERT_FATAL(ctx->raid_ch.module_channel != NULL);
+
+	g_test_reads_count = 0;
+}
+
+static void
+fini_read_ctx(struct test_raid1_read_ctx *ctx)
+{
+	spdk_put_io_channel(ctx->raid_ch.module_channel);
+	poll_threads();
+	free(ctx->raid_ch.base_channel);
+}
+
+static uint8_t
+submit_read(struct test_raid1_read_ctx *ctx, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev *raid_bdev = ctx->r1_info->raid_bdev;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+	struct raid_base_bdev_info *base_info;
+	struct test_read *read;
+	uint32_t reads_count = g_test_reads_count;
+
+	/* Each read gets its own context, it is released when the read completes */
+	bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = SPDK_BDEV_IO_TYPE_READ;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	raid_io->raid_bdev = raid_bdev;
+	raid_io->raid_ch = &ctx->raid_ch;
+
+	raid1_submit_rw_request(raid_io);
+
+	SPDK_CU_ASSERT_FATAL(g_test_reads_count == reads_count + 1);
+	read = &g_test_reads[reads_count];
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc == read->desc) {
+			return base_info - raid_bdev->base_bdev_info;
+		}
+	}
+
+	CU_FAIL_FATAL("read submitted to unknown base bdev");
+	return UINT8_MAX;
+}
+
+static void
+complete_reads(struct test_raid1_read_ctx *ctx, uint8_t idx)
+{
+	struct raid_bdev *raid_bdev = ctx->r1_info->raid_bdev;
+	struct spdk_bdev_desc *desc = raid_bdev->base_bdev_info[idx].desc;
+	struct test_read *read;
+	uint32_t i, j;
+
+	for (i = 0, j = 0; i < g_test_reads_count; i++) {
+		read = &g_test_reads[i];
+		if (read->desc == desc) {
+			read->cb(NULL, true, read->cb_arg);
+			free(spdk_bdev_io_from_ctx(read->cb_arg));
+		} else {
+			g_test_reads[j++] = *read;
+		}
+	}
+	g_test_reads_count = j;
+}
+
+static void
+complete_all_reads(struct test_raid1_read_ctx *ctx)
+{
+	uint8_t i;
+
+	for (i = 0; i < ctx->r1_info->raid_bdev->num_base_bdevs; i++) {
+		complete_reads(ctx, i);
+	}
+	CU_ASSERT(g_test_reads_count == 0);
+}
+
+static void
+test_raid1_read_balancing_round_robin(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct test_raid1_read_ctx ctx;
+		struct raid1_info *r1_info;
+		uint8_t i, idx, prev_idx;
+
+		r1_info = create_raid1(params);
+		init_read_ctx(&ctx, r1_info, RAID_READ_POLICY_ROUND_ROBIN);
+
+		prev_idx = submit_read(&ctx, 0, 1);
+		for (i = 1; i < params->num_base_bdevs * 2; i++) {
+			idx = submit_read(&ctx, 0, 1);
+			CU_ASSERT(idx == (prev_idx + 1) % params->num_base_bdevs);
+			prev_idx = idx;
+		}
+
+		/* A missing base bdev is skipped */
+		ctx.raid_ch.base_channel[(prev_idx + 1) % params->num_base_bdevs] = NULL;
+		idx = submit_read(&ctx, 0, 1);
+		CU_ASSERT(idx == (prev_idx + 2) % params->num_base_bdevs);
+
+		complete_all_reads(&ctx);
+		fini_read_ctx(&ctx);
+		delete_raid1(r1_info);
+	}
+}
+
+static void
+test_raid1_read_balancing_least_outstanding(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct test_raid1_read_ctx ctx;
+		struct raid1_info *r1_info;
+		struct raid1_io_channel *r1ch;
+		uint8_t i, idx;
+
+		r1_info = create_raid1(params);
+		init_read_ctx(&ctx, r1_info, RAID_READ_POLICY_LEAST_OUTSTANDING);
+		r1ch = spdk_io_channel_get_ctx(ctx.raid_ch.module_channel);
+
+		/* Reads are spread evenly across idle base bdevs */
+		for (i = 0; i < params->num_base_bdevs * 2; i++) {
+			submit_read(&ctx, i, 1);
+		}
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			CU_ASSERT(r1ch->base[i].reads_outstanding == 2);
+		}
+
+		/* The base bdev that drained its reads gets the next ones */
+		complete_reads(&ctx, 1);
+		CU_ASSERT(r1ch->base[1].reads_outstanding == 0);
+		CU_ASSERT(submit_read(&ctx, 0, 1) == 1);
+		CU_ASSERT(submit_read(&ctx, 0, 1) == 1);
+		idx = submit_read(&ctx, 0, 1);
+		CU_ASSERT(r1ch->base[idx].reads_outstanding == 3);
+
+		complete_all_reads(&ctx);
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			CU_ASSERT(r1ch->base[i].reads_outstanding == 0);
+		}
+
+		fini_read_ctx(&ctx);
+		delete_raid1(r1_info);
+	}
+}
+
+static void
+test_raid1_read_balancing_sequential(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct test_raid1_read_ctx ctx;
+		struct raid1_info *r1_info;
+		uint8_t i, idx, seq_idx;
+
+		r1_info = create_raid1(params);
+		init_read_ctx(&ctx, r1_info, RAID_READ_POLICY_SEQUENTIAL);
+
+		/* A sequential stream stays on one base bdev */
+		seq_idx = submit_read(&ctx, 0, 8);
+		for (i = 1; i <= RAID1_SEQUENTIAL_MAX_OUTSTANDING_DELTA; i++) {
+			CU_ASSERT(submit_read(&ctx, i * 8, 8) == seq_idx);
+		}
+
+		/* Unless it gets too far ahead of the other base bdevs */
+		idx = submit_read(&ctx, i * 8, 8);
+		CU_ASSERT(idx != seq_idx);
+
+		/* Random reads go to the least loaded base bdev */
+		complete_all_reads(&ctx);
+		seq_idx = submit_read(&ctx, 1000, 8);
+		idx = submit_read(&ctx, 5000, 8);
+		CU_ASSERT(idx != seq_idx);
+
+		complete_all_reads(&ctx);
+		fini_read_ctx(&ctx);
+		delete_raid1(r1_info);
+	}
+}
+
+static void
+test_raid1_process_request(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct test_raid1_read_ctx ctx;
+		struct raid1_info *r1_info;
+		struct raid_bdev *raid_bdev;
+		struct raid_bdev_process_request process_req = {};
+		struct raid_base_bdev_info *target;
+		int ret;
+
+		r1_info = create_raid1(params);
+		raid_bdev = r1_info->raid_bdev;
+		init_read_ctx(&ctx, r1_info, RAID_READ_POLICY_ROUND_ROBIN);
+		target = &raid_bdev->base_bdev_info[0];
+		target->raid_bdev = raid_bdev;
+
+		process_req.target = target;
+		process_req.target_ch = (void *)(uintptr_t)1;
+		process_req.offset_blocks = 0;
+		process_req.num_blocks = 1;
+		g_test_writes_count = 0;
+		g_process_requests_completed = 0;
+
+		/* The data is read from a base bdev other than the target and written to the target */
+		ret = raid1_submit_process_request(&process_req, &ctx.raid_ch);
+		CU_ASSERT(ret == 1);
+		SPDK_CU_ASSERT_FATAL(g_test_reads_count == 1);
+		CU_ASSERT(g_test_reads[0].desc != target->desc);
+		CU_ASSERT(g_test_writes_count == 0);
+		g_test_reads[0].cb(NULL, true, g_test_reads[0].cb_arg);
+		SPDK_CU_ASSERT_FATAL(g_test_writes_count == 1);
+		CU_ASSERT(g_test_writes[0].desc == target->desc);
+		CU_ASSERT(g_process_requests_completed == 0);
+		g_test_writes[0].cb(NULL, true, g_test_writes[0].cb_arg);
+		CU_ASSERT(g_process_requests_completed == 1);
+		CU_ASSERT(g_process_request_status == 0);
+
+		/* A failed read fails the request without writing the target */
+		g_test_reads_count = 0;
+		g_test_writes_count = 0;
+		ret = raid1_submit_process_request(&process_req, &ctx.raid_ch);
+		CU_ASSERT(ret == 1);
+		SPDK_CU_ASSERT_FATAL(g_test_reads_count == 1);
+		g_test_reads[0].cb(NULL, false, g_test_reads[0].cb_arg);
+		CU_ASSERT(g_test_writes_count == 0);
+		CU_ASSERT(g_process_requests_completed == 2);
+		CU_ASSERT(g_process_request_status == -EIO);
+
+		/* Nothing to read from if the other base bdevs are missing */
+		g_test_reads_count = 0;
+		memset(&ctx.raid_ch.base_channel[1], 0,
+		       (raid_bdev->num_base_bdevs - 1) * sizeof(struct spdk_io_channel *));
+		ret = raid1_submit_process_request(&process_req, &ctx.raid_ch);
+		CU_ASSERT(ret == -ENODEV);
+		CU_ASSERT(g_test_reads_count == 0);
+
+		fini_read_ctx(&ctx);
+		delete_raid1(r1_info);
+	}
+}
+
 int
 main(int argc, char **argv)
 {
@@ -133,10 +468,20 @@ main(int argc, char **argv)
 
 	suite = CU_add_suite("raid1", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_raid1_start);
+	CU_ADD_TEST(suite, test_raid1_read_balancing_round_robin);
+	CU_ADD_TEST(suite, test_raid1_read_balancing_least_outstanding);
+	CU_ADD_TEST(suite, test_raid1_read_balancing_sequential);
+	CU_ADD_TEST(suite, test_raid1_process_request);
+
+	allocate_threads(1);
+	set_thread(0);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
 	num_failures = CU_get_number_of_failures();
 	CU_cleanup_registry();
+
+	free_threads();
+
 	return num_failures;
 }
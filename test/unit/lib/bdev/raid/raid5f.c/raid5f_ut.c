@@ -20,6 +20,8 @@ DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
 DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
 DEFINE_STUB(accel_channel_create, int, (void *io_device, void *ctx_buf), 0);
 DEFINE_STUB_V(accel_channel_destroy, (void *io_device, void *ctx_buf));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
 
 struct spdk_io_channel *
 spdk_accel_get_io_channel(void)
@@ -214,6 +216,7 @@ test_raid5f_start(void)
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
 		CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_optimal_io_boundary);
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+		CU_ASSERT_FALSE(r5f_info->raid_bdev->bdev.split_on_write_unit);
 
 		delete_raid5f(r5f_info);
 	}
@@ -243,6 +246,8 @@ struct raid_io_info {
 	void *parity_md_buf;
 	void *reference_md_parity;
 	size_t parity_md_buf_size;
+	void *stripe_buf;
+	void *stripe_md_buf;
 	enum spdk_bdev_io_status status;
 	TAILQ_HEAD(, spdk_bdev_io) bdev_io_queue;
 	TAILQ_HEAD(, spdk_bdev_io_wait_entry) bdev_io_wait_queue;
@@ -411,6 +416,76 @@ process_io_completions(struct raid_io_info *io_info)
 
 #define DATA_OFFSET_TO_MD_OFFSET(raid_bdev, data_offset) ((data_offset >> raid_bdev->blocklen_shift) * raid_bdev->bdev.md_len)
 
+/* Simulated contents of the base bdevs for a single stripe */
+static struct {
+	uint64_t stripe_index;
+	void **data;
+	void **md;
+	void **expected_data;
+	void **expected_md;
+	unsigned int reads;
+	unsigned int writes;
+} g_stripe_store;
+
+/* Queues the base bdev I/O of process requests, which have no raid_io */
+static struct raid_io_info *g_process_io_info;
+static int g_process_request_status;
+static unsigned int g_process_requests_completed;
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	g_process_request_status = status;
+	g_process_requests_completed++;
+}
+
+static int
+stripe_store_submit_io(struct chunk *chunk, bool write, struct spdk_bdev_desc *desc,
+		       struct iovec *iov, int iovcnt, void *md_buf, uint64_t offset_blocks,
+		       uint64_t num_blocks, spdk_bdev_io_completion_cb cb)
+{
+	struct stripe_request *stripe_req = raid5f_chunk_stripe_req(chunk);
+	struct test_raid_bdev_io *test_raid_bdev_io;
+	struct raid_io_info *io_info;
+	struct raid_bdev *raid_bdev;
+	uint64_t chunk_offset;
+	size_t len;
+	void *buf, *md;
+
+	if (stripe_req->raid_io != NULL) {
+		test_raid_bdev_io = (struct test_raid_bdev_io *)spdk_bdev_io_from_ctx(stripe_req->raid_io);
+		io_info = test_raid_bdev_io->io_info;
+	} else {
+		io_info = g_process_io_info;
+		SPDK_CU_ASSERT_FATAL(io_info != NULL);
+	}
+	raid_bdev = io_info->r5f_info->raid_bdev;
+
+	CU_ASSERT(stripe_req->stripe_index == g_stripe_store.stripe_index);
+	chunk_offset = offset_blocks - (stripe_req->stripe_index << raid_bdev->strip_size_shift);
+	SPDK_CU_ASSERT_FATAL(chunk_offset + num_blocks <= raid_bdev->strip_size);
+
+	len = num_blocks * raid_bdev->bdev.blocklen;
+	buf = g_stripe_store.data[chunk->index] + chunk_offset * raid_bdev->bdev.blocklen;
+	md = g_stripe_store.md[chunk->index] + chunk_offset * raid_bdev->bdev.md_len;
+
+	if (write) {
+		spdk_copy_iovs_to_buf(buf, len, iov, iovcnt);
+		if (md_buf != NULL) {
+			memcpy(md, md_buf, num_blocks * raid_bdev->bdev.md_len);
+		}
+		g_stripe_store.writes++;
+	} else {
+		spdk_copy_buf_to_iovs(iov, iovcnt, buf, len);
+		if (md_buf != NULL) {
+			memcpy(md_buf, md, num_blocks * raid_bdev->bdev.md_len);
+		}
+		g_stripe_store.reads++;
+	}
+
+	return submit_io(io_info, desc, cb, chunk);
+}
+
 int
 spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 				struct iovec *iov, int iovcnt, void *md_buf,
@@ -426,7 +501,12 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	uint64_t data_offset;
 	void *dest_buf, *dest_md_buf;
 
-	SPDK_CU_ASSERT_FATAL(cb == raid5f_chunk_complete_bdev_io);
+	SPDK_CU_ASSERT_FATAL(cb == raid5f_chunk_complete_bdev_io ||
+			     cb == raid5f_process_chunk_write_complete);
+	if (g_stripe_store.data != NULL) {
+		return stripe_store_submit_io(chunk, true, desc, iov, iovcnt, md_buf, offset_blocks,
+					      num_blocks, cb);
+	}
 	SPDK_CU_ASSERT_FATAL(iovcnt == 1);
 
 	stripe_req = raid5f_chunk_stripe_req(chunk);
@@ -484,6 +564,50 @@ spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel
 					       num_blocks, cb, cb_arg);
 }
 
+static int
+test_reconstruct_chunk_read(struct chunk *chunk, struct spdk_bdev_desc *desc,
+			    struct iovec *iov, void *md_buf, uint64_t offset_blocks, uint64_t num_blocks,
+			    spdk_bdev_io_completion_cb cb)
+{
+	struct stripe_request *stripe_req = raid5f_chunk_stripe_req(chunk);
+	struct test_raid_bdev_io *test_raid_bdev_io;
+	struct raid_io_info *io_info;
+	struct raid_bdev *raid_bdev;
+	uint64_t chunk_offset;
+	uint64_t data_offset;
+	uint8_t data_chunk_idx;
+	void *src_buf, *src_md_buf;
+
+	SPDK_CU_ASSERT_FATAL(stripe_req->type == STRIPE_REQ_RECONSTRUCT);
+	SPDK_CU_ASSERT_FATAL(chunk != stripe_req->reconstruct.chunk);
+
+	test_raid_bdev_io = (struct test_raid_bdev_io *)spdk_bdev_io_from_ctx(stripe_req->raid_io);
+	io_info = test_raid_bdev_io->io_info;
+	raid_bdev = io_info->r5f_info->raid_bdev;
+
+	CU_ASSERT(offset_blocks >> raid_bdev->strip_size_shift == stripe_req->stripe_index);
+	CU_ASSERT(iov->iov_len == num_blocks * raid_bdev->bdev.blocklen);
+	chunk_offset = offset_blocks - (stripe_req->stripe_index << raid_bdev->strip_size_shift);
+	CU_ASSERT(chunk_offset == stripe_req->reconstruct.chunk_offset);
+
+	if (chunk == stripe_req->parity_chunk) {
+		src_buf = io_info->reference_parity + chunk_offset * raid_bdev->bdev.blocklen;
+		src_md_buf = io_info->reference_md_parity + chunk_offset * raid_bdev->bdev.md_len;
+	} else {
+		data_chunk_idx = chunk < stripe_req->parity_chunk ? chunk->index : chunk->index - 1;
+		data_offset = data_chunk_idx * raid_bdev->strip_size + chunk_offset;
+		src_buf = io_info->stripe_buf + data_offset * raid_bdev->bdev.blocklen;
+		src_md_buf = io_info->stripe_md_buf + data_offset * raid_bdev->bdev.md_len;
+	}
+
+	memcpy(iov->iov_base, src_buf, iov->iov_len);
+	if (md_buf != NULL) {
+		memcpy(md_buf, src_md_buf, num_blocks * raid_bdev->bdev.md_len);
+	}
+
+	return submit_io(io_info, desc, cb, chunk);
+}
+
 int
 spdk_bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 			       struct iovec *iov, int iovcnt, void *md_buf,
@@ -493,9 +617,20 @@ spdk_bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chann
 	struct raid_bdev_io *raid_io = cb_arg;
 	struct test_raid_bdev_io *test_raid_bdev_io;
 
-	SPDK_CU_ASSERT_FATAL(cb == raid5f_chunk_read_complete);
+	if ((cb == raid5f_chunk_complete_bdev_io || cb == raid5f_process_chunk_read_complete) &&
+	    g_stripe_store.data != NULL) {
+		return stripe_store_submit_io(cb_arg, false, desc, iov, iovcnt, md_buf, offset_blocks,
+					      num_blocks, cb);
+	}
+
 	SPDK_CU_ASSERT_FATAL(iovcnt == 1);
 
+	if (cb == raid5f_chunk_complete_bdev_io) {
+		return test_reconstruct_chunk_read(cb_arg, desc, iov, md_buf, offset_blocks, num_blocks, cb);
+	}
+
+	SPDK_CU_ASSERT_FATAL(cb == raid5f_chunk_read_complete);
+
 	test_raid_bdev_io = (struct test_raid_bdev_io *)spdk_bdev_io_from_ctx(raid_io);
 
 	memcpy(iov->iov_base, test_raid_bdev_io->buf, iov->iov_len);
@@ -590,6 +725,8 @@ deinit_io_info(struct raid_io_info *io_info)
 	free(io_info->reference_parity);
 	free(io_info->parity_md_buf);
 	free(io_info->reference_md_parity);
+	free(io_info->stripe_buf);
+	free(io_info->stripe_md_buf);
 }
 
 static void
@@ -693,6 +830,59 @@ io_info_setup_parity(struct raid_io_info *io_info)
 	}
 }
 
+static void
+io_info_setup_stripe(struct raid_io_info *io_info, uint64_t stripe_offset_blocks)
+{
+	struct raid5f_info *r5f_info = io_info->r5f_info;
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint32_t md_len = raid_bdev->bdev.md_len;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * md_len;
+	uint64_t block;
+	void *src;
+	uint64_t i;
+
+	io_info->stripe_buf = malloc(r5f_info->stripe_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(io_info->stripe_buf != NULL);
+	for (block = 0; block < r5f_info->stripe_blocks; block++) {
+		memset(io_info->stripe_buf + block * blocklen, (uint8_t)block, blocklen);
+		*((uint64_t *)(io_info->stripe_buf + block * blocklen)) = block;
+	}
+
+	io_info->reference_parity = calloc(1, strip_len);
+	SPDK_CU_ASSERT_FATAL(io_info->reference_parity != NULL);
+	src = io_info->stripe_buf;
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		xor_block(io_info->reference_parity, src, strip_len);
+		src += strip_len;
+	}
+
+	memcpy(io_info->src_buf, io_info->stripe_buf + stripe_offset_blocks * blocklen,
+	       io_info->buf_size);
+
+	if (md_len == 0) {
+		return;
+	}
+
+	io_info->stripe_md_buf = malloc(r5f_info->stripe_blocks * md_len);
+	SPDK_CU_ASSERT_FATAL(io_info->stripe_md_buf != NULL);
+	for (i = 0; i < r5f_info->stripe_blocks * md_len; i++) {
+		*((uint8_t *)(io_info->stripe_md_buf + i)) = (uint8_t)(i * 7);
+	}
+
+	io_info->reference_md_parity = calloc(1, strip_md_len);
+	SPDK_CU_ASSERT_FATAL(io_info->reference_md_parity != NULL);
+	src = io_info->stripe_md_buf;
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		xor_block(io_info->reference_md_parity, src, strip_md_len);
+		src += strip_md_len;
+	}
+
+	memcpy(io_info->src_md_buf, io_info->stripe_md_buf + stripe_offset_blocks * md_len,
+	       io_info->num_blocks * md_len);
+}
+
 static void
 test_raid5f_submit_rw_request(struct raid5f_info *r5f_info, struct raid_bdev_io_channel *raid_ch,
 			      enum spdk_bdev_io_type io_type, uint64_t stripe_index, uint64_t stripe_offset_blocks,
@@ -731,6 +921,7 @@ run_for_each_raid5f_config(void (*test_fn)(struct raid_bdev *raid_bdev,
 			   struct raid_bdev_io_channel *raid_ch))
 {
 	struct raid_params *params;
+	uint8_t i;
 
 	RAID_PARAMS_FOR_EACH(params) {
 		struct raid5f_info *r5f_info;
@@ -741,6 +932,9 @@ run_for_each_raid5f_config(void (*test_fn)(struct raid_bdev *raid_bdev,
 		raid_ch.num_channels = params->num_base_bdevs;
 		raid_ch.base_channel = calloc(params->num_base_bdevs, sizeof(struct spdk_io_channel *));
 		SPDK_CU_ASSERT_FATAL(raid_ch.base_channel != NULL);
+		for (i = 0; i < params->num_base_bdevs; i++) {
+			raid_ch.base_channel[i] = (void *)1;
+		}
 
 		raid_ch.module_channel = raid5f_get_io_channel(r5f_info->raid_bdev);
 		SPDK_CU_ASSERT_FATAL(raid_ch.module_channel);
@@ -793,6 +987,80 @@ test_raid5f_submit_read_request(void)
 	run_for_each_raid5f_config(__test_raid5f_submit_read_request);
 }
 
+static void
+test_raid5f_submit_degraded_read(struct raid5f_info *r5f_info, struct raid_bdev_io_channel *raid_ch,
+				 uint64_t stripe_index, uint64_t stripe_offset_blocks, uint64_t num_blocks)
+{
+	uint64_t offset_blocks = stripe_index * r5f_info->stripe_blocks + stripe_offset_blocks;
+	struct raid_io_info io_info;
+
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, num_blocks);
+	io_info_setup_stripe(&io_info, stripe_offset_blocks);
+
+	test_raid5f_read_request(&io_info);
+
+	/* the xor completes asynchronously */
+	poll_threads();
+
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info.src_buf, io_info.dest_buf, io_info.buf_size) == 0);
+	if (io_info.src_md_buf != NULL) {
+		CU_ASSERT(memcmp(io_info.src_md_buf, io_info.dest_md_buf,
+				 num_blocks * r5f_info->raid_bdev->bdev.md_len) == 0);
+	}
+
+	deinit_io_info(&io_info);
+}
+
+static void
+__test_raid5f_submit_degraded_read_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = spdk_io_channel_get_ctx(raid_ch->module_channel);
+	uint32_t strip_size = raid_bdev->strip_size;
+	struct spdk_io_channel *base_ch;
+	struct stripe_request *stripe_req;
+	uint64_t stripe_index;
+	uint8_t missing_idx;
+	unsigned int i, free_reqs;
+
+	for (missing_idx = 0; missing_idx < raid_bdev->num_base_bdevs; missing_idx++) {
+		base_ch = raid_ch->base_channel[missing_idx];
+		raid_ch->base_channel[missing_idx] = NULL;
+
+		for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+			uint64_t stripe_offset = i * strip_size;
+
+			RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+				test_raid5f_submit_degraded_read(r5f_info, raid_ch, stripe_index,
+								 stripe_offset, strip_size);
+
+				test_raid5f_submit_degraded_read(r5f_info, raid_ch, stripe_index,
+								 stripe_offset + strip_size - 1, 1);
+				if (strip_size <= 2) {
+					continue;
+				}
+				test_raid5f_submit_degraded_read(r5f_info, raid_ch, stripe_index,
+								 stripe_offset + 1, strip_size - 2);
+			}
+		}
+
+		raid_ch->base_channel[missing_idx] = base_ch;
+	}
+
+	free_reqs = 0;
+	TAILQ_FOREACH(stripe_req, &r5ch->free_stripe_requests.reconstruct, link) {
+		free_reqs++;
+	}
+	CU_ASSERT(free_reqs == RAID5F_MAX_RECONSTRUCT_STRIPES);
+}
+static void
+test_raid5f_submit_degraded_read_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_degraded_read_request);
+}
+
 static void
 __test_raid5f_stripe_request_map_iovecs(struct raid_bdev *raid_bdev,
 					struct raid_bdev_io_channel *raid_ch)
@@ -922,6 +1190,59 @@ test_raid5f_chunk_write_error(void)
 	run_for_each_raid5f_config(__test_raid5f_chunk_write_error);
 }
 
+static void
+__test_raid5f_submit_degraded_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct spdk_io_channel *base_ch;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+	struct raid_io_info io_info;
+	uint64_t stripe_index;
+	uint8_t missing_idx;
+	unsigned int submitted;
+
+	for (missing_idx = 0; missing_idx < raid_bdev->num_base_bdevs; missing_idx++) {
+		base_ch = raid_ch->base_channel[missing_idx];
+		raid_ch->base_channel[missing_idx] = NULL;
+
+		RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+			init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+				     stripe_index * r5f_info->stripe_blocks, r5f_info->stripe_blocks);
+			io_info_setup_parity(&io_info);
+
+			raid_io = get_raid_io(&io_info);
+			raid5f_submit_rw_request(raid_io);
+			poll_threads();
+
+			submitted = 0;
+			TAILQ_FOREACH(bdev_io, &io_info.bdev_io_queue, internal.link) {
+				CU_ASSERT(bdev_io->bdev != raid_bdev->base_bdev_info[missing_idx].desc->bdev);
+				submitted++;
+			}
+			CU_ASSERT(submitted == raid_bdev->num_base_bdevs - 1u);
+
+			process_io_completions(&io_info);
+
+			CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+			if (missing_idx != raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index)) {
+				CU_ASSERT(memcmp(io_info.parity_buf, io_info.reference_parity,
+						 io_info.parity_buf_size) == 0);
+			}
+
+			deinit_io_info(&io_info);
+		}
+
+		raid_ch->base_channel[missing_idx] = base_ch;
+	}
+}
+static void
+test_raid5f_submit_degraded_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_degraded_write_request);
+}
+
 struct chunk_write_error_with_enomem_ctx {
 	enum test_bdev_error_type error_type;
 	struct spdk_bdev *bdev;
@@ -982,6 +1303,460 @@ test_raid5f_chunk_write_error_with_enomem(void)
 	run_for_each_raid5f_config(__test_raid5f_chunk_write_error_with_enomem);
 }
 
+static void
+stripe_store_init(struct raid_bdev *raid_bdev, uint64_t stripe_index)
+{
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * raid_bdev->bdev.md_len;
+	uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+	uint8_t i;
+	size_t j;
+
+	g_stripe_store.stripe_index = stripe_index;
+	g_stripe_store.reads = 0;
+	g_stripe_store.writes = 0;
+	g_stripe_store.data = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	g_stripe_store.md = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	g_stripe_store.expected_data = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	g_stripe_store.expected_md = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	SPDK_CU_ASSERT_FATAL(g_stripe_store.data != NULL && g_stripe_store.md != NULL &&
+			     g_stripe_store.expected_data != NULL && g_stripe_store.expected_md != NULL);
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		g_stripe_store.data[i] = calloc(1, strip_len);
+		g_stripe_store.md[i] = calloc(1, strip_md_len + 1);
+		g_stripe_store.expected_data[i] = malloc(strip_len);
+		g_stripe_store.expected_md[i] = malloc(strip_md_len + 1);
+		SPDK_CU_ASSERT_FATAL(g_stripe_store.data[i] != NULL && g_stripe_store.md[i] != NULL &&
+				     g_stripe_store.expected_data[i] != NULL &&
+				     g_stripe_store.expected_md[i] != NULL);
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (i == p_idx) {
+			continue;
+		}
+		for (j = 0; j < strip_len; j++) {
+			((uint8_t *)g_stripe_store.data[i])[j] = rand();
+		}
+		for (j = 0; j < strip_md_len; j++) {
+			((uint8_t *)g_stripe_store.md[i])[j] = rand();
+		}
+		xor_block(g_stripe_store.data[p_idx], g_stripe_store.data[i], strip_len);
+		xor_block(g_stripe_store.md[p_idx], g_stripe_store.md[i], strip_md_len);
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		memcpy(g_stripe_store.expected_data[i], g_stripe_store.data[i], strip_len);
+		memcpy(g_stripe_store.expected_md[i], g_stripe_store.md[i], strip_md_len);
+	}
+}
+
+static void
+stripe_store_free(struct raid_bdev *raid_bdev)
+{
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		free(g_stripe_store.data[i]);
+		free(g_stripe_store.md[i]);
+		free(g_stripe_store.expected_data[i]);
+		free(g_stripe_store.expected_md[i]);
+	}
+	free(g_stripe_store.data);
+	free(g_stripe_store.md);
+	free(g_stripe_store.expected_data);
+	free(g_stripe_store.expected_md);
+	memset(&g_stripe_store, 0, sizeof(g_stripe_store));
+}
+
+static void
+stripe_store_expect_write(struct raid_io_info *io_info)
+{
+	struct raid_bdev *raid_bdev = io_info->r5f_info->raid_bdev;
+	uint64_t stripe_offset = io_info->offset_blocks % io_info->r5f_info->stripe_blocks;
+	uint8_t data_chunk_idx = stripe_offset >> raid_bdev->strip_size_shift;
+	uint64_t chunk_offset = stripe_offset - (data_chunk_idx << raid_bdev->strip_size_shift);
+	uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, g_stripe_store.stripe_index);
+	uint8_t idx = data_chunk_idx < p_idx ? data_chunk_idx : data_chunk_idx + 1;
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * raid_bdev->bdev.md_len;
+	uint8_t i;
+
+	memcpy(g_stripe_store.expected_data[idx] + chunk_offset * raid_bdev->bdev.blocklen,
+	       io_info->src_buf, io_info->buf_size);
+	if (io_info->src_md_buf != NULL) {
+		memcpy(g_stripe_store.expected_md[idx] + chunk_offset * raid_bdev->bdev.md_len,
+		       io_info->src_md_buf, io_info->num_blocks * raid_bdev->bdev.md_len);
+	}
+
+	memset(g_stripe_store.expected_data[p_idx], 0, strip_len);
+	memset(g_stripe_store.expected_md[p_idx], 0, strip_md_len);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (i != p_idx) {
+			xor_block(g_stripe_store.expected_data[p_idx], g_stripe_store.expected_data[i], strip_len);
+			xor_block(g_stripe_store.expected_md[p_idx], g_stripe_store.expected_md[i], strip_md_len);
+		}
+	}
+}
+
+static void
+stripe_store_verify(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * raid_bdev->bdev.md_len;
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_ch->base_channel[i] == NULL) {
+			continue;
+		}
+		CU_ASSERT(memcmp(g_stripe_store.data[i], g_stripe_store.expected_data[i], strip_len) == 0);
+		CU_ASSERT(memcmp(g_stripe_store.md[i], g_stripe_store.expected_md[i], strip_md_len) == 0);
+	}
+}
+
+static void
+run_stripe_io(struct raid_io_info *io_info)
+{
+	while (!TAILQ_EMPTY(&io_info->bdev_io_queue) || poll_thread(0)) {
+		process_io_completions(io_info);
+	}
+}
+
+static void
+init_partial_write_io_info(struct raid_io_info *io_info, struct raid_bdev *raid_bdev,
+			   struct raid_bdev_io_channel *raid_ch, uint64_t stripe_index,
+			   uint8_t data_chunk_idx, uint64_t chunk_offset, uint64_t num_blocks)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint64_t offset_blocks = stripe_index * r5f_info->stripe_blocks +
+				 data_chunk_idx * raid_bdev->strip_size + chunk_offset;
+
+	init_io_info(io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, offset_blocks, num_blocks);
+	stripe_store_expect_write(io_info);
+}
+
+static void
+test_raid5f_partial_write(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+			  uint64_t stripe_index, uint8_t data_chunk_idx, uint64_t chunk_offset,
+			  uint64_t num_blocks)
+{
+	struct raid_io_info io_info;
+	uint8_t n = raid_bdev->num_base_bdevs;
+	uint8_t missing = 0;
+	uint8_t i;
+
+	for (i = 0; i < n; i++) {
+		if (raid_ch->base_channel[i] == NULL) {
+			missing++;
+		}
+	}
+
+	stripe_store_init(raid_bdev, stripe_index);
+	init_partial_write_io_info(&io_info, raid_bdev, raid_ch, stripe_index, data_chunk_idx,
+				   chunk_offset, num_blocks);
+
+	raid5f_submit_rw_request(get_raid_io(&io_info));
+	run_stripe_io(&io_info);
+
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	stripe_store_verify(raid_bdev, raid_ch);
+	if (missing == 0) {
+		/* read-modify-write reads the chunk and parity, reconstruct-write the other chunks */
+		CU_ASSERT(g_stripe_store.reads == (unsigned int)spdk_min(2, n - 2));
+		CU_ASSERT(g_stripe_store.writes == 2);
+	}
+
+	deinit_io_info(&io_info);
+	stripe_store_free(raid_bdev);
+}
+
+static void
+__test_raid5f_submit_partial_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t stripe_index;
+	uint8_t i;
+
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+			test_raid5f_partial_write(raid_bdev, raid_ch, stripe_index, i, 0, 1);
+			test_raid5f_partial_write(raid_bdev, raid_ch, stripe_index, i, strip_size - 1, 1);
+			if (strip_size <= 2) {
+				continue;
+			}
+			test_raid5f_partial_write(raid_bdev, raid_ch, stripe_index, i, 1, strip_size - 2);
+		}
+	}
+}
+static void
+test_raid5f_submit_partial_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_write_request);
+}
+
+static void
+__test_raid5f_submit_degraded_partial_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct spdk_io_channel *base_ch;
+	uint64_t stripe_index;
+	uint8_t missing_idx;
+	uint8_t i;
+
+	for (missing_idx = 0; missing_idx < raid_bdev->num_base_bdevs; missing_idx++) {
+		base_ch = raid_ch->base_channel[missing_idx];
+		raid_ch->base_channel[missing_idx] = NULL;
+
+		for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+			RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+				test_raid5f_partial_write(raid_bdev, raid_ch, stripe_index, i, 0,
+							  raid_bdev->strip_size / 2 + 1);
+			}
+		}
+
+		raid_ch->base_channel[missing_idx] = base_ch;
+	}
+}
+static void
+test_raid5f_submit_degraded_partial_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_degraded_partial_write_request);
+}
+
+static void
+__test_raid5f_stripe_cache_merge(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	uint8_t n_data = raid5f_stripe_data_chunks_num(raid_bdev);
+	struct raid_io_info *io_infos;
+	uint64_t stripe_index;
+	uint8_t num_chunks, i;
+
+	io_infos = calloc(n_data, sizeof(*io_infos));
+	SPDK_CU_ASSERT_FATAL(io_infos != NULL);
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		for (num_chunks = 1; num_chunks <= n_data; num_chunks++) {
+			stripe_store_init(raid_bdev, stripe_index);
+
+			for (i = 0; i < num_chunks; i++) {
+				init_partial_write_io_info(&io_infos[i], raid_bdev, raid_ch, stripe_index, i, 0,
+							   raid_bdev->strip_size);
+				raid5f_submit_rw_request(get_raid_io(&io_infos[i]));
+			}
+
+			/* the chunk writes are held in the stripe cache until the thread is polled */
+			if (num_chunks < n_data) {
+				CU_ASSERT(TAILQ_EMPTY(&io_infos[0].bdev_io_queue));
+				poll_thread(0);
+			}
+
+			run_stripe_io(&io_infos[0]);
+
+			for (i = 0; i < num_chunks; i++) {
+				CU_ASSERT(io_infos[i].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				CU_ASSERT(TAILQ_EMPTY(&io_infos[i].bdev_io_queue));
+				deinit_io_info(&io_infos[i]);
+			}
+
+			stripe_store_verify(raid_bdev, raid_ch);
+			CU_ASSERT(g_stripe_store.reads == spdk_min(num_chunks + 1u, (unsigned int)(n_data - num_chunks)));
+			CU_ASSERT(g_stripe_store.writes == num_chunks + 1u);
+
+			stripe_store_free(raid_bdev);
+		}
+	}
+
+	free(io_infos);
+}
+static void
+test_raid5f_stripe_cache_merge(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_stripe_cache_merge);
+}
+
+static bool
+stripe_lock_has_waiters(struct raid5f_info *r5f_info, uint64_t stripe_index)
+{
+	return !TAILQ_EMPTY(&r5f_info->locked_stripes[stripe_index %
+					       RAID5F_STRIPE_LOCK_BUCKETS].waiting);
+}
+
+static void
+run_stripe_io_on_thread(struct raid_io_info *io_info, uintptr_t thread_id)
+{
+	set_thread(thread_id);
+	while (!TAILQ_EMPTY(&io_info->bdev_io_queue) || poll_thread(thread_id)) {
+		process_io_completions(io_info);
+	}
+	set_thread(0);
+}
+
+static void
+__test_raid5f_stripe_lock(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid_bdev_io_channel raid_ch2 = *raid_ch;
+	struct raid_io_info io_info[2];
+	unsigned int reads;
+	uint64_t stripe_index;
+
+	if (raid_bdev->strip_size == 1) {
+		/* single block writes would be full chunk writes going through the stripe cache */
+		return;
+	}
+
+	/* a second io channel for the raid bdev on another thread */
+	set_thread(1);
+	raid_ch2.module_channel = raid5f_get_io_channel(raid_bdev);
+	SPDK_CU_ASSERT_FATAL(raid_ch2.module_channel != NULL);
+	set_thread(0);
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		stripe_store_init(raid_bdev, stripe_index);
+
+		init_partial_write_io_info(&io_info[0], raid_bdev, raid_ch, stripe_index, 0, 0, 1);
+		init_partial_write_io_info(&io_info[1], raid_bdev, raid_ch, stripe_index, 1, 0, 1);
+
+		raid5f_submit_rw_request(get_raid_io(&io_info[0]));
+		reads = g_stripe_store.reads;
+		CU_ASSERT(reads > 0);
+
+		/* the second write to the same stripe waits for the first one */
+		raid5f_submit_rw_request(get_raid_io(&io_info[1]));
+		CU_ASSERT(g_stripe_store.reads == reads);
+		CU_ASSERT(stripe_lock_has_waiters(r5f_info, stripe_index));
+
+		while (io_info[1].status == SPDK_BDEV_IO_STATUS_PENDING) {
+			run_stripe_io(&io_info[0]);
+			run_stripe_io(&io_info[1]);
+		}
+
+		CU_ASSERT(io_info[0].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(io_info[1].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(!stripe_lock_has_waiters(r5f_info, stripe_index));
+		stripe_store_verify(raid_bdev, raid_ch);
+
+		deinit_io_info(&io_info[0]);
+		deinit_io_info(&io_info[1]);
+		stripe_store_free(raid_bdev);
+
+		/* the same with the second write submitted on another thread */
+		stripe_store_init(raid_bdev, stripe_index);
+
+		init_partial_write_io_info(&io_info[0], raid_bdev, raid_ch, stripe_index, 0, 0, 1);
+		init_partial_write_io_info(&io_info[1], raid_bdev, &raid_ch2, stripe_index, 1, 0, 1);
+
+		raid5f_submit_rw_request(get_raid_io(&io_info[0]));
+		reads = g_stripe_store.reads;
+
+		set_thread(1);
+		raid5f_submit_rw_request(get_raid_io(&io_info[1]));
+		set_thread(0);
+		CU_ASSERT(g_stripe_store.reads == reads);
+		CU_ASSERT(stripe_lock_has_waiters(r5f_info, stripe_index));
+
+		/* the waiting write is started on its own thread once the first one completes */
+		run_stripe_io(&io_info[0]);
+		CU_ASSERT(io_info[0].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(!stripe_lock_has_waiters(r5f_info, stripe_index));
+		CU_ASSERT(g_stripe_store.reads == reads);
+
+		run_stripe_io_on_thread(&io_info[1], 1);
+		CU_ASSERT(io_info[1].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(g_stripe_store.reads > reads);
+		stripe_store_verify(raid_bdev, raid_ch);
+
+		deinit_io_info(&io_info[0]);
+		deinit_io_info(&io_info[1]);
+		stripe_store_free(raid_bdev);
+	}
+
+	set_thread(1);
+	spdk_put_io_channel(raid_ch2.module_channel);
+	set_thread(0);
+	poll_threads();
+}
+
+static void
+test_raid5f_stripe_lock(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_stripe_lock);
+}
+
+static void
+__test_raid5f_process_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * raid_bdev->bdev.md_len;
+	struct raid_bdev_process_request process_req = {};
+	struct raid_io_info io_info;
+	struct spdk_io_channel *base_ch;
+	uint64_t stripe_index;
+	uint8_t target_idx;
+	int ret;
+
+	process_req.iov.iov_base = spdk_dma_malloc(strip_len, 4096, NULL);
+	SPDK_CU_ASSERT_FATAL(process_req.iov.iov_base != NULL);
+	process_req.iov.iov_len = strip_len;
+	if (strip_md_len != 0) {
+		process_req.md_buf = spdk_dma_malloc(strip_md_len, 4096, NULL);
+		SPDK_CU_ASSERT_FATAL(process_req.md_buf != NULL);
+	}
+	process_req.target_ch = (void *)1;
+
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 0);
+	g_process_io_info = &io_info;
+
+	for (target_idx = 0; target_idx < raid_bdev->num_base_bdevs; target_idx++) {
+		process_req.target = &raid_bdev->base_bdev_info[target_idx];
+		process_req.target->raid_bdev = raid_bdev;
+
+		RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+			/* The target chunk is rebuilt from the other chunks of the stripe */
+			stripe_store_init(raid_bdev, stripe_index);
+			memset(g_stripe_store.data[target_idx], 0, strip_len);
+			memset(g_stripe_store.md[target_idx], 0, strip_md_len);
+			g_process_requests_completed = 0;
+
+			process_req.offset_blocks = stripe_index * r5f_info->stripe_blocks;
+			process_req.num_blocks = r5f_info->stripe_blocks;
+
+			ret = raid5f_submit_process_request(&process_req, raid_ch);
+			CU_ASSERT(ret == (int)r5f_info->stripe_blocks);
+			run_stripe_io(&io_info);
+
+			CU_ASSERT(g_process_requests_completed == 1);
+			CU_ASSERT(g_process_request_status == 0);
+			CU_ASSERT(g_stripe_store.reads == raid_bdev->num_base_bdevs - 1u);
+			CU_ASSERT(g_stripe_store.writes == 1);
+			stripe_store_verify(raid_bdev, raid_ch);
+
+			stripe_store_free(raid_bdev);
+		}
+
+		/* A stripe can't be rebuilt with another base bdev missing */
+		base_ch = raid_ch->base_channel[(target_idx + 1) % raid_bdev->num_base_bdevs];
+		raid_ch->base_channel[(target_idx + 1) % raid_bdev->num_base_bdevs] = NULL;
+		process_req.offset_blocks = 0;
+		CU_ASSERT(raid5f_submit_process_request(&process_req, raid_ch) == -ENODEV);
+		raid_ch->base_channel[(target_idx + 1) % raid_bdev->num_base_bdevs] = base_ch;
+	}
+
+	g_process_io_info = NULL;
+	deinit_io_info(&io_info);
+	spdk_dma_free(process_req.iov.iov_base);
+	spdk_dma_free(process_req.md_buf);
+}
+static void
+test_raid5f_process_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_process_request);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -998,8 +1773,15 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid5f_submit_full_stripe_write_request);
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error);
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error_with_enomem);
-
-	allocate_threads(1);
+	CU_ADD_TEST(suite, test_raid5f_submit_degraded_read_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_degraded_write_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_degraded_partial_write_request);
+	CU_ADD_TEST(suite, test_raid5f_stripe_cache_merge);
+	CU_ADD_TEST(suite, test_raid5f_stripe_lock);
+	CU_ADD_TEST(suite, test_raid5f_process_request);
+
+	allocate_threads(2);
 	set_thread(0);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
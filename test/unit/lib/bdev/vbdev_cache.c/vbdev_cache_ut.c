@@ -0,0 +1,519 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "thread/thread_internal.h"
+#include "common/lib/test_env.c"
+#include "bdev/cache/vbdev_cache.c"
+#include "bdev/cache/vbdev_cache_rpc.c"
+
+#define BLOCK_SIZE	512
+#define BLOCK_CNT	4096
+#define LINE_SIZE	4096
+#define LINE_BLOCKS	(LINE_SIZE / BLOCK_SIZE)
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_write_zeroes_blocks, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unmap_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_copy_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t dst_offset_blocks, uint64_t src_offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_flush_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_abort, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   void *bio_cb_arg, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_json_decode_string, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint64, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_object, int, (const struct spdk_json_val *values,
+		const struct spdk_json_object_decoder *decoders, size_t num_decoders, void *out), 0);
+DEFINE_STUB(spdk_json_write_name, int, (struct spdk_json_write_ctx *w, const char *name), 0);
+DEFINE_STUB(spdk_json_write_string, int, (struct spdk_json_write_ctx *w, const char *val), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint64_t val), 0);
+DEFINE_STUB_V(spdk_rpc_register_method, (const char *method, spdk_rpc_method_handler func,
+		uint32_t state_mask));
+DEFINE_STUB(spdk_jsonrpc_begin_result, struct spdk_json_write_ctx *,
+	    (struct spdk_jsonrpc_request *request), NULL);
+DEFINE_STUB_V(spdk_jsonrpc_end_result, (struct spdk_jsonrpc_request *request,
+					struct spdk_json_write_ctx *w));
+DEFINE_STUB_V(spdk_jsonrpc_send_bool_response, (struct spdk_jsonrpc_request *request,
+		bool value));
+DEFINE_STUB_V(spdk_jsonrpc_send_error_response, (struct spdk_jsonrpc_request *request,
+		int error_code, const char *msg));
+
+static struct spdk_thread *g_thread;
+static struct spdk_bdev g_base_bdev;
+static uint8_t g_disk[BLOCK_CNT * BLOCK_SIZE];
+static uint32_t g_base_reads;
+static int g_io_status;
+static struct spdk_io_channel *g_ch;
+
+/* Base I/O is completed only when the test asks for it, so that writes can be
+ * interleaved with outstanding reads.
+ */
+struct ut_base_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	bool				write;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	uint8_t				*buf;
+	TAILQ_ENTRY(ut_base_io)		link;
+};
+static TAILQ_HEAD(ut_base_io_list, ut_base_io) g_base_ios = TAILQ_HEAD_INITIALIZER(g_base_ios);
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	if (strcmp(bdev_name, g_base_bdev.name) != 0) {
+		return -ENODEV;
+	}
+	*_desc = (void *)&g_base_bdev;
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+static int
+ut_base_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_base_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(g_ch, bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	CU_ASSERT(bdev_io == (void *)0xdeadbeef);
+}
+
+static int
+ut_submit_base_io(bool write, struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+		  uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_base_io *io;
+
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	io->write = write;
+	io->offset_blocks = offset_blocks;
+	io->num_blocks = num_blocks;
+	io->buf = malloc(num_blocks * BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(io->buf != NULL);
+
+	/* Reads sample the disk at submission, writes apply at completion. */
+	if (write) {
+		spdk_copy_iovs_to_buf(io->buf, num_blocks * BLOCK_SIZE, iov, iovcnt);
+	} else {
+		memcpy(io->buf, &g_disk[offset_blocks * BLOCK_SIZE], num_blocks * BLOCK_SIZE);
+		g_base_reads++;
+	}
+	TAILQ_INSERT_TAIL(&g_base_ios, io, link);
+
+	return 0;
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			   uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_submit_base_io(false, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			    uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			    struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_submit_base_io(true, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+static void
+ut_complete_base_io(void)
+{
+	struct ut_base_io *io = TAILQ_FIRST(&g_base_ios);
+	struct spdk_bdev_io *orig_io;
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	TAILQ_REMOVE(&g_base_ios, io, link);
+
+	if (io->write) {
+		memcpy(&g_disk[io->offset_blocks * BLOCK_SIZE], io->buf, io->num_blocks * BLOCK_SIZE);
+	} else {
+		/* Reads complete into the iovs of the original I/O, which cb_arg points to. */
+		orig_io = io->cb_arg;
+		spdk_copy_buf_to_iovs(orig_io->u.bdev.iovs, orig_io->u.bdev.iovcnt, io->buf,
+				      io->num_blocks * BLOCK_SIZE);
+	}
+	io->cb((void *)0xdeadbeef, true, io->cb_arg);
+
+	free(io->buf);
+	free(io);
+}
+
+static struct vbdev_cache *
+ut_create_cache(uint64_t size_mb, uint32_t num_shards)
+{
+	struct vbdev_cache_opts opts = {
+		.size_mb = size_mb,
+		.line_size = LINE_SIZE,
+		.num_shards = num_shards,
+	};
+
+	g_base_bdev.name = "base";
+	g_base_bdev.blocklen = BLOCK_SIZE;
+	g_base_bdev.blockcnt = BLOCK_CNT;
+
+	CU_ASSERT(bdev_cache_create_disk("base", "cache0", &opts) == 0);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_cache_nodes));
+
+	return TAILQ_FIRST(&g_cache_nodes);
+}
+
+static void
+ut_delete_cache(struct vbdev_cache *cache_node)
+{
+	vbdev_cache_destruct(cache_node);
+	vbdev_cache_finish();
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(TAILQ_EMPTY(&g_cache_nodes));
+}
+
+static bool
+ut_line_cached(struct vbdev_cache *cache_node, uint64_t line)
+{
+	struct cache_entry *entry;
+
+	entry = cache_shard_lookup(cache_get_shard(cache_node, line), line);
+
+	return entry != NULL && cache_entry_is_resident(entry);
+}
+
+static struct spdk_bdev_io *
+ut_submit(struct spdk_io_channel *ch, struct vbdev_cache *cache_node, enum spdk_bdev_io_type type,
+	  void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct iovec *iov;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct cache_bdev_io) + sizeof(*iov));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	iov = (struct iovec *)((uint8_t *)bdev_io + sizeof(*bdev_io) + sizeof(struct cache_bdev_io));
+	iov->iov_base = buf;
+	iov->iov_len = num_blocks * BLOCK_SIZE;
+
+	bdev_io->bdev = &cache_node->cache_bdev;
+	bdev_io->type = type;
+	bdev_io->internal.ch = (void *)ch;
+	bdev_io->u.bdev.iovs = iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_ch = ch;
+	vbdev_cache_submit_request(ch, bdev_io);
+
+	return bdev_io;
+}
+
+static void
+ut_free_ios(struct spdk_bdev_io **ios, int num)
+{
+	while (num-- > 0) {
+		free(ios[num]);
+	}
+}
+
+static void
+test_2q_scan_resistance(void)
+{
+	struct cache_shard shard = {};
+	struct cache_entry *entry;
+	uint64_t line;
+	uint8_t *buf;
+
+	CU_ASSERT(cache_shard_init(&shard, 8, LINE_SIZE) == 0);
+	CU_ASSERT(shard.kin == 2);
+	CU_ASSERT(shard.kout == 4);
+
+	/* Fill the shard, every line is read once and enters A1in. */
+	for (line = 0; line < 8; line++) {
+		buf = cache_shard_insert(&shard, line);
+		SPDK_CU_ASSERT_FATAL(buf != NULL);
+		memset(buf, (int)line, LINE_SIZE);
+	}
+	CU_ASSERT(shard.a1in_cnt == 8);
+	CU_ASSERT(shard.num_free_slots == 0);
+	CU_ASSERT(cache_shard_insert(&shard, 0) == NULL);
+
+	/* The oldest lines are evicted from A1in and remembered in A1out. */
+	CU_ASSERT(cache_shard_insert(&shard, 100) != NULL);
+	CU_ASSERT(cache_shard_insert(&shard, 101) != NULL);
+	entry = cache_shard_lookup(&shard, 0);
+	SPDK_CU_ASSERT_FATAL(entry != NULL);
+	CU_ASSERT(entry->state == CACHE_ENTRY_A1OUT);
+	CU_ASSERT(shard.a1out_cnt == 2);
+	CU_ASSERT(shard.evictions == 2);
+
+	/* Reading a remembered line again promotes it to Am. */
+	buf = cache_shard_insert(&shard, 0);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, 0xa5, LINE_SIZE);
+	entry = cache_shard_lookup(&shard, 0);
+	CU_ASSERT(entry->state == CACHE_ENTRY_AM);
+	CU_ASSERT(shard.promotions == 1);
+	CU_ASSERT(shard.am_cnt == 1);
+
+	/* A long scan of lines read once does not push the promoted line out. */
+	for (line = 1000; line < 1100; line++) {
+		CU_ASSERT(cache_shard_insert(&shard, line) != NULL);
+		CU_ASSERT(shard.a1out_cnt <= shard.kout);
+		CU_ASSERT(shard.a1in_cnt + shard.am_cnt <= shard.capacity);
+	}
+	entry = cache_shard_lookup(&shard, 0);
+	SPDK_CU_ASSERT_FATAL(entry != NULL);
+	CU_ASSERT(entry->state == CACHE_ENTRY_AM);
+	CU_ASSERT(cache_shard_line_buf(&shard, entry)[LINE_SIZE - 1] == 0xa5);
+
+	/* Lines that fell out of A1out are forgotten. */
+	CU_ASSERT(cache_shard_lookup(&shard, 1) == NULL);
+
+	/* Invalidation drops resident lines and ghosts. */
+	cache_shard_invalidate_line(&shard, 0);
+	CU_ASSERT(cache_shard_lookup(&shard, 0) == NULL);
+	CU_ASSERT(shard.invalidations == 1);
+	cache_shard_invalidate_range(&shard, 1000, 1099);
+	CU_ASSERT(shard.a1in_cnt == 0);
+	CU_ASSERT(shard.am_cnt == 0);
+	CU_ASSERT(shard.a1out_cnt == 0);
+	CU_ASSERT(shard.num_free_slots == shard.capacity);
+
+	cache_shard_fini(&shard);
+}
+
+static void
+test_read_hit_miss(void)
+{
+	struct vbdev_cache *cache_node;
+	struct spdk_io_channel *ch;
+	struct cache_io_channel *cache_ch;
+	struct spdk_bdev_io *ios[8];
+	uint8_t buf[4 * LINE_SIZE];
+	int num_ios = 0;
+	uint32_t i;
+
+	for (i = 0; i < sizeof(g_disk); i++) {
+		g_disk[i] = (uint8_t)(i / BLOCK_SIZE);
+	}
+	g_base_reads = 0;
+
+	cache_node = ut_create_cache(1, 1);
+	ch = spdk_get_io_channel(cache_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	cache_ch = spdk_io_channel_get_ctx(ch);
+
+	/* Miss, a read of two full lines and a part of a third fills only the full lines. */
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, LINE_BLOCKS,
+				   2 * LINE_BLOCKS + 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_PENDING);
+	ut_complete_base_io();
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base_reads == 1);
+	CU_ASSERT(cache_ch->read_misses == 1);
+	CU_ASSERT(ut_line_cached(cache_node, 1));
+	CU_ASSERT(ut_line_cached(cache_node, 2));
+	CU_ASSERT(!ut_line_cached(cache_node, 3));
+
+	/* Hit, an unaligned read within the cached lines does not reach the base bdev. */
+	memset(buf, 0, sizeof(buf));
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, LINE_BLOCKS + 3,
+				   LINE_BLOCKS);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base_reads == 1);
+	CU_ASSERT(cache_ch->read_hits == 1);
+	for (i = 0; i < LINE_BLOCKS; i++) {
+		CU_ASSERT(buf[i * BLOCK_SIZE] == (uint8_t)(LINE_BLOCKS + 3 + i));
+		CU_ASSERT(buf[(i + 1) * BLOCK_SIZE - 1] == (uint8_t)(LINE_BLOCKS + 3 + i));
+	}
+
+	/* A read that is only partly cached goes to the base bdev as a whole. */
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, 3 * LINE_BLOCKS - 1,
+				   2);
+	CU_ASSERT(g_base_reads == 2);
+	CU_ASSERT(cache_ch->read_misses == 2);
+	ut_complete_base_io();
+	CU_ASSERT(buf[0] == (uint8_t)(3 * LINE_BLOCKS - 1));
+	CU_ASSERT(buf[BLOCK_SIZE] == (uint8_t)(3 * LINE_BLOCKS));
+
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	ut_free_ios(ios, num_ios);
+	ut_delete_cache(cache_node);
+}
+
+static void
+test_write_invalidation(void)
+{
+	struct vbdev_cache *cache_node;
+	struct spdk_io_channel *ch;
+	struct spdk_bdev_io *ios[8];
+	struct ut_base_io *base_io;
+	uint8_t buf[LINE_SIZE], wbuf[LINE_SIZE];
+	int num_ios = 0;
+
+	memset(g_disk, 0x11, sizeof(g_disk));
+	g_base_reads = 0;
+
+	cache_node = ut_create_cache(1, 2);
+	ch = spdk_get_io_channel(cache_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	/* Cache line 0, then overwrite it. The write drops the line at submission. */
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, 0, LINE_BLOCKS);
+	ut_complete_base_io();
+	CU_ASSERT(ut_line_cached(cache_node, 0));
+
+	memset(wbuf, 0x22, sizeof(wbuf));
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_WRITE, wbuf, 0, 1);
+	CU_ASSERT(!ut_line_cached(cache_node, 0));
+	ut_complete_base_io();
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A read that sampled the disk before a write completed must not fill the cache. */
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, LINE_BLOCKS, LINE_BLOCKS);
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_WRITE, wbuf, LINE_BLOCKS,
+				   LINE_BLOCKS);
+	/* Complete the write first, then the stale read. */
+	base_io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	TAILQ_REMOVE(&g_base_ios, base_io, link);
+	TAILQ_INSERT_HEAD(&g_base_ios, base_io, link);
+	ut_complete_base_io();
+	ut_complete_base_io();
+	CU_ASSERT(buf[0] == 0x11);
+	CU_ASSERT(!ut_line_cached(cache_node, 1));
+
+	/* The next read goes to the base bdev and sees the new data. */
+	ios[num_ios++] = ut_submit(ch, cache_node, SPDK_BDEV_IO_TYPE_READ, buf, LINE_BLOCKS, LINE_BLOCKS);
+	ut_complete_base_io();
+	CU_ASSERT(buf[0] == 0x22);
+	CU_ASSERT(ut_line_cached(cache_node, 1));
+
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	ut_free_ios(ios, num_ios);
+	ut_delete_cache(cache_node);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_cache", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_2q_scan_resistance);
+	CU_ADD_TEST(suite, test_read_hit_miss);
+	CU_ADD_TEST(suite, test_write_invalidation);
+
+	spdk_thread_lib_init(NULL, 0);
+	g_thread = spdk_thread_create("test", NULL);
+	spdk_set_thread(g_thread);
+	spdk_io_device_register(&g_base_bdev, ut_base_ch_create_cb, ut_base_ch_destroy_cb, 0, "base");
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+
+	spdk_io_device_unregister(&g_base_bdev, NULL);
+
+	spdk_thread_exit(g_thread);
+	while (!spdk_thread_is_exited(g_thread)) {
+		spdk_thread_poll(g_thread, 0, 0);
+	}
+	spdk_thread_destroy(g_thread);
+	spdk_thread_lib_fini();
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,874 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "thread/thread_internal.h"
+#include "common/lib/test_env.c"
+#include "bdev/dedup/vbdev_dedup.c"
+#include "bdev/dedup/vbdev_dedup_rpc.c"
+
+#define BLOCK_SIZE	512
+#define BLOCK_CNT	2048
+#define CHUNK_SIZE	4096
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_get_md_size, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 64);
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_json_decode_string, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint64, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_object, int, (const struct spdk_json_val *values,
+		const struct spdk_json_object_decoder *decoders, size_t num_decoders, void *out), 0);
+DEFINE_STUB(spdk_json_write_name, int, (struct spdk_json_write_ctx *w, const char *name), 0);
+DEFINE_STUB(spdk_json_write_string, int, (struct spdk_json_write_ctx *w, const char *val), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint64_t val), 0);
+DEFINE_STUB(spdk_json_write_named_double, int, (struct spdk_json_write_ctx *w,
+		const char *name, double val), 0);
+DEFINE_STUB_V(spdk_rpc_register_method, (const char *method, spdk_rpc_method_handler func,
+		uint32_t state_mask));
+DEFINE_STUB(spdk_jsonrpc_begin_result, struct spdk_json_write_ctx *,
+	    (struct spdk_jsonrpc_request *request), NULL);
+DEFINE_STUB_V(spdk_jsonrpc_end_result, (struct spdk_jsonrpc_request *request,
+					struct spdk_json_write_ctx *w));
+DEFINE_STUB_V(spdk_jsonrpc_send_bool_response, (struct spdk_jsonrpc_request *request,
+		bool value));
+DEFINE_STUB_V(spdk_jsonrpc_send_error_response, (struct spdk_jsonrpc_request *request,
+		int error_code, const char *msg));
+
+static struct spdk_thread *g_thread;
+static struct spdk_bdev g_base_bdev;
+static uint8_t g_disk[BLOCK_CNT * BLOCK_SIZE];
+static uint32_t g_base_reads;
+static uint32_t g_base_writes;
+static uint32_t g_base_flushes;
+static uint32_t g_destruct_done;
+static int g_create_rc;
+static int g_accel_dev;
+
+/* Base I/O is queued and completed by ut_run(), so that the vbdev sees it complete
+ * asynchronously like it would on a real bdev.
+ */
+struct ut_base_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	bool				write;
+	bool				flush;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	struct iovec			iov;
+	struct iovec			*iovs;
+	int				iovcnt;
+	TAILQ_ENTRY(ut_base_io)		link;
+};
+static TAILQ_HEAD(ut_base_io_list, ut_base_io) g_base_ios = TAILQ_HEAD_INITIALIZER(g_base_ios);
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	if (strcmp(bdev_name, g_base_bdev.name) != 0) {
+		return -ENODEV;
+	}
+	*_desc = (void *)&g_base_bdev;
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+static int
+ut_base_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_base_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_dev);
+}
+
+int
+spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct iovec *iovs,
+			  uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	*crc_dst = spdk_crc32c_iov_update(iovs, iovcnt, ~seed);
+	cb_fn(cb_arg, 0);
+	return 0;
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+uint64_t
+spdk_bdev_get_num_blocks(const struct spdk_bdev *bdev)
+{
+	return bdev->blockcnt;
+}
+
+struct spdk_thread *
+spdk_bdev_io_get_thread(struct spdk_bdev_io *bdev_io)
+{
+	return g_thread;
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(spdk_io_channel_from_ctx(bdev_io->internal.ch), bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	bdev_io->internal.status = status;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	CU_ASSERT(bdev_io == (void *)0xdeadbeef);
+}
+
+void
+spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
+{
+	CU_ASSERT(bdeverrno == 0);
+	g_destruct_done++;
+}
+
+static int
+ut_submit_base_io(bool write, bool flush, struct iovec *iovs, int iovcnt, void *buf,
+		  uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		  void *cb_arg)
+{
+	struct ut_base_io *io;
+
+	CU_ASSERT(offset_blocks + num_blocks <= BLOCK_CNT);
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	io->write = write;
+	io->flush = flush;
+	io->offset_blocks = offset_blocks;
+	io->num_blocks = num_blocks;
+	if (iovs == NULL) {
+		io->iov.iov_base = buf;
+		io->iov.iov_len = num_blocks * BLOCK_SIZE;
+		iovs = &io->iov;
+		iovcnt = 1;
+	}
+	io->iovs = iovs;
+	io->iovcnt = iovcnt;
+
+	if (flush) {
+		g_base_flushes++;
+	} else if (write) {
+		g_base_writes++;
+	} else {
+		g_base_reads++;
+	}
+	TAILQ_INSERT_TAIL(&g_base_ios, io, link);
+
+	return 0;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		      void *cb_arg)
+{
+	return ut_submit_base_io(false, false, NULL, 0, buf, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_submit_base_io(false, false, iov, iovcnt, NULL, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	return ut_submit_base_io(true, false, NULL, 0, buf, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_submit_base_io(true, false, iov, iovcnt, NULL, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_flush_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		       void *cb_arg)
+{
+	return ut_submit_base_io(false, true, NULL, 0, NULL, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+/* Complete all of the base I/O and process the messages it results in. */
+static void
+ut_run(void)
+{
+	struct ut_base_io *io;
+	uint8_t *disk;
+
+	do {
+		while ((io = TAILQ_FIRST(&g_base_ios))) {
+			TAILQ_REMOVE(&g_base_ios, io, link);
+			disk = &g_disk[io->offset_blocks * BLOCK_SIZE];
+			if (io->write) {
+				spdk_copy_iovs_to_buf(disk, io->num_blocks * BLOCK_SIZE, io->iovs, io->iovcnt);
+			} else if (!io->flush) {
+				spdk_copy_buf_to_iovs(io->iovs, io->iovcnt, disk, io->num_blocks * BLOCK_SIZE);
+			}
+			io->cb((void *)0xdeadbeef, true, io->cb_arg);
+			free(io);
+		}
+	} while (spdk_thread_poll(g_thread, 0, 0) > 0 || !TAILQ_EMPTY(&g_base_ios));
+}
+
+static void
+ut_create_cb(void *cb_arg, int rc)
+{
+	g_create_rc = rc;
+}
+
+static struct vbdev_dedup *
+ut_create_dedup(uint64_t logical_size_mb)
+{
+	struct vbdev_dedup_opts opts = {
+		.chunk_size = CHUNK_SIZE,
+		.logical_size_mb = logical_size_mb,
+	};
+
+	g_base_bdev.name = "base";
+	g_base_bdev.blocklen = BLOCK_SIZE;
+	g_base_bdev.blockcnt = BLOCK_CNT;
+
+	CU_ASSERT(vbdev_dedup_init() == 0);
+	g_create_rc = 1;
+	bdev_dedup_create_disk("base", "dd0", &opts, ut_create_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_create_rc == 0);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_dedup_nodes));
+
+	return TAILQ_FIRST(&g_dedup_nodes);
+}
+
+static void
+ut_delete_dedup(struct vbdev_dedup *node)
+{
+	uint32_t destruct_done = g_destruct_done;
+
+	CU_ASSERT(vbdev_dedup_destruct(node) == 1);
+	ut_run();
+	CU_ASSERT(g_destruct_done == destruct_done + 1);
+	vbdev_dedup_finish();
+	CU_ASSERT(TAILQ_EMPTY(&g_dedup_nodes));
+}
+
+static struct spdk_bdev_io *
+ut_submit(struct spdk_io_channel *ch, struct vbdev_dedup *node, enum spdk_bdev_io_type type,
+	  void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct iovec *iov;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct dedup_bdev_io) + sizeof(*iov));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	iov = (struct iovec *)((uint8_t *)bdev_io + sizeof(*bdev_io) + sizeof(struct dedup_bdev_io));
+	iov->iov_base = buf;
+	iov->iov_len = num_blocks * CHUNK_SIZE;
+
+	bdev_io->bdev = &node->dd_bdev;
+	bdev_io->type = type;
+	bdev_io->internal.ch = spdk_io_channel_get_ctx(ch);
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	bdev_io->u.bdev.iovs = iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	vbdev_dedup_submit_request(ch, bdev_io);
+
+	return bdev_io;
+}
+
+/* Submit an I/O, run it to completion and return its status. */
+static enum spdk_bdev_io_status
+ut_io(struct spdk_io_channel *ch, struct vbdev_dedup *node, enum spdk_bdev_io_type type,
+      void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	enum spdk_bdev_io_status status;
+
+	bdev_io = ut_submit(ch, node, type, buf, offset_blocks, num_blocks);
+	ut_run();
+	status = bdev_io->internal.status;
+	free(bdev_io);
+
+	return status;
+}
+
+static void
+ut_write(struct spdk_io_channel *ch, struct vbdev_dedup *node, uint8_t pattern, uint64_t lchunk)
+{
+	uint8_t buf[CHUNK_SIZE];
+
+	memset(buf, pattern, sizeof(buf));
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_WRITE, buf, lchunk, 1) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+ut_check_read(struct spdk_io_channel *ch, struct vbdev_dedup *node, uint8_t pattern,
+	      uint64_t lchunk)
+{
+	uint8_t buf[CHUNK_SIZE], expected[CHUNK_SIZE];
+
+	memset(buf, 0xa5, sizeof(buf));
+	memset(expected, pattern, sizeof(expected));
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_READ, buf, lchunk, 1) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, expected, sizeof(buf)) == 0);
+}
+
+/* Insert a chunk in the index with the reference a lookup needs to find it. */
+static int
+ut_index_insert(struct vbdev_dedup *node, uint32_t fp, uint32_t chunk)
+{
+	node->refcnt[chunk] = 1;
+	return dedup_index_insert(node, fp, chunk);
+}
+
+/* Return the first candidate for a fingerprint, without keeping a reference to it. */
+static uint32_t
+ut_index_lookup(struct vbdev_dedup *node, uint32_t fp)
+{
+	struct dedup_index_probe probe;
+	uint32_t chunk;
+
+	dedup_index_probe_init(node, fp, &probe);
+	chunk = dedup_index_lookup(node, fp, &probe);
+	if (chunk != DEDUP_NO_CHUNK) {
+		node->refcnt[chunk]--;
+	}
+
+	return chunk;
+}
+
+static uint64_t
+ut_index_entries(struct vbdev_dedup *node)
+{
+	uint64_t entries = 0;
+	uint32_t i;
+
+	for (i = 0; i < node->num_shards; i++) {
+		entries += node->shards[i].entries;
+	}
+
+	return entries;
+}
+
+static void
+ut_get_stats_cb(void *cb_arg, const struct vbdev_dedup_stats *stats, uint32_t num_stats)
+{
+	struct vbdev_dedup_stats *ut_stats = cb_arg;
+
+	CU_ASSERT(num_stats == 1);
+	*ut_stats = stats[0];
+	ut_stats->name = NULL;
+	ut_stats->base_bdev_name = NULL;
+}
+
+static void
+test_dedup_write_read(void)
+{
+	struct vbdev_dedup *node;
+	struct spdk_io_channel *ch;
+	struct dedup_io_channel *dd_ch;
+	struct vbdev_dedup_stats stats = {};
+	uint32_t chunk;
+
+	memset(g_disk, 0xee, sizeof(g_disk));
+	node = ut_create_dedup(0);
+
+	/* 256 chunks: the superblock, one for the mapping table and one for the index. */
+	CU_ASSERT(node->dd_bdev.blocklen == CHUNK_SIZE);
+	CU_ASSERT(node->num_buckets == 64);
+	CU_ASSERT(node->data_offset == 3);
+	CU_ASSERT(node->num_physical_chunks == 253);
+	CU_ASSERT(node->dd_bdev.blockcnt == 253);
+	CU_ASSERT(node->num_free == 253);
+	CU_ASSERT(memcmp(g_disk, DEDUP_SB_MAGIC, 8) == 0);
+	/* The metadata is zeroed before the superblock is written. */
+	CU_ASSERT(spdk_mem_all_zero(&g_disk[CHUNK_SIZE], 2 * CHUNK_SIZE));
+
+	ch = spdk_get_io_channel(node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	dd_ch = spdk_io_channel_get_ctx(ch);
+
+	/* The second write of the same data only maps the chunk. */
+	g_base_writes = 0;
+	ut_write(ch, node, 0x11, 0);
+	CU_ASSERT(g_base_writes == 1);
+	ut_write(ch, node, 0x11, 1);
+	CU_ASSERT(g_base_writes == 1);
+	CU_ASSERT(dd_ch->writes_unique == 1);
+	CU_ASSERT(dd_ch->writes_deduplicated == 1);
+	CU_ASSERT(node->l2p[0] == node->l2p[1]);
+	chunk = node->l2p[0] - 1;
+	CU_ASSERT(node->refcnt[chunk] == 2);
+	CU_ASSERT(node->used_chunks == 1);
+	CU_ASSERT(node->mapped_chunks == 2);
+	ut_check_read(ch, node, 0x11, 1);
+
+	/* Zeroes are not stored and unmapped chunks read as zeroes. */
+	ut_write(ch, node, 0, 2);
+	CU_ASSERT(dd_ch->writes_zero == 1);
+	CU_ASSERT(node->l2p[2] == 0);
+	ut_check_read(ch, node, 0, 2);
+	CU_ASSERT(dd_ch->reads_unmapped == 1);
+
+	/* Overwriting both references releases the chunk, but only for the next sync. */
+	ut_write(ch, node, 0x22, 0);
+	ut_write(ch, node, 0x22, 1);
+	CU_ASSERT(node->refcnt[chunk] == 0);
+	CU_ASSERT(node->used_chunks == 1);
+	CU_ASSERT(node->num_pending == 1);
+	CU_ASSERT(node->num_free == 251);
+	CU_ASSERT(ut_index_lookup(node, node->chunk_fp[chunk]) == DEDUP_NO_CHUNK);
+	ut_check_read(ch, node, 0x22, 0);
+
+	/* Unmap drops the mapping and with it the last reference. */
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 2) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(node->mapped_chunks == 0);
+	CU_ASSERT(node->used_chunks == 0);
+	CU_ASSERT(node->num_pending == 2);
+
+	ut_write(ch, node, 0x33, 4);
+	ut_write(ch, node, 0x33, 5);
+	ut_write(ch, node, 0x33, 6);
+	CU_ASSERT(bdev_dedup_get_stats("dd0", ut_get_stats_cb, &stats) == 0);
+	ut_run();
+	CU_ASSERT(stats.mapped_chunks == 3);
+	CU_ASSERT(stats.used_chunks == 1);
+	CU_ASSERT(stats.writes_deduplicated == 4);
+	CU_ASSERT(stats.writes_unique == 3);
+	CU_ASSERT(stats.index_entries == 1);
+	CU_ASSERT(stats.index_buckets == 64);
+	CU_ASSERT(bdev_dedup_get_stats("dd1", ut_get_stats_cb, &stats) == -ENODEV);
+
+	spdk_put_io_channel(ch);
+	ut_run();
+	ut_delete_dedup(node);
+}
+
+static void
+test_hash_collision(void)
+{
+	struct vbdev_dedup *node;
+	struct spdk_io_channel *ch;
+	struct dedup_io_channel *dd_ch;
+	uint32_t chunk;
+
+	memset(g_disk, 0, sizeof(g_disk));
+	node = ut_create_dedup(0);
+	ch = spdk_get_io_channel(node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	dd_ch = spdk_io_channel_get_ctx(ch);
+
+	ut_write(ch, node, 0x44, 0);
+	chunk = node->l2p[0] - 1;
+
+	/* Data that does not match what the index points at is never shared. */
+	g_disk[dedup_data_base_block(node, chunk) * BLOCK_SIZE + 100] ^= 0xff;
+	ut_write(ch, node, 0x44, 1);
+	CU_ASSERT(dd_ch->hash_collisions == 1);
+	CU_ASSERT(dd_ch->writes_deduplicated == 0);
+	CU_ASSERT(node->l2p[1] != node->l2p[0]);
+	CU_ASSERT(node->used_chunks == 2);
+	ut_check_read(ch, node, 0x44, 1);
+
+	/* The first candidate still does not match, but the second one does. */
+	ut_write(ch, node, 0x44, 2);
+	CU_ASSERT(dd_ch->hash_collisions == 2);
+	CU_ASSERT(dd_ch->writes_deduplicated == 1);
+	CU_ASSERT(node->l2p[2] == node->l2p[1]);
+	CU_ASSERT(node->used_chunks == 2);
+	CU_ASSERT(node->refcnt[chunk] == 1);
+
+	spdk_put_io_channel(ch);
+	ut_run();
+	ut_delete_dedup(node);
+}
+
+static void
+test_index_probing(void)
+{
+	struct vbdev_dedup *node;
+	uint32_t i, fp;
+
+	memset(g_disk, 0, sizeof(g_disk));
+	node = ut_create_dedup(0);
+
+	/* Fingerprints with the same home bucket overflow into the next one. */
+	for (i = 0; i < DEDUP_BUCKET_SLOTS + 2; i++) {
+		fp = (i << 16) | 5;
+		CU_ASSERT(ut_index_insert(node, fp, i) == 0);
+	}
+	CU_ASSERT(node->index[5].slots[DEDUP_BUCKET_SLOTS - 1].chunk == DEDUP_BUCKET_SLOTS);
+	CU_ASSERT(node->index[6].slots[1].chunk == DEDUP_BUCKET_SLOTS + 2);
+	CU_ASSERT(ut_index_lookup(node, (DEDUP_BUCKET_SLOTS + 1) << 16 | 5) == DEDUP_BUCKET_SLOTS + 1);
+	CU_ASSERT(ut_index_lookup(node, 77 << 16 | 5) == DEDUP_NO_CHUNK);
+	CU_ASSERT(node->dirty_pages[node->l2p_chunks]);
+
+	/* Removed entries leave tombstones, so that the entries behind them stay reachable. */
+	dedup_index_remove(node, 3 << 16 | 5, 3);
+	CU_ASSERT(node->index[5].slots[3].chunk == DEDUP_SLOT_TOMBSTONE);
+	CU_ASSERT(ut_index_lookup(node, (DEDUP_BUCKET_SLOTS + 1) << 16 | 5) == DEDUP_BUCKET_SLOTS + 1);
+	CU_ASSERT(ut_index_lookup(node, 3 << 16 | 5) == DEDUP_NO_CHUNK);
+
+	/* The last entry of a probe sequence is emptied and tombstones are reused. */
+	dedup_index_remove(node, (DEDUP_BUCKET_SLOTS + 1) << 16 | 5, DEDUP_BUCKET_SLOTS + 1);
+	CU_ASSERT(node->index[6].slots[1].chunk == DEDUP_SLOT_EMPTY);
+	CU_ASSERT(ut_index_insert(node, 100 << 16 | 5, 100) == 0);
+	CU_ASSERT(node->index[5].slots[3].chunk == 101);
+	CU_ASSERT(ut_index_entries(node) == DEDUP_BUCKET_SLOTS + 1);
+
+	/* Probes wrap around at the end of their shard, which is four buckets here. */
+	CU_ASSERT(node->num_shards == DEDUP_INDEX_SHARDS);
+	CU_ASSERT(node->shard_buckets == 4);
+	for (i = 0; i < DEDUP_BUCKET_SLOTS + 1; i++) {
+		CU_ASSERT(ut_index_insert(node, (i << 16) | 63, 200 + i) == 0);
+	}
+	CU_ASSERT(node->index[60].slots[0].chunk == 200 + DEDUP_BUCKET_SLOTS + 1);
+	CU_ASSERT(node->index[0].slots[0].chunk == DEDUP_SLOT_EMPTY);
+	CU_ASSERT(ut_index_lookup(node, DEDUP_BUCKET_SLOTS << 16 | 63) == 200 + DEDUP_BUCKET_SLOTS);
+
+	ut_delete_dedup(node);
+}
+
+static void
+test_index_candidates(void)
+{
+	struct vbdev_dedup *node;
+	struct dedup_index_probe probe;
+	uint32_t fp = 7 << 16 | 9;
+
+	memset(g_disk, 0, sizeof(g_disk));
+	node = ut_create_dedup(0);
+
+	/* Every chunk with the fingerprint is a candidate, in probe order. */
+	CU_ASSERT(ut_index_insert(node, fp, 10) == 0);
+	CU_ASSERT(ut_index_insert(node, 1 << 16 | 9, 11) == 0);
+	CU_ASSERT(ut_index_insert(node, fp, 12) == 0);
+	CU_ASSERT(ut_index_insert(node, fp, 13) == 0);
+	dedup_index_probe_init(node, fp, &probe);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == 10);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == 12);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == 13);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == DEDUP_NO_CHUNK);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == DEDUP_NO_CHUNK);
+	/* Each candidate found holds a reference. */
+	CU_ASSERT(node->refcnt[10] == 2);
+	CU_ASSERT(node->refcnt[12] == 2);
+	CU_ASSERT(node->refcnt[11] == 1);
+
+	/* A chunk whose last reference is being dropped is skipped. */
+	node->refcnt[12] = 0;
+	dedup_index_probe_init(node, fp, &probe);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == 10);
+	CU_ASSERT(dedup_index_lookup(node, fp, &probe) == 13);
+	CU_ASSERT(node->refcnt[12] == 0);
+
+	ut_delete_dedup(node);
+}
+
+static void
+test_index_rehash(void)
+{
+	struct vbdev_dedup *node;
+	struct dedup_index_shard *shard;
+	uint32_t i, n;
+
+	memset(g_disk, 0, sizeof(g_disk));
+	node = ut_create_dedup(0);
+	shard = &node->shards[5 / node->shard_buckets];
+
+	for (i = 0; i < DEDUP_BUCKET_SLOTS + 4; i++) {
+		CU_ASSERT(ut_index_insert(node, (i << 16) | 5, i) == 0);
+	}
+
+	/* A shard of 32 slots takes up to four tombstones. */
+	for (i = 0; i < 4; i++) {
+		dedup_index_remove(node, (i << 16) | 5, i);
+	}
+	CU_ASSERT(shard->tombstones == 4);
+	CU_ASSERT(node->index[5].slots[3].chunk == DEDUP_SLOT_TOMBSTONE);
+
+	/* The next one rehashes the shard, which moves the entries back to their home. */
+	memset(node->dirty_pages, 0, node->md_chunks);
+	dedup_index_remove(node, (4 << 16) | 5, 4);
+	CU_ASSERT(shard->tombstones == 0);
+	CU_ASSERT(shard->entries == DEDUP_BUCKET_SLOTS - 1);
+	CU_ASSERT(node->dirty_pages[node->l2p_chunks]);
+	for (i = 0; i < DEDUP_BUCKET_SLOTS - 1; i++) {
+		CU_ASSERT(node->index[5].slots[i].chunk == i + 5 + 1);
+	}
+	CU_ASSERT(node->index[5].slots[DEDUP_BUCKET_SLOTS - 1].chunk == DEDUP_SLOT_EMPTY);
+	for (i = 0; i < DEDUP_BUCKET_SLOTS; i++) {
+		CU_ASSERT(node->index[6].slots[i].chunk == DEDUP_SLOT_EMPTY);
+	}
+	for (i = 5, n = 0; i < DEDUP_BUCKET_SLOTS + 4; i++) {
+		n += ut_index_lookup(node, (i << 16) | 5) == i;
+	}
+	CU_ASSERT(n == DEDUP_BUCKET_SLOTS - 1);
+
+	ut_delete_dedup(node);
+}
+
+static void
+test_persistence(void)
+{
+	struct vbdev_dedup *node;
+	struct spdk_io_channel *ch;
+	struct dedup_io_channel *dd_ch;
+	uint32_t l2p[8];
+
+	memset(g_disk, 0, sizeof(g_disk));
+	node = ut_create_dedup(0);
+	ch = spdk_get_io_channel(node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	ut_write(ch, node, 0x55, 0);
+	ut_write(ch, node, 0x55, 1);
+	ut_write(ch, node, 0x66, 2);
+	ut_write(ch, node, 0x77, 3);
+	ut_write(ch, node, 0x88, 3);
+	CU_ASSERT(node->num_pending == 1);
+	CU_ASSERT(node->md_dirty);
+
+	/* A flush writes the changed metadata between two flushes of the base bdev and
+	 * makes the chunks freed before it reusable.
+	 */
+	g_base_writes = 0;
+	g_base_flushes = 0;
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_FLUSH, NULL, 0, node->dd_bdev.blockcnt) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base_flushes == 2);
+	CU_ASSERT(g_base_writes == 1);
+	CU_ASSERT(node->num_pending == 0);
+	CU_ASSERT(node->num_free == 253 - 3);
+	CU_ASSERT(spdk_mem_all_zero(node->dirty_pages, node->md_chunks));
+	CU_ASSERT(memcmp(&g_disk[CHUNK_SIZE], node->l2p, CHUNK_SIZE) == 0);
+	CU_ASSERT(memcmp(&g_disk[2 * CHUNK_SIZE], node->index, CHUNK_SIZE) == 0);
+	memcpy(l2p, node->l2p, sizeof(l2p));
+
+	spdk_put_io_channel(ch);
+	ut_run();
+	ut_delete_dedup(node);
+
+	/* The mapping, the reference counts and the index are loaded back. */
+	node = ut_create_dedup(0);
+	CU_ASSERT(memcmp(node->l2p, l2p, sizeof(l2p)) == 0);
+	CU_ASSERT(node->refcnt[l2p[0] - 1] == 2);
+	CU_ASSERT(node->mapped_chunks == 4);
+	CU_ASSERT(node->used_chunks == 3);
+	CU_ASSERT(node->num_free == 253 - 3);
+	CU_ASSERT(ut_index_entries(node) == 3);
+
+	ch = spdk_get_io_channel(node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	dd_ch = spdk_io_channel_get_ctx(ch);
+	ut_check_read(ch, node, 0x55, 1);
+	ut_check_read(ch, node, 0x88, 3);
+	ut_write(ch, node, 0x66, 4);
+	CU_ASSERT(dd_ch->writes_deduplicated == 1);
+	CU_ASSERT(node->l2p[4] == l2p[2]);
+
+	spdk_put_io_channel(ch);
+	ut_run();
+	ut_delete_dedup(node);
+
+	/* A superblock that does not check out is not formatted over. */
+	g_disk[20] ^= 0xff;
+	g_create_rc = 1;
+	CU_ASSERT(vbdev_dedup_init() == 0);
+	bdev_dedup_create_disk("base", "dd0", &(struct vbdev_dedup_opts) {}, ut_create_cb, NULL);
+	ut_run();
+	CU_ASSERT(g_create_rc == -EILSEQ);
+	CU_ASSERT(TAILQ_EMPTY(&g_dedup_nodes));
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_names));
+	vbdev_dedup_finish();
+}
+
+static void
+test_out_of_space(void)
+{
+	struct vbdev_dedup *node;
+	struct spdk_io_channel *ch;
+	uint8_t buf[CHUNK_SIZE];
+	uint32_t i;
+
+	memset(g_disk, 0, sizeof(g_disk));
+	/* More logical chunks than physical ones. */
+	node = ut_create_dedup(1);
+	CU_ASSERT(node->dd_bdev.blockcnt == 256);
+	CU_ASSERT(node->num_physical_chunks == 253);
+	ch = spdk_get_io_channel(node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	memset(buf, 0x99, sizeof(buf));
+	for (i = 0; i < node->num_physical_chunks; i++) {
+		*(uint32_t *)buf = i;
+		CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_WRITE, buf, i, 1) ==
+			  SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+	CU_ASSERT(node->num_free == 0);
+
+	/* Data that is already stored still fits. */
+	*(uint32_t *)buf = 7;
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_WRITE, buf, 254, 1) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	*(uint32_t *)buf = 1000;
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_WRITE, buf, 255, 1) ==
+		  SPDK_BDEV_IO_STATUS_FAILED);
+
+	/* A write waits for the sync that makes unmapped chunks reusable. */
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 10, 1) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(node->num_pending == 1);
+	CU_ASSERT(ut_io(ch, node, SPDK_BDEV_IO_TYPE_WRITE, buf, 255, 1) ==
+		  SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(node->l2p[255] == 10 + 1);
+	CU_ASSERT(node->num_pending == 0);
+	CU_ASSERT(node->num_free == 0);
+
+	spdk_put_io_channel(ch);
+	ut_run();
+	ut_delete_dedup(node);
+}
+
+static int
+ut_accel_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_accel_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+iobuf_finish_cb(void *arg)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_dedup", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_dedup_write_read);
+	CU_ADD_TEST(suite, test_hash_collision);
+	CU_ADD_TEST(suite, test_index_probing);
+	CU_ADD_TEST(suite, test_index_candidates);
+	CU_ADD_TEST(suite, test_index_rehash);
+	CU_ADD_TEST(suite, test_persistence);
+	CU_ADD_TEST(suite, test_out_of_space);
+
+	spdk_thread_lib_init(NULL, 0);
+	g_thread = spdk_thread_create("test", NULL);
+	spdk_set_thread(g_thread);
+	spdk_iobuf_initialize();
+	spdk_io_device_register(&g_base_bdev, ut_base_ch_create_cb, ut_base_ch_destroy_cb, 0, "base");
+	spdk_io_device_register(&g_accel_dev, ut_accel_ch_create_cb, ut_accel_ch_destroy_cb, 0,
+				"accel");
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+
+	spdk_io_device_unregister(&g_accel_dev, NULL);
+	spdk_io_device_unregister(&g_base_bdev, NULL);
+	spdk_iobuf_finish(iobuf_finish_cb, NULL);
+
+	spdk_thread_exit(g_thread);
+	while (!spdk_thread_is_exited(g_thread)) {
+		spdk_thread_poll(g_thread, 0, 0);
+	}
+	spdk_thread_destroy(g_thread);
+	spdk_thread_lib_fini();
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,661 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_cunit.h"
+#include "spdk/env.h"
+#include "spdk_internal/mock.h"
+#include "thread/thread_internal.h"
+#include "common/lib/test_env.c"
+#include "bdev/readahead/vbdev_readahead.c"
+#include "bdev/readahead/vbdev_readahead_rpc.c"
+
+#define BLOCK_SIZE	512
+#define BLOCK_CNT	4096
+#define IO_BLOCKS	8
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_write_zeroes_blocks, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unmap_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_copy_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t dst_offset_blocks, uint64_t src_offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_flush_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_abort, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   void *bio_cb_arg, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_json_decode_string, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_object, int, (const struct spdk_json_val *values,
+		const struct spdk_json_object_decoder *decoders, size_t num_decoders, void *out), 0);
+DEFINE_STUB(spdk_json_write_name, int, (struct spdk_json_write_ctx *w, const char *name), 0);
+DEFINE_STUB(spdk_json_write_string, int, (struct spdk_json_write_ctx *w, const char *val), 0);
+DEFINE_STUB(spdk_json_write_object_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_object_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_begin, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_array_end, int, (struct spdk_json_write_ctx *w), 0);
+DEFINE_STUB(spdk_json_write_named_object_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_array_begin, int, (struct spdk_json_write_ctx *w,
+		const char *name), 0);
+DEFINE_STUB(spdk_json_write_named_string, int, (struct spdk_json_write_ctx *w,
+		const char *name, const char *val), 0);
+DEFINE_STUB(spdk_json_write_named_uint32, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint32_t val), 0);
+DEFINE_STUB(spdk_json_write_named_uint64, int, (struct spdk_json_write_ctx *w,
+		const char *name, uint64_t val), 0);
+DEFINE_STUB_V(spdk_rpc_register_method, (const char *method, spdk_rpc_method_handler func,
+		uint32_t state_mask));
+DEFINE_STUB(spdk_jsonrpc_begin_result, struct spdk_json_write_ctx *,
+	    (struct spdk_jsonrpc_request *request), NULL);
+DEFINE_STUB_V(spdk_jsonrpc_end_result, (struct spdk_jsonrpc_request *request,
+					struct spdk_json_write_ctx *w));
+DEFINE_STUB_V(spdk_jsonrpc_send_bool_response, (struct spdk_jsonrpc_request *request,
+		bool value));
+DEFINE_STUB_V(spdk_jsonrpc_send_error_response, (struct spdk_jsonrpc_request *request,
+		int error_code, const char *msg));
+
+static struct spdk_thread *g_thread;
+static struct spdk_bdev g_base_bdev;
+static uint8_t g_disk[BLOCK_CNT * BLOCK_SIZE];
+static uint32_t g_base_reads;
+static uint32_t g_prefetches;
+static uint32_t g_destruct_done;
+static struct spdk_io_channel *g_ch;
+
+/* Base I/O is completed only when the test asks for it, so that reads can be submitted
+ * while prefetches are outstanding.
+ */
+struct ut_base_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	bool				write;
+	/* Destination of a prefetch, NULL for reads on behalf of the original I/O */
+	void				*prefetch_buf;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	uint8_t				*buf;
+	TAILQ_ENTRY(ut_base_io)		link;
+};
+static TAILQ_HEAD(ut_base_io_list, ut_base_io) g_base_ios = TAILQ_HEAD_INITIALIZER(g_base_ios);
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **_desc)
+{
+	if (strcmp(bdev_name, g_base_bdev.name) != 0) {
+		return -ENODEV;
+	}
+	*_desc = (void *)&g_base_bdev;
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return (void *)desc;
+}
+
+static int
+ut_base_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_base_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(g_ch, bdev_io, true);
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	bdev_io->internal.status = status;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	CU_ASSERT(bdev_io == (void *)0xdeadbeef);
+}
+
+void
+spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
+{
+	CU_ASSERT(bdeverrno == 0);
+	g_destruct_done++;
+}
+
+static int
+ut_submit_base_io(bool write, void *prefetch_buf, struct iovec *iov, int iovcnt,
+		  uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		  void *cb_arg)
+{
+	struct ut_base_io *io;
+
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	io->write = write;
+	io->prefetch_buf = prefetch_buf;
+	io->offset_blocks = offset_blocks;
+	io->num_blocks = num_blocks;
+	io->buf = malloc(num_blocks * BLOCK_SIZE);
+	SPDK_CU_ASSERT_FATAL(io->buf != NULL);
+
+	/* Reads sample the disk at submission, writes apply at completion. */
+	if (write) {
+		spdk_copy_iovs_to_buf(io->buf, num_blocks * BLOCK_SIZE, iov, iovcnt);
+	} else {
+		memcpy(io->buf, &g_disk[offset_blocks * BLOCK_SIZE], num_blocks * BLOCK_SIZE);
+		if (prefetch_buf != NULL) {
+			g_prefetches++;
+		} else {
+			g_base_reads++;
+		}
+	}
+	TAILQ_INSERT_TAIL(&g_base_ios, io, link);
+
+	return 0;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		      void *cb_arg)
+{
+	return ut_submit_base_io(false, buf, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			   uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_submit_base_io(false, NULL, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			    uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			    struct spdk_bdev_ext_io_opts *opts)
+{
+	return ut_submit_base_io(true, NULL, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+static void
+ut_complete_base_io(void)
+{
+	struct ut_base_io *io = TAILQ_FIRST(&g_base_ios);
+	struct spdk_bdev_io *orig_io;
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	TAILQ_REMOVE(&g_base_ios, io, link);
+
+	if (io->write) {
+		memcpy(&g_disk[io->offset_blocks * BLOCK_SIZE], io->buf, io->num_blocks * BLOCK_SIZE);
+	} else if (io->prefetch_buf != NULL) {
+		memcpy(io->prefetch_buf, io->buf, io->num_blocks * BLOCK_SIZE);
+	} else {
+		/* Reads complete into the iovs of the original I/O, which cb_arg points to. */
+		orig_io = io->cb_arg;
+		spdk_copy_buf_to_iovs(orig_io->u.bdev.iovs, orig_io->u.bdev.iovcnt, io->buf,
+				      io->num_blocks * BLOCK_SIZE);
+	}
+	io->cb((void *)0xdeadbeef, true, io->cb_arg);
+
+	free(io->buf);
+	free(io);
+}
+
+static void
+ut_complete_base_ios(void)
+{
+	while (!TAILQ_EMPTY(&g_base_ios)) {
+		ut_complete_base_io();
+	}
+}
+
+static struct vbdev_readahead *
+ut_create_readahead(uint32_t max_window_kb)
+{
+	struct vbdev_readahead_opts opts = {
+		.max_streams = 2,
+		.max_window_kb = max_window_kb,
+	};
+
+	g_base_bdev.name = "base";
+	g_base_bdev.blocklen = BLOCK_SIZE;
+	g_base_bdev.blockcnt = BLOCK_CNT;
+
+	CU_ASSERT(vbdev_readahead_init() == 0);
+	CU_ASSERT(bdev_readahead_create_disk("base", "ra0", &opts) == 0);
+	SPDK_CU_ASSERT_FATAL(!TAILQ_EMPTY(&g_readahead_nodes));
+
+	return TAILQ_FIRST(&g_readahead_nodes);
+}
+
+static void
+ut_delete_readahead(struct vbdev_readahead *ra_node)
+{
+	CU_ASSERT(vbdev_readahead_destruct(ra_node) == 0);
+	vbdev_readahead_finish();
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(TAILQ_EMPTY(&g_readahead_nodes));
+}
+
+static struct spdk_bdev_io *
+ut_submit(struct spdk_io_channel *ch, struct vbdev_readahead *ra_node,
+	  enum spdk_bdev_io_type type, void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct iovec *iov;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct readahead_bdev_io) + sizeof(*iov));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	iov = (struct iovec *)((uint8_t *)bdev_io + sizeof(*bdev_io) + sizeof(struct readahead_bdev_io));
+	iov->iov_base = buf;
+	iov->iov_len = num_blocks * BLOCK_SIZE;
+
+	bdev_io->bdev = &ra_node->ra_bdev;
+	bdev_io->type = type;
+	bdev_io->internal.ch = (void *)ch;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	bdev_io->u.bdev.iovs = iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+
+	g_ch = ch;
+	vbdev_readahead_submit_request(ch, bdev_io);
+
+	return bdev_io;
+}
+
+/* Submit a read that is expected to be served from the prefetched data right away. */
+static void
+ut_read_hit(struct spdk_io_channel *ch, struct vbdev_readahead *ra_node, uint64_t offset_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint8_t buf[IO_BLOCKS * BLOCK_SIZE];
+	uint32_t base_reads = g_base_reads;
+	uint64_t i;
+
+	memset(buf, 0, sizeof(buf));
+	bdev_io = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, IO_BLOCKS);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base_reads == base_reads);
+	for (i = 0; i < IO_BLOCKS; i++) {
+		CU_ASSERT(buf[i * BLOCK_SIZE] == (uint8_t)(offset_blocks + i));
+	}
+	free(bdev_io);
+}
+
+static void
+ut_fill_disk(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < sizeof(g_disk); i++) {
+		g_disk[i] = (uint8_t)(i / BLOCK_SIZE);
+	}
+	g_base_reads = 0;
+	g_prefetches = 0;
+}
+
+struct ut_stats {
+	uint32_t				num_stats;
+	struct vbdev_readahead_stats		stats;
+	struct vbdev_readahead_stream_stats	streams[4];
+};
+
+static void
+ut_get_stats_cb(void *cb_arg, const struct vbdev_readahead_stats *stats, uint32_t num_stats)
+{
+	struct ut_stats *ut_stats = cb_arg;
+
+	ut_stats->num_stats = num_stats;
+	if (num_stats == 0) {
+		return;
+	}
+	ut_stats->stats = stats[0];
+	SPDK_CU_ASSERT_FATAL(stats[0].num_streams <= SPDK_COUNTOF(ut_stats->streams));
+	memcpy(ut_stats->streams, stats[0].streams, stats[0].num_streams * sizeof(*stats[0].streams));
+	ut_stats->stats.streams = NULL;
+	ut_stats->stats.name = NULL;
+	ut_stats->stats.base_bdev_name = NULL;
+}
+
+static void
+test_sequential_readahead(void)
+{
+	struct vbdev_readahead *ra_node;
+	struct spdk_io_channel *ch;
+	struct readahead_io_channel *ra_ch;
+	struct readahead_stream *stream;
+	struct spdk_bdev_io *ios[4];
+	struct ut_stats ut_stats = {};
+	uint8_t buf[IO_BLOCKS * BLOCK_SIZE];
+	uint64_t offset;
+	int num_ios = 0;
+
+	ut_fill_disk();
+	ra_node = ut_create_readahead(64);
+	CU_ASSERT(ra_node->min_window_blocks == 32);
+	CU_ASSERT(ra_node->max_window_blocks == 128);
+	ch = spdk_get_io_channel(ra_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	ra_ch = spdk_io_channel_get_ctx(ch);
+
+	/* The first read of a stream is not read ahead. */
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 0, IO_BLOCKS);
+	ut_complete_base_ios();
+	CU_ASSERT(ios[0]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_base_reads == 1);
+	CU_ASSERT(g_prefetches == 0);
+
+	/* The second one continues the stream and two windows are prefetched behind it. */
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, IO_BLOCKS, IO_BLOCKS);
+	CU_ASSERT(g_base_reads == 2);
+	CU_ASSERT(g_prefetches == 2);
+	CU_ASSERT(ra_node->memory_used == 2 * 32 * BLOCK_SIZE);
+	ut_complete_base_ios();
+	CU_ASSERT(ra_ch->read_misses == 2);
+
+	/* Reading the first window up moves it forward and doubles the window. */
+	stream = readahead_find_stream(ra_ch, 2 * IO_BLOCKS);
+	SPDK_CU_ASSERT_FATAL(stream != NULL);
+	for (offset = 2 * IO_BLOCKS; offset < 48; offset += IO_BLOCKS) {
+		ut_read_hit(ch, ra_node, offset);
+	}
+	CU_ASSERT(stream->window_blocks == 64);
+	CU_ASSERT(g_prefetches == 3);
+	CU_ASSERT(TAILQ_LAST(&g_base_ios, ut_base_io_list)->offset_blocks == 80);
+	CU_ASSERT(TAILQ_LAST(&g_base_ios, ut_base_io_list)->num_blocks == 64);
+
+	for (; offset < 80; offset += IO_BLOCKS) {
+		ut_read_hit(ch, ra_node, offset);
+	}
+	CU_ASSERT(stream->window_blocks == 128);
+	CU_ASSERT(g_prefetches == 4);
+
+	/* A read of data that is still being prefetched waits for it. */
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, offset, IO_BLOCKS);
+	CU_ASSERT(ios[2]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	ut_complete_base_io();
+	CU_ASSERT(ios[2]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(buf[0] == (uint8_t)offset);
+	CU_ASSERT(g_base_reads == 2);
+	ut_complete_base_ios();
+	CU_ASSERT(ra_ch->read_hits == 9);
+
+	/* Per stream statistics are reported. */
+	CU_ASSERT(bdev_readahead_get_stats("ra0", ut_get_stats_cb, &ut_stats) == 0);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(ut_stats.num_stats == 1);
+	CU_ASSERT(ut_stats.stats.read_hits == 9);
+	CU_ASSERT(ut_stats.stats.read_misses == 2);
+	CU_ASSERT(ut_stats.stats.memory_used == ra_node->memory_used);
+	CU_ASSERT(ut_stats.stats.memory_cap == 64 * 1024 * 1024);
+	CU_ASSERT(ut_stats.stats.num_streams == 1);
+	CU_ASSERT(ut_stats.streams[0].hits == 9);
+	CU_ASSERT(ut_stats.streams[0].misses == 2);
+	CU_ASSERT(ut_stats.streams[0].prefetches == 4);
+	CU_ASSERT(ut_stats.streams[0].window_size == 128 * BLOCK_SIZE);
+	CU_ASSERT(ut_stats.streams[0].next_offset_blocks == offset + IO_BLOCKS);
+	CU_ASSERT(bdev_readahead_get_stats("ra1", ut_get_stats_cb, &ut_stats) == -ENODEV);
+
+	/* Releasing the channel gives all of the prefetched data back. */
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(ra_node->memory_used == 0);
+	while (num_ios-- > 0) {
+		free(ios[num_ios]);
+	}
+	ut_delete_readahead(ra_node);
+}
+
+static void
+test_stream_replacement(void)
+{
+	struct vbdev_readahead *ra_node;
+	struct spdk_io_channel *ch;
+	struct readahead_io_channel *ra_ch;
+	struct spdk_bdev_io *ios[8];
+	uint8_t buf[IO_BLOCKS * BLOCK_SIZE];
+	uint64_t offset;
+	int num_ios = 0;
+
+	ut_fill_disk();
+	ra_node = ut_create_readahead(16);
+	ch = spdk_get_io_channel(ra_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	ra_ch = spdk_io_channel_get_ctx(ch);
+
+	/* Two interleaved streams are tracked and read ahead independently. */
+	for (offset = 0; offset < 2 * IO_BLOCKS; offset += IO_BLOCKS) {
+		ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, offset, IO_BLOCKS);
+		ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 1024 + offset,
+					   IO_BLOCKS);
+	}
+	ut_complete_base_ios();
+	CU_ASSERT(g_prefetches == 4);
+	ut_read_hit(ch, ra_node, 2 * IO_BLOCKS);
+	ut_read_hit(ch, ra_node, 1024 + 2 * IO_BLOCKS);
+
+	/* A third stream replaces the least recently used one and its data is dropped. */
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 2048, IO_BLOCKS);
+	ut_complete_base_ios();
+	CU_ASSERT(readahead_find_stream(ra_ch, 3 * IO_BLOCKS) == NULL);
+	CU_ASSERT(readahead_find_stream(ra_ch, 1024 + 3 * IO_BLOCKS) != NULL);
+	CU_ASSERT(readahead_find_buf(ra_ch, 3 * IO_BLOCKS, IO_BLOCKS) == NULL);
+	CU_ASSERT(ra_node->memory_used == 2 * 32 * BLOCK_SIZE);
+
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 3 * IO_BLOCKS, IO_BLOCKS);
+	CU_ASSERT(ra_ch->read_misses == 6);
+	ut_complete_base_ios();
+
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(ra_node->memory_used == 0);
+	while (num_ios-- > 0) {
+		free(ios[num_ios]);
+	}
+	ut_delete_readahead(ra_node);
+}
+
+static void
+test_write_invalidation(void)
+{
+	struct vbdev_readahead *ra_node;
+	struct spdk_io_channel *ch;
+	struct readahead_io_channel *ra_ch;
+	struct spdk_bdev_io *ios[8];
+	uint8_t buf[IO_BLOCKS * BLOCK_SIZE], wbuf[IO_BLOCKS * BLOCK_SIZE];
+	int num_ios = 0;
+
+	ut_fill_disk();
+	ra_node = ut_create_readahead(16);
+	ch = spdk_get_io_channel(ra_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	ra_ch = spdk_io_channel_get_ctx(ch);
+
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 0, IO_BLOCKS);
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, IO_BLOCKS, IO_BLOCKS);
+	ut_complete_base_ios();
+	SPDK_CU_ASSERT_FATAL(readahead_find_buf(ra_ch, 2 * IO_BLOCKS, IO_BLOCKS) != NULL);
+
+	/* A write drops the prefetched data it overlaps. */
+	memset(wbuf, 0xff, sizeof(wbuf));
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_WRITE, wbuf, 3 * IO_BLOCKS, 1);
+	CU_ASSERT(readahead_find_buf(ra_ch, 2 * IO_BLOCKS, IO_BLOCKS) == NULL);
+	ut_complete_base_io();
+	CU_ASSERT(ios[2]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A write seen by another channel makes the data stale through the generations. */
+	SPDK_CU_ASSERT_FATAL(readahead_find_buf(ra_ch, 6 * IO_BLOCKS, IO_BLOCKS) != NULL);
+	readahead_bump_gen(ra_node, 6 * IO_BLOCKS, 1);
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 6 * IO_BLOCKS, IO_BLOCKS);
+	CU_ASSERT(ios[3]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(ra_ch->read_hits == 0);
+	ut_complete_base_ios();
+	CU_ASSERT(ios[3]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A read waiting for a prefetch that raced with a write is sent to the base bdev. */
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 7 * IO_BLOCKS, IO_BLOCKS);
+	SPDK_CU_ASSERT_FATAL(readahead_find_buf(ra_ch, 8 * IO_BLOCKS, IO_BLOCKS) != NULL);
+	CU_ASSERT(readahead_find_buf(ra_ch, 8 * IO_BLOCKS, IO_BLOCKS)->state == READAHEAD_BUF_PENDING);
+	ios[num_ios++] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 8 * IO_BLOCKS, IO_BLOCKS);
+	CU_ASSERT(ios[5]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	readahead_bump_gen(ra_node, 8 * IO_BLOCKS, 1);
+	g_disk[8 * IO_BLOCKS * BLOCK_SIZE] = 0xaa;
+	g_base_reads = 0;
+	ut_complete_base_io();
+	CU_ASSERT(ios[5]->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(g_base_reads == 1);
+	ut_complete_base_ios();
+	CU_ASSERT(ios[5]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(buf[0] == 0xaa);
+
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(ra_node->memory_used == 0);
+	while (num_ios-- > 0) {
+		free(ios[num_ios]);
+	}
+	ut_delete_readahead(ra_node);
+}
+
+static void
+test_memory_cap(void)
+{
+	struct vbdev_readahead *ra_node;
+	struct spdk_io_channel *ch;
+	struct readahead_io_channel *ra_ch;
+	struct spdk_bdev_io *ios[2];
+	struct ut_base_io *base_io;
+	uint8_t buf[IO_BLOCKS * BLOCK_SIZE];
+
+	ut_fill_disk();
+	ra_node = ut_create_readahead(16);
+	/* Room for a single window only. */
+	ra_node->memory_cap = 32 * BLOCK_SIZE;
+	ch = spdk_get_io_channel(ra_node);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	ra_ch = spdk_io_channel_get_ctx(ch);
+
+	ios[0] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, 0, IO_BLOCKS);
+	ut_complete_base_io();
+	ios[1] = ut_submit(ch, ra_node, SPDK_BDEV_IO_TYPE_READ, buf, IO_BLOCKS, IO_BLOCKS);
+	CU_ASSERT(g_prefetches == 1);
+	CU_ASSERT(ra_ch->prefetches_skipped == 1);
+	CU_ASSERT(ra_node->memory_used == ra_node->memory_cap);
+
+	/* The vbdev is not destroyed until the outstanding prefetch completes. */
+	base_io = TAILQ_LAST(&g_base_ios, ut_base_io_list);
+	TAILQ_REMOVE(&g_base_ios, base_io, link);
+	TAILQ_INSERT_HEAD(&g_base_ios, base_io, link);
+	ut_complete_base_io();
+	CU_ASSERT(ios[1]->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	spdk_put_io_channel(ch);
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(vbdev_readahead_destruct(ra_node) == 1);
+	CU_ASSERT(g_destruct_done == 0);
+	ut_complete_base_io();
+	while (spdk_thread_poll(g_thread, 0, 0) > 0) {}
+	CU_ASSERT(g_destruct_done == 1);
+	vbdev_readahead_finish();
+
+	free(ios[0]);
+	free(ios[1]);
+}
+
+static void
+iobuf_finish_cb(void *arg)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("vbdev_readahead", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_sequential_readahead);
+	CU_ADD_TEST(suite, test_stream_replacement);
+	CU_ADD_TEST(suite, test_write_invalidation);
+	CU_ADD_TEST(suite, test_memory_cap);
+
+	spdk_thread_lib_init(NULL, 0);
+	g_thread = spdk_thread_create("test", NULL);
+	spdk_set_thread(g_thread);
+	spdk_iobuf_initialize();
+	spdk_io_device_register(&g_base_bdev, ut_base_ch_create_cb, ut_base_ch_destroy_cb, 0, "base");
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+
+	spdk_io_device_unregister(&g_base_bdev, NULL);
+	spdk_iobuf_finish(iobuf_finish_cb, NULL);
+
+	spdk_thread_exit(g_thread);
+	while (!spdk_thread_is_exited(g_thread)) {
+		spdk_thread_poll(g_thread, 0, 0);
+	}
+	spdk_thread_destroy(g_thread);
+	spdk_thread_lib_fini();
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
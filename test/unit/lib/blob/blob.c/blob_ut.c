@@ -2912,6 +2912,98 @@ bs_test_recover_cluster_count(void)
 	g_bs = NULL;
 }
 
+static void
+bs_test_recover_parallel(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts opts;
+	struct spdk_blob_opts blob_opts;
+	struct spdk_blob *blob;
+	spdk_blob_id blobids[300];
+	uint64_t free_clusters;
+	uint32_t used_md_pages_count, used_blobids_count;
+	char *xattr;
+	const void *value;
+	size_t value_len;
+	int max_md_ops[] = { 32, 2 };
+	int i, j;
+
+	/* An xattr that fills a whole md page, so that the blob md spans multiple pages */
+	size_t xattr_length = 4072 - sizeof(struct spdk_blob_md_descriptor_xattr) -
+			      strlen("large_xattr");
+	xattr = calloc(xattr_length, sizeof(char));
+	SPDK_CU_ASSERT_FATAL(xattr != NULL);
+	memset(xattr, 0xa5, xattr_length);
+
+	/* Use enough md pages for the replay to span several chunks */
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.cluster_sz = SPDK_BS_PAGE_SIZE * 4;
+	opts.num_md_pages = 1024;
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	/* Mix single page blobs, blobs with md chains and blobs with extent pages */
+	for (i = 0; i < (int)SPDK_COUNTOF(blobids); i++) {
+		ut_spdk_blob_opts_init(&blob_opts);
+		blob_opts.num_clusters = i % 3;
+		blob = ut_blob_create_and_open(bs, &blob_opts);
+		blobids[i] = spdk_blob_get_id(blob);
+
+		if (i % 10 == 0) {
+			CU_ASSERT(spdk_blob_set_xattr(blob, "large_xattr", xattr, xattr_length) == 0);
+			spdk_blob_sync_md(blob, blob_op_complete, NULL);
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+		}
+
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	used_md_pages_count = spdk_bit_array_count_set(bs->used_md_pages);
+	used_blobids_count = spdk_bit_array_count_set(bs->used_blobids);
+
+	for (j = 0; j < (int)SPDK_COUNTOF(max_md_ops); j++) {
+		spdk_bs_opts_init(&opts, sizeof(opts));
+		opts.max_md_ops = max_md_ops[j];
+		ut_bs_dirty_load(&bs, &opts);
+
+		CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+		CU_ASSERT(spdk_bit_array_count_set(bs->used_md_pages) == used_md_pages_count);
+		CU_ASSERT(spdk_bit_array_count_set(bs->used_blobids) == used_blobids_count);
+
+		for (i = 0; i < (int)SPDK_COUNTOF(blobids); i += 10) {
+			spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+			SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+			blob = g_blob;
+
+			CU_ASSERT(spdk_blob_get_num_clusters(blob) == (uint64_t)(i % 3));
+			CU_ASSERT(spdk_blob_get_xattr_value(blob, "large_xattr", &value, &value_len) == 0);
+			CU_ASSERT(value_len == xattr_length);
+			CU_ASSERT(memcmp(value, xattr, xattr_length) == 0);
+
+			spdk_blob_close(blob, blob_op_complete, NULL);
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+		}
+	}
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+	free(xattr);
+}
+
 static void
 bs_test_grow(void)
 {
@@ -4099,6 +4191,94 @@ blob_insert_cluster_msg_test(void)
 	ut_blob_close_and_delete(bs, blob);
 }
 
+static void
+insert_clusters(struct spdk_blob *blob, struct spdk_blob_md_page *pages, uint32_t first_cluster,
+		uint32_t num_clusters, bool poll)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t new_cluster;
+	uint32_t extent_page;
+	uint32_t i;
+
+	for (i = 0; i < num_clusters; i++) {
+		extent_page = 0;
+		spdk_spin_lock(&bs->used_lock);
+		CU_ASSERT(bs_allocate_cluster(blob, first_cluster + i, &new_cluster, &extent_page,
+					      false) == 0);
+		spdk_spin_unlock(&bs->used_lock);
+
+		blob_insert_cluster_on_md_thread(blob, first_cluster + i, new_cluster, extent_page,
+						 &pages[i], blob_op_complete, NULL);
+		if (poll) {
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+		}
+	}
+
+	g_bserrno = -1;
+	poll_threads();
+	if (!poll) {
+		CU_ASSERT(g_bserrno == 0);
+	}
+}
+
+static void
+blob_insert_cluster_msg_batch(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts opts;
+	struct spdk_blob_md_page pages[3] = {};
+	spdk_blob_id blobid;
+	uint64_t write_bytes, serial_write_bytes, batch_write_bytes;
+	uint32_t i;
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 7;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* The first cluster allocates the extent page */
+	insert_clusters(blob, pages, 0, 1, true);
+
+	/* Clusters persisted one by one */
+	write_bytes = g_dev_write_bytes;
+	insert_clusters(blob, pages, 1, 3, true);
+	serial_write_bytes = g_dev_write_bytes - write_bytes;
+
+	/* Clusters inserted while the first one is persisted, are persisted together */
+	write_bytes = g_dev_write_bytes;
+	insert_clusters(blob, pages, 4, 3, false);
+	batch_write_bytes = g_dev_write_bytes - write_bytes;
+
+	CU_ASSERT(batch_write_bytes < serial_write_bytes);
+	if (g_use_extent_table) {
+		/* One extent page write per batch */
+		CU_ASSERT(serial_write_bytes == 3 * SPDK_BS_PAGE_SIZE);
+		CU_ASSERT(batch_write_bytes == 2 * SPDK_BS_PAGE_SIZE);
+	}
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	for (i = 0; i < 7; i++) {
+		CU_ASSERT(blob->active.clusters[i] != 0);
+	}
+
+	ut_blob_close_and_delete(bs, blob);
+}
+
 static void
 blob_thin_prov_rw(void)
 {
@@ -4332,6 +4512,119 @@ blob_thin_prov_write_count_io(void)
 	g_bs = NULL;
 }
 
+static void
+blob_thin_prov_cluster_cache(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_channel *bs_ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters;
+	uint64_t pages_per_cluster;
+	uint32_t cached;
+	uint8_t payload_write[4096];
+
+	/* Small clusters, so that there are enough free ones to fill the channel cache */
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = 16384;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	pages_per_cluster = bs_opts.cluster_sz / spdk_bs_get_page_size(bs);
+	SPDK_CU_ASSERT_FATAL(free_clusters / BS_CLUSTER_CACHE_FREE_SHARE >=
+			     SPDK_BS_CHANNEL_CLUSTER_CACHE_SIZE);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	/* Use a channel on another thread, the md thread one is shared with the blobstore */
+	set_thread(1);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bs_ch = spdk_io_channel_get_ctx(ch);
+
+	/* The first allocation fills the channel cache, reserved clusters are still free */
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	spdk_blob_io_write(blob, ch, payload_write, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	cached = bs_ch->cluster_cache.count;
+	CU_ASSERT(cached >= SPDK_BS_CHANNEL_CLUSTER_CACHE_SIZE - 1);
+	CU_ASSERT(bs->num_reserved_clusters == cached);
+	CU_ASSERT(bs->num_free_clusters + cached == spdk_bs_free_cluster_count(bs));
+
+	/* Next allocations are served from the cache */
+	spdk_blob_io_write(blob, ch, payload_write, pages_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(bs_ch->cluster_cache.count == cached - 1);
+	CU_ASSERT(bs->num_reserved_clusters == cached - 1);
+
+	/* Destroying the channel returns the reserved clusters */
+	spdk_bs_free_io_channel(ch);
+	set_thread(0);
+	poll_threads();
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+	CU_ASSERT(bs->num_free_clusters == free_clusters - 2);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+
+	set_thread(1);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bs_ch = spdk_io_channel_get_ctx(ch);
+
+	spdk_blob_io_write(blob, ch, payload_write, 2 * pages_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch->cluster_cache.count > 0);
+	CU_ASSERT(free_clusters - 3 == spdk_bs_free_cluster_count(bs));
+	set_thread(0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_blob = NULL;
+
+	/* Unload returns the clusters reserved by channels that are still open, so they
+	 * are not persisted as used */
+	g_bserrno = -1;
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(bs_ch->cluster_cache.count == 0);
+	set_thread(1);
+	spdk_bs_free_io_channel(ch);
+	set_thread(0);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	dev = init_dev();
+	spdk_bs_load(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	CU_ASSERT(free_clusters - 3 == spdk_bs_free_cluster_count(bs));
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+	g_blobid = 0;
+}
+
 static void
 blob_thin_prov_rle(void)
 {
@@ -8742,6 +9035,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bs_type);
 	CU_ADD_TEST(suite, bs_super_block);
 	CU_ADD_TEST(suite, bs_test_recover_cluster_count);
+	CU_ADD_TEST(suite, bs_test_recover_parallel);
 	CU_ADD_TEST(suite, bs_test_grow);
 	CU_ADD_TEST(suite, blob_serialize_test);
 	CU_ADD_TEST(suite_bs, blob_crc);
@@ -8752,8 +9046,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_set_xattrs_test);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_alloc);
 	CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
+	CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_batch);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
 	CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
+	CU_ADD_TEST(suite, blob_thin_prov_cluster_cache);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
 	CU_ADD_TEST(suite, bs_load_iter_test);
@@ -34,6 +34,7 @@ struct spdk_nvme_transport t4 = {
 
 int64_t g_process_completions_return_value = 0;
 int g_destroy_return_value = 0;
+int g_register_interrupts_return_value = 0;
 
 TAILQ_HEAD(nvme_transport_list, spdk_nvme_transport) g_spdk_nvme_transports =
 	TAILQ_HEAD_INITIALIZER(g_spdk_nvme_transports);
@@ -189,6 +190,19 @@ nvme_transport_poll_group_remove(struct spdk_nvme_transport_poll_group *tgroup,
 	return -ENODEV;
 }
 
+int
+nvme_transport_poll_group_register_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp)
+{
+	return g_register_interrupts_return_value;
+}
+
+void
+nvme_transport_poll_group_unregister_interrupts(struct spdk_nvme_transport_poll_group *tgroup,
+		struct spdk_fd_group *fgrp)
+{
+}
+
 int64_t
 nvme_transport_poll_group_process_completions(struct spdk_nvme_transport_poll_group *group,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
@@ -480,6 +494,84 @@ test_spdk_nvme_poll_group_get_free_stats(void)
 	CU_ASSERT(rc == -ENOTSUP);
 }
 
+static void
+test_spdk_nvme_poll_group_wait(void)
+{
+	struct spdk_nvme_poll_group *group;
+	struct spdk_nvme_transport_poll_group *tgroup1, *tgroup2;
+	struct spdk_nvme_qpair qpair1_1 = {0}, qpair2_1 = {0};
+	struct spdk_fd_group *fgrp;
+
+	TAILQ_INSERT_TAIL(&g_spdk_nvme_transports, &t1, link);
+	TAILQ_INSERT_TAIL(&g_spdk_nvme_transports, &t2, link);
+
+	group = spdk_nvme_poll_group_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+
+	qpair1_1.state = NVME_QPAIR_DISCONNECTED;
+	qpair1_1.transport = &t1;
+	CU_ASSERT(spdk_nvme_poll_group_add(group, &qpair1_1) == 0);
+	tgroup1 = STAILQ_FIRST(&group->tgroups);
+	SPDK_CU_ASSERT_FATAL(tgroup1 != NULL);
+
+	/* Existing transport poll groups are registered when the fd group is created and the
+	 * group is processed once right away. */
+	g_register_interrupts_return_value = 0;
+	fgrp = spdk_nvme_poll_group_get_fd_group(group);
+	SPDK_CU_ASSERT_FATAL(fgrp != NULL);
+	CU_ASSERT(spdk_nvme_poll_group_get_fd_group(group) == fgrp);
+	CU_ASSERT(tgroup1->interrupts);
+	CU_ASSERT(!tgroup1->polled);
+	CU_ASSERT(group->event_pending);
+
+	/* The event is acknowledged once there's nothing left to do */
+	g_process_completions_return_value = 0;
+	CU_ASSERT(spdk_nvme_poll_group_wait(group, unit_test_disconnected_qpair_cb) == 0);
+	CU_ASSERT(!group->event_pending);
+
+	/* Keep the group signalled while it's making progress */
+	g_process_completions_return_value = 4;
+	CU_ASSERT(spdk_nvme_poll_group_wait(group, unit_test_disconnected_qpair_cb) == 4);
+	CU_ASSERT(group->event_pending);
+	g_process_completions_return_value = 0;
+	CU_ASSERT(spdk_nvme_poll_group_wait(group, unit_test_disconnected_qpair_cb) == 0);
+	CU_ASSERT(!group->event_pending);
+
+	/* Connecting a qpair signals the group */
+	qpair1_1.state = NVME_QPAIR_ENABLED;
+	CU_ASSERT(nvme_poll_group_connect_qpair(&qpair1_1) == 0);
+	CU_ASSERT(group->event_pending);
+	CU_ASSERT(spdk_nvme_poll_group_wait(group, unit_test_disconnected_qpair_cb) == 0);
+	CU_ASSERT(!group->event_pending);
+
+	/* A transport without interrupt support keeps the group signalled */
+	g_register_interrupts_return_value = -ENOTSUP;
+	qpair2_1.state = NVME_QPAIR_DISCONNECTED;
+	qpair2_1.transport = &t2;
+	CU_ASSERT(spdk_nvme_poll_group_add(group, &qpair2_1) == 0);
+	tgroup2 = STAILQ_NEXT(tgroup1, link);
+	SPDK_CU_ASSERT_FATAL(tgroup2 != NULL);
+	CU_ASSERT(!tgroup2->interrupts);
+	CU_ASSERT(tgroup2->polled);
+	CU_ASSERT(group->num_polled_tgroups == 1);
+	CU_ASSERT(group->event_pending);
+	CU_ASSERT(spdk_nvme_poll_group_wait(group, unit_test_disconnected_qpair_cb) == 0);
+	CU_ASSERT(group->event_pending);
+
+	CU_ASSERT(spdk_nvme_poll_group_remove(group, &qpair2_1) == 0);
+	g_register_interrupts_return_value = 0;
+
+	CU_ASSERT(spdk_nvme_poll_group_remove(group, &qpair1_1) == 0);
+	SPDK_CU_ASSERT_FATAL(spdk_nvme_poll_group_destroy(group) == 0);
+	CU_ASSERT(!tgroup1->interrupts);
+	CU_ASSERT(!tgroup2->polled);
+	free(tgroup1);
+	free(tgroup2);
+
+	TAILQ_REMOVE(&g_spdk_nvme_transports, &t1, link);
+	TAILQ_REMOVE(&g_spdk_nvme_transports, &t2, link);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -504,7 +596,8 @@ main(int argc, char **argv)
 			    test_spdk_nvme_poll_group_process_completions) == NULL ||
 		CU_add_test(suite, "nvme_poll_group_destroy_test", test_spdk_nvme_poll_group_destroy) == NULL ||
 		CU_add_test(suite, "nvme_poll_group_get_free_stats",
-			    test_spdk_nvme_poll_group_get_free_stats) == NULL
+			    test_spdk_nvme_poll_group_get_free_stats) == NULL ||
+		CU_add_test(suite, "nvme_poll_group_wait", test_spdk_nvme_poll_group_wait) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -28,6 +28,11 @@ DEFINE_STUB(nvmf_transport_poll_group_remove, int, (struct spdk_nvmf_transport_p
 		struct spdk_nvmf_qpair *qpair), 0);
 DEFINE_STUB(nvmf_transport_req_free, int, (struct spdk_nvmf_request *req), 0);
 DEFINE_STUB(nvmf_transport_poll_group_poll, int, (struct spdk_nvmf_transport_poll_group *group), 0);
+DEFINE_STUB(nvmf_transport_poll_group_migrate, int, (struct spdk_nvmf_transport_poll_group *group,
+		struct spdk_nvmf_qpair *qpair), 0);
+DEFINE_STUB(nvmf_transport_qpair_migrate_supported, bool, (struct spdk_nvmf_qpair *qpair), true);
+DEFINE_STUB_V(nvmf_transport_qpair_quiesce, (struct spdk_nvmf_qpair *qpair, bool quiesce));
+DEFINE_STUB(nvmf_transport_qpair_is_idle, bool, (struct spdk_nvmf_qpair *qpair), true);
 DEFINE_STUB(nvmf_transport_accept, uint32_t, (struct spdk_nvmf_transport *transport), 0);
 DEFINE_STUB_V(nvmf_subsystem_remove_all_listeners, (struct spdk_nvmf_subsystem *subsystem,
 		bool stop));
@@ -214,6 +219,302 @@ test_nvmf_tgt_create_poll_group(void)
 	MOCK_CLEAR(spdk_bdev_get_io_channel);
 }
 
+static void
+test_nvmf_tgt_get_least_loaded_poll_group(void)
+{
+	struct spdk_nvmf_tgt		tgt = {};
+	struct spdk_nvmf_poll_group	group[3] = {};
+	int				i;
+
+	TAILQ_INIT(&tgt.poll_groups);
+	pthread_mutex_init(&tgt.mutex, NULL);
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == NULL);
+
+	for (i = 0; i < 3; i++) {
+		pthread_mutex_init(&group[i].mutex, NULL);
+		TAILQ_INSERT_TAIL(&tgt.poll_groups, &group[i], link);
+	}
+
+	/* Idle groups are picked in round-robin order */
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[0]);
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[1]);
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[2]);
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[0]);
+	CU_ASSERT(group[0].load_new_qpairs == 2);
+	CU_ASSERT(group[1].load_new_qpairs == 1);
+	CU_ASSERT(group[2].load_new_qpairs == 1);
+
+	/* Busy time and IOPS relative to the busiest group both count:
+	 * group 0: 500 + 0, group 1: 100 + 1000, group 2: 200 + 100 */
+	for (i = 0; i < 3; i++) {
+		group[i].load_new_qpairs = 0;
+	}
+	group[0].load_busy = 500;
+	group[1].load_busy = 100;
+	group[1].load_iops = 1000;
+	group[2].load_busy = 200;
+	group[2].load_iops = 100;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[2]);
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[2]);
+	CU_ASSERT(group[2].load_new_qpairs == 2);
+
+	/* Qpairs placed since the last sample make a group look busier */
+	group[2].load_new_qpairs = 11;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[0]);
+
+	/* Idle qpairs count as well, whether they're connected or not yet */
+	for (i = 0; i < 3; i++) {
+		group[i].load_new_qpairs = 0;
+		group[i].load_busy = 0;
+		group[i].load_iops = 0;
+	}
+	group[0].stat.current_io_qpairs = 2;
+	group[1].current_unassociated_qpairs = 1;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[2]);
+	group[2].stat.current_io_qpairs = 2;
+	group[2].load_new_qpairs = 0;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[1]);
+	group[1].current_unassociated_qpairs = 2;
+	group[1].load_new_qpairs = 0;
+
+	/* Admin qpairs don't, so this is a tie again */
+	group[0].stat.current_admin_qpairs = 5;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[2]);
+	CU_ASSERT(group[2].load_new_qpairs == 1);
+
+	/* The count is weighed against the other loads */
+	group[2].load_new_qpairs = 0;
+	group[0].stat.current_io_qpairs = 20;
+	group[1].load_busy = 150;
+	group[2].load_busy = 250;
+	CU_ASSERT(nvmf_tgt_get_least_loaded_poll_group(&tgt) == &group[1]);
+
+	for (i = 0; i < 3; i++) {
+		pthread_mutex_destroy(&group[i].mutex);
+	}
+	pthread_mutex_destroy(&tgt.mutex);
+}
+
+static void
+qpair_migrate_done(void *cb_arg, int status)
+{
+	*(int *)cb_arg = status;
+}
+
+static void
+poll_thread(struct spdk_thread *thread)
+{
+	while (spdk_thread_poll(thread, 0, 0) > 0) {
+	}
+}
+
+static void
+poll_both_threads(struct spdk_thread *thread1, struct spdk_thread *thread2)
+{
+	bool busy;
+
+	do {
+		busy = spdk_thread_poll(thread1, 0, 0) > 0;
+		busy |= spdk_thread_poll(thread2, 0, 0) > 0;
+	} while (busy);
+}
+
+static void
+test_spdk_nvmf_qpair_migrate(void)
+{
+	struct spdk_thread			*src_thread, *dst_thread;
+	struct spdk_nvmf_tgt			tgt = {};
+	struct spdk_nvmf_transport		transport = {};
+	struct spdk_nvmf_transport_poll_group	src_tgroup = {}, dst_tgroup = {};
+	struct spdk_nvmf_poll_group		src = {}, dst = {};
+	struct spdk_nvmf_subsystem		subsystem = {};
+	struct spdk_nvmf_ctrlr			ctrlr = {};
+	struct spdk_nvmf_qpair			qpair = {};
+	int					rc, status;
+
+	src_thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(src_thread != NULL);
+	dst_thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(dst_thread != NULL);
+	spdk_set_thread(src_thread);
+
+	TAILQ_INIT(&tgt.poll_groups);
+	pthread_mutex_init(&tgt.mutex, NULL);
+
+	src.tgt = &tgt;
+	src.thread = src_thread;
+	TAILQ_INIT(&src.tgroups);
+	TAILQ_INIT(&src.qpairs);
+	src_tgroup.transport = &transport;
+	TAILQ_INSERT_TAIL(&src.tgroups, &src_tgroup, link);
+	TAILQ_INSERT_TAIL(&tgt.poll_groups, &src, link);
+	dst.tgt = &tgt;
+	dst.thread = dst_thread;
+	TAILQ_INIT(&dst.tgroups);
+	TAILQ_INIT(&dst.qpairs);
+	dst_tgroup.transport = &transport;
+	TAILQ_INSERT_TAIL(&dst.tgroups, &dst_tgroup, link);
+	TAILQ_INSERT_TAIL(&tgt.poll_groups, &dst, link);
+
+	ctrlr.cntlid = 1;
+	ctrlr.subsys = &subsystem;
+	qpair.transport = &transport;
+	qpair.ctrlr = &ctrlr;
+	qpair.group = &src;
+	qpair.qid = 1;
+	qpair.state = SPDK_NVMF_QPAIR_ACTIVE;
+	TAILQ_INIT(&qpair.outstanding);
+	TAILQ_INSERT_TAIL(&src.qpairs, &qpair, link);
+	src.stat.current_io_qpairs = 1;
+
+	/* Admin qpairs stay on the controller's thread */
+	qpair.qid = 0;
+	rc = spdk_nvmf_qpair_migrate(&qpair, &dst, qpair_migrate_done, &status);
+	CU_ASSERT(rc == -EINVAL);
+	qpair.qid = 1;
+
+	rc = spdk_nvmf_qpair_migrate(&qpair, &src, qpair_migrate_done, &status);
+	CU_ASSERT(rc == -EALREADY);
+
+	MOCK_SET(nvmf_transport_qpair_migrate_supported, false);
+	rc = spdk_nvmf_qpair_migrate(&qpair, &dst, qpair_migrate_done, &status);
+	CU_ASSERT(rc == -ENOTSUP);
+	MOCK_SET(nvmf_transport_qpair_migrate_supported, true);
+
+	/* The qpair is only moved once it has drained */
+	status = 1;
+	MOCK_SET(nvmf_transport_qpair_is_idle, false);
+	rc = spdk_nvmf_qpair_migrate(&qpair, &dst, qpair_migrate_done, &status);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(qpair.migrate_ctx != NULL);
+	rc = spdk_nvmf_qpair_migrate(&qpair, &dst, qpair_migrate_done, &status);
+	CU_ASSERT(rc == -EBUSY);
+
+	spdk_delay_us(NVMF_QPAIR_MIGRATE_POLL_PERIOD_US);
+	poll_both_threads(src_thread, dst_thread);
+	CU_ASSERT(status == 1);
+	CU_ASSERT(qpair.group == &src);
+	CU_ASSERT(TAILQ_FIRST(&src.qpairs) == &qpair);
+
+	MOCK_SET(nvmf_transport_qpair_is_idle, true);
+	spdk_delay_us(NVMF_QPAIR_MIGRATE_POLL_PERIOD_US);
+	poll_both_threads(src_thread, dst_thread);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(qpair.group == &dst);
+	CU_ASSERT(qpair.migrate_ctx == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&src.qpairs));
+	CU_ASSERT(TAILQ_FIRST(&dst.qpairs) == &qpair);
+	CU_ASSERT(src.stat.current_io_qpairs == 0);
+	CU_ASSERT(dst.stat.current_io_qpairs == 1);
+
+	/* The migration is cancelled if the qpair doesn't drain in time */
+	spdk_set_thread(dst_thread);
+	status = 1;
+	MOCK_SET(nvmf_transport_qpair_is_idle, false);
+	rc = spdk_nvmf_qpair_migrate(&qpair, &src, qpair_migrate_done, &status);
+	CU_ASSERT(rc == 0);
+	spdk_delay_us(NVMF_QPAIR_MIGRATE_TIMEOUT_US + NVMF_QPAIR_MIGRATE_POLL_PERIOD_US);
+	poll_both_threads(src_thread, dst_thread);
+	CU_ASSERT(status == -ETIMEDOUT);
+	CU_ASSERT(qpair.group == &dst);
+	CU_ASSERT(qpair.migrate_ctx == NULL);
+	CU_ASSERT(TAILQ_FIRST(&dst.qpairs) == &qpair);
+	MOCK_SET(nvmf_transport_qpair_is_idle, true);
+
+	/* The qpair goes back if the destination poll group is destroyed in the meantime */
+	status = 1;
+	rc = spdk_nvmf_qpair_migrate(&qpair, &src, qpair_migrate_done, &status);
+	CU_ASSERT(rc == 0);
+	TAILQ_REMOVE(&tgt.poll_groups, &src, link);
+	spdk_delay_us(NVMF_QPAIR_MIGRATE_POLL_PERIOD_US);
+	poll_both_threads(src_thread, dst_thread);
+	CU_ASSERT(status == -ENODEV);
+	CU_ASSERT(qpair.group == &dst);
+	CU_ASSERT(qpair.migrate_ctx == NULL);
+	CU_ASSERT(TAILQ_FIRST(&dst.qpairs) == &qpair);
+	CU_ASSERT(dst.stat.current_io_qpairs == 1);
+
+	pthread_mutex_destroy(&tgt.mutex);
+
+	spdk_set_thread(src_thread);
+	spdk_thread_exit(src_thread);
+	while (!spdk_thread_is_exited(src_thread)) {
+		spdk_thread_poll(src_thread, 0, 0);
+	}
+	spdk_thread_destroy(src_thread);
+	spdk_set_thread(dst_thread);
+	spdk_thread_exit(dst_thread);
+	while (!spdk_thread_is_exited(dst_thread)) {
+		spdk_thread_poll(dst_thread, 0, 0);
+	}
+	spdk_thread_destroy(dst_thread);
+}
+
+static void
+test_spdk_nvmf_tgt_new_qpair(void)
+{
+	struct spdk_thread			*thread;
+	struct spdk_nvmf_tgt			tgt = {};
+	struct spdk_nvmf_transport		transport = {};
+	struct spdk_nvmf_transport_poll_group	tgroup[3] = {};
+	struct spdk_nvmf_poll_group		group[3] = {};
+	struct spdk_nvmf_qpair			qpair = {};
+	int					i;
+
+	thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+
+	TAILQ_INIT(&tgt.poll_groups);
+	pthread_mutex_init(&tgt.mutex, NULL);
+	for (i = 0; i < 3; i++) {
+		group[i].tgt = &tgt;
+		group[i].thread = thread;
+		pthread_mutex_init(&group[i].mutex, NULL);
+		TAILQ_INIT(&group[i].tgroups);
+		TAILQ_INIT(&group[i].qpairs);
+		tgroup[i].transport = &transport;
+		tgroup[i].group = &group[i];
+		TAILQ_INSERT_TAIL(&group[i].tgroups, &tgroup[i], link);
+		TAILQ_INSERT_TAIL(&tgt.poll_groups, &group[i], link);
+	}
+	qpair.transport = &transport;
+
+	/* Without an affinity reported by the transport, the least loaded group is picked */
+	group[0].load_busy = 500;
+	group[1].load_busy = 300;
+	group[2].load_busy = 100;
+	spdk_nvmf_tgt_new_qpair(&tgt, &qpair);
+	CU_ASSERT(group[2].current_unassociated_qpairs == 1);
+	CU_ASSERT(group[2].load_new_qpairs == 1);
+	poll_thread(thread);
+	CU_ASSERT(qpair.group == &group[2]);
+	CU_ASSERT(TAILQ_FIRST(&group[2].qpairs) == &qpair);
+	TAILQ_REMOVE(&group[2].qpairs, &qpair, link);
+
+	/* The transport's choice is kept if the qpair has an affinity to a group */
+	MOCK_SET(nvmf_transport_get_optimal_poll_group, &tgroup[0]);
+	spdk_nvmf_tgt_new_qpair(&tgt, &qpair);
+	CU_ASSERT(group[0].current_unassociated_qpairs == 1);
+	CU_ASSERT(group[0].load_new_qpairs == 0);
+	poll_thread(thread);
+	CU_ASSERT(qpair.group == &group[0]);
+	CU_ASSERT(TAILQ_FIRST(&group[0].qpairs) == &qpair);
+	TAILQ_REMOVE(&group[0].qpairs, &qpair, link);
+	MOCK_SET(nvmf_transport_get_optimal_poll_group, NULL);
+
+	for (i = 0; i < 3; i++) {
+		pthread_mutex_destroy(&group[i].mutex);
+	}
+	pthread_mutex_destroy(&tgt.mutex);
+
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -226,6 +527,9 @@ main(int argc, char **argv)
 	suite = CU_add_suite("nvmf", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_nvmf_tgt_create_poll_group);
+	CU_ADD_TEST(suite, test_nvmf_tgt_get_least_loaded_poll_group);
+	CU_ADD_TEST(suite, test_spdk_nvmf_qpair_migrate);
+	CU_ADD_TEST(suite, test_spdk_nvmf_tgt_new_qpair);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -1266,6 +1266,58 @@ test_nvmf_tcp_pdu_ch_handle(void)
 			  struct spdk_nvme_tcp_common_pdu_hdr));
 }
 
+static void
+test_nvmf_tcp_qpair_quiesce(void)
+{
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct nvme_tcp_pdu mgmt_pdu = {}, pdu_in_progress = {};
+	int rc;
+
+	mgmt_pdu.qpair = &tqpair;
+	tqpair.mgmt_pdu = &mgmt_pdu;
+	tqpair.pdu_in_progress = &pdu_in_progress;
+	tqpair.qpair.transport = &ttransport.transport;
+	tqpair.state = NVME_TCP_QPAIR_STATE_RUNNING;
+	tqpair.resource_count = 1;
+	tqpair.state_cntr[TCP_REQUEST_STATE_FREE] = 1;
+	tqpair.quiesced = true;
+
+	/* Test case: A new command is held back while the qpair is quiesced */
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH;
+	pdu_in_progress.ch_valid_bytes = sizeof(struct spdk_nvme_tcp_common_pdu_hdr);
+	pdu_in_progress.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD;
+	pdu_in_progress.hdr.common.hlen = sizeof(struct spdk_nvme_tcp_cmd);
+	pdu_in_progress.hdr.common.plen = sizeof(struct spdk_nvme_tcp_cmd);
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH);
+	CU_ASSERT(pdu_in_progress.psh_valid_bytes == 0);
+	CU_ASSERT(nvmf_tcp_qpair_is_idle(&tqpair.qpair));
+
+	/* Test case: Other PDUs are still received while the qpair is quiesced */
+	pdu_in_progress.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_H2C_TERM_REQ;
+	pdu_in_progress.hdr.common.hlen = sizeof(struct spdk_nvme_tcp_term_req_hdr);
+	pdu_in_progress.hdr.common.plen = sizeof(struct spdk_nvme_tcp_term_req_hdr) + 4;
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH);
+	CU_ASSERT(pdu_in_progress.psh_valid_bytes > 0);
+	CU_ASSERT(!nvmf_tcp_qpair_is_idle(&tqpair.qpair));
+
+	/* Test case: The command is received once the qpair is resumed */
+	tqpair.quiesced = false;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH;
+	pdu_in_progress.psh_valid_bytes = 0;
+	pdu_in_progress.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD;
+	pdu_in_progress.hdr.common.hlen = sizeof(struct spdk_nvme_tcp_cmd);
+	pdu_in_progress.hdr.common.plen = sizeof(struct spdk_nvme_tcp_cmd);
+	rc = nvmf_tcp_sock_process(&tqpair);
+	CU_ASSERT(rc == NVME_TCP_PDU_IN_PROGRESS);
+	CU_ASSERT(tqpair.recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH);
+	CU_ASSERT(pdu_in_progress.psh_valid_bytes > 0);
+}
+
 static void
 test_nvmf_tcp_tls_add_remove_credentials(void)
 {
@@ -1469,6 +1521,166 @@ test_nvmf_tcp_tls_generate_tls_psk(void)
 					  NVME_TCP_CIPHER_AES_128_GCM_SHA256) < 0);
 }
 
+static int
+ut_poll_group_poll(void *ctx)
+{
+	return SPDK_POLLER_IDLE;
+}
+
+static void
+test_nvmf_tcp_interrupt(void)
+{
+	struct spdk_thread *thread;
+	struct spdk_nvmf_transport *transport;
+	struct spdk_nvmf_tcp_transport *ttransport;
+	struct spdk_nvmf_transport_opts opts;
+	struct spdk_nvmf_transport_poll_group *group;
+	struct spdk_nvmf_tcp_poll_group *tgroup;
+	struct spdk_nvmf_poll_group pg = {};
+	struct spdk_poller *poller;
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_port *port;
+	struct spdk_nvme_transport_id trid = {};
+	struct spdk_nvmf_listen_opts listen_opts = {};
+	struct spdk_sock_group grp = {};
+	uint64_t notify;
+	int listen_fd, rc;
+
+	/* Interrupt mode cannot be disabled again, so this test has to run last */
+	rc = spdk_interrupt_mode_enable();
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+	/* The test drives the thread itself, there is no reactor to reschedule it */
+	spdk_thread_set_interrupt_mode(false);
+
+	init_accel();
+
+	memset(&opts, 0, sizeof(opts));
+	opts.max_queue_depth = UT_MAX_QUEUE_DEPTH;
+	opts.max_qpairs_per_ctrlr = UT_MAX_QPAIRS_PER_CTRLR;
+	opts.in_capsule_data_size = UT_IN_CAPSULE_DATA_SIZE;
+	opts.max_io_size = UT_MAX_IO_SIZE;
+	opts.io_unit_size = UT_IO_UNIT_SIZE;
+	opts.max_aq_depth = UT_MAX_AQ_DEPTH;
+	opts.num_shared_buffers = UT_NUM_SHARED_BUFFERS;
+	opts.acceptor_poll_rate = 10000;
+	transport = nvmf_tcp_create(&opts);
+	SPDK_CU_ASSERT_FATAL(transport != NULL);
+	transport->opts = opts;
+	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
+
+	/* A listening socket with interrupt support accepts connections from its interrupt */
+	listen_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	SPDK_CU_ASSERT_FATAL(listen_fd >= 0);
+	trid.trtype = SPDK_NVME_TRANSPORT_TCP;
+	trid.adrfam = SPDK_NVMF_ADRFAM_IPV4;
+	snprintf(trid.traddr, sizeof(trid.traddr), "192.168.1.100");
+	snprintf(trid.trsvcid, sizeof(trid.trsvcid), "4420");
+	MOCK_SET(spdk_sock_listen_ext, (struct spdk_sock *)0xDEADBEEF);
+	MOCK_SET(spdk_sock_get_interrupt_fd, listen_fd);
+	rc = nvmf_tcp_listen(transport, &trid, &listen_opts);
+	CU_ASSERT(rc == 0);
+	port = TAILQ_FIRST(&ttransport->ports);
+	SPDK_CU_ASSERT_FATAL(port != NULL);
+	CU_ASSERT(port->listen_intr != NULL);
+	CU_ASSERT(port->accept_poller == NULL);
+	nvmf_tcp_stop_listen(transport, &trid);
+	CU_ASSERT(TAILQ_EMPTY(&ttransport->ports));
+
+	/* Without interrupt support, the port falls back to an accept poller */
+	MOCK_SET(spdk_sock_get_interrupt_fd, -1);
+	rc = nvmf_tcp_listen(transport, &trid, &listen_opts);
+	CU_ASSERT(rc == 0);
+	port = TAILQ_FIRST(&ttransport->ports);
+	SPDK_CU_ASSERT_FATAL(port != NULL);
+	CU_ASSERT(port->listen_intr == NULL);
+	CU_ASSERT(port->accept_poller != NULL);
+	nvmf_tcp_stop_listen(transport, &trid);
+	CU_ASSERT(TAILQ_EMPTY(&ttransport->ports));
+	MOCK_CLEAR_P(spdk_sock_listen_ext);
+	close(listen_fd);
+
+	poller = SPDK_POLLER_REGISTER(ut_poll_group_poll, NULL, 0);
+	SPDK_CU_ASSERT_FATAL(poller != NULL);
+	pg.poller = poller;
+	MOCK_SET(spdk_sock_group_create, &grp);
+
+	/* A failure to register the sock group's interrupts fails the poll group */
+	MOCK_SET(spdk_sock_group_register_interrupts, -ENOMEM);
+	group = nvmf_tcp_poll_group_create(transport, &pg);
+	CU_ASSERT(group == NULL);
+
+	/* Without interrupt support, the poll group is polled and the fd group is unwound */
+	MOCK_SET(spdk_sock_group_register_interrupts, -ENOTSUP);
+	group = nvmf_tcp_poll_group_create(transport, &pg);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	CU_ASSERT(tgroup->fgrp == NULL);
+	CU_ASSERT(tgroup->intr == NULL);
+	CU_ASSERT(tgroup->event_fd == -1);
+	nvmf_tcp_poll_group_kick(tgroup);
+	CU_ASSERT(!tgroup->event_pending);
+	group->transport = transport;
+	nvmf_tcp_poll_group_destroy(group);
+
+	MOCK_SET(spdk_sock_group_register_interrupts, 0);
+	group = nvmf_tcp_poll_group_create(transport, &pg);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	CU_ASSERT(tgroup->fgrp != NULL);
+	CU_ASSERT(tgroup->intr != NULL);
+	CU_ASSERT(tgroup->event_fd >= 0);
+	group->transport = transport;
+	group->group = &pg;
+
+	/* Kicks are coalesced until the interrupt acknowledges them */
+	nvmf_tcp_poll_group_kick(tgroup);
+	CU_ASSERT(tgroup->event_pending);
+	nvmf_tcp_poll_group_kick(tgroup);
+	CU_ASSERT(read(tgroup->event_fd, &notify, sizeof(notify)) == sizeof(notify));
+	CU_ASSERT(notify == 1);
+	nvmf_tcp_poll_group_kick(tgroup);
+	CU_ASSERT(read(tgroup->event_fd, &notify, sizeof(notify)) == -1);
+
+	/* While polling is paused, the interrupt leaves the kick pending */
+	pg.poller = NULL;
+	nvmf_tcp_poll_group_intr(tgroup);
+	CU_ASSERT(tgroup->event_pending);
+	pg.poller = poller;
+
+	/* A pass that handled events kicks the poll group again */
+	TAILQ_INSERT_TAIL(&tgroup->qpairs, &tqpair, link);
+	MOCK_SET(spdk_sock_group_poll, 1);
+	rc = nvmf_tcp_poll_group_intr(tgroup);
+	CU_ASSERT(rc == SPDK_POLLER_BUSY);
+	CU_ASSERT(tgroup->event_pending);
+	CU_ASSERT(read(tgroup->event_fd, &notify, sizeof(notify)) == sizeof(notify));
+
+	/* An idle pass only acknowledges the kick */
+	MOCK_SET(spdk_sock_group_poll, 0);
+	rc = nvmf_tcp_poll_group_intr(tgroup);
+	CU_ASSERT(rc == SPDK_POLLER_IDLE);
+	CU_ASSERT(!tgroup->event_pending);
+	CU_ASSERT(read(tgroup->event_fd, &notify, sizeof(notify)) == -1);
+	TAILQ_REMOVE(&tgroup->qpairs, &tqpair, link);
+
+	nvmf_tcp_poll_group_destroy(group);
+	MOCK_CLEAR_P(spdk_sock_group_create);
+	MOCK_SET(spdk_sock_get_interrupt_fd, -1);
+	spdk_poller_unregister(&poller);
+	nvmf_tcp_destroy(transport, NULL, NULL);
+
+	fini_accel();
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1493,10 +1705,12 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_check_xfer_type);
 	CU_ADD_TEST(suite, test_nvmf_tcp_invalid_sgl);
 	CU_ADD_TEST(suite, test_nvmf_tcp_pdu_ch_handle);
+	CU_ADD_TEST(suite, test_nvmf_tcp_qpair_quiesce);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_add_remove_credentials);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_psk_id);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_retained_psk);
 	CU_ADD_TEST(suite, test_nvmf_tcp_tls_generate_tls_psk);
+	CU_ADD_TEST(suite, test_nvmf_tcp_interrupt);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -615,6 +615,295 @@ iobuf_cache(void)
 	free_cores();
 }
 
+static void
+ut_iobuf_get_stats_cb(struct spdk_iobuf_module_stats *modules, uint32_t num_modules, void *cb_arg)
+{
+	struct spdk_iobuf_module_stats *stats = cb_arg;
+	uint32_t i;
+
+	CU_ASSERT_EQUAL(num_modules, 2);
+	for (i = 0; i < num_modules; ++i) {
+		stats[i] = modules[i];
+		/* The name is only valid during the callback */
+		CU_ASSERT_STRING_EQUAL(modules[i].module, i == 0 ? "ut_module0" : "ut_module1");
+	}
+}
+
+static void
+iobuf_depot(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 128,
+		.large_pool_count = 8,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = LARGE_BUFSIZE,
+	};
+	struct spdk_iobuf_channel iobuf_ch[2];
+	struct spdk_iobuf_module_stats stats[2] = {};
+	void *bufs[12];
+	size_t ring_count;
+	int rc, finish = 0;
+	uint32_t i;
+
+	allocate_cores(1);
+	allocate_threads(1);
+
+	set_thread(0);
+
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+
+	rc = spdk_iobuf_register_module("ut_module0");
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_register_module("ut_module1");
+	CU_ASSERT_EQUAL(rc, 0);
+
+	rc = spdk_iobuf_channel_init(&iobuf_ch[0], "ut_module0", 4, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[1], "ut_module1", 4, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	/* Allocate more buffers than cached, so that some are taken from the global pool */
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch[0], SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+	CU_ASSERT_EQUAL(iobuf_ch[0].small.stats.cache, 10);
+	CU_ASSERT_EQUAL(iobuf_ch[0].small.stats.main, 2);
+	ring_count = spdk_ring_count(g_iobuf.nodes[0].small_pool);
+	CU_ASSERT_EQUAL(ring_count, 128 - 4 - 4 - 8);
+
+	/* Release them through the other module.  Buffers overflowing its cache stay on the thread
+	 * instead of going back to the global pool...
+	 */
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		spdk_iobuf_put(&iobuf_ch[1], bufs[i], SMALL_BUFSIZE);
+	}
+	CU_ASSERT_EQUAL(iobuf_ch[1].small.cache_count, 4);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.nodes[0].small_pool), ring_count);
+
+	/* ...and are reused by the first module without touching the global pool */
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch[0], SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+	CU_ASSERT_EQUAL(iobuf_ch[0].small.stats.cache, 19);
+	CU_ASSERT_EQUAL(iobuf_ch[0].small.stats.depot, 3);
+	CU_ASSERT_EQUAL(iobuf_ch[0].small.stats.main, 2);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.nodes[0].small_pool), ring_count);
+
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		spdk_iobuf_put(&iobuf_ch[0], bufs[i], SMALL_BUFSIZE);
+	}
+
+	rc = spdk_iobuf_get_stats(ut_iobuf_get_stats_cb, stats);
+	CU_ASSERT_EQUAL(rc, 0);
+	poll_threads();
+	CU_ASSERT_EQUAL(stats[0].small_pool.cache, 19);
+	CU_ASSERT_EQUAL(stats[0].small_pool.depot, 3);
+	CU_ASSERT_EQUAL(stats[0].small_pool.main, 2);
+	CU_ASSERT_EQUAL(stats[0].small_pool.retry, 0);
+	CU_ASSERT_EQUAL(stats[1].small_pool.cache, 0);
+	CU_ASSERT_EQUAL(stats[1].small_pool.main, 0);
+
+	/* Buffers kept on the thread are returned to the pool once all channels are gone */
+	spdk_iobuf_channel_fini(&iobuf_ch[0]);
+	spdk_iobuf_channel_fini(&iobuf_ch[1]);
+	poll_threads();
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.nodes[0].small_pool), 128);
+
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+
+	free_threads();
+	free_cores();
+}
+
+static void
+iobuf_depot_flush(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 128,
+		.large_pool_count = 8,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = LARGE_BUFSIZE,
+	};
+	struct spdk_iobuf_channel iobuf_ch[2];
+	struct iobuf_channel *ch;
+	void *bufs[128];
+	size_t ring_count;
+	int rc, finish = 0;
+	uint32_t i, num_bufs = 0;
+
+	allocate_cores(1);
+	allocate_threads(1);
+
+	set_thread(0);
+
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+
+	rc = spdk_iobuf_register_module("ut_module0");
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_register_module("ut_module1");
+	CU_ASSERT_EQUAL(rc, 0);
+
+	rc = spdk_iobuf_channel_init(&iobuf_ch[0], "ut_module0", 4, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[1], "ut_module1", 4, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	ch = spdk_io_channel_get_ctx(iobuf_ch[1].parent);
+
+	/* Park a couple of batches in the thread's depot */
+	for (i = 0; i < 12; ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch[0], SMALL_BUFSIZE, NULL, NULL);
+		CU_ASSERT_PTR_NOT_NULL(bufs[i]);
+	}
+	for (i = 0; i < 12; ++i) {
+		spdk_iobuf_put(&iobuf_ch[1], bufs[i], SMALL_BUFSIZE);
+	}
+	CU_ASSERT_EQUAL(ch->small_depot.count, 3);
+
+	/* Drain the global pool below its low-water mark, leaving the depot alone */
+	while (spdk_ring_count(g_iobuf.nodes[0].small_pool) >= 128 / IOBUF_DEPOT_POOL_RESERVE) {
+		rc = spdk_ring_dequeue(g_iobuf.nodes[0].small_pool, &bufs[num_bufs], 1);
+		CU_ASSERT_EQUAL(rc, 1);
+		num_bufs++;
+	}
+	CU_ASSERT_EQUAL(ch->small_depot.count, 3);
+
+	/* The next release on the thread hands the depot back to the global pool */
+	ring_count = spdk_ring_count(g_iobuf.nodes[0].small_pool);
+	bufs[num_bufs] = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, NULL, NULL);
+	CU_ASSERT_PTR_NOT_NULL(bufs[num_bufs]);
+	spdk_iobuf_put(&iobuf_ch[1], bufs[num_bufs], SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(ch->small_depot.count, 0);
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.nodes[0].small_pool), ring_count + 12);
+
+	spdk_ring_enqueue(g_iobuf.nodes[0].small_pool, bufs, num_bufs, NULL);
+	spdk_iobuf_channel_fini(&iobuf_ch[0]);
+	spdk_iobuf_channel_fini(&iobuf_ch[1]);
+	poll_threads();
+	CU_ASSERT_EQUAL(spdk_ring_count(g_iobuf.nodes[0].small_pool), 128);
+
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+
+	free_threads();
+	free_cores();
+}
+
+static void
+iobuf_numa(void)
+{
+	struct spdk_iobuf_opts opts = {
+		.small_pool_count = 64,
+		.large_pool_count = 8,
+		.small_bufsize = SMALL_BUFSIZE,
+		.large_bufsize = LARGE_BUFSIZE,
+		.enable_numa = true,
+	};
+	struct spdk_iobuf_channel iobuf_ch[2];
+	struct iobuf_node *node0, *node1;
+	void *bufs[64], *buf, *remote_buf;
+	int rc, finish = 0;
+	uint32_t i;
+
+	allocate_cores(1);
+	allocate_threads(2);
+
+	set_thread(0);
+
+	/* Pretend there are two NUMA nodes */
+	MOCK_SET(spdk_env_get_current_core, 0);
+	MOCK_SET(spdk_env_get_socket_id, 1);
+
+	g_iobuf.opts = opts;
+	rc = spdk_iobuf_initialize();
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_iobuf.num_nodes, 2);
+	node0 = &g_iobuf.nodes[0];
+	node1 = &g_iobuf.nodes[1];
+
+	rc = spdk_iobuf_register_module("ut_module0");
+	CU_ASSERT_EQUAL(rc, 0);
+
+	/* Each thread uses the pool of its own node */
+	MOCK_SET(spdk_env_get_socket_id, 0);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[0], "ut_module0", 0, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_PTR_EQUAL(iobuf_ch[0].small.pool, node0->small_pool);
+
+	set_thread(1);
+	MOCK_SET(spdk_env_get_socket_id, 1);
+	rc = spdk_iobuf_channel_init(&iobuf_ch[1], "ut_module0", 0, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_PTR_EQUAL(iobuf_ch[1].small.pool, node1->small_pool);
+
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		bufs[i] = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, NULL, NULL);
+		SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+		CU_ASSERT((char *)bufs[i] >= (char *)node1->small_pool_base);
+		CU_ASSERT((char *)bufs[i] < (char *)node1->small_pool_base + 64 * SMALL_BUFSIZE);
+	}
+
+	/* The local node is exhausted and falling back to other nodes is disabled */
+	buf = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, NULL, NULL);
+	CU_ASSERT_PTR_NULL(buf);
+	CU_ASSERT_EQUAL(spdk_ring_count(node0->small_pool), 64);
+
+	/* Buffers released on another node go back to their own pool */
+	set_thread(0);
+	spdk_iobuf_put(&iobuf_ch[0], bufs[0], SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(spdk_ring_count(node1->small_pool), 1);
+	CU_ASSERT_EQUAL(spdk_ring_count(node0->small_pool), 64);
+
+	/* Once enabled, the remote node is used only after the local one is exhausted */
+	g_iobuf.opts.numa_fallback = true;
+	set_thread(1);
+	bufs[0] = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, NULL, NULL);
+	CU_ASSERT_PTR_NOT_NULL(bufs[0]);
+	CU_ASSERT_EQUAL(iobuf_ch[1].small.stats.remote, 0);
+	remote_buf = spdk_iobuf_get(&iobuf_ch[1], SMALL_BUFSIZE, NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(remote_buf != NULL);
+	CU_ASSERT((char *)remote_buf >= (char *)node0->small_pool_base);
+	CU_ASSERT((char *)remote_buf < (char *)node0->small_pool_base + 64 * SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(iobuf_ch[1].small.stats.remote, 1);
+	CU_ASSERT_EQUAL(spdk_ring_count(node0->small_pool), 63);
+
+	spdk_iobuf_put(&iobuf_ch[1], remote_buf, SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(spdk_ring_count(node0->small_pool), 64);
+	for (i = 0; i < SPDK_COUNTOF(bufs); ++i) {
+		spdk_iobuf_put(&iobuf_ch[1], bufs[i], SMALL_BUFSIZE);
+	}
+	CU_ASSERT_EQUAL(spdk_ring_count(node1->small_pool), 64);
+
+	spdk_iobuf_channel_fini(&iobuf_ch[1]);
+	set_thread(0);
+	spdk_iobuf_channel_fini(&iobuf_ch[0]);
+	poll_threads();
+
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &finish);
+	poll_threads();
+
+	CU_ASSERT_EQUAL(finish, 1);
+	CU_ASSERT_EQUAL(g_iobuf.num_nodes, 0);
+
+	MOCK_CLEAR(spdk_env_get_current_core);
+	MOCK_CLEAR(spdk_env_get_socket_id);
+	g_iobuf.opts.enable_numa = false;
+	g_iobuf.opts.numa_fallback = false;
+
+	free_threads();
+	free_cores();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -627,6 +916,9 @@ main(int argc, char **argv)
 	suite = CU_add_suite("io_channel", NULL, NULL);
 	CU_ADD_TEST(suite, iobuf);
 	CU_ADD_TEST(suite, iobuf_cache);
+	CU_ADD_TEST(suite, iobuf_depot);
+	CU_ADD_TEST(suite, iobuf_depot_flush);
+	CU_ADD_TEST(suite, iobuf_numa);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
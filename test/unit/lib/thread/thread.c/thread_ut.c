@@ -146,6 +146,91 @@ thread_send_msg(void)
 	free_threads();
 }
 
+static void
+count_msg_cb(void *ctx)
+{
+	uint32_t *count = ctx;
+
+	(*count)++;
+}
+
+static int
+busy_poller(void *ctx)
+{
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+thread_msg_batch_size(void)
+{
+	struct spdk_thread *thread0;
+	struct spdk_poller *poller;
+	uint32_t count = 0, prev, i;
+	int rc;
+
+	allocate_threads(2);
+	set_thread(0);
+	thread0 = spdk_get_thread();
+
+	/* Send 300 messages to thread 0 */
+	set_thread(1);
+	for (i = 0; i < 300; i++) {
+		rc = spdk_thread_send_msg(thread0, count_msg_cb, &count);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 300);
+
+	/* An explicit limit keeps the old cap */
+	spdk_thread_poll(thread0, 100, 0);
+	CU_ASSERT(count == SPDK_MSG_BATCH_SIZE);
+	CU_ASSERT(thread0->msg_batch_size == SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 1, 0);
+	CU_ASSERT(count - prev == 1);
+
+	/* Without a limit, the budget grows while the messages are backing up */
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 2 * SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 4 * SPDK_MSG_BATCH_SIZE);
+
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 8 * SPDK_MSG_BATCH_SIZE);
+
+	/* ...and shrinks back once the pollers have work */
+	set_thread(0);
+	poller = spdk_poller_register(busy_poller, NULL, 0);
+	CU_ASSERT(poller != NULL);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 8 * SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 4 * SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == 2 * SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == SPDK_MSG_BATCH_SIZE);
+	prev = count;
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(count - prev == SPDK_MSG_BATCH_SIZE);
+	spdk_poller_unregister(&poller);
+
+	poll_threads();
+	CU_ASSERT(count == 300);
+	CU_ASSERT(thread0->msg_batch_size == SPDK_MSG_BATCH_SIZE);
+
+	free_threads();
+}
+
 static int
 poller_run_done(void *ctx)
 {
@@ -1926,6 +2011,7 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, thread_alloc);
 	CU_ADD_TEST(suite, thread_send_msg);
+	CU_ADD_TEST(suite, thread_msg_batch_size);
 	CU_ADD_TEST(suite, thread_poller);
 	CU_ADD_TEST(suite, poller_pause);
 	CU_ADD_TEST(suite, thread_for_each);
@@ -28,6 +28,10 @@ function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/scsi_nvme.c/scsi_nvme_ut
 	$valgrind $testdir/lib/bdev/vbdev_lvol.c/vbdev_lvol_ut
 	$valgrind $testdir/lib/bdev/vbdev_zone_block.c/vbdev_zone_block_ut
+	$valgrind $testdir/lib/bdev/vbdev_cache.c/vbdev_cache_ut
+	$valgrind $testdir/lib/bdev/vbdev_dedup.c/vbdev_dedup_ut
+	$valgrind $testdir/lib/bdev/vbdev_readahead.c/vbdev_readahead_ut
+	$valgrind $testdir/lib/bdev/bdev_malloc.c/bdev_malloc_ut
 	$valgrind $testdir/lib/bdev/mt/bdev.c/bdev_ut
 }
 